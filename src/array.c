@@ -18,6 +18,10 @@ static void arr_release(GC *gc, void *ptr) {
     }
 }
 
+static int arr_is_container(VMValue value) {
+    return value.type == VALUE_ARRAY || value.type == VALUE_MAPPING;
+}
+
 array_t* array_new(GC *gc, size_t capacity) {
     array_t *arr = (array_t *)arr_alloc(gc, sizeof(array_t), GC_TYPE_ARRAY);
     if (!arr) return NULL;
@@ -25,28 +29,132 @@ array_t* array_new(GC *gc, size_t capacity) {
     arr->gc = gc;
     arr->length = 0;
     arr->capacity = capacity > 0 ? capacity : 8;
+    arr->shared = NULL;
+    arr->containers = 0;
+    /* Slots past length are never read, so they are left as they come */
     arr->elements = (VMValue *)arr_alloc(gc, sizeof(VMValue) * arr->capacity, GC_TYPE_GENERIC);
     if (!arr->elements) {
         arr_release(gc, arr);
         return NULL;
     }
 
-    for (size_t i = 0; i < arr->capacity; i++) {
-        arr->elements[i].type = VALUE_UNINITIALIZED;
+    return arr;
+}
+
+/* ========== Sharing ========== */
+
+/* Free values[from..to); shallow releases only strings, leaving nested
+ * arrays and mappings to the collector */
+static void arr_free_values(VMValue *values, size_t from, size_t to, int deep) {
+    for (size_t i = from; i < to; i++) {
+        if (deep) {
+            vm_value_free(&values[i]);
+        } else if (values[i].type == VALUE_STRING) {
+            vm_value_release(&values[i]);
+        }
     }
+}
 
-    return arr;
+/* Stop using shared storage, freeing it if arr was its last user */
+static void arr_drop_shared(array_t *arr, int deep) {
+    array_shared_t *shared = arr->shared;
+    arr->shared = NULL;
+    if (--shared->refs > 0) return;
+
+    arr_free_values(shared->values, 0, shared->length, deep);
+    arr_release(arr->gc, shared->values);
+    arr_release(arr->gc, shared);
+}
+
+/* View of length elements of arr from start, sharing its storage */
+static array_t* arr_share(array_t *arr, size_t start, size_t length) {
+    if (!arr->shared) {
+        array_shared_t *shared = (array_shared_t *)arr_alloc(arr->gc, sizeof(array_shared_t),
+                                                             GC_TYPE_GENERIC);
+        if (!shared) return NULL;
+        shared->refs = 1;
+        shared->values = arr->elements;
+        shared->length = arr->length;
+        shared->capacity = arr->capacity;
+        arr->shared = shared;
+    }
+
+    array_t *view = (array_t *)arr_alloc(arr->gc, sizeof(array_t), GC_TYPE_ARRAY);
+    if (!view) return NULL;
+
+    view->gc = arr->gc;
+    view->elements = arr->elements + start;
+    view->length = length;
+    view->capacity = length;
+    view->shared = arr->shared;
+    view->containers = arr->containers;
+    arr->shared->refs++;
+
+    /* The view is born marked mid-cycle and never traced; marking arr
+     * marks the values it shares */
+    if (arr->containers > 0) {
+        VMValue source;
+        source.type = VALUE_ARRAY;
+        source.data.array_value = arr;
+        vm_value_write_barrier(source);
+    }
+    return view;
+}
+
+/**
+ * Give arr storage of its own before a write. The last user of the whole
+ * storage simply takes it back; otherwise the visible elements are copied
+ * (moved, if no other array still reads them).
+ */
+static int arr_unshare(array_t *arr) {
+    array_shared_t *shared = arr->shared;
+    if (!shared) return 0;
+
+    if (shared->refs == 1 && arr->elements == shared->values && arr->length == shared->length) {
+        arr->capacity = shared->capacity;
+        arr->shared = NULL;
+        arr_release(arr->gc, shared);
+        return 0;
+    }
+
+    size_t capacity = arr->length > 8 ? arr->length : 8;
+    VMValue *values = (VMValue *)arr_alloc(arr->gc, sizeof(VMValue) * capacity, GC_TYPE_GENERIC);
+    if (!values) return -1;
+
+    int last = shared->refs == 1;
+    size_t offset = (size_t)(arr->elements - shared->values);
+    arr->containers = 0;
+    for (size_t i = 0; i < arr->length; i++) {
+        values[i] = arr->elements[i];
+        if (!last) vm_value_addref(&values[i]);
+        if (arr_is_container(values[i])) arr->containers++;
+    }
+
+    if (last) {
+        /* The rest go; other arrays may hold their nested values, so
+         * with a collector those are left to it */
+        int deep = arr->gc == NULL;
+        arr_free_values(shared->values, 0, offset, deep);
+        arr_free_values(shared->values, offset + arr->length, shared->length, deep);
+        arr_release(arr->gc, shared->values);
+        arr_release(arr->gc, shared);
+    } else {
+        shared->refs--;
+    }
+
+    arr->shared = NULL;
+    arr->elements = values;
+    arr->capacity = capacity;
+    return 0;
 }
 
+/* ========== Elements ========== */
+
 static int array_grow(array_t *arr) {
     size_t new_cap = arr->capacity > 0 ? arr->capacity * 2 : 8;
     VMValue *new_elems = (VMValue *)arr_alloc(arr->gc, sizeof(VMValue) * new_cap, GC_TYPE_GENERIC);
     if (!new_elems) return -1;
 
-    for (size_t i = 0; i < new_cap; i++) {
-        new_elems[i].type = VALUE_UNINITIALIZED;
-    }
-
     if (arr->elements) {
         memcpy(new_elems, arr->elements, sizeof(VMValue) * arr->length);
         arr_release(arr->gc, arr->elements);
@@ -58,18 +166,22 @@ static int array_grow(array_t *arr) {
 }
 
 int array_push(array_t *arr, VMValue value) {
-    if (!arr) return -1;
+    if (!arr || arr_unshare(arr) != 0) return -1;
     if (arr->length >= arr->capacity) {
         if (array_grow(arr) != 0) return -1;
     }
+    vm_value_write_barrier(value);
     arr->elements[arr->length++] = value;
+    if (arr_is_container(value)) arr->containers++;
     return 0;
 }
 
 int array_pop(array_t *arr, VMValue *out) {
-    if (!arr || arr->length == 0) return -1;
+    if (!arr || arr->length == 0 || arr_unshare(arr) != 0) return -1;
+    VMValue last = arr->elements[arr->length - 1];
+    if (arr_is_container(last)) arr->containers--;
     if (out) {
-        *out = arr->elements[arr->length - 1];
+        *out = last;
     }
     arr->length--;
     return 0;
@@ -83,28 +195,36 @@ VMValue array_get(const array_t *arr, size_t index) {
 }
 
 int array_set(array_t *arr, size_t index, VMValue value) {
-    if (!arr || index >= arr->length) return -1;
-    vm_value_free(&arr->elements[index]);
+    if (!arr || index >= arr->length || arr_unshare(arr) != 0) return -1;
+    if (arr_is_container(arr->elements[index])) arr->containers--;
+    /* Other values may still reach a nested container; the collector
+     * reclaims it once none do */
+    vm_value_release(&arr->elements[index]);
+    vm_value_write_barrier(value);
     arr->elements[index] = value;
+    if (arr_is_container(value)) arr->containers++;
     return 0;
 }
 
 int array_insert(array_t *arr, size_t index, VMValue value) {
-    if (!arr || index > arr->length) return -1;
+    if (!arr || index > arr->length || arr_unshare(arr) != 0) return -1;
     if (arr->length >= arr->capacity) {
         if (array_grow(arr) != 0) return -1;
     }
     for (size_t i = arr->length; i > index; i--) {
         arr->elements[i] = arr->elements[i - 1];
     }
+    vm_value_write_barrier(value);
     arr->elements[index] = value;
     arr->length++;
+    if (arr_is_container(value)) arr->containers++;
     return 0;
 }
 
 int array_delete(array_t *arr, size_t index) {
-    if (!arr || index >= arr->length) return -1;
-    vm_value_free(&arr->elements[index]);
+    if (!arr || index >= arr->length || arr_unshare(arr) != 0) return -1;
+    if (arr_is_container(arr->elements[index])) arr->containers--;
+    vm_value_release(&arr->elements[index]);
     for (size_t i = index; i + 1 < arr->length; i++) {
         arr->elements[i] = arr->elements[i + 1];
     }
@@ -116,25 +236,54 @@ size_t array_length(const array_t *arr) {
     return arr ? arr->length : 0;
 }
 
-array_t* array_clone(const array_t *arr, GC *gc) {
-    if (!arr) return NULL;
-    array_t *copy = array_new(gc ? gc : arr->gc, arr->length);
+/* Deep copy of length elements of arr from start */
+static array_t* arr_copy(array_t *arr, GC *gc, size_t start, size_t length) {
+    array_t *copy = array_new(gc, length);
     if (!copy) return NULL;
-    copy->length = arr->length;
-    for (size_t i = 0; i < arr->length; i++) {
-        copy->elements[i] = vm_value_clone(arr->elements[i]);
+    copy->length = length;
+    for (size_t i = 0; i < length; i++) {
+        copy->elements[i] = vm_value_clone(arr->elements[start + i]);
+        if (arr_is_container(copy->elements[i])) copy->containers++;
     }
     return copy;
 }
 
-void array_free(array_t *arr) {
+array_t* array_clone(array_t *arr, GC *gc) {
+    if (!arr) return NULL;
+    if (!gc) gc = arr->gc;
+
+    /* Flat arrays share storage; a deep copy of nested arrays and
+     * mappings can't wait for a write to this one */
+    if (arr->containers == 0 && gc == arr->gc) {
+        return arr_share(arr, 0, arr->length);
+    }
+    return arr_copy(arr, gc, 0, arr->length);
+}
+
+array_t* array_slice(array_t *arr, size_t start, size_t length) {
+    if (!arr || start > arr->length || length > arr->length - start) return NULL;
+    /* As with clones, only flat arrays are viewed */
+    if (arr->containers == 0) return arr_share(arr, start, length);
+    return arr_copy(arr, arr->gc, start, length);
+}
+
+/* Free arr and its storage, or its share of the storage */
+static void arr_destroy(array_t *arr, int deep) {
     if (!arr) return;
-    if (arr->elements) {
-        for (size_t i = 0; i < arr->length; i++) {
-            vm_value_free(&arr->elements[i]);
-        }
+    if (arr->shared) {
+        arr_drop_shared(arr, deep);
+    } else if (arr->elements) {
+        arr_free_values(arr->elements, 0, arr->length, deep);
         arr_release(arr->gc, arr->elements);
-        arr->elements = NULL;
     }
+    arr->elements = NULL;
     arr_release(arr->gc, arr);
 }
+
+void array_free(array_t *arr) {
+    arr_destroy(arr, 1);
+}
+
+void array_free_shallow(array_t *arr) {
+    arr_destroy(arr, 0);
+}
@@ -5,11 +5,26 @@
 #include "gc.h"
 #include "vm.h"
 
+/*
+ * Clones and slices share their source's element storage until one of
+ * them is written; the write copies the elements it can see into storage
+ * of its own. Once shared, storage is owned by this refcounted record
+ * rather than by any one array, and is freed with its last user.
+ */
+typedef struct array_shared_t {
+    size_t refs;            /* Arrays reading from values */
+    VMValue *values;        /* Owned values, 0..length-1 */
+    size_t length;
+    size_t capacity;
+} array_shared_t;
+
 typedef struct array_t {
     GC *gc;                 /* Owning garbage collector (nullable) */
-    VMValue *elements;      /* Element storage */
+    VMValue *elements;      /* Element storage, or a range of shared->values */
     size_t length;          /* Number of elements */
     size_t capacity;        /* Allocated capacity */
+    array_shared_t *shared; /* Set while storage is shared; NULL if exclusive */
+    size_t containers;      /* At least the number of array and mapping elements */
 } array_t;
 
 array_t* array_new(GC *gc, size_t capacity);
@@ -20,7 +35,20 @@ int array_set(array_t *arr, size_t index, VMValue value);
 int array_insert(array_t *arr, size_t index, VMValue value);
 int array_delete(array_t *arr, size_t index);
 size_t array_length(const array_t *arr);
-array_t* array_clone(const array_t *arr, GC *gc);
+
+/* Deep copy. O(1) when arr holds no arrays or mappings: the copy shares
+ * arr's storage until either is written */
+array_t* array_clone(array_t *arr, GC *gc);
+
+/* Copy of length elements from start, deep like array_clone(): an O(1)
+ * view when arr holds no arrays or mappings. NULL if the range is out of
+ * bounds */
+array_t* array_slice(array_t *arr, size_t start, size_t length);
+
 void array_free(array_t *arr);
 
+/* Free arr and release its strings, leaving nested arrays and mappings
+ * to the collector, which reclaims them independently */
+void array_free_shallow(array_t *arr);
+
 #endif /* ARRAY_H */
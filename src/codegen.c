@@ -185,84 +185,42 @@ int codegen_get_current_address(CodeGenerator *cg) {
     return cg->current_function->instruction_count;
 }
 
+/* Packing only fails on out-of-range operands or allocation failure */
+static int codegen_check_emit(CodeGenerator *cg, int addr) {
+    if (addr < 0) codegen_error(cg, "Failed to emit instruction (operand out of range)");
+    return addr;
+}
+
 int codegen_emit_opcode(CodeGenerator *cg, OpCode opcode) {
     if (!cg || !cg->current_function) return -1;
-    
-    VMFunction *func = cg->current_function;
-    if (func->instruction_count >= func->instruction_capacity) {
-        func->instruction_capacity = func->instruction_capacity * 2 + 1;
-        func->instructions = xrealloc(func->instructions, 
-                                      sizeof(VMInstruction) * func->instruction_capacity);
-    }
-    
-    int addr = func->instruction_count;
-    func->instructions[addr].opcode = opcode;
-    memset(&func->instructions[addr].operand, 0, sizeof(func->instructions[addr].operand));
-    func->instruction_count++;
-    return addr;
+    return codegen_check_emit(cg, vm_function_emit(cg->current_function, opcode, 0));
 }
 
 int codegen_emit_int(CodeGenerator *cg, OpCode opcode, long operand) {
     if (!cg || !cg->current_function) return -1;
     
     VMFunction *func = cg->current_function;
-    if (func->instruction_count >= func->instruction_capacity) {
-        func->instruction_capacity = func->instruction_capacity * 2 + 1;
-        func->instructions = xrealloc(func->instructions, 
-                                      sizeof(VMInstruction) * func->instruction_capacity);
+    if (opcode == OP_PUSH_INT) {
+        return codegen_check_emit(cg, vm_function_emit_int(func, operand));
     }
-    
-    int addr = func->instruction_count;
-    func->instructions[addr].opcode = opcode;
-    func->instructions[addr].operand.int_operand = operand;
-    func->instruction_count++;
-    return addr;
+    return codegen_check_emit(cg, vm_function_emit(func, opcode, operand));
 }
 
 int codegen_emit_float(CodeGenerator *cg, OpCode opcode, double operand) {
     if (!cg || !cg->current_function) return -1;
-    
-    VMFunction *func = cg->current_function;
-    if (func->instruction_count >= func->instruction_capacity) {
-        func->instruction_capacity = func->instruction_capacity * 2 + 1;
-        func->instructions = xrealloc(func->instructions, 
-                                      sizeof(VMInstruction) * func->instruction_capacity);
-    }
-    
-    int addr = func->instruction_count;
-    func->instructions[addr].opcode = opcode;
-    func->instructions[addr].operand.float_operand = operand;
-    func->instruction_count++;
-    return addr;
+    return codegen_check_emit(cg, vm_function_emit_constant(cg->current_function, opcode,
+                                                            vm_value_create_float(operand)));
 }
 
 int codegen_emit_string(CodeGenerator *cg, OpCode opcode, const char *operand) {
     if (!cg || !cg->current_function) return -1;
-    
-    VMFunction *func = cg->current_function;
-    if (func->instruction_count >= func->instruction_capacity) {
-        func->instruction_capacity = func->instruction_capacity * 2 + 1;
-        func->instructions = xrealloc(func->instructions, 
-                                      sizeof(VMInstruction) * func->instruction_capacity);
-    }
-    
-    int addr = func->instruction_count;
-    func->instructions[addr].opcode = opcode;
-    func->instructions[addr].operand.string_operand = xstrdup(operand);
-    func->instruction_count++;
-    return addr;
+    return codegen_check_emit(cg, vm_function_emit_constant(cg->current_function, opcode,
+                                                            vm_value_create_string(operand ? operand : "")));
 }
 
 static int codegen_emit_call(CodeGenerator *cg, const char *name, int arg_count, int target) {
     if (!cg || !cg->current_function) return -1;
-    int addr = codegen_emit_opcode(cg, OP_CALL);
-    if (addr < 0) return -1;
-    cg->current_function->instructions[addr].operand.call_operand.arg_count = arg_count;
-    cg->current_function->instructions[addr].operand.call_operand.target = target;
-    if (name) {
-        cg->current_function->instructions[addr].operand.call_operand.name = xstrdup(name);
-    }
-    return addr;
+    return codegen_check_emit(cg, vm_function_emit_call(cg->current_function, name, arg_count, target));
 }
 
 int codegen_create_label(CodeGenerator *cg, const char *name) {
@@ -290,8 +248,7 @@ int codegen_mark_label(CodeGenerator *cg, int label_index) {
     
     /* Patch all forward references */
     for (int i = 0; i < label->patch_count; i++) {
-        int patch_addr = label->patch_locations[i];
-        cg->current_function->instructions[patch_addr].operand.address_operand = label->address;
+        vm_function_patch_jump(cg->current_function, label->patch_locations[i], label->address);
     }
     label->patch_count = 0;
     return 0;
@@ -317,9 +274,7 @@ int codegen_emit_jump(CodeGenerator *cg, OpCode opcode, int label_index) {
 
 int codegen_patch_address(CodeGenerator *cg, int address, int target) {
     if (!cg || !cg->current_function) return -1;
-    if (address < 0 || address >= cg->current_function->instruction_count) return -1;
-    cg->current_function->instructions[address].operand.address_operand = target;
-    return 0;
+    return vm_function_patch_jump(cg->current_function, address, target);
 }
 
 /* ========== AST Compilation ========== */
@@ -995,13 +950,9 @@ int codegen_compile_function(CodeGenerator *cg, ASTNode *node) {
     FunctionDeclNode *func_decl = (FunctionDeclNode*)node->data;
     
     /* Create function */
-    VMFunction *func = xmalloc(sizeof(VMFunction));
-    func->name = xstrdup(func_decl->name);
-    func->param_count = func_decl->parameter_count;
-    func->local_var_count = func_decl->parameter_count;
-    func->instructions = xmalloc(sizeof(VMInstruction) * 256);
-    func->instruction_count = 0;
-    func->instruction_capacity = 256;
+    VMFunction *func = vm_function_create(func_decl->name, func_decl->parameter_count,
+                                          func_decl->parameter_count);
+    if (!func) return -1;
     
     /* Set as current function for code generation */
     VMFunction *prev_func = cg->current_function;
@@ -1018,9 +969,7 @@ int codegen_compile_function(CodeGenerator *cg, ASTNode *node) {
     /* Compile function body */
     if (codegen_compile_node(cg, func_decl->body) < 0) {
         /* Error compiling function */
-        free(func->name);
-        free(func->instructions);
-        free(func);
+        vm_function_free(func);
         cg->current_function = prev_func;
         cg->in_function = prev_in_func;
         return -1;
@@ -1028,12 +977,13 @@ int codegen_compile_function(CodeGenerator *cg, ASTNode *node) {
     
     /* Ensure function ends with return */
     if (func->instruction_count == 0 || 
-        func->instructions[func->instruction_count - 1].opcode != OP_RETURN) {
+        VM_CODE_OP(func->code[func->instruction_count - 1]) != OP_RETURN) {
         codegen_emit_opcode(cg, OP_PUSH_NULL);
         codegen_emit_opcode(cg, OP_RETURN);
     }
     
     /* Add function to VM */
+    vm_optimize_function(func, cg->vm->opt_level);
     int func_idx = vm_add_function(cg->vm, func);
     
     /* Restore previous function */
@@ -1047,13 +997,8 @@ int codegen_compile(CodeGenerator *cg, ASTNode *ast) {
     if (!cg || !ast) return -1;
     
     /* Create main function for top-level code */
-    VMFunction *main_func = xmalloc(sizeof(VMFunction));
-    main_func->name = xstrdup("main");
-    main_func->param_count = 0;
-    main_func->local_var_count = 0;
-    main_func->instructions = xmalloc(sizeof(VMInstruction) * 1024);
-    main_func->instruction_count = 0;
-    main_func->instruction_capacity = 1024;
+    VMFunction *main_func = vm_function_create("main", 0, 0);
+    if (!main_func) return -1;
     
     cg->current_function = main_func;
     cg->in_function = 1;
@@ -1086,8 +1031,10 @@ int codegen_compile(CodeGenerator *cg, ASTNode *ast) {
     /* Ensure main ends with halt */
     codegen_emit_opcode(cg, OP_HALT);
     
-    /* Load main function's bytecode into VM */
-    vm_load_bytecode(cg->vm, main_func->instructions, main_func->instruction_count);
+    /* Hand main's code to the VM as its top-level code */
+    cg->current_function = NULL;
+    vm_optimize_function(main_func, cg->vm->opt_level);
+    vm_load_toplevel(cg->vm, main_func);
     
     if (cg->error_count > 0) return -1;
     return 0;
@@ -1115,9 +1062,7 @@ void codegen_free(CodeGenerator *cg) {
     free(cg->labels);
     
     if (cg->current_function) {
-        free(cg->current_function->name);
-        free(cg->current_function->instructions);
-        free(cg->current_function);
+        vm_function_free(cg->current_function);
     }
 
     free(cg->break_stack);
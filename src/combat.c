@@ -2,6 +2,7 @@
 #include "skills.h"
 #include "item.h"
 #include "session_internal.h"
+#include "session.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -734,9 +735,15 @@ void combat_award_experience(CombatParticipant *winner, CombatParticipant *loser
 void combat_broadcast(CombatRound *combat, const char *message) {
     if (!combat || !message) return;
     
+    SharedMessage shared;
+    if (shared_message_init(&shared, "%s", message) != 0) return;
+    
     for (CombatParticipant *p = combat->participants; p; p = p->next) {
-        combat_send_to_participant(p, message);
+        if (p->is_player && p->session) {
+            send_shared_message(p->session, &shared);
+        }
     }
+    shared_message_release(&shared);
 }
 
 void combat_send_to_participant(CombatParticipant *p, const char *message) {
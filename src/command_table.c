@@ -0,0 +1,450 @@
+/**
+ * command_table.c - Verb Registry Implementation
+ *
+ * Slots hold pointers to entries, so an entry stays put while the table
+ * grows or other verbs are removed; removal shifts the rest of the probe
+ * run back instead of leaving tombstones. An entry left without any
+ * handler is removed with it, so objects adding and dropping actions do
+ * not leave dead verbs behind for prefix matching to trip over.
+ */
+
+#include "command_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== Entries ========== */
+
+static CommandEntry* cmd_entry_new(const char *verb, unsigned int hash) {
+    CommandEntry *entry = (CommandEntry *)calloc(1, sizeof(CommandEntry));
+    if (!entry) return NULL;
+    entry->verb = strdup(verb);
+    if (!entry->verb) {
+        free(entry);
+        return NULL;
+    }
+    entry->hash = hash;
+    return entry;
+}
+
+static void cmd_action_free(CommandAction *action) {
+    if (action->owner && action->owner->action_count > 0) {
+        action->owner->action_count--;
+    }
+    vm_string_release(action->function);
+    free(action);
+}
+
+static void cmd_entry_free(CommandEntry *entry) {
+    while (entry->actions) {
+        CommandAction *next = entry->actions->next;
+        cmd_action_free(entry->actions);
+        entry->actions = next;
+    }
+    free(entry->path);
+    free(entry->verb);
+    free(entry);
+}
+
+/* An alias is in use while it stands for a verb */
+static int cmd_entry_unused(const CommandEntry *entry) {
+    return !entry->alias_of && !entry->handler && !entry->path && !entry->actions;
+}
+
+/* ========== Slots ========== */
+
+static size_t cmd_slot_of(const CommandTable *table, const char *verb, unsigned int hash) {
+    size_t mask = table->slot_count - 1;
+    size_t i = hash & mask;
+    while (table->slots[i]) {
+        const CommandEntry *entry = table->slots[i];
+        if (entry->hash == hash && strcmp(entry->verb, verb) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int cmd_grow(CommandTable *table) {
+    size_t new_count = table->slot_count * 2;
+    CommandEntry **slots = (CommandEntry **)calloc(new_count, sizeof(CommandEntry *));
+    if (!slots) {
+        fprintf(stderr, "[CommandTable] ERROR: Failed to grow to %zu slots\n", new_count);
+        return -1;
+    }
+    for (size_t i = 0; i < table->slot_count; i++) {
+        CommandEntry *entry = table->slots[i];
+        if (!entry) continue;
+        size_t j = entry->hash & (new_count - 1);
+        while (slots[j]) j = (j + 1) & (new_count - 1);
+        slots[j] = entry;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = new_count;
+    return 0;
+}
+
+/* Entry for verb, created if missing */
+static CommandEntry* cmd_intern(CommandTable *table, const char *verb) {
+    if (!table || !table->slots) return NULL;
+    if (!verb || !verb[0] || strlen(verb) >= COMMAND_VERB_MAX) {
+        fprintf(stderr, "[CommandTable] ERROR: Invalid verb '%s'\n", verb ? verb : "(null)");
+        return NULL;
+    }
+    unsigned int hash = vm_hash_cstring(verb);
+    size_t i = cmd_slot_of(table, verb, hash);
+    if (table->slots[i]) return table->slots[i];
+
+    /* Keep the load at or under one half */
+    if ((table->count + 1) * 2 > table->slot_count) {
+        if (cmd_grow(table) != 0) return NULL;
+        i = cmd_slot_of(table, verb, hash);
+    }
+    CommandEntry *entry = cmd_entry_new(verb, hash);
+    if (!entry) {
+        fprintf(stderr, "[CommandTable] ERROR: Out of memory adding '%s'\n", verb);
+        return NULL;
+    }
+    table->slots[i] = entry;
+    table->count++;
+    return entry;
+}
+
+/* Empty slot i, pulling later entries of its probe run back into it */
+static void cmd_vacate(CommandTable *table, size_t i) {
+    size_t mask = table->slot_count - 1;
+    size_t hole = i;
+    size_t j = i;
+    table->slots[hole] = NULL;
+    for (;;) {
+        j = (j + 1) & mask;
+        CommandEntry *entry = table->slots[j];
+        if (!entry) break;
+        /* Move entry back unless its home lies cyclically in (hole, j] */
+        size_t home = entry->hash & mask;
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            table->slots[hole] = entry;
+            table->slots[j] = NULL;
+            hole = j;
+        }
+    }
+    table->count--;
+}
+
+/* Remove entry; its aliases stop standing for it, and go if that was all they did */
+static void cmd_unlink(CommandTable *table, CommandEntry *entry) {
+    if (entry->flags & COMMAND_ABBREV) table->sorted_stale = 1;
+    cmd_vacate(table, cmd_slot_of(table, entry->verb, entry->hash));
+
+    size_t i = 0;
+    while (i < table->slot_count) {
+        CommandEntry *alias = table->slots[i];
+        if (alias && alias->alias_of == entry) {
+            alias->alias_of = NULL;
+            if (cmd_entry_unused(alias)) {
+                /* An alias once given an action may still be in the prefix index */
+                if (alias->flags & COMMAND_ABBREV) table->sorted_stale = 1;
+                /* Shifting may bring an unvisited entry into slot i */
+                cmd_vacate(table, i);
+                cmd_entry_free(alias);
+                continue;
+            }
+        }
+        i++;
+    }
+    cmd_entry_free(entry);
+}
+
+/* ========== Table ========== */
+
+int command_table_init(CommandTable *table) {
+    if (!table) return -1;
+    memset(table, 0, sizeof(CommandTable));
+    table->slots = (CommandEntry **)calloc(COMMAND_TABLE_INITIAL_SLOTS, sizeof(CommandEntry *));
+    if (!table->slots) {
+        fprintf(stderr, "[CommandTable] ERROR: Failed to allocate slots\n");
+        return -1;
+    }
+    table->slot_count = COMMAND_TABLE_INITIAL_SLOTS;
+    return 0;
+}
+
+void command_table_free(CommandTable *table) {
+    if (!table || !table->slots) return;
+    for (size_t i = 0; i < table->slot_count; i++) {
+        if (table->slots[i]) cmd_entry_free(table->slots[i]);
+    }
+    free(table->slots);
+    free(table->sorted);
+    memset(table, 0, sizeof(CommandTable));
+}
+
+CommandTable* command_table_global(void) {
+    static CommandTable global;
+    static int initialized = 0;
+    if (!initialized) {
+        command_table_init(&global);
+        initialized = 1;
+    }
+    return &global;
+}
+
+/* ========== Registration ========== */
+
+static void cmd_set_flags(CommandTable *table, CommandEntry *entry, int flags) {
+    if ((flags & COMMAND_ABBREV) && !(entry->flags & COMMAND_ABBREV)) {
+        table->sorted_stale = 1;
+    }
+    entry->flags |= flags;
+}
+
+int command_table_add_builtin(CommandTable *table, const char *verb, CommandHandler handler,
+                              int min_privilege, int flags) {
+    if (!handler) return -1;
+    CommandEntry *entry = cmd_intern(table, verb);
+    if (!entry) return -1;
+    entry->alias_of = NULL;
+    entry->handler = handler;
+    entry->min_privilege = min_privilege;
+    cmd_set_flags(table, entry, flags);
+    return 0;
+}
+
+int command_table_add_alias(CommandTable *table, const char *alias, const char *verb) {
+    if (!table || !alias || !verb) return -1;
+    const CommandEntry *found = command_table_find(table, verb);
+    CommandEntry *target = (CommandEntry *)command_table_builtin(found);
+    if (!target) {
+        fprintf(stderr, "[CommandTable] ERROR: Alias '%s' for unknown verb '%s'\n", alias, verb);
+        return -1;
+    }
+    CommandEntry *entry = cmd_intern(table, alias);
+    if (!entry) return -1;
+    if (entry == target) return 0;
+    if (entry->handler) {
+        fprintf(stderr, "[CommandTable] ERROR: Alias '%s' is already a verb\n", alias);
+        return -1;
+    }
+    entry->alias_of = target;
+    return 0;
+}
+
+int command_table_add_path(CommandTable *table, const char *verb, const char *path) {
+    if (!path || !path[0]) return -1;
+    CommandEntry *entry = cmd_intern(table, verb);
+    if (!entry) return -1;
+    char *copy = strdup(path);
+    if (!copy) {
+        if (cmd_entry_unused(entry)) cmd_unlink(table, entry);
+        return -1;
+    }
+    free(entry->path);
+    entry->path = copy;
+    return 0;
+}
+
+int command_table_add_action(CommandTable *table, const char *verb, obj_t *owner,
+                             const char *function, int flags) {
+    if (!owner || !function || !function[0]) return -1;
+    CommandEntry *entry = cmd_intern(table, verb);
+    if (!entry) return -1;
+
+    /* An owner gets one action per verb */
+    CommandAction **link = &entry->actions;
+    while (*link) {
+        if ((*link)->owner == owner) {
+            CommandAction *old = *link;
+            *link = old->next;
+            cmd_action_free(old);
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    CommandAction *action = (CommandAction *)malloc(sizeof(CommandAction));
+    if (!action) {
+        fprintf(stderr, "[CommandTable] ERROR: Out of memory adding action '%s'\n", verb);
+        if (cmd_entry_unused(entry)) cmd_unlink(table, entry);
+        return -1;
+    }
+    action->owner = owner;
+    action->function = vm_string_intern(function);
+    action->next = entry->actions;
+    entry->actions = action;
+    owner->action_count++;
+    cmd_set_flags(table, entry, flags);
+    return 0;
+}
+
+int command_table_remove_path(CommandTable *table, const char *verb) {
+    CommandEntry *entry = (CommandEntry *)command_table_find(table, verb);
+    if (!entry || !entry->path) return -1;
+    free(entry->path);
+    entry->path = NULL;
+    if (cmd_entry_unused(entry)) cmd_unlink(table, entry);
+    return 0;
+}
+
+int command_table_remove(CommandTable *table, const char *verb) {
+    CommandEntry *entry = (CommandEntry *)command_table_find(table, verb);
+    if (!entry) return -1;
+    cmd_unlink(table, entry);
+    return 0;
+}
+
+void command_table_forget_object(CommandTable *table, obj_t *owner) {
+    if (!table || !table->slots || !owner || owner->action_count == 0) return;
+
+    /* Drop the actions first; unlinking moves entries between slots */
+    int emptied = 0;
+    for (size_t i = 0; i < table->slot_count && owner->action_count > 0; i++) {
+        CommandEntry *entry = table->slots[i];
+        if (!entry || !entry->actions) continue;
+        CommandAction **link = &entry->actions;
+        while (*link) {
+            if ((*link)->owner == owner) {
+                CommandAction *old = *link;
+                *link = old->next;
+                cmd_action_free(old);
+            } else {
+                link = &(*link)->next;
+            }
+        }
+        if (cmd_entry_unused(entry)) emptied = 1;
+    }
+
+    while (emptied) {
+        emptied = 0;
+        for (size_t i = 0; i < table->slot_count; i++) {
+            CommandEntry *entry = table->slots[i];
+            if (entry && cmd_entry_unused(entry)) {
+                cmd_unlink(table, entry);
+                emptied = 1;
+                break;
+            }
+        }
+    }
+}
+
+/* ========== Lookup ========== */
+
+const CommandEntry* command_table_find(CommandTable *table, const char *verb) {
+    if (!table || !table->slots || !verb) return NULL;
+    return table->slots[cmd_slot_of(table, verb, vm_hash_cstring(verb))];
+}
+
+const CommandEntry* command_table_builtin(const CommandEntry *entry) {
+    if (!entry) return NULL;
+    if (entry->alias_of) return entry->alias_of;
+    return entry->handler ? entry : NULL;
+}
+
+static int cmd_compare_verbs(const void *a, const void *b) {
+    const CommandEntry *x = *(const CommandEntry * const *)a;
+    const CommandEntry *y = *(const CommandEntry * const *)b;
+    return strcmp(x->verb, y->verb);
+}
+
+static int cmd_rebuild_sorted(CommandTable *table) {
+    size_t n = 0;
+    for (size_t i = 0; i < table->slot_count; i++) {
+        CommandEntry *entry = table->slots[i];
+        if (entry && (entry->flags & COMMAND_ABBREV)) n++;
+    }
+    CommandEntry **sorted = NULL;
+    if (n > 0) {
+        sorted = (CommandEntry **)malloc(n * sizeof(CommandEntry *));
+        if (!sorted) {
+            fprintf(stderr, "[CommandTable] ERROR: Failed to index %zu verbs\n", n);
+            return -1;
+        }
+        n = 0;
+        for (size_t i = 0; i < table->slot_count; i++) {
+            CommandEntry *entry = table->slots[i];
+            if (entry && (entry->flags & COMMAND_ABBREV)) sorted[n++] = entry;
+        }
+        qsort(sorted, n, sizeof(CommandEntry *), cmd_compare_verbs);
+    }
+    free(table->sorted);
+    table->sorted = sorted;
+    table->sorted_count = n;
+    table->sorted_stale = 0;
+    return 0;
+}
+
+const CommandEntry* command_table_match(CommandTable *table, const char *word) {
+    const CommandEntry *entry = command_table_find(table, word);
+    if (entry || !table || !word || !word[0]) return entry;
+
+    if (table->sorted_stale && cmd_rebuild_sorted(table) != 0) return NULL;
+
+    /* First verb not below word; a second match means word is ambiguous */
+    size_t len = strlen(word);
+    size_t lo = 0, hi = table->sorted_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(table->sorted[mid]->verb, word) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo >= table->sorted_count || strncmp(table->sorted[lo]->verb, word, len) != 0) return NULL;
+    if (lo + 1 < table->sorted_count && strncmp(table->sorted[lo + 1]->verb, word, len) == 0) {
+        return NULL;
+    }
+    return table->sorted[lo];
+}
+
+/* Whether player can use the actions of owner */
+static int cmd_in_reach(obj_t *owner, obj_t *player) {
+    if (owner == player) return 1;
+    obj_t *env = player->environment;
+    if (owner->environment == player) return 1;
+    return env && (owner == env || owner->environment == env);
+}
+
+int command_table_run_actions(CommandTable *table, VirtualMachine *vm, const CommandEntry *entry,
+                              obj_t *player, const char *args) {
+    if (!table || !vm || !entry || !player || !entry->actions) return 0;
+
+    /* An action may destruct objects or change the verb's actions, so the
+     * candidates are copied first and each is checked again before its call */
+    char verb[COMMAND_VERB_MAX];
+    snprintf(verb, sizeof(verb), "%s", entry->verb);
+    int n = 0;
+    for (const CommandAction *a = entry->actions; a; a = a->next) n++;
+    obj_t **owners = (obj_t **)malloc((size_t)n * sizeof(obj_t *));
+    if (!owners) return 0;
+    n = 0;
+    for (const CommandAction *a = entry->actions; a; a = a->next) {
+        if (cmd_in_reach(a->owner, player)) owners[n++] = a->owner;
+    }
+
+    int handled = 0;
+    for (int k = 0; k < n && !handled; k++) {
+        const CommandEntry *current = entry;
+        if (k > 0) {
+            current = command_table_find(table, verb);
+            if (!current) break;
+        }
+        const CommandAction *action = current->actions;
+        while (action && action->owner != owners[k]) action = action->next;
+        if (!action || action->owner->is_destroyed || !cmd_in_reach(action->owner, player)) continue;
+
+        VMValue arg = vm_value_create_string(args ? args : "");
+        VMValue result = obj_call_method(vm, action->owner, action->function, &arg, 1);
+        vm_value_release(&arg);
+        handled = (result.type == VALUE_INT && result.data.int_value != 0) ||
+                  (result.type == VALUE_STRING && result.data.string_value);
+        vm_value_release(&result);
+    }
+    free(owners);
+    return handled;
+}
+
+void command_table_set_verb(CommandTable *table, const char *verb) {
+    if (!table) return;
+    snprintf(table->current_verb, sizeof(table->current_verb), "%s", verb ? verb : "");
+}
+
+const char* command_table_verb(const CommandTable *table) {
+    return table ? table->current_verb : "";
+}
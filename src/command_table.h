@@ -0,0 +1,186 @@
+/**
+ * command_table.h - Verb Registry
+ *
+ * One table maps every command verb the driver knows to what handles it:
+ * a C builtin registered by the driver, an LPC command object registered
+ * by the command daemon with register_verb(), and any actions objects
+ * added with add_action(). A command is routed with a single lookup of
+ * its verb instead of a chain of comparisons.
+ *
+ * Verbs live in an open-addressing hash table keyed by the lowercased
+ * verb. An alias ("l" for "look") is an entry of its own that shares its
+ * verb's builtin; command paths and actions stay with the word they were
+ * registered for, as the command daemon maps words, not builtins. Verbs flagged COMMAND_ABBREV can also be chosen by a unique
+ * prefix ("inv"); those are found by binary search over a sorted list of
+ * verbs, rebuilt only after the set of verbs changes, and only when the
+ * exact lookup misses.
+ */
+
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include "vm.h"
+#include "object.h"
+#include <stddef.h>
+
+typedef struct PlayerSession PlayerSession;
+
+/* ========== Constants ========== */
+
+#define COMMAND_TABLE_INITIAL_SLOTS 256     /* Power of two */
+#define COMMAND_VERB_MAX 64                 /* Longest verb, including the NUL */
+
+/* Entry flags */
+#define COMMAND_EARLY   0x01    /* Builtin runs before the player object sees the command */
+#define COMMAND_ABBREV  0x02    /* A unique prefix of the verb selects it */
+
+/* ========== Types ========== */
+
+/* C builtin; verb is the entry's own verb, not the alias or prefix typed */
+typedef VMValue (*CommandHandler)(PlayerSession *session, const char *verb, const char *args);
+
+typedef struct CommandAction {
+    obj_t *owner;                   /* Object that called add_action() */
+    char *function;                 /* Interned method name */
+    struct CommandAction *next;     /* Newest first */
+} CommandAction;
+
+typedef struct CommandEntry {
+    char *verb;
+    unsigned int hash;
+    struct CommandEntry *alias_of;  /* Verb whose builtin an alias uses, or NULL */
+    int flags;                      /* Not inherited by aliases */
+
+    /* Handlers, any of which may be missing */
+    CommandHandler handler;         /* C builtin */
+    int min_privilege;              /* Needed for the builtin */
+    char *path;                     /* LPC command object, from register_verb() */
+    CommandAction *actions;         /* From add_action() */
+} CommandEntry;
+
+typedef struct {
+    CommandEntry **slots;           /* Linear probing; NULL is empty */
+    size_t slot_count;
+    size_t count;                   /* Verbs and aliases */
+
+    CommandEntry **sorted;          /* COMMAND_ABBREV entries in verb order */
+    size_t sorted_count;
+    int sorted_stale;               /* Rebuilt by the next prefix lookup */
+
+    char current_verb[COMMAND_VERB_MAX];    /* Verb being run, for query_verb() */
+} CommandTable;
+
+/* ========== Table ========== */
+
+/**
+ * Initialise an empty table
+ *
+ * @return 0 on success, -1 on failure
+ */
+int command_table_init(CommandTable *table);
+
+/**
+ * Free every entry and the table's storage
+ */
+void command_table_free(CommandTable *table);
+
+/**
+ * The driver's table, shared with the efuns
+ */
+CommandTable* command_table_global(void);
+
+/* ========== Registration ========== */
+
+/**
+ * Register a C builtin for verb, replacing any earlier one or alias
+ *
+ * @param flags COMMAND_EARLY and/or COMMAND_ABBREV
+ * @return 0 on success, -1 on failure
+ */
+int command_table_add_builtin(CommandTable *table, const char *verb, CommandHandler handler,
+                              int min_privilege, int flags);
+
+/**
+ * Make alias another name for verb's builtin
+ *
+ * @return 0 on success, -1 if verb has no builtin or alias has its own
+ */
+int command_table_add_alias(CommandTable *table, const char *alias, const char *verb);
+
+/**
+ * Set the LPC command object for verb, replacing any earlier one
+ *
+ * @return 0 on success, -1 on failure
+ */
+int command_table_add_path(CommandTable *table, const char *verb, const char *path);
+
+/**
+ * Add an action: owner's function handles verb
+ * An owner adding the same verb again replaces its earlier action.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int command_table_add_action(CommandTable *table, const char *verb, obj_t *owner,
+                             const char *function, int flags);
+
+/**
+ * Drop the LPC command object for verb, and verb if nothing else handles it
+ *
+ * @return 0 on success, -1 if verb has no command object
+ */
+int command_table_remove_path(CommandTable *table, const char *verb);
+
+/**
+ * Remove verb with all its handlers; its aliases lose the builtin
+ *
+ * @return 0 on success, -1 if not registered
+ */
+int command_table_remove(CommandTable *table, const char *verb);
+
+/**
+ * Drop every action owner added; called when owner is freed
+ */
+void command_table_forget_object(CommandTable *table, obj_t *owner);
+
+/* ========== Lookup ========== */
+
+/**
+ * Entry for verb
+ * verb must already be lowercase.
+ *
+ * @return Entry, or NULL if unknown
+ */
+const CommandEntry* command_table_find(CommandTable *table, const char *verb);
+
+/**
+ * Entry holding the builtin that entry runs: entry itself, or the verb it
+ * is an alias of
+ *
+ * @return Entry, or NULL if entry has no builtin
+ */
+const CommandEntry* command_table_builtin(const CommandEntry *entry);
+
+/**
+ * As command_table_find(), falling back to the COMMAND_ABBREV verb that
+ * word is a prefix of, if there is exactly one
+ */
+const CommandEntry* command_table_match(CommandTable *table, const char *word);
+
+/**
+ * Run the actions for entry that player can reach: its own, its
+ * environment's, and those of objects in either. Each is called with the
+ * arguments as its one string parameter, newest first, until one returns
+ * nonzero.
+ *
+ * @return 1 if an action handled the command, 0 otherwise
+ */
+int command_table_run_actions(CommandTable *table, VirtualMachine *vm, const CommandEntry *entry,
+                              obj_t *player, const char *args);
+
+/**
+ * Record or read the verb of the command being run
+ */
+void command_table_set_verb(CommandTable *table, const char *verb);
+const char* command_table_verb(const CommandTable *table);
+
+#endif /* COMMAND_TABLE_H */
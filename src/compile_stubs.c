@@ -34,3 +34,7 @@ void *get_current_player_object(void) {
 void set_current_session(void *session) {
     (void)session;
 }
+
+int get_current_privilege(void) {
+    return -1;
+}
@@ -1,6 +1,7 @@
 #include "compiler.h"
 #include "lexer.h"
 #include "parser.h"
+#include "debug.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,6 +46,13 @@ typedef struct {
     size_t global_count;
     size_t global_capacity;
     
+    char **inherits;
+    size_t inherit_count;
+    char **externs;             /* Undeclared names, when there are inherits */
+    size_t extern_count;
+    char **locals;              /* Declared in the function being compiled */
+    size_t local_count;
+    
     VMValue *constants;
     size_t constant_count;
     size_t constant_capacity;
@@ -189,6 +197,72 @@ static void compiler_add_global(compiler_state_t *state, const char *name) {
     state->globals[index].value.data.int_value = 0;
 }
 
+/**
+ * Find a global variable's slot, or -1
+ */
+static int compiler_find_global(compiler_state_t *state, const char *name) {
+    for (size_t i = 0; i < state->global_count; i++) {
+        if (strcmp(state->globals[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/**
+ * Slot of a variable declared in an inherited program: the first is
+ * global_count, so the loader can tell them from our own. Locals are
+ * never looked for there.
+ */
+static int compiler_find_extern(compiler_state_t *state, const char *name) {
+    if (state->inherit_count == 0) return -1;
+    for (size_t i = 0; i < state->local_count; i++) {
+        if (strcmp(state->locals[i], name) == 0) return -1;
+    }
+    for (size_t i = 0; i < state->extern_count; i++) {
+        if (strcmp(state->externs[i], name) == 0) return (int)(state->global_count + i);
+    }
+
+    char **externs = realloc(state->externs, sizeof(char *) * (state->extern_count + 1));
+    if (!externs) return -1;
+    state->externs = externs;
+    state->externs[state->extern_count] = strdup(name);
+    return (int)(state->global_count + state->extern_count++);
+}
+
+/**
+ * Remember a local declared in the function being compiled
+ */
+static void compiler_add_local(compiler_state_t *state, const char *name) {
+    char **locals = realloc(state->locals, sizeof(char *) * (state->local_count + 1));
+    if (!locals) return;
+    state->locals = locals;
+    state->locals[state->local_count++] = strdup(name);
+}
+
+static void compiler_clear_locals(compiler_state_t *state) {
+    for (size_t i = 0; i < state->local_count; i++) {
+        free(state->locals[i]);
+    }
+    state->local_count = 0;
+}
+
+/**
+ * Find a parameter of the function being compiled, or -1
+ */
+static int compiler_find_param(compiler_state_t *state, const char *name) {
+    if (state->current_function_idx < 0) return -1;
+    
+    ASTNode *fn_node = state->functions[state->current_function_idx].ast_node;
+    if (!fn_node || !fn_node->data) return -1;
+    
+    FunctionDeclNode *fn = (FunctionDeclNode *)fn_node->data;
+    for (int i = 0; i < fn->parameter_count; i++) {
+        if (fn->parameters[i].name && strcmp(fn->parameters[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /**
  * Add constant to program
  */
@@ -231,6 +305,15 @@ static void compiler_emit(compiler_state_t *state, uint8_t byte, int line) {
     }
 }
 
+/**
+ * Emit an opcode with a 16-bit operand (little-endian)
+ */
+static void compiler_emit_u16(compiler_state_t *state, uint8_t opcode, int operand, int line) {
+    compiler_emit(state, opcode, line);
+    compiler_emit(state, operand & 0xFF, line);
+    compiler_emit(state, (operand >> 8) & 0xFF, line);
+}
+
 /**
  * Forward declarations for recursive bytecode generation
  */
@@ -288,32 +371,17 @@ static void compiler_codegen_expression(compiler_state_t *state, ASTNode *node)
         case NODE_IDENTIFIER: {
             IdentifierNode *id = (IdentifierNode *)node->data;
             if (id && id->name) {
-                // Check if we're in a function and if this identifier is a local/param
-                int local_idx = -1;
-                if (state->current_function_idx >= 0) {
-                    ASTNode *fn_node = state->functions[state->current_function_idx].ast_node;
-                    if (fn_node && fn_node->data) {
-                        FunctionDeclNode *fn = (FunctionDeclNode *)fn_node->data;
-                        // Check parameters
-                        for (int i = 0; i < fn->parameter_count; i++) {
-                            if (fn->parameters[i].name && strcmp(fn->parameters[i].name, id->name) == 0) {
-                                local_idx = i;
-                                break;
-                            }
-                        }
-                    }
-                }
-                
+                int local_idx = compiler_find_param(state, id->name);
                 if (local_idx >= 0) {
-                    // It's a local variable/parameter - use LOAD_LOCAL
-                    compiler_emit(state, OP_LOAD_LOCAL, node->line);
-                    compiler_emit(state, local_idx, node->line);
+                    // It's a parameter - use LOAD_LOCAL
+                    compiler_emit_u16(state, OP_LOAD_LOCAL, local_idx, node->line);
                 } else {
-                    // It's a global variable - use LOAD_GLOBAL
-                    compiler_emit(state, OP_LOAD_GLOBAL, node->line);
-                    // Emit global index (simplified: use first 2 bytes for index)
-                    compiler_emit(state, 0, node->line);
-                    compiler_emit(state, 0, node->line);
+                    // A global variable: its slot in the object's variables,
+                    // ours or an inherited program's. Anything else still
+                    // falls back to slot 0.
+                    int global_idx = compiler_find_global(state, id->name);
+                    if (global_idx < 0) global_idx = compiler_find_extern(state, id->name);
+                    compiler_emit_u16(state, OP_LOAD_GLOBAL, global_idx >= 0 ? global_idx : 0, node->line);
                 }
             }
             break;
@@ -329,11 +397,17 @@ static void compiler_codegen_expression(compiler_state_t *state, ASTNode *node)
                 // Emit call instruction
                 compiler_emit(state, OP_CALL, node->line);
                 compiler_emit(state, call->argument_count & 0xFF, node->line);
-                // Function name length and bytes
-                size_t len = strlen(call->function_name);
+                // Function name length and bytes; ::name calls the
+                // inherited definition and keeps its prefix for the loader
+                const char *prefix = call->is_parent_call ? "::" : "";
+                size_t prefix_len = strlen(prefix);
+                size_t len = prefix_len + strlen(call->function_name);
                 compiler_emit(state, len & 0xFF, node->line);
-                for (size_t i = 0; i < len; i++) {
-                    compiler_emit(state, (unsigned char)call->function_name[i], node->line);
+                for (size_t i = 0; i < prefix_len; i++) {
+                    compiler_emit(state, (unsigned char)prefix[i], node->line);
+                }
+                for (size_t i = prefix_len; i < len; i++) {
+                    compiler_emit(state, (unsigned char)call->function_name[i - prefix_len], node->line);
                 }
             }
             break;
@@ -430,10 +504,27 @@ static void compiler_codegen_expression(compiler_state_t *state, ASTNode *node)
                     } 
                     // Handle simple variable assignment: var = value
                     else if (assign->target->type == NODE_IDENTIFIER) {
-                        // For now, just compile value and pop it (placeholder)
-                        // Full implementation would need symbol table lookup
+                        // Parameters and globals are stored; the assigned
+                        // value stays on the stack as the expression's value
+                        IdentifierNode *id = (IdentifierNode *)assign->target->data;
+                        int local_idx = id && id->name ? compiler_find_param(state, id->name) : -1;
+                        int global_idx = id && id->name && local_idx < 0
+                            ? compiler_find_global(state, id->name) : -1;
+                        if (global_idx < 0 && id && id->name && local_idx < 0) {
+                            global_idx = compiler_find_extern(state, id->name);
+                        }
+                        
                         compiler_codegen_expression(state, assign->value);
-                        compiler_emit(state, OP_POP, node->line);
+                        if (local_idx >= 0) {
+                            compiler_emit(state, OP_DUP, node->line);
+                            compiler_emit_u16(state, OP_STORE_LOCAL, local_idx, node->line);
+                        } else if (global_idx >= 0) {
+                            compiler_emit(state, OP_DUP, node->line);
+                            compiler_emit_u16(state, OP_STORE_GLOBAL, global_idx, node->line);
+                        } else {
+                            // Locals are not allocated yet: evaluate and drop
+                            compiler_emit(state, OP_POP, node->line);
+                        }
                     }
                     // For other targets (member access, etc.), emit placeholder
                     else {
@@ -533,6 +624,14 @@ static void compiler_codegen_statement(compiler_state_t *state, ASTNode *node) {
             break;
         }
 
+        case NODE_VARIABLE_DECL: {
+            // Locals get no storage yet, but must not be taken for
+            // inherited variables of the same name
+            VariableDeclNode *var = (VariableDeclNode *)node->data;
+            if (var && var->name) compiler_add_local(state, var->name);
+            break;
+        }
+
         default:
             // Unhandled statement type - silently skip
             break;
@@ -582,6 +681,7 @@ static compile_error_t compiler_generate_bytecode(compiler_state_t *state,
         
         // Clear current function context
         state->current_function_idx = -1;
+        compiler_clear_locals(state);
     }
 
     // If no bytecode was generated, emit a minimal program (just return)
@@ -606,6 +706,13 @@ static void compiler_extract_metadata(compiler_state_t *state, ASTNode *ast) {
     ProgramNode *prog = (ProgramNode *)ast->data;
     if (!prog) return;
 
+    if (prog->inherit_count > 0) {
+        state->inherits = malloc(sizeof(char *) * prog->inherit_count);
+        for (int i = 0; state->inherits && i < prog->inherit_count; i++) {
+            state->inherits[state->inherit_count++] = strdup(prog->inherits[i]);
+        }
+    }
+
     for (int i = 0; i < prog->declaration_count; i++) {
         ASTNode *decl = prog->declarations[i];
         if (!decl) continue;
@@ -630,8 +737,10 @@ static Program* compiler_compile_internal(const char *source, const char *filena
     if (!source || !filename) {
         return NULL;
     }
-    /* Debug dump: write raw source to temporary file for inspection */
-    {
+    /* Debug dumps: the source and token stream, for inspecting parser
+     * issues. These files are shared by every compile in the process,
+     * so they are written only with AMLP_DEBUG set. */
+    if (AMLP_DEBUG_VERBOSE()) {
         FILE *dbg = fopen("/tmp/amlp_last_loaded_source.lpc", "w");
         if (dbg) {
             fprintf(dbg, "/* source for: %s */\n", filename);
@@ -646,8 +755,7 @@ static Program* compiler_compile_internal(const char *source, const char *filena
     
     // Lexical analysis
     Lexer *lexer = lexer_init_from_string(source);
-    /* Dump token stream for debugging parser issues */
-    if (lexer) {
+    if (lexer && AMLP_DEBUG_VERBOSE()) {
         char tokens_path[256];
         snprintf(tokens_path, sizeof(tokens_path), "/tmp/amlp_tokens_%d.log", (int)getpid());
         FILE *tf = fopen(tokens_path, "a");
@@ -692,8 +800,8 @@ static Program* compiler_compile_internal(const char *source, const char *filena
     // Note: Parser errors are tracked via parser->error_count
     // Phase 7 Iteration 2: Expand parser to collect detailed error info
     if (parser->error_count > 0) {
-        compiler_add_error(state, COMPILE_ERROR_SYNTAX, 1, 0,
-                         "Syntax error in source code");
+        compiler_add_error(state, COMPILE_ERROR_SYNTAX, parser->first_error_line,
+                           parser->first_error_column, parser->first_error);
     }
     
     // Semantic analysis and code generation
@@ -740,6 +848,11 @@ static Program* compiler_compile_internal(const char *source, const char *filena
     }
     prog->global_count = state->global_count;
     
+    prog->inherits = state->inherits;
+    prog->inherit_count = state->inherit_count;
+    prog->externs = state->externs;
+    prog->extern_count = state->extern_count;
+    
     prog->constants = state->constants;
     prog->constant_count = state->constant_count;
     
@@ -771,6 +884,8 @@ static Program* compiler_compile_internal(const char *source, const char *filena
     
     prog->ref_count = 1;
     
+    compiler_clear_locals(state);
+    free(state->locals);
     free(state);
     return prog;
 }
@@ -843,6 +958,15 @@ void program_free(Program *prog) {
         free(prog->globals);
     }
     
+    for (size_t i = 0; i < prog->inherit_count; i++) {
+        free(prog->inherits[i]);
+    }
+    free(prog->inherits);
+    for (size_t i = 0; i < prog->extern_count; i++) {
+        free(prog->externs[i]);
+    }
+    free(prog->externs);
+    
     if (prog->constants) free(prog->constants);
     if (prog->line_map) free(prog->line_map);
     if (prog->error_info.message) free(prog->error_info.message);
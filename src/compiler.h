@@ -43,6 +43,15 @@ typedef struct Program {
     } *globals;
     size_t global_count;
     
+    // Inherited programs, as written: "/std/object"
+    char **inherits;
+    size_t inherit_count;
+    
+    // Variables used but not declared here, to be found in an inherited
+    // program; OP_LOAD/STORE_GLOBAL address them as global_count + index
+    char **externs;
+    size_t extern_count;
+    
     // Constants pool
     VMValue *constants;
     size_t constant_count;
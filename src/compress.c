@@ -0,0 +1,250 @@
+/**
+ * compress.c - Output Compression Implementation
+ */
+
+#include "compress.h"
+#include "websocket.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPRESS_STAGE_INITIAL 4096
+#define COMPRESS_PREFIX 4               /* Length before each staged WebSocket message */
+
+/* What a sync flush ends with; RFC 7692 leaves it off the wire */
+static const uint8_t deflate_tail[4] = { 0x00, 0x00, 0xff, 0xff };
+
+/* ========== Compression ========== */
+
+Compressor* compressor_new(CompressMode mode, int window_bits, int no_context_takeover, size_t limit) {
+    if (window_bits > COMPRESS_WINDOW_BITS) window_bits = COMPRESS_WINDOW_BITS;
+    if (window_bits < 9) window_bits = 9;
+
+    Compressor *comp = calloc(1, sizeof(Compressor));
+    if (!comp) return NULL;
+    comp->mode = mode;
+    comp->no_context_takeover = no_context_takeover;
+    comp->limit = limit ? limit : OUTPUT_QUEUE_LIMIT;
+
+    /* MCCP2 is a zlib stream, permessage-deflate raw deflate */
+    int bits = mode == COMPRESS_MCCP2 ? window_bits : -window_bits;
+    if (deflateInit2(&comp->stream, COMPRESS_LEVEL, Z_DEFLATED, bits, COMPRESS_MEM_LEVEL,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(comp);
+        return NULL;
+    }
+
+    comp->scratch = malloc(COMPRESS_SCRATCH_SIZE);
+    if (!comp->scratch) {
+        compressor_free(comp);
+        return NULL;
+    }
+    comp->scratch_size = COMPRESS_SCRATCH_SIZE;
+    return comp;
+}
+
+void compressor_free(Compressor *comp) {
+    if (!comp) return;
+    deflateEnd(&comp->stream);
+    free(comp->staged);
+    free(comp->scratch);
+    free(comp);
+}
+
+size_t compressor_staged(const Compressor *comp) {
+    return comp ? comp->staged_len - comp->staged_start : 0;
+}
+
+int compressor_stage(Compressor *comp, const void *data, size_t len) {
+    if (!comp) return -1;
+    if (len == 0) return 0;
+
+    size_t need = len + (comp->mode == COMPRESS_WS_DEFLATE ? COMPRESS_PREFIX : 0);
+    if (len > UINT32_MAX || compressor_staged(comp) + need > comp->limit) return -1;
+
+    /* Reclaim what has been compressed before growing */
+    if (comp->staged_len + need > comp->staged_size && comp->staged_start > 0) {
+        memmove(comp->staged, comp->staged + comp->staged_start, compressor_staged(comp));
+        comp->staged_len -= comp->staged_start;
+        comp->staged_start = 0;
+    }
+    if (comp->staged_len + need > comp->staged_size) {
+        size_t size = comp->staged_size ? comp->staged_size : COMPRESS_STAGE_INITIAL;
+        while (size < comp->staged_len + need) size *= 2;
+        uint8_t *staged = realloc(comp->staged, size);
+        if (!staged) return -1;
+        comp->staged = staged;
+        comp->staged_size = size;
+    }
+
+    if (comp->mode == COMPRESS_WS_DEFLATE) {
+        uint32_t prefix = (uint32_t)len;
+        memcpy(comp->staged + comp->staged_len, &prefix, COMPRESS_PREFIX);
+        comp->staged_len += COMPRESS_PREFIX;
+    }
+    memcpy(comp->staged + comp->staged_len, data, len);
+    comp->staged_len += len;
+    return 0;
+}
+
+/* Deflate into the queue a scratch buffer at a time (MCCP2) */
+static int compressor_deflate_stream(Compressor *comp, OutputQueue *out,
+                                     const uint8_t *data, size_t len, int flush) {
+    z_stream *zs = &comp->stream;
+    zs->next_in = (Bytef *)data;
+    zs->avail_in = (uInt)len;
+
+    do {
+        zs->next_out = comp->scratch;
+        zs->avail_out = (uInt)comp->scratch_size;
+        if (deflate(zs, flush) == Z_STREAM_ERROR) return -1;
+
+        size_t produced = comp->scratch_size - zs->avail_out;
+        if (produced > 0 && output_queue_write(out, comp->scratch, produced) != 0) return -1;
+        comp->bytes_out += produced;
+    } while (zs->avail_out == 0);
+    return 0;
+}
+
+/* Deflate one WebSocket message into scratch; returns the payload length */
+static long compressor_deflate_message(Compressor *comp, const uint8_t *data, size_t len) {
+    z_stream *zs = &comp->stream;
+    zs->next_in = (Bytef *)data;
+    zs->avail_in = (uInt)len;
+
+    size_t produced = 0;
+    for (;;) {
+        zs->next_out = comp->scratch + produced;
+        zs->avail_out = (uInt)(comp->scratch_size - produced);
+        if (deflate(zs, Z_SYNC_FLUSH) == Z_STREAM_ERROR) return -1;
+        produced = comp->scratch_size - zs->avail_out;
+        if (zs->avail_out != 0) break;
+
+        uint8_t *scratch = realloc(comp->scratch, comp->scratch_size * 2);
+        if (!scratch) return -1;
+        comp->scratch = scratch;
+        comp->scratch_size *= 2;
+    }
+
+    if (produced < sizeof(deflate_tail) ||
+        memcmp(comp->scratch + produced - sizeof(deflate_tail), deflate_tail, sizeof(deflate_tail)) != 0) {
+        return -1;
+    }
+    if (comp->no_context_takeover) deflateReset(zs);
+    return (long)(produced - sizeof(deflate_tail));
+}
+
+/* Frame one WebSocket message, compressed unless it is too short to gain */
+static int compressor_send_message(Compressor *comp, OutputQueue *out, const uint8_t *text, size_t len) {
+    uint8_t header[WS_MAX_HEADER_SIZE];
+    const uint8_t *payload = text;
+    size_t payload_len = len;
+    int compressed = len >= COMPRESS_MIN_MESSAGE;
+
+    if (compressed) {
+        long deflated = compressor_deflate_message(comp, text, len);
+        if (deflated < 0) return -1;
+        payload = comp->scratch;
+        payload_len = (size_t)deflated;
+    }
+
+    size_t header_len = ws_frame_header(header, WS_OPCODE_TEXT, compressed, payload_len);
+    if (output_queue_write(out, header, header_len) != 0 ||
+        (payload_len > 0 && output_queue_write(out, payload, payload_len) != 0)) {
+        return -1;
+    }
+    comp->bytes_out += header_len + payload_len;
+    return 0;
+}
+
+int compressor_run(Compressor *comp, OutputQueue *out, size_t budget) {
+    if (!comp || !out) return -1;
+
+    if (comp->mode == COMPRESS_MCCP2) {
+        size_t len = compressor_staged(comp);
+        if (budget > 0 && len > budget) len = budget;
+        if (len > 0) {
+            if (compressor_deflate_stream(comp, out, comp->staged + comp->staged_start, len,
+                                          Z_SYNC_FLUSH) != 0) {
+                return -1;
+            }
+            comp->staged_start += len;
+            comp->bytes_in += len;
+        }
+    } else {
+        size_t taken = 0;
+        while (compressor_staged(comp) > 0 && (budget == 0 || taken < budget)) {
+            uint32_t len;
+            memcpy(&len, comp->staged + comp->staged_start, COMPRESS_PREFIX);
+            const uint8_t *text = comp->staged + comp->staged_start + COMPRESS_PREFIX;
+            if (compressor_send_message(comp, out, text, len) != 0) return -1;
+
+            comp->staged_start += COMPRESS_PREFIX + len;
+            comp->bytes_in += len;
+            taken += COMPRESS_PREFIX + len;
+        }
+    }
+
+    if (comp->staged_start == comp->staged_len) {
+        comp->staged_start = 0;
+        comp->staged_len = 0;
+    }
+    return compressor_staged(comp) > 0 ? 1 : 0;
+}
+
+int compressor_finish(Compressor *comp, OutputQueue *out) {
+    if (compressor_run(comp, out, 0) != 0) return -1;
+    if (comp->mode != COMPRESS_MCCP2) return 0;
+    return compressor_deflate_stream(comp, out, NULL, 0, Z_FINISH);
+}
+
+/* ========== Decompression ========== */
+
+Decompressor* decompressor_new(size_t max_size) {
+    Decompressor *decomp = calloc(1, sizeof(Decompressor));
+    if (!decomp) return NULL;
+
+    /* Clients may use any window up to 32 KB */
+    decomp->out = malloc(max_size + 1);
+    if (!decomp->out || inflateInit2(&decomp->stream, -15) != Z_OK) {
+        free(decomp->out);
+        free(decomp);
+        return NULL;
+    }
+    decomp->max_size = max_size;
+    return decomp;
+}
+
+void decompressor_free(Decompressor *decomp) {
+    if (!decomp) return;
+    inflateEnd(&decomp->stream);
+    free(decomp->out);
+    free(decomp);
+}
+
+long decompressor_message(Decompressor *decomp, const uint8_t *data, size_t len) {
+    if (!decomp || (!data && len > 0)) return -1;
+    z_stream *zs = &decomp->stream;
+
+    /* One byte of room past max_size tells an over-long message */
+    zs->next_out = decomp->out;
+    zs->avail_out = (uInt)(decomp->max_size + 1);
+
+    const uint8_t *inputs[2] = { data, deflate_tail };
+    size_t lengths[2] = { len, sizeof(deflate_tail) };
+    for (int i = 0; i < 2; i++) {
+        zs->next_in = (Bytef *)inputs[i];
+        zs->avail_in = (uInt)lengths[i];
+        int rc = inflate(zs, Z_SYNC_FLUSH);
+        if (rc == Z_STREAM_END) {
+            /* A final block: the next message starts a new stream */
+            inflateReset(zs);
+            break;
+        }
+        if ((rc != Z_OK && rc != Z_BUF_ERROR) || zs->avail_in != 0) return -1;
+    }
+
+    size_t produced = decomp->max_size + 1 - zs->avail_out;
+    if (produced > decomp->max_size) return -1;
+    decomp->out[produced] = '\0';
+    return (long)produced;
+}
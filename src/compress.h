@@ -0,0 +1,140 @@
+/**
+ * compress.h - Output Compression for Telnet and WebSocket Sessions
+ *
+ * Room descriptions, score sheets and menus repeat themselves, so a
+ * connection's output compresses several-fold once the compressor keeps
+ * its window from one message to the next. Two wire formats are spoken:
+ *
+ *   MCCP2 (telnet option 86): after IAC SB 86 IAC SE everything the
+ *   server sends is one zlib stream, sync-flushed at the end of a pass.
+ *
+ *   permessage-deflate (RFC 7692): each text message is raw deflate,
+ *   sync-flushed with the trailing 00 00 ff ff dropped, in a frame with
+ *   RSV1 set. The window carries over between messages unless the
+ *   client asked for server_no_context_takeover.
+ *
+ * Output is staged uncompressed as it is produced and compressed when
+ * the driver flushes, a budget of staged bytes at a time, so the cost of
+ * one busy connection is spread over passes instead of stalling the
+ * loop. Compressed bytes go onto the connection's OutputQueue.
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "output_queue.h"
+#include <stdint.h>
+#include <zlib.h>
+
+/* ========== Constants ========== */
+
+#define COMPRESS_LEVEL 6                /* zlib level */
+#define COMPRESS_WINDOW_BITS 13         /* 8 KB window: a few screens of text */
+#define COMPRESS_MEM_LEVEL 6            /* With the window, about 64 KB per stream */
+#define COMPRESS_MIN_MESSAGE 16         /* Shorter WebSocket messages are sent as they are */
+#define COMPRESS_SCRATCH_SIZE 16384     /* Compressed bytes gathered per queue write */
+
+/* ========== Types ========== */
+
+typedef enum {
+    COMPRESS_MCCP2,                 /* One zlib stream */
+    COMPRESS_WS_DEFLATE             /* Raw deflate per WebSocket text message */
+} CompressMode;
+
+typedef struct {
+    CompressMode mode;
+    z_stream stream;
+    int no_context_takeover;        /* Fresh window for every message */
+
+    uint8_t *staged;                /* Uncompressed output; length-prefixed messages for WebSocket */
+    size_t staged_start;            /* First byte not yet compressed */
+    size_t staged_len;
+    size_t staged_size;
+    size_t limit;                   /* Most staged bytes allowed */
+
+    uint8_t *scratch;               /* Compressed bytes on their way to the queue */
+    size_t scratch_size;
+
+    /* Lifetime counters */
+    unsigned long long bytes_in;    /* Uncompressed bytes compressed */
+    unsigned long long bytes_out;   /* Bytes queued for them, frame headers included */
+} Compressor;
+
+typedef struct {
+    z_stream stream;
+    uint8_t *out;                   /* Last inflated message, NUL-terminated */
+    size_t max_size;
+} Decompressor;
+
+/* ========== Compression ========== */
+
+/**
+ * Start a compressed stream
+ *
+ * @param mode Wire format
+ * @param window_bits Window size, 9 to 15 (capped at COMPRESS_WINDOW_BITS)
+ * @param no_context_takeover Forget the window after each WebSocket message
+ * @param limit Most uncompressed bytes staged at once, 0 for OUTPUT_QUEUE_LIMIT
+ * @return Compressor, or NULL on failure
+ */
+Compressor* compressor_new(CompressMode mode, int window_bits, int no_context_takeover, size_t limit);
+
+/**
+ * Free a compressor and anything still staged
+ */
+void compressor_free(Compressor *comp);
+
+/**
+ * Stage output; a WebSocket compressor keeps each call as one message
+ *
+ * @return 0 on success, -1 if the limit would be exceeded or memory ran out
+ */
+int compressor_stage(Compressor *comp, const void *data, size_t len);
+
+/**
+ * Uncompressed bytes staged
+ */
+size_t compressor_staged(const Compressor *comp);
+
+/**
+ * Compress staged output onto a queue
+ * Stops once budget bytes have been taken; WebSocket messages are never
+ * split, so one may take the budget past its end.
+ *
+ * @param comp Compressor
+ * @param out Queue the compressed bytes are written to
+ * @param budget Most staged bytes to compress, or 0 for all of them
+ * @return 0 when nothing is left staged, 1 when output is left for a
+ *         later call, -1 on failure (the queue refused the output)
+ */
+int compressor_run(Compressor *comp, OutputQueue *out, size_t budget);
+
+/**
+ * Compress everything staged and end the stream (MCCP2 being turned
+ * off); the compressor is then only fit to be freed
+ *
+ * @return 0 on success, -1 on failure
+ */
+int compressor_finish(Compressor *comp, OutputQueue *out);
+
+/* ========== Decompression ========== */
+
+/**
+ * Set up to inflate permessage-deflate messages from a client
+ *
+ * @param max_size Longest message accepted, uncompressed
+ * @return Decompressor, or NULL on failure
+ */
+Decompressor* decompressor_new(size_t max_size);
+
+void decompressor_free(Decompressor *decomp);
+
+/**
+ * Inflate one message; the result is in decomp->out until the next call
+ *
+ * @return Length of the message, or -1 if it is corrupt or longer than
+ *         max_size
+ */
+long decompressor_message(Decompressor *decomp, const uint8_t *data, size_t len);
+
+#endif /* COMPRESS_H */
@@ -4,74 +4,36 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "log.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* Debug output control
- * Can be enabled via:
- * 1. Environment variable: export AMLP_DEBUG=1
- * 2. Compile flag: gcc -DAMLP_DEBUG_ENABLED
+ * Levels are read once, by log_init() (see log.h), from:
+ * 1. Environment variable: export AMLP_DEBUG=1 (everything)
+ * 2. Environment variable: export AMLP_LOG=vm=debug,efun=debug
+ * and can be changed while running with the set_log_level() efun.
  */
 
-#define AMLP_DEBUG_VERBOSE() (getenv("AMLP_DEBUG") != NULL)
+#define AMLP_DEBUG_VERBOSE() LOG_ENABLED(LOG_GENERAL, LOG_LEVEL_DEBUG)
 
-/* Debug logging macros - only output if debug enabled */
-#define DEBUG_LOG(fmt, ...) \
-    do { \
-        if (AMLP_DEBUG_VERBOSE()) { \
-            fprintf(stderr, "[DEBUG] " fmt "\n", ##__VA_ARGS__); \
-        } \
-    } while(0)
+/* Debug logging macros - arguments are only evaluated if enabled */
+#define DEBUG_LOG(fmt, ...)       LOG_AT(LOG_GENERAL, LOG_LEVEL_DEBUG, "[DEBUG]", fmt, ##__VA_ARGS__)
+#define DEBUG_LOG_VM(fmt, ...)    LOG_AT(LOG_VM, LOG_LEVEL_DEBUG, "[VM]", fmt, ##__VA_ARGS__)
+#define DEBUG_LOG_STACK(fmt, ...) LOG_AT(LOG_STACK, LOG_LEVEL_DEBUG, "[STACK]", fmt, ##__VA_ARGS__)
+#define DEBUG_LOG_OBJ(fmt, ...)   LOG_AT(LOG_OBJECT, LOG_LEVEL_DEBUG, "[Object]", fmt, ##__VA_ARGS__)
+#define DEBUG_LOG_PARAM(fmt, ...) LOG_AT(LOG_PARAM, LOG_LEVEL_DEBUG, "[Param]", fmt, ##__VA_ARGS__)
+#define DEBUG_LOG_EFUN(fmt, ...)  LOG_AT(LOG_EFUN, LOG_LEVEL_DEBUG, "[Efun]", fmt, ##__VA_ARGS__)
 
-#define DEBUG_LOG_VM(fmt, ...) \
-    do { \
-        if (AMLP_DEBUG_VERBOSE()) { \
-            fprintf(stderr, "[VM] " fmt "\n", ##__VA_ARGS__); \
-        } \
-    } while(0)
+/* Important errors and warnings - shown unless turned off */
+#define WARN_LOG(fmt, ...)  LOG_AT(LOG_GENERAL, LOG_LEVEL_WARN, "[WARNING]", fmt, ##__VA_ARGS__)
+#define ERROR_LOG(fmt, ...) LOG_AT(LOG_GENERAL, LOG_LEVEL_ERROR, "[ERROR]", fmt, ##__VA_ARGS__)
+#define INFO_LOG(fmt, ...)  LOG_AT(LOG_GENERAL, LOG_LEVEL_INFO, "[INFO]", fmt, ##__VA_ARGS__)
 
-#define DEBUG_LOG_STACK(fmt, ...) \
-    do { \
-        if (AMLP_DEBUG_VERBOSE()) { \
-            fprintf(stderr, "[STACK] " fmt "\n", ##__VA_ARGS__); \
-        } \
-    } while(0)
-
-#define DEBUG_LOG_OBJ(fmt, ...) \
-    do { \
-        if (AMLP_DEBUG_VERBOSE()) { \
-            fprintf(stderr, "[Object] " fmt "\n", ##__VA_ARGS__); \
-        } \
-    } while(0)
-
-#define DEBUG_LOG_PARAM(fmt, ...) \
-    do { \
-        if (AMLP_DEBUG_VERBOSE()) { \
-            fprintf(stderr, "[Param] " fmt "\n", ##__VA_ARGS__); \
-        } \
-    } while(0)
-
-#define DEBUG_LOG_EFUN(fmt, ...) \
-    do { \
-        if (AMLP_DEBUG_VERBOSE()) { \
-            fprintf(stderr, "[Efun] " fmt "\n", ##__VA_ARGS__); \
-        } \
-    } while(0)
-
-/* Important errors and warnings - ALWAYS shown */
-#define WARN_LOG(fmt, ...) \
-    fprintf(stderr, "[WARNING] " fmt "\n", ##__VA_ARGS__)
-
-#define ERROR_LOG(fmt, ...) \
-    fprintf(stderr, "[ERROR] " fmt "\n", ##__VA_ARGS__)
-
-#define FATAL_LOG(fmt, ...) \
-    fprintf(stderr, "[FATAL] " fmt "\n", ##__VA_ARGS__)
-
-#define INFO_LOG(fmt, ...) \
-    fprintf(stderr, "[INFO] " fmt "\n", ##__VA_ARGS__)
+/* Always shown */
+#define FATAL_LOG(fmt, ...) log_write("[FATAL] " fmt, ##__VA_ARGS__)
 
 #ifdef __cplusplus
 }
@@ -3,7 +3,7 @@
  * 
  * Main executable combining:
  * - LPC compiler and Virtual Machine
- * - Multi-client network server using select()
+ * - Multi-client network server on an epoll reactor (see net.c)
  * - Login system with character creation
  * - Session management and privilege system
  * - Command execution pipeline
@@ -27,10 +27,10 @@
 #include <signal.h>
 #include <time.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -50,15 +50,32 @@
 #include "object.h"
 #include "room.h"
 #include "chargen.h"
+#include "net.h"
+#include "timer_wheel.h"
+#include "output_queue.h"
+#include "scheduler.h"
+#include "program_cache.h"
+#include "preload.h"
+#include "command_table.h"
+#include "log.h"
 
-#define MAX_CLIENTS 100
 #define BUFFER_SIZE 4096
 #define INPUT_BUFFER_SIZE 2048
-#define WS_BUFFER_SIZE 65536
 #define DEFAULT_PORT 3000
 #define DEFAULT_WS_PORT 3001
 #define DEFAULT_MASTER_PATH "lib/secure/master.lpc"
 #define SESSION_TIMEOUT 1800  /* 30 minutes */
+#define GC_BUSY_POLL_MS 10      /* Reactor timeout while a collection is unfinished */
+#define IDLE_POLL_MS 1000       /* Reactor timeout otherwise; the idle timer tick */
+#define SESSION_TABLE_INITIAL 64
+#define SESSION_READ_BUDGET (16 * BUFFER_SIZE)  /* Bytes read per wakeup before yielding */
+#define SESSION_OUTPUT_LIMIT (256 * 1024)      /* Backlog before a client is dropped */
+#define COMPRESS_SESSION_BUDGET (64 * 1024)    /* Staged bytes compressed per session per pass */
+#define COMPRESS_PASS_BUDGET (1024 * 1024)     /* ... and for all sessions together */
+#define PLAYER_ROUND_MS 15000   /* One melee round: PPE/ISP recovery and meditation */
+
+/* Messages from the game loop; "server" in AMLP_LOG or set_log_level() */
+#define SERVER_LOG(level, fmt, ...) LOG_AT(LOG_SERVER, level, "[Server]", fmt, ##__VA_ARGS__)
 
 /* Connection types and session state are defined in session_internal.h */
 
@@ -68,7 +85,31 @@
 /* Global state */
 static volatile sig_atomic_t server_running = 1;
 static VirtualMachine *global_vm = NULL;
-static PlayerSession *sessions[MAX_CLIENTS];
+
+/* Live sessions, unordered; session->slot is each one's index */
+static PlayerSession **sessions = NULL;
+static int session_count = 0;
+static int session_capacity = 0;
+
+/* Sessions closed during the current pass, freed once its events are done */
+static PlayerSession *closed_sessions = NULL;
+
+/* Sessions with output queued during the current pass */
+static PlayerSession *dirty_sessions = NULL;
+
+/* Sessions left with staged output when the compression budget ran out,
+ * flushed first next pass. A session on it is freed only after that
+ * flush has dropped it, since reap_closed_sessions() runs after it. */
+static PlayerSession *deferred_sessions = NULL;
+
+typedef struct {
+    int fd;
+    ConnectionType type;
+} Listener;
+
+static NetReactor reactor;
+static Listener listeners[2];
+static TimerWheel idle_timers;
 static int first_player_created = 0;  /* Track if first player has logged in */
 
 typedef struct {
@@ -92,7 +133,7 @@ int test_parse_file(const char *filename);  /* ADD THIS LINE */
 void init_session(PlayerSession *session, int fd, const char *ip, ConnectionType conn_type);
 void free_session(PlayerSession *session);
 void handle_session_input(PlayerSession *session, const char *input);
-void handle_websocket_data(PlayerSession *session, const uint8_t *data, size_t len);
+void handle_websocket_data(PlayerSession *session);
 void process_login_state(PlayerSession *session, const char *input);
 void process_chargen_state(PlayerSession *session, const char *input);
 void process_playing_state(PlayerSession *session, const char *input);
@@ -103,13 +144,13 @@ void broadcast_message(const char *message, PlayerSession *exclude);
 void check_session_timeouts(void);
 void* create_player_object(const char *username, const char *password_hash);
 VMValue call_player_command(void *player_obj, const char *command);
-int setup_ws_listener(int port);
 PlayerSession* find_session_for_player(void *player_obj);
 
 static void command_debug_init(void);
 static void command_debug_set_context(const char *raw, const char *cmd,
                                       const char *args, const char *path);
 static void command_debug_log_result(PlayerSession *session, VMValue result);
+static void register_builtin_commands(void);
 
 /* Filesystem command functions (implemented in server.c) */
 int cmd_ls_filesystem(PlayerSession *session, const char *args);
@@ -230,6 +271,8 @@ void handle_shutdown_signal(int sig) {
 int initialize_vm(const char *master_path) {
     fprintf(stderr, "[Server] Initializing VM...\n");
     
+    register_builtin_commands();
+    
     global_vm = vm_init();
     if (!global_vm) {
         fprintf(stderr, "[Server] ERROR: Failed to initialize VM\n");
@@ -249,6 +292,43 @@ int initialize_vm(const char *master_path) {
     return 0;
 }
 
+/*
+ * Compile the objects in the preload list on all CPUs, then load them.
+ * AMLP_PRELOAD names the list (default <mudlib>/secure/preload.txt; an
+ * empty value skips preloading) and AMLP_PRELOAD_THREADS the workers.
+ */
+static void preload_mudlib(void) {
+    const char *mudlib = getenv("AMLP_MUDLIB");
+    if (!mudlib || !*mudlib) mudlib = "./lib";
+
+    char default_list[PATH_MAX];
+    const char *list_file = getenv("AMLP_PRELOAD");
+    if (!list_file) {
+        snprintf(default_list, sizeof(default_list), "%s/%s", mudlib, PRELOAD_DEFAULT_LIST);
+        list_file = default_list;
+        if (access(list_file, R_OK) != 0) return;
+    }
+    if (!*list_file) return;
+
+    const char *threads_env = getenv("AMLP_PRELOAD_THREADS");
+    int threads = threads_env ? atoi(threads_env) : 0;
+
+    PreloadList list;
+    if (preload_list_init(&list, mudlib) != 0) return;
+    if (preload_list_read(&list, list_file) < 0) {
+        fprintf(stderr, "[Server] ERROR: cannot read preload list %s\n", list_file);
+        preload_list_free(&list);
+        return;
+    }
+
+    preload_compile(&list, threads);
+    preload_link(global_vm, &list);
+    fprintf(stderr, "[Server] Preloaded %d/%d programs: compile %.1f ms on %d threads, load %.1f ms\n",
+            list.loaded, list.count, list.compile_seconds * 1e3, list.threads,
+            list.link_seconds * 1e3);
+    preload_list_free(&list);
+}
+
 /* Cleanup VM resources */
 void cleanup_vm(void) {
     if (global_vm) {
@@ -257,26 +337,27 @@ void cleanup_vm(void) {
         vm_free(global_vm);
         global_vm = NULL;
     }
+    command_table_free(command_table_global());
 }
 
 /* Create player object through VM */
 void* create_player_object(const char *username, const char *password_hash __attribute__((unused))) {
     if (!global_vm) return NULL;
     
-    fprintf(stderr, "[Server] Creating LPC player object for: %s\n", username);
+    SERVER_LOG(LOG_LEVEL_INFO, "Creating LPC player object for: %s", username);
     
     /* Clone full /std/player object */
     VMValue path_value = vm_value_create_string("/std/player");
     VMValue result = efun_clone_object(global_vm, &path_value, 1);
     
     if (result.type != VALUE_OBJECT || !result.data.object_value) {
-        fprintf(stderr, "[Server] ERROR: Failed to clone /std/player for %s\n", username);
+        SERVER_LOG(LOG_LEVEL_ERROR, "ERROR: Failed to clone /std/player for %s", username);
         return NULL;
     }
     
     obj_t *player_obj = (obj_t *)result.data.object_value;
-    fprintf(stderr, "[Server] Player object cloned successfully: %s\n", 
-            player_obj->name ? player_obj->name : "<unnamed>");
+    SERVER_LOG(LOG_LEVEL_DEBUG, "Player object cloned successfully: %s", 
+               player_obj->name ? player_obj->name : "<unnamed>");
     
     /* Call setup_player(username, password_hash) */
     VMValue setup_args[2];
@@ -286,8 +367,8 @@ void* create_player_object(const char *username, const char *password_hash __att
     VMValue setup_result = obj_call_method(global_vm, player_obj, "setup_player", setup_args, 2);
     (void)setup_result;  /* Ignore result */
     
-    fprintf(stderr, "[Server] Player object initialized for %s (methods: %d)\n", 
-            username, player_obj->method_count);
+    SERVER_LOG(LOG_LEVEL_INFO, "Player object initialized for %s (methods: %d)", 
+               username, obj_get_method_count(player_obj));
     
     return (void *)player_obj;
 }
@@ -298,50 +379,50 @@ VMValue call_player_command(void *player_obj, const char *command) {
     result.type = VALUE_NULL;
 
     if (!player_obj || !global_vm || !command) {
-        fprintf(stderr, "[Server] call_player_command: NULL parameter (obj=%p, vm=%p, cmd=%p)\n",
-                player_obj, global_vm, (void*)command);
+        SERVER_LOG(LOG_LEVEL_WARN, "call_player_command: NULL parameter (obj=%p, vm=%p, cmd=%p)",
+                   player_obj, global_vm, (void*)command);
         return result;
     }
 
-    fprintf(stderr, "[Server] Calling player command: '%s' (len=%zu)\n", command, strlen(command));
+    SERVER_LOG(LOG_LEVEL_DEBUG, "Calling player command: '%s' (len=%zu)", command, strlen(command));
 
     // Cast player_obj to obj_t*
     obj_t *obj = (obj_t *)player_obj;
 
     // Prepare argument (command string)
     VMValue cmd_arg = vm_value_create_string(command);
-    fprintf(stderr, "[Server] DEBUG: Created VMValue string: type=%d, ptr=%p, value='%s'\n",
-            cmd_arg.type, (void*)cmd_arg.data.string_value, 
-            cmd_arg.data.string_value ? cmd_arg.data.string_value : "(null)");
+    SERVER_LOG(LOG_LEVEL_DEBUG, "Created VMValue string: type=%d, ptr=%p, value='%s'",
+               cmd_arg.type, (void*)cmd_arg.data.string_value, 
+               cmd_arg.data.string_value ? cmd_arg.data.string_value : "(null)");
 
     /* Debug: check whether object exposes process_command */
     VMFunction *m = obj_get_method(obj, "process_command");
     if (!m) {
-        fprintf(stderr, "[Server] DEBUG: player object '%s' has no process_command()\n",
-                obj->name ? obj->name : "<unnamed>");
+        SERVER_LOG(LOG_LEVEL_DEBUG, "player object '%s' has no process_command()",
+                   obj->name ? obj->name : "<unnamed>");
     } else {
-        fprintf(stderr, "[Server] DEBUG: player object '%s' has process_command (%d params, %d locals)\n",
-                obj->name ? obj->name : "<unnamed>", m->param_count, m->local_var_count);
+        SERVER_LOG(LOG_LEVEL_DEBUG, "player object '%s' has process_command (%d params, %d locals)",
+                   obj->name ? obj->name : "<unnamed>", m->param_count, m->local_var_count);
     }
     
-    fprintf(stderr, "[Server] DEBUG: Before call_method: stack->top=%d\n", 
-            global_vm->stack ? global_vm->stack->top : -1);
+    SERVER_LOG(LOG_LEVEL_DEBUG, "Before call_method: stack->top=%d", 
+               global_vm->stack ? global_vm->stack->top : -1);
 
     // Call process_command on the player object
     result = obj_call_method(global_vm, obj, "process_command", &cmd_arg, 1);
     
-    fprintf(stderr, "[Server] DEBUG: After call_method: stack->top=%d\n", 
-            global_vm->stack ? global_vm->stack->top : -1);
+    SERVER_LOG(LOG_LEVEL_DEBUG, "After call_method: stack->top=%d", 
+               global_vm->stack ? global_vm->stack->top : -1);
 
     /* Debug: log return type */
     if (result.type == VALUE_STRING) {
-        fprintf(stderr, "[Server] DEBUG: process_command returned string: %s\n",
-                result.data.string_value ? result.data.string_value : "(null)");
+        SERVER_LOG(LOG_LEVEL_DEBUG, "process_command returned string: %s",
+                   result.data.string_value ? result.data.string_value : "(null)");
     } else if (result.type == VALUE_INT) {
-        fprintf(stderr, "[Server] DEBUG: process_command returned int: %ld\n",
-                result.data.int_value);
+        SERVER_LOG(LOG_LEVEL_DEBUG, "process_command returned int: %ld",
+                   result.data.int_value);
     } else {
-        fprintf(stderr, "[Server] DEBUG: process_command returned type %d\n", result.type);
+        SERVER_LOG(LOG_LEVEL_DEBUG, "process_command returned type %d", result.type);
     }
 
     /* PHASE 2: Release our reference to the string
@@ -367,7 +448,9 @@ void init_session(PlayerSession *session, int fd, const char *ip, ConnectionType
     session->privilege_level = 0;  /* Default to player */
     strncpy(session->ip_address, ip, INET_ADDRSTRLEN - 1);
     session->input_length = 0;
-    session->ws_buffer_length = 0;
+    ws_parser_init(&session->ws_parser);
+    telnet_init(&session->telnet);
+    output_queue_init(&session->output, SESSION_OUTPUT_LIMIT);
 }
 
 /* Free session resources */
@@ -388,9 +471,9 @@ void free_session(PlayerSession *session) {
                 fprintf(f, "name:%s\n", session->username);
                 fprintf(f, "priv:%d\n", session->privilege_level);
                 fclose(f);
-                fprintf(stderr, "[Server] Wrote minimal savefile: %s\n", path);
+                SERVER_LOG(LOG_LEVEL_INFO, "Wrote minimal savefile: %s", path);
             } else {
-                fprintf(stderr, "[Server] WARNING: failed to write savefile %s\n", path);
+                SERVER_LOG(LOG_LEVEL_WARN, "WARNING: failed to write savefile %s", path);
             }
         }
 
@@ -403,15 +486,342 @@ void free_session(PlayerSession *session) {
         session->fd = -1;
     }
     
+    compressor_free(session->compressor);
+    decompressor_free(session->decompressor);
+    output_queue_free(&session->output);
     free(session);
 }
 
+/* ========== Session Table ========== */
+
+static int session_table_add(PlayerSession *session) {
+    if (session_count == session_capacity) {
+        int capacity = session_capacity ? session_capacity * 2 : SESSION_TABLE_INITIAL;
+        PlayerSession **grown = realloc(sessions, (size_t)capacity * sizeof(PlayerSession *));
+        if (!grown) return -1;
+        sessions = grown;
+        session_capacity = capacity;
+    }
+    
+    session->slot = session_count;
+    sessions[session_count++] = session;
+    return 0;
+}
+
+/* Swap the last session into the hole */
+static void session_table_remove(PlayerSession *session) {
+    int slot = session->slot;
+    if (slot < 0 || slot >= session_count || sessions[slot] != session) return;
+    
+    sessions[slot] = sessions[--session_count];
+    sessions[slot]->slot = slot;
+    session->slot = -1;
+}
+
+/* ========== Session I/O ========== */
+
+static void session_mark_dirty(PlayerSession *session) {
+    if (!session->output_dirty) {
+        session->output_dirty = 1;
+        session->next_dirty = dirty_sessions;
+        dirty_sessions = session;
+    }
+}
+
+static void session_output_overflow(PlayerSession *session) {
+    session->output_overflow = 1;
+    session->state = STATE_DISCONNECTING;
+}
+
+/* Compress up to budget staged bytes (0 for all) onto the queue.
+ * Returns 1 if some are left, 0 if not, -1 once the backlog is full. */
+static int session_compress(PlayerSession *session, size_t budget) {
+    int result = compressor_run(session->compressor, &session->output, budget);
+    if (result < 0) session_output_overflow(session);
+    return result;
+}
+
+/* Queue output; it is sent by flush_dirty_sessions() at the end of the pass.
+ * A client whose backlog passes the limit is disconnected there. Anything
+ * staged for compression goes first, so WebSocket frames keep their order. */
+static void session_write(PlayerSession *session, const void *data, size_t len) {
+    if (!session || session->fd <= 0 || session->slot < 0 || len == 0) return;
+    
+    if (compressor_staged(session->compressor) > 0) session_compress(session, 0);
+    if (output_queue_write(&session->output, data, len) != 0) {
+        session_output_overflow(session);
+    }
+    session_mark_dirty(session);
+}
+
+/* Queue a shared block by reference */
+static void session_append(PlayerSession *session, OutputBlock *block) {
+    if (!session || session->fd <= 0 || session->slot < 0) return;
+    
+    if (output_queue_append(&session->output, block, 0, block->used) != 0) {
+        session_output_overflow(session);
+    }
+    session_mark_dirty(session);
+}
+
+/* Queue game output. With compression on it is staged for the next
+ * flush; otherwise it is queued as it is, in a text frame for WebSocket.
+ * block, if given, holds the same bytes and is queued by reference. */
+static void session_send(PlayerSession *session, const char *text, size_t len, OutputBlock *block) {
+    if (!session || session->fd <= 0 || session->slot < 0 || len == 0) return;
+    
+    if (session->compressor) {
+        if (compressor_stage(session->compressor, text, len) != 0) {
+            session_output_overflow(session);
+        }
+        session_mark_dirty(session);
+        return;
+    }
+    
+    if (session->connection_type == CONN_WEBSOCKET) {
+        uint8_t header[WS_MAX_HEADER_SIZE];
+        session_write(session, header, ws_frame_header(header, WS_OPCODE_TEXT, 0, len));
+    }
+    if (block) {
+        session_append(session, block);
+    } else {
+        session_write(session, text, len);
+    }
+}
+
+/* Send queued output; -1 means the connection is broken */
+static int session_flush(PlayerSession *session) {
+    return output_queue_flush(&session->output, session->fd) < 0 ? -1 : 0;
+}
+
+/* Unregister a session. It is freed by reap_closed_sessions(), so events
+ * for it later in the same batch are skipped rather than dangling. */
+static void close_session(PlayerSession *session, const char *reason) {
+    if (!session || session->slot < 0) return;
+    
+    if (session->compressor) compressor_finish(session->compressor, &session->output);
+    session_flush(session);
+    if (session->output_overflow) reason = "Output backlog full";
+    
+    OutputQueue *out = &session->output;
+    SERVER_LOG(LOG_LEVEL_INFO, "%s: fd %d (%s), output %llu queued, %llu sent, %llu dropped",
+               reason, session->fd, session->username[0] ? session->username : session->ip_address,
+               out->bytes_queued, out->bytes_flushed, out->bytes_dropped);
+    
+    net_reactor_remove(&reactor, session->fd);
+    timer_wheel_remove(&idle_timers, &session->idle_timer);
+    session_table_remove(session);
+    
+    session->next_closed = closed_sessions;
+    closed_sessions = session;
+}
+
+/*
+ * Flush every session written to during this pass, those deferred last
+ * pass first. Compression is bounded per session and per pass, so one
+ * connection flooded with output costs the loop a slice at a time; what
+ * is left over waits for the next pass. Returns 1 if any was left over.
+ */
+static int flush_dirty_sessions(void) {
+    PlayerSession *deferred = deferred_sessions;
+    PlayerSession **deferred_tail = &deferred_sessions;
+    size_t pass_budget = COMPRESS_PASS_BUDGET;
+    deferred_sessions = NULL;
+    
+    while (deferred || dirty_sessions) {
+        PlayerSession *session;
+        if (deferred) {
+            session = deferred;
+            deferred = session->next_dirty;
+        } else {
+            session = dirty_sessions;
+            dirty_sessions = session->next_dirty;
+        }
+        session->output_dirty = 0;
+        if (session->slot < 0) continue;
+        
+        int staged = 0;
+        if (session->compressor && !session->output_overflow && pass_budget > 0) {
+            size_t budget = pass_budget < COMPRESS_SESSION_BUDGET ? pass_budget : COMPRESS_SESSION_BUDGET;
+            unsigned long long before = session->compressor->bytes_in;
+            staged = session_compress(session, budget) > 0;
+            size_t used = (size_t)(session->compressor->bytes_in - before);
+            pass_budget -= used < pass_budget ? used : pass_budget;
+        } else if (session->compressor) {
+            staged = compressor_staged(session->compressor) > 0;
+        }
+        
+        if (session->output_overflow) {
+            close_session(session, "Output backlog full");
+        } else if (session_flush(session) < 0) {
+            close_session(session, "Write failed");
+        } else if (staged) {
+            session->output_dirty = 1;
+            session->next_dirty = NULL;
+            *deferred_tail = session;
+            deferred_tail = &session->next_dirty;
+        }
+    }
+    return deferred_sessions != NULL;
+}
+
+static void reap_closed_sessions(void) {
+    while (closed_sessions) {
+        PlayerSession *session = closed_sessions;
+        closed_sessions = session->next_closed;
+        free_session(session);
+    }
+}
+
+/* Idle timer: a session is only examined when it could have timed out */
+static void session_idle_expired(TimerEntry *timer, void *ctx) {
+    PlayerSession *session = (PlayerSession *)ctx;
+    time_t idle = time(NULL) - session->last_activity;
+    
+    if (idle <= SESSION_TIMEOUT) {
+        timer_wheel_add(&idle_timers, timer,
+                        (unsigned long)(session->last_activity + SESSION_TIMEOUT + 1),
+                        session_idle_expired, session);
+        return;
+    }
+    
+    send_to_player(session, "\r\nYou have been idle too long. Disconnecting...\r\n");
+    close_session(session, "Timeout disconnect");
+}
+
+/* Accept until the backlog is empty */
+static void accept_connections(Listener *listener) {
+    for (;;) {
+        char ip[INET_ADDRSTRLEN];
+        int fd = net_accept(listener->fd, ip, sizeof(ip));
+        
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                /* Out of descriptors: the listener is level-triggered,
+                 * so the backlog is retried on the next pass */
+                SERVER_LOG(LOG_LEVEL_ERROR, "ERROR: accept() failed: %s", strerror(errno));
+            }
+            return;
+        }
+        
+        PlayerSession *session = malloc(sizeof(PlayerSession));
+        if (!session) {
+            close(fd);
+            continue;
+        }
+        init_session(session, fd, ip, listener->type);
+        
+        if (session_table_add(session) != 0 ||
+            net_reactor_add(&reactor, fd, NET_EVENT_READ | NET_EVENT_WRITE | NET_EVENT_EDGE,
+                            session) != 0) {
+            session_table_remove(session);
+            free_session(session);
+            continue;
+        }
+        timer_wheel_add(&idle_timers, &session->idle_timer,
+                        (unsigned long)(session->last_activity + SESSION_TIMEOUT + 1),
+                        session_idle_expired, session);
+        
+        if (listener->type == CONN_WEBSOCKET) {
+            SERVER_LOG(LOG_LEVEL_INFO, "WebSocket connection fd %d from %s (%d online)",
+                       fd, session->ip_address, session_count);
+            /* Don't send prompt yet - wait for handshake */
+        } else {
+            SERVER_LOG(LOG_LEVEL_INFO, "Telnet connection fd %d from %s (%d online)",
+                       fd, session->ip_address, session_count);
+            static const uint8_t offer_compress[] = { TELNET_IAC, TELNET_WILL, TELOPT_COMPRESS2 };
+            session_write(session, offer_compress, sizeof(offer_compress));
+            send_prompt(session);
+        }
+    }
+}
+
+/* Telnet negotiation: MCCP2, offered on connect, is the only option spoken */
+static void session_telnet_option(void *ctx, int verb, int option) {
+    PlayerSession *session = (PlayerSession *)ctx;
+    if (option != TELOPT_COMPRESS2) return;
+    
+    if (verb == TELNET_DO && !session->compressor) {
+        /* Everything after IAC SE is compressed */
+        Compressor *compressor = compressor_new(COMPRESS_MCCP2, COMPRESS_WINDOW_BITS, 0,
+                                                SESSION_OUTPUT_LIMIT);
+        if (!compressor) return;
+        static const uint8_t start[] = { TELNET_IAC, TELNET_SB, TELOPT_COMPRESS2, TELNET_IAC, TELNET_SE };
+        session_write(session, start, sizeof(start));
+        session->compressor = compressor;
+    } else if (verb == TELNET_DONT && session->compressor) {
+        if (compressor_finish(session->compressor, &session->output) != 0) {
+            session_output_overflow(session);
+        }
+        compressor_free(session->compressor);
+        session->compressor = NULL;
+        session_mark_dirty(session);
+    }
+}
+
+/* Read until the socket is drained or the budget is spent */
+static void session_readable(PlayerSession *session) {
+    size_t budget = SESSION_READ_BUDGET;
+    
+    while (session->slot >= 0) {
+        if (budget == 0) {
+            /* Re-arming an edge-triggered socket reports it again if data remains */
+            net_reactor_modify(&reactor, session->fd,
+                               NET_EVENT_READ | NET_EVENT_WRITE | NET_EVENT_EDGE, session);
+            return;
+        }
+        
+        /* WebSocket bytes go straight into the frame parser's buffer */
+        int websocket = session->connection_type == CONN_WEBSOCKET;
+        char buffer[BUFFER_SIZE];
+        void *into = buffer;
+        size_t room = sizeof(buffer) - 1;
+        if (websocket) {
+            into = ws_parser_space(&session->ws_parser, &room);
+            if (!into) {
+                close_session(session, "WebSocket buffer full");
+                return;
+            }
+        }
+        
+        ssize_t bytes = recv(session->fd, into, room, 0);
+        
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            close_session(session, "Disconnect");
+            return;
+        }
+        if (bytes == 0) {
+            close_session(session, "Disconnect");
+            return;
+        }
+        budget = (size_t)bytes < budget ? budget - (size_t)bytes : 0;
+        
+        if (websocket) {
+            ws_parser_commit(&session->ws_parser, (size_t)bytes);
+            handle_websocket_data(session);
+        } else {
+            /* Handle as telnet data, negotiation stripped */
+            size_t len = telnet_filter(&session->telnet, buffer, (size_t)bytes,
+                                       session_telnet_option, session);
+            buffer[len] = '\0';
+            if (len > 0) handle_session_input(session, buffer);
+        }
+        
+        if (session->state == STATE_DISCONNECTING) {
+            close_session(session, "Closing");
+        }
+    }
+}
+
 /* Send formatted output to player */
 /* Find the session associated with a player object */
 PlayerSession* find_session_for_player(void *player_obj) {
     if (!player_obj) return NULL;
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
+    for (int i = 0; i < session_count; i++) {
         if (sessions[i] && sessions[i]->player_object == player_obj) {
             return sessions[i];
         }
@@ -430,51 +840,134 @@ void send_message_to_player_session(void *player_obj, const char *message) {
     }
 }
 
+/* WebSocket output text: ANSI converted for web display and line
+ * endings normalized. Caller frees. */
+static char *websocket_text(const char *text, size_t *len) {
+    char *web_text = ws_convert_ansi(text, 1);
+    if (!web_text) return NULL;
+    
+    char *normalized = ws_normalize_line_endings(web_text);
+    free(web_text);
+    if (normalized) *len = strlen(normalized);
+    return normalized;
+}
+
+/* Telnet wants CRLF: a trailing bare LF becomes CRLF. buffer needs a
+ * spare byte past len. Returns the new length. */
+static size_t telnet_fix_line_ending(char *buffer, size_t len) {
+    if (len > 0 && buffer[len-1] == '\n' && (len < 2 || buffer[len-2] != '\r')) {
+        buffer[len-1] = '\r';
+        buffer[len] = '\n';
+        len++;
+    }
+    return len;
+}
+
 void send_to_player(PlayerSession *session, const char *format, ...) {
     if (!session || session->fd <= 0) return;
     
-    char buffer[BUFFER_SIZE];
-    va_list args;
+    /* Room for CRLF conversion; longer output is formatted on the heap */
+    char stack_buffer[BUFFER_SIZE];
+    char *buffer = stack_buffer;
+    va_list args, retry;
     va_start(args, format);
-    int len = vsnprintf(buffer, sizeof(buffer) - 3, format, args);
+    va_copy(retry, args);
+    int len = vsnprintf(buffer, sizeof(stack_buffer) - 3, format, args);
     va_end(args);
     
-    if (len > 0 && len < BUFFER_SIZE - 3) {
+    if (len >= (int)sizeof(stack_buffer) - 3) {
+        buffer = malloc((size_t)len + 3);
+        if (buffer) {
+            vsnprintf(buffer, (size_t)len + 1, format, retry);
+        }
+    }
+    va_end(retry);
+    
+    if (buffer && len > 0) {
         if (session->connection_type == CONN_WEBSOCKET) {
             /* WebSocket: send as text frame */
             if (session->ws_state == WS_STATE_OPEN) {
-                /* Convert ANSI codes for web display */
-                char *web_text = ws_convert_ansi(buffer, 1);
+                size_t web_len;
+                char *web_text = websocket_text(buffer, &web_len);
                 if (web_text) {
-                    /* Normalize line endings for web */
-                    char *normalized = ws_normalize_line_endings(web_text);
+                    session_send(session, web_text, web_len, NULL);
                     free(web_text);
-                    
-                    if (normalized) {
-                        size_t frame_len;
-                        uint8_t *frame = ws_encode_text(normalized, &frame_len);
-                        free(normalized);
-                        
-                        if (frame) {
-                            send(session->fd, frame, frame_len, 0);
-                            free(frame);
-                        }
-                    }
                 }
             }
         } else {
-            /* Telnet: ensure CRLF line endings */
-            if (buffer[len-1] == '\n' && (len < 2 || buffer[len-2] != '\r')) {
-                buffer[len-1] = '\r';
-                buffer[len] = '\n';
-                buffer[len+1] = '\0';
-                len++;
+            session_send(session, buffer, telnet_fix_line_ending(buffer, (size_t)len), NULL);
+        }
+    }
+    
+    if (buffer != stack_buffer) {
+        free(buffer);
+    }
+}
+
+int shared_message_init(SharedMessage *msg, const char *format, ...) {
+    memset(msg, 0, sizeof(*msg));
+    
+    va_list args, retry;
+    va_start(args, format);
+    va_copy(retry, args);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    
+    if (len >= 0) {
+        msg->text = malloc((size_t)len + 1);
+        if (msg->text) {
+            vsnprintf(msg->text, (size_t)len + 1, format, retry);
+        }
+    }
+    va_end(retry);
+    
+    return msg->text ? 0 : -1;
+}
+
+void send_shared_message(PlayerSession *session, SharedMessage *msg) {
+    if (!session || session->fd <= 0 || !msg || !msg->text || !msg->text[0]) return;
+    
+    OutputBlock *block;
+    if (session->connection_type == CONN_WEBSOCKET) {
+        if (session->ws_state != WS_STATE_OPEN) return;
+        
+        if (!msg->websocket) {
+            size_t web_len;
+            char *web_text = websocket_text(msg->text, &web_len);
+            if (!web_text) return;
+            msg->websocket = output_block_new(web_len);
+            if (msg->websocket) {
+                memcpy(msg->websocket->data, web_text, web_len);
+                msg->websocket->used = web_len;
+            }
+            free(web_text);
+        }
+        block = msg->websocket;
+    } else {
+        if (!msg->telnet) {
+            size_t len = strlen(msg->text);
+            msg->telnet = output_block_new(len + 1);
+            if (msg->telnet) {
+                memcpy(msg->telnet->data, msg->text, len);
+                msg->telnet->used = telnet_fix_line_ending(msg->telnet->data, len);
             }
-            send(session->fd, buffer, len, 0);
         }
+        block = msg->telnet;
+    }
+    
+    if (block) {
+        session_send(session, block->data, block->used, block);
     }
 }
 
+void shared_message_release(SharedMessage *msg) {
+    if (!msg) return;
+    free(msg->text);
+    output_block_release(msg->telnet);
+    output_block_release(msg->websocket);
+    memset(msg, 0, sizeof(*msg));
+}
+
 /* Send command prompt based on state */
 void send_prompt(PlayerSession *session) {
     switch (session->state) {
@@ -525,7 +1018,7 @@ void send_prompt(PlayerSession *session) {
 static PlayerSession* find_player_by_name(const char *name) {
     if (!name || !*name) return NULL;
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
+    for (int i = 0; i < session_count; i++) {
         if (sessions[i] && 
             sessions[i]->state == STATE_PLAYING && 
             sessions[i]->username && 
@@ -579,15 +1072,17 @@ static int cmd_chat(PlayerSession *session, const char *arg) {
     }
     
     /* Broadcast to all players */
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (sessions[i] && sessions[i]->state == STATE_PLAYING) {
-            if (sessions[i] == session) {
-                send_to_player(sessions[i], "[CHAT: %s] %s\n", session->username, arg);
-            } else {
-                send_to_player(sessions[i], "\n[CHAT: %s] %s\n", session->username, arg);
-            }
+    SharedMessage shared;
+    if (shared_message_init(&shared, "\n[CHAT: %s] %s\n", session->username, arg) != 0) {
+        return 1;
+    }
+    for (int i = 0; i < session_count; i++) {
+        if (sessions[i] != session && sessions[i]->state == STATE_PLAYING) {
+            send_shared_message(sessions[i], &shared);
         }
     }
+    shared_message_release(&shared);
+    send_to_player(session, "[CHAT: %s] %s\n", session->username, arg);
     
     return 1;
 }
@@ -636,11 +1131,15 @@ static int cmd_whisper(PlayerSession *session, const char *arg) {
     send_to_player(session, "You whisper to %s: %s\n", target->username, message);
     
     /* Let others know something was whispered (but not what) */
-    for (int i = 0; i < room->num_players; i++) {
-        if (room->players[i] && room->players[i] != session && room->players[i] != target) {
-            send_to_player(room->players[i], "%s whispers something to %s.\n",
-                          session->username, target->username);
+    SharedMessage shared;
+    if (shared_message_init(&shared, "%s whispers something to %s.\n",
+                            session->username, target->username) == 0) {
+        for (int i = 0; i < room->num_players; i++) {
+            if (room->players[i] && room->players[i] != session && room->players[i] != target) {
+                send_shared_message(room->players[i], &shared);
+            }
         }
+        shared_message_release(&shared);
     }
     
     return 1;
@@ -661,10 +1160,14 @@ static int cmd_shout(PlayerSession *session, const char *arg) {
     Room *room = session->current_room;
     
     /* Shout in current room */
-    for (int i = 0; i < room->num_players; i++) {
-        if (room->players[i] && room->players[i] != session) {
-            send_to_player(room->players[i], "%s shouts: %s\n", session->username, arg);
+    SharedMessage shared;
+    if (shared_message_init(&shared, "%s shouts: %s\n", session->username, arg) == 0) {
+        for (int i = 0; i < room->num_players; i++) {
+            if (room->players[i] && room->players[i] != session) {
+                send_shared_message(room->players[i], &shared);
+            }
         }
+        shared_message_release(&shared);
     }
     send_to_player(session, "You shout: %s\n", arg);
     
@@ -782,669 +1285,560 @@ static int cmd_give_item(PlayerSession *session, const char *arg) {
 }
 
 /* Execute command through VM */
-VMValue execute_command(PlayerSession *session, const char *command) {
+/* ========== Builtin Commands ==========
+ * Each handler gets the verb it was registered under and the arguments
+ * ("" if none). A string result is sent to the player; NULL means the
+ * handler already wrote its own output. */
+
+static VMValue command_reply(const char *text) {
+    VMValue result;
+    result.type = VALUE_STRING;
+    result.data.string_value = strdup(text);
+    return result;
+}
+
+static VMValue command_done(void) {
     VMValue result;
     result.type = VALUE_NULL;
-    
-    if (!global_vm || !session) {
-        return result;
-    }
-    
-    /* Parse command early for filesystem checks */
-    char cmd_buffer[256];
-    strncpy(cmd_buffer, command, sizeof(cmd_buffer) - 1);
-    cmd_buffer[sizeof(cmd_buffer) - 1] = '\0';
-    
-    /* Convert to lowercase for comparison */
-    char *cmd = cmd_buffer;
-    for (int i = 0; cmd[i]; i++) {
-        cmd[i] = tolower(cmd[i]);
+    return result;
+}
+
+static VMValue builtin_ls(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    cmd_ls_filesystem(session, args);
+    return command_reply("");
+}
+
+static VMValue builtin_cd(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    cmd_cd_filesystem(session, args);
+    return command_reply("");
+}
+
+static VMValue builtin_pwd(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb; (void)args;
+    cmd_pwd_filesystem(session);
+    return command_reply("");
+}
+
+static VMValue builtin_cat(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    cmd_cat_filesystem(session, args);
+    return command_reply("");
+}
+
+/* Registered under each direction's name */
+static VMValue builtin_move(PlayerSession *session, const char *verb, const char *args) {
+    (void)args;
+    cmd_move(session, verb);
+    return command_done();
+}
+
+static VMValue builtin_quit(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb; (void)args;
+    /* Auto-save before quitting */
+    send_to_player(session, "\r\nSaving your character...\r\n");
+    if (save_character(session)) {
+        send_to_player(session, " Character saved.\r\n");
+    } else {
+        send_to_player(session, " Warning: Failed to save character.\r\n");
     }
-    
-    /* Parse command and arguments */
-    char *args = strchr(cmd, ' ');
-    if (args) {
-        *args = '\0';
-        args++;
-        while (*args == ' ') args++;
+    return command_reply("quit");
+}
+
+static VMValue builtin_save(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb; (void)args;
+    if (save_character(session)) {
+        send_to_player(session, " Character saved successfully.\r\n");
+    } else {
+        send_to_player(session, " Failed to save character.\r\n");
     }
+    return command_done();
+}
 
-    command_debug_set_context(command, cmd, args ? args : "", "builtin");
+static VMValue builtin_help(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb; (void)args;
+    char help_text[2048];
+    strcpy(help_text, 
+        "Available commands:\r\n"
+        "  help                 - Show this help\r\n"
+        "  look / l             - Look at your surroundings\r\n"
+        "  inventory / i        - Check your inventory\r\n"
+        "  say <message>        - Say something\r\n"
+        "  emote <action>       - Perform an emote\r\n"
+        "  who                  - List players online\r\n"
+        "  stats                - Show your character stats\r\n"
+        "  save                 - Save your character\r\n"
+        "  quit / logout        - Save and disconnect\r\n"
+        "\r\nMovement: north, south, east, west, up, down (or n, s, e, w, u, d)\r\n");
     
-    /* Filesystem commands for wizards/admins - CHECK FIRST BEFORE PLAYER OBJECT */
     if (session->privilege_level >= 1) {
-        if (strcmp(cmd, "ls") == 0 || strcmp(cmd, "dir") == 0) {
-            command_debug_set_context(command, cmd, args ? args : "", "filesystem");
-            cmd_ls_filesystem(session, args);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("");
-            return result;
-        }
-        
-        if (strcmp(cmd, "cd") == 0) {
-            command_debug_set_context(command, cmd, args ? args : "", "filesystem");
-            cmd_cd_filesystem(session, args);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("");
-            return result;
-        }
-        
-        if (strcmp(cmd, "pwd") == 0) {
-            command_debug_set_context(command, cmd, args ? args : "", "filesystem");
-            cmd_pwd_filesystem(session);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("");
-            return result;
-        }
-        
-        if (strcmp(cmd, "cat") == 0 || strcmp(cmd, "more") == 0) {
-            command_debug_set_context(command, cmd, args ? args : "", "filesystem");
-            cmd_cat_filesystem(session, args);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("");
-            return result;
-        }
+        strcat(help_text,
+            "\r\nWIZARD COMMANDS (Level 1+):\r\n"
+            "  goto <room>         - Teleport to a room\r\n"
+            "  clone <object>      - Clone an object\r\n");
     }
     
-    /* If player object exists, route command through it. Set the
-     * current VM session so efuns like this_player() can access it. */
-    if (session->player_object) {
-        command_debug_set_context(command, cmd, args ? args : "", "vm");
-        set_current_session(session);
-        result = call_player_command(session->player_object, command);
-        set_current_session(NULL);
+    if (session->privilege_level >= 2) {
+        strcat(help_text,
+            "\r\nADMIN COMMANDS (Level 2):\r\n"
+            "  promote <player> <level> - Promote player (0=player, 1=wizard, 2=admin)\r\n"
+            "  users                     - Show detailed user list\r\n"
+            "  sched                     - Show heartbeat/call_out scheduler stats\r\n"
+            "  shutdown [delay]          - Shutdown server (optional delay in seconds)\r\n");
+    }
+    
+    return command_reply(help_text);
+}
 
-        /* If VM returns valid result, use it */
-        if (result.type == VALUE_STRING && result.data.string_value) {
-            return result;
-        }
+/* Game commands taking (session, args) and writing their own output */
+#define GAME_COMMAND(name, fn) \
+    static VMValue builtin_##name(PlayerSession *session, const char *verb, const char *args) { \
+        (void)verb; \
+        fn(session, args); \
+        return command_done(); \
+    }
+
+GAME_COMMAND(look, cmd_look)
+GAME_COMMAND(stats, cmd_stats)
+GAME_COMMAND(skills, cmd_skills)
+GAME_COMMAND(attack, cmd_attack)
+GAME_COMMAND(strike, cmd_strike)
+GAME_COMMAND(shoot, cmd_shoot)
+GAME_COMMAND(dodge, cmd_dodge)
+GAME_COMMAND(flee, cmd_flee)
+GAME_COMMAND(inventory, cmd_inventory)
+GAME_COMMAND(equip, cmd_equip)
+GAME_COMMAND(unequip, cmd_unequip)
+GAME_COMMAND(worn, cmd_worn)
+GAME_COMMAND(get, cmd_get)
+GAME_COMMAND(drop, cmd_drop)
+GAME_COMMAND(use, cmd_use_power)
+GAME_COMMAND(powers, cmd_powers)
+GAME_COMMAND(isp, cmd_isp)
+GAME_COMMAND(cast, cmd_cast)
+GAME_COMMAND(spells, cmd_spells)
+GAME_COMMAND(ppe, cmd_ppe)
+GAME_COMMAND(meditate, cmd_meditate)
+GAME_COMMAND(tell, cmd_tell)
+GAME_COMMAND(chat, cmd_chat)
+GAME_COMMAND(whisper, cmd_whisper)
+GAME_COMMAND(shout, cmd_shout)
+GAME_COMMAND(exits, cmd_exits)
+GAME_COMMAND(examine, cmd_examine)
+GAME_COMMAND(give, cmd_give_item)
+
+#undef GAME_COMMAND
+
+static VMValue builtin_say(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    if (!*args) return command_reply("Say what?\r\n");
+    
+    char msg[BUFFER_SIZE];
+    snprintf(msg, sizeof(msg), "%s says: %s\r\n", 
+            session->username, args);
+    broadcast_message(msg, session);
+    
+    snprintf(msg, sizeof(msg), "You say: %s\r\n", args);
+    return command_reply(msg);
+}
+
+static VMValue builtin_emote(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    if (!*args) return command_reply("Emote what?\r\n");
+    
+    char msg[BUFFER_SIZE];
+    snprintf(msg, sizeof(msg), "%s %s\r\n", session->username, args);
+    broadcast_message(msg, session);
+    return command_reply(msg);
+}
 
-        command_debug_set_context(command, cmd, args ? args : "", "builtin");
+static VMValue builtin_who(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb; (void)args;
+    char msg[BUFFER_SIZE];
+    int count = 0;
+    strcpy(msg, "Players online:\r\n");
+    
+    for (int i = 0; i < session_count; i++) {
+        if (sessions[i] && sessions[i]->state == STATE_PLAYING) {
+            char line[128];
+            time_t idle = time(NULL) - sessions[i]->last_activity;
+            const char *priv = (sessions[i]->privilege_level == 2) ? "[Admin]" :
+                              (sessions[i]->privilege_level == 1) ? "[Wiz]" : "";
+            snprintf(line, sizeof(line), "  %-20s %s(idle: %ld seconds)\r\n",
+                    sessions[i]->username, priv, idle);
+            if (strlen(msg) + strlen(line) < sizeof(msg) - 64) {  /* Room for the footer */
+                strcat(msg, line);
+            }
+            count++;
+        }
     }
     
-    /* Fallback to built-in commands if no player object or no result */
+    char footer[64];
+    snprintf(footer, sizeof(footer), "\r\nTotal: %d player%s\r\n", 
+            count, count == 1 ? "" : "s");
+    strcat(msg, footer);
     
-    /* Built-in commands */
+    return command_reply(msg);
+}
+
+static VMValue builtin_promote(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb;
+    static const char usage[] =
+        "Usage: promote <player> <level>\r\n"
+        "Levels: 0=player, 1=wizard, 2=admin\r\n";
     
-    /* Movement commands */
-    if (strcmp(cmd, "north") == 0 || strcmp(cmd, "n") == 0) {
-        cmd_move(session, "north");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    if (strcmp(cmd, "south") == 0 || strcmp(cmd, "s") == 0) {
-        cmd_move(session, "south");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    if (strcmp(cmd, "east") == 0 || strcmp(cmd, "e") == 0) {
-        cmd_move(session, "east");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    if (strcmp(cmd, "west") == 0 || strcmp(cmd, "w") == 0) {
-        cmd_move(session, "west");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    if (strcmp(cmd, "up") == 0 || strcmp(cmd, "u") == 0) {
-        cmd_move(session, "up");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    if (strcmp(cmd, "down") == 0 || strcmp(cmd, "d") == 0) {
-        cmd_move(session, "down");
-        result.type = VALUE_NULL;
-        return result;
+    char target_name[64];
+    int new_level;
+    if (!*args || sscanf(args, "%63s %d", target_name, &new_level) != 2) {
+        return command_reply(usage);
     }
     
-    if (strcmp(cmd, "quit") == 0 || strcmp(cmd, "logout") == 0) {
-        /* Auto-save before quitting */
-        send_to_player(session, "\r\nSaving your character...\r\n");
-        if (save_character(session)) {
-            send_to_player(session, " Character saved.\r\n");
-        } else {
-            send_to_player(session, " Warning: Failed to save character.\r\n");
-        }
-        
-        result.type = VALUE_STRING;
-        result.data.string_value = strdup("quit");
-        return result;
+    if (new_level < 0 || new_level > 2) {
+        return command_reply("Invalid level. Use 0 (player), 1 (wizard), or 2 (admin).\r\n");
     }
     
-    if (strcmp(cmd, "save") == 0) {
-        if (save_character(session)) {
-            send_to_player(session, " Character saved successfully.\r\n");
-        } else {
-            send_to_player(session, " Failed to save character.\r\n");
+    // Find and promote player
+    for (int i = 0; i < session_count; i++) {
+        if (sessions[i] && sessions[i]->state == STATE_PLAYING &&
+            strcmp(sessions[i]->username, target_name) == 0) {
+            sessions[i]->privilege_level = new_level;
+            
+            char msg[256];
+            const char *level_name = (new_level == 2) ? "Admin" : 
+                                     (new_level == 1) ? "Wizard" : "Player";
+            snprintf(msg, sizeof(msg), 
+                    "Promoted %s to %s (level %d).\r\n", 
+                    target_name, level_name, new_level);
+            return command_reply(msg);
         }
-        result.type = VALUE_NULL;
-        return result;
     }
+    return command_reply("Player not found.\r\n");
+}
+
+static VMValue builtin_users(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb; (void)args;
+    char msg[BUFFER_SIZE];
+    strcpy(msg, "Connected users:\r\n");
+    strcat(msg, "Name            Privilege      Idle      Out: queued/sent/dropped\r\n");
+    strcat(msg, "----------------------------------------------------------------------\r\n");
     
-    if (strcmp(cmd, "help") == 0) {
-        result.type = VALUE_STRING;
-        
-        char help_text[2048];
-        strcpy(help_text, 
-            "Available commands:\r\n"
-            "  help                 - Show this help\r\n"
-            "  look / l             - Look at your surroundings\r\n"
-            "  inventory / i        - Check your inventory\r\n"
-            "  say <message>        - Say something\r\n"
-            "  emote <action>       - Perform an emote\r\n"
-            "  who                  - List players online\r\n"
-            "  stats                - Show your character stats\r\n"
-            "  save                 - Save your character\r\n"
-            "  quit / logout        - Save and disconnect\r\n"
-            "\r\nMovement: north, south, east, west, up, down (or n, s, e, w, u, d)\r\n");
-        
-        if (session->privilege_level >= 1) {
-            strcat(help_text,
-                "\r\nWIZARD COMMANDS (Level 1+):\r\n"
-                "  goto <room>         - Teleport to a room\r\n"
-                "  clone <object>      - Clone an object\r\n");
-        }
-        
-        if (session->privilege_level >= 2) {
-            strcat(help_text,
-                "\r\nADMIN COMMANDS (Level 2):\r\n"
-                "  promote <player> <level> - Promote player (0=player, 1=wizard, 2=admin)\r\n"
-                "  users                     - Show detailed user list\r\n"
-                "  shutdown [delay]          - Shutdown server (optional delay in seconds)\r\n");
+    for (int i = 0; i < session_count; i++) {
+        if (sessions[i] && sessions[i]->state == STATE_PLAYING) {
+            const char *priv_name = (sessions[i]->privilege_level == 2) ? "Admin" :
+                                   (sessions[i]->privilege_level == 1) ? "Wizard" : "Player";
+            time_t idle = time(NULL) - sessions[i]->last_activity;
+            const OutputQueue *out = &sessions[i]->output;
+            char line[160];
+            snprintf(line, sizeof(line), "%-15s %-14s %-9ld %llu/%llu/%llu\r\n",
+                    sessions[i]->username, priv_name, idle,
+                    out->bytes_queued, out->bytes_flushed, out->bytes_dropped);
+            if (strlen(msg) + strlen(line) < sizeof(msg)) {
+                strcat(msg, line);
+            }
         }
-        
-        result.data.string_value = strdup(help_text);
-        return result;
-    }
-    
-    if (strcmp(cmd, "look") == 0 || strcmp(cmd, "l") == 0) {
-        cmd_look(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "stats") == 0 || strcmp(cmd, "score") == 0) {
-        cmd_stats(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "skills") == 0) {
-        cmd_skills(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "attack") == 0) {
-        cmd_attack(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "strike") == 0) {
-        cmd_strike(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "shoot") == 0) {
-        cmd_shoot(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "dodge") == 0) {
-        cmd_dodge(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "flee") == 0) {
-        cmd_flee(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "inventory") == 0 || strcmp(cmd, "i") == 0) {
-        cmd_inventory(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
     }
     
-    if (strcmp(cmd, "equip") == 0 || strcmp(cmd, "eq") == 0 || strcmp(cmd, "wield") == 0 || strcmp(cmd, "wear") == 0) {
-        cmd_equip(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "unequip") == 0 || strcmp(cmd, "uneq") == 0 || strcmp(cmd, "remove") == 0) {
-        cmd_unequip(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "worn") == 0 || strcmp(cmd, "equipment") == 0 || strcmp(cmd, "eq") == 0) {
-        cmd_worn(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "get") == 0 || strcmp(cmd, "take") == 0) {
-        cmd_get(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "drop") == 0) {
-        cmd_drop(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    /* Psionics commands (Phase 5) */
-    if (strcmp(cmd, "use") == 0) {
-        cmd_use_power(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "powers") == 0 || strcmp(cmd, "abilities") == 0) {
-        cmd_powers(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "isp") == 0 || strcmp(cmd, "inner_strength") == 0) {
-        cmd_isp(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    /* Magic commands (Phase 5) */
-    if (strcmp(cmd, "cast") == 0) {
-        cmd_cast(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
-    
-    if (strcmp(cmd, "spells") == 0 || strcmp(cmd, "grimoire") == 0) {
-        cmd_spells(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
+    return command_reply(msg);
+}
+
+static VMValue builtin_sched(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb; (void)args;
+    char msg[BUFFER_SIZE];
+    scheduler_format_stats(scheduler_global(), msg, sizeof(msg));
+    return command_reply(msg);
+}
+
+static VMValue builtin_goto(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    if (!*args) {
+        return command_reply(
+            "Usage: goto <room_id>\r\n"
+            "Available rooms: 0=Void, 1=Chi-Town Plaza, 2=Coalition HQ, 3=Merchant District\r\n");
     }
     
-    if (strcmp(cmd, "ppe") == 0 || strcmp(cmd, "ppp") == 0) {
-        cmd_ppe(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
+    int room_id = atoi(args);
+    Room *target_room = room_get_by_id(room_id);
     
-    if (strcmp(cmd, "meditate") == 0) {
-        cmd_meditate(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
+    if (!target_room) {
+        return command_reply("Invalid room ID.\r\n");
     }
     
-    if (strcmp(cmd, "say") == 0) {
-        if (args && *args) {
-            char msg[BUFFER_SIZE];
-            snprintf(msg, sizeof(msg), "%s says: %s\r\n", 
-                    session->username, args);
-            broadcast_message(msg, session);
-            
-            snprintf(msg, sizeof(msg), "You say: %s\r\n", args);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(msg);
-        } else {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("Say what?\r\n");
-        }
-        return result;
-    }
-    
-    if (strcmp(cmd, "emote") == 0) {
-        if (args && *args) {
-            char msg[BUFFER_SIZE];
-            snprintf(msg, sizeof(msg), "%s %s\r\n", session->username, args);
-            broadcast_message(msg, session);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(msg);
-        } else {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("Emote what?\r\n");
-        }
-        return result;
+    /* Remove from current room */
+    if (session->current_room) {
+        room_remove_player(session->current_room, session);
+        
+        char leave_msg[256];
+        snprintf(leave_msg, sizeof(leave_msg), 
+                "%s vanishes in a puff of smoke.\r\n", session->username);
+        room_broadcast(session->current_room, leave_msg, NULL);
     }
     
-    /* Priority gameplay commands */
-    if (strcmp(cmd, "tell") == 0) {
-        cmd_tell(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
+    /* Add to target room */
+    session->current_room = target_room;
+    room_add_player(target_room, session);
     
-    if (strcmp(cmd, "chat") == 0) {
-        cmd_chat(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
+    char arrive_msg[256];
+    snprintf(arrive_msg, sizeof(arrive_msg), 
+            "%s appears in a puff of smoke.\r\n", session->username);
+    room_broadcast(target_room, arrive_msg, session);
     
-    if (strcmp(cmd, "whisper") == 0) {
-        cmd_whisper(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
+    /* Show new room */
+    cmd_look(session, "");
     
-    if (strcmp(cmd, "shout") == 0) {
-        cmd_shout(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
+    return command_done();
+}
+
+static VMValue builtin_clone(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb;
+    if (!*args) {
+        return command_reply(
+            "Usage: clone <object>\r\n"
+            "Available objects: sword, shield, potion\r\n");
     }
     
-    if (strcmp(cmd, "exits") == 0) {
-        cmd_exits(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
+    char msg[512];
+    if (strcmp(args, "sword") == 0) {
+        snprintf(msg, sizeof(msg), 
+                "You conjure a gleaming sword from thin air!\r\n"
+                "The sword materializes in your hands.\r\n");
+    } else if (strcmp(args, "shield") == 0) {
+        snprintf(msg, sizeof(msg), 
+                "You conjure a sturdy shield from thin air!\r\n"
+                "The shield materializes on your arm.\r\n");
+    } else if (strcmp(args, "potion") == 0) {
+        snprintf(msg, sizeof(msg), 
+                "You conjure a health potion from thin air!\r\n"
+                "The potion appears in a small glass vial.\r\n");
+    } else {
+        snprintf(msg, sizeof(msg), 
+                "Unknown object: %s\r\n"
+                "Available objects: sword, shield, potion\r\n", args);
     }
     
-    if (strcmp(cmd, "examine") == 0 || strcmp(cmd, "exam") == 0) {
-        cmd_examine(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
+    return command_reply(msg);
+}
+
+static VMValue builtin_shutdown(PlayerSession *session, const char *verb, const char *args) {
+    (void)verb;
+    int delay = atoi(args);
     
-    if (strcmp(cmd, "give") == 0) {
-        cmd_give_item(session, args ? args : "");
-        result.type = VALUE_NULL;
-        return result;
-    }
+    char msg[256];
+    snprintf(msg, sizeof(msg), 
+            "SYSTEM: Admin %s is shutting down the server%s%d second%s.\r\n",
+            session->username,
+            delay > 0 ? " in " : "",
+            delay,
+            delay == 1 ? "" : "s");
+    broadcast_message(msg, NULL);
     
-    if (strcmp(cmd, "who") == 0) {
-        char msg[BUFFER_SIZE];
-        int count = 0;
-        strcpy(msg, "Players online:\r\n");
+    SERVER_LOG(LOG_LEVEL_INFO, "Shutdown initiated by %s", session->username);
+    server_running = 0;
+    return command_reply("Server shutdown initiated.\r\n");
+}
+
+typedef struct {
+    const char *verb;
+    const char *aliases;        /* Space separated, or NULL */
+    int min_privilege;
+    int flags;                  /* COMMAND_EARLY, COMMAND_ABBREV */
+    CommandHandler handler;
+} BuiltinCommand;
+
+/* Early commands run before the player object, and only for players with
+ * the privilege; the rest run when it leaves a command unhandled, and
+ * refuse players without it. */
+static const BuiltinCommand builtin_commands[] = {
+    /* Filesystem, for wizards and admins */
+    {"ls",        "dir",              1, COMMAND_EARLY,  builtin_ls},
+    {"cd",        NULL,               1, COMMAND_EARLY,  builtin_cd},
+    {"pwd",       NULL,               1, COMMAND_EARLY,  builtin_pwd},
+    {"cat",       "more",             1, COMMAND_EARLY,  builtin_cat},
+    
+    /* Movement */
+    {"north",     "n",                0, 0,              builtin_move},
+    {"south",     "s",                0, 0,              builtin_move},
+    {"east",      "e",                0, 0,              builtin_move},
+    {"west",      "w",                0, 0,              builtin_move},
+    {"up",        "u",                0, 0,              builtin_move},
+    {"down",      "d",                0, 0,              builtin_move},
+    
+    {"quit",      "logout",           0, 0,              builtin_quit},
+    {"save",      NULL,               0, 0,              builtin_save},
+    {"help",      NULL,               0, 0,              builtin_help},
+    {"look",      "l",                0, 0,              builtin_look},
+    {"stats",     "score",            0, 0,              builtin_stats},
+    {"skills",    NULL,               0, COMMAND_ABBREV, builtin_skills},
+    
+    /* Combat */
+    {"attack",    NULL,               0, 0,              builtin_attack},
+    {"strike",    NULL,               0, 0,              builtin_strike},
+    {"shoot",     NULL,               0, 0,              builtin_shoot},
+    {"dodge",     NULL,               0, 0,              builtin_dodge},
+    {"flee",      NULL,               0, 0,              builtin_flee},
+    
+    /* Items */
+    {"inventory", "i",                0, COMMAND_ABBREV, builtin_inventory},
+    {"equip",     "eq wield wear",    0, 0,              builtin_equip},
+    {"unequip",   "uneq remove",      0, 0,              builtin_unequip},
+    {"worn",      "equipment",        0, 0,              builtin_worn},
+    {"get",       "take",             0, 0,              builtin_get},
+    {"drop",      NULL,               0, 0,              builtin_drop},
+    
+    /* Psionics and magic */
+    {"use",       NULL,               0, 0,              builtin_use},
+    {"powers",    "abilities",        0, COMMAND_ABBREV, builtin_powers},
+    {"isp",       "inner_strength",   0, 0,              builtin_isp},
+    {"cast",      NULL,               0, 0,              builtin_cast},
+    {"spells",    "grimoire",         0, COMMAND_ABBREV, builtin_spells},
+    {"ppe",       "ppp",              0, 0,              builtin_ppe},
+    {"meditate",  NULL,               0, COMMAND_ABBREV, builtin_meditate},
+    
+    /* Communication */
+    {"say",       NULL,               0, 0,              builtin_say},
+    {"emote",     NULL,               0, 0,              builtin_emote},
+    {"tell",      NULL,               0, 0,              builtin_tell},
+    {"chat",      NULL,               0, 0,              builtin_chat},
+    {"whisper",   NULL,               0, 0,              builtin_whisper},
+    {"shout",     NULL,               0, 0,              builtin_shout},
+    {"exits",     NULL,               0, 0,              builtin_exits},
+    {"examine",   "exam",             0, COMMAND_ABBREV, builtin_examine},
+    {"give",      NULL,               0, 0,              builtin_give},
+    {"who",       NULL,               0, 0,              builtin_who},
+    
+    /* Admin */
+    {"promote",   NULL,               2, 0,              builtin_promote},
+    {"users",     NULL,               2, 0,              builtin_users},
+    {"sched",     NULL,               2, 0,              builtin_sched},
+    {"shutdown",  NULL,               2, 0,              builtin_shutdown},
+    
+    /* Wizard */
+    {"goto",      NULL,               1, 0,              builtin_goto},
+    {"clone",     NULL,               1, 0,              builtin_clone},
+};
+
+static void register_builtin_commands(void) {
+    CommandTable *table = command_table_global();
+    size_t count = sizeof(builtin_commands) / sizeof(builtin_commands[0]);
+    
+    for (size_t i = 0; i < count; i++) {
+        const BuiltinCommand *b = &builtin_commands[i];
+        command_table_add_builtin(table, b->verb, b->handler, b->min_privilege, b->flags);
+        if (!b->aliases) continue;
         
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (sessions[i] && sessions[i]->state == STATE_PLAYING) {
-                char line[128];
-                time_t idle = time(NULL) - sessions[i]->last_activity;
-                const char *priv = (sessions[i]->privilege_level == 2) ? "[Admin]" :
-                                  (sessions[i]->privilege_level == 1) ? "[Wiz]" : "";
-                snprintf(line, sizeof(line), "  %-20s %s(idle: %ld seconds)\r\n",
-                        sessions[i]->username, priv, idle);
-                strcat(msg, line);
-                count++;
-            }
+        char aliases[64];
+        snprintf(aliases, sizeof(aliases), "%s", b->aliases);
+        char *save = NULL;
+        for (char *alias = strtok_r(aliases, " ", &save); alias; alias = strtok_r(NULL, " ", &save)) {
+            command_table_add_alias(table, alias, b->verb);
         }
-        
-        char footer[64];
-        snprintf(footer, sizeof(footer), "\r\nTotal: %d player%s\r\n", 
-                count, count == 1 ? "" : "s");
-        strcat(msg, footer);
-        
-        result.type = VALUE_STRING;
-        result.data.string_value = strdup(msg);
-        return result;
     }
+}
+
+/*
+ * Route a command: one lookup of its verb in the command table, then, in
+ * order, an early builtin, actions in reach of the player, the player
+ * object's process_command(), and the builtin as a fallback.
+ */
+VMValue execute_command(PlayerSession *session, const char *command) {
+    VMValue result;
+    result.type = VALUE_NULL;
     
-    if (strcmp(cmd, "stats") == 0) {
-        char msg[512];
-        const char *priv_name = (session->privilege_level == 2) ? "Admin" :
-                               (session->privilege_level == 1) ? "Wizard" : "Player";
-        snprintf(msg, sizeof(msg),
-            "Your stats:\r\n"
-            "  Name: %s\r\n"
-            "  Privilege Level: %d (%s)\r\n"
-            "  Level: 1\r\n"
-            "  HP: 100/100\r\n"
-            "  Strength: 10\r\n"
-            "  Dexterity: 10\r\n"
-            "  Intelligence: 10\r\n",
-            session->username, session->privilege_level, priv_name);
-        
-        result.type = VALUE_STRING;
-        result.data.string_value = strdup(msg);
+    if (!global_vm || !session) {
         return result;
     }
     
-    /* Movement commands */
-    const char *directions[] = {"north", "south", "east", "west", "up", "down", 
-                               "n", "s", "e", "w", "u", "d", NULL};
-    for (int i = 0; directions[i]; i++) {
-        if (strcmp(cmd, directions[i]) == 0) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("You can't go that way.\r\n");
-            return result;
-        }
+    /* Parse command early for filesystem checks */
+    char cmd_buffer[256];
+    strncpy(cmd_buffer, command, sizeof(cmd_buffer) - 1);
+    cmd_buffer[sizeof(cmd_buffer) - 1] = '\0';
+    
+    /* Convert to lowercase for comparison */
+    char *cmd = cmd_buffer;
+    for (int i = 0; cmd[i]; i++) {
+        cmd[i] = tolower(cmd[i]);
     }
     
-    /* Admin commands */
-    if (strcmp(cmd, "promote") == 0) {
-        if (session->privilege_level < 2) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("You don't have permission to use that command.\r\n");
-            return result;
-        }
-        
-        if (!args || *args == '\0') {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(
-                "Usage: promote <player> <level>\r\n"
-                "Levels: 0=player, 1=wizard, 2=admin\r\n");
-            return result;
-        }
-        
-        char target_name[64];
-        int new_level;
-        if (sscanf(args, "%63s %d", target_name, &new_level) != 2) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(
-                "Usage: promote <player> <level>\r\n"
-                "Levels: 0=player, 1=wizard, 2=admin\r\n");
-            return result;
-        }
-        
-        if (new_level < 0 || new_level > 2) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("Invalid level. Use 0 (player), 1 (wizard), or 2 (admin).\r\n");
-            return result;
-        }
-        
-        // Find and promote player
-        int promoted = 0;
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (sessions[i] && sessions[i]->state == STATE_PLAYING &&
-                strcmp(sessions[i]->username, target_name) == 0) {
-                sessions[i]->privilege_level = new_level;
-                promoted = 1;
-                break;
-            }
-        }
-        
-        if (promoted) {
-            char msg[256];
-            const char *level_name = (new_level == 2) ? "Admin" : 
-                                     (new_level == 1) ? "Wizard" : "Player";
-            snprintf(msg, sizeof(msg), 
-                    "Promoted %s to %s (level %d).\r\n", 
-                    target_name, level_name, new_level);
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(msg);
-        } else {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("Player not found.\r\n");
-        }
-        return result;
+    /* Parse command and arguments */
+    char *args = strchr(cmd, ' ');
+    if (args) {
+        *args = '\0';
+        args++;
+        while (*args == ' ') args++;
+    } else {
+        args = cmd + strlen(cmd);
     }
+
+    CommandTable *table = command_table_global();
+    const CommandEntry *entry = command_table_match(table, cmd);
+    const CommandEntry *builtin = command_table_builtin(entry);
+    command_table_set_verb(table, cmd);
+    command_debug_set_context(command, cmd, args, "builtin");
     
-    if (strcmp(cmd, "users") == 0) {
-        if (session->privilege_level < 2) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("You don't have permission to use that command.\r\n");
-            return result;
-        }
-        
-        char msg[BUFFER_SIZE];
-        strcpy(msg, "Connected users:\r\n");
-        strcat(msg, "Name            Privilege      Idle\r\n");
-        strcat(msg, "----------------------------------------------\r\n");
-        
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (sessions[i] && sessions[i]->state == STATE_PLAYING) {
-                const char *priv_name = (sessions[i]->privilege_level == 2) ? "Admin" :
-                                       (sessions[i]->privilege_level == 1) ? "Wizard" : "Player";
-                time_t idle = time(NULL) - sessions[i]->last_activity;
-                char line[128];
-                snprintf(line, sizeof(line), "%-15s %-14s %ld sec\r\n",
-                        sessions[i]->username, priv_name, idle);
-                strcat(msg, line);
-            }
-        }
-        
-        result.type = VALUE_STRING;
-        result.data.string_value = strdup(msg);
-        return result;
+    /* Early builtins (the filesystem commands) - CHECK FIRST BEFORE PLAYER OBJECT */
+    if (builtin && (builtin->flags & COMMAND_EARLY) &&
+        session->privilege_level >= builtin->min_privilege) {
+        command_debug_set_context(command, cmd, args, "filesystem");
+        return builtin->handler(session, builtin->verb, args);
     }
     
-    /* Wizard commands */
-    if (strcmp(cmd, "goto") == 0) {
-        if (session->privilege_level < 1) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("You don't have permission to use that command.\r\n");
-            return result;
-        }
-        
-        if (!args || *args == '\0') {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(
-                "Usage: goto <room_id>\r\n"
-                "Available rooms: 0=Void, 1=Chi-Town Plaza, 2=Coalition HQ, 3=Merchant District\r\n");
-            return result;
-        }
-        
-        int room_id = atoi(args);
-        Room *target_room = room_get_by_id(room_id);
-        
-        if (!target_room) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("Invalid room ID.\r\n");
-            return result;
-        }
-        
-        /* Remove from current room */
-        if (session->current_room) {
-            room_remove_player(session->current_room, session);
-            
-            char leave_msg[256];
-            snprintf(leave_msg, sizeof(leave_msg), 
-                    "%s vanishes in a puff of smoke.\r\n", session->username);
-            room_broadcast(session->current_room, leave_msg, NULL);
-        }
-        
-        /* Add to target room */
-        session->current_room = target_room;
-        room_add_player(target_room, session);
-        
-        char arrive_msg[256];
-        snprintf(arrive_msg, sizeof(arrive_msg), 
-                "%s appears in a puff of smoke.\r\n", session->username);
-        room_broadcast(target_room, arrive_msg, session);
-        
-        /* Show new room */
-        cmd_look(session, "");
-        
-        result.type = VALUE_NULL;
-        return result;
+    /* Actions added by the player, its surroundings and what it carries */
+    if (entry && entry->actions && session->player_object) {
+        command_debug_set_context(command, cmd, args, "action");
+        set_current_session(session);
+        int handled = command_table_run_actions(table, global_vm, entry,
+                                                (obj_t *)session->player_object, args);
+        set_current_session(NULL);
+        if (handled) return command_reply("");
+        command_debug_set_context(command, cmd, args, "builtin");
     }
     
-    if (strcmp(cmd, "clone") == 0) {
-        if (session->privilege_level < 1) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("You don't have permission to use that command.\r\n");
-            return result;
-        }
-        
-        if (!args || *args == '\0') {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup(
-                "Usage: clone <object>\r\n"
-                "Available objects: sword, shield, potion\r\n");
+    /* If player object exists, route command through it. Set the
+     * current VM session so efuns like this_player() can access it. */
+    if (session->player_object) {
+        command_debug_set_context(command, cmd, args, "vm");
+        set_current_session(session);
+        result = call_player_command(session->player_object, command);
+        set_current_session(NULL);
+
+        /* If VM returns valid result, use it */
+        if (result.type == VALUE_STRING && result.data.string_value) {
             return result;
         }
+
+        command_debug_set_context(command, cmd, args, "builtin");
         
-        char msg[512];
-        if (strcmp(args, "sword") == 0) {
-            snprintf(msg, sizeof(msg), 
-                    "You conjure a gleaming sword from thin air!\r\n"
-                    "The sword materializes in your hands.\r\n");
-        } else if (strcmp(args, "shield") == 0) {
-            snprintf(msg, sizeof(msg), 
-                    "You conjure a sturdy shield from thin air!\r\n"
-                    "The shield materializes on your arm.\r\n");
-        } else if (strcmp(args, "potion") == 0) {
-            snprintf(msg, sizeof(msg), 
-                    "You conjure a health potion from thin air!\r\n"
-                    "The potion appears in a small glass vial.\r\n");
-        } else {
-            snprintf(msg, sizeof(msg), 
-                    "Unknown object: %s\r\n"
-                    "Available objects: sword, shield, potion\r\n", args);
-        }
-        
-        result.type = VALUE_STRING;
-        result.data.string_value = strdup(msg);
-        return result;
+        /* LPC code may have changed the table, so builtin is stale */
+        builtin = command_table_builtin(command_table_match(table, cmd));
     }
     
-    if (strcmp(cmd, "shutdown") == 0) {
-        if (session->privilege_level < 2) {
-            result.type = VALUE_STRING;
-            result.data.string_value = strdup("You don't have permission to use that command.\r\n");
-            return result;
-        }
-        
-        int delay = 0;
-        if (args && *args != '\0') {
-            delay = atoi(args);
+    /* Fallback to built-in commands if no player object or no result */
+    if (builtin && !(builtin->flags & COMMAND_EARLY)) {
+        if (session->privilege_level < builtin->min_privilege) {
+            return command_reply("You don't have permission to use that command.\r\n");
         }
-        
-        char msg[256];
-        snprintf(msg, sizeof(msg), 
-                "SYSTEM: Admin %s is shutting down the server%s%d second%s.\r\n",
-                session->username,
-                delay > 0 ? " in " : "",
-                delay,
-                delay == 1 ? "" : "s");
-        broadcast_message(msg, NULL);
-        
-        fprintf(stderr, "[Server] Shutdown initiated by %s\n", session->username);
-        server_running = 0;
-        result.type = VALUE_STRING;
-        result.data.string_value = strdup("Server shutdown initiated.\r\n");
-        return result;
+        return builtin->handler(session, builtin->verb, args);
     }
     
     /* Unknown command */
-    command_debug_set_context(command, cmd, args ? args : "", "unknown");
+    command_debug_set_context(command, cmd, args, "unknown");
     char error_msg[512];
     snprintf(error_msg, sizeof(error_msg), 
             "Unknown command: %.200s\r\nType 'help' for available commands.\r\n", cmd);
-    result.type = VALUE_STRING;
-    result.data.string_value = strdup(error_msg);
-    
-    return result;
+    return command_reply(error_msg);
 }
 
 /* Broadcast message to all players except one */
 void broadcast_message(const char *message, PlayerSession *exclude) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (sessions[i] && 
-            sessions[i]->state == STATE_PLAYING && 
-            sessions[i] != exclude) {
-            send_to_player(sessions[i], "%s", message);
+    SharedMessage shared;
+    if (shared_message_init(&shared, "%s", message) != 0) return;
+    
+    for (int i = 0; i < session_count; i++) {
+        if (sessions[i]->state == STATE_PLAYING && sessions[i] != exclude) {
+            send_shared_message(sessions[i], &shared);
         }
     }
+    shared_message_release(&shared);
 }
 
 /* Process input during login states */
@@ -1506,8 +1900,8 @@ void process_login_state(PlayerSession *session, const char *input) {
                     "");  /* Password hash not needed for existing players */
                 
                 if (!session->player_object) {
-                    fprintf(stderr, "[Server] WARNING: Failed to create LPC player object for %s\n",
-                            session->username);
+                    SERVER_LOG(LOG_LEVEL_WARN, "WARNING: Failed to create LPC player object for %s",
+                               session->username);
                     /* Continue anyway - C commands will still work */
                 }
                 
@@ -1584,8 +1978,8 @@ void process_login_state(PlayerSession *session, const char *input) {
             if (!first_player_created) {
                 session->privilege_level = 2;  /* Admin */
                 first_player_created = 1;
-                fprintf(stderr, "[Server] First player created: %s (privilege: Admin)\n",
-                       session->username);
+                SERVER_LOG(LOG_LEVEL_INFO, "First player created: %s (privilege: Admin)",
+                           session->username);
             } else {
                 session->privilege_level = 0;  /* Regular player */
             }
@@ -1639,6 +2033,25 @@ void process_playing_state(PlayerSession *session, const char *input) {
     }
 }
 
+/* Handle one complete input line */
+static void handle_session_line(PlayerSession *session, char *line) {
+    if (session->state == STATE_CONNECTING) {
+        send_prompt(session);
+    } else if (session->state == STATE_CHARGEN) {
+        if (strlen(line) > 0) {
+            process_chargen_state(session, line);
+        }
+    } else if (session->state == STATE_PLAYING) {
+        if (strlen(line) > 0) {
+            process_playing_state(session, line);
+        } else {
+            send_prompt(session);
+        }
+    } else {
+        process_login_state(session, line);
+    }
+}
+
 /* Handle incoming input for a session */
 void handle_session_input(PlayerSession *session, const char *input) {
     if (!session) return;
@@ -1666,22 +2079,7 @@ void handle_session_input(PlayerSession *session, const char *input) {
         char *cr = strchr(line_start, '\r');
         if (cr) *cr = '\0';
         
-        if (session->state == STATE_CONNECTING) {
-            send_prompt(session);
-        } else if (session->state == STATE_CHARGEN) {
-            if (strlen(line_start) > 0) {
-                process_chargen_state(session, line_start);
-            }
-        } else if (session->state == STATE_PLAYING) {
-            if (strlen(line_start) > 0) {
-                process_playing_state(session, line_start);
-            } else {
-                send_prompt(session);
-            }
-        } else {
-            process_login_state(session, line_start);
-        }
-        
+        handle_session_line(session, line_start);
         line_start = newline + 1;
     }
     
@@ -1695,77 +2093,111 @@ void handle_session_input(PlayerSession *session, const char *input) {
     }
 }
 
-/* Check for idle session timeouts */
+/* Fire idle timers that are due; each session is looked at only when
+ * it could have reached SESSION_TIMEOUT */
 void check_session_timeouts(void) {
-    time_t now = time(NULL);
+    timer_wheel_advance(&idle_timers, (unsigned long)time(NULL));
+}
+
+/* Scheduler task: one melee round for everyone in the game */
+static void player_round_tick(void *ctx) {
+    (void)ctx;
+    for (int i = 0; i < session_count; i++) {
+        PlayerSession *session = sessions[i];
+        if (session->state != STATE_PLAYING) continue;
+        
+        Character *ch = &session->character;
+        psionics_power_tick(ch);
+        psionics_meditate_tick(ch);
+        magic_spell_tick(ch);
+        magic_meditate_tick(ch);
+    }
+}
+
+/*
+ * A text message is one or more lines, handled where they lie in the
+ * frame parser's buffer
+ */
+static void handle_websocket_text(PlayerSession *session, char *text, size_t len) {
+    char *end = text + len;
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (sessions[i]) {
-            time_t idle = now - sessions[i]->last_activity;
-            
-            if (idle > SESSION_TIMEOUT) {
-                send_to_player(sessions[i], 
-                    "\r\nYou have been idle too long. Disconnecting...\r\n");
-                fprintf(stderr, "[Server] Timeout disconnect: %s (slot %d)\n",
-                       sessions[i]->username[0] ? sessions[i]->username : "guest",
-                       i);
-                sessions[i]->state = STATE_DISCONNECTING;
-            }
+    while (text < end) {
+        char *line_end = memchr(text, '\n', (size_t)(end - text));
+        if (!line_end) line_end = end;
+        *line_end = '\0';
+        
+        char *cr = memchr(text, '\r', (size_t)(line_end - text));
+        if (cr) *cr = '\0';
+        if (line_end - text >= INPUT_BUFFER_SIZE - 1) {
+            text[INPUT_BUFFER_SIZE - 2] = '\0';  /* As long as a telnet line may be */
         }
+        
+        handle_session_line(session, text);
+        text = line_end + 1;
     }
 }
 
-/* Handle WebSocket data */
-void handle_websocket_data(PlayerSession *session, const uint8_t *data, size_t len) {
-    if (!session || !data) return;
-    
-    session->last_activity = time(NULL);
-    
-    /* Append to WebSocket buffer */
-    if (session->ws_buffer_length + len >= WS_BUFFER_SIZE) {
-        fprintf(stderr, "[Server] WebSocket buffer overflow, clearing\n");
-        session->ws_buffer_length = 0;
-        return;
+/* Close the connection with a close frame carrying code */
+static void websocket_fail(PlayerSession *session, uint16_t code) {
+    size_t close_len;
+    uint8_t *close_frame = ws_encode_close(code, NULL, &close_len);
+    if (close_frame) {
+        session_write(session, close_frame, close_len);
+        free(close_frame);
     }
+    session->ws_state = WS_STATE_CLOSED;
+    session->state = STATE_DISCONNECTING;
+}
+
+/* Handle WebSocket data received into the session's frame parser */
+void handle_websocket_data(PlayerSession *session) {
+    if (!session) return;
     
-    memcpy(session->ws_buffer + session->ws_buffer_length, data, len);
-    session->ws_buffer_length += len;
+    session->last_activity = time(NULL);
+    WSParser *parser = &session->ws_parser;
     
     /* Handle based on WebSocket state */
     if (session->ws_state == WS_STATE_CONNECTING) {
         /* Check for complete HTTP request (ends with \r\n\r\n) */
-        if (memmem(session->ws_buffer, session->ws_buffer_length, "\r\n\r\n", 4) != NULL) {
-            /* Null-terminate for string processing */
-            session->ws_buffer[session->ws_buffer_length] = '\0';
+        size_t pending_len;
+        char *request = (char *)ws_parser_pending(parser, &pending_len);
+        char *request_end = memmem(request, pending_len, "\r\n\r\n", 4);
+        if (!request_end) return;
+        
+        size_t request_len = (size_t)(request_end - request) + 4;
+        WSHandshake handshake;
+        if (ws_handle_handshake(request, request_len, &handshake) == 0) {
+            /* Send handshake response */
+            session_write(session, handshake.response, handshake.response_len);
             
-            WSHandshake handshake;
-            if (ws_handle_handshake((char*)session->ws_buffer, session->ws_buffer_length, &handshake) == 0) {
-                /* Send handshake response */
-                send(session->fd, handshake.response, handshake.response_len, 0);
-                ws_handshake_free(&handshake);
-                
-                session->ws_state = WS_STATE_OPEN;
-                session->ws_buffer_length = 0;
-                
-                fprintf(stderr, "[Server] WebSocket handshake complete for slot\n");
-                
-                /* Send welcome prompt */
-                send_prompt(session);
-            } else {
-                /* Invalid handshake */
-                fprintf(stderr, "[Server] WebSocket handshake failed\n");
-                session->state = STATE_DISCONNECTING;
+            /* Output is compressed from the first message after the response */
+            if (handshake.deflate) {
+                parser->deflate = 1;
+                session->compressor = compressor_new(COMPRESS_WS_DEFLATE, handshake.deflate_window_bits,
+                                                     handshake.deflate_no_context_takeover,
+                                                     SESSION_OUTPUT_LIMIT);
             }
+            ws_handshake_free(&handshake);
+            
+            session->ws_state = WS_STATE_OPEN;
+            ws_parser_skip(parser, request_len);
+            
+            SERVER_LOG(LOG_LEVEL_DEBUG, "WebSocket handshake complete for slot");
+            
+            /* Send welcome prompt */
+            send_prompt(session);
+        } else {
+            /* Invalid handshake */
+            SERVER_LOG(LOG_LEVEL_WARN, "WebSocket handshake failed");
+            session->state = STATE_DISCONNECTING;
+            return;
         }
-        return;
     }
     
-    /* Process WebSocket frames */
-    while (session->ws_buffer_length > 0 && session->ws_state == WS_STATE_OPEN) {
-        WSFrame frame;
-        size_t consumed;
-        
-        int result = ws_decode_frame(session->ws_buffer, session->ws_buffer_length, &frame, &consumed);
+    /* Process WebSocket messages */
+    while (session->ws_state == WS_STATE_OPEN && session->state != STATE_DISCONNECTING) {
+        WSMessage message;
+        int result = ws_parser_next(parser, &message);
         
         if (result > 0) {
             /* Need more data */
@@ -1774,27 +2206,29 @@ void handle_websocket_data(PlayerSession *session, const uint8_t *data, size_t l
         
         if (result < 0) {
             /* Error */
-            fprintf(stderr, "[Server] WebSocket frame decode error\n");
-            session->state = STATE_DISCONNECTING;
+            SERVER_LOG(LOG_LEVEL_WARN, "WebSocket frame decode error (close code %d)",
+                       parser->close_code);
+            websocket_fail(session, parser->close_code);
             break;
         }
         
-        /* Handle frame by opcode */
-        switch (frame.opcode) {
+        /* Handle message by opcode */
+        switch (message.opcode) {
             case WS_OPCODE_TEXT:
-                /* Process as normal input */
-                if (frame.payload && frame.payload_len > 0) {
-                    /* Add newline if not present (for command processing) */
-                    char input[INPUT_BUFFER_SIZE];
-                    size_t copy_len = frame.payload_len;
-                    if (copy_len >= sizeof(input) - 2) {
-                        copy_len = sizeof(input) - 2;
+                /* Process as normal input, inflated first if compressed */
+                if (message.compressed) {
+                    if (!session->decompressor) {
+                        session->decompressor = decompressor_new(WS_MAX_MESSAGE_SIZE);
                     }
-                    memcpy(input, frame.payload, copy_len);
-                    input[copy_len] = '\n';
-                    input[copy_len + 1] = '\0';
-                    
-                    handle_session_input(session, input);
+                    long len = decompressor_message(session->decompressor, message.data, message.len);
+                    if (len < 0) {
+                        SERVER_LOG(LOG_LEVEL_WARN, "WebSocket message could not be inflated");
+                        websocket_fail(session, WS_CLOSE_PROTOCOL_ERROR);
+                        break;
+                    }
+                    handle_websocket_text(session, (char *)session->decompressor->out, (size_t)len);
+                } else {
+                    handle_websocket_text(session, (char *)message.data, message.len);
                 }
                 break;
                 
@@ -1804,12 +2238,12 @@ void handle_websocket_data(PlayerSession *session, const uint8_t *data, size_t l
                 
             case WS_OPCODE_CLOSE:
                 /* Client initiated close */
-                fprintf(stderr, "[Server] WebSocket close received\n");
+                SERVER_LOG(LOG_LEVEL_DEBUG, "WebSocket close received");
                 {
                     size_t close_len;
                     uint8_t *close_frame = ws_encode_close(WS_CLOSE_NORMAL, "Goodbye", &close_len);
                     if (close_frame) {
-                        send(session->fd, close_frame, close_len, 0);
+                        session_write(session, close_frame, close_len);
                         free(close_frame);
                     }
                 }
@@ -1821,9 +2255,9 @@ void handle_websocket_data(PlayerSession *session, const uint8_t *data, size_t l
                 /* Respond with pong */
                 {
                     size_t pong_len;
-                    uint8_t *pong_frame = ws_encode_pong(frame.payload, frame.payload_len, &pong_len);
+                    uint8_t *pong_frame = ws_encode_pong(message.data, message.len, &pong_len);
                     if (pong_frame) {
-                        send(session->fd, pong_frame, pong_len, 0);
+                        session_write(session, pong_frame, pong_len);
                         free(pong_frame);
                     }
                 }
@@ -1833,52 +2267,9 @@ void handle_websocket_data(PlayerSession *session, const uint8_t *data, size_t l
                 /* Received pong, ignore */
                 break;
         }
-        
-        ws_frame_free(&frame);
-        
-        /* Remove consumed bytes from buffer */
-        if (consumed < session->ws_buffer_length) {
-            memmove(session->ws_buffer, session->ws_buffer + consumed, 
-                    session->ws_buffer_length - consumed);
-            session->ws_buffer_length -= consumed;
-        } else {
-            session->ws_buffer_length = 0;
-        }
     }
 }
 
-/* Setup WebSocket listener socket */
-int setup_ws_listener(int port) {
-    int ws_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (ws_fd < 0) {
-        fprintf(stderr, "[Server] ERROR: WebSocket socket() failed: %s\n", strerror(errno));
-        return -1;
-    }
-    
-    int opt = 1;
-    setsockopt(ws_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
-    struct sockaddr_in ws_addr;
-    memset(&ws_addr, 0, sizeof(ws_addr));
-    ws_addr.sin_family = AF_INET;
-    ws_addr.sin_addr.s_addr = INADDR_ANY;
-    ws_addr.sin_port = htons(port);
-    
-    if (bind(ws_fd, (struct sockaddr*)&ws_addr, sizeof(ws_addr)) < 0) {
-        fprintf(stderr, "[Server] ERROR: WebSocket bind() failed: %s\n", strerror(errno));
-        close(ws_fd);
-        return -1;
-    }
-    
-    if (listen(ws_fd, 10) < 0) {
-        fprintf(stderr, "[Server] ERROR: WebSocket listen() failed: %s\n", strerror(errno));
-        close(ws_fd);
-        return -1;
-    }
-    
-    return ws_fd;
-}
-
 /* Test mode: parse a single file and report results */
 int test_parse_file(const char *filename) {
     fprintf(stderr, "[Parser Test] File: %s\n", filename);
@@ -1947,10 +2338,19 @@ int main(int argc, char **argv) {
     signal(SIGINT, handle_shutdown_signal);
     signal(SIGTERM, handle_shutdown_signal);
     signal(SIGPIPE, SIG_IGN);
+    log_init();
+    
+    /* Compiled program images; AMLP_PROGRAM_CACHE="" turns them off */
+    const char *cache_dir = getenv("AMLP_PROGRAM_CACHE");
+    if (!cache_dir) cache_dir = PROGRAM_CACHE_DEFAULT_DIR;
+    if (*cache_dir && program_cache_set_dir(cache_dir) == 0) {
+        fprintf(stderr, "[Server] Program cache: %s\n", cache_dir);
+    }
     
     if (initialize_vm(master_path) != 0) {
         return 1;
     }
+    preload_mudlib();
 
     command_debug_init();
     
@@ -1972,44 +2372,40 @@ int main(int argc, char **argv) {
     /* Initialize magic system (Phase 5) */
     magic_init();
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        sessions[i] = NULL;
-    }
-    
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int server_fd = net_listen(port);
     if (server_fd < 0) {
-        fprintf(stderr, "[Server] ERROR: socket() failed: %s\n", strerror(errno));
         cleanup_vm();
         return 1;
     }
     
-    int opt = 1;
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port);
-    
-    if (bind(server_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        fprintf(stderr, "[Server] ERROR: bind() failed: %s\n", strerror(errno));
-        close(server_fd);
-        cleanup_vm();
-        return 1;
+    /* Setup WebSocket listener */
+    int ws_fd = net_listen(ws_port);
+    if (ws_fd < 0) {
+        fprintf(stderr, "[Server] WARNING: WebSocket listener failed, continuing with telnet only\n");
     }
     
-    if (listen(server_fd, 10) < 0) {
-        fprintf(stderr, "[Server] ERROR: listen() failed: %s\n", strerror(errno));
+    if (net_reactor_init(&reactor) != 0) {
         close(server_fd);
+        if (ws_fd > 0) close(ws_fd);
         cleanup_vm();
         return 1;
     }
+    timer_wheel_init(&idle_timers, (unsigned long)time(NULL));
     
-    /* Setup WebSocket listener */
-    int ws_fd = setup_ws_listener(ws_port);
-    if (ws_fd < 0) {
-        fprintf(stderr, "[Server] WARNING: WebSocket listener failed, continuing with telnet only\n");
+    Scheduler *scheduler = scheduler_global();
+    scheduler_every(scheduler, PLAYER_ROUND_MS, player_round_tick, NULL);
+    int scheduler_wait = -1;
+    int output_deferred = 0;     /* Compressed output left for the next pass */
+    
+    /* Listeners are level-triggered so a backlog left behind when we run
+     * out of descriptors is retried on the next pass */
+    listeners[0].fd = server_fd;
+    listeners[0].type = CONN_TELNET;
+    net_reactor_add(&reactor, server_fd, NET_EVENT_READ, &listeners[0]);
+    listeners[1].fd = ws_fd;
+    listeners[1].type = CONN_WEBSOCKET;
+    if (ws_fd > 0) {
+        net_reactor_add(&reactor, ws_fd, NET_EVENT_READ, &listeners[1]);
     }
     
     fprintf(stderr, "[Server] Telnet listening on port %d\n", port);
@@ -2018,156 +2414,72 @@ int main(int argc, char **argv) {
     }
     fprintf(stderr, "[Server] Ready for connections\n\n");
     
-    time_t last_timeout_check = time(NULL);
+    /* From here on log messages are written by a background thread */
+    log_start_writer();
     
     while (server_running) {
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        FD_SET(server_fd, &read_fds);
+        /* One collector slice per pass; keep polling until the cycle finishes */
+        int gc_busy = vm_gc_step(global_vm);
         
-        int max_fd = server_fd;
+        /* Wake for the next scheduler tick if it comes sooner */
+        int timeout = gc_busy ? GC_BUSY_POLL_MS : IDLE_POLL_MS;
+        if (scheduler_wait >= 0 && scheduler_wait < timeout) timeout = scheduler_wait;
+        if (output_deferred) timeout = 0;
         
-        /* Add WebSocket listener to select set */
-        if (ws_fd > 0) {
-            FD_SET(ws_fd, &read_fds);
-            if (ws_fd > max_fd) {
-                max_fd = ws_fd;
-            }
-        }
+        int ready = net_reactor_wait(&reactor, timeout);
+        if (ready < 0) break;
         
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (sessions[i] && sessions[i]->fd > 0) {
-                FD_SET(sessions[i]->fd, &read_fds);
-                if (sessions[i]->fd > max_fd) {
-                    max_fd = sessions[i]->fd;
-                }
-            }
-        }
-        
-        struct timeval timeout;
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-        
-        int activity = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
-        
-        if (activity < 0 && errno != EINTR) {
-            fprintf(stderr, "[Server] ERROR: select() failed: %s\n", strerror(errno));
-            break;
-        }
-        
-        if (activity < 0) continue;
-        
-        /* Handle telnet connections */
-        if (FD_ISSET(server_fd, &read_fds)) {
-            struct sockaddr_in client_addr;
-            socklen_t addr_len = sizeof(client_addr);
-            int new_fd = accept(server_fd, (struct sockaddr*)&client_addr, &addr_len);
+        for (int i = 0; i < ready; i++) {
+            NetEvent *event = &reactor.events[i];
             
-            if (new_fd >= 0) {
-                int slot = -1;
-                for (int i = 0; i < MAX_CLIENTS; i++) {
-                    if (!sessions[i]) {
-                        slot = i;
-                        break;
-                    }
-                }
-                
-                if (slot >= 0) {
-                    sessions[slot] = malloc(sizeof(PlayerSession));
-                    init_session(sessions[slot], new_fd, inet_ntoa(client_addr.sin_addr), CONN_TELNET);
-                    fprintf(stderr, "[Server] Telnet connection slot %d from %s\n", 
-                           slot, sessions[slot]->ip_address);
-                    send_prompt(sessions[slot]);
-                } else {
-                    const char *msg = "Server full.\r\n";
-                    send(new_fd, msg, strlen(msg), 0);
-                    close(new_fd);
-                }
+            if (event->data == &listeners[0] || event->data == &listeners[1]) {
+                accept_connections((Listener *)event->data);
+                continue;
             }
-        }
-        
-        /* Handle WebSocket connections */
-        if (ws_fd > 0 && FD_ISSET(ws_fd, &read_fds)) {
-            struct sockaddr_in client_addr;
-            socklen_t addr_len = sizeof(client_addr);
-            int new_fd = accept(ws_fd, (struct sockaddr*)&client_addr, &addr_len);
             
-            if (new_fd >= 0) {
-                int slot = -1;
-                for (int i = 0; i < MAX_CLIENTS; i++) {
-                    if (!sessions[i]) {
-                        slot = i;
-                        break;
-                    }
-                }
-                
-                if (slot >= 0) {
-                    sessions[slot] = malloc(sizeof(PlayerSession));
-                    init_session(sessions[slot], new_fd, inet_ntoa(client_addr.sin_addr), CONN_WEBSOCKET);
-                    fprintf(stderr, "[Server] WebSocket connection slot %d from %s\n", 
-                           slot, sessions[slot]->ip_address);
-                    /* Don't send prompt yet - wait for handshake */
-                } else {
-                    const char *msg = "HTTP/1.1 503 Service Unavailable\r\n\r\n";
-                    send(new_fd, msg, strlen(msg), 0);
-                    close(new_fd);
-                }
-            }
-        }
-        
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (!sessions[i] || sessions[i]->fd <= 0) continue;
+            PlayerSession *session = (PlayerSession *)event->data;
+            if (session->slot < 0) continue;  /* Closed earlier in this batch */
             
-            if (sessions[i]->state == STATE_DISCONNECTING) {
-                fprintf(stderr, "[Server] Closing slot %d\n", i);
-                free_session(sessions[i]);
-                sessions[i] = NULL;
+            if ((event->events & NET_EVENT_WRITE) && session_flush(session) < 0) {
+                close_session(session, "Write failed");
                 continue;
             }
-            
-            if (FD_ISSET(sessions[i]->fd, &read_fds)) {
-                char buffer[BUFFER_SIZE];
-                ssize_t bytes = recv(sessions[i]->fd, buffer, sizeof(buffer) - 1, 0);
-                
-                if (bytes <= 0) {
-                    fprintf(stderr, "[Server] Disconnect slot %d\n", i);
-                    free_session(sessions[i]);
-                    sessions[i] = NULL;
-                } else {
-                    if (sessions[i]->connection_type == CONN_WEBSOCKET) {
-                        /* Handle as WebSocket data */
-                        handle_websocket_data(sessions[i], (uint8_t*)buffer, bytes);
-                    } else {
-                        /* Handle as telnet data */
-                        buffer[bytes] = '\0';
-                        handle_session_input(sessions[i], buffer);
-                    }
-                }
+            if (event->events & (NET_EVENT_READ | NET_EVENT_HANGUP)) {
+                session_readable(session);
             }
         }
         
-        time_t now = time(NULL);
-        if (now - last_timeout_check > 60) {
-            check_session_timeouts();
-            last_timeout_check = now;
-        }
+        check_session_timeouts();
+        scheduler_wait = scheduler_run(scheduler, global_vm, scheduler_clock_ms());
+        output_deferred = flush_dirty_sessions();
+        reap_closed_sessions();
     }
     
-    fprintf(stderr, "\n[Server] Shutting down...\n");
+    SERVER_LOG(LOG_LEVEL_INFO, "Shutting down...");
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (sessions[i]) {
-            send_to_player(sessions[i], "\r\nServer shutting down...\r\n");
-            free_session(sessions[i]);
-        }
+    while (session_count > 0) {
+        PlayerSession *session = sessions[session_count - 1];
+        send_to_player(session, "\r\nServer shutting down...\r\n");
+        close_session(session, "Shutdown");
     }
+    flush_dirty_sessions();
+    reap_closed_sessions();
+    free(sessions);
+    log_shutdown();
     
+    net_reactor_close(&reactor);
     close(server_fd);
     if (ws_fd > 0) {
         close(ws_fd);
     }
+    scheduler_free(scheduler);
     cleanup_vm();
     
+    const ProgramCacheStats *cache = program_cache_stats();
+    fprintf(stderr, "[Server] Program cache: %lu hits, %lu rehashed, %lu compiled, %lu rejected\n",
+            cache->hits, cache->rehashed, cache->misses, cache->rejected);
+    program_cache_set_dir(NULL);
+    
     fprintf(stderr, "[Server] Shutdown complete\n");
     return 0;
 }
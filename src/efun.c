@@ -13,9 +13,12 @@
 #include "mapping.h"
 #include "object.h"
 #include "compiler.h"
-#include "program_loader.h"
+#include "object_program.h"
 #include "object.h"
 #include "session.h"
+#include "slab.h"
+#include "scheduler.h"
+#include "command_table.h"
 #include <sys/stat.h>
 #include <libgen.h>
 #include <limits.h>
@@ -25,6 +28,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <math.h>
 #include <time.h>
@@ -941,7 +945,7 @@ VMValue efun_rm(VirtualMachine *vm, VMValue *args, int arg_count) {
 
 /* ========== Object/Player Efuns ========== */
 
-static ObjManager *get_global_obj_manager(void) {
+ObjManager *efun_object_manager(void) {
     static ObjManager *mgr = NULL;
     if (!mgr) mgr = obj_manager_init();
     return mgr;
@@ -963,57 +967,39 @@ VMValue efun_clone_object(VirtualMachine *vm, VMValue *args, int arg_count) {
         return vm_value_create_null();
     }
 
-    /* Compile source file */
-    Program *prog = compiler_compile_file(fs_path);
-    if (!prog) {
-        return vm_value_create_null();
-    }
-
-    /* Load into VM (adds VMFunction entries) */
-    if (program_loader_load(vm, prog) != 0) {
-        program_free(prog);
+    /* Compiled once per file; later clones share it */
+    ObjProgram *program = obj_program_load(vm, lpc_path, fs_path);
+    if (!program) {
         return vm_value_create_null();
     }
 
     /* Create object and register it */
     obj_t *o = obj_new(lpc_path);
     if (!o) {
-        program_free(prog);
         return vm_value_create_null();
     }
-    ObjManager *mgr = get_global_obj_manager();
-    if (mgr) obj_manager_register(mgr, o);
-
-    /* Attach functions from program to object by name lookup in VM */
-    for (size_t fi = 0; fi < prog->function_count; fi++) {
-        const char *fname = prog->functions[fi].name;
-        if (!fname) continue;
-        /* Find VMFunction pointer by name */
-        for (int i = 0; i < vm->function_count; i++) {
-            if (vm->functions[i] && strcmp(vm->functions[i]->name, fname) == 0) {
-                obj_add_method(o, vm->functions[i]);
-                break;
-            }
-        }
+    if (obj_program_attach(o, program) != 0) {
+        obj_free(o);
+        return vm_value_create_null();
     }
+    ObjManager *mgr = efun_object_manager();
+    if (mgr) obj_manager_register(mgr, o);
 
     /* Debug: report which key methods were attached */
-    {
-        int has_process = obj_get_method(o, "process_command") ? 1 : 0;
+    if (LOG_ENABLED(LOG_EFUN, LOG_LEVEL_DEBUG)) {
         int has_setup = obj_get_method(o, "setup_player") ? 1 : 0;
         int has_save = obj_get_method(o, "save_me") ? 1 : 0;
-        fprintf(stderr, "[Efun] clone_object: created '%s' methods=%d setup=%d save_me=%d\n",
-                o->name ? o->name : "<noname>", o->method_count, has_setup, has_save);
+        DEBUG_LOG_EFUN("clone_object: created '%s' methods=%d setup=%d save_me=%d",
+                       o->name ? o->name : "<noname>", program->function_count, has_setup, has_save);
     }
 
     /* Call create() on object if present */
-    fprintf(stderr, "[Efun] clone_object: calling create() on %s\n",
-            o->name ? o->name : "<noname>");
+    DEBUG_LOG_EFUN("clone_object: calling create() on %s",
+                   o->name ? o->name : "<noname>");
     obj_call_method(vm, o, "create", NULL, 0);
-    fprintf(stderr, "[Efun] clone_object: create() returned for %s\n",
-            o->name ? o->name : "<noname>");
-
-    program_free(prog);
+    DEBUG_LOG_EFUN("clone_object: create() returned for %s",
+                   o->name ? o->name : "<noname>");
+    scheduler_arm_reset(scheduler_global(), o);
 
     VMValue v;
     v.type = VALUE_OBJECT;
@@ -1027,7 +1013,7 @@ VMValue efun_find_object(VirtualMachine *vm, VMValue *args, int arg_count) {
     const char *path = args[0].data.string_value;
     if (!path) return vm_value_create_null();
 
-    ObjManager *mgr = get_global_obj_manager();
+    ObjManager *mgr = efun_object_manager();
     if (!mgr) return vm_value_create_null();
 
     obj_t *found = obj_manager_find(mgr, path);
@@ -1053,7 +1039,7 @@ VMValue efun_call_other(VirtualMachine *vm, VMValue *args, int arg_count) {
         target = (obj_t *)args[0].data.object_value;
     } else if (args[0].type == VALUE_STRING) {
         /* find object by path/name */
-        ObjManager *mgr = get_global_obj_manager();
+        ObjManager *mgr = efun_object_manager();
         if (!mgr) return vm_value_create_null();
         for (int i = 0; i < mgr->object_count; i++) {
             if (mgr->objects[i] && mgr->objects[i]->name && strcmp(mgr->objects[i]->name, args[0].data.string_value) == 0) {
@@ -1073,6 +1059,14 @@ VMValue efun_call_other(VirtualMachine *vm, VMValue *args, int arg_count) {
     return obj_call_method(vm, target, method, sub, sub_args);
 }
 
+/* present() matches an object's name or its "id" property */
+static int efun_present_match(obj_t *o, const char *id) {
+    if (o->name && strcmp(o->name, id) == 0) return 1;
+
+    VMValue pid = obj_get_prop(o, "id");
+    return pid.type == VALUE_STRING && strcmp(pid.data.string_value, id) == 0;
+}
+
 VMValue efun_present(VirtualMachine *vm, VMValue *args, int arg_count) {
     (void)vm;
     if (arg_count < 1) return vm_value_create_null();
@@ -1082,43 +1076,35 @@ VMValue efun_present(VirtualMachine *vm, VMValue *args, int arg_count) {
     obj_t *where = NULL;
     if (arg_count >= 2 && args[1].type == VALUE_OBJECT) where = (obj_t *)args[1].data.object_value;
 
-    ObjManager *mgr = get_global_obj_manager();
-    if (!mgr) return vm_value_create_null();
-
-    for (int i = 0; i < mgr->object_count; i++) {
-        obj_t *o = mgr->objects[i];
-        if (!o) continue;
-        /* If where is provided, ensure object's environment matches */
-        if (where) {
-            VMValue env = obj_get_prop(o, "environment");
-            int match_env = 0;
-            if (env.type == VALUE_OBJECT && env.data.object_value == where) match_env = 1;
-            if (!match_env) continue;
-        }
-
-        /* match by object name */
-        if (o->name && strcmp(o->name, id) == 0) {
-            VMValue v; v.type = VALUE_OBJECT; v.data.object_value = o; return v;
+    obj_t *found = NULL;
+    if (where) {
+        /* Walk only the container's inventory */
+        for (obj_t *o = where->first_inventory; o && !found; o = o->next_inventory) {
+            if (efun_present_match(o, id)) found = o;
         }
+    } else {
+        ObjManager *mgr = efun_object_manager();
+        if (!mgr) return vm_value_create_null();
 
-        /* match by id property */
-        VMValue pid = obj_get_prop(o, "id");
-        if (pid.type == VALUE_STRING && strcmp(pid.data.string_value, id) == 0) {
-            VMValue v; v.type = VALUE_OBJECT; v.data.object_value = o; return v;
+        for (int i = 0; i < mgr->object_count && !found; i++) {
+            obj_t *o = mgr->objects[i];
+            if (o && efun_present_match(o, id)) found = o;
         }
     }
 
-    return vm_value_create_null();
+    if (!found) return vm_value_create_null();
+    VMValue v; v.type = VALUE_OBJECT; v.data.object_value = found; return v;
 }
 
 VMValue efun_environment(VirtualMachine *vm, VMValue *args, int arg_count) {
     (void)vm;
     if (arg_count != 1 || args[0].type != VALUE_OBJECT) return vm_value_create_null();
     obj_t *o = (obj_t *)args[0].data.object_value;
-    if (!o) return vm_value_create_null();
+    if (!o || !o->environment) return vm_value_create_null();
 
-    VMValue env = obj_get_prop(o, "environment");
-    if (env.type == VALUE_UNINITIALIZED) return vm_value_create_null();
+    VMValue env;
+    env.type = VALUE_OBJECT;
+    env.data.object_value = o->environment;
     return env;
 }
 
@@ -1131,10 +1117,7 @@ VMValue efun_move_object(VirtualMachine *vm, VMValue *args, int arg_count) {
     obj_t *dst = (obj_t *)args[1].data.object_value;
     if (!src || !dst) return vm_value_create_int(0);
 
-    VMValue v;
-    v.type = VALUE_OBJECT;
-    v.data.object_value = dst;
-    if (obj_set_prop(src, "environment", v) != 0) return vm_value_create_int(0);
+    if (obj_move(src, dst) != 0) return vm_value_create_int(0);
     return vm_value_create_int(1);
 }
 
@@ -1164,14 +1147,14 @@ VMValue efun_load_object(VirtualMachine *vm, VMValue *args, int arg_count) {
     const char *lpc_path = args[0].data.string_value;
     if (!lpc_path) return vm_value_create_null();
     
-    fprintf(stderr, "[Efun] load_object: requested '%s'\n", lpc_path);
+    DEBUG_LOG_EFUN("load_object: requested '%s'", lpc_path);
     
     /* Check if object is already loaded (singleton pattern) */
-    ObjManager *mgr = get_global_obj_manager();
+    ObjManager *mgr = efun_object_manager();
     if (mgr) {
         obj_t *existing = obj_manager_find(mgr, lpc_path);
         if (existing) {
-            fprintf(stderr, "[Efun] load_object: '%s' already loaded, returning existing object\n", lpc_path);
+            DEBUG_LOG_EFUN("load_object: '%s' already loaded, returning existing object", lpc_path);
             VMValue v;
             v.type = VALUE_OBJECT;
             v.data.object_value = existing;
@@ -1187,55 +1170,38 @@ VMValue efun_load_object(VirtualMachine *vm, VMValue *args, int arg_count) {
     /* Strip leading slash */
     const char *p = lpc_path[0] == '/' ? lpc_path + 1 : lpc_path;
     if (snprintf(fs_path, sizeof(fs_path), "%s/%s.lpc", mudlib, p) >= (int)sizeof(fs_path)) {
-        fprintf(stderr, "[Efun] load_object: path too long\n");
+        LOG_AT(LOG_EFUN, LOG_LEVEL_ERROR, "[Efun]", "load_object: path too long");
         return vm_value_create_null();
     }
     
-    fprintf(stderr, "[Efun] load_object: compiling '%s'\n", fs_path);
-    
-    /* Compile source file */
-    Program *prog = compiler_compile_file(fs_path);
-    if (!prog) {
-        fprintf(stderr, "[Efun] load_object: compilation failed for '%s'\n", fs_path);
-        return vm_value_create_null();
-    }
+    DEBUG_LOG_EFUN("load_object: compiling '%s'", fs_path);
     
-    /* Load into VM (adds VMFunction entries) */
-    if (program_loader_load(vm, prog) != 0) {
-        fprintf(stderr, "[Efun] load_object: program_loader_load failed\n");
-        program_free(prog);
+    /* Compiled once per file; clones of it share the program */
+    ObjProgram *program = obj_program_load(vm, lpc_path, fs_path);
+    if (!program) {
+        LOG_AT(LOG_EFUN, LOG_LEVEL_ERROR, "[Efun]", "load_object: compilation failed for '%s'", fs_path);
         return vm_value_create_null();
     }
     
     /* Create object and register it */
     obj_t *o = obj_new(lpc_path);
     if (!o) {
-        fprintf(stderr, "[Efun] load_object: obj_new failed\n");
-        program_free(prog);
+        LOG_AT(LOG_EFUN, LOG_LEVEL_ERROR, "[Efun]", "load_object: obj_new failed");
         return vm_value_create_null();
     }
-    if (mgr) obj_manager_register(mgr, o);
-    
-    /* Attach functions from program to object by name lookup in VM */
-    for (size_t fi = 0; fi < prog->function_count; fi++) {
-        const char *fname = prog->functions[fi].name;
-        if (!fname) continue;
-        /* Find VMFunction pointer by name */
-        for (int i = 0; i < vm->function_count; i++) {
-            if (vm->functions[i] && strcmp(vm->functions[i]->name, fname) == 0) {
-                obj_add_method(o, vm->functions[i]);
-                break;
-            }
-        }
+    if (obj_program_attach(o, program) != 0) {
+        LOG_AT(LOG_EFUN, LOG_LEVEL_ERROR, "[Efun]", "load_object: obj_program_attach failed");
+        obj_free(o);
+        return vm_value_create_null();
     }
+    if (mgr) obj_manager_register(mgr, o);
     
-    fprintf(stderr, "[Efun] load_object: created '%s' with %d methods\n", 
-            o->name ? o->name : "<noname>", o->method_count);
+    DEBUG_LOG_EFUN("load_object: created '%s' with %d methods", 
+                   o->name ? o->name : "<noname>", program->function_count);
     
     /* Call create() on object if present */
     obj_call_method(vm, o, "create", NULL, 0);
-    
-    program_free(prog);
+    scheduler_arm_reset(scheduler_global(), o);
     
     VMValue v;
     v.type = VALUE_OBJECT;
@@ -1250,24 +1216,15 @@ VMValue efun_all_inventory(VirtualMachine *vm, VMValue *args, int arg_count) {
     obj_t *container = (obj_t *)args[0].data.object_value;
     if (!container) return vm_value_create_null();
     
-    /* Build array of all objects with this container as environment */
-    array_t *result = array_new(vm->gc, 8);
+    /* Build array of the container's inventory, most recent first */
+    array_t *result = array_new(vm->gc, (size_t)container->inventory_count);
     if (!result) return vm_value_create_null();
     
-    ObjManager *mgr = get_global_obj_manager();
-    if (mgr) {
-        for (int i = 0; i < mgr->object_count; i++) {
-            obj_t *obj = mgr->objects[i];
-            if (obj) {
-                VMValue env = obj_get_prop(obj, "environment");
-                if (env.type == VALUE_OBJECT && env.data.object_value == container) {
-                    VMValue obj_val;
-                    obj_val.type = VALUE_OBJECT;
-                    obj_val.data.object_value = obj;
-                    array_push(result, obj_val);
-                }
-            }
-        }
+    for (obj_t *obj = container->first_inventory; obj; obj = obj->next_inventory) {
+        VMValue obj_val;
+        obj_val.type = VALUE_OBJECT;
+        obj_val.data.object_value = obj;
+        array_push(result, obj_val);
     }
     
     VMValue v;
@@ -1307,7 +1264,7 @@ VMValue efun_function_exists(VirtualMachine *vm, VMValue *args, int arg_count) {
     if (!target) return vm_value_create_int(0);
     
     /* Check if function exists in target object */
-    VMFunction *method = obj_get_method(target, func_name);
+    VMFunction *method = obj_method_table_find_string(obj_method_table(target), func_name);
     return vm_value_create_int(method != NULL ? 1 : 0);
 }
 
@@ -1317,16 +1274,181 @@ VMValue efun_enable_commands(VirtualMachine *vm, VMValue *args, int arg_count) {
     return vm_value_create_int(1);
 }
 
+/* Copy a verb argument into buf in lowercase; 0 if it is not a usable verb */
+static int efun_verb_arg(VMValue *arg, char *buf, size_t size) {
+    if (arg->type != VALUE_STRING || !arg->data.string_value) return 0;
+    const char *verb = arg->data.string_value;
+    size_t len = strlen(verb);
+    if (len == 0 || len >= size) return 0;
+    for (size_t i = 0; i <= len; i++) buf[i] = (char)tolower((unsigned char)verb[i]);
+    return 1;
+}
+
+/* add_action(function, verb, flag): flag 1 lets a unique prefix of verb match */
 VMValue efun_add_action(VirtualMachine *vm, VMValue *args, int arg_count) {
-    (void)vm; (void)args; (void)arg_count;
-    /* Stub: action registration for command processing */
-    return vm_value_create_int(1);
+    char verb[COMMAND_VERB_MAX];
+    if (!vm || !vm->current_object || arg_count < 2) return vm_value_create_int(0);
+    if (args[0].type != VALUE_STRING || !args[0].data.string_value) return vm_value_create_int(0);
+    if (!efun_verb_arg(&args[1], verb, sizeof(verb))) return vm_value_create_int(0);
+    int flags = (arg_count > 2 && args[2].type == VALUE_INT && args[2].data.int_value == 1) ?
+                COMMAND_ABBREV : 0;
+    return vm_value_create_int(command_table_add_action(command_table_global(), verb,
+                                                        vm->current_object,
+                                                        args[0].data.string_value, flags) == 0);
 }
 
 VMValue efun_query_verb(VirtualMachine *vm, VMValue *args, int arg_count) {
     (void)vm; (void)args; (void)arg_count;
-    /* Stub: would return current command verb */
-    return vm_value_create_string("");
+    return vm_value_create_string(command_table_verb(command_table_global()));
+}
+
+VMValue efun_register_verb(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    char verb[COMMAND_VERB_MAX];
+    if (arg_count != 2 || !efun_verb_arg(&args[0], verb, sizeof(verb))) return vm_value_create_int(0);
+    if (args[1].type != VALUE_STRING || !args[1].data.string_value) return vm_value_create_int(0);
+    return vm_value_create_int(command_table_add_path(command_table_global(), verb,
+                                                      args[1].data.string_value) == 0);
+}
+
+VMValue efun_unregister_verb(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    char verb[COMMAND_VERB_MAX];
+    if (arg_count != 1 || !efun_verb_arg(&args[0], verb, sizeof(verb))) return vm_value_create_int(0);
+    return vm_value_create_int(command_table_remove_path(command_table_global(), verb) == 0);
+}
+
+VMValue efun_query_verb_path(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    char verb[COMMAND_VERB_MAX];
+    if (arg_count != 1 || !efun_verb_arg(&args[0], verb, sizeof(verb))) return vm_value_create_int(0);
+    const CommandEntry *entry = command_table_find(command_table_global(), verb);
+    if (!entry || !entry->path) return vm_value_create_int(0);
+    return vm_value_create_string(entry->path);
+}
+
+VMValue efun_query_verbs(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)args; (void)arg_count;
+    if (!vm || !vm->gc) return vm_value_create_null();
+    CommandTable *table = command_table_global();
+    array_t *result = array_new(vm->gc, table->count);
+    if (!result) return vm_value_create_null();
+    for (size_t i = 0; i < table->slot_count; i++) {
+        const CommandEntry *entry = table->slots[i];
+        if (entry && entry->path) {
+            array_push(result, vm_value_create_string(entry->verb));
+        }
+    }
+    VMValue v;
+    v.type = VALUE_ARRAY;
+    v.data.array_value = result;
+    return v;
+}
+
+/* Category named by a string argument; "all" is LOG_CATEGORY_COUNT */
+static int efun_log_category_arg(VMValue *arg) {
+    if (arg->type != VALUE_STRING || !arg->data.string_value) return -1;
+    if (strcasecmp(arg->data.string_value, "all") == 0) return LOG_CATEGORY_COUNT;
+    return log_category_by_name(arg->data.string_value);
+}
+
+/* set_log_level(category, level): returns the previous level, or -1 */
+VMValue efun_set_log_level(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    if (arg_count != 2 || args[1].type != VALUE_INT) return vm_value_create_int(-1);
+    if (get_current_privilege() == 0) {
+        LOG_AT(LOG_EFUN, LOG_LEVEL_WARN, "[Efun]", "set_log_level: refused, not a wizard");
+        return vm_value_create_int(-1);
+    }
+    int category = efun_log_category_arg(&args[0]);
+    if (category < 0) return vm_value_create_int(-1);
+    return vm_value_create_int(log_set_level(category, (int)args[1].data.int_value));
+}
+
+VMValue efun_query_log_level(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    if (arg_count != 1) return vm_value_create_int(-1);
+    int category = efun_log_category_arg(&args[0]);
+    if (category < 0 || category == LOG_CATEGORY_COUNT) return vm_value_create_int(-1);
+    return vm_value_create_int(log_levels[category]);
+}
+
+/* ========== Scheduler Efuns ========== */
+
+VMValue efun_this_object(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)args; (void)arg_count;
+    if (!vm || !vm->current_object) return vm_value_create_null();
+    VMValue v;
+    v.type = VALUE_OBJECT;
+    v.data.object_value = vm->current_object;
+    return v;
+}
+
+VMValue efun_set_heart_beat(VirtualMachine *vm, VMValue *args, int arg_count) {
+    if (arg_count != 1 || args[0].type != VALUE_INT) return vm_value_create_int(0);
+    if (!vm || !vm->current_object) return vm_value_create_int(0);
+    
+    int beats = (int)args[0].data.int_value;
+    return vm_value_create_int(scheduler_set_heart_beat(scheduler_global(), vm->current_object, beats));
+}
+
+VMValue efun_query_heart_beat(VirtualMachine *vm, VMValue *args, int arg_count) {
+    obj_t *obj = vm ? vm->current_object : NULL;
+    if (arg_count == 1 && args[0].type == VALUE_OBJECT) obj = (obj_t *)args[0].data.object_value;
+    return vm_value_create_int(scheduler_query_heart_beat(obj));
+}
+
+/* call_out(string function, int|float delay, mixed args...) */
+VMValue efun_call_out(VirtualMachine *vm, VMValue *args, int arg_count) {
+    if (arg_count < 2 || args[0].type != VALUE_STRING) return vm_value_create_int(-1);
+    if (!vm || !vm->current_object) return vm_value_create_int(-1);
+    
+    double seconds;
+    if (args[1].type == VALUE_INT) {
+        seconds = (double)args[1].data.int_value;
+    } else if (args[1].type == VALUE_FLOAT) {
+        seconds = args[1].data.float_value;
+    } else {
+        return vm_value_create_int(-1);
+    }
+    if (seconds < 0) seconds = 0;
+    
+    int handle = scheduler_call_out(scheduler_global(), vm->current_object,
+                                    args[0].data.string_value, (unsigned long)(seconds * 1000.0),
+                                    args + 2, arg_count - 2);
+    return vm_value_create_int(handle);
+}
+
+/* remove_call_out(int handle | string function): seconds left, or -1 */
+VMValue efun_remove_call_out(VirtualMachine *vm, VMValue *args, int arg_count) {
+    if (arg_count != 1 || !vm || !vm->current_object) return vm_value_create_int(-1);
+    
+    Scheduler *sched = scheduler_global();
+    if (args[0].type == VALUE_STRING) {
+        return vm_value_create_int(scheduler_remove_call_out(sched, vm->current_object,
+                                                             args[0].data.string_value, 0));
+    }
+    if (args[0].type == VALUE_INT) {
+        return vm_value_create_int(scheduler_remove_call_out(sched, vm->current_object, NULL,
+                                                             (int)args[0].data.int_value));
+    }
+    return vm_value_create_int(-1);
+}
+
+/* find_call_out(int handle | string function): seconds left, or -1 */
+VMValue efun_find_call_out(VirtualMachine *vm, VMValue *args, int arg_count) {
+    if (arg_count != 1 || !vm || !vm->current_object) return vm_value_create_int(-1);
+    
+    Scheduler *sched = scheduler_global();
+    if (args[0].type == VALUE_STRING) {
+        return vm_value_create_int(scheduler_find_call_out(sched, vm->current_object,
+                                                           args[0].data.string_value, 0));
+    }
+    if (args[0].type == VALUE_INT) {
+        return vm_value_create_int(scheduler_find_call_out(sched, vm->current_object, NULL,
+                                                           (int)args[0].data.int_value));
+    }
+    return vm_value_create_int(-1);
 }
 
 /* ========== Debugging Efuns ========== */
@@ -1395,7 +1517,7 @@ VMValue efun_debug_mem_stats(VirtualMachine *vm, VMValue *args, int arg_count) {
     (void)arg_count;
     if (!vm) return vm_value_create_null();
 
-    char buffer[512];
+    char buffer[2048];
     unsigned long outstanding = 0;
     size_t bytes_outstanding = 0;
     if (vm->profile.string_allocs >= vm->profile.string_frees) {
@@ -1408,13 +1530,62 @@ VMValue efun_debug_mem_stats(VirtualMachine *vm, VMValue *args, int arg_count) {
     snprintf(buffer, sizeof(buffer),
              "VM memory stats:\n"
              "  strings: alloc=%lu free=%lu outstanding=%lu\n"
-             "  string_bytes: alloc=%zu free=%zu outstanding=%zu\n",
+             "  string_bytes: alloc=%zu free=%zu outstanding=%zu\n"
+             "  strings_interned: %d\n"
+             "  method_cache: hits=%lu misses=%lu\n",
              vm->profile.string_allocs,
              vm->profile.string_frees,
              outstanding,
              vm->profile.string_bytes_alloc,
              vm->profile.string_bytes_free,
-             bytes_outstanding);
+             bytes_outstanding,
+             vm_string_intern_count(),
+             vm->profile.method_cache_hits,
+             vm->profile.method_cache_misses);
+
+    /* Collector pauses: bucket i counts slices shorter than 2^i microseconds */
+    GC *gc = vm->gc;
+    if (gc) {
+        size_t len = strlen(buffer);
+        len += snprintf(buffer + len, sizeof(buffer) - len,
+                        "  gc: cycles=%d slices=%lu last_freed=%d tracked=%d\n"
+                        "  gc_pause_us: max=%ld mean=%.1f budget=%ld\n"
+                        "  gc_pause_histogram:",
+                        gc->collection_count, gc->slice_count, gc->last_cycle_freed,
+                        gc->object_count, gc->pause_max_usec,
+                        gc->slice_count ? gc->pause_total_usec / (double)gc->slice_count : 0.0,
+                        gc->slice_budget_usec);
+        for (int i = 0; i < GC_PAUSE_BUCKETS && len < sizeof(buffer); i++) {
+            if (i < GC_PAUSE_BUCKETS - 1) {
+                len += snprintf(buffer + len, sizeof(buffer) - len, " <%ld:%lu",
+                                1L << i, gc->pause_histogram[i]);
+            } else {
+                len += snprintf(buffer + len, sizeof(buffer) - len, " >=%ld:%lu",
+                                1L << (i - 1), gc->pause_histogram[i]);
+            }
+        }
+        if (len < sizeof(buffer)) {
+            snprintf(buffer + len, sizeof(buffer) - len, "\n");
+        }
+    }
+
+    /* Slab classes in use: size allocs/live */
+    SlabStats slab;
+    slab_get_stats(&slab);
+    size_t len = strlen(buffer);
+    len += snprintf(buffer + len, sizeof(buffer) - len,
+                    "  slab: chunk_bytes=%zu large=%lu/%lu\n  slab_classes:",
+                    slab.chunk_bytes, slab.large_allocs,
+                    slab.large_allocs - slab.large_frees);
+    for (int i = 0; i < SLAB_CLASS_COUNT && len < sizeof(buffer); i++) {
+        if (slab.classes[i].allocs == 0) continue;
+        len += snprintf(buffer + len, sizeof(buffer) - len, " %zu:%lu/%lu",
+                        slab.classes[i].size, slab.classes[i].allocs,
+                        slab.classes[i].allocs - slab.classes[i].frees);
+    }
+    if (len < sizeof(buffer)) {
+        snprintf(buffer + len, sizeof(buffer) - len, "\n");
+    }
 
     return vm_value_create_string(buffer);
 }
@@ -1485,8 +1656,22 @@ int efun_register_all(EfunRegistry *registry) {
     efun_register(registry, "enable_commands", efun_enable_commands, 0, 0, "int enable_commands()");
     efun_register(registry, "add_action", efun_add_action, 2, 3, "int add_action(string, string)");
     efun_register(registry, "query_verb", efun_query_verb, 0, 0, "string query_verb()");
+    efun_register(registry, "register_verb", efun_register_verb, 2, 2, "int register_verb(string, string)");
+    efun_register(registry, "unregister_verb", efun_unregister_verb, 1, 1, "int unregister_verb(string)");
+    efun_register(registry, "query_verb_path", efun_query_verb_path, 1, 1, "string query_verb_path(string)");
+    efun_register(registry, "query_verbs", efun_query_verbs, 0, 0, "string* query_verbs()");
+    efun_register(registry, "set_log_level", efun_set_log_level, 2, 2, "int set_log_level(string, int)");
+    efun_register(registry, "query_log_level", efun_query_log_level, 1, 1, "int query_log_level(string)");
     efun_register(registry, "write", efun_write, 1, 1, "int write(mixed)");
     efun_register(registry, "printf", efun_printf, 1, -1, "int printf(string, ...)");
+    efun_register(registry, "this_object", efun_this_object, 0, 0, "object this_object()");
+    efun_register(registry, "set_heart_beat", efun_set_heart_beat, 1, 1, "int set_heart_beat(int)");
+    efun_register(registry, "query_heart_beat", efun_query_heart_beat, 0, 1,
+                  "int query_heart_beat(object|void)");
+    efun_register(registry, "call_out", efun_call_out, 2, -1, "int call_out(string, int|float, ...)");
+    efun_register(registry, "remove_call_out", efun_remove_call_out, 1, 1,
+                  "int remove_call_out(int|string)");
+    efun_register(registry, "find_call_out", efun_find_call_out, 1, 1, "int find_call_out(int|string)");
     count += 2;
 
     /* Debugging efuns */
@@ -159,6 +159,40 @@ VMValue efun_enable_commands(VirtualMachine *vm, VMValue *args, int arg_count);
 VMValue efun_add_action(VirtualMachine *vm, VMValue *args, int arg_count);
 VMValue efun_query_verb(VirtualMachine *vm, VMValue *args, int arg_count);
 
+/* ========== Command Registry Efuns ==========
+ * Verbs the command daemon maps to command objects, in the driver's
+ * command table (command_table.h). */
+
+VMValue efun_register_verb(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_unregister_verb(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_query_verb_path(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_query_verbs(VirtualMachine *vm, VMValue *args, int arg_count);
+
+/* ========== Logging Efuns ==========
+ * Levels per category (log.h); changing one needs a wizard, or no
+ * player command running. */
+
+VMValue efun_set_log_level(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_query_log_level(VirtualMachine *vm, VMValue *args, int arg_count);
+
+/* ========== Scheduler Efuns ==========
+ * These act on this_object(), the object whose method is running. */
+
+VMValue efun_this_object(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_set_heart_beat(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_query_heart_beat(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_call_out(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_remove_call_out(VirtualMachine *vm, VMValue *args, int arg_count);
+VMValue efun_find_call_out(VirtualMachine *vm, VMValue *args, int arg_count);
+
+/**
+ * Registry of every object created by the object efuns
+ * Created on first use; the collector scans it as a root.
+ *
+ * @return Global object manager, or NULL on allocation failure
+ */
+struct ObjManager* efun_object_manager(void);
+
 /* ========== Utility Functions ========== */
 
 /* Debugging efuns */
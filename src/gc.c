@@ -2,27 +2,122 @@
  * gc.c - Garbage Collection System Implementation
  * 
  * Reference-counted garbage collector with cycle detection.
- * 
+ *
+ * Once a tracer is installed, the types it names are reclaimed by an
+ * incremental mark and sweep instead: gc_step() runs one slice bounded
+ * by slice_budget_usec. Objects allocated while a cycle runs are born
+ * marked, and the tracer's write barrier marks references stored into
+ * the heap during the mark phase, so nothing reachable is swept.
+* 
  * Phase 5 Implementation - January 22, 2026
  */
 
 #include "gc.h"
+#include "slab.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#define GC_SLICE_CHECK_INTERVAL 32   /* Work units between clock reads */
+#define GC_ROOT_CHUNK 16             /* Roots visited per scan_roots call */
+#define GC_FIRST_EPOCH 2             /* 0 and 1 are used by the untraced sweep */
+
+/* gc_alloc() payloads follow their header, kept 16-byte aligned */
+#define GC_HEADER_SIZE (((sizeof(GCObject) + 15) / 16) * 16)
 
 /* ========== Helper Functions ========== */
 
+/**
+ * Slot for a pointer in the index (Fibonacci hashing of the address)
+ */
+static int gc_index_slot(const GC *gc, const void *ptr) {
+    unsigned long long key = (unsigned long long)(uintptr_t)ptr;
+    key = (key >> 4) * 11400714819323198485ULL;
+    return (int)((key >> 32) & (unsigned long long)(gc->index_capacity - 1));
+}
+
+/**
+ * Insert a wrapper into the index without growing it
+ */
+static void gc_index_put(GC *gc, GCObject *obj) {
+    int mask = gc->index_capacity - 1;
+    int slot = gc_index_slot(gc, obj->ptr);
+    
+    while (gc->index[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    gc->index[slot] = obj;
+}
+
+/**
+ * Double the index once it is half full
+ */
+static int gc_index_grow(GC *gc) {
+    if (gc->object_count < gc->index_capacity / 2) return 0;
+    
+    int old_capacity = gc->index_capacity;
+    GCObject **old_index = gc->index;
+    GCObject **new_index = (GCObject **)calloc((size_t)old_capacity * 2, sizeof(GCObject *));
+    if (!new_index) return -1;
+    
+    gc->index = new_index;
+    gc->index_capacity = old_capacity * 2;
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_index[i]) {
+            gc_index_put(gc, old_index[i]);
+        }
+    }
+    
+    free(old_index);
+    return 0;
+}
+
+/**
+ * Remove a wrapper from the index
+ * Later entries of the probe run are shifted back so lookups never
+ * need tombstones.
+ */
+static void gc_index_remove(GC *gc, GCObject *obj) {
+    int mask = gc->index_capacity - 1;
+    int slot = gc_index_slot(gc, obj->ptr);
+    
+    while (gc->index[slot] && gc->index[slot] != obj) {
+        slot = (slot + 1) & mask;
+    }
+    if (!gc->index[slot]) return;
+    
+    int hole = slot;
+    for (;;) {
+        slot = (slot + 1) & mask;
+        GCObject *next = gc->index[slot];
+        if (!next) break;
+        
+        /* Move next into the hole unless its home lies cyclically in (hole, slot] */
+        int home = gc_index_slot(gc, next->ptr);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            gc->index[hole] = next;
+            hole = slot;
+        }
+    }
+    gc->index[hole] = NULL;
+}
+
 /**
  * Find GCObject wrapper for a pointer
  */
 GCObject* gc_find_object(GC *gc, void *ptr) {
     if (!gc || !ptr) return NULL;
     
-    for (int i = 0; i < gc->object_count; i++) {
-        if (gc->objects[i] && gc->objects[i]->ptr == ptr) {
-            return gc->objects[i];
+    int mask = gc->index_capacity - 1;
+    int slot = gc_index_slot(gc, ptr);
+    
+    while (gc->index[slot]) {
+        if (gc->index[slot]->ptr == ptr) {
+            return gc->index[slot];
         }
+        slot = (slot + 1) & mask;
     }
     
     return NULL;
@@ -30,22 +125,190 @@ GCObject* gc_find_object(GC *gc, void *ptr) {
 
 /**
  * Remove object from tracking array
+ * The last object is moved into the freed slot.
  */
 static int gc_remove_object(GC *gc, GCObject *obj) {
     if (!gc || !obj) return -1;
     
-    for (int i = 0; i < gc->object_count; i++) {
-        if (gc->objects[i] == obj) {
-            /* Shift remaining objects down */
-            for (int j = i; j < gc->object_count - 1; j++) {
-                gc->objects[j] = gc->objects[j + 1];
-            }
-            gc->object_count--;
-            return 0;
+    int i = obj->index;
+    if (i < 0 || i >= gc->object_count || gc->objects[i] != obj) return -1;
+    
+    gc_index_remove(gc, obj);
+    
+    GCObject *last = gc->objects[--gc->object_count];
+    gc->objects[i] = last;
+    last->index = i;
+    obj->index = -1;
+    
+    return 0;
+}
+
+/* ========== Incremental Tracing Helpers ========== */
+
+static long gc_now_usec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+/**
+ * Record one pause in the histogram
+ */
+static void gc_note_pause(GC *gc, long usec) {
+    int bucket = 0;
+    while (bucket < GC_PAUSE_BUCKETS - 1 && usec >= (1L << bucket)) {
+        bucket++;
+    }
+    
+    gc->pause_histogram[bucket]++;
+    gc->slice_count++;
+    gc->pause_total_usec += (double)usec;
+    if (usec > gc->pause_max_usec) {
+        gc->pause_max_usec = usec;
+    }
+}
+
+static int gc_is_traced_type(const GC *gc, GCObjectType type) {
+    return (gc->tracer.types & (1u << type)) != 0;
+}
+
+static void gc_begin_cycle(GC *gc) {
+    gc->mark_epoch++;
+    if (gc->mark_epoch < GC_FIRST_EPOCH) {
+        gc->mark_epoch = GC_FIRST_EPOCH;
+    }
+    
+    gc->phase = GC_PHASE_MARK;
+    gc->allocation_count = 0;
+    gc->gray_count = 0;
+    gc->root_cursor = 0;
+    gc->sweep_cursor = 0;
+    gc->cycle_freed = 0;
+    
+    gc->tracer.mark_roots(gc, gc->tracer.ctx);
+}
+
+/**
+ * Trace one gray object; returns 0 if the gray stack was empty
+ */
+static int gc_trace_one(GC *gc) {
+    if (gc->gray_count == 0) return 0;
+    
+    GCObject *obj = gc->gray[--gc->gray_count];
+    gc->tracer.trace(gc, obj, gc->tracer.ctx);
+    return 1;
+}
+
+/**
+ * End of marking: rescan the unbarriered roots and trace what they reach
+ */
+static void gc_remark(GC *gc) {
+    gc->tracer.mark_roots(gc, gc->tracer.ctx);
+    while (gc_trace_one(gc)) {
+        /* drain */
+    }
+    
+    gc->phase = GC_PHASE_SWEEP;
+    gc->sweep_cursor = 0;
+}
+
+/**
+ * Examine one objects[] slot in the sweep
+ */
+static void gc_sweep_one(GC *gc) {
+    if (gc->sweep_cursor >= gc->object_count) {
+        gc->phase = GC_PHASE_IDLE;
+        gc->last_cycle_freed = gc->cycle_freed;
+        gc->collection_count++;
+        return;
+    }
+    
+    GCObject *obj = gc->objects[gc->sweep_cursor];
+    if (!gc_is_traced_type(gc, obj->type) || obj->marked == gc->mark_epoch) {
+        gc->sweep_cursor++;
+        return;
+    }
+    
+    gc->tracer.finalize(gc, obj, gc->tracer.ctx);
+    gc->cycle_freed++;
+    
+    /* A freed slot now holds the former last object, which still needs a look */
+    if (gc->sweep_cursor < gc->object_count && gc->objects[gc->sweep_cursor] == obj) {
+        gc->sweep_cursor++;
+    }
+}
+
+/**
+ * Perform one unit of collector work
+ */
+static void gc_work(GC *gc) {
+    if (gc->phase == GC_PHASE_MARK) {
+        if (gc_trace_one(gc)) return;
+    
+        if (gc->root_cursor >= 0 && gc->tracer.scan_roots) {
+            gc->root_cursor = gc->tracer.scan_roots(gc, gc->tracer.ctx,
+                                                    gc->root_cursor, GC_ROOT_CHUNK);
+            return;
         }
+    
+        gc_remark(gc);
+    } else if (gc->phase == GC_PHASE_SWEEP) {
+        gc_sweep_one(gc);
+    }
+}
+
+/* ========== Object Storage ========== */
+
+/**
+ * Make room for one more tracked object
+ */
+static int gc_reserve(GC *gc) {
+    if (gc->object_count >= gc->object_capacity) {
+        if (gc->object_capacity >= GC_MAX_OBJECTS) {
+            fprintf(stderr, "[GC] Maximum object limit reached (%d)\n", GC_MAX_OBJECTS);
+            return -1;
+        }
+        
+        GCObject **objects = (GCObject **)realloc(gc->objects,
+                                                  sizeof(GCObject *) * gc->object_capacity * 2);
+        if (!objects) return -1;
+        gc->objects = objects;
+        gc->object_capacity *= 2;
+    }
+    
+    return gc_index_grow(gc);
+}
+
+/**
+ * Initialize a wrapper and add it to the tracking array and pointer index
+ */
+static void gc_register(GC *gc, GCObject *obj, void *ptr, size_t size,
+                        GCObjectType type, int inline_payload) {
+    obj->ptr = ptr;
+    obj->type = type;
+    obj->ref_count = 1;  /* Start with reference count of 1 */
+    obj->marked = gc->phase != GC_PHASE_IDLE ? gc->mark_epoch : 0;  /* Born marked mid-cycle */
+    obj->size = size;
+    obj->index = gc->object_count;
+    obj->inline_payload = inline_payload;
+    obj->next = NULL;
+    
+    gc->objects[gc->object_count++] = obj;
+    gc_index_put(gc, obj);
+    gc->total_allocated += size;
+}
+
+/**
+ * Free a wrapper and the memory it tracks (already removed from tracking)
+ */
+static void gc_destroy_object(GCObject *obj) {
+    if (obj->inline_payload) {
+        slab_free(obj, GC_HEADER_SIZE + obj->size);
+        return;
     }
     
-    return -1;
+    free(obj->ptr);
+    slab_free(obj, sizeof(GCObject));
 }
 
 /* ========== Core GC Functions ========== */
@@ -58,7 +321,12 @@ GC* gc_init(void) {
     gc->object_count = 0;
     gc->objects = (GCObject **)malloc(sizeof(GCObject *) * gc->object_capacity);
     
-    if (!gc->objects) {
+    gc->index_capacity = GC_INDEX_INITIAL_CAPACITY;
+    gc->index = (GCObject **)calloc((size_t)gc->index_capacity, sizeof(GCObject *));
+    
+    if (!gc->objects || !gc->index) {
+        free(gc->objects);
+        free(gc->index);
         free(gc);
         return NULL;
     }
@@ -73,6 +341,24 @@ GC* gc_init(void) {
     gc->collect_threshold = GC_COLLECT_THRESHOLD;
     gc->auto_collect_enabled = 1;
     
+    /* Tracing stays off until a tracer is installed */
+    memset(&gc->tracer, 0, sizeof(gc->tracer));
+    gc->has_tracer = 0;
+    gc->phase = GC_PHASE_IDLE;
+    gc->mark_epoch = GC_FIRST_EPOCH;
+    gc->gray = NULL;
+    gc->gray_count = 0;
+    gc->gray_capacity = 0;
+    gc->root_cursor = -1;
+    gc->sweep_cursor = 0;
+    gc->slice_budget_usec = GC_SLICE_BUDGET_USEC;
+    gc->cycle_freed = 0;
+    gc->last_cycle_freed = 0;
+    gc->slice_count = 0;
+    memset(gc->pause_histogram, 0, sizeof(gc->pause_histogram));
+    gc->pause_max_usec = 0;
+    gc->pause_total_usec = 0.0;
+    
     printf("[GC] Initialized (capacity: %d)\n", gc->object_capacity);
     
     return gc;
@@ -81,21 +367,19 @@ GC* gc_init(void) {
 void* gc_alloc(GC *gc, size_t size, GCObjectType type) {
     if (!gc || size == 0) return NULL;
     
-    /* Allocate memory */
-    void *ptr = malloc(size);
-    if (!ptr) return NULL;
+    if (gc_reserve(gc) != 0) return NULL;
     
-    /* Track with GC */
-    GCObject *obj = gc_track(gc, ptr, size, type);
-    if (!obj) {
-        free(ptr);
-        return NULL;
-    }
+    /* Header and payload share one slab block */
+    GCObject *obj = (GCObject *)slab_alloc(GC_HEADER_SIZE + size);
+    if (!obj) return NULL;
+    
+    void *ptr = (char *)obj + GC_HEADER_SIZE;
+    gc_register(gc, obj, ptr, size, type, 1);
     
     gc->allocation_count++;
     
-    /* Auto-collect if threshold reached */
-    if (gc->auto_collect_enabled && 
+    /* Auto-collect if threshold reached (tracing GCs collect in gc_step) */
+    if (!gc->has_tracer && gc->auto_collect_enabled &&
         gc->allocation_count >= gc->collect_threshold) {
         gc_collect(gc);
         gc->allocation_count = 0;
@@ -107,34 +391,13 @@ void* gc_alloc(GC *gc, size_t size, GCObjectType type) {
 GCObject* gc_track(GC *gc, void *ptr, size_t size, GCObjectType type) {
     if (!gc || !ptr) return NULL;
     
-    /* Check if we need to expand tracking array */
-    if (gc->object_count >= gc->object_capacity) {
-        if (gc->object_capacity >= GC_MAX_OBJECTS) {
-            fprintf(stderr, "[GC] Maximum object limit reached (%d)\n", GC_MAX_OBJECTS);
-            return NULL;
-        }
-        
-        gc->object_capacity *= 2;
-        gc->objects = (GCObject **)realloc(gc->objects, 
-                                           sizeof(GCObject *) * gc->object_capacity);
-        if (!gc->objects) return NULL;
-    }
+    if (gc_reserve(gc) != 0) return NULL;
     
     /* Create GCObject wrapper */
-    GCObject *obj = (GCObject *)malloc(sizeof(GCObject));
+    GCObject *obj = (GCObject *)slab_alloc(sizeof(GCObject));
     if (!obj) return NULL;
     
-    obj->ptr = ptr;
-    obj->type = type;
-    obj->ref_count = 1;  /* Start with reference count of 1 */
-    obj->marked = 0;
-    obj->size = size;
-    obj->next = NULL;
-    
-    /* Add to tracking array */
-    gc->objects[gc->object_count++] = obj;
-    gc->total_allocated += size;
-    
+    gc_register(gc, obj, ptr, size, type, 0);
     return obj;
 }
 
@@ -160,15 +423,9 @@ int gc_release(GC *gc, void *ptr) {
     if (obj->ref_count <= 0) {
         gc->total_freed += obj->size;
         
-        /* Free the actual object */
-        if (obj->ptr) {
-            free(obj->ptr);
-            obj->ptr = NULL;
-        }
-        
-        /* Remove from tracking */
+        /* Remove from tracking while ptr still keys the index */
         gc_remove_object(gc, obj);
-        free(obj);
+        gc_destroy_object(obj);
         
         return -1;  /* Indicate object was freed */
     }
@@ -189,17 +446,12 @@ int gc_collect(GC *gc) {
             /* Free the object */
             gc->total_freed += obj->size;
             
-            if (obj->ptr) {
-                free(obj->ptr);
-                obj->ptr = NULL;
-            }
-            
-            /* Remove from tracking */
+            /* Remove from tracking while ptr still keys the index */
             gc_remove_object(gc, obj);
-            free(obj);
+            gc_destroy_object(obj);
             
             freed_count++;
-            /* Don't increment i since we shifted array down */
+            /* Don't increment i: the last object was moved into slot i */
         } else {
             i++;
         }
@@ -217,6 +469,22 @@ int gc_collect(GC *gc) {
 int gc_collect_full(GC *gc) {
     if (!gc) return 0;
     
+    if (gc->has_tracer) {
+        long start = gc_now_usec();
+        if (gc->phase == GC_PHASE_IDLE) {
+            gc_begin_cycle(gc);
+        }
+        while (gc->phase != GC_PHASE_IDLE) {
+            gc_work(gc);
+        }
+        gc_note_pause(gc, gc_now_usec() - start);
+    
+        if (gc->last_cycle_freed > 0) {
+            printf("[GC] Full collection freed %d objects\n", gc->last_cycle_freed);
+        }
+        return gc->last_cycle_freed;
+    }
+    
     /* Mark phase: clear all marks */
     for (int i = 0; i < gc->object_count; i++) {
         if (gc->objects[i]) {
@@ -242,13 +510,8 @@ int gc_collect_full(GC *gc) {
             /* Unreachable object - free it */
             gc->total_freed += obj->size;
             
-            if (obj->ptr) {
-                free(obj->ptr);
-                obj->ptr = NULL;
-            }
-            
             gc_remove_object(gc, obj);
-            free(obj);
+            gc_destroy_object(obj);
             
             freed_count++;
         } else {
@@ -273,17 +536,16 @@ void gc_free(GC *gc) {
     /* Free all tracked objects */
     for (int i = 0; i < gc->object_count; i++) {
         if (gc->objects[i]) {
-            if (gc->objects[i]->ptr) {
-                free(gc->objects[i]->ptr);
-            }
-            free(gc->objects[i]);
+            gc_destroy_object(gc->objects[i]);
         }
     }
     
-    /* Free tracking array */
+    /* Free tracking array, pointer index and gray stack */
     if (gc->objects) {
         free(gc->objects);
     }
+    free(gc->index);
+    free(gc->gray);
     
     /* Print final statistics */
     printf("[GC] Final statistics:\n");
@@ -294,6 +556,81 @@ void gc_free(GC *gc) {
     free(gc);
 }
 
+/* ========== Incremental Collection ========== */
+
+void gc_set_tracer(GC *gc, const GCTracer *tracer) {
+    if (!gc) return;
+    
+    /* Finish the running cycle under the old hooks */
+    if (gc->has_tracer && gc->phase != GC_PHASE_IDLE) {
+        gc_collect_full(gc);
+    }
+    
+    if (tracer && tracer->mark_roots && tracer->trace && tracer->finalize) {
+        gc->tracer = *tracer;
+        gc->has_tracer = 1;
+    } else {
+        memset(&gc->tracer, 0, sizeof(gc->tracer));
+        gc->has_tracer = 0;
+    }
+    gc->phase = GC_PHASE_IDLE;
+}
+
+int gc_step(GC *gc) {
+    if (!gc || !gc->has_tracer) return 0;
+    
+    if (gc->phase == GC_PHASE_IDLE) {
+        if (!gc->auto_collect_enabled || gc->allocation_count < gc->collect_threshold) {
+            return 0;
+        }
+    }
+    
+    long start = gc_now_usec();
+    long deadline = start + gc->slice_budget_usec;
+    if (gc->phase == GC_PHASE_IDLE) {
+        gc_begin_cycle(gc);
+    }
+    
+    int units = 0;
+    while (gc->phase != GC_PHASE_IDLE) {
+        gc_work(gc);
+        if (++units % GC_SLICE_CHECK_INTERVAL == 0 && gc_now_usec() >= deadline) {
+            break;
+        }
+    }
+    
+    gc_note_pause(gc, gc_now_usec() - start);
+    return gc->phase != GC_PHASE_IDLE;
+}
+
+void gc_mark(GC *gc, void *ptr) {
+    if (!gc || !ptr || gc->phase != GC_PHASE_MARK) return;
+    
+    GCObject *obj = gc_find_object(gc, ptr);
+    if (!obj || obj->marked == gc->mark_epoch || !gc_is_traced_type(gc, obj->type)) return;
+    
+    obj->marked = gc->mark_epoch;
+    
+    if (gc->gray_count >= gc->gray_capacity) {
+        int capacity = gc->gray_capacity ? gc->gray_capacity * 2 : GC_INITIAL_CAPACITY;
+        GCObject **gray = (GCObject **)realloc(gc->gray, sizeof(GCObject *) * capacity);
+        if (!gray) {
+            /* Trace it now rather than lose it */
+            gc->tracer.trace(gc, obj, gc->tracer.ctx);
+            return;
+        }
+        gc->gray = gray;
+        gc->gray_capacity = capacity;
+    }
+    gc->gray[gc->gray_count++] = obj;
+}
+
+void gc_set_slice_budget(GC *gc, long usec) {
+    if (gc && usec > 0) {
+        gc->slice_budget_usec = usec;
+    }
+}
+
 /* ========== Reference Management ========== */
 
 int gc_get_ref_count(GC *gc, void *ptr) {
@@ -335,6 +672,12 @@ void gc_print_stats(GC *gc) {
     printf("  Collections performed: %d\n", gc->collection_count);
     printf("  Auto-collect: %s\n", gc->auto_collect_enabled ? "enabled" : "disabled");
     printf("  Collect threshold: %d allocations\n", gc->collect_threshold);
+    if (gc->has_tracer) {
+        printf("  Slices: %lu (max pause %ld us, mean %.1f us)\n", gc->slice_count,
+               gc->pause_max_usec,
+               gc->slice_count ? gc->pause_total_usec / (double)gc->slice_count : 0.0);
+        printf("  Last cycle freed: %d objects\n", gc->last_cycle_freed);
+    }
     printf("\n");
 }
 
@@ -6,7 +6,7 @@
  * 
  * Features:
  * - Reference counting for automatic cleanup
- * - Cycle detection for circular references
+ * - Incremental tracing collection with a per-slice pause budget
  * - Integration with object system
  * - Leak detection and reporting
  * - Configurable collection thresholds
@@ -29,6 +29,9 @@ typedef struct GC GC;
 #define GC_INITIAL_CAPACITY 256
 #define GC_COLLECT_THRESHOLD 1000    /* Collect after this many allocations */
 #define GC_MAX_OBJECTS 100000         /* Maximum tracked objects */
+#define GC_INDEX_INITIAL_CAPACITY 512 /* Pointer index slots (power of two) */
+#define GC_SLICE_BUDGET_USEC 500      /* Default pause budget of one collector slice */
+#define GC_PAUSE_BUCKETS 12           /* Pause histogram: <1us, <2us, <4us ... >=1024us */
 
 /* ========== Object Types ========== */
 
@@ -41,6 +44,35 @@ typedef enum {
     GC_TYPE_GENERIC,       /* Generic allocation */
 } GCObjectType;
 
+/* ========== Incremental Tracing ========== */
+
+typedef enum {
+    GC_PHASE_IDLE,         /* No cycle in progress */
+    GC_PHASE_MARK,         /* Tracing from the roots */
+    GC_PHASE_SWEEP,        /* Reclaiming unmarked objects */
+} GCPhase;
+
+/**
+ * Hooks through which the owner of the heap drives a tracing cycle.
+ * The GC only knows pointers; the tracer knows what they contain.
+ *
+ * mark_roots runs atomically at the start of a cycle and again before the
+ * sweep, so it should cover roots that change without a write barrier
+ * (stacks, globals). scan_roots walks the remaining roots a chunk at a
+ * time: it is called with cursor 0 first and returns the cursor to resume
+ * from, or -1 once every root has been visited. trace marks everything an
+ * object references and finalize frees an unreachable object, which must
+ * drop it from the GC with gc_release().
+ */
+typedef struct GCTracer {
+    unsigned int types;         /* Mask of (1u << GCObjectType) the tracer reclaims */
+    void (*mark_roots)(GC *gc, void *ctx);
+    int (*scan_roots)(GC *gc, void *ctx, int cursor, int limit);
+    void (*trace)(GC *gc, GCObject *obj, void *ctx);
+    void (*finalize)(GC *gc, GCObject *obj, void *ctx);
+    void *ctx;                  /* Passed to every hook */
+} GCTracer;
+
 /* ========== GC Object Wrapper ========== */
 
 /**
@@ -51,8 +83,10 @@ struct GCObject {
     void *ptr;                  /* Pointer to actual object */
     GCObjectType type;          /* Type of object */
     int ref_count;              /* Reference count */
-    int marked;                 /* Mark bit for cycle detection */
+    int marked;                 /* Mark epoch of the last cycle that reached it */
     size_t size;                /* Size in bytes */
+    int index;                  /* Position in GC objects array */
+    int inline_payload;         /* ptr shares this header's slab block (gc_alloc) */
     GCObject *next;             /* Next in linked list */
 };
 
@@ -61,12 +95,20 @@ struct GCObject {
 /**
  * Main garbage collector structure
  * Tracks all allocated objects and manages cleanup
+ *
+ * objects[] is unordered: removal moves the last entry into the freed
+ * slot and updates its index. The pointer index is an open-addressing
+ * table keyed by the tracked pointer, so lookup and removal are O(1)
+ * instead of a scan of every live object.
  */
 struct GC {
     GCObject **objects;         /* Array of tracked objects */
     int object_count;           /* Number of tracked objects */
     int object_capacity;        /* Capacity of objects array */
     
+    GCObject **index;           /* Pointer-keyed hash of tracked objects */
+    int index_capacity;         /* Slot count, always a power of two */
+    
     /* Statistics */
     size_t total_allocated;     /* Total bytes allocated */
     size_t total_freed;         /* Total bytes freed */
@@ -76,6 +118,26 @@ struct GC {
     /* Configuration */
     int collect_threshold;      /* Collect after this many allocations */
     int auto_collect_enabled;   /* Enable automatic collection */
+    
+    /* Incremental tracing, active once a tracer is installed */
+    GCTracer tracer;            /* Heap owner's hooks */
+    int has_tracer;             /* 1 if tracer is installed */
+    GCPhase phase;              /* Current cycle phase */
+    int mark_epoch;             /* marked value of reachable objects this cycle */
+    GCObject **gray;            /* Marked objects whose children are not traced yet */
+    int gray_count;             /* Entries in gray */
+    int gray_capacity;          /* Capacity of gray */
+    int root_cursor;            /* scan_roots resume point, -1 once done */
+    int sweep_cursor;           /* Next objects[] slot to sweep */
+    long slice_budget_usec;     /* Pause budget of one gc_step() */
+    int cycle_freed;            /* Objects reclaimed by the running cycle */
+    int last_cycle_freed;       /* Objects reclaimed by the last finished cycle */
+    
+    /* Pause statistics (one pause per gc_step or full collection) */
+    unsigned long slice_count;  /* Pauses recorded */
+    unsigned long pause_histogram[GC_PAUSE_BUCKETS]; /* Bucket i counts pauses < 2^i us */
+    long pause_max_usec;        /* Longest pause */
+    double pause_total_usec;    /* Sum of all pauses */
 };
 
 /* ========== Core GC Functions ========== */
@@ -89,6 +151,7 @@ GC* gc_init(void);
 
 /**
  * Allocate memory tracked by GC
+ * The payload and its GCObject header share one slab block
  * 
  * @param gc Garbage collector instance
  * @param size Size in bytes to allocate
@@ -99,7 +162,8 @@ void* gc_alloc(GC *gc, size_t size, GCObjectType type);
 
 /**
  * Track an existing pointer with GC
- * Used for objects allocated outside GC that need tracking
+ * Used for objects allocated outside GC that need tracking; ptr must
+ * come from malloc(), since the GC frees it with free()
  * 
  * @param gc Garbage collector instance
  * @param ptr Pointer to track
@@ -138,13 +202,58 @@ int gc_collect(GC *gc);
 
 /**
  * Perform full collection including cycle detection
- * More expensive than gc_collect() but handles circular references
+ * With a tracer installed this runs a whole tracing cycle without
+ * pausing, finishing any cycle already in progress. Without one, objects
+ * with ref_count <= 0 are swept.
  * 
  * @param gc Garbage collector instance
  * @return Number of objects freed
  */
 int gc_collect_full(GC *gc);
 
+/* ========== Incremental Collection ========== */
+
+/**
+ * Install the hooks used for tracing collection
+ * Once installed, gc_alloc() no longer collects on its own; the owner
+ * calls gc_step() from a point where no untraced temporaries are live.
+ * 
+ * @param gc Garbage collector instance
+ * @param tracer Hooks to copy, or NULL to return to reference counting
+ */
+void gc_set_tracer(GC *gc, const GCTracer *tracer);
+
+/**
+ * Run one collector slice
+ * Starts a cycle once collect_threshold allocations have happened, then
+ * marks or sweeps until the slice budget is spent. A slice can overrun
+ * by the cost of one object, and the final remark (roots plus whatever
+ * they newly reach) is not split.
+ * 
+ * @param gc Garbage collector instance
+ * @return 1 while a cycle is still in progress, 0 otherwise
+ */
+int gc_step(GC *gc);
+
+/**
+ * Mark a pointer reachable during the mark phase
+ * Called by tracers for children and by write barriers for stored
+ * references. Untracked pointers and types the tracer does not reclaim
+ * are ignored; outside the mark phase this does nothing.
+ * 
+ * @param gc Garbage collector instance
+ * @param ptr Pointer to mark
+ */
+void gc_mark(GC *gc, void *ptr);
+
+/**
+ * Set the pause budget of one gc_step()
+ * 
+ * @param gc Garbage collector instance
+ * @param usec Budget in microseconds
+ */
+void gc_set_slice_budget(GC *gc, long usec);
+
 /**
  * Free all objects and the GC itself
  * 
@@ -235,6 +344,7 @@ void gc_set_collect_threshold(GC *gc, int threshold);
 
 /**
  * Find GCObject wrapper for a pointer
+ * Constant time lookup through the pointer index
  * 
  * @param gc Garbage collector instance
  * @param ptr Pointer to find
@@ -0,0 +1,234 @@
+/**
+ * log.c - Leveled Logging Implementation
+ *
+ * The ring is a bounded multi-producer queue: each slot carries a
+ * sequence number telling producers when it is free and the writer when
+ * it is full, so a producer claims a slot with one compare-and-swap on
+ * the head and publishes it with one store, and never takes a lock. The
+ * writer is the only consumer. It collects what is ready into one buffer,
+ * writes it with a single call, and sleeps briefly when the ring is
+ * empty.
+ */
+
+#include "log.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define LOG_IDLE_NSEC   1000000L            /* Writer's sleep when the ring is empty */
+#define LOG_BATCH_BYTES (64 * 1024)         /* Most the writer puts in one write */
+
+typedef struct {
+    unsigned long seq;          /* Position the slot is free for, or that position + 1 once full */
+    unsigned short length;
+    char text[LOG_RECORD_MAX];
+} LogSlot;
+
+unsigned char log_levels[LOG_CATEGORY_COUNT] = {
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT,
+    LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT, LOG_LEVEL_DEFAULT,
+};
+
+static const char *category_names[LOG_CATEGORY_COUNT] = {
+    "general", "vm", "stack", "object", "param", "efun", "server", "compiler"
+};
+
+static const char *level_names[] = { "off", "error", "warn", "info", "debug" };
+
+static LogSlot ring[LOG_RING_SLOTS];
+static unsigned long ring_head;         /* Next position to claim */
+static unsigned long ring_tail;         /* Next position to write out; writer only */
+static unsigned long dropped;
+
+static pthread_t writer;
+static int writer_running;              /* Producers use the ring while set */
+static int writer_stop;
+
+/* ========== Configuration ========== */
+
+int log_category_by_name(const char *name) {
+    if (!name) return -1;
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++) {
+        if (strcasecmp(name, category_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char* log_category_name(LogCategory category) {
+    return (unsigned)category < LOG_CATEGORY_COUNT ? category_names[category] : "unknown";
+}
+
+int log_level_by_name(const char *name) {
+    if (!name) return -1;
+    for (int i = 0; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcasecmp(name, level_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+int log_set_level(int category, int level) {
+    if (level < LOG_LEVEL_OFF || level > LOG_LEVEL_DEBUG) return -1;
+    if (category == LOG_CATEGORY_COUNT) {
+        int previous = log_levels[LOG_GENERAL];
+        for (int i = 0; i < LOG_CATEGORY_COUNT; i++) log_levels[i] = (unsigned char)level;
+        return previous;
+    }
+    if (category < 0 || category >= LOG_CATEGORY_COUNT) return -1;
+    int previous = log_levels[category];
+    log_levels[category] = (unsigned char)level;
+    return previous;
+}
+
+/* Apply "name=level,name=level" */
+static void log_parse_spec(const char *spec) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *save = NULL;
+    for (char *item = strtok_r(buf, ", ", &save); item; item = strtok_r(NULL, ", ", &save)) {
+        char *eq = strchr(item, '=');
+        if (!eq) {
+            fprintf(stderr, "[Log] WARNING: ignoring '%s' in AMLP_LOG (want category=level)\n", item);
+            continue;
+        }
+        *eq = '\0';
+        int category = strcasecmp(item, "all") == 0 ? LOG_CATEGORY_COUNT : log_category_by_name(item);
+        int level = log_level_by_name(eq + 1);
+        if (category < 0 || level < 0) {
+            fprintf(stderr, "[Log] WARNING: ignoring '%s=%s' in AMLP_LOG\n", item, eq + 1);
+            continue;
+        }
+        log_set_level(category, level);
+    }
+}
+
+void log_init(void) {
+    static int initialized = 0;
+    if (initialized) return;
+    initialized = 1;
+
+    if (getenv("AMLP_DEBUG")) log_set_level(LOG_CATEGORY_COUNT, LOG_LEVEL_DEBUG);
+    const char *spec = getenv("AMLP_LOG");
+    if (spec && *spec) log_parse_spec(spec);
+}
+
+/* ========== Ring ========== */
+
+/* Claim the slot for the next position, or NULL if the ring is full */
+static LogSlot* log_claim(unsigned long *position) {
+    unsigned long pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    for (;;) {
+        LogSlot *slot = &ring[pos & (LOG_RING_SLOTS - 1)];
+        unsigned long seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring_head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *position = pos;
+                return slot;
+            }
+            /* pos now holds the current head; try that */
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Append every ready record to buf; returns the bytes used */
+static size_t log_collect(char *buf, size_t size) {
+    size_t used = 0;
+    for (;;) {
+        LogSlot *slot = &ring[ring_tail & (LOG_RING_SLOTS - 1)];
+        unsigned long seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq != ring_tail + 1) break;
+        if (used + slot->length + 1 > size) break;
+
+        memcpy(buf + used, slot->text, slot->length);
+        used += slot->length;
+        buf[used++] = '\n';
+        __atomic_store_n(&slot->seq, ring_tail + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        ring_tail++;
+    }
+    return used;
+}
+
+static size_t log_drain(void) {
+    static char batch[LOG_BATCH_BYTES];
+    size_t total = 0;
+    size_t n;
+    while ((n = log_collect(batch, sizeof(batch))) > 0) {
+        fwrite(batch, 1, n, stderr);
+        total += n;
+    }
+    if (total > 0) fflush(stderr);
+    return total;
+}
+
+static void* log_writer_main(void *arg) {
+    (void)arg;
+    struct timespec idle = { 0, LOG_IDLE_NSEC };
+    for (;;) {
+        if (log_drain() > 0) continue;
+        if (__atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE)) break;
+        nanosleep(&idle, NULL);
+    }
+    return NULL;
+}
+
+/* ========== Writing ========== */
+
+void log_write(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+
+    if (__atomic_load_n(&writer_running, __ATOMIC_ACQUIRE)) {
+        unsigned long pos;
+        LogSlot *slot = log_claim(&pos);
+        if (slot) {
+            int n = vsnprintf(slot->text, sizeof(slot->text), fmt, ap);
+            if (n < 0) n = 0;
+            if (n >= (int)sizeof(slot->text)) n = (int)sizeof(slot->text) - 1;
+            slot->length = (unsigned short)n;
+            __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+        } else {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        vfprintf(stderr, fmt, ap);
+        fputc('\n', stderr);
+    }
+    va_end(ap);
+}
+
+int log_start_writer(void) {
+    if (writer_running) return 0;
+    for (unsigned long i = 0; i < LOG_RING_SLOTS; i++) ring[i].seq = i;
+    ring_head = ring_tail = 0;
+    writer_stop = 0;
+    if (pthread_create(&writer, NULL, log_writer_main, NULL) != 0) {
+        fprintf(stderr, "[Log] ERROR: Failed to start the log writer; logging directly\n");
+        return -1;
+    }
+    __atomic_store_n(&writer_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!writer_running) return;
+    __atomic_store_n(&writer_running, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&writer_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+
+    /* Anything published while the writer was stopping */
+    log_drain();
+    unsigned long lost = log_dropped();
+    if (lost > 0) fprintf(stderr, "[Log] %lu message(s) dropped with the log queue full\n", lost);
+}
+
+unsigned long log_dropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
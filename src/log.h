@@ -0,0 +1,121 @@
+/**
+ * log.h - Leveled Logging with an Asynchronous Sink
+ *
+ * Every message belongs to a category with its own level. Levels are
+ * read from the environment once, by log_init(), and can be changed at
+ * run time with log_set_level() (the set_log_level() efun). The logging
+ * macros test the level with a single load before evaluating any
+ * argument, so a disabled message costs a compare and a branch.
+ *
+ * Once log_start_writer() has run, enabled messages are formatted
+ * straight into a slot of a lock-free ring and written to stderr by a
+ * background thread, so the game loop never waits on the terminal. When
+ * the ring is full a message is dropped and counted rather than waited
+ * for. Before the writer starts, and after log_shutdown(), messages are
+ * written directly, as they always were.
+ *
+ * Environment:
+ *   AMLP_DEBUG=1                 every category at LOG_LEVEL_DEBUG
+ *   AMLP_LOG=vm=debug,efun=warn  per category; "all" names every one
+ */
+
+#ifndef AMLP_LOG_H
+#define AMLP_LOG_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/* ========== Constants ========== */
+
+#define LOG_RING_SLOTS  1024    /* Power of two */
+#define LOG_RECORD_MAX  240     /* Longer messages are truncated */
+
+/* Levels; a category shows messages at or below its level */
+#define LOG_LEVEL_OFF   0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_INFO
+
+typedef enum {
+    LOG_GENERAL,
+    LOG_VM,
+    LOG_STACK,
+    LOG_OBJECT,
+    LOG_PARAM,
+    LOG_EFUN,
+    LOG_SERVER,
+    LOG_COMPILER,
+    LOG_CATEGORY_COUNT
+} LogCategory;
+
+/* Current level of each category; read by the macros below */
+extern unsigned char log_levels[LOG_CATEGORY_COUNT];
+
+/* ========== Macros ==========
+ * tag is a string literal printed before the message, e.g. "[VM]". */
+
+#define LOG_ENABLED(category, level) (log_levels[(category)] >= (level))
+
+#define LOG_AT(category, level, tag, fmt, ...) \
+    do { \
+        if (LOG_ENABLED(category, level)) { \
+            log_write(tag " " fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+/* ========== Functions ========== */
+
+/**
+ * Read AMLP_DEBUG and AMLP_LOG; only the first call does anything
+ */
+void log_init(void);
+
+/**
+ * Format and emit a message; use the macros, which check the level first
+ */
+void log_write(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Start the background writer
+ *
+ * @return 0 on success, -1 if the thread could not be started
+ */
+int log_start_writer(void);
+
+/**
+ * Write out everything queued, stop the writer and go back to writing
+ * directly
+ */
+void log_shutdown(void);
+
+/**
+ * Messages dropped because the ring was full
+ */
+unsigned long log_dropped(void);
+
+/**
+ * Category for a name such as "vm", or -1 if there is none
+ */
+int log_category_by_name(const char *name);
+
+/**
+ * Name of a category, e.g. "vm"
+ */
+const char* log_category_name(LogCategory category);
+
+/**
+ * Level for a name such as "debug", or -1 if there is none
+ */
+int log_level_by_name(const char *name);
+
+/**
+ * Change a category's level; LOG_CATEGORY_COUNT changes all of them
+ *
+ * @return Previous level (of LOG_GENERAL for all), or -1 if invalid
+ */
+int log_set_level(int category, int level);
+
+#endif /* AMLP_LOG_H */
@@ -2,14 +2,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-static unsigned int map_hash(const char *key, size_t capacity) {
-    unsigned int hash = 0;
-    for (const char *p = key; *p; ++p) {
-        hash = ((hash << 5) + hash) ^ (unsigned char)(*p);
-    }
-    return hash % (capacity ? capacity : 1);
-}
-
 static void* map_alloc(GC *gc, size_t size, GCObjectType type) {
     if (gc) return gc_alloc(gc, size, type);
     return malloc(size);
@@ -24,98 +16,398 @@ static void map_release(GC *gc, void *ptr) {
     }
 }
 
+/* ========== Keys ========== */
+
+/* Spread the low bits the index uses (murmur3's finaliser) */
+static unsigned int map_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (unsigned int)h;
+}
+
+unsigned int mapping_hash_key(VMValue key) {
+    switch (key.type) {
+        case VALUE_STRING:
+            return key.data.string_value ? map_mix(vm_string_hash(key.data.string_value)) : 0;
+        case VALUE_INT:
+            return map_mix((uint64_t)key.data.int_value);
+        case VALUE_FLOAT: {
+            double d = key.data.float_value == 0.0 ? 0.0 : key.data.float_value;
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            return map_mix(bits ^ 0x5bd1e995ULL);
+        }
+        case VALUE_NULL:
+            return 0;
+        default:
+            return map_mix((uint64_t)(uintptr_t)key.data.object_value >> 4);
+    }
+}
+
+/* Hashes already agree; interned strings match by pointer alone */
+static int map_key_equal(VMValue stored, VMValue probe, int interned) {
+    if (stored.type != probe.type) return 0;
+
+    switch (stored.type) {
+        case VALUE_STRING:
+            if (stored.data.string_value == probe.data.string_value) return 1;
+            return !interned && probe.data.string_value &&
+                   strcmp(stored.data.string_value, probe.data.string_value) == 0;
+        case VALUE_INT:
+            return stored.data.int_value == probe.data.int_value;
+        case VALUE_FLOAT:
+            return stored.data.float_value == probe.data.float_value;
+        case VALUE_NULL:
+            return 1;
+        default:
+            return stored.data.object_value == probe.data.object_value;
+    }
+}
+
+/* ========== Index ========== */
+
+static size_t map_round_up(size_t n) {
+    size_t size = 8;
+    while (size < n) size <<= 1;
+    return size;
+}
+
+/* How far the entry in slot sits from the slot its hash prefers */
+static size_t map_distance(const mapping_t *map, size_t slot) {
+    size_t mask = map->bucket_count - 1;
+    unsigned int hash = map->entries[map->index[slot] - 1].hash;
+    return (slot - (hash & mask)) & mask;
+}
+
+/* Add entry number n to the index, displacing entries nearer home */
+static void map_index_insert(mapping_t *map, uint32_t n) {
+    size_t mask = map->bucket_count - 1;
+    size_t slot = map->entries[n - 1].hash & mask;
+    size_t dist = 0;
+
+    while (map->index[slot]) {
+        size_t occupant_dist = map_distance(map, slot);
+        if (occupant_dist < dist) {
+            uint32_t carried = map->index[slot];
+            map->index[slot] = n;
+            n = carried;
+            dist = occupant_dist;
+        }
+        slot = (slot + 1) & mask;
+        dist++;
+    }
+    map->index[slot] = n;
+}
+
+/* Index slot holding key, or -1. A probe stops at the first entry nearer
+ * its home than the probe has come, since key would have displaced it. */
+static long map_find_slot(const mapping_t *map, VMValue key, unsigned int hash, int interned) {
+    if (!map->index) return -1;
+
+    size_t mask = map->bucket_count - 1;
+    size_t slot = hash & mask;
+    for (size_t dist = 0; map->index[slot]; dist++) {
+        const mapping_entry_t *entry = &map->entries[map->index[slot] - 1];
+        if (entry->hash == hash && map_key_equal(entry->key, key, interned)) {
+            return (long)slot;
+        }
+        if (map_distance(map, slot) < dist) break;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/* Close the gap left at slot by shifting the following run back */
+static void map_index_remove(mapping_t *map, size_t slot) {
+    size_t mask = map->bucket_count - 1;
+    size_t next = (slot + 1) & mask;
+    while (map->index[next] && map_distance(map, next) > 0) {
+        map->index[slot] = map->index[next];
+        slot = next;
+        next = (next + 1) & mask;
+    }
+    map->index[slot] = 0;
+}
+
+/*
+ * Drop deleted entries, give the index bucket_count slots and the entry
+ * array room for entry_capacity entries, then rebuild the index
+ */
+static int map_rebuild(mapping_t *map, size_t bucket_count, size_t entry_capacity) {
+    if (entry_capacity < map->size) entry_capacity = map->size;
+
+    uint32_t *index = map->index;
+    if (bucket_count != map->bucket_count || !index) {
+        index = (uint32_t *)map_alloc(map->gc, sizeof(uint32_t) * bucket_count, GC_TYPE_GENERIC);
+        if (!index) return -1;
+    }
+
+    mapping_entry_t *entries = map->entries;
+    if (entry_capacity != map->entry_capacity) {
+        entries = (mapping_entry_t *)map_alloc(map->gc, sizeof(mapping_entry_t) * entry_capacity,
+                                               GC_TYPE_GENERIC);
+        if (!entries) {
+            if (index != map->index) map_release(map->gc, index);
+            return -1;
+        }
+    }
+
+    /* Compact in insertion order; memmove handles the in-place case */
+    size_t live = 0;
+    for (size_t i = 0; i < map->entry_count; i++) {
+        if (map->entries[i].key.type == VALUE_UNINITIALIZED) continue;
+        if (entries != map->entries || live != i) {
+            memmove(&entries[live], &map->entries[i], sizeof(mapping_entry_t));
+        }
+        live++;
+    }
+
+    if (entries != map->entries) map_release(map->gc, map->entries);
+    if (index != map->index) map_release(map->gc, map->index);
+    map->entries = entries;
+    map->entry_capacity = entry_capacity;
+    map->entry_count = live;
+    map->index = index;
+    map->bucket_count = bucket_count;
+
+    memset(map->index, 0, sizeof(uint32_t) * bucket_count);
+    for (size_t i = 0; i < live; i++) {
+        map_index_insert(map, (uint32_t)(i + 1));
+    }
+    return 0;
+}
+
+/* Make room for one more entry */
+static int map_reserve(mapping_t *map) {
+    if ((map->size + 1) * MAPPING_MAX_LOAD_DEN > map->bucket_count * MAPPING_MAX_LOAD_NUM) {
+        size_t buckets = map->bucket_count * 2;
+        return map_rebuild(map, buckets, buckets * MAPPING_MAX_LOAD_NUM / MAPPING_MAX_LOAD_DEN);
+    }
+    if (map->entry_count < map->entry_capacity) return 0;
+
+    /* Full of deleted entries: compact in place; otherwise grow */
+    if (map->entry_count - map->size >= map->entry_count / 2 && map->entry_count > 0) {
+        return map_rebuild(map, map->bucket_count, map->entry_capacity);
+    }
+    size_t capacity = map->entry_capacity ? map->entry_capacity * 2 : 4;
+    size_t limit = map->bucket_count * MAPPING_MAX_LOAD_NUM / MAPPING_MAX_LOAD_DEN;
+    return map_rebuild(map, map->bucket_count, capacity < limit ? capacity : limit);
+}
+
+/* ========== Sharing ========== */
+
+static int map_is_container(VMValue value) {
+    return value.type == VALUE_ARRAY || value.type == VALUE_MAPPING;
+}
+
+/* Give map entries and an index of its own before a write. The copies
+ * keep the shared layout, so index slots found beforehand stay valid. */
+static int map_unshare(mapping_t *map) {
+    if (!map->shares) return 0;
+
+    if (*map->shares == 1) {
+        map_release(map->gc, map->shares);
+        map->shares = NULL;
+        return 0;
+    }
+
+    uint32_t *index = (uint32_t *)map_alloc(map->gc, sizeof(uint32_t) * map->bucket_count,
+                                            GC_TYPE_GENERIC);
+    if (!index) return -1;
+    mapping_entry_t *entries = NULL;
+    if (map->entry_capacity > 0) {
+        entries = (mapping_entry_t *)map_alloc(map->gc, sizeof(mapping_entry_t) * map->entry_capacity,
+                                               GC_TYPE_GENERIC);
+        if (!entries) {
+            map_release(map->gc, index);
+            return -1;
+        }
+    }
+
+    memcpy(index, map->index, sizeof(uint32_t) * map->bucket_count);
+    for (size_t i = 0; i < map->entry_count; i++) {
+        entries[i] = map->entries[i];
+        if (entries[i].key.type == VALUE_UNINITIALIZED) continue;
+        vm_value_addref(&entries[i].key);
+        vm_value_addref(&entries[i].value);
+    }
+
+    (*map->shares)--;
+    map->shares = NULL;
+    map->index = index;
+    map->entries = entries;
+    return 0;
+}
+
+/* ========== Mapping ========== */
+
 mapping_t* mapping_new(GC *gc, size_t buckets) {
-    size_t bucket_count = buckets > 0 ? buckets : 16;
+    size_t bucket_count = map_round_up(buckets > 0 ? buckets : 16);
     mapping_t *map = (mapping_t *)map_alloc(gc, sizeof(mapping_t), GC_TYPE_MAPPING);
     if (!map) return NULL;
 
     map->gc = gc;
+    map->entries = NULL;
+    map->entry_count = 0;
+    map->entry_capacity = 0;
     map->bucket_count = bucket_count;
     map->size = 0;
-    map->buckets = (mapping_entry_t **)map_alloc(gc, sizeof(mapping_entry_t *) * bucket_count, GC_TYPE_GENERIC);
-    if (!map->buckets) {
+    map->shares = NULL;
+    map->containers = 0;
+    map->index = (uint32_t *)map_alloc(gc, sizeof(uint32_t) * bucket_count, GC_TYPE_GENERIC);
+    if (!map->index) {
         map_release(gc, map);
         return NULL;
     }
-    for (size_t i = 0; i < bucket_count; i++) {
-        map->buckets[i] = NULL;
-    }
+    memset(map->index, 0, sizeof(uint32_t) * bucket_count);
 
     return map;
 }
 
-mapping_entry_t* mapping_set(mapping_t *map, const char *key, VMValue value) {
-    if (!map || !key) return NULL;
-
-    unsigned int idx = map_hash(key, map->bucket_count);
-    mapping_entry_t *entry = map->buckets[idx];
-
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            vm_value_free(&entry->value);
-            entry->value = value;
-            return entry;
-        }
-        entry = entry->next;
+/* Store value under key, taking ownership of one reference to a string
+ * key, which must be interned */
+static mapping_entry_t* map_put(mapping_t *map, VMValue key, unsigned int hash, VMValue value) {
+    long slot = map_find_slot(map, key, hash, 1);
+    if (map_unshare(map) != 0) {
+        vm_value_release(&key);
+        return NULL;
+    }
+    if (slot >= 0) {
+        mapping_entry_t *entry = &map->entries[map->index[slot] - 1];
+        vm_value_release(&key);
+        if (map_is_container(entry->value)) map->containers--;
+        /* A replaced container is left to the collector */
+        vm_value_release(&entry->value);
+        vm_value_write_barrier(value);
+        entry->value = value;
+        if (map_is_container(value)) map->containers++;
+        return entry;
     }
 
-    entry = (mapping_entry_t *)map_alloc(map->gc, sizeof(mapping_entry_t), GC_TYPE_GENERIC);
-    if (!entry) return NULL;
-    entry->key = (char *)malloc(strlen(key) + 1);
-    if (!entry->key) {
-        map_release(map->gc, entry);
+    if (map_reserve(map) != 0) {
+        vm_value_release(&key);
         return NULL;
     }
-    strcpy(entry->key, key);
+    mapping_entry_t *entry = &map->entries[map->entry_count++];
+    entry->key = key;
+    entry->hash = hash;
+    vm_value_write_barrier(key);
+    vm_value_write_barrier(value);
     entry->value = value;
-    entry->next = map->buckets[idx];
-    map->buckets[idx] = entry;
+    map_index_insert(map, (uint32_t)map->entry_count);
     map->size++;
+    map->containers += map_is_container(key) + map_is_container(value);
     return entry;
 }
 
+static int map_unlink(mapping_t *map, size_t slot) {
+    if (map_unshare(map) != 0) return -1;
+
+    mapping_entry_t *entry = &map->entries[map->index[slot] - 1];
+    map->containers -= map_is_container(entry->key) + map_is_container(entry->value);
+    map_index_remove(map, slot);
+    vm_value_release(&entry->value);
+    vm_value_release(&entry->key);
+    entry->key.type = VALUE_UNINITIALIZED;
+    map->size--;
+
+    /* Trailing deletions can be reused straight away */
+    while (map->entry_count > 0 &&
+           map->entries[map->entry_count - 1].key.type == VALUE_UNINITIALIZED) {
+        map->entry_count--;
+    }
+    return 0;
+}
+
+mapping_entry_t* mapping_set(mapping_t *map, const char *key, VMValue value) {
+    if (!map || !key) return NULL;
+
+    VMValue k = vm_value_create_interned(key);
+    if (!k.data.string_value) return NULL;
+    return map_put(map, k, mapping_hash_key(k), value);
+}
+
 VMValue mapping_get(const mapping_t *map, const char *key) {
     if (!map || !key) return vm_value_create_null();
-    unsigned int idx = map_hash(key, map->bucket_count);
-    mapping_entry_t *entry = map->buckets[idx];
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            return entry->value;
-        }
-        entry = entry->next;
-    }
-    return vm_value_create_null();
+
+    VMValue k;
+    k.type = VALUE_STRING;
+    k.data.string_value = (char *)key;
+    long slot = map_find_slot(map, k, map_mix(vm_hash_cstring(key)), 0);
+    return slot >= 0 ? map->entries[map->index[slot] - 1].value : vm_value_create_null();
 }
 
 int mapping_delete(mapping_t *map, const char *key) {
     if (!map || !key) return -1;
-    unsigned int idx = map_hash(key, map->bucket_count);
-    mapping_entry_t **cursor = &map->buckets[idx];
-    while (*cursor) {
-        mapping_entry_t *entry = *cursor;
-        if (strcmp(entry->key, key) == 0) {
-            *cursor = entry->next;
-            vm_value_free(&entry->value);
-            if (entry->key) free(entry->key);
-            map_release(map->gc, entry);
-            map->size--;
-            return 0;
+
+    VMValue k;
+    k.type = VALUE_STRING;
+    k.data.string_value = (char *)key;
+    long slot = map_find_slot(map, k, map_mix(vm_hash_cstring(key)), 0);
+    if (slot < 0) return -1;
+    return map_unlink(map, (size_t)slot);
+}
+
+VMValue mapping_lookup(const mapping_t *map, VMValue key) {
+    if (!map || key.type == VALUE_UNINITIALIZED ||
+        (key.type == VALUE_STRING && !key.data.string_value)) {
+        return vm_value_create_null();
+    }
+
+    int interned = key.type == VALUE_STRING && vm_string_is_interned(key.data.string_value);
+    long slot = map_find_slot(map, key, mapping_hash_key(key), interned);
+    return slot >= 0 ? map->entries[map->index[slot] - 1].value : vm_value_create_null();
+}
+
+mapping_entry_t* mapping_store(mapping_t *map, VMValue key, VMValue value) {
+    if (!map || key.type == VALUE_UNINITIALIZED) return NULL;
+
+    if (key.type == VALUE_STRING) {
+        if (!key.data.string_value) return NULL;
+        vm_value_addref(&key);
+        vm_value_intern(&key);
+        if (!vm_string_is_interned(key.data.string_value)) {
+            vm_value_release(&key);
+            return NULL;
         }
-        cursor = &(*cursor)->next;
     }
-    return -1;
+    return map_put(map, key, mapping_hash_key(key), value);
+}
+
+int mapping_remove(mapping_t *map, VMValue key) {
+    if (!map || key.type == VALUE_UNINITIALIZED ||
+        (key.type == VALUE_STRING && !key.data.string_value)) {
+        return -1;
+    }
+
+    int interned = key.type == VALUE_STRING && vm_string_is_interned(key.data.string_value);
+    long slot = map_find_slot(map, key, mapping_hash_key(key), interned);
+    if (slot < 0) return -1;
+    return map_unlink(map, (size_t)slot);
+}
+
+mapping_entry_t* mapping_next(const mapping_t *map, size_t *cursor) {
+    if (!map || !cursor) return NULL;
+
+    while (*cursor < map->entry_count) {
+        mapping_entry_t *entry = &map->entries[(*cursor)++];
+        if (entry->key.type != VALUE_UNINITIALIZED) return entry;
+    }
+    return NULL;
 }
 
 array_t* mapping_keys(const mapping_t *map) {
     if (!map) return NULL;
     array_t *arr = array_new(map->gc, map->size);
     if (!arr) return NULL;
-    for (size_t i = 0; i < map->bucket_count; i++) {
-        mapping_entry_t *entry = map->buckets[i];
-        while (entry) {
-            array_push(arr, vm_value_create_string(entry->key));
-            entry = entry->next;
-        }
+    size_t cursor = 0;
+    mapping_entry_t *entry;
+    while ((entry = mapping_next(map, &cursor)) != NULL) {
+        /* String keys are interned; share them rather than copy */
+        VMValue key = entry->key;
+        vm_value_addref(&key);
+        array_push(arr, key);
     }
     return arr;
 }
@@ -124,12 +416,10 @@ array_t* mapping_values(const mapping_t *map) {
     if (!map) return NULL;
     array_t *arr = array_new(map->gc, map->size);
     if (!arr) return NULL;
-    for (size_t i = 0; i < map->bucket_count; i++) {
-        mapping_entry_t *entry = map->buckets[i];
-        while (entry) {
-            array_push(arr, vm_value_clone(entry->value));
-            entry = entry->next;
-        }
+    size_t cursor = 0;
+    mapping_entry_t *entry;
+    while ((entry = mapping_next(map, &cursor)) != NULL) {
+        array_push(arr, vm_value_clone(entry->value));
     }
     return arr;
 }
@@ -138,35 +428,73 @@ size_t mapping_size(const mapping_t *map) {
     return map ? map->size : 0;
 }
 
-mapping_t* mapping_clone(const mapping_t *map, GC *gc) {
+mapping_t* mapping_clone(mapping_t *map, GC *gc) {
     if (!map) return NULL;
-    mapping_t *copy = mapping_new(gc ? gc : map->gc, map->bucket_count);
-    if (!copy) return NULL;
-    for (size_t i = 0; i < map->bucket_count; i++) {
-        mapping_entry_t *entry = map->buckets[i];
-        while (entry) {
-            mapping_set(copy, entry->key, vm_value_clone(entry->value));
-            entry = entry->next;
+    if (!gc) gc = map->gc;
+
+    /* Without nested arrays or mappings there is nothing to copy deeply,
+     * so the copy can share map's entries until one of them is written */
+    if (map->containers == 0 && gc == map->gc) {
+        if (!map->shares) {
+            map->shares = (size_t *)map_alloc(gc, sizeof(size_t), GC_TYPE_GENERIC);
+            if (!map->shares) return NULL;
+            *map->shares = 1;
         }
+        mapping_t *copy = (mapping_t *)map_alloc(gc, sizeof(mapping_t), GC_TYPE_MAPPING);
+        if (!copy) return NULL;
+        *copy = *map;
+        (*map->shares)++;
+        return copy;
+    }
+
+    mapping_t *copy = mapping_new(gc,
+                                  map->size * MAPPING_MAX_LOAD_DEN / MAPPING_MAX_LOAD_NUM + 1);
+    if (!copy) return NULL;
+    size_t cursor = 0;
+    mapping_entry_t *entry;
+    while ((entry = mapping_next(map, &cursor)) != NULL) {
+        VMValue key = entry->key;
+        vm_value_addref(&key);
+        map_put(copy, key, entry->hash, vm_value_clone(entry->value));
     }
     return copy;
 }
 
-void mapping_free(mapping_t *map) {
+/* Free the arrays and map; deep frees values, shallow only strings */
+static void map_destroy(mapping_t *map, int deep) {
     if (!map) return;
-    if (map->buckets) {
-        for (size_t i = 0; i < map->bucket_count; i++) {
-            mapping_entry_t *entry = map->buckets[i];
-            while (entry) {
-                mapping_entry_t *next = entry->next;
+    if (map->shares) {
+        /* Another mapping still uses the entries */
+        if (--*map->shares > 0) {
+            map_release(map->gc, map);
+            return;
+        }
+        map_release(map->gc, map->shares);
+        map->shares = NULL;
+    }
+    if (map->entries) {
+        for (size_t i = 0; i < map->entry_count; i++) {
+            mapping_entry_t *entry = &map->entries[i];
+            if (entry->key.type == VALUE_UNINITIALIZED) continue;
+            if (deep) {
                 vm_value_free(&entry->value);
-                if (entry->key) free(entry->key);
-                map_release(map->gc, entry);
-                entry = next;
+            } else if (entry->value.type == VALUE_STRING) {
+                vm_value_release(&entry->value);
             }
+            vm_value_release(&entry->key);
         }
-        map_release(map->gc, map->buckets);
-        map->buckets = NULL;
+        map_release(map->gc, map->entries);
+        map->entries = NULL;
     }
+    map_release(map->gc, map->index);
+    map->index = NULL;
     map_release(map->gc, map);
 }
+
+void mapping_free(mapping_t *map) {
+    map_destroy(map, 1);
+}
+
+void mapping_free_shallow(mapping_t *map) {
+    map_destroy(map, 0);
+}
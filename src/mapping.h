@@ -2,31 +2,87 @@
 #define MAPPING_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include "gc.h"
 #include "vm.h"
 #include "array.h"
 
+/*
+ * A mapping keeps its entries in a dense array in insertion order, and
+ * finds them through an open-addressing index of entry numbers probed
+ * Robin Hood style. Each entry caches its key's hash, so growing the
+ * index never rehashes a key and a probe compares keys only when the
+ * hashes agree. Iteration walks the entry array, so it follows
+ * insertion order. A deleted entry is only marked; its slot is
+ * reclaimed when the array is next compacted.
+ *
+ * Keys may be any value. Strings compare by contents (they are stored
+ * interned, so a stored key matches an interned probe by pointer),
+ * ints and floats by value, and objects, arrays, mappings and functions
+ * by identity. String keys hold a reference; array and mapping keys are
+ * kept alive by the collector, which traces keys as well as values.
+ *
+ * A clone of a mapping without nested arrays or mappings shares its
+ * entries and index until either mapping is written. The write copies
+ * them, keeping their layout, so a probe made before it stays valid.
+ */
+
 typedef struct mapping_entry_t {
-    char *key;
+    VMValue key;                /* VALUE_UNINITIALIZED once deleted */
+    unsigned int hash;          /* mapping_hash_key(key) */
     VMValue value;
-    struct mapping_entry_t *next;
 } mapping_entry_t;
 
 typedef struct mapping_t {
     GC *gc;
-    mapping_entry_t **buckets;
-    size_t bucket_count;
-    size_t size;
+    mapping_entry_t *entries;   /* Insertion order, deleted ones included */
+    size_t entry_count;         /* Entries used, live or deleted */
+    size_t entry_capacity;
+    uint32_t *index;            /* Entry number + 1 per slot; 0 is empty */
+    size_t bucket_count;        /* Index slots, a power of two */
+    size_t size;                /* Live entries */
+    size_t *shares;             /* Mappings sharing entries and index; NULL if exclusive */
+    size_t containers;          /* Keys and values that are arrays or mappings */
 } mapping_t;
 
+/* The index grows past this many live entries per slot */
+#define MAPPING_MAX_LOAD_NUM 3
+#define MAPPING_MAX_LOAD_DEN 4
+
+/* buckets is a size hint: the index starts with at least that many slots */
 mapping_t* mapping_new(GC *gc, size_t buckets);
+
+/* String-key convenience wrappers */
 mapping_entry_t* mapping_set(mapping_t *map, const char *key, VMValue value);
 VMValue mapping_get(const mapping_t *map, const char *key);
 int mapping_delete(mapping_t *map, const char *key);
+
+/* Lookup, store and removal with any key. Storing takes ownership of
+ * value, and keeps its own reference to a string key. The returned entry
+ * is valid until the next store or removal. */
+VMValue mapping_lookup(const mapping_t *map, VMValue key);
+mapping_entry_t* mapping_store(mapping_t *map, VMValue key, VMValue value);
+int mapping_remove(mapping_t *map, VMValue key);
+
+/* Next live entry at or after *cursor (start at 0), in insertion order,
+ * advancing *cursor past it; NULL at the end */
+mapping_entry_t* mapping_next(const mapping_t *map, size_t *cursor);
+
+/* Hash used for a key; equal keys hash alike */
+unsigned int mapping_hash_key(VMValue key);
+
 array_t* mapping_keys(const mapping_t *map);
 array_t* mapping_values(const mapping_t *map);
 size_t mapping_size(const mapping_t *map);
-mapping_t* mapping_clone(const mapping_t *map, GC *gc);
+
+/* Deep copy. O(1) when map holds no arrays or mappings: the copy shares
+ * map's entries until either is written */
+mapping_t* mapping_clone(mapping_t *map, GC *gc);
+
 void mapping_free(mapping_t *map);
 
+/* Free map, its entries and their strings, leaving nested arrays and
+ * mappings to the collector */
+void mapping_free_shallow(mapping_t *map);
+
 #endif /* MAPPING_H */
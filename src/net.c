@@ -0,0 +1,151 @@
+/**
+ * net.c - Socket Reactor Implementation
+ */
+
+#define _GNU_SOURCE  /* for accept4() */
+
+#include "net.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static uint32_t net_epoll_mask(unsigned int events) {
+    uint32_t mask = 0;
+    if (events & NET_EVENT_READ) mask |= EPOLLIN | EPOLLRDHUP;
+    if (events & NET_EVENT_WRITE) mask |= EPOLLOUT;
+    if (events & NET_EVENT_EDGE) mask |= EPOLLET;
+    return mask;
+}
+
+int net_reactor_init(NetReactor *reactor) {
+    if (!reactor) return -1;
+
+    memset(reactor, 0, sizeof(*reactor));
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epoll_fd < 0) {
+        fprintf(stderr, "[Net] ERROR: epoll_create1() failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void net_reactor_close(NetReactor *reactor) {
+    if (!reactor || reactor->epoll_fd < 0) return;
+    close(reactor->epoll_fd);
+    reactor->epoll_fd = -1;
+    reactor->watched = 0;
+}
+
+int net_reactor_add(NetReactor *reactor, int fd, unsigned int events, void *data) {
+    if (!reactor || fd < 0) return -1;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = net_epoll_mask(events);
+    ev.data.ptr = data;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        fprintf(stderr, "[Net] ERROR: epoll_ctl(ADD, %d) failed: %s\n", fd, strerror(errno));
+        return -1;
+    }
+    reactor->watched++;
+    return 0;
+}
+
+int net_reactor_modify(NetReactor *reactor, int fd, unsigned int events, void *data) {
+    if (!reactor || fd < 0) return -1;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = net_epoll_mask(events);
+    ev.data.ptr = data;
+    return epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+int net_reactor_remove(NetReactor *reactor, int fd) {
+    if (!reactor || fd < 0) return -1;
+
+    /* Pre-2.6.9 kernels require a non-NULL event even for DEL */
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, fd, &ev) < 0) return -1;
+    reactor->watched--;
+    return 0;
+}
+
+int net_reactor_wait(NetReactor *reactor, int timeout_ms) {
+    if (!reactor) return -1;
+
+    struct epoll_event ready[NET_MAX_EVENTS];
+    int n = epoll_wait(reactor->epoll_fd, ready, NET_MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR) return 0;
+        fprintf(stderr, "[Net] ERROR: epoll_wait() failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        unsigned int events = 0;
+        if (ready[i].events & EPOLLIN) events |= NET_EVENT_READ;
+        if (ready[i].events & EPOLLOUT) events |= NET_EVENT_WRITE;
+        if (ready[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) events |= NET_EVENT_HANGUP;
+        reactor->events[i].data = ready[i].data.ptr;
+        reactor->events[i].events = events;
+    }
+    return n;
+}
+
+int net_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int net_listen(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[Net] ERROR: socket() failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "[Net] ERROR: bind() on port %d failed: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "[Net] ERROR: listen() on port %d failed: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int net_accept(int listen_fd, char *ip, size_t ip_size) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    int fd = accept4(listen_fd, (struct sockaddr*)&addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return -1;
+
+    if (ip && ip_size > 0) {
+        if (!inet_ntop(AF_INET, &addr.sin_addr, ip, (socklen_t)ip_size)) ip[0] = '\0';
+    }
+    return fd;
+}
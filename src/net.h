@@ -0,0 +1,116 @@
+/**
+ * net.h - Socket Reactor
+ *
+ * Thin layer over epoll for the driver's main loop. Registrations carry
+ * an opaque pointer that comes back with each event, so dispatch does
+ * not need an fd-to-session lookup. Connections are registered
+ * edge-triggered for both directions: an event means "something changed",
+ * and the handler must read (or write) until the call would block.
+ *
+ * Sockets handed to the reactor should be nonblocking; net_accept()
+ * returns them that way.
+ */
+
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========== Constants ========== */
+
+#define NET_MAX_EVENTS 256          /* Events collected per wait */
+
+#define NET_EVENT_READ   0x01
+#define NET_EVENT_WRITE  0x02
+#define NET_EVENT_HANGUP 0x04       /* Peer closed or socket error */
+#define NET_EVENT_EDGE   0x08       /* Registration flag: edge-triggered */
+
+/* ========== Types ========== */
+
+typedef struct {
+    void *data;                 /* Pointer given at registration */
+    unsigned int events;        /* NET_EVENT_* bits */
+} NetEvent;
+
+typedef struct {
+    int epoll_fd;
+    int watched;                /* Registered descriptors */
+    NetEvent events[NET_MAX_EVENTS];
+} NetReactor;
+
+/* ========== Reactor ========== */
+
+/**
+ * Create the epoll instance
+ *
+ * @return 0 on success, -1 on failure
+ */
+int net_reactor_init(NetReactor *reactor);
+
+/**
+ * Close the epoll instance; registered descriptors stay open
+ */
+void net_reactor_close(NetReactor *reactor);
+
+/**
+ * Watch a descriptor
+ *
+ * @param reactor Reactor
+ * @param fd Descriptor
+ * @param events NET_EVENT_READ / NET_EVENT_WRITE, plus NET_EVENT_EDGE
+ * @param data Returned with every event for fd
+ * @return 0 on success, -1 on failure
+ */
+int net_reactor_add(NetReactor *reactor, int fd, unsigned int events, void *data);
+
+/**
+ * Change a registration. For an edge-triggered descriptor this also
+ * re-arms it: an event is reported again if it is still ready.
+ */
+int net_reactor_modify(NetReactor *reactor, int fd, unsigned int events, void *data);
+
+/**
+ * Stop watching a descriptor. Must be called before closing it.
+ */
+int net_reactor_remove(NetReactor *reactor, int fd);
+
+/**
+ * Wait for events
+ *
+ * @param reactor Reactor
+ * @param timeout_ms Milliseconds to wait, 0 to poll, -1 for no limit
+ * @return Number of entries filled in reactor->events, 0 on timeout or
+ *         signal, -1 on failure
+ */
+int net_reactor_wait(NetReactor *reactor, int timeout_ms);
+
+/* ========== Sockets ========== */
+
+/**
+ * Put a descriptor in nonblocking mode
+ *
+ * @return 0 on success, -1 on failure
+ */
+int net_set_nonblocking(int fd);
+
+/**
+ * Create a nonblocking TCP listener on all interfaces
+ *
+ * @param port Port to bind
+ * @return Listening descriptor, or -1 on failure
+ */
+int net_listen(int port);
+
+/**
+ * Accept one pending connection as a nonblocking socket
+ *
+ * @param listen_fd Listening descriptor
+ * @param ip Receives the peer address as text (may be NULL)
+ * @param ip_size Size of ip
+ * @return Connected descriptor, or -1 with errno set (EAGAIN when the
+ *         backlog is empty)
+ */
+int net_accept(int listen_fd, char *ip, size_t ip_size);
+
+#endif /* NET_H */
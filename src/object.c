@@ -8,7 +8,10 @@
  */
 
 #include "object.h"
+#include "object_program.h"
 #include "vm.h"
+#include "scheduler.h"
+#include "command_table.h"
 #include "debug.h"
 #include <stdlib.h>
 #include <string.h>
@@ -17,37 +20,197 @@
 /* ========== Property Hash Functions ========== */
 
 /**
- * Hash function for property names
- * Simple polynomial rolling hash
+ * Find the link pointing at a property (this object only, no inheritance),
+ * or the empty link ending its chain. Names are interned, so a match is
+ * usually a pointer compare; hash is vm_hash_cstring(prop_name).
  */
-static int property_hash(const char *name, int capacity) {
-    unsigned int hash = 0;
-    for (const char *p = name; *p; p++) {
-        hash = ((hash << 5) + hash) ^ (*p);
+static ObjProperty** find_property_link(obj_t *obj, const char *prop_name, unsigned int hash) {
+    ObjProperty **link = &obj->properties[hash % (unsigned int)obj->property_capacity];
+    
+    while (*link) {
+        ObjProperty *entry = *link;
+        if (entry->name == prop_name ||
+            (entry->hash == hash && strcmp(entry->name, prop_name) == 0)) {
+            break;
+        }
+        link = &entry->next;
     }
-    return hash % capacity;
+    
+    return link;
 }
 
 /**
  * Find property in hash table (this object only, no inheritance)
  * Returns pointer to property entry, or NULL if not found
  */
-static ObjProperty* find_property(obj_t *obj, const char *prop_name) {
+static ObjProperty* find_property(obj_t *obj, const char *prop_name, unsigned int hash) {
     if (!obj || !prop_name || !obj->properties) return NULL;
     
-    int hash = property_hash(prop_name, obj->property_capacity);
-    ObjProperty *entry = obj->properties[hash];
+    return *find_property_link(obj, prop_name, hash);
+}
+
+/* ========== Interned Names ========== */
+
+#define OBJ_METHOD_TABLE_MIN_CAPACITY 8
+
+const char* obj_intern_name(const char *name) {
+    /* Shared with VM string constants, so a literal method name in LPC
+     * code is this same pointer */
+    return vm_string_intern_static(name);
+}
+
+/* ========== Method Tables ========== */
+
+static unsigned int next_method_table_id = 1;
+
+void obj_method_table_release(ObjMethodTable *table) {
+    if (!table) return;
+    if (--table->ref_count > 0) return;
+    free(table->entries);
+    free(table);
+}
+
+/* Insert unless already present, so the first definition found wins */
+static void method_table_insert(ObjMethodTable *table, VMFunction *function) {
+    const char *name = obj_intern_name(function->name);
+    if (!name) return;
     
-    while (entry) {
-        if (strcmp(entry->name, prop_name) == 0) {
-            return entry;
+    unsigned int hash = vm_string_hash(name);
+    unsigned int mask= (unsigned int)table->capacity - 1;
+    unsigned int pos = hash & mask;
+    while (table->entries[pos].name) {
+        if (table->entries[pos].name == name) return;
+        pos = (pos + 1) & mask;
+    }
+    
+    table->entries[pos].name = name;
+    table->entries[pos].hash = hash;
+    table->entries[pos].function = function;
+    table->count++;
+}
+
+static ObjMethodTable* method_table_alloc(int total) {
+    int capacity = OBJ_METHOD_TABLE_MIN_CAPACITY;
+    while (capacity < total * 2) capacity *= 2;
+    
+    ObjMethodTable *table = (ObjMethodTable *)malloc(sizeof(ObjMethodTable));
+    if (!table) return NULL;
+    table->entries = (ObjMethodEntry *)calloc(capacity, sizeof(ObjMethodEntry));
+    if (!table->entries) {
+        free(table);
+        return NULL;
+    }
+    table->id = next_method_table_id++;
+    table->ref_count = 1;
+    table->capacity = capacity;
+    table->count = 0;
+    
+    return table;
+}
+
+static void method_table_insert_all(ObjMethodTable *table, VMFunction **functions, int count) {
+    for (int i = 0; i < count; i++) {
+        if (functions[i] && functions[i]->name) {
+            method_table_insert(table, functions[i]);
         }
-        entry = entry->next;
+    }
+}
+
+ObjMethodTable* obj_method_table_new(VMFunction **functions, int count) {
+    if (count < 0 || (count > 0 && !functions)) return NULL;
+    
+    ObjMethodTable *table = method_table_alloc(count);
+    if (table) method_table_insert_all(table, functions, count);
+    return table;
+}
+
+/* Add the methods of a program's table, which already resolved inherits */
+static void method_table_insert_table(ObjMethodTable *table, const ObjMethodTable *from) {
+    for (int i = 0; from && i < from->capacity; i++) {
+        if (from->entries[i].name) method_table_insert(table, from->entries[i].function);
+    }
+}
+
+static ObjMethodTable* method_table_build(obj_t *obj, const ObjMethodTable *proto_table) {
+    const ObjMethodTable *program_table = obj->program ? obj->program->method_table : NULL;
+    int total = obj->method_count;
+    if (program_table) total += program_table->count;
+    if (proto_table) total += proto_table->count;
+    
+    ObjMethodTable *table = method_table_alloc(total);
+    if (!table) return NULL;
+    
+    /* Own methods, then the program's, then the prototype chain's */
+    method_table_insert_all(table, obj->methods, obj->method_count);
+    method_table_insert_table(table, program_table);
+    method_table_insert_table(table, proto_table);
+    
+    return table;
+}
+
+ObjMethodTable* obj_method_table(obj_t *obj) {
+    if (!obj) return NULL;
+    
+    /* A prototype that changed has a new table, and so a new id */
+    ObjMethodTable *proto_table = obj->proto ? obj_method_table(obj->proto) : NULL;
+    unsigned int proto_id = proto_table ? proto_table->id : 0;
+    if (obj->method_table && obj->method_table_epoch == obj->method_epoch &&
+        obj->method_table_proto_id == proto_id) {
+        return obj->method_table;
+    }
+    
+    obj_method_table_release(obj->method_table);
+    obj->method_table = NULL;
+    
+    ObjMethodTable *table;
+    if (obj->method_count == 0 && obj->proto) {
+        /* Clone: nothing of its own to add, share the prototype's table */
+        table = proto_table;
+        if (table) table->ref_count++;
+    } else if (obj->method_count == 0 && obj->program) {
+        /* Plain instance of a program: its table never changes */
+        table = obj->program->method_table;
+        if (table) table->ref_count++;
+    } else {
+        table = method_table_build(obj, proto_table);
+    }
+    
+    obj->method_table = table;
+    obj->method_table_epoch = obj->method_epoch;
+    obj->method_table_proto_id = proto_id;
+    return table;
+}
+
+/* Table keys are interned, so an interned probe never needs strcmp() */
+static VMFunction* method_table_lookup(ObjMethodTable *table, const char *method_name,
+                                       unsigned int hash, int interned) {
+    unsigned int mask = (unsigned int)table->capacity - 1;
+    unsigned int pos = hash & mask;
+    while (table->entries[pos].name) {
+        ObjMethodEntry *entry = &table->entries[pos];
+        if (entry->name == method_name ||
+            (!interned && entry->hash == hash && strcmp(entry->name, method_name) == 0)) {
+            return entry->function;
+        }
+        pos = (pos + 1) & mask;
     }
     
     return NULL;
 }
 
+VMFunction* obj_method_table_find(ObjMethodTable *table, const char *method_name) {
+    if (!table || !method_name || table->count == 0) return NULL;
+    
+    return method_table_lookup(table, method_name, vm_hash_cstring(method_name), 0);
+}
+
+VMFunction* obj_method_table_find_string(ObjMethodTable *table, const char *method_name) {
+    if (!table || !method_name || table->count == 0) return NULL;
+    
+    return method_table_lookup(table, method_name, vm_string_hash(method_name),
+                               vm_string_is_interned(method_name));
+}
+
 /* ========== Object Lifecycle Functions ========== */
 
 obj_t* obj_new(const char *name) {
@@ -63,18 +226,32 @@ obj_t* obj_new(const char *name) {
     /* Initialize prototype */
     obj->proto = NULL;
     
-    /* Initialize properties hash table */
-    obj->property_capacity = OBJ_PROPERTY_HASH_SIZE;
+    /* Properties and methods are allocated on first use, so a clone that
+     * only runs its program's code costs little more than this struct */
+    obj->property_capacity = 0;
     obj->property_count = 0;
-    obj->properties = (ObjProperty **)malloc(sizeof(ObjProperty *) * obj->property_capacity);
-    for (int i = 0; i < obj->property_capacity; i++) {
-        obj->properties[i] = NULL;
-    }
+    obj->properties = NULL;
     
-    /* Initialize methods array */
-    obj->method_capacity = OBJ_INITIAL_METHOD_CAPACITY;
+    obj->program = NULL;
+    obj->variables = NULL;
+    obj->variable_count = 0;
+    
+    obj->method_capacity = 0;
     obj->method_count = 0;
-    obj->methods = (VMFunction **)malloc(sizeof(VMFunction *) * obj->method_capacity);
+    obj->methods = NULL;
+    obj->method_table = NULL;
+    obj->method_epoch = 0;
+    obj->method_table_epoch = 0;
+    obj->method_table_proto_id = 0;
+    
+    /* Not inside anything yet */
+    obj->environment = NULL;
+    obj->first_inventory = NULL;
+    obj->next_inventory = NULL;
+    obj->prev_inventory = NULL;
+    obj->inventory_count = 0;
+    obj->sched_entries = NULL;
+    obj->action_count = 0;
     
     /* Initialize state */
     obj->ref_count = 1;
@@ -97,6 +274,12 @@ obj_t* obj_clone(obj_t *original) {
     clone->proto = original;
     original->ref_count++;
     
+    /* Same program, fresh variables */
+    if (original->program && obj_program_attach(clone, original->program) != 0) {
+        obj_free(clone);
+        return NULL;
+    }
+    
     return clone;
 }
 
@@ -104,6 +287,8 @@ void obj_destroy(obj_t *obj) {
     if (!obj || obj->is_destroyed) return;
     
     obj->is_destroyed = 1;
+    scheduler_forget_object(obj);
+    command_table_forget_object(command_table_global(), obj);
     
     printf("[Object] Destroyed object '%s'\n", obj->name);
 }
@@ -111,6 +296,16 @@ void obj_destroy(obj_t *obj) {
 void obj_free(obj_t *obj) {
     if (!obj) return;
     
+    /* Nothing may call into it any more */
+    scheduler_forget_object(obj);
+    command_table_forget_object(command_table_global(), obj);
+    
+    /* Leave the containment tree */
+    obj_move(obj, NULL);
+    while (obj->first_inventory) {
+        obj_move(obj->first_inventory, NULL);
+    }
+    
     /* Free name */
     if (obj->name) {
         free(obj->name);
@@ -123,7 +318,7 @@ void obj_free(obj_t *obj) {
             ObjProperty *entry = obj->properties[i];
             while (entry) {
                 ObjProperty *next = entry->next;
-                if (entry->name) free(entry->name);
+                vm_string_release(entry->name);
                 vm_value_free(&entry->value);
                 free(entry);
                 entry = next;
@@ -133,11 +328,25 @@ void obj_free(obj_t *obj) {
         obj->properties = NULL;
     }
     
+    /* Free variables and drop the program */
+    if (obj->variables) {
+        for (int i = 0; i < obj->variable_count; i++) {
+            vm_value_release(&obj->variables[i]);
+        }
+        free(obj->variables);
+        obj->variables = NULL;
+        obj->variable_count = 0;
+    }
+    obj_program_release(obj->program);
+    obj->program = NULL;
+    
     /* Free methods array (but not the functions themselves - managed by VM) */
     if (obj->methods) {
         free(obj->methods);
         obj->methods = NULL;
     }
+    obj_method_table_release(obj->method_table);
+    obj->method_table = NULL;
     
     /* Decrement prototype reference */
     if (obj->proto) {
@@ -147,6 +356,44 @@ void obj_free(obj_t *obj) {
     free(obj);
 }
 
+/* ========== Containment Functions ========== */
+
+int obj_move(obj_t *obj, obj_t *dest) {
+    if (!obj) return -1;
+    
+    /* Refuse to create a containment cycle */
+    for (obj_t *o = dest; o; o = o->environment) {
+        if (o == obj) return -1;
+    }
+    
+    obj_t *env = obj->environment;
+    if (env) {
+        if (obj->prev_inventory) {
+            obj->prev_inventory->next_inventory = obj->next_inventory;
+        } else {
+            env->first_inventory = obj->next_inventory;
+        }
+        if (obj->next_inventory) {
+            obj->next_inventory->prev_inventory = obj->prev_inventory;
+        }
+        env->inventory_count--;
+    }
+    
+    obj->environment = dest;
+    obj->prev_inventory = NULL;
+    obj->next_inventory = NULL;
+    if (dest) {
+        obj->next_inventory = dest->first_inventory;
+        if (dest->first_inventory) {
+            dest->first_inventory->prev_inventory = obj;
+        }
+        dest->first_inventory = obj;
+        dest->inventory_count++;
+    }
+    
+    return 0;
+}
+
 /* ========== Property Access Functions ========== */
 
 VMValue obj_get_prop(obj_t *obj, const char *prop_name) {
@@ -154,15 +401,13 @@ VMValue obj_get_prop(obj_t *obj, const char *prop_name) {
         return vm_value_create_null();
     }
     
-    /* Search this object */
-    ObjProperty *prop = find_property(obj, prop_name);
-    if (prop) {
-        return prop->value;
-    }
-    
-    /* Search prototype chain */
-    if (obj->proto) {
-        return obj_get_prop(obj->proto, prop_name);
+    /* Search this object, then the prototype chain */
+    unsigned int hash = vm_hash_cstring(prop_name);
+    for (obj_t *o = obj; o; o = o->proto) {
+        ObjProperty *prop = find_property(o, prop_name, hash);
+        if (prop) {
+            return prop->value;
+        }
     }
     
     /* Not found */
@@ -172,27 +417,39 @@ VMValue obj_get_prop(obj_t *obj, const char *prop_name) {
 int obj_set_prop(obj_t *obj, const char *prop_name, VMValue value) {
     if (!obj || !prop_name) return -1;
     
+    if (!obj->properties) {
+        obj->properties = (ObjProperty **)calloc(OBJ_PROPERTY_HASH_SIZE, sizeof(ObjProperty *));
+        if (!obj->properties) return -1;
+        obj->property_capacity = OBJ_PROPERTY_HASH_SIZE;
+    }
+    
     /* Check if property already exists */
-    ObjProperty *prop = find_property(obj, prop_name);
+    unsigned int hash = vm_hash_cstring(prop_name);
+    ObjProperty *prop = find_property(obj, prop_name, hash);
     if (prop) {
         /* Update existing property */
         vm_value_free(&prop->value);
+        vm_value_write_barrier(value);
         prop->value = value;
         return 0;
     }
     
     /* Create new property */
-    int hash = property_hash(prop_name, obj->property_capacity);
-    
     ObjProperty *new_prop = (ObjProperty *)malloc(sizeof(ObjProperty));
     if (!new_prop) return -1;
     
-    new_prop->name = (char *)malloc(strlen(prop_name) + 1);
-    strcpy(new_prop->name, prop_name);
+    new_prop->name = vm_string_intern(prop_name);
+    if (!new_prop->name) {
+        free(new_prop);
+        return -1;
+    }
+    new_prop->hash = hash;
+    vm_value_write_barrier(value);
     new_prop->value = value;
-    new_prop->next = obj->properties[hash];
     
-    obj->properties[hash] = new_prop;
+    ObjProperty **head = &obj->properties[hash % (unsigned int)obj->property_capacity];
+    new_prop->next = *head;
+    *head = new_prop;
     obj->property_count++;
     
     return 0;
@@ -201,14 +458,12 @@ int obj_set_prop(obj_t *obj, const char *prop_name, VMValue value) {
 int obj_has_prop(obj_t *obj, const char *prop_name) {
     if (!obj || !prop_name) return 0;
     
-    /* Check this object */
-    if (find_property(obj, prop_name) != NULL) {
-        return 1;
-    }
-    
-    /* Check prototype chain */
-    if (obj->proto) {
-        return obj_has_prop(obj->proto, prop_name);
+    /* Check this object, then the prototype chain */
+    unsigned int hash = vm_hash_cstring(prop_name);
+    for (obj_t *o = obj; o; o = o->proto) {
+        if (find_property(o, prop_name, hash) != NULL) {
+            return 1;
+        }
     }
     
     return 0;
@@ -217,24 +472,17 @@ int obj_has_prop(obj_t *obj, const char *prop_name) {
 int obj_delete_prop(obj_t *obj, const char *prop_name) {
     if (!obj || !prop_name || !obj->properties) return -1;
     
-    int hash = property_hash(prop_name, obj->property_capacity);
-    ObjProperty **indirect = &obj->properties[hash];
-    
-    while (*indirect) {
-        ObjProperty *entry = *indirect;
-        if (strcmp(entry->name, prop_name) == 0) {
-            /* Found it - remove from chain */
-            *indirect = entry->next;
-            if (entry->name) free(entry->name);
-            vm_value_free(&entry->value);
-            free(entry);
-            obj->property_count--;
-            return 0;
-        }
-        indirect = &entry->next;
-    }
+    ObjProperty **link = find_property_link(obj, prop_name, vm_hash_cstring(prop_name));
+    ObjProperty *entry = *link;
+    if (!entry) return -1;  /* Not found */
     
-    return -1;  /* Not found */
+    /* Found it - remove from chain */
+    *link = entry->next;
+    vm_string_release(entry->name);
+    vm_value_free(&entry->value);
+    free(entry);
+    obj->property_count--;
+    return 0;
 }
 
 /* ========== Method Management Functions ========== */
@@ -244,16 +492,18 @@ int obj_add_method(obj_t *obj, VMFunction *method) {
     
     /* Check if we need to expand methods array */
     if (obj->method_count >= obj->method_capacity) {
-        obj->method_capacity *= 2;
-        obj->methods = (VMFunction **)realloc(obj->methods, 
-                                               sizeof(VMFunction *) * obj->method_capacity);
-        if (!obj->methods) return -1;
+        int capacity = obj->method_capacity ? obj->method_capacity * 2 : OBJ_INITIAL_METHOD_CAPACITY;
+        VMFunction **methods = (VMFunction **)realloc(obj->methods, sizeof(VMFunction *) * capacity);
+        if (!methods) return -1;
+        obj->methods = methods;
+        obj->method_capacity = capacity;
     }
     
     /* Add method */
     int index = obj->method_count;
     obj->methods[index] = method;
     obj->method_count++;
+    obj->method_epoch++;
     
     return index;
 }
@@ -261,19 +511,7 @@ int obj_add_method(obj_t *obj, VMFunction *method) {
 VMFunction* obj_get_method(obj_t *obj, const char *method_name) {
     if (!obj || !method_name) return NULL;
     
-    /* Search this object's methods */
-    for (int i = 0; i < obj->method_count; i++) {
-        if (obj->methods[i] && strcmp(obj->methods[i]->name, method_name) == 0) {
-            return obj->methods[i];
-        }
-    }
-    
-    /* Search prototype chain */
-    if (obj->proto) {
-        return obj_get_method(obj->proto, method_name);
-    }
-    
-    return NULL;
+    return obj_method_table_find(obj_method_table(obj), method_name);
 }
 
 VMValue obj_call_method(VirtualMachine *vm, obj_t *obj, const char *method_name,
@@ -300,6 +538,7 @@ VMValue obj_call_method(VirtualMachine *vm, obj_t *obj, const char *method_name,
     /* Preserve VM state to avoid leaking stack growth into caller */
     int saved_top = vm->stack ? vm->stack->top : 0;
     int saved_running = vm->running;
+    obj_t *saved_object = vm->current_object;
 
     /* Push arguments onto stack (in call order) */
     for (int i = 0; i < arg_count; i++) {
@@ -317,22 +556,22 @@ VMValue obj_call_method(VirtualMachine *vm, obj_t *obj, const char *method_name,
         }
     }
     
-    /* Find method index in VM's function table */
-    int method_idx = -1;
-    for (int i = 0; i < vm->function_count; i++) {
-        if (vm->functions[i] == method) {
-            method_idx = i;
-            break;
-        }
-    }
-    
-    if (method_idx == -1) {
+    /* Functions record their slot when registered with vm_add_function() */
+    int method_idx = method->index;
+    if (method_idx < 0 || method_idx >= vm->function_count ||
+        vm->functions[method_idx] != method) {
         DEBUG_LOG_OBJ("Method '%s' not found in VM function table", method_name);
+        while (vm->stack && vm->stack->top > saved_top) {
+            VMValue arg = vm->stack->values[--vm->stack->top];
+            vm_value_release(&arg);
+        }
         return vm_value_create_null();
     }
     
-    /* Call the method through VM */
+    /* Call the method through VM, as this object */
+    vm->current_object = obj;
     vm_call_function(vm, method_idx, arg_count);
+    vm->current_object = saved_object;
 
     /* Capture return value if one was produced */
     VMValue result = vm_value_create_null();
@@ -371,6 +610,7 @@ void obj_set_proto(obj_t *obj, obj_t *proto) {
     
     /* Set new prototype */
     obj->proto = proto;
+    obj->method_epoch++;
     
     /* Increment new prototype's ref count */
     if (proto) {
@@ -475,6 +715,10 @@ void obj_print(obj_t *obj) {
     
     printf("Object: %s\n", obj->name);
     printf("  Prototype: %s\n", obj->proto ? obj->proto->name : "NULL");
+    if (obj->program) {
+        printf("  Program: %s (%d functions, %d variables)\n", obj->program->path,
+               obj->program->function_count, obj->variable_count);
+    }
     printf("  Properties: %d\n", obj->property_count);
     
     /* Print properties */
@@ -517,6 +761,7 @@ int obj_get_method_count(obj_t *obj) {
     if (!obj) return 0;
     
     int count = obj->method_count;
+    if (obj->program && obj->program->method_table) count += obj->program->method_table->count;
     
     /* Add inherited methods */
     if (obj->proto) {
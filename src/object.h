@@ -14,6 +14,8 @@
  *   - proto: Prototype (parent) for inheritance
  *   - properties: Hash map of property name -> VMValue
  *   - methods: Array of functions defined in this object
+ *   - program: Shared compiled program (see object_program.h) and the
+ *     object's own slots for that program's global variables
  * 
  * Phase 4 Implementation - January 22, 2026
  */
@@ -29,6 +31,7 @@
 typedef struct obj_t obj_t;
 typedef struct ObjProperty ObjProperty;
 typedef struct ObjManager ObjManager;
+struct ObjProgram;
 
 /* ========== Constants ========== */
 
@@ -43,11 +46,38 @@ typedef struct ObjManager ObjManager;
  * Stores name-value pairs with chaining for collision resolution
  */
 typedef struct ObjProperty {
-    char *name;                     /* Property name (heap-allocated) */
+    char *name;                     /* Interned property name, one reference held */
+    unsigned int hash;              /* vm_hash_cstring(name) */
     VMValue value;                  /* Property value */
     struct ObjProperty *next;       /* Next entry in collision chain */
 } ObjProperty;
 
+/* ========== Method Table ========== */
+
+/**
+ * Slot in a hashed method table
+ * Names are interned, so tables built from the same program share keys
+ */
+typedef struct ObjMethodEntry {
+    const char *name;               /* Interned method name, NULL if slot empty */
+    unsigned int hash;              /* Cached hash of name */
+    VMFunction *function;           /* Method implementation */
+} ObjMethodEntry;
+
+/**
+ * Hashed method table (open addressing, power-of-two capacity)
+ * Flattens an object's own methods and everything inherited along the
+ * prototype chain. Built lazily; clones without methods of their own
+ * share their prototype's table by reference.
+ */
+typedef struct ObjMethodTable {
+    unsigned int id;                /* Unique per table, keys call-site caches */
+    int ref_count;                  /* Objects sharing this table */
+    int capacity;                   /* Number of slots */
+    int count;                      /* Methods stored */
+    ObjMethodEntry *entries;        /* Slot array */
+} ObjMethodTable;
+
 /* ========== Object Structure ========== */
 
 /**
@@ -63,11 +93,35 @@ struct obj_t {
     int property_count;             /* Number of properties stored */
     int property_capacity;          /* Capacity of hash table */
     
-    /* Methods (array of function pointers) */
+    /* Compiled program shared with every object made from the same file */
+    struct ObjProgram *program;     /* Reference held, or NULL */
+    VMValue *variables;             /* This object's global variables */
+    int variable_count;             /* program->variable_count */
+    
+    /* Methods added directly (allocated on first use) */
     VMFunction **methods;           /* Array of method function pointers */
     int method_count;               /* Number of methods */
     int method_capacity;            /* Capacity of methods array */
     
+    /* Hashed lookup over methods + prototype chain (built on demand) */
+    ObjMethodTable *method_table;   /* Shared, reference counted */
+    unsigned int method_epoch;      /* Bumped when methods or proto change */
+    unsigned int method_table_epoch; /* method_epoch the table was built at */
+    unsigned int method_table_proto_id; /* Id of the proto's table it was built over */
+    
+    /* Containment tree, maintained by obj_move() */
+    obj_t *environment;             /* Container, or NULL */
+    obj_t *first_inventory;         /* Most recently moved-in content */
+    obj_t *next_inventory;          /* Next sibling in environment's inventory */
+    obj_t *prev_inventory;          /* Previous sibling, NULL if first */
+    int inventory_count;            /* Objects directly inside this one */
+    
+    /* Heartbeat, call_outs and reset, managed by the scheduler */
+    struct SchedEntry *sched_entries;
+    
+    /* Actions this object added to the command table */
+    int action_count;
+    
     /* Reference counting for garbage collection */
     int ref_count;                  /* Reference count (future use) */
     
@@ -116,12 +170,26 @@ void obj_destroy(obj_t *obj);
 
 /**
  * Completely free an object's memory
- * Called after obj_destroy() when ready to deallocate
+ * Called after obj_destroy() when ready to deallocate. The object leaves
+ * its environment and its contents are left with no environment.
  * 
  * @param obj Object to free
  */
 void obj_free(obj_t *obj);
 
+/* ========== Containment Functions ========== */
+
+/**
+ * Move an object into a container
+ * Unlinks it from its current environment and makes it the first item
+ * of dest's inventory. Both steps are O(1).
+ * 
+ * @param obj Object to move
+ * @param dest New environment, or NULL to leave the current one
+ * @return 0 on success, -1 if dest is obj or inside it
+ */
+int obj_move(obj_t *obj, obj_t *dest);
+
 /* ========== Property Access Functions ========== */
 
 /**
@@ -176,6 +244,22 @@ int obj_delete_prop(obj_t *obj, const char *prop_name);
  */
 int obj_add_method(obj_t *obj, VMFunction *method);
 
+/**
+ * Build a method table over a function list
+ * The first function with a given name wins. Used for tables shared by
+ * every object of a program.
+ * 
+ * @param functions Functions to index
+ * @param count Number of functions
+ * @return Table holding one reference, or NULL on failure
+ */
+ObjMethodTable* obj_method_table_new(VMFunction **functions, int count);
+
+/**
+ * Drop a reference to a method table; the last one frees it
+ */
+void obj_method_table_release(ObjMethodTable *table);
+
 /**
  * Get a method by name from object or prototype chain
  * 
@@ -185,6 +269,46 @@ int obj_add_method(obj_t *obj, VMFunction *method);
  */
 VMFunction* obj_get_method(obj_t *obj, const char *method_name);
 
+/**
+ * Intern a method name
+ * Returns the canonical copy of the name; equal names yield the same
+ * pointer. Interned names live for the lifetime of the process.
+ * 
+ * @param name Name to intern
+ * @return Canonical name pointer, or NULL on failure
+ */
+const char* obj_intern_name(const char *name);
+
+/**
+ * Get the hashed method table for an object
+ * Rebuilds the table if the object or a prototype gained methods or
+ * changed prototype since it was built.
+ * The table is owned by the object; do not free it.
+ * 
+ * @param obj Object to query
+ * @return Method table, or NULL on failure
+ */
+ObjMethodTable* obj_method_table(obj_t *obj);
+
+/**
+ * Look up a method in a method table
+ * 
+ * @param table Table from obj_method_table()
+ * @param method_name Method name (interned names compare by pointer)
+ * @return Function pointer, or NULL if not found
+ */
+VMFunction* obj_method_table_find(ObjMethodTable *table, const char *method_name);
+
+/**
+ * Look up a method by a VM string name
+ * Uses the string's cached hash; interned names match by pointer alone.
+ * 
+ * @param table Table from obj_method_table()
+ * @param method_name VM string (see vm.h), e.g. a value's string_value
+ * @return Function pointer, or NULL if not found
+ */
+VMFunction* obj_method_table_find_string(ObjMethodTable *table, const char *method_name);
+
 /**
  * Call a method on an object
  * Looks up method by name and invokes it with arguments
@@ -0,0 +1,543 @@
+/**
+ * object_program.c - Shared Compiled Programs Implementation
+ */
+
+#include "object_program.h"
+#include "program_loader.h"
+#include "program_cache.h"
+#include "log.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Name -> entry, while a program's dispatch is worked out */
+typedef struct {
+    const char *name;               /* Interned, NULL if slot empty */
+    int entry;
+} ObjProgramName;
+
+/* ========== Programs ========== */
+
+static void obj_program_free(ObjProgram *program) {
+    for (int i = 0; i < program->variable_count; i++) {
+        vm_value_release(&program->variable_defaults[i]);
+    }
+    free(program->variable_defaults);
+    free(program->variable_names);
+    obj_method_table_release(program->method_table);
+    free(program->functions);
+    free(program->dispatch);
+    for (int i = 0; i < program->inherit_count; i++) {
+        obj_program_release(program->inherits[i]);
+    }
+    free(program->inherits);
+    free(program->path);
+    free(program);
+}
+
+static ObjProgramCache* obj_program_cache(VirtualMachine *vm) {
+    if (!vm->program_cache) {
+        vm->program_cache = (ObjProgramCache *)calloc(1, sizeof(ObjProgramCache));
+    }
+    return vm->program_cache;
+}
+
+/* Rewrite OP_LOAD/STORE_GLOBAL slots: through map when given, else by offset */
+static void obj_program_relocate_globals(VMFunction *func, const int *map, int map_count,
+                                         int offset) {
+    for (int i = 0; i < func->instruction_count; i++) {
+        OpCode op = VM_CODE_OP(func->code[i]);
+        if (op != OP_LOAD_GLOBAL && op != OP_STORE_GLOBAL) continue;
+
+        int slot = VM_CODE_SIMM(func->code[i]);
+        if (slot < 0) continue;
+        slot = map ? (slot < map_count ? map[slot] : 0) : slot + offset;
+        func->code[i] = VM_CODE(op, slot);
+    }
+}
+
+/* ========== Inherits ========== */
+
+/*
+ * Map an inherit string to its cache key and source file:
+ * "/std/object", "std/object.c" and "/std/object.lpc" all name
+ * <mudlib>/std/object.lpc. Some files spell the mudlib directory out
+ * ("/lib/std/object"); without such a file that means the same.
+ */
+static int obj_program_inherit_path(const char *inherit, char *path, size_t path_size,
+                                    char *fs_path, size_t fs_size) {
+    const char *mudlib = getenv("AMLP_MUDLIB");
+    if (!mudlib || !*mudlib) mudlib = "./lib";
+
+    while (*inherit == '/') inherit++;
+    size_t len = strlen(inherit);
+    if (len > 4 && strcmp(inherit + len - 4, ".lpc") == 0) {
+        len -= 4;
+    } else if (len > 2 && strcmp(inherit + len - 2, ".c") == 0) {
+        len -= 2;
+    }
+    if (len == 0) return -1;
+
+    for (;;) {
+        if (snprintf(path, path_size, "/%.*s", (int)len, inherit) >= (int)path_size ||
+            snprintf(fs_path, fs_size, "%s%s.lpc", mudlib, path) >= (int)fs_size) {
+            return -1;
+        }
+        struct stat st;
+        if (stat(fs_path, &st) == 0 || len <= 4 || strncmp(inherit, "lib/", 4) != 0) return 0;
+        inherit += 4;
+        len -= 4;
+    }
+}
+
+/*
+ * Load every inherited program, holding a reference to each. One that
+ * cannot be loaded is reported and left out, so the program still runs
+ * its own code, as it did before inherits were linked.
+ */
+static int obj_program_load_inherits(VirtualMachine *vm, ObjProgram *program, Program *prog) {
+    ObjProgramCache *cache = obj_program_cache(vm);
+    if (!cache) return -1;
+    if (cache->linking_depth >= OBJ_PROGRAM_MAX_INHERIT_DEPTH) {
+        fprintf(stderr, "[ObjProgram] ERROR: %s: inherits nested too deeply\n", program->path);
+        return -1;
+    }
+
+    program->inherits = (ObjProgram **)calloc(prog->inherit_count, sizeof(ObjProgram *));
+    if (!program->inherits) return -1;
+
+    cache->linking[cache->linking_depth++] = program->path;
+    for (size_t i = 0; i < prog->inherit_count; i++) {
+        char path[PATH_MAX];
+        char fs_path[PATH_MAX];
+        if (obj_program_inherit_path(prog->inherits[i], path, sizeof(path),
+                                     fs_path, sizeof(fs_path)) != 0) {
+            fprintf(stderr, "[ObjProgram] ERROR: %s: bad inherit \"%s\"\n",
+                    program->path, prog->inherits[i]);
+            continue;
+        }
+
+        int cycle = 0;
+        for (int d = 0; d < cache->linking_depth; d++) {
+            if (strcmp(cache->linking[d], path) == 0) cycle = 1;
+        }
+        ObjProgram *parent = cycle ? NULL : obj_program_load(vm, path, fs_path);
+        if (!parent) {
+            fprintf(stderr, "[ObjProgram] ERROR: %s: %s %s; linking without it\n", program->path,
+                    cycle ? "inherit cycle through" : "cannot load inherited", path);
+            continue;
+        }
+        parent->ref_count++;
+        program->inherits[program->inherit_count++] = parent;
+    }
+    cache->linking_depth--;
+    return 0;
+}
+
+/*
+ * Where a name used by our code but declared in an inherited program
+ * lives: the first block declaring it, its most derived declaration.
+ * Returns -1 if no inherited program declares it.
+ */
+static int obj_program_find_extern(ObjProgram *program, const char *name) {
+    const char *interned = obj_intern_name(name);
+    int base = 0;
+    for (int i = 0; i < program->inherit_count; i++) {
+        ObjProgram *parent = program->inherits[i];
+        for (int v = parent->variable_count - 1; v >= 0; v--) {
+            if (parent->variable_names[v] == interned) return base + v;
+        }
+        base += parent->variable_count;
+    }
+    return -1;
+}
+
+/*
+ * Put a parent's table and variables at entry fo and slot vo. At 0 and
+ * 0 its functions are shared as they are; anywhere else they are copied
+ * and moved there.
+ */
+static int obj_program_place(VirtualMachine *vm, ObjProgram *program, ObjProgram *parent,
+                             int fo, int vo) {
+    int shared = fo == 0 && vo == 0;
+    for (int j = 0; j < parent->function_count; j++) {
+        program->dispatch[fo + j] = parent->dispatch[j] + fo;
+        if (shared) {
+            program->functions[j] = parent->functions[j];
+            continue;
+        }
+
+        VMFunction *copy = vm_function_copy(parent->functions[j]);
+        if (!copy) return -1;
+        obj_program_relocate_globals(copy, NULL, 0, vo);
+        if (vm_add_function(vm, copy) < 0) {
+            vm_function_free(copy);
+            return -1;
+        }
+        program->functions[fo + j] = copy;
+    }
+
+    /* Calls linked to entries of the parent's table follow the block */
+    for (int j = 0; !shared && j < parent->function_count; j++) {
+        VMFunction *func = program->functions[fo + j];
+        for (int i = 0; i < func->call_site_count; i++) {
+            VMCallSite *site = &func->call_sites[i];
+            int super = site->link == VM_CALL_LOCAL && site->name && strncmp(site->name, "::", 2) == 0;
+            if (site->link != VM_CALL_VIRTUAL && !super) continue;
+            site->slot += fo;
+            site->target = program->functions[site->slot]->index;
+        }
+    }
+
+    for (int v = 0; v < parent->variable_count; v++) {
+        program->variable_names[vo + v] = parent->variable_names[v];
+        program->variable_defaults[vo + v] = parent->variable_defaults[v];
+        vm_value_addref(&program->variable_defaults[vo + v]);
+        program->variable_count = vo + v + 1;
+    }
+    return 0;
+}
+
+static int obj_program_name_slot(ObjProgramName *names, int capacity, const char *name) {
+    unsigned int mask = (unsigned int)capacity - 1;
+    unsigned int pos = vm_string_hash(name) & mask;
+    while (names[pos].name && names[pos].name != name) {
+        pos = (pos + 1) & mask;
+    }
+    return (int)pos;
+}
+
+/*
+ * Link our own functions into the table starting at own: ::name calls
+ * to the inherited definition, the dispatch of every entry, calls to
+ * program functions through the table, and the method table.
+ */
+static int obj_program_link(ObjProgram *program, int own) {
+    int count = program->function_count;
+
+    for (int f = own; f < count; f++) {
+        VMFunction *func = program->functions[f];
+        for (int i = 0; i < func->call_site_count; i++) {
+            VMCallSite *site = &func->call_sites[i];
+            if (!site->name || strncmp(site->name, "::", 2) != 0) continue;
+
+            int entry = -1;
+            for (int e = 0; e < own && entry < 0; e++) {
+                if (strcmp(program->functions[e]->name, site->name + 2) == 0) {
+                    entry = program->dispatch[e];
+                }
+            }
+            if (entry < 0) {
+                fprintf(stderr, "[ObjProgram] WARNING: %s: %s() has no inherited definition\n",
+                        program->path, site->name);
+                continue;
+            }
+            site->link = VM_CALL_LOCAL;
+            site->slot = entry;
+            site->target = program->functions[entry]->index;
+        }
+    }
+
+    /* Our own definitions first, then each block's, the first one winning */
+    int capacity = 8;
+    while (capacity < count * 2) capacity *= 2;
+    ObjProgramName *names = (ObjProgramName *)calloc(capacity, sizeof(ObjProgramName));
+    const char **entry_names = (const char **)malloc(sizeof(char *) * (count > 0 ? count : 1));
+    VMFunction **visible = (VMFunction **)malloc(sizeof(VMFunction *) * (count > 0 ? count : 1));
+    if (!names || !entry_names || !visible) {
+        free(names);
+        free(entry_names);
+        free(visible);
+        return -1;
+    }
+
+    int visible_count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        int first = pass == 0 ? own : 0;
+        int last = pass == 0 ? count : own;
+        for (int e = first; e < last; e++) {
+            entry_names[e] = obj_intern_name(program->functions[e]->name);
+            int slot = obj_program_name_slot(names, capacity, entry_names[e]);
+            if (names[slot].name) continue;
+            names[slot].name = entry_names[e];
+            names[slot].entry = program->dispatch[e];
+            visible[visible_count++] = program->functions[program->dispatch[e]];
+        }
+    }
+    for (int e = 0; e < count; e++) {
+        program->dispatch[e] = names[obj_program_name_slot(names, capacity, entry_names[e])].entry;
+    }
+
+    /* Efuns keep precedence; every other call to one of our names goes
+     * through the table, so a program inheriting ours can override it */
+    for (int f = own; f < count; f++) {
+        VMFunction *func = program->functions[f];
+        for (int i = 0; i < func->call_site_count; i++) {
+            VMCallSite *site = &func->call_sites[i];
+            if (!site->name || site->link == VM_CALL_EFUN || strncmp(site->name, "::", 2) == 0) {
+                continue;
+            }
+            const char *name = obj_intern_name(site->name);
+            int slot = obj_program_name_slot(names, capacity, name);
+            if (!names[slot].name) continue;
+            site->link = VM_CALL_VIRTUAL;
+            site->slot = names[slot].entry;
+            site->target = program->functions[site->slot]->index;
+        }
+    }
+
+    program->method_table = obj_method_table_new(visible, visible_count);
+    free(names);
+    free(entry_names);
+    free(visible);
+    return program->method_table ? 0 : -1;
+}
+
+ObjProgram* obj_program_from(VirtualMachine *vm, const char *path, Program *prog) {
+    if (!vm || !path || !prog) return NULL;
+
+    ObjProgram *program = (ObjProgram *)calloc(1, sizeof(ObjProgram));
+    if (!program) return NULL;
+    program->ref_count = 1;
+    program->path = (char *)malloc(strlen(path) + 1);
+    if (!program->path) {
+        obj_program_free(program);
+        return NULL;
+    }
+    strcpy(program->path, path);
+
+    /* Inherited programs come first in our table and our variables */
+    if (prog->inherit_count > 0 && obj_program_load_inherits(vm, program, prog) != 0) {
+        obj_program_free(program);
+        return NULL;
+    }
+    int inherited_functions = 0;
+    int inherited_variables = 0;
+    for (int i = 0; i < program->inherit_count; i++) {
+        inherited_functions += program->inherits[i]->function_count;
+        inherited_variables += program->inherits[i]->variable_count;
+    }
+
+    /* Our code addresses its own variables from 0 and inherited ones
+     * after them; names no inherited program declares share one slot
+     * past the end, where nothing else is stored */
+    int own_variables = (int)prog->global_count;
+    int map_count = own_variables + (int)prog->extern_count;
+    int *map = (int *)malloc(sizeof(int) * (map_count > 0 ? map_count : 1));
+    if (!map) {
+        obj_program_free(program);
+        return NULL;
+    }
+    int unresolved = 0;
+    for (int i = 0; i < own_variables; i++) {
+        map[i] = inherited_variables + i;
+    }
+    for (size_t k = 0; k < prog->extern_count; k++) {
+        int slot = obj_program_find_extern(program, prog->externs[k]);
+        if (slot < 0) {
+            LOG_AT(LOG_OBJECT, LOG_LEVEL_DEBUG, "[ObjProgram]", "%s: '%s' is not an inherited variable",
+                   path, prog->externs[k]);
+            slot = inherited_variables + own_variables;
+            unresolved = 1;
+        }
+        map[own_variables + k] = slot;
+    }
+
+    /* The loader appends the program's functions in order */
+    int first_function = vm->function_count;
+    if (program_loader_load(vm, prog) != 0) {
+        fprintf(stderr, "[ObjProgram] ERROR: failed to load '%s'\n", path);
+        free(map);
+        obj_program_free(program);
+        return NULL;
+    }
+    int own_functions = vm->function_count - first_function;
+
+    int function_count = inherited_functions + own_functions;
+    int variable_count = inherited_variables + own_variables + unresolved;
+    if (function_count > 0) {
+        program->functions = (VMFunction **)malloc(sizeof(VMFunction *) * function_count);
+        program->dispatch = (int *)malloc(sizeof(int) * function_count);
+        if (!program->functions || !program->dispatch) {
+            free(map);
+            obj_program_free(program);
+            return NULL;
+        }
+    }
+    program->function_count = function_count;
+    if (variable_count > 0) {
+        program->variable_names = (const char **)malloc(sizeof(char *) * variable_count);
+        program->variable_defaults = (VMValue *)malloc(sizeof(VMValue) * variable_count);
+        if (!program->variable_names || !program->variable_defaults) {
+            free(map);
+            obj_program_free(program);
+            return NULL;
+        }
+    }
+
+    int fo = 0;
+    int vo = 0;
+    for (int i = 0; i < program->inherit_count; i++) {
+        if (obj_program_place(vm, program, program->inherits[i], fo, vo) != 0) {
+            fprintf(stderr, "[ObjProgram] ERROR: %s: failed to place %s\n", path, program->inherits[i]->path);
+            free(map);
+            obj_program_free(program);
+            return NULL;
+        }
+        fo += program->inherits[i]->function_count;
+        vo += program->inherits[i]->variable_count;
+    }
+
+    for (int k = 0; k < own_functions; k++) {
+        VMFunction *func = vm->functions[first_function + k];
+        if (program->inherit_count > 0) obj_program_relocate_globals(func, map, map_count, 0);
+        program->functions[fo + k] = func;
+        program->dispatch[fo + k] = fo + k;
+    }
+    free(map);
+
+    for (int i = 0; i < own_variables + unresolved; i++) {
+        program->variable_names[vo + i] = obj_intern_name(i < own_variables ? prog->globals[i].name : "");
+        program->variable_defaults[vo + i] = i < own_variables ? prog->globals[i].value
+                                                               : vm_value_create_int(0);
+        vm_value_addref(&program->variable_defaults[vo + i]);
+        program->variable_count = vo + i + 1;
+    }
+
+    if (obj_program_link(program, fo) != 0) {
+        obj_program_free(program);
+        return NULL;
+    }
+    return program;
+}
+
+void obj_program_release(ObjProgram *program) {
+    if (!program) return;
+    if (--program->ref_count > 0) return;
+    obj_program_free(program);
+}
+
+int obj_program_attach(obj_t *obj, ObjProgram *program) {
+    if (!obj || !program || obj->program) return -1;
+
+    if (program->variable_count > 0) {
+        obj->variables = (VMValue *)malloc(sizeof(VMValue) * program->variable_count);
+        if (!obj->variables) return -1;
+        for (int i = 0; i < program->variable_count; i++) {
+            obj->variables[i] = program->variable_defaults[i];
+            vm_value_addref(&obj->variables[i]);
+        }
+    }
+    obj->variable_count = program->variable_count;
+
+    program->ref_count++;
+    obj->program = program;
+
+    /* Drop any table built before the program was attached */
+    obj_method_table_release(obj->method_table);
+    obj->method_table = NULL;
+    return 0;
+}
+
+int obj_program_find_variable(ObjProgram *program, const char *name) {
+    if (!program || !name) return -1;
+
+    for (int i = program->variable_count - 1; i >= 0; i--) {
+        if (strcmp(program->variable_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+/* ========== Cache ========== */
+
+static ObjProgram** obj_program_cache_link(ObjProgramCache *cache, const char *path) {
+    ObjProgram **link = &cache->buckets[vm_hash_cstring(path) % OBJ_PROGRAM_CACHE_BUCKETS];
+    while (*link && strcmp((*link)->path, path) != 0) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+ObjProgram* obj_program_find(VirtualMachine *vm, const char *path) {
+    if (!vm || !vm->program_cache || !path) return NULL;
+
+    return *obj_program_cache_link(vm->program_cache, path);
+}
+
+/* Whether every program inherited, all the way down, is still the cached one */
+static int obj_program_inherits_current(ObjProgramCache *cache, ObjProgram *program) {
+    for (int i = 0; i < program->inherit_count; i++) {
+        ObjProgram *parent = program->inherits[i];
+        if (*obj_program_cache_link(cache, parent->path) != parent ||
+            !obj_program_inherits_current(cache, parent)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+ObjProgram* obj_program_load(VirtualMachine *vm, const char *path, const char *fs_path) {
+    if (!vm || !path || !fs_path) return NULL;
+
+    ObjProgramCache *cache = obj_program_cache(vm);
+    if (!cache) return NULL;
+
+    struct stat st;
+    time_t mtime = stat(fs_path, &st) == 0 ? st.st_mtime : 0;
+
+    ObjProgram *cached = *obj_program_cache_link(cache, path);
+    if (cached && cached->mtime == mtime && obj_program_inherits_current(cache, cached)) {
+        cache->hits++;
+        return cached;
+    }
+
+    Program *prog = program_cache_compile_file(fs_path);
+    if (!prog) return NULL;
+    ObjProgram *program = obj_program_install(vm, path, prog, mtime);
+    program_free(prog);
+    return program;
+}
+
+ObjProgram* obj_program_install(VirtualMachine *vm, const char *path, Program *prog, time_t mtime) {
+    if (!vm || !path || !prog) return NULL;
+
+    ObjProgramCache *cache = obj_program_cache(vm);
+    if (!cache) return NULL;
+
+    ObjProgram *program = obj_program_from(vm, path, prog);
+    if (!program) return NULL;
+    program->mtime = mtime;
+    cache->compiles++;
+
+    /* Replace a stale entry; its objects keep it alive */
+    ObjProgram **link = obj_program_cache_link(cache, path);
+    ObjProgram *old = *link;
+    if (old) {
+        program->next = old->next;
+        old->next = NULL;
+        obj_program_release(old);
+    } else {
+        cache->count++;
+    }
+    *link = program;
+    return program;
+}
+
+void obj_program_cache_free(VirtualMachine *vm) {
+    if (!vm || !vm->program_cache) return;
+
+    ObjProgramCache *cache = vm->program_cache;
+    for (int i = 0; i < OBJ_PROGRAM_CACHE_BUCKETS; i++) {
+        ObjProgram *program = cache->buckets[i];
+        while (program) {
+            ObjProgram *next = program->next;
+            program->next = NULL;
+            obj_program_release(program);
+            program = next;
+        }
+    }
+    free(cache);
+    vm->program_cache = NULL;
+}
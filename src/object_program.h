@@ -0,0 +1,158 @@
+/**
+ * object_program.h - Shared Compiled Programs
+ *
+ * Every object compiled from the same file runs the same code. An
+ * ObjProgram is that code, loaded once: its own function table (in
+ * program order, so a same-named function of another file can never be
+ * picked up), the method table built over it, and the layout and
+ * initial values of its global variables. String and float constants
+ * live in the functions' constant pools, which the program's functions
+ * own.
+ *
+ * An object made from a program holds a reference to it and a vector
+ * with one slot per global variable; OP_LOAD_GLOBAL and OP_STORE_GLOBAL
+ * address that vector while the object is running. Attaching a program
+ * is O(1) in the size of the program: nothing is copied but the
+ * variables' initial values.
+ *
+ * Programs are cached per VM by LPC path. A lookup recompiles when the
+ * source file's modification time has changed; objects of the old
+ * version keep it alive until they are freed.
+ *
+ * Inheritance is linked when a program is loaded. Each inherited
+ * program is loaded (or found in the cache) first, and its whole
+ * function table and variable layout become a block of ours: blocks in
+ * inherit order, then our own functions and variables. The first block
+ * starts at entry 0 and slot 0 and so shares the parent's functions;
+ * later blocks are copies with their variable slots and table entries
+ * moved to where the block lands. Every entry has a dispatch entry, the
+ * definition a call through it runs: our own function of that name if
+ * there is one, else what the first block defining it dispatches to.
+ * A call to a program function is linked to an entry (VM_CALL_VIRTUAL),
+ * and at run time costs one table lookup in the running object's
+ * program; ::name() calls are linked straight to the inherited
+ * definition.
+ */
+
+#ifndef OBJECT_PROGRAM_H
+#define OBJECT_PROGRAM_H
+
+#include "object.h"
+#include "compiler.h"
+#include <time.h>
+
+/* ========== Constants ========== */
+
+#define OBJ_PROGRAM_CACHE_BUCKETS 256
+#define OBJ_PROGRAM_MAX_INHERIT_DEPTH 32
+
+/* ========== Types ========== */
+
+typedef struct ObjProgram {
+    char *path;                     /* LPC path, e.g. "/std/monster" */
+    int ref_count;                  /* Cache entry plus every attached object */
+
+    struct ObjProgram **inherits;   /* Inherited programs, in source order; referenced */
+    int inherit_count;
+
+    VMFunction **functions;         /* Each inherit's table, then own functions in program order */
+    int *dispatch;                  /* Per entry, the entry a call through it runs */
+    int function_count;
+    ObjMethodTable *method_table;   /* Over dispatched functions, shared by all instances */
+
+    const char **variable_names;    /* Interned, in slot order, inherited first */
+    VMValue *variable_defaults;     /* Copied into each new object */
+    int variable_count;
+
+    time_t mtime;                   /* Source modification time when compiled */
+    struct ObjProgram *next;        /* Cache chain */
+} ObjProgram;
+
+typedef struct ObjProgramCache {
+    ObjProgram *buckets[OBJ_PROGRAM_CACHE_BUCKETS];
+    int count;
+    unsigned long hits;
+    unsigned long compiles;
+    const char *linking[OBJ_PROGRAM_MAX_INHERIT_DEPTH]; /* Paths loading their inherits */
+    int linking_depth;
+} ObjProgramCache;
+
+/* ========== Programs ========== */
+
+/**
+ * Load a compiled program into the VM and wrap it as a shared program
+ * The result is not cached; the caller still owns and frees prog.
+ * Inherited programs are loaded through the cache, from the mudlib
+ * directory (AMLP_MUDLIB, default ./lib); one that does not load, or
+ * inherits us back, is reported and linked without.
+ *
+ * @param vm Virtual machine the functions are added to
+ * @param path LPC path to record
+ * @param prog Compiled program
+ * @return Program holding one reference, or NULL on failure
+ */
+ObjProgram* obj_program_from(VirtualMachine *vm, const char *path, Program *prog);
+
+/**
+ * Get the program for an LPC path, compiling fs_path on a cache miss,
+ * when the file changed since it was compiled, or when a program it
+ * inherits has been recompiled since
+ *
+ * @param vm Virtual machine
+ * @param path LPC path, the cache key
+ * @param fs_path Source file
+ * @return Program (owned by the cache; attach to keep it), or NULL if
+ *         the file does not compile
+ */
+ObjProgram* obj_program_load(VirtualMachine *vm, const char *path, const char *fs_path);
+
+/**
+ * Cache a program compiled elsewhere, e.g. on a preload worker, as if
+ * obj_program_load() had compiled it. Replaces any entry for path.
+ *
+ * @param vm Virtual machine
+ * @param path LPC path, the cache key
+ * @param prog Compiled program; the caller still owns and frees it
+ * @param mtime Source mtime taken before compiling
+ * @return Program (owned by the cache), or NULL on failure
+ */
+ObjProgram* obj_program_install(VirtualMachine *vm, const char *path, Program *prog, time_t mtime);
+
+/**
+ * Look up a cached program without compiling
+ *
+ * @return Program owned by the cache, or NULL
+ */
+ObjProgram* obj_program_find(VirtualMachine *vm, const char *path);
+
+/**
+ * Drop a reference; the last one frees the program (its functions stay
+ * in the VM's function table)
+ */
+void obj_program_release(ObjProgram *program);
+
+/**
+ * Make obj an instance of program
+ * Takes a reference and gives obj a fresh copy of the initial variable
+ * values. The object must not already have a program.
+ *
+ * @param obj Object
+ * @param program Program
+ * @return 0 on success, -1 on failure
+ */
+int obj_program_attach(obj_t *obj, ObjProgram *program);
+
+/**
+ * Find a global variable's slot in a program
+ *
+ * @return Slot index (the last, so our own when an inherited program
+ *         declares it too), or -1 if the program has no such variable
+ */
+int obj_program_find_variable(ObjProgram *program, const char *name);
+
+/**
+ * Release every cached program (called by vm_free)
+ */
+void obj_program_cache_free(VirtualMachine *vm);
+
+#endif /* OBJECT_PROGRAM_H */
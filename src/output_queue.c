@@ -0,0 +1,192 @@
+/**
+ * output_queue.c - Per-Connection Output Queue Implementation
+ */
+
+#include "output_queue.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#define OUTPUT_QUEUE_INITIAL_SEGMENTS 8
+
+OutputBlock* output_block_new(size_t size) {
+    OutputBlock *block = malloc(sizeof(OutputBlock) + size);
+    if (!block) return NULL;
+    block->refcount = 1;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void output_block_release(OutputBlock *block) {
+    if (block && --block->refcount == 0) free(block);
+}
+
+static OutputSegment *output_queue_at(OutputQueue *queue, size_t i) {
+    return &queue->segments[(queue->head + i) & (queue->capacity - 1)];
+}
+
+/* Double the ring, unwrapping it so head is 0 */
+static int output_queue_grow(OutputQueue *queue) {
+    size_t capacity = queue->capacity ? queue->capacity * 2 : OUTPUT_QUEUE_INITIAL_SEGMENTS;
+    OutputSegment *segments = malloc(capacity * sizeof(OutputSegment));
+    if (!segments) return -1;
+
+    for (size_t i = 0; i < queue->count; i++) {
+        segments[i] = *output_queue_at(queue, i);
+    }
+    free(queue->segments);
+    queue->segments = segments;
+    queue->capacity = capacity;
+    queue->head = 0;
+    return 0;
+}
+
+/* Drop the oldest segment */
+static void output_queue_pop(OutputQueue *queue) {
+    OutputSegment *seg = output_queue_at(queue, 0);
+    output_block_release(seg->block);
+    seg->block = NULL;
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->count--;
+}
+
+void output_queue_init(OutputQueue *queue, size_t limit) {
+    if (!queue) return;
+    memset(queue, 0, sizeof(*queue));
+    queue->limit = limit ? limit : OUTPUT_QUEUE_LIMIT;
+}
+
+void output_queue_free(OutputQueue *queue) {
+    if (!queue) return;
+    while (queue->count > 0) output_queue_pop(queue);
+    free(queue->segments);
+    queue->segments = NULL;
+    queue->capacity = 0;
+    queue->head = 0;
+    queue->pending = 0;
+}
+
+int output_queue_write(OutputQueue *queue, const void *data, size_t len) {
+    if (!queue || len == 0) return 0;
+
+    if (queue->pending + len > queue->limit) {
+        queue->bytes_dropped += len;
+        return -1;
+    }
+
+    /* Room in the tail block, if this queue owns it and the segment ends at its edge */
+    OutputSegment *tail = queue->count > 0 ? output_queue_at(queue, queue->count - 1) : NULL;
+    size_t room = 0;
+    if (tail && tail->block->refcount == 1 && tail->offset + tail->length == tail->block->used) {
+        room = tail->block->size - tail->block->used;
+    }
+    if (room > len) room = len;
+
+    /* Get everything that can fail out of the way before copying */
+    OutputBlock *block = NULL;
+    if (len > room) {
+        size_t left = len - room;
+        if (queue->count == queue->capacity && output_queue_grow(queue) != 0) {
+            queue->bytes_dropped += len;
+            return -1;
+        }
+        block = output_block_new(left > OUTPUT_BLOCK_SIZE ? left : OUTPUT_BLOCK_SIZE);
+        if (!block) {
+            queue->bytes_dropped += len;
+            return -1;
+        }
+        /* Growing may have moved the ring */
+        tail = queue->count > 0 ? output_queue_at(queue, queue->count - 1) : NULL;
+    }
+
+    const char *bytes = (const char *)data;
+    if (room > 0) {
+        memcpy(tail->block->data + tail->block->used, bytes, room);
+        tail->block->used += room;
+        tail->length += room;
+    }
+    if (block) {
+        memcpy(block->data, bytes + room, len - room);
+        block->used = len - room;
+
+        OutputSegment *seg = output_queue_at(queue, queue->count);
+        seg->block = block;
+        seg->offset = 0;
+        seg->length = block->used;
+        queue->count++;
+    }
+
+    queue->pending += len;
+    queue->bytes_queued += len;
+    return 0;
+}
+
+int output_queue_append(OutputQueue *queue, OutputBlock *block, size_t offset, size_t len) {
+    if (!queue || !block || len == 0) return 0;
+
+    if (queue->pending + len > queue->limit ||
+        (queue->count == queue->capacity && output_queue_grow(queue) != 0)) {
+        queue->bytes_dropped += len;
+        return -1;
+    }
+
+    block->refcount++;
+    OutputSegment *seg = output_queue_at(queue, queue->count);
+    seg->block = block;
+    seg->offset = offset;
+    seg->length = len;
+    queue->count++;
+
+    queue->pending += len;
+    queue->bytes_queued += len;
+    return 0;
+}
+
+int output_queue_flush(OutputQueue *queue, int fd) {
+    if (!queue) return -1;
+
+    while (queue->count > 0) {
+        struct iovec iov[OUTPUT_QUEUE_IOV_MAX];
+        int iovcnt = 0;
+        for (size_t i = 0; i < queue->count && iovcnt < OUTPUT_QUEUE_IOV_MAX; i++) {
+            OutputSegment *seg = output_queue_at(queue, i);
+            iov[iovcnt].iov_base = seg->block->data + seg->offset;
+            iov[iovcnt].iov_len = seg->length;
+            iovcnt++;
+        }
+
+        ssize_t sent = writev(fd, iov, iovcnt);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+
+            queue->bytes_dropped += queue->pending;
+            while (queue->count > 0) output_queue_pop(queue);
+            queue->pending = 0;
+            return -1;
+        }
+
+        queue->bytes_flushed += (unsigned long long)sent;
+        queue->pending -= (size_t)sent;
+
+        size_t left = (size_t)sent;
+        while (left > 0) {
+            OutputSegment *seg = output_queue_at(queue, 0);
+            if (left < seg->length) {
+                seg->offset += left;
+                seg->length -= left;
+                break;
+            }
+            left -= seg->length;
+            output_queue_pop(queue);
+        }
+    }
+
+    return 0;
+}
+
+size_t output_queue_pending(const OutputQueue *queue) {
+    return queue ? queue->pending : 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * output_queue.h - Per-Connection Output Queue
+ *
+ * Output for a connection is queued rather than sent as it is produced,
+ * then written with writev() when the driver flushes at the end of a
+ * pass or the socket becomes writable again. Everything one command
+ * prints therefore leaves in as few syscalls as the socket allows, and a
+ * client that stops reading costs memory up to the queue's limit instead
+ * of stalling the driver.
+ *
+ * The queue is a ring of segments, each a byte range of a refcounted
+ * OutputBlock. Small writes are copied into the tail block until it is
+ * full, so the ring stays short. A block built once for many connections
+ * (a broadcast) is appended to each queue by reference instead.
+ */
+
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <stddef.h>
+
+/* ========== Constants ========== */
+
+#define OUTPUT_BLOCK_SIZE 4096          /* Default block size for copied output */
+#define OUTPUT_QUEUE_LIMIT (256 * 1024) /* Default backlog before a write is refused */
+#define OUTPUT_QUEUE_IOV_MAX 64         /* Segments gathered per writev() */
+
+/* ========== Types ========== */
+
+typedef struct OutputBlock {
+    int refcount;
+    size_t size;                /* Capacity of data */
+    size_t used;                /* Bytes written into data */
+    char data[];
+} OutputBlock;
+
+typedef struct {
+    OutputBlock *block;
+    size_t offset;              /* First unsent byte in block->data */
+    size_t length;
+} OutputSegment;
+
+typedef struct {
+    OutputSegment *segments;    /* Ring; capacity is a power of two */
+    size_t capacity;
+    size_t head;                /* Oldest segment */
+    size_t count;
+    size_t pending;             /* Unsent bytes */
+    size_t limit;               /* Most unsent bytes allowed */
+
+    /* Lifetime counters */
+    unsigned long long bytes_queued;
+    unsigned long long bytes_flushed;
+    unsigned long long bytes_dropped;   /* Refused over the limit or lost on error */
+} OutputQueue;
+
+/* ========== Blocks ========== */
+
+/**
+ * Allocate a block holding one reference
+ *
+ * @param size Capacity in bytes
+ * @return Empty block, or NULL on failure
+ */
+OutputBlock* output_block_new(size_t size);
+
+/**
+ * Drop a reference; the block is freed with the last one
+ */
+void output_block_release(OutputBlock *block);
+
+/* ========== Queue ========== */
+
+/**
+ * Initialize an empty queue
+ *
+ * @param queue Queue to initialize
+ * @param limit Backlog limit in bytes, or 0 for OUTPUT_QUEUE_LIMIT
+ */
+void output_queue_init(OutputQueue *queue, size_t limit);
+
+/**
+ * Release every queued block and the ring
+ */
+void output_queue_free(OutputQueue *queue);
+
+/**
+ * Copy bytes onto the end of the queue
+ *
+ * @param queue Queue
+ * @param data Bytes to send
+ * @param len Length of data
+ * @return 0 on success, -1 if the write would exceed the limit or memory
+ *         ran out (nothing is queued and len is counted as dropped)
+ */
+int output_queue_write(OutputQueue *queue, const void *data, size_t len);
+
+/**
+ * Queue a byte range of a shared block without copying it
+ *
+ * @param queue Queue
+ * @param block Block; the queue takes its own reference
+ * @param offset First byte of the range
+ * @param len Length of the range
+ * @return 0 on success, -1 if the limit would be exceeded or memory ran
+ *         out (nothing is queued and len is counted as dropped)
+ */
+int output_queue_append(OutputQueue *queue, OutputBlock *block, size_t offset, size_t len);
+
+/**
+ * Write as much as the socket takes
+ *
+ * @param queue Queue
+ * @param fd Nonblocking socket
+ * @return 0 when the queue is empty, 1 when the socket would block with
+ *         output still queued, -1 on a socket error (the rest is dropped)
+ */
+int output_queue_flush(OutputQueue *queue, int fd);
+
+/**
+ * Unsent bytes
+ */
+size_t output_queue_pending(const OutputQueue *queue);
+
+#endif /* OUTPUT_QUEUE_H */
@@ -95,6 +95,11 @@ static void parser_error(Parser *parser, const char *message) {
             parser->current_token.line_number,
             parser->current_token.column_number,
             message);
+    if (parser->error_count == 0) {
+        parser->first_error_line = parser->current_token.line_number;
+        parser->first_error_column = parser->current_token.column_number;
+        snprintf(parser->first_error, sizeof(parser->first_error), "%s", message);
+    }
     parser->error_count++;
     parser->error_recovery_mode = 1;
 }
@@ -148,6 +153,8 @@ static ProgramNode* program_node_create(void) {
     node->declarations = malloc(sizeof(ASTNode*) * 10);
     node->declaration_count = 0;
     node->capacity = 10;
+    node->inherits = NULL;
+    node->inherit_count = 0;
     return node;
 }
 
@@ -1323,12 +1330,13 @@ Parser* parser_init(Lexer *lexer) {
         return NULL;
     }
 
-    Parser *parser = malloc(sizeof(Parser));
+    Parser *parser = calloc(1, sizeof(Parser));
     if (!parser) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         return NULL;
     }
 
+    PARSER_STATE_INIT(parser);
     parser->lexer = lexer;
     parser->current_token = lexer_get_next_token(lexer);
     parser->error_count = 0;
@@ -1345,6 +1353,7 @@ ASTNode* parser_parse(Parser *parser) {
         fprintf(stderr, "Error: Cannot parse with NULL parser\n");
         return NULL;
     }
+    PARSER_STATE_CHECK(parser);
 
     ProgramNode *program = program_node_create();
     ASTNode *prog_node = ast_node_create(NODE_PROGRAM, 1, 1);
@@ -1356,10 +1365,14 @@ ASTNode* parser_parse(Parser *parser) {
             strcmp(parser->current_token.value, "inherit") == 0) {
             parser_advance(parser);  /* Skip 'inherit' */
             
-            /* Expect a string path like "/std/object" */
+            /* Expect a string path like "/std/object"; the loader links it */
             if (parser_check(parser, TOKEN_STRING)) {
-                /* Log the inherit for now, full implementation later */
-                fprintf(stderr, "[Parser] Inherit statement: %s\n", parser->current_token.value);
+                char **inherits = realloc(program->inherits,
+                                          sizeof(char*) * (program->inherit_count + 1));
+                if (inherits) {
+                    program->inherits = inherits;
+                    program->inherits[program->inherit_count++] = strdup(parser->current_token.value);
+                }
                 parser_advance(parser);
             } else {
                 parser_error(parser, "Expected string path after 'inherit'");
@@ -1391,6 +1404,7 @@ ASTNode* parser_parse(Parser *parser) {
  */
 void parser_free(Parser *parser) {
     if (!parser) return;
+    PARSER_STATE_CLEAR(parser);
     free(parser);
 }
 
@@ -1407,6 +1421,10 @@ void ast_node_free(ASTNode *node) {
                 ast_node_free(prog->declarations[i]);
             }
             free(prog->declarations);
+            for (int i = 0; i < prog->inherit_count; i++) {
+                free(prog->inherits[i]);
+            }
+            free(prog->inherits);
             free(prog);
             break;
         }
@@ -9,6 +9,7 @@
 #define PARSER_H
 
 #include "lexer.h"
+#include "parser_state.h"
 
 /* ========== AST Node Type Enumeration ========== */
 
@@ -73,6 +74,8 @@ typedef struct {
     ASTNode **declarations;         /* Array of declarations */
     int declaration_count;
     int capacity;
+    char **inherits;                /* inherit paths, in source order */
+    int inherit_count;
 } ProgramNode;
 
 /* Function declaration node */
@@ -252,12 +255,21 @@ typedef struct {
 
 /* ========== Parser Structure ========== */
 
+/*
+ * All parse state lives here, so parsers on different threads never
+ * share anything.
+ */
 typedef struct {
+    uint32_t magic;                 /* PARSER_STATE_MAGIC while live */
+    int initialized;
     Lexer *lexer;                   /* Lexer providing tokens */
     Token current_token;            /* Current token being parsed */
     Token previous_token;           /* Previous token (for error recovery) */
     int error_count;                /* Number of errors encountered */
     int error_recovery_mode;        /* 1 if in error recovery, 0 otherwise */
+    int first_error_line;           /* Position and text of the first error */
+    int first_error_column;
+    char first_error[256];
 } Parser;
 
 /* ========== Parser API Functions ========== */
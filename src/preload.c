@@ -0,0 +1,289 @@
+/**
+ * preload.c - Parallel Mudlib Preload Implementation
+ */
+
+#include "preload.h"
+#include "program_cache.h"
+#include "object_program.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* ========== Helpers ========== */
+
+static double preload_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char *preload_strdup(const char *s) {
+    char *copy = (char *)malloc(strlen(s) + 1);
+    if (copy) strcpy(copy, s);
+    return copy;
+}
+
+static int preload_compare_names(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* ========== List ========== */
+
+int preload_list_init(PreloadList *list, const char *mudlib) {
+    if (!list || !mudlib) return -1;
+
+    memset(list, 0, sizeof(*list));
+    list->mudlib = preload_strdup(mudlib);
+    return list->mudlib ? 0 : -1;
+}
+
+/* Add one file; path is "/dir/name" without the .lpc suffix */
+static int preload_add_file(PreloadList *list, const char *path, const char *fs_path) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->entries[i].path, path) == 0) return 0;
+    }
+
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        PreloadEntry *grown = (PreloadEntry *)realloc(list->entries, sizeof(PreloadEntry) * capacity);
+        if (!grown) return -1;
+        list->entries = grown;
+        list->capacity = capacity;
+    }
+
+    PreloadEntry *entry = &list->entries[list->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->path = preload_strdup(path);
+    entry->fs_path = preload_strdup(fs_path);
+    if (!entry->path || !entry->fs_path) {
+        free(entry->path);
+        free(entry->fs_path);
+        return -1;
+    }
+    list->count++;
+    return 1;
+}
+
+/* Add every .lpc file under a directory, in name order */
+static int preload_add_dir(PreloadList *list, const char *path, const char *fs_dir) {
+    DIR *dir = opendir(fs_dir);
+    if (!dir) return -1;
+
+    char **names = NULL;
+    int count = 0, capacity = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        if (count >= capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            char **grown = (char **)realloc(names, sizeof(char *) * capacity);
+            if (!grown) break;
+            names = grown;
+        }
+        names[count] = preload_strdup(de->d_name);
+        if (names[count]) count++;
+    }
+    closedir(dir);
+    if (count > 0) qsort(names, count, sizeof(char *), preload_compare_names);
+
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        char child[PATH_MAX], fs_child[PATH_MAX];
+        size_t len = strlen(names[i]);
+        snprintf(fs_child, sizeof(fs_child), "%s/%s", fs_dir, names[i]);
+
+        struct stat st;
+        if (stat(fs_child, &st) == 0 && S_ISDIR(st.st_mode)) {
+            snprintf(child, sizeof(child), "%s/%s", path, names[i]);
+            int n = preload_add_dir(list, child, fs_child);
+            if (n > 0) added += n;
+        } else if (len > 4 && strcmp(names[i] + len - 4, ".lpc") == 0) {
+            snprintf(child, sizeof(child), "%s/%.*s", path, (int)(len - 4), names[i]);
+            if (preload_add_file(list, child, fs_child) > 0) added++;
+        }
+        free(names[i]);
+    }
+    free(names);
+    return added;
+}
+
+int preload_list_add(PreloadList *list, const char *path) {
+    if (!list || !path) return -1;
+
+    /* Normalise to "/a/b": one leading slash, no trailing ones */
+    char lpc_path[PATH_MAX];
+    while (*path == '/') path++;
+    snprintf(lpc_path, sizeof(lpc_path), "/%s", path);
+    size_t len = strlen(lpc_path);
+    while (len > 1 && lpc_path[len - 1] == '/') lpc_path[--len] = '\0';
+    if (len > 4 && strcmp(lpc_path + len - 4, ".lpc") == 0) lpc_path[len - 4] = '\0';
+
+    char fs_path[PATH_MAX];
+    struct stat st;
+    snprintf(fs_path, sizeof(fs_path), "%s%s", list->mudlib, lpc_path);
+    if (stat(fs_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        return preload_add_dir(list, strcmp(lpc_path, "/") == 0 ? "" : lpc_path, fs_path);
+    }
+
+    snprintf(fs_path, sizeof(fs_path), "%s%s.lpc", list->mudlib, lpc_path);
+    if (stat(fs_path, &st) != 0) return -1;
+    return preload_add_file(list, lpc_path, fs_path);
+}
+
+int preload_list_read(PreloadList *list, const char *list_file) {
+    if (!list || !list_file) return -1;
+
+    FILE *f = fopen(list_file, "r");
+    if (!f) return -1;
+
+    int added = 0;
+    char line[PATH_MAX];
+    while (fgets(line, sizeof(line), f)) {
+        char *start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        char *end = start + strlen(start);
+        while (end > start && (end[-1] == '\n' || end[-1] == '\r' ||
+                               end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+        if (*start == '\0' || *start == '#') continue;
+
+        int n = preload_list_add(list, start);
+        if (n < 0) {
+            fprintf(stderr, "[Preload] ERROR: %s: no such file or directory: %s\n", list_file, start);
+        } else {
+            added += n;
+        }
+    }
+    fclose(f);
+    return added;
+}
+
+void preload_list_free(PreloadList *list) {
+    if (!list) return;
+
+    for (int i = 0; i < list->count; i++) {
+        free(list->entries[i].path);
+        free(list->entries[i].fs_path);
+        program_free(list->entries[i].program);
+    }
+    free(list->entries);
+    free(list->mudlib);
+    memset(list, 0, sizeof(*list));
+}
+
+/* ========== Compiling ========== */
+
+int preload_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    if (cpus > PRELOAD_MAX_THREADS) cpus = PRELOAD_MAX_THREADS;
+    return (int)cpus;
+}
+
+typedef struct {
+    PreloadList *list;
+    int next;                   /* Next entry to hand out */
+    pthread_mutex_t lock;
+} PreloadQueue;
+
+static void preload_compile_entry(PreloadEntry *entry) {
+    struct stat st;
+    entry->mtime = stat(entry->fs_path, &st) == 0 ? st.st_mtime : 0;
+    entry->program = program_cache_compile_file(entry->fs_path);
+}
+
+static void *preload_worker(void *arg) {
+    PreloadQueue *queue = (PreloadQueue *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int i = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (i >= queue->list->count) break;
+
+        preload_compile_entry(&queue->list->entries[i]);
+    }
+    return NULL;
+}
+
+int preload_compile(PreloadList *list, int threads) {
+    if (!list) return 0;
+
+    if (threads <= 0) threads = preload_default_threads();
+    if (threads > PRELOAD_MAX_THREADS) threads = PRELOAD_MAX_THREADS;
+    if (threads > list->count) threads = list->count > 0 ? list->count : 1;
+
+    PreloadQueue queue;
+    queue.list = list;
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    double start = preload_now();
+    pthread_t workers[PRELOAD_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, preload_worker, &queue) != 0) {
+            fprintf(stderr, "[Preload] ERROR: could not start worker %d\n", i);
+            break;
+        }
+        started++;
+    }
+    /* The calling thread is a worker too */
+    preload_worker(&queue);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+
+    list->threads = started + 1;
+    list->compile_seconds = preload_now() - start;
+    list->compiled = 0;
+    list->failed = 0;
+    for (int i = 0; i < list->count; i++) {
+        Program *prog = list->entries[i].program;
+        if (prog && prog->last_error == COMPILE_SUCCESS && !prog->error_info.message) {
+            list->compiled++;
+        } else {
+            list->failed++;
+        }
+    }
+    return list->compiled;
+}
+
+/* ========== Linking ========== */
+
+int preload_link(VirtualMachine *vm, PreloadList *list) {
+    if (!vm || !list) return 0;
+
+    double start = preload_now();
+    list->loaded = 0;
+    for (int i = 0; i < list->count; i++) {
+        PreloadEntry *entry = &list->entries[i];
+        Program *prog = entry->program;
+        if (!prog) continue;
+
+        ObjProgram *cached = obj_program_find(vm, entry->path);
+        if (prog->last_error != COMPILE_SUCCESS || prog->error_info.message) {
+            fprintf(stderr, "[Preload] ERROR: %s:%d:%d: %s\n", entry->path,
+                    prog->error_info.line, prog->error_info.column,
+                    prog->error_info.message ? prog->error_info.message : "compile failed");
+        } else if (cached && cached->mtime == entry->mtime) {
+            /* Already loaded as an inherit of an earlier file */
+            list->loaded++;
+        } else if (obj_program_install(vm, entry->path, prog, entry->mtime)) {
+            list->loaded++;
+        } else {
+            fprintf(stderr, "[Preload] ERROR: %s: failed to load\n", entry->path);
+        }
+        program_free(prog);
+        entry->program = NULL;
+    }
+    list->link_seconds = preload_now() - start;
+    return list->loaded;
+}
@@ -0,0 +1,110 @@
+/**
+ * preload.h - Parallel Mudlib Preload
+ *
+ * Objects named in a preload list are compiled at boot instead of on
+ * their first clone_object() or load_object(). Lexing, parsing and code
+ * generation are pure functions of the source text, so the list is
+ * compiled on a pool of worker threads; each worker takes the next file
+ * and runs it through program_cache_compile_file(). Loading the results
+ * into the VM (program_loader_load() and the program cache) touches the
+ * function table and the string pool, so it runs afterwards on the
+ * calling thread, in list order.
+ *
+ * A list file names one LPC path per line ("/std/player"). A line naming
+ * a directory ("/std/") preloads every .lpc file beneath it. Blank lines
+ * and lines starting with '#' are ignored.
+ */
+
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include "vm.h"
+#include "compiler.h"
+#include <time.h>
+
+/* ========== Constants ========== */
+
+#define PRELOAD_DEFAULT_LIST "secure/preload.txt"  /* Relative to the mudlib */
+#define PRELOAD_MAX_THREADS 64
+
+/* ========== Types ========== */
+
+typedef struct {
+    char *path;                 /* LPC path, the program cache key */
+    char *fs_path;              /* Source file */
+    time_t mtime;               /* Taken before compiling */
+    Program *program;           /* Set by preload_compile() */
+} PreloadEntry;
+
+typedef struct {
+    char *mudlib;               /* Directory LPC paths are relative to */
+    PreloadEntry *entries;
+    int count;
+    int capacity;
+
+    /* Results of the last preload_compile() / preload_link() */
+    int threads;
+    int compiled;               /* Programs without errors */
+    int failed;                 /* Unreadable or with errors */
+    int loaded;                 /* Installed in the VM */
+    double compile_seconds;
+    double link_seconds;
+} PreloadList;
+
+/* ========== List ========== */
+
+/**
+ * Start an empty list
+ *
+ * @param mudlib Mudlib directory, e.g. "./lib"
+ * @return 0 on success, -1 on failure
+ */
+int preload_list_init(PreloadList *list, const char *mudlib);
+
+/**
+ * Add an LPC path, or every .lpc file under a directory
+ * Paths already in the list are skipped.
+ *
+ * @return Number of files added, or -1 if path does not exist
+ */
+int preload_list_add(PreloadList *list, const char *path);
+
+/**
+ * Add every path named in a list file
+ *
+ * @return Number of files added, or -1 if the file cannot be read
+ */
+int preload_list_read(PreloadList *list, const char *list_file);
+
+/**
+ * Free the list and any compiled programs still in it
+ */
+void preload_list_free(PreloadList *list);
+
+/* ========== Preloading ========== */
+
+/**
+ * Compile every entry on a pool of worker threads
+ * Does not touch any VM; entries get their Program (NULL if the file
+ * could not be read).
+ *
+ * @param threads Worker count; 0 picks one per online CPU
+ * @return Number of programs that compiled without errors
+ */
+int preload_compile(PreloadList *list, int threads);
+
+/**
+ * Load the compiled programs into vm's program cache, in list order
+ * Programs with errors are reported and skipped. Each entry's Program
+ * is freed once loaded.
+ *
+ * @return Number of programs loaded
+ */
+int preload_link(VirtualMachine *vm, PreloadList *list);
+
+/**
+ * Default worker count: online CPUs, capped at PRELOAD_MAX_THREADS
+ */
+int preload_default_threads(void);
+
+#endif /* PRELOAD_H */
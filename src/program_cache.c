@@ -0,0 +1,523 @@
+/**
+ * program_cache.c - On-Disk Compiled Program Cache Implementation
+ */
+
+#include "program_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Programs may be compiled on several threads at once (see preload.c);
+ * the directory is set before that and only the counters are shared */
+static char *cache_dir = NULL;
+static ProgramCacheStats cache_stats;
+static unsigned long store_sequence = 0;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void cache_count(unsigned long *counter) {
+    pthread_mutex_lock(&stats_lock);
+    (*counter)++;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/* ========== Configuration ========== */
+
+int program_cache_set_dir(const char *dir) {
+    free(cache_dir);
+    cache_dir = NULL;
+    if (!dir || !*dir) return 0;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "[ProgramCache] ERROR: cannot create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    cache_dir = (char *)malloc(strlen(dir) + 1);
+    if (!cache_dir) return -1;
+    strcpy(cache_dir, dir);
+    return 0;
+}
+
+const char* program_cache_dir(void) {
+    return cache_dir;
+}
+
+const ProgramCacheStats* program_cache_stats(void) {
+    return &cache_stats;
+}
+
+void program_cache_reset_stats(void) {
+    pthread_mutex_lock(&stats_lock);
+    memset(&cache_stats, 0, sizeof(cache_stats));
+    pthread_mutex_unlock(&stats_lock);
+}
+
+uint64_t program_cache_hash(const void *data, size_t len) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int program_cache_image_path(const char *filename, char *buf, size_t size) {
+    if (!cache_dir || !filename) return -1;
+
+    int n = snprintf(buf, size, "%s/%016llx%s", cache_dir,
+                     (unsigned long long)program_cache_hash(filename, strlen(filename)),
+                     PROGRAM_CACHE_SUFFIX);
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+/* ========== Writing ========== */
+
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t capacity;
+    int failed;
+} ImageBuffer;
+
+static void image_put(ImageBuffer *buf, const void *data, size_t len) {
+    if (buf->failed) return;
+    if (buf->len + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (capacity < buf->len + len) capacity *= 2;
+        unsigned char *grown = (unsigned char *)realloc(buf->data, capacity);
+        if (!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void image_put_u8(ImageBuffer *buf, uint8_t v) { image_put(buf, &v, sizeof(v)); }
+static void image_put_u16(ImageBuffer *buf, uint16_t v) { image_put(buf, &v, sizeof(v)); }
+static void image_put_u32(ImageBuffer *buf, uint32_t v) { image_put(buf, &v, sizeof(v)); }
+
+static void image_put_name(ImageBuffer *buf, const char *name) {
+    size_t len = name ? strlen(name) : 0;
+    if (len > UINT16_MAX) {
+        buf->failed = 1;
+        return;
+    }
+    image_put_u16(buf, (uint16_t)len);
+    image_put(buf, name, len);
+}
+
+/* Only values the compiler produces can be cached */
+static void image_put_value(ImageBuffer *buf, VMValue value) {
+    image_put_u8(buf, (uint8_t)value.type);
+    switch (value.type) {
+        case VALUE_INT: {
+            int64_t v = value.data.int_value;
+            image_put(buf, &v, sizeof(v));
+            break;
+        }
+        case VALUE_FLOAT:
+            image_put(buf, &value.data.float_value, sizeof(double));
+            break;
+        case VALUE_STRING: {
+            size_t len = value.data.string_value ? strlen(value.data.string_value) : 0;
+            image_put_u32(buf, (uint32_t)len);
+            image_put(buf, value.data.string_value, len);
+            break;
+        }
+        case VALUE_NULL:
+            break;
+        default:
+            buf->failed = 1;
+            break;
+    }
+}
+
+/* Write to a temporary name and rename, so a reader never sees half an image */
+static int program_cache_store(const Program *prog, const char *filename,
+                               const struct stat *st, uint64_t source_hash) {
+    char path[PATH_MAX];
+    char tmp[PATH_MAX + 32];
+    if (program_cache_image_path(filename, path, sizeof(path)) != 0) return -1;
+    pthread_mutex_lock(&stats_lock);
+    unsigned long sequence = store_sequence++;
+    pthread_mutex_unlock(&stats_lock);
+    snprintf(tmp, sizeof(tmp), "%s.%d.%lu.tmp", path, (int)getpid(), sequence);
+
+    ProgramImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.header_size = sizeof(header);
+    header.source_mtime = (int64_t)st->st_mtime;
+    header.source_size = (uint64_t)st->st_size;
+    header.source_hash = source_hash;
+    header.path_len = (uint32_t)strlen(filename);
+    header.bytecode_len = (uint32_t)prog->bytecode_len;
+    header.function_count = (uint32_t)prog->function_count;
+    header.global_count = (uint32_t)prog->global_count;
+    header.constant_count = (uint32_t)prog->constant_count;
+    header.line_map_count = (uint32_t)prog->line_map_count;
+    header.inherit_count = (uint32_t)prog->inherit_count;
+    header.extern_count = (uint32_t)prog->extern_count;
+
+    ImageBuffer buf = { NULL, 0, 0, 0 };
+    image_put(&buf, &header, sizeof(header));
+    image_put(&buf, filename, header.path_len);
+    image_put(&buf, prog->bytecode, prog->bytecode_len);
+    for (size_t i = 0; i < prog->function_count; i++) {
+        image_put_u16(&buf, prog->functions[i].offset);
+        image_put_u8(&buf, prog->functions[i].arg_count);
+        image_put_u8(&buf, prog->functions[i].local_count);
+        image_put_name(&buf, prog->functions[i].name);
+    }
+    for (size_t i = 0; i < prog->global_count; i++) {
+        image_put_name(&buf, prog->globals[i].name);
+        image_put_value(&buf, prog->globals[i].value);
+    }
+    for (size_t i = 0; i < prog->constant_count; i++) {
+        image_put_value(&buf, prog->constants[i]);
+    }
+    for (size_t i = 0; i < prog->line_map_count; i++) {
+        image_put_u16(&buf, prog->line_map[i].bytecode_offset);
+        image_put_u16(&buf, prog->line_map[i].source_line);
+    }
+    for (size_t i = 0; i < prog->inherit_count; i++) {
+        image_put_name(&buf, prog->inherits[i]);
+    }
+    for (size_t i = 0; i < prog->extern_count; i++) {
+        image_put_name(&buf, prog->externs[i]);
+    }
+    if (buf.failed) {
+        free(buf.data);
+        return -1;
+    }
+
+    ProgramImageHeader *out = (ProgramImageHeader *)buf.data;
+    out->image_size = buf.len;
+    out->payload_hash = program_cache_hash(buf.data + sizeof(header), buf.len - sizeof(header));
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(buf.data);
+        return -1;
+    }
+    size_t written = 0;
+    while (written < buf.len) {
+        ssize_t n = write(fd, buf.data + written, buf.len - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += (size_t)n;
+    }
+    free(buf.data);
+    if (close(fd) != 0 || written != buf.len || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+
+    cache_count(&cache_stats.stores);
+    return 0;
+}
+
+/* ========== Reading ========== */
+
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+    int failed;
+} ImageReader;
+
+static const void *image_take(ImageReader *r, size_t len) {
+    if (r->failed || len > r->len - r->pos) {
+        r->failed = 1;
+        return NULL;
+    }
+    const void *p = r->data + r->pos;
+    r->pos += len;
+    return p;
+}
+
+static uint8_t image_get_u8(ImageReader *r) {
+    const uint8_t *p = (const uint8_t *)image_take(r, 1);
+    return p ? *p : 0;
+}
+
+static uint16_t image_get_u16(ImageReader *r) {
+    uint16_t v = 0;
+    const void *p = image_take(r, sizeof(v));
+    if (p) memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t image_get_u32(ImageReader *r) {
+    uint32_t v = 0;
+    const void *p = image_take(r, sizeof(v));
+    if (p) memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static char *image_get_bytes(ImageReader *r, size_t len) {
+    const void *p = image_take(r, len);
+    if (!p) return NULL;
+    char *s = (char *)malloc(len + 1);
+    if (!s) {
+        r->failed = 1;
+        return NULL;
+    }
+    memcpy(s, p, len);
+    s[len] = '\0';
+    return s;
+}
+
+static char *image_get_name(ImageReader *r) {
+    return image_get_bytes(r, image_get_u16(r));
+}
+
+static VMValue image_get_value(ImageReader *r) {
+    VMValue value;
+    value.type = (ValueType)image_get_u8(r);
+    switch (value.type) {
+        case VALUE_INT: {
+            int64_t v = 0;
+            const void *p = image_take(r, sizeof(v));
+            if (p) memcpy(&v, p, sizeof(v));
+            value.data.int_value = (long)v;
+            break;
+        }
+        case VALUE_FLOAT: {
+            double v = 0;
+            const void *p = image_take(r, sizeof(v));
+            if (p) memcpy(&v, p, sizeof(v));
+            value.data.float_value = v;
+            break;
+        }
+        case VALUE_STRING: {
+            char *s = image_get_bytes(r, image_get_u32(r));
+            value = vm_value_create_string(s ? s : "");
+            free(s);
+            break;
+        }
+        case VALUE_NULL:
+            break;
+        default:
+            r->failed = 1;
+            value.type = VALUE_NULL;
+            break;
+    }
+    return value;
+}
+
+/* Decode the payload after a validated header */
+static Program* program_cache_decode(ImageReader *r, const ProgramImageHeader *header,
+                                     const char *filename) {
+    Program *prog = (Program *)calloc(1, sizeof(Program));
+    if (!prog) return NULL;
+    prog->ref_count = 1;
+    prog->last_error = COMPILE_SUCCESS;
+    prog->filename = (char *)malloc(strlen(filename) + 1);
+    if (prog->filename) strcpy(prog->filename, filename);
+    prog->error_info.filename = prog->filename;
+
+    image_take(r, header->path_len);
+    prog->bytecode = (uint8_t *)image_get_bytes(r, header->bytecode_len);
+    prog->bytecode_len = header->bytecode_len;
+
+    prog->functions = calloc(header->function_count ? header->function_count : 1,
+                             sizeof(prog->functions[0]));
+    prog->globals = calloc(header->global_count ? header->global_count : 1,
+                           sizeof(prog->globals[0]));
+    prog->constants = (VMValue *)calloc(header->constant_count ? header->constant_count : 1,
+                                        sizeof(VMValue));
+    prog->line_map = calloc(header->line_map_count ? header->line_map_count : 1,
+                            sizeof(prog->line_map[0]));
+    if (header->inherit_count > 0) {
+        prog->inherits = (char **)calloc(header->inherit_count, sizeof(char *));
+        if (!prog->inherits) r->failed = 1;
+    }
+    if (header->extern_count > 0) {
+        prog->externs = (char **)calloc(header->extern_count, sizeof(char *));
+        if (!prog->externs) r->failed = 1;
+    }
+    if (!prog->filename || !prog->functions || !prog->globals || !prog->constants || !prog->line_map) {
+        r->failed = 1;
+    }
+
+    for (uint32_t i = 0; !r->failed && i < header->function_count; i++) {
+        prog->functions[i].offset = image_get_u16(r);
+        prog->functions[i].arg_count = image_get_u8(r);
+        prog->functions[i].local_count = image_get_u8(r);
+        prog->functions[i].name = image_get_name(r);
+        prog->function_count = i + 1;
+    }
+    for (uint32_t i = 0; !r->failed && i < header->global_count; i++) {
+        prog->globals[i].name = image_get_name(r);
+        prog->globals[i].value = image_get_value(r);
+        prog->global_count = i + 1;
+    }
+    for (uint32_t i = 0; !r->failed && i < header->constant_count; i++) {
+        prog->constants[i] = image_get_value(r);
+        prog->constant_count = i + 1;
+    }
+    for (uint32_t i = 0; !r->failed && i < header->line_map_count; i++) {
+        prog->line_map[i].bytecode_offset = image_get_u16(r);
+        prog->line_map[i].source_line = image_get_u16(r);
+        prog->line_map_count = i + 1;
+    }
+    for (uint32_t i = 0; !r->failed && i < header->inherit_count; i++) {
+        prog->inherits[i] = image_get_name(r);
+        prog->inherit_count = i + 1;
+    }
+    for (uint32_t i = 0; !r->failed && i < header->extern_count; i++) {
+        prog->externs[i] = image_get_name(r);
+        prog->extern_count = i + 1;
+    }
+
+    if (r->failed || r->pos != r->len) {
+        program_free(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+static char *read_source(const char *filename, size_t *len) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    char *source = (char *)malloc((size_t)size + 1);
+    if (!source) {
+        fclose(f);
+        return NULL;
+    }
+    *len = fread(source, 1, (size_t)size, f);
+    source[*len] = '\0';
+    fclose(f);
+    return source;
+}
+
+/*
+ * Load filename's image if it is still good. The source is read into
+ * *source only when the mtime disagrees; *stale_mtime is then set if
+ * the content hash matched, so the caller can rewrite the image.
+ */
+static Program* program_cache_read(const char *filename, const struct stat *st,
+                                   char **source, size_t *source_len, int *stale_mtime) {
+    char path[PATH_MAX];
+    if (program_cache_image_path(filename, path, sizeof(path)) != 0) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat ist;
+    if (fstat(fd, &ist) != 0 || (size_t)ist.st_size < sizeof(ProgramImageHeader)) {
+        close(fd);
+        cache_count(&cache_stats.rejected);
+        return NULL;
+    }
+    size_t image_len = (size_t)ist.st_size;
+    void *map = mmap(NULL, image_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    ProgramImageHeader header;
+    memcpy(&header, map, sizeof(header));
+    const char *image_path = (const char *)map + sizeof(header);
+
+    Program *prog = NULL;
+    int usable = memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == PROGRAM_CACHE_VERSION &&
+                 header.header_size == sizeof(header) &&
+                 header.image_size == image_len &&
+                 header.path_len == strlen(filename) &&
+                 header.path_len <= image_len - sizeof(header) &&
+                 memcmp(image_path, filename, header.path_len) == 0 &&
+                 header.source_size == (uint64_t)st->st_size;
+
+    if (usable && header.source_mtime != (int64_t)st->st_mtime) {
+        /* Same size, new mtime: the contents decide */
+        if (!*source) *source = read_source(filename, source_len);
+        usable = *source && program_cache_hash(*source, *source_len) == header.source_hash;
+        if (usable) *stale_mtime = 1;
+    }
+
+    if (usable) {
+        const unsigned char *payload = (const unsigned char *)map + sizeof(header);
+        usable = program_cache_hash(payload, image_len - sizeof(header)) == header.payload_hash;
+    }
+
+    if (usable) {
+        ImageReader reader = { (const unsigned char *)map + sizeof(header),
+                               image_len - sizeof(header), 0, 0 };
+        prog = program_cache_decode(&reader, &header, filename);
+    }
+    munmap(map, image_len);
+
+    if (!prog) cache_count(&cache_stats.rejected);
+    return prog;
+}
+
+/* ========== Compiling ========== */
+
+/* Syntax errors leave last_error at COMPILE_SUCCESS; only error_info records them */
+static int compiled_cleanly(const Program *prog) {
+    return prog->last_error == COMPILE_SUCCESS && !prog->error_info.message;
+}
+
+Program* program_cache_compile_file(const char *filename) {
+    if (!filename) return NULL;
+    if (!cache_dir) return compiler_compile_file(filename);
+
+    struct stat st;
+    if (stat(filename, &st) != 0) return compiler_compile_file(filename);
+
+    /* Fast path: size and mtime match, and the source is never read */
+    char *source = NULL;
+    size_t source_len = 0;
+    int stale_mtime = 0;
+    Program *prog = program_cache_read(filename, &st, &source, &source_len, &stale_mtime);
+    if (prog && !stale_mtime) {
+        free(source);
+        cache_count(&cache_stats.hits);
+        return prog;
+    }
+
+    if (!source) source = read_source(filename, &source_len);
+    if (!source) {
+        fprintf(stderr, "Error: Could not open file '%s'\n", filename);
+        program_free(prog);
+        return NULL;
+    }
+
+    if (prog) {
+        /* Only the mtime moved; refresh the image's copy of it */
+        cache_count(&cache_stats.rehashed);
+    } else {
+        cache_count(&cache_stats.misses);
+        prog = compiler_compile_string(source, filename);
+    }
+
+    if (prog && compiled_cleanly(prog) &&
+        program_cache_store(prog, filename, &st, program_cache_hash(source, source_len)) != 0) {
+        fprintf(stderr, "[ProgramCache] ERROR: cannot write image for %s\n", filename);
+    }
+    free(source);
+    return prog;
+}
@@ -0,0 +1,123 @@
+/**
+ * program_cache.h - On-Disk Compiled Program Cache
+ *
+ * Compiling an LPC file means lexing, parsing and generating code for
+ * all of it. The result, a Program, is small and self-contained, so it
+ * is written to an image file the first time a file is compiled and
+ * read back on later boots instead of compiling again.
+ *
+ * Images live in one directory, named by a hash of the source path.
+ * Each records the path, the source's size, mtime and content hash,
+ * and a hash of its own payload. An image is used when the path, size
+ * and mtime match; when only the mtime differs (a checkout or a touch)
+ * the source is hashed, and a matching hash keeps the image. Images are
+ * mapped with mmap() and decoded with bounds checks, and anything that
+ * does not validate is ignored and rewritten by the next compile.
+ *
+ * Image layout (host byte order; the version and header size guard it):
+ *
+ *   ProgramImageHeader
+ *   path          path_len bytes
+ *   bytecode      bytecode_len bytes
+ *   functions     u16 offset, u8 args, u8 locals, u16 name length, name
+ *   globals       u16 name length, name, value
+ *   constants     value
+ *   line map      u16 bytecode offset, u16 source line
+ *   inherits      u16 path length, path
+ *   externs       u16 name length, name
+ *
+ * A value is a u8 type, then an i64 (int), f64 (float) or u32 length
+ * and bytes (string); null has no payload.
+ */
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "compiler.h"
+#include <stdint.h>
+
+/* ========== Constants ========== */
+
+#define PROGRAM_CACHE_MAGIC "AMLPPRG"           /* 8 bytes with the NUL */
+#define PROGRAM_CACHE_VERSION 2
+#define PROGRAM_CACHE_DEFAULT_DIR "data/program_cache"
+#define PROGRAM_CACHE_SUFFIX ".prg"
+
+/* ========== Types ========== */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;           /* sizeof(ProgramImageHeader) when written */
+    int64_t source_mtime;
+    uint64_t source_size;
+    uint64_t source_hash;           /* program_cache_hash() of the source */
+    uint64_t payload_hash;          /* program_cache_hash() of everything after the header */
+    uint64_t image_size;            /* Whole file */
+    uint32_t path_len;
+    uint32_t bytecode_len;
+    uint32_t function_count;
+    uint32_t global_count;
+    uint32_t constant_count;
+    uint32_t line_map_count;
+    uint32_t inherit_count;
+    uint32_t extern_count;
+} ProgramImageHeader;
+
+typedef struct {
+    unsigned long hits;             /* Image used, size and mtime matched */
+    unsigned long rehashed;         /* Image used after hashing the source */
+    unsigned long misses;           /* No usable image; compiled */
+    unsigned long stores;           /* Images written */
+    unsigned long rejected;         /* Images present but stale or invalid */
+} ProgramCacheStats;
+
+/* ========== Configuration ========== */
+
+/**
+ * Set the image directory, creating it if needed
+ *
+ * @param dir Directory, or NULL to turn the cache off (the default)
+ * @return 0 on success, -1 if the directory cannot be created (the
+ *         cache is then off)
+ */
+int program_cache_set_dir(const char *dir);
+
+/**
+ * Current image directory, or NULL when the cache is off
+ */
+const char* program_cache_dir(void);
+
+/* ========== Compiling ========== */
+
+/**
+ * Compile a file, or load its cached image
+ * A drop-in for compiler_compile_file(). Programs loaded from an image
+ * carry no source text. Programs that compiled with errors are returned
+ * but never cached. Safe to call from several threads at once, as long
+ * as the directory is not changed meanwhile.
+ *
+ * @param filename Source file
+ * @return Program (free with program_free()), or NULL if unreadable
+ */
+Program* program_cache_compile_file(const char *filename);
+
+/**
+ * Path of the image that would cache filename
+ *
+ * @return 0 on success, -1 if the cache is off or buf is too small
+ */
+int program_cache_image_path(const char *filename, char *buf, size_t size);
+
+/**
+ * Counters since start-up (or the last reset)
+ */
+const ProgramCacheStats* program_cache_stats(void);
+void program_cache_reset_stats(void);
+
+/**
+ * 64-bit FNV-1a hash
+ */
+uint64_t program_cache_hash(const void *data, size_t len);
+
+#endif /* PROGRAM_CACHE_H */
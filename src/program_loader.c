@@ -9,10 +9,10 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "program_loader.h"
+#include "debug.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
 
 /* Helper: Read uint8 from bytecode */
 static uint8_t read_u8(const uint8_t *bytecode, size_t *offset) {
@@ -65,34 +65,34 @@ static int program_line_for_offset(Program *program, size_t offset) {
     return line;
 }
 
-int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VMInstruction *instr) {
-    if (!bytecode || !instr) return -1;
+int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VMFunction *func) {
+    if (!bytecode || !func) return -1;
     
     size_t start_offset = offset;
     OpCode opcode = (OpCode)read_u8(bytecode, &offset);
-    instr->opcode = opcode;
+    int index;
     
     /* Decode operands based on opcode */
     switch (opcode) {
         case OP_PUSH_INT:
-            instr->operand.int_operand = read_i64(bytecode, &offset);
+            index = vm_function_emit_int(func, read_i64(bytecode, &offset));
             break;
             
         case OP_PUSH_FLOAT:
-            instr->operand.float_operand = read_f64(bytecode, &offset);
+            index = vm_function_emit_constant(func, OP_PUSH_FLOAT,
+                                              vm_value_create_float(read_f64(bytecode, &offset)));
             break;
             
         case OP_PUSH_STRING: {
             /* String operand: 2 bytes length (little-endian) + string data */
-            uint8_t len_lo = read_u8(bytecode, &offset);
-            uint8_t len_hi = read_u8(bytecode, &offset);
-            uint16_t str_len = len_lo | (len_hi << 8);
+            uint16_t str_len = read_u16(bytecode, &offset);
             char *str = (char*)malloc(str_len + 1);
             if (!str) return -1;
             memcpy(str, &bytecode[offset], str_len);
             str[str_len] = '\0';
             offset += str_len;
-            instr->operand.string_operand = str;
+            index = vm_function_emit_constant(func, OP_PUSH_STRING, vm_value_create_string(str));
+            free(str);
             break;
         }
             
@@ -102,14 +102,18 @@ int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VM
         case OP_STORE_GLOBAL:
         case OP_MAKE_ARRAY:
         case OP_MAKE_MAPPING:
+            index = vm_function_emit(func, opcode, read_u16(bytecode, &offset));
+            break;
+            
         case OP_CALL_METHOD:
-            instr->operand.int_operand = read_u16(bytecode, &offset);
+            index = vm_function_emit_call_method(func, read_u16(bytecode, &offset));
             break;
             
         case OP_JUMP:
         case OP_JUMP_IF_FALSE:
         case OP_JUMP_IF_TRUE:
-            instr->operand.address_operand = read_u16(bytecode, &offset);
+            /* Still a byte offset; program_loader_decode_range() translates it */
+            index = vm_function_emit(func, opcode, read_u16(bytecode, &offset));
             break;
             
         case OP_CALL: {
@@ -121,9 +125,9 @@ int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VM
             memcpy(name, &bytecode[offset], name_len);
             name[name_len] = '\0';
             offset += name_len;
-            instr->operand.call_operand.arg_count = arg_count;
-            instr->operand.call_operand.target = 0;  /* Will be resolved at runtime */
-            instr->operand.call_operand.name = name;  /* Store function name for lookup */
+            /* Target is bound by name in vm_link_calls() */
+            index = vm_function_emit_call(func, name, arg_count, 0);
+            free(name);
             break;
         }
             
@@ -160,7 +164,7 @@ int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VM
         case OP_STORE_MAPPING:
         case OP_HALT:
         case OP_PRINT:
-            /* No operands */
+            index = vm_function_emit(func, opcode, 0);
             break;
             
         default:
@@ -168,105 +172,130 @@ int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VM
             return -1;
     }
     
-    return (int)(offset - start_offset);
-}
-
-int program_loader_load(VirtualMachine *vm, Program *program) {
-    if (!vm || !program || !program->bytecode) {
-        fprintf(stderr, "[program_loader] Invalid arguments\n");
+    if (index < 0) {
+        fprintf(stderr, "[program_loader] Cannot pack opcode %d at offset %zu\n", opcode, start_offset);
         return -1;
     }
+    return (int)(offset - start_offset);
+}
 
-    /* Debug: dump the Program's source as seen by the loader */
-    {
-        char dump_path[256];
-        snprintf(dump_path, sizeof(dump_path), "/tmp/amlp_program_load_%d.lpc", (int)getpid());
-        FILE *d = fopen(dump_path, "a");
-        if (d) {
-            fprintf(d, "/* program filename: %s */\n", program->filename ? program->filename : "<null>");
-            if (program->source) {
-                fwrite(program->source, 1, strlen(program->source), d);
-                fprintf(d, "\n/* EOF */\n\n");
-            } else {
-                fprintf(d, "/* NO SOURCE AVAILABLE */\n\n");
-            }
-            fclose(d);
-        }
-    }
-    
-    /* Step 1: Decode bytecode into VMInstructions */
-    VMInstruction *instructions = NULL;
-    int instruction_count = 0;
-    int instruction_capacity = 256;
-    
-    instructions = (VMInstruction*)malloc(sizeof(VMInstruction) * instruction_capacity);
-    if (!instructions) {
-        fprintf(stderr, "[program_loader] Out of memory for instructions\n");
+/**
+ * Decode bytecode[start, end) into @func, one packed word per instruction,
+ * and build its line map. The compiler writes jump targets as absolute
+ * byte offsets; once every instruction's offset is known they are
+ * rewritten as instruction indices (a target that is not an instruction
+ * boundary in the range becomes the end of the function).
+ */
+static int program_loader_decode_range(Program *program, size_t start, size_t end, VMFunction *func) {
+    int capacity = 64;
+    size_t *offsets = (size_t *)malloc(sizeof(size_t) * capacity);
+    int *line_map = (int *)malloc(sizeof(int) * capacity);
+    if (!offsets || !line_map) {
+        free(offsets);
+        free(line_map);
+        fprintf(stderr, "[program_loader] Out of memory decoding %s\n", func->name);
         return -1;
     }
     
-    size_t offset = 0;
-    while (offset < program->bytecode_len) {
-        if (instruction_count >= instruction_capacity) {
-            instruction_capacity *= 2;
-            VMInstruction *new_instructions = (VMInstruction*)realloc(
-                instructions,
-                sizeof(VMInstruction) * instruction_capacity
-            );
-            if (!new_instructions) {
-                free(instructions);
-                fprintf(stderr, "[program_loader] Out of memory expanding instructions\n");
+    size_t offset = start;
+    while (offset < end) {
+        int index = func->instruction_count;
+        if (index >= capacity) {
+            capacity *= 2;
+            size_t *new_offsets = (size_t *)realloc(offsets, sizeof(size_t) * capacity);
+            if (new_offsets) offsets = new_offsets;
+            int *new_map = (int *)realloc(line_map, sizeof(int) * capacity);
+            if (new_map) line_map = new_map;
+            if (!new_offsets || !new_map) {
+                free(offsets);
+                free(line_map);
+                fprintf(stderr, "[program_loader] Out of memory expanding %s\n", func->name);
                 return -1;
             }
-            instructions = new_instructions;
         }
         
-        VMInstruction instr;
-        int bytes_read = program_loader_decode_instruction(
-            program->bytecode,
-            offset,
-            &instr
-        );
-        
+        int bytes_read = program_loader_decode_instruction(program->bytecode, offset, func);
         if (bytes_read < 0) {
-            free(instructions);
+            free(offsets);
+            free(line_map);
             fprintf(stderr, "[program_loader] Failed to decode instruction at offset %zu\n", offset);
             return -1;
         }
-        
-        instructions[instruction_count++] = instr;
+        offsets[index] = offset;
+        line_map[index] = program_line_for_offset(program, offset);
         offset += bytes_read;
     }
     
-    /* Step 2: Load top-level bytecode into VM */
-    if (vm_load_bytecode(vm, instructions, instruction_count) != 0) {
-        free(instructions);
+    int count = func->instruction_count;
+    for (int i = 0; i < count; i++) {
+        OpCode opcode = VM_CODE_OP(func->code[i]);
+        if (opcode != OP_JUMP && opcode != OP_JUMP_IF_FALSE && opcode != OP_JUMP_IF_TRUE) continue;
+        
+        /* Offsets are ascending: binary search for the target */
+        size_t target = VM_CODE_IMM(func->code[i]);
+        int lo = 0, hi = count - 1, index = count;
+        while (lo <= hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (offsets[mid] == target) {
+                index = mid;
+                break;
+            }
+            if (offsets[mid] < target) lo = mid + 1;
+            else hi = mid - 1;
+        }
+        vm_function_patch_jump(func, i, index);
+    }
+    
+    free(offsets);
+    func->line_map = line_map;
+    func->line_map_count = count;
+    return 0;
+}
+
+int program_loader_load(VirtualMachine *vm, Program *program) {
+    if (!vm || !program || !program->bytecode) {
+        fprintf(stderr, "[program_loader] Invalid arguments\n");
+        return -1;
+    }
+
+    /* Step 1: Decode top-level bytecode */
+    VMFunction *toplevel = vm_function_create("<toplevel>", 0, 0);
+    if (!toplevel) {
+        fprintf(stderr, "[program_loader] Out of memory for instructions\n");
+        return -1;
+    }
+    if (program_loader_decode_range(program, 0, program->bytecode_len, toplevel) != 0) {
+        vm_function_free(toplevel);
+        return -1;
+    }
+    vm_optimize_function(toplevel, vm->opt_level);
+    int instruction_count = toplevel->instruction_count;
+    
+    /* Step 2: Load top-level bytecode into VM (which takes ownership) */
+    if (vm_load_toplevel(vm, toplevel) != 0) {
+        vm_function_free(toplevel);
         fprintf(stderr, "[program_loader] Failed to load bytecode into VM\n");
         return -1;
     }
     
     /* Step 3: Create VMFunctions from function table */
+    int first_function = vm->function_count;
     for (size_t i = 0; i < program->function_count; i++) {
-        VMFunction *func = (VMFunction*)malloc(sizeof(VMFunction));
+        VMFunction *func = vm_function_create(program->functions[i].name,
+                                              program->functions[i].arg_count,
+                                              program->functions[i].local_count);
         if (!func) {
             fprintf(stderr, "[program_loader] Out of memory creating function %zu\n", i);
             return -1;
         }
-        
-        func->name = strdup(program->functions[i].name);
-        func->param_count = program->functions[i].arg_count;
-        func->local_var_count = program->functions[i].local_count;
         func->source_file = program->filename ? strdup(program->filename) : NULL;
-        func->line_map = NULL;
-        func->line_map_count = 0;
         
         /* Extract function bytecode from main bytecode */
         uint16_t func_offset = program->functions[i].offset;
         if (func_offset >= program->bytecode_len) {
             fprintf(stderr, "[program_loader] Function %s offset %u beyond bytecode (%zu)\n",
                     program->functions[i].name, func_offset, program->bytecode_len);
-            free(func->name);
-            free(func);
+            vm_function_free(func);
             return -1;
         }
         
@@ -279,94 +308,27 @@ int program_loader_load(VirtualMachine *vm, Program *program) {
         }
         
         /* Decode function instructions */
-        int func_instr_capacity = 64;
-        func->instructions = (VMInstruction*)malloc(sizeof(VMInstruction) * func_instr_capacity);
-        func->instruction_count = 0;
-        func->instruction_capacity = func_instr_capacity;
-        int *line_map = (int *)malloc(sizeof(int) * func_instr_capacity);
-        
-        if (!func->instructions) {
-            free(func->name);
-            if (func->source_file) free(func->source_file);
-            free(func);
-            fprintf(stderr, "[program_loader] Out of memory for function instructions\n");
+        if (program_loader_decode_range(program, func_offset, func_end, func) != 0) {
+            vm_function_free(func);
             return -1;
         }
-        
-        size_t func_offset_current = func_offset;
-        while (func_offset_current < func_end) {
-            if (func->instruction_count >= func->instruction_capacity) {
-                func->instruction_capacity *= 2;
-                VMInstruction *new_instr = (VMInstruction*)realloc(
-                    func->instructions,
-                    sizeof(VMInstruction) * func->instruction_capacity
-                );
-                if (!new_instr) {
-                    free(func->instructions);
-                    if (line_map) free(line_map);
-                    free(func->name);
-                    if (func->source_file) free(func->source_file);
-                    free(func);
-                    fprintf(stderr, "[program_loader] Out of memory expanding function instructions\n");
-                    return -1;
-                }
-                func->instructions = new_instr;
-                if (line_map) {
-                    int *new_map = (int *)realloc(line_map, sizeof(int) * func->instruction_capacity);
-                    if (!new_map) {
-                        free(func->instructions);
-                        free(line_map);
-                        free(func->name);
-                        if (func->source_file) free(func->source_file);
-                        free(func);
-                        fprintf(stderr, "[program_loader] Out of memory expanding line map\n");
-                        return -1;
-                    }
-                    line_map = new_map;
-                }
-            }
-            
-            VMInstruction instr;
-            size_t instr_offset = func_offset_current;
-            int bytes_read = program_loader_decode_instruction(
-                program->bytecode,
-                func_offset_current,
-                &instr
-            );
-            
-            if (bytes_read < 0) {
-                free(func->instructions);
-                if (line_map) free(line_map);
-                free(func->name);
-                if (func->source_file) free(func->source_file);
-                free(func);
-                fprintf(stderr, "[program_loader] Failed to decode function instruction at offset %zu\n",
-                        func_offset_current);
-                return -1;
-            }
-            
-            func->instructions[func->instruction_count++] = instr;
-            if (line_map) {
-                line_map[func->instruction_count - 1] = program_line_for_offset(program, instr_offset);
-            }
-            func_offset_current += bytes_read;
-        }
-
-        func->line_map = line_map;
-        func->line_map_count = line_map ? func->instruction_count : 0;
+        vm_optimize_function(func, vm->opt_level);
         
         /* Add function to VM */
         if (vm_add_function(vm, func) < 0) {
-            free(func->instructions);
-            if (func->line_map) free(func->line_map);
-            free(func->name);
-            if (func->source_file) free(func->source_file);
-            free(func);
+            vm_function_free(func);
             fprintf(stderr, "[program_loader] Failed to add function to VM\n");
             return -1;
         }
     }
     
+    /* Step 3b: Bind call sites now that the whole program is present */
+    int unresolved = vm_link_calls(vm, first_function, (int)program->function_count);
+    if (unresolved > 0) {
+        DEBUG_LOG_VM("%s: %d call site(s) left for runtime resolution",
+                     program->filename ? program->filename : "<program>", unresolved);
+    }
+    
     /* Step 4: Load globals into VM */
     for (size_t i = 0; i < program->global_count; i++) {
         /* Initialize global variables in VM's global storage */
@@ -423,9 +385,11 @@ int program_loader_load(VirtualMachine *vm, Program *program) {
     printf("[program_loader] Loaded program: %d instructions, %zu functions, %zu globals\n",
            instruction_count, program->function_count, program->global_count);
     
-    if (vm->function_count > 0) {
+    /* This program's functions only; listing the whole table on every
+     * load made booting quadratic in the number of files */
+    if (AMLP_DEBUG_VERBOSE() && vm->function_count > first_function) {
         printf("[program_loader] Functions registered:\n");
-        for (int i = 0; i < vm->function_count; i++) {
+        for (int i = first_function; i < vm->function_count; i++) {
             if (vm->functions[i]) {
                 printf("  [%d] %s (%d params, %d locals, %d instructions)\n",
                        i,
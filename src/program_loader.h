@@ -3,13 +3,13 @@
  * 
  * This module bridges the compiler and VM by converting a compiled
  * Program (with bytecode, function offsets, and metadata) into
- * VM-executable structures (VMInstructions, VMFunctions).
+ * VM-executable structures (packed VMFunctions).
  * 
  * Responsibilities:
- * - Parse bytecode array into VMInstruction stream
+ * - Pack the bytecode array into VMCode words
  * - Create VMFunction structures from function table
  * - Load constants and globals into VM
- * - Map bytecode offsets to VM instruction pointers
+ * - Map bytecode offsets (jump targets, lines) to instruction indices
  */
 
 #ifndef PROGRAM_LOADER_H
@@ -23,7 +23,7 @@
  * @vm: Target virtual machine
  * @program: Compiled program with bytecode and metadata
  * 
- * Converts the Program's bytecode array into VMInstructions,
+ * Packs the Program's bytecode array into VMCode words,
  * creates VMFunction structures for each function in the
  * function table, and loads globals/constants into the VM.
  * 
@@ -48,13 +48,14 @@ int program_loader_find_entry(VirtualMachine *vm, Program *program, const char *
  * program_loader_decode_instruction - Decode single bytecode instruction
  * @bytecode: Pointer to bytecode array
  * @offset: Current offset in bytecode
- * @instr: Output VMInstruction structure
+ * @func: Function to append the packed instruction to
  * 
  * Internal helper to decode one bytecode instruction at the given
- * offset into a VMInstruction structure.
+ * offset and append it to @func. Jump operands are left as byte
+ * offsets; program_loader_load() translates them.
  * 
  * Returns: Number of bytes consumed, or -1 on error
  */
-int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VMInstruction *instr);
+int program_loader_decode_instruction(const uint8_t *bytecode, size_t offset, VMFunction *func);
 
 #endif
@@ -1,5 +1,6 @@
 #include "room.h"
 #include "session_internal.h"
+#include "session.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -155,11 +156,15 @@ void room_remove_player(Room *room, PlayerSession *player) {
 void room_broadcast(Room *room, const char *message, PlayerSession *exclude) {
     if (!room || !message) return;
     
+    SharedMessage shared;
+    if (shared_message_init(&shared, "%s", message) != 0) return;
+    
     for (int i = 0; i < room->num_players; i++) {
-        if (room->players[i] != exclude && room->players[i]->username) {
-            send_to_player(room->players[i], "%s", message);
+        if (room->players[i] != exclude) {
+            send_shared_message(room->players[i], &shared);
         }
     }
+    shared_message_release(&shared);
 }
 
 /* Look command */
@@ -269,11 +274,14 @@ void cmd_move(PlayerSession *sess, const char *direction) {
     }
     
     /* Notify room of departure */
-    for (int i = 0; i < current->num_players; i++) {
-        if (current->players[i] != sess) {
-            send_to_player(current->players[i], "%s leaves %s.\n", 
-                          sess->username, direction);
+    SharedMessage shared;
+    if (shared_message_init(&shared, "%s leaves %s.\n", sess->username, direction) == 0) {
+        for (int i = 0; i < current->num_players; i++) {
+            if (current->players[i] != sess) {
+                send_shared_message(current->players[i], &shared);
+            }
         }
+        shared_message_release(&shared);
     }
     
     /* Move player */
@@ -282,10 +290,13 @@ void cmd_move(PlayerSession *sess, const char *direction) {
     sess->current_room = next_room;
     
     /* Notify new room of arrival */
-    for (int i = 0; i < next_room->num_players; i++) {
-        if (next_room->players[i] != sess) {
-            send_to_player(next_room->players[i], "%s arrives.\n", sess->username);
+    if (shared_message_init(&shared, "%s arrives.\n", sess->username) == 0) {
+        for (int i = 0; i < next_room->num_players; i++) {
+            if (next_room->players[i] != sess) {
+                send_shared_message(next_room->players[i], &shared);
+            }
         }
+        shared_message_release(&shared);
     }
     
     /* Auto-look */
@@ -0,0 +1,469 @@
+/**
+ * scheduler.c - Heartbeat, call_out and Reset Scheduler Implementation
+ *
+ * An entry is in at most one of three places: armed in the wheel, queued
+ * in the ready list, or running. Entries owned by an object are also on
+ * its sched_entries list until cancelled, so set_heart_beat(0),
+ * remove_call_out() and obj_free() find them without a search of the
+ * whole schedule, and every entry is on the scheduler's own list for
+ * teardown and the collector. Cancelling a queued or running entry only
+ * flags it; it is freed once it leaves the queue or finishes running.
+ */
+
+#include "scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SCHED_TICKS(ms) (((ms) + SCHEDULER_TICK_MS - 1) / SCHEDULER_TICK_MS)
+
+static const char *sched_kind_names[SCHED_KIND_COUNT] = {
+    "heart_beat", "call_out", "reset", "task"
+};
+
+unsigned long long scheduler_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + (unsigned long long)ts.tv_nsec / 1000000ULL;
+}
+
+static long sched_clock_usec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+/* ========== Entries ========== */
+
+static void sched_entry_free(SchedEntry *entry) {
+    Scheduler *sched = entry->scheduler;
+    sched->pending[entry->kind]--;
+
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        sched->entries = entry->next;
+    }
+    if (entry->next) entry->next->prev = entry->prev;
+
+    if (entry->function) vm_string_release(entry->function);
+    for (int i = 0; i < entry->arg_count; i++) {
+        vm_value_release(&entry->args[i]);
+    }
+    free(entry->args);
+    free(entry);
+}
+
+static void sched_timer_expired(TimerEntry *timer, void *ctx) {
+    SchedEntry *entry = (SchedEntry *)timer;
+    Scheduler *sched = (Scheduler *)ctx;
+
+    entry->due = sched->wheel.now;
+    entry->queued = 1;
+    entry->next_ready = NULL;
+    if (sched->ready_tail) {
+        sched->ready_tail->next_ready = entry;
+    } else {
+        sched->ready_head = entry;
+    }
+    sched->ready_tail = entry;
+    sched->ready_count++;
+}
+
+static void sched_arm(Scheduler *sched, SchedEntry *entry, unsigned long expires) {
+    timer_wheel_add(&sched->wheel, &entry->timer, expires, sched_timer_expired, sched);
+}
+
+static SchedEntry *sched_entry_new(Scheduler *sched, SchedKind kind, obj_t *obj) {
+    SchedEntry *entry = calloc(1, sizeof(SchedEntry));
+    if (!entry) {
+        fprintf(stderr, "[Scheduler] ERROR: out of memory\n");
+        return NULL;
+    }
+    entry->scheduler = sched;
+    entry->kind = kind;
+    entry->object = obj;
+    if (obj) {
+        entry->next_owned = obj->sched_entries;
+        obj->sched_entries = entry;
+    }
+    entry->next = sched->entries;
+    if (entry->next) entry->next->prev = entry;
+    sched->entries = entry;
+    sched->pending[kind]++;
+    return entry;
+}
+
+static void sched_unlink_owned(SchedEntry *entry) {
+    if (!entry->object) return;
+
+    for (SchedEntry **link = &entry->object->sched_entries; *link; link = &(*link)->next_owned) {
+        if (*link == entry) {
+            *link = entry->next_owned;
+            break;
+        }
+    }
+    entry->object = NULL;
+    entry->next_owned = NULL;
+}
+
+void scheduler_cancel(SchedEntry *entry) {
+    if (!entry || entry->cancelled) return;
+
+    sched_unlink_owned(entry);
+    timer_wheel_remove(&entry->scheduler->wheel, &entry->timer);
+    entry->cancelled = 1;
+    if (!entry->queued && entry != entry->scheduler->running) {
+        sched_entry_free(entry);
+    }
+}
+
+static SchedEntry *sched_find_owned(obj_t *obj, SchedKind kind) {
+    for (SchedEntry *entry = obj->sched_entries; entry; entry = entry->next_owned) {
+        if (entry->kind == kind) return entry;
+    }
+    return NULL;
+}
+
+/* By handle, or by interned name when function is set; a call_out that
+ * is already running no longer counts */
+static SchedEntry *sched_find_call_out(obj_t *obj, const char *function, int handle) {
+    for (SchedEntry *entry = obj->sched_entries; entry; entry = entry->next_owned) {
+        if (entry->kind != SCHED_CALL_OUT || entry == entry->scheduler->running) continue;
+        if (function ? entry->function == function : entry->handle == handle) return entry;
+    }
+    return NULL;
+}
+
+/* First run of a periodic entry, staggered across one interval */
+static unsigned long sched_first_due(Scheduler *sched, unsigned long interval) {
+    return sched->wheel.now + 1 + (sched->spread++ % interval);
+}
+
+static int sched_seconds_left(const Scheduler *sched, const SchedEntry *entry) {
+    if (entry->queued || entry->timer.expires <= sched->wheel.now) return 0;
+    unsigned long ms = (entry->timer.expires - sched->wheel.now) * SCHEDULER_TICK_MS;
+    return (int)((ms + 999) / 1000);
+}
+
+/* ========== Lifecycle ========== */
+
+void scheduler_init(Scheduler *sched, unsigned long long now_ms) {
+    if (!sched) return;
+    memset(sched, 0, sizeof(*sched));
+    timer_wheel_init(&sched->wheel, 0);
+    sched->origin_ms = now_ms;
+    sched->next_handle = 1;
+    sched->max_callbacks = SCHEDULER_MAX_CALLBACKS;
+    sched->budget_usec = SCHEDULER_BUDGET_USEC;
+}
+
+void scheduler_free(Scheduler *sched) {
+    if (!sched) return;
+
+    while (sched->entries) {
+        SchedEntry *entry = sched->entries;
+        timer_wheel_remove(&sched->wheel, &entry->timer);
+        sched_unlink_owned(entry);
+        sched_entry_free(entry);
+    }
+    sched->ready_head = NULL;
+    sched->ready_tail = NULL;
+    sched->ready_count = 0;
+}
+
+Scheduler* scheduler_global(void) {
+    static Scheduler global;
+    static int initialized = 0;
+    if (!initialized) {
+        scheduler_init(&global, scheduler_clock_ms());
+        initialized = 1;
+    }
+    return &global;
+}
+
+void scheduler_set_budget(Scheduler *sched, int max_callbacks, long budget_usec) {
+    if (!sched) return;
+    sched->max_callbacks = max_callbacks > 0 ? max_callbacks : 1;
+    sched->budget_usec = budget_usec > 0 ? budget_usec : 1;
+}
+
+/* ========== Running ========== */
+
+static void sched_run_entry(Scheduler *sched, VirtualMachine *vm, SchedEntry *entry) {
+    unsigned long lag_ms = (sched->wheel.now - entry->due) * SCHEDULER_TICK_MS;
+    sched->stats.lag_total_ms += lag_ms;
+    if (lag_ms > sched->stats.lag_max_ms) sched->stats.lag_max_ms = lag_ms;
+
+    obj_t *obj = entry->object;
+    const char *function = entry->kind == SCHED_HEART_BEAT ? "heart_beat" :
+                           entry->kind == SCHED_RESET ? "reset" : entry->function;
+
+    sched->running = entry;
+    long start = sched_clock_usec();
+    if (entry->kind == SCHED_TASK) {
+        entry->task(entry->task_ctx);
+    } else if (obj && !obj->is_destroyed && vm) {
+        if (obj_get_method(obj, function)) {
+            VMValue result = obj_call_method(vm, obj, function, entry->args, entry->arg_count);
+            vm_value_release(&result);
+        } else {
+            sched->stats.missing++;
+        }
+    }
+    long cost = sched_clock_usec() - start;
+    sched->running = NULL;
+
+    /* The callback may have destroyed its own object */
+    obj = entry->object;
+
+    if (cost < 0) cost = 0;
+    sched->stats.runs[entry->kind]++;
+    sched->stats.eval_usec[entry->kind] += (unsigned long long)cost;
+    if ((unsigned long)cost > sched->stats.eval_max_usec) {
+        sched->stats.eval_max_usec = (unsigned long)cost;
+        snprintf(sched->stats.eval_max_where, sizeof(sched->stats.eval_max_where), "%s->%s",
+                 obj && obj->name ? obj->name : "<driver>",
+                 function ? function : sched_kind_names[entry->kind]);
+    }
+    if (cost > SCHEDULER_EVAL_WARN_USEC) {
+        fprintf(stderr, "[Scheduler] WARNING: %s in %s took %ld us\n",
+                function ? function : sched_kind_names[entry->kind],
+                obj && obj->name ? obj->name : "<driver>", cost);
+    }
+
+    if (entry->cancelled || entry->interval == 0) {
+        sched_unlink_owned(entry);
+        sched_entry_free(entry);
+        return;
+    }
+
+    /* Keep the entry's phase; if it fell a whole interval behind, skip ahead */
+    unsigned long next = entry->due + entry->interval;
+    if (next <= sched->wheel.now) next = sched->wheel.now + 1;
+    sched_arm(sched, entry, next);
+}
+
+int scheduler_run(Scheduler *sched, VirtualMachine *vm, unsigned long long now_ms) {
+    if (!sched) return -1;
+
+    unsigned long tick = now_ms > sched->origin_ms ?
+        (unsigned long)((now_ms - sched->origin_ms) / SCHEDULER_TICK_MS) : 0;
+    if (tick > sched->wheel.now) {
+        unsigned long elapsed = tick - sched->wheel.now;
+        sched->stats.ticks += elapsed;
+        if (elapsed > 1) sched->stats.late_ticks += elapsed - 1;
+        timer_wheel_advance(&sched->wheel, tick);
+    }
+
+    if (sched->ready_head) {
+        sched->stats.passes++;
+        long start = sched_clock_usec();
+        int ran = 0;
+
+        while (sched->ready_head) {
+            if (ran >= sched->max_callbacks || sched_clock_usec() - start >= sched->budget_usec) {
+                sched->stats.overruns++;
+                sched->stats.deferred += sched->ready_count;
+                break;
+            }
+
+            SchedEntry *entry = sched->ready_head;
+            sched->ready_head = entry->next_ready;
+            if (!sched->ready_head) sched->ready_tail = NULL;
+            sched->ready_count--;
+            entry->queued = 0;
+            entry->next_ready = NULL;
+
+            if (entry->cancelled) {
+                sched_entry_free(entry);
+                continue;
+            }
+            sched_run_entry(sched, vm, entry);
+            ran++;
+        }
+    }
+
+    if (sched->ready_head) return 0;
+    if (sched->wheel.count == 0) return -1;
+
+    unsigned long long next_ms = sched->origin_ms + (unsigned long long)(sched->wheel.now + 1) * SCHEDULER_TICK_MS;
+    return next_ms > now_ms ? (int)(next_ms - now_ms) : 0;
+}
+
+/* ========== Objects ========== */
+
+int scheduler_set_heart_beat(Scheduler *sched, obj_t *obj, int beats) {
+    if (!sched || !obj) return 0;
+
+    SchedEntry *entry = sched_find_owned(obj, SCHED_HEART_BEAT);
+    if (beats <= 0) {
+        if (entry) scheduler_cancel(entry);
+        return 1;
+    }
+
+    unsigned long interval = SCHED_TICKS((unsigned long)beats * SCHEDULER_HEART_BEAT_MS);
+    if (entry) {
+        entry->interval = interval;
+        return 1;
+    }
+
+    entry = sched_entry_new(sched, SCHED_HEART_BEAT, obj);
+    if (!entry) return 0;
+    entry->interval = interval;
+    sched_arm(sched, entry, sched_first_due(sched, interval));
+    return 1;
+}
+
+int scheduler_query_heart_beat(obj_t *obj) {
+    if (!obj) return 0;
+    SchedEntry *entry = sched_find_owned(obj, SCHED_HEART_BEAT);
+    if (!entry) return 0;
+    return (int)(entry->interval / SCHED_TICKS(SCHEDULER_HEART_BEAT_MS));
+}
+
+int scheduler_call_out(Scheduler *sched, obj_t *obj, const char *function,
+                       unsigned long delay_ms, VMValue *args, int arg_count) {
+    if (!sched || !obj || !function || arg_count < 0) return -1;
+
+    char *name = vm_string_intern(function);
+    VMValue *copy = NULL;
+    if (arg_count > 0) copy = malloc(sizeof(VMValue) * (size_t)arg_count);
+    if (!name || (arg_count > 0 && !copy)) {
+        fprintf(stderr, "[Scheduler] ERROR: out of memory\n");
+        if (name) vm_string_release(name);
+        free(copy);
+        return -1;
+    }
+
+    SchedEntry *entry = sched_entry_new(sched, SCHED_CALL_OUT, obj);
+    if (!entry) {
+        vm_string_release(name);
+        free(copy);
+        return -1;
+    }
+
+    /* Strings are shared by reference; arrays and mappings stay reachable
+     * through scheduler_visit_values() */
+    for (int i = 0; i < arg_count; i++) {
+        copy[i] = args[i];
+        vm_value_addref(&copy[i]);
+    }
+    entry->function = name;
+    entry->args = copy;
+    entry->arg_count = arg_count;
+    entry->handle = sched->next_handle++;
+    if (sched->next_handle <= 0) sched->next_handle = 1;
+
+    unsigned long ticks = SCHED_TICKS(delay_ms);
+    sched_arm(sched, entry, sched->wheel.now + (ticks > 0 ? ticks : 1));
+    return entry->handle;
+}
+
+static SchedEntry *sched_lookup_call_out(obj_t *obj, const char *function, int handle) {
+    if (!obj) return NULL;
+    if (!function) return sched_find_call_out(obj, NULL, handle);
+
+    /* Interned names compare by pointer */
+    char *name = vm_string_intern(function);
+    if (!name) return NULL;
+    SchedEntry *entry = sched_find_call_out(obj, name, 0);
+    vm_string_release(name);
+    return entry;
+}
+
+int scheduler_remove_call_out(Scheduler *sched, obj_t *obj, const char *function, int handle) {
+    if (!sched) return -1;
+    SchedEntry *entry = sched_lookup_call_out(obj, function, handle);
+    if (!entry) return -1;
+
+    int left = sched_seconds_left(sched, entry);
+    scheduler_cancel(entry);
+    return left;
+}
+
+int scheduler_find_call_out(Scheduler *sched, obj_t *obj, const char *function, int handle) {
+    if (!sched) return -1;
+    SchedEntry *entry = sched_lookup_call_out(obj, function, handle);
+    return entry ? sched_seconds_left(sched, entry) : -1;
+}
+
+int scheduler_arm_reset(Scheduler *sched, obj_t *obj) {
+    if (!sched || !obj || !obj_get_method(obj, "reset")) return 0;
+    if (sched_find_owned(obj, SCHED_RESET)) return 1;
+
+    SchedEntry *entry = sched_entry_new(sched, SCHED_RESET, obj);
+    if (!entry) return 0;
+    entry->interval = SCHED_TICKS(SCHEDULER_RESET_MS);
+
+    /* The first reset lands in the second half of an interval */
+    unsigned long half = entry->interval / 2;
+    sched_arm(sched, entry, sched_first_due(sched, half) + half);
+    return 1;
+}
+
+void scheduler_forget_object(obj_t *obj) {
+    if (!obj) return;
+    while (obj->sched_entries) {
+        scheduler_cancel(obj->sched_entries);
+    }
+}
+
+/* ========== Native Tasks ========== */
+
+SchedEntry* scheduler_every(Scheduler *sched, unsigned long interval_ms, SchedTask task, void *ctx) {
+    if (!sched || !task) return NULL;
+
+    SchedEntry *entry = sched_entry_new(sched, SCHED_TASK, NULL);
+    if (!entry) return NULL;
+    entry->task = task;
+    entry->task_ctx = ctx;
+    entry->interval = SCHED_TICKS(interval_ms);
+    if (entry->interval == 0) entry->interval = 1;
+    sched_arm(sched, entry, sched->wheel.now + entry->interval);
+    return entry;
+}
+
+/* ========== Statistics ========== */
+
+int scheduler_format_stats(const Scheduler *sched, char *buf, size_t size) {
+    if (!sched || !buf || size == 0) return 0;
+
+    const SchedulerStats *st = &sched->stats;
+    unsigned long long runs = 0;
+    for (int k = 0; k < SCHED_KIND_COUNT; k++) runs += st->runs[k];
+
+    int len = snprintf(buf, size,
+        "Scheduler (%d ms ticks, %d callbacks or %ld us per pass)\r\n"
+        "  pending:   %zu heart_beat, %zu call_out, %zu reset, %zu task, %zu queued\r\n"
+        "  ticks:     %llu (%llu late), %llu passes, %llu overruns, %llu deferred\r\n"
+        "  lag:       %.1f ms avg, %lu ms max\r\n",
+        SCHEDULER_TICK_MS, sched->max_callbacks, sched->budget_usec,
+        sched->pending[SCHED_HEART_BEAT], sched->pending[SCHED_CALL_OUT],
+        sched->pending[SCHED_RESET], sched->pending[SCHED_TASK], sched->ready_count,
+        st->ticks, st->late_ticks, st->passes, st->overruns, st->deferred,
+        runs ? (double)st->lag_total_ms / (double)runs : 0.0, st->lag_max_ms);
+
+    for (int k = 0; k < SCHED_KIND_COUNT && len >= 0 && (size_t)len < size; k++) {
+        len += snprintf(buf + len, size - (size_t)len,
+                        "  %-10s %llu runs, %.1f us avg\r\n", sched_kind_names[k], st->runs[k],
+                        st->runs[k] ? (double)st->eval_usec[k] / (double)st->runs[k] : 0.0);
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(buf + len, size - (size_t)len,
+                        "  slowest:   %lu us (%s), %llu missing methods\r\n",
+                        st->eval_max_usec, st->eval_max_where[0] ? st->eval_max_where : "-",
+                        st->missing);
+    }
+    return len;
+}
+
+void scheduler_visit_values(Scheduler *sched, void (*visit)(VMValue value, void *ctx), void *ctx) {
+    if (!sched || !visit) return;
+    for (SchedEntry *entry = sched->entries; entry; entry = entry->next) {
+        for (int i = 0; i < entry->arg_count; i++) {
+            visit(entry->args[i], ctx);
+        }
+    }
+}
@@ -0,0 +1,239 @@
+/**
+ * scheduler.h - Heartbeat, call_out and Reset Scheduler
+ *
+ * Everything the driver runs on a timer rather than in answer to input
+ * goes through here: heart_beat() for objects that asked with
+ * set_heart_beat(), call_out() callbacks, the periodic reset() of objects
+ * that define one, and native C tasks such as the player round. Timers
+ * live in a hierarchical wheel counted in SCHEDULER_TICK_MS ticks, so
+ * thousands of them cost only the ones due on a given tick.
+ *
+ * Due callbacks are queued and run from scheduler_run() in the main loop,
+ * at most SCHEDULER_MAX_CALLBACKS or SCHEDULER_BUDGET_USEC per pass. What
+ * does not fit waits for the next pass instead of holding up the sockets;
+ * the pass is counted as an overrun. Each callback's run time is its eval
+ * cost, and the totals, the worst callback and the lag between a timer
+ * coming due and running are kept for the "sched" command.
+ *
+ * Ticks are counted from a fixed origin rather than from the previous
+ * pass, so a slow pass delays the callbacks behind it but never shifts
+ * the schedule.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "object.h"
+#include "timer_wheel.h"
+#include <stddef.h>
+
+/* ========== Constants ========== */
+
+#define SCHEDULER_TICK_MS 100           /* Wheel resolution */
+#define SCHEDULER_HEART_BEAT_MS 2000    /* One heartbeat */
+#define SCHEDULER_RESET_MS (30 * 60 * 1000) /* Between reset() calls */
+#define SCHEDULER_MAX_CALLBACKS 2000    /* Callbacks per pass */
+#define SCHEDULER_BUDGET_USEC 20000     /* Run time per pass */
+#define SCHEDULER_EVAL_WARN_USEC 50000  /* Callbacks slower than this are logged */
+
+/* ========== Types ========== */
+
+typedef enum {
+    SCHED_HEART_BEAT,
+    SCHED_CALL_OUT,
+    SCHED_RESET,
+    SCHED_TASK,                 /* Native C callback */
+    SCHED_KIND_COUNT
+} SchedKind;
+
+typedef struct Scheduler Scheduler;
+typedef struct SchedEntry SchedEntry;
+
+/* Native task; ctx is the pointer given to scheduler_every() */
+typedef void (*SchedTask)(void *ctx);
+
+struct SchedEntry {
+    TimerEntry timer;
+    Scheduler *scheduler;
+    SchedKind kind;
+    obj_t *object;              /* Owner; NULL for tasks */
+    char *function;             /* Interned method name (call_outs) */
+    VMValue *args;              /* call_out arguments, strings referenced */
+    int arg_count;
+    int handle;                 /* call_out handle */
+    unsigned long interval;     /* Ticks between runs; 0 for one-shot */
+    unsigned long due;          /* Tick the last run came due */
+    SchedTask task;
+    void *task_ctx;
+    int queued;                 /* Waiting in the ready queue */
+    int cancelled;              /* Freed once out of the queue or finished */
+    SchedEntry *next_owned;     /* Owner's list (obj->sched_entries) */
+    SchedEntry *next_ready;
+    SchedEntry *prev;           /* Every live entry (Scheduler.entries) */
+    SchedEntry *next;
+};
+
+typedef struct {
+    unsigned long long ticks;           /* Ticks advanced */
+    unsigned long long late_ticks;      /* Ticks that passed while the loop was elsewhere */
+    unsigned long long passes;          /* scheduler_run() calls that ran callbacks */
+    unsigned long long overruns;        /* Passes stopped by the budget with work left */
+    unsigned long long deferred;        /* Callbacks carried to a later pass */
+    unsigned long long runs[SCHED_KIND_COUNT];
+    unsigned long long eval_usec[SCHED_KIND_COUNT];
+    unsigned long long missing;         /* Callbacks whose method was not found */
+    unsigned long eval_max_usec;        /* Slowest callback */
+    char eval_max_where[96];            /* "object->function" of the slowest */
+    unsigned long long lag_total_ms;    /* Due-to-run delay, summed */
+    unsigned long lag_max_ms;
+} SchedulerStats;
+
+struct Scheduler {
+    TimerWheel wheel;
+    unsigned long long origin_ms;       /* Clock reading of tick 0 */
+    SchedEntry *entries;                /* Every live entry */
+    SchedEntry *ready_head;             /* Due, not yet run */
+    SchedEntry *ready_tail;
+    size_t ready_count;
+    SchedEntry *running;                /* Entry whose callback is executing */
+    size_t pending[SCHED_KIND_COUNT];   /* Live entries by kind */
+    int next_handle;
+    unsigned long spread;               /* Staggers first heartbeats and resets */
+    int max_callbacks;
+    long budget_usec;
+    SchedulerStats stats;
+};
+
+/* ========== Lifecycle ========== */
+
+/**
+ * Initialize a scheduler
+ *
+ * @param sched Scheduler to initialize
+ * @param now_ms Clock reading that becomes tick 0
+ */
+void scheduler_init(Scheduler *sched, unsigned long long now_ms);
+
+/**
+ * Cancel and free every entry
+ */
+void scheduler_free(Scheduler *sched);
+
+/**
+ * The driver's scheduler, initialized on first use
+ */
+Scheduler* scheduler_global(void);
+
+/**
+ * Monotonic clock in milliseconds
+ */
+unsigned long long scheduler_clock_ms(void);
+
+/**
+ * Change the per-pass limits
+ *
+ * @param max_callbacks Callbacks per pass
+ * @param budget_usec Run time per pass
+ */
+void scheduler_set_budget(Scheduler *sched, int max_callbacks, long budget_usec);
+
+/* ========== Running ========== */
+
+/**
+ * Advance to now and run due callbacks within the budget
+ *
+ * @param sched Scheduler
+ * @param vm VM to run LPC callbacks on
+ * @param now_ms Current clock reading
+ * @return Milliseconds until the next tick, 0 if callbacks are still
+ *         queued, or -1 if nothing is scheduled
+ */
+int scheduler_run(Scheduler *sched, VirtualMachine *vm, unsigned long long now_ms);
+
+/* ========== Objects ========== */
+
+/**
+ * Start, retime or stop an object's heart_beat()
+ *
+ * @param sched Scheduler
+ * @param obj Object
+ * @param beats Heartbeats between calls, or 0 to stop
+ * @return 1 on success, 0 on failure
+ */
+int scheduler_set_heart_beat(Scheduler *sched, obj_t *obj, int beats);
+
+/**
+ * Heartbeats between an object's heart_beat() calls, 0 if it has none
+ */
+int scheduler_query_heart_beat(obj_t *obj);
+
+/**
+ * Call a method of obj after a delay
+ *
+ * @param sched Scheduler
+ * @param obj Object
+ * @param function Method name
+ * @param delay_ms Delay; 0 runs it on the next tick
+ * @param args Arguments, copied (may be NULL if arg_count is 0)
+ * @param arg_count Number of arguments
+ * @return Handle for remove_call_out()/find_call_out(), or -1 on failure
+ */
+int scheduler_call_out(Scheduler *sched, obj_t *obj, const char *function,
+                       unsigned long delay_ms, VMValue *args, int arg_count);
+
+/**
+ * Cancel a call_out by handle, or by function name if function is set
+ *
+ * @return Seconds it had left, or -1 if there was no such call_out
+ */
+int scheduler_remove_call_out(Scheduler *sched, obj_t *obj, const char *function, int handle);
+
+/**
+ * Seconds left on a call_out by handle, or by function name if set
+ *
+ * @return Seconds left, or -1 if there is no such call_out
+ */
+int scheduler_find_call_out(Scheduler *sched, obj_t *obj, const char *function, int handle);
+
+/**
+ * Schedule reset() every SCHEDULER_RESET_MS if obj defines it
+ *
+ * @return 1 if armed, 0 if obj has no reset()
+ */
+int scheduler_arm_reset(Scheduler *sched, obj_t *obj);
+
+/**
+ * Cancel everything an object has scheduled; called from obj_free()
+ */
+void scheduler_forget_object(obj_t *obj);
+
+/* ========== Native Tasks ========== */
+
+/**
+ * Run a C function every interval_ms
+ *
+ * @return Entry to pass to scheduler_cancel(), or NULL on failure
+ */
+SchedEntry* scheduler_every(Scheduler *sched, unsigned long interval_ms, SchedTask task, void *ctx);
+
+/**
+ * Cancel one entry
+ */
+void scheduler_cancel(SchedEntry *entry);
+
+/* ========== Statistics ========== */
+
+/**
+ * Write a human-readable summary of the counters
+ *
+ * @return Length written, as snprintf()
+ */
+int scheduler_format_stats(const Scheduler *sched, char *buf, size_t size);
+
+/**
+ * Visit every value held by pending call_outs; the collector treats
+ * them as roots
+ */
+void scheduler_visit_values(Scheduler *sched, void (*visit)(VMValue value, void *ctx), void *ctx);
+
+#endif /* SCHEDULER_H */
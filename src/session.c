@@ -16,3 +16,7 @@ void *get_current_player_object(void) {
 void set_current_session(void *session) {
     vm_current_session = (PlayerSession *)session;
 }
+
+int get_current_privilege(void) {
+    return vm_current_session ? vm_current_session->privilege_level : -1;
+}
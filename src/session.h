@@ -12,10 +12,32 @@ void *get_current_player_object(void);
 /* Set the current session for the VM context (opaque pointer). */
 void set_current_session(void *session);
 
+/* Privilege level of the player whose command is running, or -1 when
+ * the driver itself is running code (boot, preload, the scheduler). */
+int get_current_privilege(void);
+
 /* Find the session for a given player object */
 PlayerSession* find_session_for_player(void *player_obj);
 
 /* Send a message to a player's session */
 void send_message_to_player_session(void *player_obj, const char *message);
 
+/* One message for many sessions (room and global broadcasts). Each wire
+ * form is encoded the first time a recipient needs it and then queued to
+ * every such recipient by reference. */
+typedef struct {
+    char *text;
+    struct OutputBlock *telnet;     /* CRLF form */
+    struct OutputBlock *websocket;  /* Web text, framed or compressed per recipient */
+} SharedMessage;
+
+/* Format the message text, printf-style. Returns 0, or -1 if out of memory. */
+int shared_message_init(SharedMessage *msg, const char *format, ...);
+
+/* Queue the message to one session */
+void send_shared_message(PlayerSession *session, SharedMessage *msg);
+
+/* Drop the text and this message's references to the encoded forms */
+void shared_message_release(SharedMessage *msg);
+
 #endif /* SESSION_H */
@@ -6,12 +6,15 @@
 #include <netinet/in.h>
 #include "websocket.h"
 #include "chargen.h"  /* Character generation system */
+#include "timer_wheel.h"
+#include "output_queue.h"
+#include "compress.h"
+#include "telnet.h"
 
 /* Forward declarations */
 typedef struct Room Room;
 
 #define INPUT_BUFFER_SIZE 2048
-#define WS_BUFFER_SIZE 65536
 
 typedef enum {
     STATE_CONNECTING,
@@ -39,8 +42,7 @@ typedef struct PlayerSession {
     char password_hash[128];      /* Stored password hash for verification */
     char input_buffer[INPUT_BUFFER_SIZE];
     size_t input_length;
-    uint8_t ws_buffer[WS_BUFFER_SIZE];
-    size_t ws_buffer_length;
+    WSParser ws_parser;      /* WebSocket bytes are received into it */
     time_t last_activity;
     time_t connect_time;
     void *player_object;
@@ -54,6 +56,18 @@ typedef struct PlayerSession {
     int chargen_temp_choice; /* Temporary storage for menu selection */
     Character character;
     Room *current_room;
+    
+    /* Event loop bookkeeping (driver.c) */
+    int slot;                /* Index in the session table, -1 once closed */
+    TimerEntry idle_timer;   /* Due when the session could next time out */
+    OutputQueue output;      /* Sent at the end of each pass */
+    int output_dirty;        /* On the driver's flush list */
+    int output_overflow;     /* Backlog limit hit; closed at the next flush */
+    TelnetState telnet;      /* IAC commands split across reads */
+    Compressor *compressor;  /* MCCP2 or permessage-deflate; game output is staged in it */
+    Decompressor *decompressor;  /* Compressed client messages, created on the first */
+    struct PlayerSession *next_dirty;
+    struct PlayerSession *next_closed;
 } PlayerSession;
 
 #endif /* SESSION_INTERNAL_H */
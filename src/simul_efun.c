@@ -1,4 +1,5 @@
 #include "simul_efun.h"
+#include "program_cache.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -52,7 +53,7 @@ void simul_efun_registry_free(simul_efun_registry_t *registry) {
 int simul_efun_load_object(simul_efun_registry_t *registry, const char *filename) {
     if (!registry || !filename) return -1;
     
-    Program *prog = compiler_compile_file(filename);
+    Program *prog = program_cache_compile_file(filename);
     if (!prog) {
         fprintf(stderr, "Error: Failed to load simul_efun object from '%s'\n", filename);
         return -1;
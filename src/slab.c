@@ -0,0 +1,147 @@
+/**
+ * slab.c - Size-Class Slab Allocator Implementation
+ *
+ * Each thread owns one SlabContext: a free list and a bump region per
+ * size class. Allocation pops the free list, then bumps through the
+ * current chunk, then carves a new chunk. Chunks are linked through
+ * their first bytes so they stay reachable for leak checkers.
+ */
+
+#include "slab.h"
+#include <stdlib.h>
+
+#if defined(__GNUC__)
+#define SLAB_THREAD_LOCAL __thread
+#else
+#define SLAB_THREAD_LOCAL
+#endif
+
+#define SLAB_ALIGN 16
+
+/* Block sizes; every class is a multiple of SLAB_ALIGN */
+static const size_t slab_class_size[SLAB_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512
+};
+
+typedef struct SlabFree {
+    struct SlabFree *next;
+} SlabFree;
+
+typedef struct SlabChunk {
+    struct SlabChunk *next;
+} SlabChunk;
+
+typedef struct {
+    SlabFree *free;             /* Returned blocks */
+    char *bump;                 /* Uncarved part of the newest chunk */
+    char *bump_end;
+} SlabClass;
+
+typedef struct {
+    SlabClass classes[SLAB_CLASS_COUNT];
+    SlabChunk *chunks;          /* Every chunk this thread carved */
+    SlabStats stats;
+} SlabContext;
+
+static SLAB_THREAD_LOCAL SlabContext slab_ctx;
+
+/* Chunk header rounded up so blocks stay aligned */
+#define SLAB_CHUNK_HEADER (((sizeof(SlabChunk) + SLAB_ALIGN - 1) / SLAB_ALIGN) * SLAB_ALIGN)
+
+#ifndef AMLP_NO_SLAB
+
+/**
+ * Size class for a request, or -1 if it is served by malloc()
+ */
+static int slab_class_of(size_t size) {
+    if (size == 0) size = 1;
+    if (size <= 128) return (int)((size - 1) / 16);
+    if (size <= 256) return 8 + (int)((size - 129) / 32);
+    if (size <= SLAB_MAX_SIZE) return 12 + (int)((size - 257) / 64);
+    return -1;
+}
+
+static int slab_refill(SlabContext *ctx, int cls) {
+    SlabChunk *chunk = (SlabChunk *)malloc(SLAB_CHUNK_SIZE);
+    if (!chunk) return -1;
+
+    chunk->next = ctx->chunks;
+    ctx->chunks = chunk;
+    ctx->classes[cls].bump = (char *)chunk + SLAB_CHUNK_HEADER;
+    ctx->classes[cls].bump_end = (char *)chunk + SLAB_CHUNK_SIZE;
+    ctx->stats.classes[cls].chunks++;
+    ctx->stats.chunk_bytes += SLAB_CHUNK_SIZE;
+    return 0;
+}
+
+void* slab_alloc(size_t size) {
+    SlabContext *ctx = &slab_ctx;
+    int cls = slab_class_of(size);
+
+    if (cls < 0) {
+        ctx->stats.large_allocs++;
+        return malloc(size);
+    }
+
+    SlabClass *sc = &ctx->classes[cls];
+    void *block;
+
+    if (sc->free) {
+        block = sc->free;
+        sc->free = sc->free->next;
+    } else {
+        size_t block_size = slab_class_size[cls];
+        if (!sc->bump || sc->bump + block_size > sc->bump_end) {
+            if (slab_refill(ctx, cls) != 0) return NULL;
+        }
+        block = sc->bump;
+        sc->bump += block_size;
+    }
+
+    ctx->stats.classes[cls].allocs++;
+    return block;
+}
+
+void slab_free(void *ptr, size_t size) {
+    if (!ptr) return;
+
+    SlabContext *ctx = &slab_ctx;
+    int cls = slab_class_of(size);
+
+    if (cls < 0) {
+        ctx->stats.large_frees++;
+        free(ptr);
+        return;
+    }
+
+    SlabFree *node = (SlabFree *)ptr;
+    node->next = ctx->classes[cls].free;
+    ctx->classes[cls].free = node;
+    ctx->stats.classes[cls].frees++;
+}
+
+#else /* AMLP_NO_SLAB */
+
+void* slab_alloc(size_t size) {
+    slab_ctx.stats.large_allocs++;
+    return malloc(size);
+}
+
+void slab_free(void *ptr, size_t size) {
+    (void)size;
+    if (!ptr) return;
+    slab_ctx.stats.large_frees++;
+    free(ptr);
+}
+
+#endif /* AMLP_NO_SLAB */
+
+void slab_get_stats(SlabStats *out) {
+    if (!out) return;
+
+    *out = slab_ctx.stats;
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        out->classes[i].size = slab_class_size[i];
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * slab.h - Size-Class Slab Allocator
+ *
+ * Small blocks for the GC, VM strings and GC headers. Requests up to
+ * SLAB_MAX_SIZE bytes are rounded up to one of SLAB_CLASS_COUNT size
+ * classes and carved from SLAB_CHUNK_SIZE chunks; larger ones go to
+ * malloc(). Blocks carry no header, so slab_free() must be given the
+ * size that was passed to slab_alloc().
+ *
+ * Free lists and statistics are per thread. A block freed by another
+ * thread joins that thread's free list. Chunks are kept for reuse while
+ * the process runs, which keeps small objects packed together instead
+ * of scattered across the malloc heap.
+ *
+ * Build with -DAMLP_NO_SLAB to route everything to malloc()/free(),
+ * for sanitizer runs or before/after comparisons.
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+/* ========== Constants ========== */
+
+#define SLAB_CLASS_COUNT 16
+#define SLAB_MAX_SIZE    512          /* Largest size served from a class */
+#define SLAB_CHUNK_SIZE  (64 * 1024)  /* Bytes carved per chunk */
+
+/* ========== Statistics ========== */
+
+typedef struct {
+    size_t size;                /* Block size of the class */
+    unsigned long allocs;       /* Blocks handed out */
+    unsigned long frees;        /* Blocks returned */
+    unsigned long chunks;       /* Chunks carved for the class */
+} SlabClassStats;
+
+typedef struct {
+    SlabClassStats classes[SLAB_CLASS_COUNT];
+    unsigned long large_allocs; /* Requests above SLAB_MAX_SIZE */
+    unsigned long large_frees;
+    size_t chunk_bytes;         /* Bytes held in chunks */
+} SlabStats;
+
+/* ========== Allocation ========== */
+
+/**
+ * Allocate a block
+ *
+ * @param size Size in bytes
+ * @return Block aligned for any VM type, or NULL on failure
+ */
+void* slab_alloc(size_t size);
+
+/**
+ * Return a block
+ *
+ * @param ptr Block from slab_alloc(), or NULL
+ * @param size Size passed to slab_alloc()
+ */
+void slab_free(void *ptr, size_t size);
+
+/**
+ * Copy the calling thread's statistics
+ *
+ * @param out Receives the statistics
+ */
+void slab_get_stats(SlabStats *out);
+
+#endif /* SLAB_H */
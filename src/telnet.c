@@ -0,0 +1,68 @@
+/**
+ * telnet.c - Telnet Command Filtering Implementation
+ */
+
+#include "telnet.h"
+
+enum {
+    TELNET_STATE_DATA,
+    TELNET_STATE_IAC,           /* After IAC */
+    TELNET_STATE_OPTION,        /* After IAC WILL/WONT/DO/DONT */
+    TELNET_STATE_SB,            /* Inside a subnegotiation */
+    TELNET_STATE_SB_IAC         /* IAC inside a subnegotiation */
+};
+
+void telnet_init(TelnetState *state) {
+    if (!state) return;
+    state->state = TELNET_STATE_DATA;
+    state->verb = 0;
+}
+
+size_t telnet_filter(TelnetState *state, char *data, size_t len,
+                     TelnetOptionCallback on_option, void *ctx) {
+    if (!state || !data) return 0;
+    size_t out = 0;
+    
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)data[i];
+        
+        switch (state->state) {
+            case TELNET_STATE_DATA:
+                if (c == TELNET_IAC) {
+                    state->state = TELNET_STATE_IAC;
+                } else {
+                    data[out++] = (char)c;
+                }
+                break;
+                
+            case TELNET_STATE_IAC:
+                if (c == TELNET_IAC) {
+                    data[out++] = (char)c;
+                    state->state = TELNET_STATE_DATA;
+                } else if (c >= TELNET_WILL && c <= TELNET_DONT) {
+                    state->verb = c;
+                    state->state = TELNET_STATE_OPTION;
+                } else if (c == TELNET_SB) {
+                    state->state = TELNET_STATE_SB;
+                } else {
+                    /* Two-byte commands (NOP, AYT, GA, ...) are ignored */
+                    state->state = TELNET_STATE_DATA;
+                }
+                break;
+                
+            case TELNET_STATE_OPTION:
+                state->state = TELNET_STATE_DATA;
+                if (on_option) on_option(ctx, state->verb, c);
+                break;
+                
+            case TELNET_STATE_SB:
+                if (c == TELNET_IAC) state->state = TELNET_STATE_SB_IAC;
+                break;
+                
+            case TELNET_STATE_SB_IAC:
+                state->state = c == TELNET_SE ? TELNET_STATE_DATA : TELNET_STATE_SB;
+                break;
+        }
+    }
+    return out;
+}
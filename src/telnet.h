@@ -0,0 +1,61 @@
+/**
+ * telnet.h - Telnet Command Filtering
+ *
+ * Telnet clients interleave IAC commands with what the player types.
+ * telnet_filter() strips them from each read in place, remembering where
+ * it was when a command is split across reads, and reports option
+ * negotiation (IAC WILL/WONT/DO/DONT <option>) through a callback. An
+ * escaped IAC IAC is kept as one 255 byte; subnegotiations are dropped.
+ */
+
+#ifndef TELNET_H
+#define TELNET_H
+
+#include <stddef.h>
+
+/* ========== Constants ========== */
+
+#define TELNET_IAC  255
+#define TELNET_DONT 254
+#define TELNET_DO   253
+#define TELNET_WONT 252
+#define TELNET_WILL 251
+#define TELNET_SB   250
+#define TELNET_SE   240
+
+#define TELOPT_COMPRESS2 86     /* MCCP2 */
+
+/* ========== Types ========== */
+
+typedef struct {
+    int state;                  /* Where the last read left off */
+    int verb;                   /* WILL/WONT/DO/DONT awaiting its option */
+} TelnetState;
+
+/**
+ * Option negotiation callback
+ *
+ * @param ctx Caller's context
+ * @param verb TELNET_WILL, TELNET_WONT, TELNET_DO or TELNET_DONT
+ * @param option Option code
+ */
+typedef void (*TelnetOptionCallback)(void *ctx, int verb, int option);
+
+/* ========== Functions ========== */
+
+void telnet_init(TelnetState *state);
+
+/**
+ * Strip telnet commands from received bytes in place
+ *
+ * @param state Filter state, carried between reads
+ * @param data Received bytes
+ * @param len Number of bytes
+ * @param on_option Called for each negotiation, may be NULL
+ * @param ctx Passed to on_option
+ * @return Number of data bytes left at the front of data
+ */
+size_t telnet_filter(TelnetState *state, char *data, size_t len,
+                     TelnetOptionCallback on_option, void *ctx);
+
+#endif /* TELNET_H */
@@ -0,0 +1,147 @@
+/**
+ * timer_wheel.c - Hierarchical Timing Wheel Implementation
+ *
+ * Each slot is a doubly linked list threaded through pprev, so a timer
+ * can be unlinked without knowing which list holds it. Running or
+ * cascading a slot detaches its list first; timers that are not yet due
+ * go back into the wheel, and callbacks can safely touch any other timer.
+ */
+
+#include "timer_wheel.h"
+#include <string.h>
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_SPAN (1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+static void timer_link(TimerEntry **head, TimerEntry *timer) {
+    timer->next = *head;
+    if (timer->next) timer->next->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void timer_unlink(TimerEntry *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/*
+ * File a timer by its distance from the next tick. Due timers go in the
+ * next level-0 slot the wheel will visit; deadlines past the span are
+ * parked in the last slot the top level can reach.
+ */
+static void timer_insert(TimerWheel *wheel, TimerEntry *timer) {
+    unsigned long base = wheel->now + 1;
+    unsigned long tick = timer->expires > base ? timer->expires : base;
+    if (tick - base >= TIMER_WHEEL_SPAN) tick = base + TIMER_WHEEL_SPAN - 1;
+
+    unsigned long delta = tick - base;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1UL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    size_t slot = (tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    timer_link(&wheel->slots[level][slot], timer);
+}
+
+/* Move a slot's list to a local head so refiling can't revisit it */
+static TimerEntry *timer_detach(TimerEntry **slot, TimerEntry **head) {
+    *head = *slot;
+    if (*head) (*head)->pprev = head;
+    *slot = NULL;
+    return *head;
+}
+
+/*
+ * Refile every timer in one slot of an upper level. Runs before wheel->now
+ * moves to tick, so timers due at tick land in the slot about to run.
+ */
+static void timer_cascade(TimerWheel *wheel, int level, unsigned long tick) {
+    size_t slot = (tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    TimerEntry *pending;
+    timer_detach(&wheel->slots[level][slot], &pending);
+
+    while (pending) {
+        TimerEntry *timer = pending;
+        timer_unlink(timer);
+        timer_insert(wheel, timer);
+    }
+}
+
+void timer_wheel_init(TimerWheel *wheel, unsigned long now) {
+    if (!wheel) return;
+    memset(wheel->slots, 0, sizeof(wheel->slots));
+    wheel->now = now;
+    wheel->count = 0;
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *timer, unsigned long expires,
+                     TimerCallback callback, void *ctx) {
+    if (!wheel || !timer) return;
+
+    if (timer->pprev) {
+        timer_unlink(timer);
+    } else {
+        wheel->count++;
+    }
+
+    timer->expires = expires;
+    timer->callback = callback;
+    timer->ctx = ctx;
+    timer_insert(wheel, timer);
+}
+
+void timer_wheel_remove(TimerWheel *wheel, TimerEntry *timer) {
+    if (!wheel || !timer || !timer->pprev) return;
+    timer_unlink(timer);
+    wheel->count--;
+}
+
+int timer_wheel_pending(const TimerEntry *timer) {
+    return timer && timer->pprev != NULL;
+}
+
+int timer_wheel_advance(TimerWheel *wheel, unsigned long now) {
+    if (!wheel || now <= wheel->now) return 0;
+
+    int fired = 0;
+    while (wheel->now < now) {
+        /* Nothing armed: nothing to cascade either */
+        if (wheel->count == 0) {
+            wheel->now = now;
+            break;
+        }
+
+        /* Each time a level wraps, the next level's slot is cascaded down */
+        unsigned long tick = wheel->now + 1;
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            unsigned long mask = (1UL << (TIMER_WHEEL_BITS * level)) - 1;
+            if (tick & mask) break;
+            timer_cascade(wheel, level, tick);
+        }
+        wheel->now = tick;
+
+        TimerEntry *pending;
+        timer_detach(&wheel->slots[0][wheel->now & TIMER_WHEEL_MASK], &pending);
+
+        while (pending) {
+            TimerEntry *timer = pending;
+            timer_unlink(timer);
+
+            if (timer->expires > wheel->now) {
+                timer_insert(wheel, timer);
+                continue;
+            }
+
+            wheel->count--;
+            fired++;
+            if (timer->callback) timer->callback(timer, timer->ctx);
+        }
+    }
+
+    return fired;
+}
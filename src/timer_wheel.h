@@ -0,0 +1,96 @@
+/**
+ * timer_wheel.h - Hierarchical Timing Wheel
+ *
+ * Deadlines are whole ticks. The wheel has TIMER_WHEEL_LEVELS rings of
+ * TIMER_WHEEL_SLOTS slots; level 0 holds timers due within one lap, and
+ * each level above covers TIMER_WHEEL_SLOTS times the span of the one
+ * below. When level 0 wraps, the matching slot of the next level is
+ * cascaded down, so advancing one tick costs the timers in one slot
+ * rather than every pending timer, however far out the deadlines are.
+ * Deadlines beyond the top level are parked at its edge and re-filed
+ * until they come due.
+ *
+ * Timers are intrusive: embed a TimerEntry in the owning structure and
+ * recover the owner in the callback. The wheel allocates nothing.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+
+/* ========== Constants ========== */
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)   /* Slots per level; one lap of level 0 */
+#define TIMER_WHEEL_LEVELS 4                         /* Span of SLOTS^LEVELS ticks */
+
+/* ========== Types ========== */
+
+typedef struct TimerEntry TimerEntry;
+
+/**
+ * Expiry callback. The entry is already unlinked, so the callback may
+ * re-add it, remove other timers or free the owner.
+ */
+typedef void (*TimerCallback)(TimerEntry *timer, void *ctx);
+
+struct TimerEntry {
+    TimerEntry *next;
+    TimerEntry **pprev;         /* Link pointing at this entry; NULL when idle */
+    unsigned long expires;      /* Tick the timer is due */
+    TimerCallback callback;
+    void *ctx;
+};
+
+typedef struct {
+    TimerEntry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    unsigned long now;          /* Last tick processed */
+    size_t count;               /* Pending timers */
+} TimerWheel;
+
+/* ========== Wheel ========== */
+
+/**
+ * Initialize a wheel
+ *
+ * @param wheel Wheel to initialize
+ * @param now Current tick
+ */
+void timer_wheel_init(TimerWheel *wheel, unsigned long now);
+
+/**
+ * Arm a timer, or move it if it is already pending
+ *
+ * @param wheel Wheel
+ * @param timer Timer to arm
+ * @param expires Tick to fire at; past ticks fire on the next advance
+ * @param callback Called when the timer expires
+ * @param ctx Passed to callback
+ */
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *timer, unsigned long expires,
+                     TimerCallback callback, void *ctx);
+
+/**
+ * Disarm a timer; harmless if it is not pending
+ */
+void timer_wheel_remove(TimerWheel *wheel, TimerEntry *timer);
+
+/**
+ * Check whether a timer is armed
+ */
+int timer_wheel_pending(const TimerEntry *timer);
+
+/**
+ * Advance the wheel and fire every timer due by now
+ *
+ * Ticks are processed in order, so a callback sees wheel->now set to the
+ * tick its timer was due.
+ *
+ * @param wheel Wheel
+ * @param now Current tick; going backwards is a no-op
+ * @return Number of timers fired
+ */
+int timer_wheel_advance(TimerWheel *wheel, unsigned long now);
+
+#endif /* TIMER_WHEEL_H */
@@ -11,13 +11,17 @@
 #include "vm.h"
 #include "efun.h"
 #include "object.h"
+#include "object_program.h"
 #include "debug.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <math.h>
+#include <stdarg.h>
 #include "array.h"
 #include "mapping.h"
+#include "slab.h"
 
 /* ========== Constants ========== */
 
@@ -27,9 +31,29 @@
 #define VM_STRING_POOL_INIT 128
 #define VM_MAPPING_BUCKETS  16
 
+/* Threaded dispatch needs GCC's labels-as-values; build with
+ * -DVM_NO_THREADED_DISPATCH to force the portable switch loop */
+#if defined(__GNUC__) && !defined(VM_NO_THREADED_DISPATCH)
+#define VM_THREADED_DISPATCH 1
+#else
+#define VM_THREADED_DISPATCH 0
+#endif
+
+static void vm_prepare_function(VMFunction *function);
+
+/* ========== Strings ========== */
+
+#define VM_STRING_HASHED    0x1u    /* hash is valid */
+#define VM_STRING_INTERNED  0x2u    /* Listed in the intern table */
+#define VM_STRING_STATIC    0x4u    /* Holds a reference that is never dropped */
+
+#define VM_INTERN_INITIAL_CAPACITY 1024
+
 typedef struct {
     int refcount;
-    size_t length;
+    unsigned int hash;          /* Valid once VM_STRING_HASHED is set */
+    unsigned int length;
+    unsigned int flags;
     char data[];
 } VMStringHeader;
 
@@ -37,20 +61,207 @@ static VMStringHeader *vm_string_header(const char *data) {
     return (VMStringHeader *)((char *)data - offsetof(VMStringHeader, data));
 }
 
+static size_t vm_string_block_size(size_t len) {
+    return sizeof(VMStringHeader) + len + 1;
+}
+
 static char *vm_string_create(const char *value, size_t len) {
-    VMStringHeader *hdr = (VMStringHeader *)malloc(sizeof(VMStringHeader) + len + 1);
+    if (len > UINT_MAX) return NULL;
+    VMStringHeader *hdr = (VMStringHeader *)slab_alloc(vm_string_block_size(len));
     if (!hdr) return NULL;
     hdr->refcount = 1;
-    hdr->length = len;
+    hdr->hash = 0;
+    hdr->length = (unsigned int)len;
+    hdr->flags = 0;
     memcpy(hdr->data, value, len);
     hdr->data[len] = '\0';
     return hdr->data;
 }
 
+static unsigned int vm_hash_bytes(const char *str, size_t len) {
+    unsigned int hash = 0;
+    for (size_t i = 0; i < len; i++) {
+        hash = ((hash << 5) + hash) ^ (unsigned char)str[i];
+    }
+    return hash;
+}
+
+unsigned int vm_hash_cstring(const char *str) {
+    return str ? vm_hash_bytes(str, strlen(str)) : 0;
+}
+
+unsigned int vm_string_hash(const char *str) {
+    if (!str) return 0;
+
+    VMStringHeader *hdr = vm_string_header(str);
+    if (!(hdr->flags & VM_STRING_HASHED)) {
+        hdr->hash = vm_hash_bytes(hdr->data, hdr->length);
+        hdr->flags |= VM_STRING_HASHED;
+    }
+    return hdr->hash;
+}
+
+int vm_string_is_interned(const char *str) {
+    return str && (vm_string_header(str)->flags & VM_STRING_INTERNED) != 0;
+}
+
+/* ========== Intern Table ==========
+ * Open addressing over header pointers, keyed by the cached hash. The
+ * table holds no reference: a string leaves it when its last reference
+ * is released. Process-wide and not thread-safe, like the object
+ * manager. */
+
+static VMStringHeader **intern_slots = NULL;
+static unsigned int intern_capacity = 0;
+static unsigned int intern_count = 0;
+
+static int vm_intern_grow(void) {
+    unsigned int capacity = intern_capacity ? intern_capacity * 2 : VM_INTERN_INITIAL_CAPACITY;
+    VMStringHeader **slots = (VMStringHeader **)calloc(capacity, sizeof(VMStringHeader *));
+    if (!slots) return -1;
+
+    for (unsigned int i = 0; i < intern_capacity; i++) {
+        VMStringHeader *hdr = intern_slots[i];
+        if (!hdr) continue;
+        unsigned int pos = hdr->hash & (capacity - 1);
+        while (slots[pos]) pos = (pos + 1) & (capacity - 1);
+        slots[pos] = hdr;
+    }
+
+    free(intern_slots);
+    intern_slots = slots;
+    intern_capacity = capacity;
+    return 0;
+}
+
+/**
+ * Find the interned copy of str, or the empty slot where it belongs
+ */
+static unsigned int vm_intern_probe(const char *str, size_t len, unsigned int hash) {
+    unsigned int mask = intern_capacity - 1;
+    unsigned int pos = hash & mask;
+    while (intern_slots[pos]) {
+        VMStringHeader *hdr = intern_slots[pos];
+        if (hdr->hash == hash && hdr->length == len && memcmp(hdr->data, str, len) == 0) {
+            break;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+/* Backward-shift delete keeps every probe sequence unbroken */
+static void vm_intern_remove(VMStringHeader *hdr) {
+    unsigned int mask = intern_capacity - 1;
+    unsigned int pos = hdr->hash & mask;
+    while (intern_slots[pos] && intern_slots[pos] != hdr) {
+        pos = (pos + 1) & mask;
+    }
+    if (!intern_slots[pos]) return;
+
+    unsigned int hole = pos;
+    for (unsigned int next = (hole + 1) & mask; intern_slots[next]; next = (next + 1) & mask) {
+        unsigned int home = intern_slots[next]->hash & mask;
+        /* Move next into the hole unless its home lies in (hole, next] */
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            intern_slots[hole] = intern_slots[next];
+            hole = next;
+        }
+    }
+    intern_slots[hole] = NULL;
+    intern_count--;
+}
+
+static char *vm_intern_bytes(const char *str, size_t len, unsigned int hash) {
+    /* Keep load factor under 1/2 */
+    if ((intern_count + 1) * 2 > intern_capacity && vm_intern_grow() != 0) {
+        return NULL;
+    }
+
+    unsigned int pos = vm_intern_probe(str, len, hash);
+    if (intern_slots[pos]) {
+        intern_slots[pos]->refcount++;
+        return intern_slots[pos]->data;
+    }
+
+    char *data = vm_string_create(str, len);
+    if (!data) return NULL;
+
+    VMStringHeader *hdr = vm_string_header(data);
+    hdr->hash = hash;
+    hdr->flags = VM_STRING_HASHED | VM_STRING_INTERNED;
+    intern_slots[pos] = hdr;
+    intern_count++;
+
+    VMValue v;
+    v.type = VALUE_STRING;
+    v.data.string_value = data;
+    vm_profile_note_create(v, len + 1);
+    return data;
+}
+
+char* vm_string_intern(const char *str) {
+    if (!str) return NULL;
+    size_t len = strlen(str);
+    return vm_intern_bytes(str, len, vm_hash_bytes(str, len));
+}
+
+const char* vm_string_intern_static(const char *str) {
+    char *interned = vm_string_intern(str);
+    if (!interned) return NULL;
+
+    VMStringHeader *hdr = vm_string_header(interned);
+    if (hdr->flags & VM_STRING_STATIC) {
+        hdr->refcount--;    /* Already holds its permanent reference */
+    } else {
+        hdr->flags |= VM_STRING_STATIC;
+    }
+    return interned;
+}
+
+int vm_string_intern_count(void) {
+    return (int)intern_count;
+}
+
+void vm_string_addref(const char *str) {
+    if (str) vm_string_header(str)->refcount++;
+}
+
+void vm_string_release(const char *str) {
+    if (!str) return;
+
+    VMStringHeader *hdr = vm_string_header(str);
+    if (--hdr->refcount > 0) return;
+
+    if (hdr->flags & VM_STRING_INTERNED) {
+        vm_intern_remove(hdr);
+    }
+
+    VMValue v;
+    v.type = VALUE_STRING;
+    v.data.string_value = hdr->data;
+    vm_profile_note_free(v, hdr->length + 1);
+    slab_free(hdr, vm_string_block_size(hdr->length));
+}
+
+int vm_string_equal(const char *a, const char *b) {
+    if (a == b) return 1;
+    if (!a || !b) return 0;
+
+    VMStringHeader *ha = vm_string_header(a);
+    VMStringHeader *hb = vm_string_header(b);
+    if (ha->flags & hb->flags & VM_STRING_INTERNED) return 0;
+    if (ha->length != hb->length) return 0;
+    if (vm_string_hash(a) != vm_string_hash(b)) return 0;
+    return memcmp(a, b, ha->length) == 0;
+}
+
 /**
  * Initialize the virtual machine
  */
 VirtualMachine* vm_init(void) {
+    log_init();
+
     VirtualMachine *vm = (VirtualMachine *)malloc(sizeof(VirtualMachine));
     if (!vm) {
         FATAL_LOG("Memory allocation failed for VM");
@@ -66,15 +277,32 @@ VirtualMachine* vm_init(void) {
     vm->stack->capacity = VM_STACK_SIZE;
     vm->stack->values = (VMValue *)malloc(sizeof(VMValue) * vm->stack->capacity);
     vm->stack->top = 0;
+
+    /* Frames are carved out of one block; locals live on the value stack */
+    vm->frames = (CallFrame *)malloc(sizeof(CallFrame) * VM_MAX_CALL_DEPTH);
+    if (!vm->stack->values || !vm->frames) {
+        FATAL_LOG("Memory allocation failed for VM stacks");
+        free(vm->stack->values);
+        free(vm->stack);
+        free(vm->frames);
+        free(vm);
+        return NULL;
+    }
     
     /* Initialize all stack values */
     for (int i = 0; i < vm->stack->capacity; i++) {
         vm->stack->values[i].type = VALUE_UNINITIALIZED;
     }
-
+    vm->frame_count = 0;
     vm->current_frame = NULL;
     vm->running = 0;
     vm->error_count = 0;
+    vm->last_error[0] = '\0';
+    vm->current_object = NULL;
+    vm->program_cache = NULL;
+    
+    const char *opt_level = getenv("AMLP_OPT_LEVEL");
+    vm->opt_level = opt_level ? atoi(opt_level) : VM_OPT_DEFAULT;
     
     vm->efun_registry = efun_init();
     if (!vm->efun_registry) {
@@ -88,6 +316,7 @@ VirtualMachine* vm_init(void) {
     
     vm->function_capacity = VM_FUNCTIONS_INIT;
     vm->function_count = 0;
+    vm->call_generation = 0;
     vm->functions = (VMFunction **)malloc(sizeof(VMFunction *) * vm->function_capacity);
     
     vm->global_capacity = VM_GLOBALS_INIT;
@@ -101,9 +330,7 @@ VirtualMachine* vm_init(void) {
     vm->string_pool_count = 0;
     vm->string_pool = (char **)malloc(sizeof(char *) * vm->string_pool_capacity);
     
-    vm->instructions = NULL;
-    vm->instruction_count = 0;
-    vm->instruction_capacity = 0;
+    vm->toplevel = NULL;
     vm->instruction_pointer = 0;
 
     vm->debug_flags = 0;
@@ -116,6 +343,7 @@ VirtualMachine* vm_init(void) {
         vm_free(vm);
         return NULL;
     }
+    vm_gc_attach(vm);
 
     vm_debug_init(vm);
 
@@ -142,12 +370,27 @@ int vm_load_program(VirtualMachine *vm, ASTNode *program) {
 int vm_load_bytecode(VirtualMachine *vm, VMInstruction *instructions, int count) {
     if (!vm || !instructions || count <= 0) return -1;
     
-    vm->instruction_capacity = count;
-    vm->instructions = (VMInstruction *)malloc(sizeof(VMInstruction) * count);
-    if (!vm->instructions) return -1;
+    VMFunction *toplevel = vm_function_create("<toplevel>", 0, 0);
+    if (!toplevel) return -1;
+    for (int i = 0; i < count; i++) {
+        if (vm_function_add_instruction(toplevel, instructions[i]) < 0) {
+            vm_function_free(toplevel);
+            return -1;
+        }
+    }
     
-    memcpy(vm->instructions, instructions, sizeof(VMInstruction) * count);
-    vm->instruction_count = count;
+    return vm_load_toplevel(vm, toplevel);
+}
+
+int vm_load_toplevel(VirtualMachine *vm, VMFunction *toplevel) {
+    if (!vm || !toplevel) return -1;
+    
+    vm_prepare_function(toplevel);
+    if (vm->toplevel) {
+        vm_function_free(vm->toplevel);
+    }
+    vm->toplevel = toplevel;
+    vm->instruction_pointer = 0;
     
     return 0;
 }
@@ -164,10 +407,83 @@ int vm_add_function(VirtualMachine *vm, VMFunction *function) {
                                                 sizeof(VMFunction *) * vm->function_capacity);
     }
     
+    vm_prepare_function(function);
     vm->functions[vm->function_count] = function;
+    function->index = vm->function_count;
+    /* A new definition may shadow a name some call site has cached */
+    vm->call_generation++;
     return vm->function_count++;
 }
 
+int vm_find_function(VirtualMachine *vm, const char *name) {
+    if (!vm || !name) return -1;
+
+    for (int i = vm->function_count - 1; i >= 0; i--) {
+        if (vm->functions[i] && strcmp(vm->functions[i]->name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Bind a single OP_CALL site. Functions in [first, first+count) belong to
+ * the caller's program and are bound permanently; anything found outside
+ * that range is cached against the current call generation.
+ */
+static int vm_resolve_call(VirtualMachine *vm, VMCallSite *site, int first, int count) {
+    const char *name = site->name;
+    if (!name) return -1;
+
+    if (vm->efun_registry) {
+        EfunEntry *efun_entry = efun_find(vm->efun_registry, name);
+        if (efun_entry) {
+            site->link = VM_CALL_EFUN;
+            site->target = (int)(efun_entry - vm->efun_registry->efuns);
+            return 0;
+        }
+    }
+
+    for (int i = first; i < first + count; i++) {
+        if (vm->functions[i] && strcmp(vm->functions[i]->name, name) == 0) {
+            site->link = VM_CALL_LOCAL;
+            site->target = i;
+            return 0;
+        }
+    }
+
+    int idx = vm_find_function(vm, name);
+    if (idx < 0) return -1;
+
+    site->link = VM_CALL_CACHED;
+    site->target = idx;
+    site->generation = vm->call_generation;
+    return 0;
+}
+
+int vm_link_calls(VirtualMachine *vm, int first, int count) {
+    if (!vm || first < 0 || count < 0 || first + count > vm->function_count) return -1;
+
+    int unresolved = 0;
+    for (int f = first; f < first + count; f++) {
+        VMFunction *func = vm->functions[f];
+        if (!func) continue;
+
+        for (int i = 0; i < func->call_site_count; i++) {
+            VMCallSite *site = &func->call_sites[i];
+            if (!site->name) continue;
+
+            if (vm_resolve_call(vm, site, first, count) != 0) {
+                site->link = VM_CALL_UNLINKED;
+                unresolved++;
+            }
+        }
+    }
+
+    return unresolved;
+}
+
 /**
  * Value creation functions
  */
@@ -201,6 +517,25 @@ VMValue vm_value_create_string(const char *value) {
     return v;
 }
 
+VMValue vm_value_create_interned(const char *value) {
+    VMValue v;
+    v.type = VALUE_STRING;
+    v.data.string_value = vm_string_intern(value ? value : "");
+    return v;
+}
+
+void vm_value_intern(VMValue *value) {
+    if (!value || value->type != VALUE_STRING || !value->data.string_value) return;
+    if (vm_string_is_interned(value->data.string_value)) return;
+
+    const char *str = value->data.string_value;
+    char *interned = vm_intern_bytes(str, vm_string_header(str)->length, vm_string_hash(str));
+    if (!interned) return;
+
+    vm_string_release(str);
+    value->data.string_value = interned;
+}
+
 VMValue vm_value_create_null(void) {
     VMValue v;
     v.type = VALUE_NULL;
@@ -220,13 +555,7 @@ void vm_value_release(VMValue *value) {
     if (!value) return;
     if (value->type != VALUE_STRING || !value->data.string_value) return;
 
-    VMStringHeader *hdr = vm_string_header(value->data.string_value);
-    hdr->refcount--;
-    if (hdr->refcount <= 0) {
-        vm_profile_note_free(*value, hdr->length + 1);
-        free(hdr);
-    }
-
+    vm_string_release(value->data.string_value);
     value->data.string_value = NULL;
     value->type = VALUE_UNINITIALIZED;
 }
@@ -319,7 +648,10 @@ VMValue vm_value_clone(VMValue value) {
 
     switch (value.type) {
         case VALUE_STRING:
-            if (value.data.string_value) {
+            /* Interned strings are immutable and shared; others are copied */
+            if (vm_string_is_interned(value.data.string_value)) {
+                vm_string_addref(value.data.string_value);
+            } else if (value.data.string_value) {
                 copy = vm_value_create_string(value.data.string_value);
             }
             break;
@@ -348,39 +680,355 @@ VMValue vm_value_clone(VMValue value) {
  * Function operations
  */
 VMFunction* vm_function_create(const char *name, int param_count, int local_var_count) {
-    VMFunction *func = (VMFunction *)malloc(sizeof(VMFunction));
-    func->name = (char *)malloc(strlen(name) + 1);
-    strcpy(func->name, name);
+    VMFunction *func = (VMFunction *)calloc(1, sizeof(VMFunction));
+    if (!func) return NULL;
+    func->name = strdup(name);
     func->param_count = param_count;
     func->local_var_count = local_var_count;
-    func->instruction_count = 0;
-    func->instruction_capacity = 32;
-    func->instructions = (VMInstruction *)malloc(sizeof(VMInstruction) * func->instruction_capacity);
-    func->source_file = NULL;
-    func->line_map = NULL;
-    func->line_map_count = 0;
+    func->index = -1;
     
     return func;
 }
 
+/* Grow a table to hold at least @needed items; NULL (table intact) on failure */
+static void *vm_grow(void *items, int *capacity, int needed, size_t item_size) {
+    if (items && needed <= *capacity) return items;
+    
+    int new_capacity = *capacity > 0 ? *capacity : 16;
+    while (new_capacity < needed) new_capacity *= 2;
+    void *grown = realloc(items, item_size * new_capacity);
+    if (!grown) return NULL;
+    *capacity = new_capacity;
+    return grown;
+}
+
+int vm_code_branch_target(VMCode word) {
+    switch (VM_CODE_OP(word)) {
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+            return VM_CODE_IMM(word);
+        case OP_CMP_JUMP_IF_FALSE:
+            return VM_CODE_HI(word);
+        default:
+            return -1;
+    }
+}
+
+int vm_code_retarget(VMCode *word, int target) {
+    OpCode opcode = VM_CODE_OP(*word);
+    switch (opcode) {
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+            /* Negative targets mark forward references still to be patched */
+            if (target < VM_IMM24_MIN || target >= VM_IMM24_LIMIT) return -1;
+            *word = VM_CODE(opcode, target);
+            return 0;
+        case OP_CMP_JUMP_IF_FALSE:
+            if (target < 0 || target >= VM_SITE_LIMIT) return -1;
+            *word = VM_CODE_PAIR(opcode, VM_CODE_LO(*word), target);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static int vm_function_append(VMFunction *function, VMCode word) {
+    /* Always keep one slot past the end for the sentinel */
+    VMCode *code = (VMCode *)vm_grow(function->code, &function->instruction_capacity,
+                                     function->instruction_count + 2, sizeof(VMCode));
+    if (!code) return -1;
+    function->code = code;
+    
+    int index = function->instruction_count++;
+    code[index] = word;
+    code[function->instruction_count] = VM_CODE(OP_RETURN, 0);
+    
+    /* A loaded function's jumps were validated against the old length */
+    if (function->index >= 0 && vm_code_branch_target(word) >= 0) {
+        vm_prepare_function(function);
+    }
+    return index;
+}
+
+int vm_function_emit(VMFunction *function, OpCode opcode, long imm) {
+    if (!function || (unsigned)opcode >= VM_OPCODE_COUNT) return -1;
+    if (imm < VM_IMM24_MIN || imm >= VM_IMM24_LIMIT) return -1;
+    
+    return vm_function_append(function, VM_CODE(opcode, imm));
+}
+
+/* Add @value to the constant table (taking its reference), reusing an
+ * equal entry when there is one. String constants are interned, so equal
+ * literals share one copy across every loaded program. */
+static int vm_function_add_constant(VMFunction *function, VMValue value) {
+    vm_value_intern(&value);
+    
+    for (int i = 0; i < function->constant_count; i++) {
+        VMValue *c = &function->constants[i];
+        if (c->type != value.type) continue;
+        if ((value.type == VALUE_INT && c->data.int_value == value.data.int_value) ||
+            (value.type == VALUE_FLOAT && c->data.float_value == value.data.float_value) ||
+            (value.type == VALUE_STRING && vm_string_equal(c->data.string_value, value.data.string_value))) {
+            vm_value_release(&value);
+            return i;
+        }
+    }
+    
+    if (function->constant_count >= VM_IMM24_LIMIT) return -1;
+    VMValue *constants = (VMValue *)vm_grow(function->constants, &function->constant_capacity,
+                                            function->constant_count + 1, sizeof(VMValue));
+    if (!constants) return -1;
+    function->constants = constants;
+    constants[function->constant_count] = value;
+    return function->constant_count++;
+}
+
+int vm_function_emit_constant(VMFunction *function, OpCode opcode, VMValue value) {
+    if (!function) return -1;
+    
+    int idx = vm_function_add_constant(function, value);
+    if (idx < 0) {
+        vm_value_release(&value);
+        return -1;
+    }
+    return vm_function_emit(function, opcode, idx);
+}
+
+int vm_function_emit_int(VMFunction *function, long value) {
+    if (value >= VM_IMM24_MIN && value <= VM_IMM24_MAX) {
+        return vm_function_emit(function, OP_PUSH_INT, value);
+    }
+    return vm_function_emit_constant(function, OP_PUSH_CONST, vm_value_create_int(value));
+}
+
+int vm_function_emit_call(VMFunction *function, const char *name, int arg_count, int target) {
+    if (!function || arg_count < 0 || arg_count >= VM_ARGC_LIMIT) return -1;
+    if (function->call_site_count >= VM_SITE_LIMIT) return -1;
+    
+    VMCallSite *sites = (VMCallSite *)vm_grow(function->call_sites, &function->call_site_capacity,
+                                              function->call_site_count + 1, sizeof(VMCallSite));
+    if (!sites) return -1;
+    function->call_sites = sites;
+    
+    VMCallSite *site = &sites[function->call_site_count];
+    site->name = name ? strdup(name) : NULL;
+    site->target = target;
+    /* Calls by index are bound from the start */
+    site->link = name ? VM_CALL_UNLINKED : VM_CALL_LOCAL;
+    site->generation = 0;
+    site->slot = 0;
+    
+    return vm_function_append(function, VM_CODE_CALL(OP_CALL, arg_count, function->call_site_count++));
+}
+
+int vm_function_emit_call_method(VMFunction *function, int arg_count) {
+    if (!function || arg_count < 0 || arg_count >= VM_ARGC_LIMIT) return -1;
+    if (function->method_cache_count >= VM_SITE_LIMIT) return -1;
+    
+    int capacity = function->method_cache_count;
+    VMMethodCache *caches = (VMMethodCache *)vm_grow(function->method_caches, &capacity,
+                                                     function->method_cache_count + 1,
+                                                     sizeof(VMMethodCache));
+    if (!caches) return -1;
+    function->method_caches = caches;
+    memset(&caches[function->method_cache_count], 0, sizeof(VMMethodCache));
+    
+    return vm_function_append(function, VM_CODE_CALL(OP_CALL_METHOD, arg_count,
+                                                     function->method_cache_count++));
+}
+
 int vm_function_add_instruction(VMFunction *function, VMInstruction instruction) {
     if (!function) return -1;
     
-    if (function->instruction_count >= function->instruction_capacity) {
-        function->instruction_capacity *= 2;
-        function->instructions = (VMInstruction *)realloc(function->instructions,
-                                                          sizeof(VMInstruction) * function->instruction_capacity);
+    switch (instruction.opcode) {
+        case OP_PUSH_INT:
+            return vm_function_emit_int(function, instruction.operand.int_operand);
+        case OP_PUSH_FLOAT:
+            return vm_function_emit_constant(function, OP_PUSH_FLOAT,
+                                             vm_value_create_float(instruction.operand.float_operand));
+        case OP_PUSH_STRING: {
+            const char *str = instruction.operand.string_operand;
+            return vm_function_emit_constant(function, OP_PUSH_STRING,
+                                             vm_value_create_string(str ? str : ""));
+        }
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+            return vm_function_emit(function, instruction.opcode, instruction.operand.address_operand);
+        case OP_CALL:
+            return vm_function_emit_call(function, instruction.operand.call_operand.name,
+                                         instruction.operand.call_operand.arg_count,
+                                         instruction.operand.call_operand.target);
+        case OP_CALL_METHOD:
+            return vm_function_emit_call_method(function, (int)instruction.operand.int_operand);
+        case OP_LOAD_LOCAL:
+        case OP_STORE_LOCAL:
+        case OP_LOAD_GLOBAL:
+        case OP_STORE_GLOBAL:
+        case OP_MAKE_ARRAY:
+        case OP_MAKE_MAPPING:
+        case OP_PUSH_INT_ADD:
+        case OP_INC_LOCAL:
+        case OP_LOAD_LOCAL_LOAD_LOCAL:
+        case OP_CMP_JUMP_IF_FALSE:
+        case OP_RETURN_LOCAL:
+            return vm_function_emit(function, instruction.opcode, instruction.operand.int_operand);
+        case OP_PUSH_CONST:
+            return -1;  /* Only produced by packing a wide PUSH_INT */
+        default:
+            return vm_function_emit(function, instruction.opcode, 0);
     }
+}
+
+int vm_function_patch_jump(VMFunction *function, int index, int target) {
+    if (!function || index < 0 || index >= function->instruction_count) return -1;
     
-    function->instructions[function->instruction_count++] = instruction;
-    return function->instruction_count - 1;
+    return vm_code_retarget(&function->code[index], target);
+}
+
+int vm_function_decode(const VMFunction *function, int index, VMInstruction *out) {
+    if (!function || !out || index < 0 || index >= function->instruction_count) return -1;
+    
+    VMCode word = function->code[index];
+    memset(out, 0, sizeof(*out));
+    out->opcode = VM_CODE_OP(word);
+    
+    switch (out->opcode) {
+        case OP_PUSH_INT:
+        case OP_LOAD_GLOBAL:
+        case OP_STORE_GLOBAL:
+        case OP_PUSH_INT_ADD:
+            out->operand.int_operand = VM_CODE_SIMM(word);
+            break;
+        case OP_PUSH_FLOAT:
+            out->operand.float_operand = function->constants[VM_CODE_IMM(word)].data.float_value;
+            break;
+        case OP_PUSH_STRING:
+            out->operand.string_operand = function->constants[VM_CODE_IMM(word)].data.string_value;
+            break;
+        case OP_PUSH_CONST:
+            /* Wide constants decode to the PUSH_INT they were packed from */
+            out->opcode = OP_PUSH_INT;
+            out->operand.int_operand = function->constants[VM_CODE_IMM(word)].data.int_value;
+            break;
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+            out->operand.address_operand = VM_CODE_IMM(word);
+            break;
+        case OP_CALL: {
+            const VMCallSite *site = &function->call_sites[VM_CODE_SITE(word)];
+            out->operand.call_operand.arg_count = VM_CODE_ARGC(word);
+            out->operand.call_operand.target = site->target;
+            out->operand.call_operand.name = site->name;
+            out->operand.call_operand.link = site->link;
+            out->operand.call_operand.generation = site->generation;
+            break;
+        }
+        case OP_CALL_METHOD:
+            out->operand.int_operand = VM_CODE_ARGC(word);
+            break;
+        default:
+            /* Includes superinstructions with two fields: the raw immediate */
+            out->operand.int_operand = VM_CODE_IMM(word);
+            break;
+    }
+    
+    return 0;
+}
+
+/**
+ * Make a function ready to run: out-of-range jumps go to the end and the
+ * slot past the last instruction holds a sentinel OP_RETURN, so running
+ * off the end needs no bounds check in the dispatch loop.
+ */
+static void vm_prepare_function(VMFunction *function) {
+    VMCode *code = (VMCode *)vm_grow(function->code, &function->instruction_capacity,
+                                     function->instruction_count + 1, sizeof(VMCode));
+    if (!code) return;
+    function->code = code;
+    
+    int count = function->instruction_count;
+    code[count] = VM_CODE(OP_RETURN, 0);
+    for (int i = 0; i < count; i++) {
+        if (vm_code_branch_target(code[i]) > count) {
+            vm_code_retarget(&code[i], count);
+        }
+    }
+}
+
+VMFunction* vm_function_copy(const VMFunction *function) {
+    if (!function) return NULL;
+    
+    VMFunction *copy = vm_function_create(function->name, function->param_count,
+                                          function->local_var_count);
+    if (!copy) return NULL;
+    
+    int count = function->instruction_count;
+    copy->code = (VMCode *)malloc(sizeof(VMCode) * (count + 1));
+    if (copy->code) {
+        memcpy(copy->code, function->code, sizeof(VMCode) * count);
+        copy->instruction_count = count;
+        copy->instruction_capacity = count + 1;
+    }
+    if (function->constant_count > 0) {
+        copy->constants = (VMValue *)malloc(sizeof(VMValue) * function->constant_count);
+        for (int i = 0; copy->constants && i < function->constant_count; i++) {
+            copy->constants[i] = function->constants[i];
+            vm_value_addref(&copy->constants[i]);
+            copy->constant_count = copy->constant_capacity = i + 1;
+        }
+    }
+    if (function->call_site_count > 0) {
+        copy->call_sites = (VMCallSite *)malloc(sizeof(VMCallSite) * function->call_site_count);
+        for (int i = 0; copy->call_sites && i < function->call_site_count; i++) {
+            copy->call_sites[i] = function->call_sites[i];
+            if (function->call_sites[i].name) {
+                copy->call_sites[i].name = strdup(function->call_sites[i].name);
+            }
+            copy->call_site_count = copy->call_site_capacity = i + 1;
+        }
+    }
+    if (function->method_cache_count > 0) {
+        copy->method_caches = (VMMethodCache *)calloc(function->method_cache_count,
+                                                      sizeof(VMMethodCache));
+        if (copy->method_caches) copy->method_cache_count = function->method_cache_count;
+    }
+    if (function->source_file) copy->source_file = strdup(function->source_file);
+    if (function->line_map_count > 0) {
+        copy->line_map = (int *)malloc(sizeof(int) * function->line_map_count);
+        if (copy->line_map) {
+            memcpy(copy->line_map, function->line_map, sizeof(int) * function->line_map_count);
+            copy->line_map_count = function->line_map_count;
+        }
+    }
+    
+    if (!copy->code || copy->constant_count != function->constant_count ||
+        copy->call_site_count != function->call_site_count ||
+        copy->method_cache_count != function->method_cache_count ||
+        copy->line_map_count != function->line_map_count) {
+        vm_function_free(copy);
+        return NULL;
+    }
+    return copy;
 }
 
 void vm_function_free(VMFunction *function) {
     if (!function) return;
     
     if (function->name) free(function->name);
-    if (function->instructions) free(function->instructions);
+    if (function->code) free(function->code);
+    for (int i = 0; i < function->constant_count; i++) {
+        vm_value_release(&function->constants[i]);
+    }
+    free(function->constants);
+    for (int i = 0; i < function->call_site_count; i++) {
+        free(function->call_sites[i].name);
+    }
+    free(function->call_sites);
+    free(function->method_caches);
     if (function->source_file) free(function->source_file);
     if (function->line_map) free(function->line_map);
     free(function);
@@ -526,7 +1174,7 @@ static void vm_logical_not(VirtualMachine *vm) {
 /* ========== Bitwise Operations ========== */
 
 static void vm_bitwise_op(VirtualMachine *vm, int op) {
-    VMValue b, a;
+    VMValue b = { .type = VALUE_NULL }, a;
     long a_val, b_val;
     long result = 0;
     
@@ -569,6 +1217,9 @@ void vm_free(VirtualMachine *vm) {
         if (vm->stack->values) free(vm->stack->values);
         free(vm->stack);
     }
+    free(vm->frames);
+    
+    obj_program_cache_free(vm);
     
     if (vm->functions) {
         for (int i = 0; i < vm->function_count; i++) {
@@ -595,8 +1246,8 @@ void vm_free(VirtualMachine *vm) {
         free(vm->string_pool);
     }
     
-    if (vm->instructions) {
-        free(vm->instructions);
+    if (vm->toplevel) {
+        vm_function_free(vm->toplevel);
     }
 
     if (vm->gc) {
@@ -607,567 +1258,241 @@ void vm_free(VirtualMachine *vm) {
         fclose(vm->trace_output);
         vm->trace_output = NULL;
     }
+    vm_debug_shutdown(vm);
 
     free(vm);
     printf("[VM] Virtual machine freed\n");
 }
 
-/* ========== Instruction Dispatch ========== */
+/* ========== Method Dispatch ========== */
 
-static int vm_execute_instruction(VirtualMachine *vm, VMInstruction *instr) {
-    if (!vm || !instr) return -1;
-    
-    switch (instr->opcode) {
-        case OP_PUSH_INT:
-            return vm_push_value(vm, vm_value_create_int(instr->operand.int_operand));
-        
-        case OP_PUSH_FLOAT:
-            return vm_push_value(vm, vm_value_create_float(instr->operand.float_operand));
-        
-        case OP_PUSH_STRING:
-            return vm_push_value(vm, vm_value_create_string(instr->operand.string_operand));
-        
-        case OP_PUSH_NULL:
-            return vm_push_value(vm, vm_value_create_null());
-        
-        case OP_POP: {
-            VMValue v = vm_pop_value(vm);
-            vm_value_release(&v);
-            return 0;
-        }
-        
-        case OP_DUP: {
-            VMValue v = vm_peek_value(vm);
-            return vm_push_value(vm, v);
-        }
-        
-        case OP_LOAD_LOCAL: {
-            if (!vm->current_frame) {
-                ERROR_LOG("OP_LOAD_LOCAL: No current frame");
-                return -1;
-            }
-            
-            DEBUG_LOG_VM("OP_LOAD_LOCAL called in function: %s",
-                    vm->current_frame->function ? vm->current_frame->function->name : "(null)");
-            
-            int idx = instr->operand.int_operand;
-            /* CRITICAL FIX: Bounds check must include BOTH parameters and locals
-             * Parameters are at indices [0..param_count-1]
-             * Locals are at indices [param_count..param_count+local_var_count-1]
-             * Total valid indices: [0..param_count+local_var_count-1] */
-            int total_vars = vm->current_frame->function->param_count + vm->current_frame->function->local_var_count;
-            if (idx < 0 || idx >= total_vars) {
-                DEBUG_LOG_VM("OP_LOAD_LOCAL: idx=%d out of bounds (total_vars=%d, params=%d, locals=%d)",
-                        idx, total_vars, vm->current_frame->function->param_count, vm->current_frame->function->local_var_count);
-                return -1;
-            }
-            
-            /* Validate frame state */
-            if (!vm->current_frame->local_variables) {
-                DEBUG_LOG_VM("OP_LOAD_LOCAL: No local_variables array in frame");
-                return -1;
-            }
-            
-            VMValue v = vm->current_frame->local_variables[idx];
-            
-            /* Debug ALL OP_LOAD_LOCAL in process_command */
-            if (strcmp(vm->current_frame->function->name, "process_command") == 0) {
-                DEBUG_LOG_VM("OP_LOAD_LOCAL idx=%d in %s: type=%d (PARAM/LOCAL check), ptr=%p",
-                        idx, vm->current_frame->function->name, v.type, (void*)v.data.string_value);
-                
-                /* Warn if parameter is NULL */
-                if (v.type == VALUE_NULL && idx < vm->current_frame->function->param_count) {
-                    WARN_LOG("Parameter %d is NULL in process_command! Frame corruption?", idx);
-                }
-            }
-            
-            return vm_push_value(vm, v);
-        }
-        
-        case OP_STORE_LOCAL: {
-            if (!vm->current_frame) return -1;
-            int idx = instr->operand.int_operand;
-            /* CRITICAL FIX: Bounds check must include BOTH parameters and locals
-             * Parameters are at indices [0..param_count-1]
-             * Locals are at indices [param_count..param_count+local_var_count-1]
-             * Total valid indices: [0..param_count+local_var_count-1] */
-            int total_vars = vm->current_frame->function->param_count + vm->current_frame->function->local_var_count;
-            if (idx < 0 || idx >= total_vars) {
-                DEBUG_LOG_VM("OP_STORE_LOCAL: idx=%d out of bounds (total_vars=%d, params=%d, locals=%d)",
-                        idx, total_vars, vm->current_frame->function->param_count, vm->current_frame->function->local_var_count);
-                return -1;
-            }
-            VMValue v = vm_pop_value(vm);
-            vm_value_release(&vm->current_frame->local_variables[idx]);
-            vm->current_frame->local_variables[idx] = v;
-            return 0;
-        }
-        
-        case OP_LOAD_GLOBAL: {
-            int idx = instr->operand.int_operand;
-            if (idx < 0 || idx >= vm->global_count) return -1;
-            VMValue v = vm->global_variables[idx];
-            return vm_push_value(vm, v);
-        }
-        
-        case OP_STORE_GLOBAL: {
-            int idx = instr->operand.int_operand;
-            if (idx < 0) {
-                if (vm->global_count >= vm->global_capacity) {
-                    vm->global_capacity *= 2;
-                    vm->global_variables = (VMValue *)realloc(vm->global_variables,
-                                                               sizeof(VMValue) * vm->global_capacity);
-                }
-                idx = vm->global_count++;
-            }
-            VMValue v = vm_pop_value(vm);
-            if (idx >= 0 && idx < vm->global_count) {
-                vm_value_release(&vm->global_variables[idx]);
-            }
-            vm->global_variables[idx] = v;
-            return 0;
-        }
-        
-        case OP_ADD: vm_arithmetic_op(vm, 0); return 0;
-        case OP_SUB: vm_arithmetic_op(vm, 1); return 0;
-        case OP_MUL: vm_arithmetic_op(vm, 2); return 0;
-        case OP_DIV: vm_arithmetic_op(vm, 3); return 0;
-        case OP_MOD: vm_arithmetic_op(vm, 4); return 0;
-        case OP_NEG: vm_negate(vm); return 0;
-        
-        case OP_EQ: vm_comparison_op(vm, 0); return 0;
-        case OP_NE: vm_comparison_op(vm, 1); return 0;
-        case OP_LT: vm_comparison_op(vm, 2); return 0;
-        case OP_LE: vm_comparison_op(vm, 3); return 0;
-        case OP_GT: vm_comparison_op(vm, 4); return 0;
-        case OP_GE: vm_comparison_op(vm, 5); return 0;
-        
-        case OP_AND: vm_logical_and(vm); return 0;
-        case OP_OR: vm_logical_or(vm); return 0;
-        case OP_NOT: vm_logical_not(vm); return 0;
-        
-        case OP_BIT_AND: vm_bitwise_op(vm, 0); return 0;
-        case OP_BIT_OR: vm_bitwise_op(vm, 1); return 0;
-        case OP_BIT_XOR: vm_bitwise_op(vm, 2); return 0;
-        case OP_BIT_NOT: vm_bitwise_op(vm, 3); return 0;
-        case OP_LSHIFT: vm_bitwise_op(vm, 4); return 0;
-        case OP_RSHIFT: vm_bitwise_op(vm, 5); return 0;
-        
-        case OP_JUMP:
-            vm->instruction_pointer = instr->operand.address_operand;
-            return 0;
-        
-        case OP_JUMP_IF_FALSE: {
-            VMValue cond = vm_pop_value(vm);
-            if (!vm_value_is_truthy(cond)) {
-                vm->instruction_pointer = instr->operand.address_operand;
-            }
-            vm_value_release(&cond);
-            return 0;
-        }
-        
-        case OP_JUMP_IF_TRUE: {
-            VMValue cond = vm_pop_value(vm);
-            if (vm_value_is_truthy(cond)) {
-                vm->instruction_pointer = instr->operand.address_operand;
-            }
-            vm_value_release(&cond);
-            return 0;
-        }
-        
-        case OP_CALL: {
-            int arg_count = instr->operand.call_operand.arg_count;
-            char *func_name = instr->operand.call_operand.name;
-            
-            if (func_name) {
-                /* Try to call as an efun first */
-                if (vm->efun_registry) {
-                    EfunEntry *efun_entry = efun_find(vm->efun_registry, func_name);
-                    if (efun_entry) {
-                        VMValue *args = NULL;
-                        if (arg_count > 0) {
-                            args = (VMValue *)malloc(sizeof(VMValue) * arg_count);
-                            if (!args) return -1;
-                            /* Pop arguments from stack in reverse order */
-                            for (int i = arg_count - 1; i >= 0; i--) {
-                                args[i] = vm_pop_value(vm);
-                            }
-                        }
-                        VMValue result = efun_entry->callback(vm, args, arg_count);
-                        if (args) {
-                            for (int i = 0; i < arg_count; i++) {
-                                vm_value_release(&args[i]);
-                            }
-                            free(args);
-                        }
-                        return vm_push_value(vm, result);
-                    }
-                }
-                
-                /* Otherwise, try to call as a user-defined function */
-                for (int i = 0; i < vm->function_count; i++) {
-                    if (vm->functions[i] && strcmp(vm->functions[i]->name, func_name) == 0) {
-                        return vm_call_function(vm, i, arg_count);
-                    }
-                }
-                
-                DEBUG_LOG_VM("OP_CALL: Unknown function: %s", func_name);
-                return -1;
-            } else {
-                int func_idx = instr->operand.call_operand.target;
-                return vm_call_function(vm, func_idx, arg_count);
-            }
-        }
-        
-        case OP_RETURN:
-            vm->running = 0;
-            return 0;
-        
-        case OP_MAKE_ARRAY: {
-            int size = instr->operand.int_operand;
-            array_t *arr = array_new(vm->gc, size);
-            for (int i = 0; i < size; i++) {
-                VMValue v = vm_pop_value(vm);
-                array_push(arr, v);
-            }
-            VMValue arr_val;
-            arr_val.type = VALUE_ARRAY;
-            arr_val.data.array_value = arr;
-            return vm_push_value(vm, arr_val);
-        }
-        
-        case OP_INDEX_ARRAY: {
-            VMValue idx_val = vm_pop_value(vm);
-            VMValue arr_val = vm_pop_value(vm);
-            if (arr_val.type != VALUE_ARRAY) return -1;
-            
-            int idx = (idx_val.type == VALUE_INT) ? idx_val.data.int_value : (int)idx_val.data.float_value;
-            VMValue result = array_get((array_t *)arr_val.data.array_value, idx);
-            return vm_push_value(vm, result);
-        }
-        
-        case OP_SLICE_RANGE: {
-            /* Pop end, start, array/string from stack */
-            VMValue end_val = vm_pop_value(vm);
-            VMValue start_val = vm_pop_value(vm);
-            VMValue arr_val = vm_pop_value(vm);
-            
-            int start = (start_val.type == VALUE_INT) ? start_val.data.int_value : 0;
-            int end = (end_val.type == VALUE_INT) ? end_val.data.int_value : -1;
-            
-            /* Handle string slicing */
-            if (arr_val.type == VALUE_STRING) {
-                const char *str = arr_val.data.string_value;
-                int len = str ? strlen(str) : 0;
-                
-                /* Normalize indices */
-                if (start < 0) start = 0;
-                if (end < 0 || end >= len) end = len - 1;
-                if (start > end) {
-                    /* Empty string */
-                    VMValue result;
-                    result.type = VALUE_STRING;
-                    /* Create empty string using gc_alloc */
-                    char *empty_str = (char *)gc_alloc(vm->gc, 1, GC_TYPE_STRING);
-                    if (empty_str) empty_str[0] = '\0';
-                    result.data.string_value = empty_str;
-                    return vm_push_value(vm, result);
-                }
-                
-                /* Create substring */
-                int slice_len = end - start + 1;
-                char *slice = (char *)gc_alloc(vm->gc, slice_len + 1, GC_TYPE_STRING);
-                strncpy(slice, str + start, slice_len);
-                slice[slice_len] = '\0';
-                
-                VMValue result;
-                result.type = VALUE_STRING;
-                result.data.string_value = slice;
-                return vm_push_value(vm, result);
-            }
-            
-            /* Handle array slicing */
-            if (arr_val.type == VALUE_ARRAY) {
-                array_t *arr = (array_t *)arr_val.data.array_value;
-                int len = array_length(arr);
-                
-                /* Normalize indices */
-                if (start < 0) start = 0;
-                if (end < 0 || end >= len) end = len - 1;
-                if (start > end) {
-                    /* Empty array */
-                    array_t *new_arr = array_new(vm->gc, 0);
-                    VMValue result;
-                    result.type = VALUE_ARRAY;
-                    result.data.array_value = new_arr;
-                    return vm_push_value(vm, result);
-                }
-                
-                /* Create slice array */
-                int slice_len = end - start + 1;
-                array_t *new_arr = array_new(vm->gc, slice_len);
-                for (int i = 0; i < slice_len; i++) {
-                    VMValue elem = array_get(arr, start + i);
-                    array_set(new_arr, i, elem);
-                }
-                
-                VMValue result;
-                result.type = VALUE_ARRAY;
-                result.data.array_value = new_arr;
-                return vm_push_value(vm, result);
+/**
+ * Resolve a method for OP_CALL_METHOD. Receivers sharing a method table
+ * hit the site's cache without touching the table.
+ */
+static VMFunction *vm_lookup_method(VirtualMachine *vm, VMMethodCache *cache,
+                                    obj_t *target, const char *name) {
+    ObjMethodTable *table = obj_method_table(target);
+    if (!table) return NULL;
+
+    if (cache) {
+        for (int i = 0; i < cache->count; i++) {
+            VMMethodCacheEntry *entry = &cache->entries[i];
+            if (entry->table_id == table->id &&
+                vm_string_equal(entry->name, name)) {
+                vm->profile.method_cache_hits++;
+                return entry->function;
             }
-            
-            return -1;  /* Invalid type for slicing */
         }
-        
-        case OP_STORE_ARRAY: {
-            VMValue val = vm_pop_value(vm);
-            VMValue idx_val = vm_pop_value(vm);
-            VMValue arr_val = vm_pop_value(vm);
-            if (arr_val.type != VALUE_ARRAY) return -1;
-            
-            int idx = (idx_val.type == VALUE_INT) ? idx_val.data.int_value : (int)idx_val.data.float_value;
-            return array_set((array_t *)arr_val.data.array_value, idx, val);
+        vm->profile.method_cache_misses++;
+    }
+
+    VMFunction *method = obj_method_table_find_string(table, name);
+    const char *interned = (cache && method) ? obj_intern_name(name) : NULL;
+    if (interned) {
+        VMMethodCacheEntry *entry;
+        if (cache->count < VM_METHOD_CACHE_WAYS) {
+            entry = &cache->entries[cache->count++];
+        } else {
+            entry = &cache->entries[cache->next_victim];
+            cache->next_victim = (cache->next_victim + 1) % VM_METHOD_CACHE_WAYS;
         }
+        entry->table_id = table->id;
+        entry->name = interned;
+        entry->function = method;
+    }
+
+    return method;
+}
+
+/* ========== Instruction Dispatch ========== */
+
+/* OP_SLICE_RANGE on strings and arrays */
+static int vm_slice_range(VirtualMachine *vm) {
+    /* Pop end, start, array/string from stack */
+    VMValue end_val = vm_pop_value(vm);
+    VMValue start_val = vm_pop_value(vm);
+    VMValue arr_val = vm_pop_value(vm);
+    
+    int start = (start_val.type == VALUE_INT) ? start_val.data.int_value : 0;
+    int end = (end_val.type == VALUE_INT) ? end_val.data.int_value : -1;
+    
+    /* Handle string slicing */
+    if (arr_val.type == VALUE_STRING) {
+        const char *str = arr_val.data.string_value;
+        int len = str ? strlen(str) : 0;
         
-        case OP_MAKE_MAPPING: {
-            int pair_count = instr->operand.int_operand;
-            mapping_t *map = mapping_new(vm->gc, VM_MAPPING_BUCKETS);
-            for (int i = 0; i < pair_count; i++) {
-                VMValue val = vm_pop_value(vm);
-                VMValue key_val = vm_pop_value(vm);
-                if (key_val.type == VALUE_STRING) {
-                    mapping_set(map, key_val.data.string_value, val);
-                }
-            }
-            VMValue map_val;
-            map_val.type = VALUE_MAPPING;
-            map_val.data.mapping_value = map;
-            return vm_push_value(vm, map_val);
-        }
+        /* Normalize indices */
+        if (start < 0) start = 0;
+        if (end < 0 || end >= len) end = len - 1;
         
-        case OP_INDEX_MAPPING: {
-            VMValue key_val = vm_pop_value(vm);
-            VMValue map_val = vm_pop_value(vm);
-            if (map_val.type != VALUE_MAPPING || key_val.type != VALUE_STRING) return -1;
-            
-            VMValue result = mapping_get((mapping_t *)map_val.data.mapping_value, 
-                                         key_val.data.string_value);
-            return vm_push_value(vm, result);
-        }
+        /* Slices are ordinary refcounted VM strings */
+        int slice_len = start > end ? 0 : end - start + 1;
+        VMValue result;
+        result.type = VALUE_STRING;
+        result.data.string_value = vm_string_create(slice_len > 0 ? str + start : "", (size_t)slice_len);
+        vm_profile_note_create(result, result.data.string_value ? (size_t)slice_len + 1 : 0);
         
-        case OP_STORE_MAPPING: {
-            VMValue val = vm_pop_value(vm);
-            VMValue key_val = vm_pop_value(vm);
-            VMValue map_val = vm_pop_value(vm);
-            if (map_val.type != VALUE_MAPPING || key_val.type != VALUE_STRING) return -1;
-
-            mapping_entry_t *entry = mapping_set((mapping_t *)map_val.data.mapping_value,
-                                                 key_val.data.string_value, val);
-            return entry ? 0 : -1;
-        }
+        int status = vm_push_value(vm, result);
+        vm_value_release(&result);
+        vm_value_release(&arr_val);
+        return status;
+    }
+    
+    /* Handle array slicing */
+    if (arr_val.type == VALUE_ARRAY) {
+        array_t *arr = (array_t *)arr_val.data.array_value;
+        int len = array_length(arr);
         
-        case OP_HALT:
-            vm->running = 0;
-            return 0;
+        /* Normalize indices */
+        if (start < 0) start = 0;
+        if (end < 0 || end >= len) end = len - 1;
         
-        case OP_PRINT: {
-            VMValue v = vm_pop_value(vm);
-            char *str = vm_value_to_string(v);
-            printf("%s\n", str);
-            free(str);
-            vm_value_release(&v);
-            return 0;
-        }
+        /* A flat slice is a view sharing arr's elements until either is written */
+        int slice_len = start > end ? 0 : end - start + 1;
+        array_t *new_arr = array_slice(arr, (size_t)(start > len ? len : start), (size_t)slice_len);
+        vm_value_release(&arr_val);
+        if (!new_arr) return -1;
         
-        case OP_CALL_METHOD: {
-            int arg_count = instr->operand.int_operand;
-            if (arg_count < 0 || arg_count > vm->stack->top - 2) {
-                fprintf(stderr, "[VM] OP_CALL_METHOD: invalid arg_count=%d (stack=%d)\n",
-                        arg_count, vm->stack ? vm->stack->top : -1);
-                vm_push_value(vm, vm_value_create_null());
-                return -1;
-            }
+        VMValue result;
+        result.type = VALUE_ARRAY;
+        result.data.array_value = new_arr;
+        return vm_push_value(vm, result);
+    }
+    
+    return -1;  /* Invalid type for slicing */
+}
 
-            /* Collect arguments from stack (preserve call order) */
-            VMValue args_buffer[32];
-            VMValue *args = args_buffer;
-            if (arg_count > (int)(sizeof(args_buffer) / sizeof(args_buffer[0]))) {
-                args = (VMValue *)malloc(sizeof(VMValue) * arg_count);
-                if (!args) {
-                    DEBUG_LOG_VM("OP_CALL_METHOD: out of memory for %d args", arg_count);
-                    vm_push_value(vm, vm_value_create_null());
-                    return -1;
-                }
-            }
+void vm_runtime_error(VirtualMachine *vm, const char *fmt, ...) {
+    if (!vm || !fmt) return;
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(vm->last_error, sizeof(vm->last_error), fmt, args);
+    va_end(args);
+
+    CallFrame *frame = vm->current_frame;
+    if (frame && frame->function) {
+        VMFunction *func = frame->function;
+        int ip = frame->instruction_pointer - 1;
+        int line = (func->line_map && ip >= 0 && ip < func->line_map_count) ? func->line_map[ip] : -1;
+        fprintf(stderr, "[VM] Runtime error: %s\n  in %s() at %s:%d (depth %d)\n",
+                vm->last_error, func->name,
+                func->source_file ? func->source_file : "<unknown>", line, vm->frame_count);
+    } else {
+        fprintf(stderr, "[VM] Runtime error: %s\n", vm->last_error);
+    }
+}
 
-            for (int i = arg_count - 1; i >= 0; i--) {
-                args[i] = vm_pop_value(vm);
-            }
+/* Drop everything a frame owns on the value stack: args, locals, temps */
+static void vm_unwind_stack(VirtualMachine *vm, int stack_base) {
+    while (vm->stack->top > stack_base) {
+        vm_value_release(&vm->stack->values[--vm->stack->top]);
+        vm->stack->values[vm->stack->top].type = VALUE_UNINITIALIZED;
+    }
+}
 
-            VMValue method_val = vm_pop_value(vm);
-            VMValue obj_val = vm_pop_value(vm);
-
-            if (method_val.type != VALUE_STRING || !method_val.data.string_value) {
-                DEBUG_LOG_VM("OP_CALL_METHOD: method name must be string");
-                vm_value_free(&method_val);
-                for (int i = 0; i < arg_count; i++) {
-                    vm_value_free(&args[i]);
-                }
-                if (args != args_buffer) free(args);
-                vm_push_value(vm, vm_value_create_null());
-                return -1;
-            }
+/**
+ * Push a frame for @func whose @arg_count arguments are on top of the
+ * stack. The arguments become locals[0..arg_count-1] in place and the
+ * remaining locals are reserved directly above them. On failure the
+ * arguments are released and NULL is returned.
+ */
+static CallFrame *vm_push_frame(VirtualMachine *vm, VMFunction *func, int arg_count) {
+    int stack_base = vm->stack->top - arg_count;
+    int total_vars = func->param_count + func->local_var_count;
 
-            if (obj_val.type != VALUE_OBJECT || !obj_val.data.object_value) {
-                DEBUG_LOG_VM("OP_CALL_METHOD: invalid object reference");
-                vm_value_free(&method_val);
-                for (int i = 0; i < arg_count; i++) {
-                    vm_value_free(&args[i]);
-                }
-                if (args != args_buffer) free(args);
-                vm_push_value(vm, vm_value_create_null());
-                return -1;
-            }
+    if (vm->frame_count >= VM_MAX_CALL_DEPTH) {
+        vm_runtime_error(vm, "Too deep recursion calling %s() (max depth %d)",
+                         func->name, VM_MAX_CALL_DEPTH);
+        vm_unwind_stack(vm, stack_base);
+        return NULL;
+    }
+    if (stack_base + total_vars > vm->stack->capacity) {
+        vm_runtime_error(vm, "Stack overflow calling %s()", func->name);
+        vm_unwind_stack(vm, stack_base);
+        return NULL;
+    }
+    for (int i = arg_count; i < total_vars; i++) {
+        vm->stack->values[vm->stack->top++].type = VALUE_UNINITIALIZED;
+    }
+
+    CallFrame *frame = &vm->frames[vm->frame_count++];
+    frame->function = func;
+    frame->local_variables = &vm->stack->values[stack_base];
+    frame->instruction_pointer = 0;
+    frame->stack_base = stack_base;
+    frame->prev = vm->current_frame;
+    vm->current_frame = frame;
+    return frame;
+}
+
+/* Pop the current frame, replacing its arguments, locals and temporaries
+ * with the return value (the result's reference moves, no addref) */
+static void vm_pop_frame(VirtualMachine *vm) {
+    CallFrame *frame = vm->current_frame;
+    int total_vars = frame->function->param_count + frame->function->local_var_count;
 
-            obj_t *target = (obj_t *)obj_val.data.object_value;
-            const char *method_name = method_val.data.string_value;
+    VMValue result;
+    result.type = VALUE_NULL;
+    if (vm->stack->top > frame->stack_base + total_vars) {
+        result = vm->stack->values[--vm->stack->top];
+    }
+    vm_unwind_stack(vm, frame->stack_base);
+    vm->stack->values[vm->stack->top++] = result;
 
-            VMValue result = obj_call_method(vm, target, method_name, args, arg_count);
+    vm->current_frame = frame->prev;
+    vm->frame_count--;
+}
 
-            /* method_name no longer needed */
-            vm_value_free(&method_val);
+#define VM_RUN_NAME vm_run_fast
+#define VM_RUN_TRACED 0
+#include "vm_dispatch.h"
+#undef VM_RUN_NAME
+#undef VM_RUN_TRACED
 
-            /* Clean up temporary args allocation if used */
-            if (args != args_buffer) {
-                free(args);
-            }
+#define VM_RUN_NAME vm_run_traced
+#define VM_RUN_TRACED 1
+#include "vm_dispatch.h"
+#undef VM_RUN_NAME
+#undef VM_RUN_TRACED
 
-            return vm_push_value(vm, result);
-        }
-        
-        default:
-            ERROR_LOG("Unknown opcode: %d", instr->opcode);
-            return -1;
-    }
+/* Run until the frame at exit_depth returns (or top-level code halts) */
+static int vm_run(VirtualMachine *vm, int exit_depth) {
+    int saved_running = vm->running;
+    vm->running = 1;
+
+    int status = (vm->debug_flags & VM_DEBUG_TRACE)
+        ? vm_run_traced(vm, exit_depth)
+        : vm_run_fast(vm, exit_depth);
+
+    vm->running = saved_running;
+    return status;
 }
 
 int vm_execute(VirtualMachine *vm) {
-    if (!vm || !vm->instructions) return -1;
+    if (!vm || !vm->toplevel) return -1;
     
-    vm->running = 1;
+    /* Top-level code runs outside any frame; calls it makes stack above */
+    CallFrame *saved_frame = vm->current_frame;
+    vm->current_frame = NULL;
     vm->instruction_pointer = 0;
-    
-    while (vm->running && vm->instruction_pointer < vm->instruction_count) {
-        VMInstruction *instr = &vm->instructions[vm->instruction_pointer++];
-        if (vm->debug_flags & VM_DEBUG_TRACE) {
-            vm_trace_instruction(vm, vm->current_frame, instr, vm->instruction_pointer - 1);
-        }
-        if (vm_execute_instruction(vm, instr) < 0) {
-            vm->error_count++;
-            if (vm->debug_flags & VM_DEBUG_CALLSTACK) {
-                vm_trace_dump_call_stack(vm, "vm_execute error");
-            }
-            return -1;
-        }
-    }
-    
-    return 0;
-}
 
-/* Forward declaration */
-static const char* opcode_name(OpCode opcode);
+    int status = vm_run(vm, -1);
+
+    vm->current_frame = saved_frame;
+    return status;
+}
 
 int vm_call_function(VirtualMachine *vm, int function_index, int arg_count) {
     if (!vm || function_index < 0 || function_index >= vm->function_count) return -1;
     
     VMFunction *func = vm->functions[function_index];
-    if (!func || arg_count != func->param_count) return -1;
-    
-    /* CRITICAL: Allocate space for BOTH parameters and local variables
-     * Parameters are stored in local_variables[0..param_count-1]
-     * Local variables are stored in local_variables[param_count..param_count+local_var_count-1]
-     * Previous code allocated only local_var_count space, causing buffer overflow when params > 0 */
-    int total_vars = func->param_count + func->local_var_count;
-    DEBUG_LOG_VM("ALLOCATION: func->param_count=%d, func->local_var_count=%d, total_vars=%d, size=%zu bytes",
-            func->param_count, func->local_var_count, total_vars, sizeof(VMValue) * total_vars);
-    
-    CallFrame *frame = (CallFrame *)malloc(sizeof(CallFrame));
-    frame->function = func;
-    frame->local_variables = (VMValue *)malloc(sizeof(VMValue) * total_vars);
-    DEBUG_LOG_VM("Allocated frame->local_variables=%p", (void*)frame->local_variables);
-    frame->instruction_pointer = 0;
-    frame->stack_base = vm->stack->top - arg_count;
-    frame->prev = vm->current_frame;
-    
-    /* Initialize all local variables (parameters + locals) to uninitialized
-     * Parameters will be overwritten in the next loop, locals need initialization */
-    for (int i = 0; i < total_vars; i++) {
-        frame->local_variables[i].type = VALUE_UNINITIALIZED;
-    }
-    
-    /* Copy parameters from stack to local variables array */
-    for (int i = 0; i < arg_count; i++) {
-        frame->local_variables[i] = vm->stack->values[frame->stack_base + i];
-        vm_value_addref(&frame->local_variables[i]);
-        DEBUG_LOG_VM("Copied param %d from stack[%d] to local[%d]: type=%d (str_ptr=%p)",
-                i, frame->stack_base + i, i, frame->local_variables[i].type,
-                (void*)frame->local_variables[i].data.string_value);
-    }
-    
-    vm->current_frame = frame;
-    
-    /* Debug: Print frame state before execution */
-    if (strcmp(func->name, "process_command") == 0) {
-        DEBUG_LOG_VM("FRAME SETUP for %s: frame=%p local_vars=%p param_count=%d local_count=%d",
-                func->name, (void*)frame, (void*)frame->local_variables, 
-                func->param_count, func->local_var_count);
-        /* Enable instruction tracing for this function */
-        vm->debug_flags |= VM_DEBUG_TRACE;
-    }
-    
-    int saved_running = vm->running;
-    vm->running = 1;
-
-    while (frame->instruction_pointer < func->instruction_count && vm->running) {
-        VMInstruction *instr = &func->instructions[frame->instruction_pointer++];
-        
-        /* Debug EVERY instruction in process_command */
-        if (strcmp(func->name, "process_command") == 0) {
-            DEBUG_LOG_VM("[%s] IP=%d opcode=%d",
-                    func->name, frame->instruction_pointer - 1, instr->opcode);
-        }
-        
-        if (vm->debug_flags & VM_DEBUG_TRACE) {
-            vm_trace_instruction(vm, frame, instr, frame->instruction_pointer - 1);
-        }
-        if (vm_execute_instruction(vm, instr) < 0) {
-            vm->error_count++;
-            if (vm->debug_flags & VM_DEBUG_CALLSTACK) {
-                vm_trace_dump_call_stack(vm, "vm_call_function error");
-            }
-            vm->running = saved_running;
-            vm->current_frame = frame->prev;
-            /* Release all variables (parameters and locals) */
-            for (int i = 0; i < total_vars; i++) {
-                vm_value_release(&frame->local_variables[i]);
-            }
-            if (frame->local_variables) free(frame->local_variables);
-            free(frame);
-            return -1;
-        }
-    }
+    if (!func || arg_count != func->param_count || arg_count > vm->stack->top) return -1;
 
-    vm->running = saved_running;
-    vm->current_frame = frame->prev;
-    /* Release all variables (parameters and locals) */
-    for (int i = 0; i < total_vars; i++) {
-        vm_value_release(&frame->local_variables[i]);
-    }
-    if (frame->local_variables) free(frame->local_variables);
-    free(frame);
-    
-    return 0;
+    int exit_depth = vm->frame_count;
+    if (!vm_push_frame(vm, func, arg_count)) return -1;
+    return vm_run(vm, exit_depth);
 }
 
 /* ========== Debugging Functions ========== */
@@ -1232,6 +1557,12 @@ static const char* opcode_name(OpCode opcode) {
         case OP_CALL_METHOD: return "CALL_METHOD";
         case OP_HALT: return "HALT";
         case OP_PRINT: return "PRINT";
+        case OP_PUSH_CONST: return "PUSH_CONST";
+        case OP_PUSH_INT_ADD: return "PUSH_INT_ADD";
+        case OP_INC_LOCAL: return "INC_LOCAL";
+        case OP_LOAD_LOCAL_LOAD_LOCAL: return "LOAD_LOCAL_LOAD_LOCAL";
+        case OP_CMP_JUMP_IF_FALSE: return "CMP_JUMP_IF_FALSE";
+        case OP_RETURN_LOCAL: return "RETURN_LOCAL";
         default: return "UNKNOWN";
     }
 }
@@ -1264,8 +1595,23 @@ void vm_disassemble_instruction(VMInstruction instruction, int index) {
         case OP_STORE_GLOBAL:
         case OP_MAKE_ARRAY:
         case OP_MAKE_MAPPING:
+        case OP_PUSH_INT_ADD:
+        case OP_RETURN_LOCAL:
             printf(" %ld\n", instruction.operand.int_operand);
             break;
+        case OP_INC_LOCAL:
+        case OP_LOAD_LOCAL_LOAD_LOCAL:
+        case OP_CMP_JUMP_IF_FALSE: {
+            VMCode word = VM_CODE(instruction.opcode, instruction.operand.int_operand);
+            if (instruction.opcode == OP_INC_LOCAL) {
+                printf(" %d += %d\n", VM_CODE_LO(word), VM_CODE_SHI(word));
+            } else if (instruction.opcode == OP_LOAD_LOCAL_LOAD_LOCAL) {
+                printf(" %d, %d\n", VM_CODE_LO(word), VM_CODE_HI(word));
+            } else {
+                printf(" %s -> %d\n", opcode_name((OpCode)(OP_EQ + VM_CODE_LO(word))), VM_CODE_HI(word));
+            }
+            break;
+        }
         default:
             printf("\n");
             break;
@@ -1278,8 +1624,11 @@ void vm_disassemble_function(VMFunction *function) {
     printf("Function: %s (params=%d, locals=%d)\n",
            function->name, function->param_count, function->local_var_count);
     
+    VMInstruction instruction;
     for (int i = 0; i < function->instruction_count; i++) {
-        vm_disassemble_instruction(function->instructions[i], i);
+        if (vm_function_decode(function, i, &instruction) == 0) {
+            vm_disassemble_instruction(instruction, i);
+        }
     }
     printf("\n");
 }
@@ -93,8 +93,20 @@ typedef enum {
     /* Special */
     OP_HALT,            /* Stop execution */
     OP_PRINT,           /* Print top of stack (debugging) */
+    
+    /* Packed-code only (never in compiled Program bytecode) */
+    OP_PUSH_CONST,      /* Push an entry of the function's constant table */
+    
+    /* Superinstructions, produced by vm_optimize_function() */
+    OP_PUSH_INT_ADD,          /* PUSH_INT k; ADD */
+    OP_INC_LOCAL,             /* LOAD_LOCAL n; PUSH_INT k; ADD; STORE_LOCAL n */
+    OP_LOAD_LOCAL_LOAD_LOCAL, /* LOAD_LOCAL a; LOAD_LOCAL b */
+    OP_CMP_JUMP_IF_FALSE,     /* EQ/NE/LT/LE/GT/GE; JUMP_IF_FALSE */
+    OP_RETURN_LOCAL,          /* LOAD_LOCAL n; RETURN */
 } OpCode;
 
+#define VM_OPCODE_COUNT (OP_RETURN_LOCAL + 1)
+
 /* ========== Value Types ========== */
 
 struct array_t;
@@ -133,8 +145,29 @@ typedef struct {
     } data;
 } VMValue;
 
+/* ========== Call Linkage ========== */
+
+/*
+ * How an OP_CALL site has been bound. Calls are linked when a program is
+ * loaded (vm_link_calls); sites that could not be bound then are resolved
+ * by name on first execution and cached in the instruction itself.
+ */
+typedef enum {
+    VM_CALL_UNLINKED = 0,   /* Not yet resolved, look up by name */
+    VM_CALL_EFUN,           /* target is an efun registry index */
+    VM_CALL_LOCAL,          /* target is a function of the calling program */
+    VM_CALL_CACHED,         /* target is a function index, valid for one generation */
+    VM_CALL_VIRTUAL,        /* slot is an entry of the running object's program table,
+                               target the function there when the site was linked */
+} VMCallLink;
+
 /* ========== Bytecode Instruction ========== */
 
+/*
+ * Unpacked instruction. This is the form code generators hand to
+ * vm_function_add_instruction() and the form vm_function_decode()
+ * returns for disassembly; functions execute the packed VMCode stream.
+ */
 typedef struct {
     OpCode opcode;
     union {
@@ -146,22 +179,110 @@ typedef struct {
             int arg_count;      /* Number of arguments */
             int target;         /* Function or method index */
             char *name;         /* Function name for efun lookup */
+            int link;           /* VMCallLink binding of target */
+            unsigned int generation; /* vm->call_generation when cached */
         } call_operand;
     } operand;
 } VMInstruction;
 
+/* ========== Packed Bytecode ========== */
+
+/*
+ * Functions execute a stream of 32-bit words: the low 8 bits hold the
+ * opcode and the high 24 bits an immediate. Operands that do not fit
+ * live in per-function tables which the immediate indexes:
+ *
+ *   PUSH_INT                signed 24-bit value
+ *   PUSH_FLOAT/STRING/CONST constants[] index
+ *   LOAD/STORE_LOCAL        local slot
+ *   LOAD/STORE_GLOBAL       signed global index (STORE_GLOBAL -1 appends)
+ *   JUMP*                   instruction index
+ *   MAKE_ARRAY/MAPPING      element / pair count
+ *   CALL                    arg count (8 bits) | call_sites[] index (16 bits)
+ *   CALL_METHOD             arg count (8 bits) | method_caches[] index (16 bits)
+ *   PUSH_INT_ADD            signed 24-bit addend
+ *   INC_LOCAL               local slot (8 bits) | signed addend (16 bits)
+ *   LOAD_LOCAL_LOAD_LOCAL   first slot (8 bits) | second slot (16 bits)
+ *   CMP_JUMP_IF_FALSE       comparison, EQ = 0 .. GE = 5 (8 bits) | target (16 bits)
+ *   RETURN_LOCAL            local slot
+ */
+typedef uint32_t VMCode;
+
+#define VM_CODE(op, imm)     ((VMCode)(op) | ((VMCode)(imm) << 8))
+#define VM_CODE_OP(w)        ((OpCode)((w) & 0xFFu))
+#define VM_CODE_IMM(w)       ((int)((w) >> 8))
+#define VM_CODE_SIMM(w)      ((int)((int32_t)(w) >> 8))
+#define VM_CODE_LO(w)        ((int)(((w) >> 8) & 0xFFu))
+#define VM_CODE_HI(w)        ((int)((w) >> 16))
+#define VM_CODE_SHI(w)       ((int)((int32_t)(w) >> 16))
+#define VM_CODE_PAIR(op, lo, hi) \
+    VM_CODE((op), ((VMCode)(lo) & 0xFFu) | ((VMCode)(hi) << 8))
+
+#define VM_CODE_ARGC(w)      VM_CODE_LO(w)
+#define VM_CODE_SITE(w)      VM_CODE_HI(w)
+#define VM_CODE_CALL(op, argc, site) VM_CODE_PAIR((op), (argc), (site))
+
+#define VM_IMM24_MIN   (-(1L << 23))
+#define VM_IMM24_MAX   ((1L << 23) - 1)
+#define VM_IMM24_LIMIT (1 << 24)
+#define VM_SITE_LIMIT  (1 << 16)
+#define VM_ARGC_LIMIT  (1 << 8)
+#define VM_IMM8_LIMIT  (1 << 8)
+#define VM_IMM16_MIN   (-(1 << 15))
+#define VM_IMM16_MAX   ((1 << 15) - 1)
+
+/* Target of one OP_CALL site; see VMCallLink */
+typedef struct {
+    char *name;                 /* Function name, NULL for direct index calls */
+    int target;                 /* Function or efun index */
+    int link;                   /* VMCallLink binding of target */
+    unsigned int generation;    /* vm->call_generation when cached */
+    int slot;                   /* Program table entry, see object_program.h */
+} VMCallSite;
+
+/* ========== Method Call Caches ========== */
+
+#define VM_METHOD_CACHE_WAYS 4
+
+/*
+ * Inline cache for one OP_CALL_METHOD site. Entries are keyed by the
+ * receiver's method table id, so every object sharing a program's table
+ * hits the same entry. One entry is monomorphic, more are polymorphic;
+ * when all ways are taken entries are replaced round-robin.
+ */
+typedef struct {
+    unsigned int table_id;      /* ObjMethodTable id, 0 if unused */
+    const char *name;           /* Interned method name */
+    VMFunction *function;       /* Resolved method */
+} VMMethodCacheEntry;
+
+typedef struct {
+    VMMethodCacheEntry entries[VM_METHOD_CACHE_WAYS];
+    int count;                  /* Entries in use */
+    int next_victim;            /* Replacement cursor once full */
+} VMMethodCache;
+
 /* ========== Function Structure ========== */
 
 typedef struct VMFunction {
     char *name;
     int param_count;
     int local_var_count;
-    VMInstruction *instructions;
+    VMCode *code;                   /* Packed instructions, plus an OP_RETURN sentinel */
     int instruction_count;
     int instruction_capacity;
+    VMValue *constants;             /* Floats, strings and wide ints */
+    int constant_count;
+    int constant_capacity;
+    VMCallSite *call_sites;         /* One per OP_CALL */
+    int call_site_count;
+    int call_site_capacity;
+    VMMethodCache *method_caches;   /* One per OP_CALL_METHOD */
+    int method_cache_count;
     char *source_file;
     int *line_map;
     int line_map_count;
+    int index;                      /* Slot in vm->functions, -1 until added */
 } VMFunction;
 
 /* ========== Execution Stack ========== */
@@ -176,7 +297,7 @@ typedef struct {
 
 typedef struct CallFrame {
     VMFunction *function;       /* Function being executed */
-    VMValue *local_variables;   /* Local variable storage */
+    VMValue *local_variables;   /* Arguments then locals, on the value stack */
     int instruction_pointer;    /* Current instruction in function */
     int stack_base;             /* Base of stack frame */
     struct CallFrame *prev;     /* Previous call frame */
@@ -202,16 +323,38 @@ typedef struct {
     unsigned long string_frees;
     size_t string_bytes_alloc;
     size_t string_bytes_free;
+    unsigned long method_cache_hits;
+    unsigned long method_cache_misses;
 } VMProfileStats;
 
 /* ========== Virtual Machine Structure ========== */
 
+#define VM_MAX_CALL_DEPTH     256   /* Frames in the preallocated frame stack */
+#define VM_ERROR_MESSAGE_SIZE 256
+
+/*
+ * Bytecode optimization levels (AMLP_OPT_LEVEL overrides the default):
+ *   0  code runs as loaded
+ *   1  constant folding and dead-jump elimination
+ *   2  level 1 plus superinstructions
+ */
+#define VM_OPT_NONE      0
+#define VM_OPT_PEEPHOLE  1
+#define VM_OPT_FUSE      2
+#define VM_OPT_DEFAULT   VM_OPT_FUSE
+
 typedef struct {
     /* Execution state */
     VMStack *stack;
     CallFrame *current_frame;
+    CallFrame *frames;          /* Contiguous frame stack, VM_MAX_CALL_DEPTH long */
+    int frame_count;
     int running;
     int error_count;
+    char last_error[VM_ERROR_MESSAGE_SIZE]; /* Most recent runtime error */
+    int opt_level;              /* VM_OPT_* applied to code as it is loaded */
+    struct obj_t *current_object; /* Object whose method is running; its variables are the globals */
+    struct ObjProgramCache *program_cache; /* Shared programs by path (object_program.h) */
 
     /* Memory management */
     GC *gc;
@@ -223,6 +366,7 @@ typedef struct {
     VMFunction **functions;     /* Array of all functions */
     int function_count;
     int function_capacity;
+    unsigned int call_generation; /* Bumped when the function table changes */
     
     VMValue *global_variables;  /* Global variable storage */
     int global_count;
@@ -233,11 +377,9 @@ typedef struct {
     int string_pool_count;
     int string_pool_capacity;
     
-    /* Instruction pointer for top-level code */
-    VMInstruction *instructions;
+    /* Top-level code, run by vm_execute() outside any frame */
+    VMFunction *toplevel;
     int instruction_pointer;
-    int instruction_count;
-    int instruction_capacity;
 
     /* Debugging and profiling */
     unsigned int debug_flags;
@@ -263,12 +405,21 @@ VirtualMachine* vm_init(void);
  * @instructions: Array of bytecode instructions
  * @count: Number of instructions
  * 
- * Loads compiled bytecode into the VM for execution.
+ * Packs the instructions into the VM's top-level code for vm_execute().
  * 
  * Returns: 0 on success, -1 on error
  */
 int vm_load_bytecode(VirtualMachine *vm, VMInstruction *instructions, int count);
 
+/**
+ * vm_load_toplevel - Install already packed top-level code
+ * @vm: Pointer to the VirtualMachine
+ * @toplevel: Function holding the code; the VM takes ownership
+ * 
+ * Returns: 0 on success, -1 on error
+ */
+int vm_load_toplevel(VirtualMachine *vm, VMFunction *toplevel);
+
 /**
  * vm_add_function - Add a function to the VM
  * @vm: Pointer to the VirtualMachine
@@ -280,6 +431,32 @@ int vm_load_bytecode(VirtualMachine *vm, VMInstruction *instructions, int count)
  */
 int vm_add_function(VirtualMachine *vm, VMFunction *function);
 
+/**
+ * vm_find_function - Find a function index by name
+ * @vm: Pointer to the VirtualMachine
+ * @name: Function name
+ * 
+ * Searches newest-first so a reloaded program shadows older definitions.
+ * 
+ * Returns: Function index, or -1 if not found
+ */
+int vm_find_function(VirtualMachine *vm, const char *name);
+
+/**
+ * vm_link_calls - Bind OP_CALL sites of a freshly loaded program
+ * @vm: Pointer to the VirtualMachine
+ * @first: Index of the program's first function in vm->functions
+ * @count: Number of functions belonging to the program
+ * 
+ * Rewrites each OP_CALL to an efun registry index or a function index
+ * so execution skips the name lookup. Efuns win over program functions,
+ * program functions win over functions of other programs. Sites that
+ * cannot be bound yet are left for the runtime inline cache.
+ * 
+ * Returns: Number of call sites left unresolved, or -1 on error
+ */
+int vm_link_calls(VirtualMachine *vm, int first, int count);
+
 /**
  * vm_execute - Execute the loaded bytecode
  * @vm: Pointer to the VirtualMachine
@@ -297,12 +474,27 @@ int vm_execute(VirtualMachine *vm);
  * @arg_count: Number of arguments on stack
  * 
  * Calls a function with the specified number of arguments
- * already pushed onto the stack.
+ * already pushed onto the stack. The arguments become the first
+ * locals in place; the remaining locals are reserved above them.
+ * On return the arguments are replaced by the function's result
+ * (null if it produced none). On error they are released and
+ * nothing is pushed.
  * 
- * Returns: 0 on success, -1 on error
+ * Returns: 0 on success, -1 on error (see vm->last_error)
  */
 int vm_call_function(VirtualMachine *vm, int function_index, int arg_count);
 
+/**
+ * vm_runtime_error - Report an LPC runtime error
+ * @vm: Pointer to the VirtualMachine
+ * @fmt: printf-style message
+ * 
+ * Records the message in vm->last_error and reports it with the
+ * LPC location of the innermost frame. The caller unwinds by
+ * returning -1.
+ */
+void vm_runtime_error(VirtualMachine *vm, const char *fmt, ...);
+
 /**
  * vm_free - Free all VM resources
  * @vm: Pointer to the VirtualMachine
@@ -364,6 +556,20 @@ VMValue vm_value_create_float(double value);
  */
 VMValue vm_value_create_string(const char *value);
 
+/**
+ * vm_value_create_interned - Create a value holding the interned copy of a string
+ * @value: String to intern (NULL interns "")
+ *
+ * Returns: VMValue holding a new reference to the shared copy
+ */
+VMValue vm_value_create_interned(const char *value);
+
+/**
+ * vm_value_intern - Replace a string value with its interned copy
+ * @value: Value to update; non-strings and interned strings are left alone
+ */
+void vm_value_intern(VMValue *value);
+
 /**
  * vm_value_create_null - Create a null value
  * 
@@ -397,6 +603,77 @@ char* vm_value_to_string(VMValue value);
  */
 int vm_value_is_truthy(VMValue value);
 
+/* ========== Strings ==========
+ *
+ * Every VALUE_STRING the VM creates is a "VM string": refcounted, with
+ * its length, a lazily cached hash and flags in a header before the
+ * data. The functions below taking a VM string must not be handed a
+ * plain C string.
+ *
+ * Interned strings are unique per content, so two interned strings are
+ * equal exactly when their pointers are. String constants, mapping keys,
+ * property names and method names are interned. The table is
+ * process-wide and not thread-safe.
+ */
+
+/**
+ * vm_string_intern - Get the interned copy of a C string
+ * @str: NUL-terminated string
+ *
+ * Returns: Interned VM string holding a new reference, or NULL on failure
+ */
+char* vm_string_intern(const char *str);
+
+/**
+ * vm_string_intern_static - Intern a string for the life of the process
+ * @str: NUL-terminated string
+ *
+ * The interned copy keeps one permanent reference; calling this again
+ * for the same contents adds no more. The caller owns no reference.
+ *
+ * Returns: Interned VM string, or NULL on failure
+ */
+const char* vm_string_intern_static(const char *str);
+
+/**
+ * vm_string_addref / vm_string_release- Adjust a VM string's refcount
+ * @str: VM string, or NULL
+ *
+ * The last release frees the string and drops it from the intern table.
+ */
+void vm_string_addref(const char *str);
+void vm_string_release(const char *str);
+
+/**
+ * vm_string_is_interned - Check whether a VM string is the interned copy
+ */
+int vm_string_is_interned(const char *str);
+
+/**
+ * vm_string_hash - Hash of a VM string, computed once and cached
+ *
+ * Matches vm_hash_cstring() for the same contents.
+ */
+unsigned int vm_string_hash(const char *str);
+
+/**
+ * vm_hash_cstring - Hash any NUL-terminated string
+ */
+unsigned int vm_hash_cstring(const char *str);
+
+/**
+ * vm_string_equal - Compare two VM strings
+ *
+ * Pointer-equal strings match at once and two distinct interned strings
+ * never do; otherwise lengths and cached hashes are checked before bytes.
+ */
+int vm_string_equal(const char *a, const char *b);
+
+/**
+ * vm_string_intern_count - Number of strings in the intern table
+ */
+int vm_string_intern_count(void);
+
 /* ========== Value Clone ========== */
 
 /**
@@ -407,6 +684,38 @@ int vm_value_is_truthy(VMValue value);
  */
 VMValue vm_value_clone(VMValue value);
 
+/**
+ * vm_value_write_barrier - Note a value being stored into the heap
+ * @value: Value written into an array, mapping or object property
+ *
+ * While a collection is marking, arrays and mappings stored into
+ * containers it may already have traced are marked here so the sweep
+ * keeps them. Cheap when no cycle is running.
+ */
+void vm_value_write_barrier(VMValue value);
+
+/* ========== Garbage Collection ========== */
+
+/**
+ * vm_gc_attach - Reclaim the VM's arrays and mappings by tracing
+ * @vm: Pointer to the VirtualMachine
+ *
+ * Installs the VM's roots and tracing hooks on vm->gc (see vm_gc.c).
+ * AMLP_GC_SLICE_USEC overrides the pause budget of one slice.
+ */
+void vm_gc_attach(VirtualMachine *vm);
+
+/**
+ * vm_gc_step - Run one incremental collector slice
+ * @vm: Pointer to the VirtualMachine
+ *
+ * Only call this between top-level executions, when every live array
+ * and mapping is reachable from the stack, globals or an object.
+ *
+ * Returns: 1 while a collection is still in progress, 0 otherwise
+ */
+int vm_gc_step(VirtualMachine *vm);
+
 /* ========== Function Operations ========== */
 
 /**
@@ -424,10 +733,111 @@ VMFunction* vm_function_create(const char *name, int param_count, int local_var_
  * @function: The function
  * @instruction: Instruction to add
  * 
- * Returns: 0 on success, -1 on error
+ * Packs the instruction, copying any string or call name operand into
+ * the function's own tables.
+ * 
+ * Returns: Index of the new instruction, or -1 on error
  */
 int vm_function_add_instruction(VMFunction *function, VMInstruction instruction);
 
+/**
+ * vm_function_emit - Append a packed instruction
+ * @function: The function
+ * @opcode: Opcode
+ * @imm: Immediate (table index, slot, count or jump target)
+ * 
+ * Returns: Index of the new instruction, or -1 if @imm does not fit
+ */
+int vm_function_emit(VMFunction *function, OpCode opcode, long imm);
+
+/**
+ * vm_function_emit_int - Append a PUSH_INT, spilling wide values to
+ * the constant table
+ * 
+ * Returns: Index of the new instruction, or -1 on error
+ */
+int vm_function_emit_int(VMFunction *function, long value);
+
+/**
+ * vm_function_emit_constant - Append PUSH_FLOAT, PUSH_STRING or
+ * PUSH_CONST for @value; the constant table takes over its reference
+ * 
+ * Returns: Index of the new instruction, or -1 on error
+ */
+int vm_function_emit_constant(VMFunction *function, OpCode opcode, VMValue value);
+
+/**
+ * vm_function_emit_call - Append an OP_CALL with a new call site
+ * @name: Function name to link, or NULL to call @target directly
+ * 
+ * Returns: Index of the new instruction, or -1 on error
+ */
+int vm_function_emit_call(VMFunction *function, const char *name, int arg_count, int target);
+
+/**
+ * vm_function_emit_call_method - Append an OP_CALL_METHOD with its own
+ * inline cache
+ * 
+ * Returns: Index of the new instruction, or -1 on error
+ */
+int vm_function_emit_call_method(VMFunction *function, int arg_count);
+
+/**
+ * vm_function_patch_jump - Point the jump at @index to @target
+ * 
+ * Returns: 0 on success, -1 if @index is not a jump
+ */
+int vm_function_patch_jump(VMFunction *function, int index, int target);
+
+/**
+ * vm_code_branch_target - Target of a branch instruction
+ * 
+ * Returns: Instruction index @word jumps to, or -1 if it does not branch
+ */
+int vm_code_branch_target(VMCode word);
+
+/**
+ * vm_code_retarget - Replace the target of a branch instruction
+ * 
+ * Returns: 0 on success, -1 if @word does not branch or @target does not
+ * fit its encoding
+ */
+int vm_code_retarget(VMCode *word, int target);
+
+/**
+ * vm_optimize_function - Peephole-optimize a function's code
+ * @function: Function not yet added to a VM
+ * @level: VM_OPT_* level
+ * 
+ * Folds constants, removes dead jumps and unreachable code and, at
+ * VM_OPT_FUSE, fuses common sequences into superinstructions. Jump
+ * targets and the line map are remapped to the new code.
+ * 
+ * Returns: Number of instructions removed
+ */
+int vm_optimize_function(VMFunction *function, int level);
+
+/**
+ * vm_function_decode - Unpack one instruction
+ * @function: The function
+ * @index: Instruction index
+ * @out: Receives the instruction; strings point into the function's tables
+ * 
+ * Returns: 0 on success, -1 on error
+ */
+int vm_function_decode(const VMFunction *function, int index, VMInstruction *out);
+
+/**
+ * vm_function_copy - Copy a function with its code and tables
+ * @function: The function to copy
+ * 
+ * Call sites keep their bindings; method caches start empty. The copy
+ * is not in any VM until vm_add_function().
+ * 
+ * Returns: Pointer to new function, or NULL on error
+ */
+VMFunction* vm_function_copy(const VMFunction *function);
+
 /**
  * vm_function_free - Free a function and its instructions
  * @function: The function to free
@@ -458,13 +868,14 @@ void vm_disassemble_function(VMFunction *function);
 /* ========== Debugging/Tracing API ========== */
 
 void vm_debug_init(VirtualMachine *vm);
+void vm_debug_shutdown(VirtualMachine *vm);
 void vm_debug_set_flags(VirtualMachine *vm, unsigned int flags);
 unsigned int vm_debug_get_flags(VirtualMachine *vm);
 void vm_debug_enable(VirtualMachine *vm, unsigned int flags);
 void vm_debug_disable(VirtualMachine *vm, unsigned int flags);
 
 void vm_trace_instruction(VirtualMachine *vm, CallFrame *frame,
-                          VMInstruction *instr, int instruction_index);
+                          VMCode word, int instruction_index);
 void vm_trace_dump_call_stack(VirtualMachine *vm, const char *reason);
 void vm_trace_dump_function(VirtualMachine *vm, VMFunction *function, FILE *out);
 
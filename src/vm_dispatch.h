@@ -0,0 +1,621 @@
+/*
+ * vm_dispatch.h - Bytecode Dispatch Loop
+ *
+ * The interpreter core. This file is not a normal header: vm.c includes it
+ * twice to stamp out two copies of the same loop,
+ *
+ *   VM_RUN_NAME = vm_run_fast,   VM_RUN_TRACED = 0  (production path)
+ *   VM_RUN_NAME = vm_run_traced, VM_RUN_TRACED = 1  (debug/trace hooks)
+ *
+ * so the production loop carries no per-instruction checks for tracing.
+ * With VM_THREADED_DISPATCH each handler ends by indexing a label table
+ * with the next word's opcode byte (GCC labels-as-values); otherwise a
+ * portable switch is used. Instructions are packed VMCode words, see vm.h.
+ *
+ * A loop runs the current context (a frame, or top-level code when there
+ * is none). OP_CALL to an LPC function pushes a frame and continues in the
+ * same loop; the loop returns when the frame at exit_depth returns, or when
+ * top-level code halts.
+ */
+
+static int VM_RUN_NAME(VirtualMachine *vm, int exit_depth) {
+#if VM_THREADED_DISPATCH
+    static const void *const labels[VM_OPCODE_COUNT] = {
+        [OP_PUSH_INT] = &&L_OP_PUSH_INT,
+        [OP_PUSH_FLOAT] = &&L_OP_PUSH_FLOAT,
+        [OP_PUSH_STRING] = &&L_OP_PUSH_STRING,
+        [OP_PUSH_NULL] = &&L_OP_PUSH_NULL,
+        [OP_POP] = &&L_OP_POP,
+        [OP_DUP] = &&L_OP_DUP,
+        [OP_LOAD_LOCAL] = &&L_OP_LOAD_LOCAL,
+        [OP_STORE_LOCAL] = &&L_OP_STORE_LOCAL,
+        [OP_LOAD_GLOBAL] = &&L_OP_LOAD_GLOBAL,
+        [OP_STORE_GLOBAL] = &&L_OP_STORE_GLOBAL,
+        [OP_ADD] = &&L_OP_ADD,
+        [OP_SUB] = &&L_OP_SUB,
+        [OP_MUL] = &&L_OP_MUL,
+        [OP_DIV] = &&L_OP_DIV,
+        [OP_MOD] = &&L_OP_MOD,
+        [OP_NEG] = &&L_OP_NEG,
+        [OP_EQ] = &&L_OP_EQ,
+        [OP_NE] = &&L_OP_NE,
+        [OP_LT] = &&L_OP_LT,
+        [OP_LE] = &&L_OP_LE,
+        [OP_GT] = &&L_OP_GT,
+        [OP_GE] = &&L_OP_GE,
+        [OP_AND] = &&L_OP_AND,
+        [OP_OR] = &&L_OP_OR,
+        [OP_NOT] = &&L_OP_NOT,
+        [OP_BIT_AND] = &&L_OP_BIT_AND,
+        [OP_BIT_OR] = &&L_OP_BIT_OR,
+        [OP_BIT_XOR] = &&L_OP_BIT_XOR,
+        [OP_BIT_NOT] = &&L_OP_BIT_NOT,
+        [OP_LSHIFT] = &&L_OP_LSHIFT,
+        [OP_RSHIFT] = &&L_OP_RSHIFT,
+        [OP_JUMP] = &&L_OP_JUMP,
+        [OP_JUMP_IF_FALSE] = &&L_OP_JUMP_IF_FALSE,
+        [OP_JUMP_IF_TRUE] = &&L_OP_JUMP_IF_TRUE,
+        [OP_CALL] = &&L_OP_CALL,
+        [OP_RETURN] = &&L_OP_RETURN,
+        [OP_MAKE_ARRAY] = &&L_OP_MAKE_ARRAY,
+        [OP_INDEX_ARRAY] = &&L_OP_INDEX_ARRAY,
+        [OP_STORE_ARRAY] = &&L_OP_STORE_ARRAY,
+        [OP_MAKE_MAPPING] = &&L_OP_MAKE_MAPPING,
+        [OP_INDEX_MAPPING] = &&L_OP_INDEX_MAPPING,
+        [OP_STORE_MAPPING] = &&L_OP_STORE_MAPPING,
+        [OP_CALL_METHOD] = &&L_OP_CALL_METHOD,
+        [OP_SLICE_RANGE] = &&L_OP_SLICE_RANGE,
+        [OP_HALT] = &&L_OP_HALT,
+        [OP_PRINT] = &&L_OP_PRINT,
+        [OP_PUSH_CONST] = &&L_OP_PUSH_CONST,
+        [OP_PUSH_INT_ADD] = &&L_OP_PUSH_INT_ADD,
+        [OP_INC_LOCAL] = &&L_OP_INC_LOCAL,
+        [OP_LOAD_LOCAL_LOAD_LOCAL] = &&L_OP_LOAD_LOCAL_LOAD_LOCAL,
+        [OP_CMP_JUMP_IF_FALSE] = &&L_OP_CMP_JUMP_IF_FALSE,
+        [OP_RETURN_LOCAL] = &&L_OP_RETURN_LOCAL,
+    };
+#endif
+
+    CallFrame *frame = vm->current_frame;
+    VMFunction *fn = frame ? frame->function : vm->toplevel;
+    const VMCode *code = fn->code;
+    int *ip_slot = frame ? &frame->instruction_pointer : &vm->instruction_pointer;
+    const VMCode *pc = code + *ip_slot;
+    VMCode w;
+
+/* Make the current position visible to anything that inspects frames */
+#define VM_SAVE_IP() (*ip_slot = (int)(pc - code))
+
+/* Switch to whichever context is now on top of the frame stack */
+#define VM_LOAD_CONTEXT() do { \
+        frame = vm->current_frame; \
+        fn = frame ? frame->function : vm->toplevel; \
+        code = fn->code; \
+        ip_slot = frame ? &frame->instruction_pointer : &vm->instruction_pointer; \
+        pc = code + *ip_slot; \
+    } while (0)
+
+#if VM_RUN_TRACED
+#define VM_FETCH() do { \
+        w = *pc++; \
+        VM_SAVE_IP(); \
+        vm_trace_instruction(vm, frame, w, (int)(pc - code) - 1); \
+    } while (0)
+#else
+#define VM_FETCH() (w = *pc++)
+#endif
+
+#if VM_THREADED_DISPATCH
+#define VM_CASE(op) L_##op:
+/* Opcodes are range-checked when the word is built (vm_function_emit) */
+#define VM_NEXT() do { VM_FETCH(); goto *labels[VM_CODE_OP(w)]; } while (0)
+#else
+#define VM_CASE(op) case op:
+#define VM_NEXT() continue
+#endif
+
+#define VM_CHECK(expr) do { if ((expr) < 0) goto vm_error; } while (0)
+
+#if VM_THREADED_DISPATCH
+    VM_NEXT();
+    {
+#else
+    for (;;) {
+        VM_FETCH();
+        switch (VM_CODE_OP(w)) {
+#endif
+
+    /* ---------- Stack ---------- */
+
+    VM_CASE(OP_PUSH_INT)
+        VM_CHECK(vm_push_value(vm, vm_value_create_int(VM_CODE_SIMM(w))));
+        VM_NEXT();
+
+    /* Constant-table pushes share the table's reference */
+    VM_CASE(OP_PUSH_FLOAT)
+    VM_CASE(OP_PUSH_STRING)
+    VM_CASE(OP_PUSH_CONST)
+        VM_CHECK(vm_push_value(vm, fn->constants[VM_CODE_IMM(w)]));
+        VM_NEXT();
+
+    VM_CASE(OP_PUSH_NULL)
+        VM_CHECK(vm_push_value(vm, vm_value_create_null()));
+        VM_NEXT();
+
+    VM_CASE(OP_POP) {
+        VMValue v = vm_pop_value(vm);
+        vm_value_release(&v);
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_DUP)
+        VM_CHECK(vm_push_value(vm, vm_peek_value(vm)));
+        VM_NEXT();
+
+    /* ---------- Variables ---------- */
+
+    VM_CASE(OP_LOAD_LOCAL) {
+        long idx = (long)VM_CODE_IMM(w);
+        if (!frame) {
+            ERROR_LOG("OP_LOAD_LOCAL: No current frame");
+            goto vm_error;
+        }
+        if (idx < 0 || idx >= frame->function->param_count + frame->function->local_var_count) {
+            DEBUG_LOG_VM("OP_LOAD_LOCAL: idx=%ld out of bounds in %s", idx, frame->function->name);
+            goto vm_error;
+        }
+        VM_CHECK(vm_push_value(vm, frame->local_variables[idx]));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_STORE_LOCAL) {
+        long idx = (long)VM_CODE_IMM(w);
+        if (!frame) goto vm_error;
+        if (idx < 0 || idx >= frame->function->param_count + frame->function->local_var_count) {
+            DEBUG_LOG_VM("OP_STORE_LOCAL: idx=%ld out of bounds in %s", idx, frame->function->name);
+            goto vm_error;
+        }
+        VMValue v = vm_pop_value(vm);
+        vm_value_release(&frame->local_variables[idx]);
+        frame->local_variables[idx] = v;
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_LOAD_GLOBAL) {
+        long idx = VM_CODE_SIMM(w);
+        obj_t *self = vm->current_object;
+        if (self && self->variables) {
+            /* Running as an object: globals are its own variables */
+            if (idx < 0 || idx >= self->variable_count) goto vm_error;
+            VM_CHECK(vm_push_value(vm, self->variables[idx]));
+            VM_NEXT();
+        }
+        if (idx < 0 || idx >= vm->global_count) goto vm_error;
+        VM_CHECK(vm_push_value(vm, vm->global_variables[idx]));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_STORE_GLOBAL) {
+        long idx = VM_CODE_SIMM(w);
+        obj_t *self = vm->current_object;
+        if (self && self->variables) {
+            if (idx < 0 || idx >= self->variable_count) goto vm_error;
+            VMValue v = vm_pop_value(vm);
+            vm_value_release(&self->variables[idx]);
+            vm_value_write_barrier(v);
+            self->variables[idx] = v;
+            VM_NEXT();
+        }
+        if (idx < 0) {
+            if (vm->global_count >= vm->global_capacity) {
+                vm->global_capacity *= 2;
+                vm->global_variables = (VMValue *)realloc(vm->global_variables,
+                                                           sizeof(VMValue) * vm->global_capacity);
+            }
+            idx = vm->global_count++;
+        }
+        VMValue v = vm_pop_value(vm);
+        if (idx < vm->global_count) {
+            vm_value_release(&vm->global_variables[idx]);
+        }
+        vm->global_variables[idx] = v;
+        VM_NEXT();
+    }
+
+    /* ---------- Arithmetic, comparison, logic ---------- */
+
+    VM_CASE(OP_ADD) vm_arithmetic_op(vm, 0); VM_NEXT();
+    VM_CASE(OP_SUB) vm_arithmetic_op(vm, 1); VM_NEXT();
+    VM_CASE(OP_MUL) vm_arithmetic_op(vm, 2); VM_NEXT();
+    VM_CASE(OP_DIV) vm_arithmetic_op(vm, 3); VM_NEXT();
+    VM_CASE(OP_MOD) vm_arithmetic_op(vm, 4); VM_NEXT();
+    VM_CASE(OP_NEG) vm_negate(vm); VM_NEXT();
+
+    VM_CASE(OP_EQ) vm_comparison_op(vm, 0); VM_NEXT();
+    VM_CASE(OP_NE) vm_comparison_op(vm, 1); VM_NEXT();
+    VM_CASE(OP_LT) vm_comparison_op(vm, 2); VM_NEXT();
+    VM_CASE(OP_LE) vm_comparison_op(vm, 3); VM_NEXT();
+    VM_CASE(OP_GT) vm_comparison_op(vm, 4); VM_NEXT();
+    VM_CASE(OP_GE) vm_comparison_op(vm, 5); VM_NEXT();
+
+    VM_CASE(OP_AND) vm_logical_and(vm); VM_NEXT();
+    VM_CASE(OP_OR) vm_logical_or(vm); VM_NEXT();
+    VM_CASE(OP_NOT) vm_logical_not(vm); VM_NEXT();
+
+    VM_CASE(OP_BIT_AND) vm_bitwise_op(vm, 0); VM_NEXT();
+    VM_CASE(OP_BIT_OR) vm_bitwise_op(vm, 1); VM_NEXT();
+    VM_CASE(OP_BIT_XOR) vm_bitwise_op(vm, 2); VM_NEXT();
+    VM_CASE(OP_BIT_NOT) vm_bitwise_op(vm, 3); VM_NEXT();
+    VM_CASE(OP_LSHIFT) vm_bitwise_op(vm, 4); VM_NEXT();
+    VM_CASE(OP_RSHIFT) vm_bitwise_op(vm, 5); VM_NEXT();
+
+    /* ---------- Control flow (targets validated by vm_prepare_function) ---------- */
+
+    VM_CASE(OP_JUMP)
+        pc = code + VM_CODE_IMM(w);
+        VM_NEXT();
+
+    VM_CASE(OP_JUMP_IF_FALSE) {
+        VMValue cond = vm_pop_value(vm);
+        if (!vm_value_is_truthy(cond)) {
+            pc = code + VM_CODE_IMM(w);
+        }
+        vm_value_release(&cond);
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_JUMP_IF_TRUE) {
+        VMValue cond = vm_pop_value(vm);
+        if (vm_value_is_truthy(cond)) {
+            pc = code + VM_CODE_IMM(w);
+        }
+        vm_value_release(&cond);
+        VM_NEXT();
+    }
+
+    /* ---------- Calls ---------- */
+
+    VM_CASE(OP_CALL) {
+        int arg_count = (int)VM_CODE_ARGC(w);
+        VMCallSite *site = &fn->call_sites[VM_CODE_SITE(w)];
+
+        /* Inline cache: cross-program targets go stale when the function
+         * table changes; local and efun bindings never do. */
+        if (site->link == VM_CALL_CACHED && site->generation != vm->call_generation) {
+            site->link = VM_CALL_UNLINKED;
+        }
+        if (site->link == VM_CALL_UNLINKED && vm_resolve_call(vm, site, 0, 0) != 0) {
+            DEBUG_LOG_VM("OP_CALL: Unknown function: %s", site->name);
+            goto vm_error;
+        }
+        if (site->link == VM_CALL_EFUN) {
+            if (arg_count > vm->stack->top) goto vm_error;
+            VM_SAVE_IP();
+
+            /* Arguments are already contiguous on the stack in call order */
+            EfunEntry *efun_entry = &vm->efun_registry->efuns[site->target];
+            VMValue *args = arg_count > 0 ? &vm->stack->values[vm->stack->top - arg_count] : NULL;
+            VMValue result = efun_entry->callback(vm, args, arg_count);
+
+            for (int i = 0; i < arg_count; i++) {
+                VMValue arg = vm_pop_value(vm);
+                vm_value_release(&arg);
+            }
+            VM_CHECK(vm_push_value(vm, result));
+            VM_NEXT();
+        }
+
+        /* LPC function: push a frame and keep going in this loop */
+        int target = site->target;
+        if (site->link == VM_CALL_VIRTUAL) {
+            /* The object's program may override the function: one table
+             * lookup, when the object really runs the program linked */
+            ObjProgram *program = vm->current_object ? vm->current_object->program : NULL;
+            if (program && site->slot < program->function_count &&
+                program->functions[site->slot]->index == target) {
+                target = program->functions[program->dispatch[site->slot]]->index;
+            }
+        }
+        if (target < 0 || target >= vm->function_count) goto vm_error;
+        VMFunction *callee = vm->functions[target];
+        if (!callee || callee->param_count != arg_count || arg_count > vm->stack->top) goto vm_error;
+
+        VM_SAVE_IP();
+        if (!vm_push_frame(vm, callee, arg_count)) goto vm_error;
+        VM_LOAD_CONTEXT();
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_RETURN)
+    VM_CASE(OP_HALT)
+    vm_return:
+        if (!frame) {
+            /* Top-level code is done */
+            VM_SAVE_IP();
+            goto vm_done;
+        }
+        vm_pop_frame(vm);
+        if (vm->frame_count == exit_depth) goto vm_done;
+        VM_LOAD_CONTEXT();
+        VM_NEXT();
+
+    VM_CASE(OP_CALL_METHOD) {
+        int arg_count = (int)VM_CODE_ARGC(w);
+        if (arg_count > vm->stack->top - 2) {
+            fprintf(stderr, "[VM] OP_CALL_METHOD: invalid arg_count=%d (stack=%d)\n",
+                    arg_count, vm->stack->top);
+            vm_push_value(vm, vm_value_create_null());
+            goto vm_error;
+        }
+        VM_SAVE_IP();
+
+        /* Stack: [object, method name, args...]; the arguments stay in
+         * place and become the callee's parameters */
+        int base = vm->stack->top - arg_count - 2;
+        VMValue obj_val = vm->stack->values[base];
+        VMValue method_val = vm->stack->values[base + 1];
+        int status = 0;
+        VMFunction *method = NULL;
+
+        if (method_val.type != VALUE_STRING || !method_val.data.string_value) {
+            DEBUG_LOG_VM("OP_CALL_METHOD: method name must be string");
+            status = -1;
+        } else if (obj_val.type != VALUE_OBJECT || !obj_val.data.object_value) {
+            DEBUG_LOG_VM("OP_CALL_METHOD: invalid object reference");
+            status = -1;
+        } else {
+            method = vm_lookup_method(vm, &fn->method_caches[VM_CODE_SITE(w)],
+                                      (obj_t *)obj_val.data.object_value,
+                                      method_val.data.string_value);
+            if (!method) {
+                DEBUG_LOG_OBJ("Method '%s' not found in object '%s'",
+                              method_val.data.string_value,
+                              ((obj_t *)obj_val.data.object_value)->name);
+            } else if (method->param_count != arg_count) {
+                DEBUG_LOG_OBJ("Method '%s' expects %d arguments, got %d",
+                              method->name, method->param_count, arg_count);
+                method = NULL;
+            }
+        }
+
+        /* A failed or missing method yields null, like obj_call_method() */
+        VMValue result;
+        result.type = VALUE_NULL;
+        if (method) {
+            /* The callee runs as the target object */
+            obj_t *saved_object = vm->current_object;
+            vm->current_object = (obj_t *)obj_val.data.object_value;
+            if (vm_call_function(vm, method->index, arg_count) == 0) {
+                result = vm_pop_value(vm);
+            }
+            vm->current_object = saved_object;
+        }
+        vm_unwind_stack(vm, base);
+        vm->stack->values[vm->stack->top++] = result;
+
+        VM_CHECK(status);
+        VM_NEXT();
+    }
+
+    /* ---------- Arrays and mappings ---------- */
+
+    VM_CASE(OP_MAKE_ARRAY) {
+        int size = (int)VM_CODE_IMM(w);
+        array_t *arr = array_new(vm->gc, size);
+        for (int i = 0; i < size; i++) {
+            VMValue v = vm_pop_value(vm);
+            array_push(arr, v);
+        }
+        VMValue arr_val;
+        arr_val.type = VALUE_ARRAY;
+        arr_val.data.array_value = arr;
+        VM_CHECK(vm_push_value(vm, arr_val));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_INDEX_ARRAY) {
+        VMValue idx_val = vm_pop_value(vm);
+        VMValue arr_val = vm_pop_value(vm);
+        if (arr_val.type != VALUE_ARRAY) goto vm_error;
+
+        int idx = (idx_val.type == VALUE_INT) ? idx_val.data.int_value : (int)idx_val.data.float_value;
+        VMValue result = array_get((array_t *)arr_val.data.array_value, idx);
+        VM_CHECK(vm_push_value(vm, result));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_STORE_ARRAY) {
+        VMValue val = vm_pop_value(vm);
+        VMValue idx_val = vm_pop_value(vm);
+        VMValue arr_val = vm_pop_value(vm);
+        if (arr_val.type != VALUE_ARRAY) goto vm_error;
+
+        int idx = (idx_val.type == VALUE_INT) ? idx_val.data.int_value : (int)idx_val.data.float_value;
+        VM_CHECK(array_set((array_t *)arr_val.data.array_value, idx, val));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_SLICE_RANGE)
+        VM_CHECK(vm_slice_range(vm));
+        VM_NEXT();
+
+    VM_CASE(OP_MAKE_MAPPING) {
+        int pair_count = (int)VM_CODE_IMM(w);
+        if (vm->stack->top < 2 * pair_count) goto vm_error;
+        size_t hint = (size_t)pair_count * MAPPING_MAX_LOAD_DEN / MAPPING_MAX_LOAD_NUM + 1;
+        mapping_t *map = mapping_new(vm->gc, hint > VM_MAPPING_BUCKETS ? hint : VM_MAPPING_BUCKETS);
+
+        /* Store the pairs in source order, so the literal iterates as written */
+        VMValue *pairs = &vm->stack->values[vm->stack->top - 2 * pair_count];
+        for (int i = 0; i < pair_count; i++) {
+            mapping_store(map, pairs[2 * i], pairs[2 * i + 1]);
+            vm_value_release(&pairs[2 * i]);
+        }
+        vm->stack->top -= 2 * pair_count;
+        VMValue map_val;
+        map_val.type = VALUE_MAPPING;
+        map_val.data.mapping_value = map;
+        VM_CHECK(vm_push_value(vm, map_val));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_INDEX_MAPPING) {
+        VMValue key_val = vm_pop_value(vm);
+        VMValue map_val = vm_pop_value(vm);
+        if (map_val.type != VALUE_MAPPING) goto vm_error;
+
+        VMValue result = mapping_lookup((mapping_t *)map_val.data.mapping_value, key_val);
+        vm_value_release(&key_val);
+        VM_CHECK(vm_push_value(vm, result));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_STORE_MAPPING) {
+        VMValue val = vm_pop_value(vm);
+        VMValue key_val = vm_pop_value(vm);
+        VMValue map_val = vm_pop_value(vm);
+        if (map_val.type != VALUE_MAPPING) goto vm_error;
+
+        mapping_entry_t *entry = mapping_store((mapping_t *)map_val.data.mapping_value,
+                                               key_val, val);
+        vm_value_release(&key_val);
+        if (!entry) goto vm_error;
+        VM_NEXT();
+    }
+
+    /* ---------- Superinstructions (see vm_optimize_function) ----------
+     * Each has an int-only fast path and otherwise does exactly what the
+     * sequence it replaced would have done. */
+
+    VM_CASE(OP_PUSH_INT_ADD) {
+        VMValue *top = vm->stack->top > 0 ? &vm->stack->values[vm->stack->top - 1] : NULL;
+        if (top && top->type == VALUE_INT) {
+            top->data.int_value += VM_CODE_SIMM(w);
+        } else {
+            VM_CHECK(vm_push_value(vm, vm_value_create_int(VM_CODE_SIMM(w))));
+            vm_arithmetic_op(vm, 0);
+        }
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_INC_LOCAL) {
+        int idx = VM_CODE_LO(w);
+        if (!frame || idx >= frame->function->param_count + frame->function->local_var_count) {
+            DEBUG_LOG_VM("OP_INC_LOCAL: idx=%d out of bounds", idx);
+            goto vm_error;
+        }
+        VMValue *local = &frame->local_variables[idx];
+        if (local->type == VALUE_INT) {
+            local->data.int_value += VM_CODE_SHI(w);
+        } else {
+            VM_CHECK(vm_push_value(vm, *local));
+            VM_CHECK(vm_push_value(vm, vm_value_create_int(VM_CODE_SHI(w))));
+            vm_arithmetic_op(vm, 0);
+            VMValue v = vm_pop_value(vm);
+            vm_value_release(local);
+            *local = v;
+        }
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_LOAD_LOCAL_LOAD_LOCAL) {
+        int first = VM_CODE_LO(w);
+        int second = VM_CODE_HI(w);
+        if (!frame) {
+            ERROR_LOG("OP_LOAD_LOCAL: No current frame");
+            goto vm_error;
+        }
+        int total_vars = frame->function->param_count + frame->function->local_var_count;
+        if (first >= total_vars || second >= total_vars) {
+            DEBUG_LOG_VM("OP_LOAD_LOCAL_LOAD_LOCAL: idx=%d,%d out of bounds in %s",
+                         first, second, frame->function->name);
+            goto vm_error;
+        }
+        VM_CHECK(vm_push_value(vm, frame->local_variables[first]));
+        VM_CHECK(vm_push_value(vm, frame->local_variables[second]));
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_CMP_JUMP_IF_FALSE) {
+        int cmp = VM_CODE_LO(w);
+        VMValue *values = vm->stack->values;
+        int top = vm->stack->top;
+        int taken;
+        if (top >= 2 && values[top - 2].type == VALUE_INT && values[top - 1].type == VALUE_INT) {
+            long a = values[top - 2].data.int_value;
+            long b = values[top - 1].data.int_value;
+            switch (cmp) {
+                case 0: taken = a == b; break;
+                case 1: taken = a != b; break;
+                case 2: taken = a < b; break;
+                case 3: taken = a <= b; break;
+                case 4: taken = a > b; break;
+                default: taken = a >= b; break;
+            }
+            vm->stack->top -= 2;
+        } else {
+            vm_comparison_op(vm, cmp);
+            VMValue cond = vm_pop_value(vm);
+            taken = vm_value_is_truthy(cond);
+            vm_value_release(&cond);
+        }
+        if (!taken) {
+            pc = code + VM_CODE_HI(w);
+        }
+        VM_NEXT();
+    }
+
+    VM_CASE(OP_RETURN_LOCAL) {
+        int idx = VM_CODE_IMM(w);
+        if (!frame || idx >= frame->function->param_count + frame->function->local_var_count) {
+            DEBUG_LOG_VM("OP_RETURN_LOCAL: idx=%d out of bounds", idx);
+            goto vm_error;
+        }
+        VM_CHECK(vm_push_value(vm, frame->local_variables[idx]));
+        goto vm_return;
+    }
+
+    /* ---------- Special ---------- */
+
+    VM_CASE(OP_PRINT) {
+        VMValue v = vm_pop_value(vm);
+        char *str = vm_value_to_string(v);
+        printf("%s\n", str);
+        free(str);
+        vm_value_release(&v);
+        VM_NEXT();
+    }
+
+#if !VM_THREADED_DISPATCH
+        default:
+            ERROR_LOG("Unknown opcode: %d", (int)VM_CODE_OP(w));
+            goto vm_error;
+        }
+#endif
+    }
+
+vm_error:
+    VM_SAVE_IP();
+    vm->error_count++;
+    if (vm->debug_flags & VM_DEBUG_CALLSTACK) {
+        vm_trace_dump_call_stack(vm, "vm error");
+    }
+    /* Unwind every frame this loop pushed, releasing their stack regions */
+    while (vm->current_frame && vm->frame_count > exit_depth) {
+        CallFrame *dead = vm->current_frame;
+        vm_unwind_stack(vm, dead->stack_base);
+        vm->current_frame = dead->prev;
+        vm->frame_count--;
+    }
+    return -1;
+
+vm_done:
+    return 0;
+
+#undef VM_SAVE_IP
+#undef VM_LOAD_CONTEXT
+#undef VM_FETCH
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_CHECK
+}
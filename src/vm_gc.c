@@ -0,0 +1,157 @@
+/*
+ * vm_gc.c - Tracing Hooks for the Incremental Collector
+ *
+ * Arrays and mappings are reclaimed by tracing rather than by reference
+ * counting, so cycles between them (and through object properties) are
+ * collected. The roots are:
+ *
+ *   VM value stack, globals      marked atomically at the start of a
+ *   and call_out arguments       cycle and again before the sweep
+ *   properties and variables     scanned a chunk per call, newest object
+ *   of every object in the       first, so objects unregistered mid-scan
+ *   object manager               never shift an unscanned one past the cursor
+ *
+ * Stores into arrays, mappings, object properties and variables go through
+ * vm_value_write_barrier(), which marks the stored value while a cycle is
+ * marking. Slices must run where no C code holds an array or mapping that
+ * is not reachable from these roots; the driver runs them from its main
+ * loop between commands.
+ */
+
+#include "vm.h"
+#include "array.h"
+#include "mapping.h"
+#include "object.h"
+#include "efun.h"
+#include "scheduler.h"
+#include <stdlib.h>
+
+#define VM_GC_TRACED_TYPES ((1u << GC_TYPE_ARRAY) | (1u << GC_TYPE_MAPPING))
+
+static void vm_gc_mark_value(GC *gc, VMValue value) {
+    if (value.type == VALUE_ARRAY) {
+        gc_mark(gc, value.data.array_value);
+    } else if (value.type == VALUE_MAPPING) {
+        gc_mark(gc, value.data.mapping_value);
+    }
+}
+
+static void vm_gc_visit_value(VMValue value, void *ctx) {
+    vm_gc_mark_value((GC *)ctx, value);
+}
+
+static void vm_gc_mark_roots(GC *gc, void *ctx) {
+    VirtualMachine *vm = (VirtualMachine *)ctx;
+
+    if (vm->stack) {
+        for (int i = 0; i < vm->stack->top; i++) {
+            vm_gc_mark_value(gc, vm->stack->values[i]);
+        }
+    }
+    for (int i = 0; i < vm->global_count; i++) {
+        vm_gc_mark_value(gc, vm->global_variables[i]);
+    }
+    scheduler_visit_values(scheduler_global(), vm_gc_visit_value, gc);
+}
+
+/**
+ * Mark the properties of up to limit objects. cursor is one past the
+ * next object to scan, or 0 to start from the end of the manager.
+ */
+static int vm_gc_scan_objects(GC *gc, void *ctx, int cursor, int limit) {
+    (void)ctx;
+    ObjManager *mgr = efun_object_manager();
+    if (!mgr) return -1;
+
+    int next = cursor == 0 ? mgr->object_count : cursor;
+    if (next > mgr->object_count) next = mgr->object_count;
+
+    while (next > 0 && limit-- > 0) {
+        obj_t *obj = mgr->objects[--next];
+        if (!obj) continue;
+
+        for (int i = 0; i < obj->variable_count; i++) {
+            vm_gc_mark_value(gc, obj->variables[i]);
+        }
+        if (!obj->properties) continue;
+
+        for (int i = 0; i < obj->property_capacity; i++) {
+            for (ObjProperty *prop = obj->properties[i]; prop; prop = prop->next) {
+                vm_gc_mark_value(gc, prop->value);
+            }
+        }
+    }
+
+    return next > 0 ? next : -1;
+}
+
+static void vm_gc_trace(GC *gc, GCObject *obj, void *ctx) {
+    (void)ctx;
+
+    if (obj->type == GC_TYPE_ARRAY) {
+        /* Shared storage stays alive while any view of it does */
+        array_t *arr = (array_t *)obj->ptr;
+        const VMValue *values = arr->shared ? arr->shared->values : arr->elements;
+        size_t length = arr->shared ? arr->shared->length : arr->length;
+        for (size_t i = 0; i < length; i++) {
+            vm_gc_mark_value(gc, values[i]);
+        }
+    } else if (obj->type == GC_TYPE_MAPPING) {
+        mapping_t *map = (mapping_t *)obj->ptr;
+        size_t cursor = 0;
+        mapping_entry_t *entry;
+        while ((entry = mapping_next(map, &cursor)) != NULL) {
+            vm_gc_mark_value(gc, entry->key);
+            vm_gc_mark_value(gc, entry->value);
+        }
+    }
+}
+
+static void vm_gc_finalize(GC *gc, GCObject *obj, void *ctx) {
+    (void)gc;
+    (void)ctx;
+
+    if (obj->type == GC_TYPE_ARRAY) {
+        array_free_shallow((array_t *)obj->ptr);
+    } else if (obj->type == GC_TYPE_MAPPING) {
+        mapping_free_shallow((mapping_t *)obj->ptr);
+    }
+}
+
+void vm_gc_attach(VirtualMachine *vm) {
+    if (!vm || !vm->gc) return;
+
+    GCTracer tracer = {
+        .types = VM_GC_TRACED_TYPES,
+        .mark_roots = vm_gc_mark_roots,
+        .scan_roots = vm_gc_scan_objects,
+        .trace = vm_gc_trace,
+        .finalize = vm_gc_finalize,
+        .ctx = vm,
+    };
+    gc_set_tracer(vm->gc, &tracer);
+
+    const char *budget = getenv("AMLP_GC_SLICE_USEC");
+    if (budget && *budget) {
+        gc_set_slice_budget(vm->gc, atol(budget));
+    }
+}
+
+int vm_gc_step(VirtualMachine *vm) {
+    if (!vm || !vm->gc) return 0;
+    return gc_step(vm->gc);
+}
+
+void vm_value_write_barrier(VMValue value) {
+    GC *gc = NULL;
+
+    if (value.type == VALUE_ARRAY && value.data.array_value) {
+        gc = value.data.array_value->gc;
+    } else if (value.type == VALUE_MAPPING && value.data.mapping_value) {
+        gc = value.data.mapping_value->gc;
+    }
+
+    if (gc && gc->phase == GC_PHASE_MARK) {
+        vm_gc_mark_value(gc, value);
+    }
+}
@@ -0,0 +1,359 @@
+/*
+ * vm_optimize.c - Bytecode Peephole Optimizer
+ *
+ * Rewrites a function's packed code before it is added to the VM. The
+ * pass streams the instructions into a new buffer and, after each one,
+ * rewrites the tail of the buffer while a rule matches:
+ *
+ *   VM_OPT_PEEPHOLE  PUSH_INT a; PUSH_INT b; <op>   -> PUSH_INT (a op b)
+ *                    PUSH_INT a; NEG/NOT/BIT_NOT   -> PUSH_INT
+ *                    PUSH_INT c; JUMP_IF_FALSE t   -> JUMP t, or nothing
+ *                    JUMP to the next instruction  -> removed
+ *                    jumps to JUMPs                -> threaded to the final target
+ *                    unreachable code              -> removed
+ *
+ *   VM_OPT_FUSE      PUSH_INT k; ADD                         -> PUSH_INT_ADD k
+ *                    LOAD_LOCAL n; PUSH_INT_ADD k; STORE_LOCAL n -> INC_LOCAL n, k
+ *                    LOAD_LOCAL a; LOAD_LOCAL b              -> LOAD_LOCAL_LOAD_LOCAL a, b
+ *                    EQ..GE; JUMP_IF_FALSE t                 -> CMP_JUMP_IF_FALSE
+ *                    LOAD_LOCAL n; RETURN                    -> RETURN_LOCAL n
+ *
+ * A jump target always starts an instruction of the output, so a rule
+ * never reaches back past one. Passes repeat until the code stops
+ * shrinking, since removing dead code can expose new jumps-to-next.
+ */
+
+#include "vm.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VM_OPT_MAX_PASSES  8
+#define VM_OPT_MAX_THREAD  16
+
+/* Output buffer; branch targets stay in input numbering until the end */
+typedef struct {
+    VMCode *code;
+    int *target;        /* Input index a branch goes to, -1 otherwise */
+    int *line;
+    char *label;        /* Instruction starts at a jump target */
+    int count;
+} OptBuffer;
+
+static int opt_is_int(VMCode word) {
+    return VM_CODE_OP(word) == OP_PUSH_INT;
+}
+
+static int opt_fits_imm24(long value) {
+    return value >= VM_IMM24_MIN && value <= VM_IMM24_MAX;
+}
+
+/* Fold a binary op over two ints the way vm.c computes it; 0 if it cannot */
+static int opt_fold_binary(OpCode opcode, long a, long b, long *result) {
+    switch (opcode) {
+        case OP_ADD: *result = a + b; return 1;
+        case OP_SUB: *result = a - b; return 1;
+        case OP_MUL: *result = a * b; return 1;
+        case OP_MOD:
+            if (b == 0) return 0;
+            *result = a % b;
+            return 1;
+        case OP_EQ: *result = a == b; return 1;
+        case OP_NE: *result = a != b; return 1;
+        case OP_LT: *result = a < b; return 1;
+        case OP_LE: *result = a <= b; return 1;
+        case OP_GT: *result = a > b; return 1;
+        case OP_GE: *result = a >= b; return 1;
+        case OP_AND: *result = a && b; return 1;
+        case OP_OR: *result = a || b; return 1;
+        case OP_BIT_AND: *result = a & b; return 1;
+        case OP_BIT_OR: *result = a | b; return 1;
+        case OP_BIT_XOR: *result = a ^ b; return 1;
+        case OP_LSHIFT:
+            if (b < 0 || b > 31) return 0;
+            *result = a << b;
+            return 1;
+        case OP_RSHIFT:
+            if (b < 0 || b > 31) return 0;
+            *result = a >> b;
+            return 1;
+        default:
+            return 0;   /* DIV yields a float */
+    }
+}
+
+static int opt_fold_unary(OpCode opcode, long a, long *result) {
+    switch (opcode) {
+        case OP_NEG: *result = -a; return 1;
+        case OP_NOT: *result = !a; return 1;
+        case OP_BIT_NOT: *result = ~a; return 1;
+        default: return 0;
+    }
+}
+
+static int opt_is_comparison(OpCode opcode) {
+    return opcode >= OP_EQ && opcode <= OP_GE;
+}
+
+static int opt_ends_block(VMCode word) {
+    switch (VM_CODE_OP(word)) {
+        case OP_JUMP:
+        case OP_RETURN:
+        case OP_HALT:
+        case OP_RETURN_LOCAL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* The last @n entries can be rewritten as one group */
+static int opt_tail(OptBuffer *out, int n) {
+    if (out->count < n) return 0;
+    for (int i = out->count - n + 1; i < out->count; i++) {
+        if (out->label[i]) return 0;
+    }
+    return 1;
+}
+
+/* Replace the last @n entries with one instruction that keeps the first's
+ * label and line */
+static void opt_replace(OptBuffer *out, int n, VMCode word, int target) {
+    int at = out->count - n;
+    out->code[at] = word;
+    out->target[at] = target;
+    out->count = at + 1;
+}
+
+/* Drop the last @n entries; returns whether a jump target went with them */
+static int opt_drop(OptBuffer *out, int n) {
+    out->count -= n;
+    return out->label[out->count];
+}
+
+/**
+ * Apply one rule to the tail of @out. Returns 1 if something changed,
+ * 2 if the rewrite dropped a jump target (the next instruction inherits
+ * it), 0 if no rule matched.
+ */
+static int opt_rewrite_tail(OptBuffer *out, int level) {
+    int n = out->count;
+    if (n == 0) return 0;
+
+    VMCode last = out->code[n - 1];
+    OpCode op = VM_CODE_OP(last);
+    long result;
+
+    /* ---------- Constant folding ---------- */
+
+    if (opt_tail(out, 3) && opt_is_int(out->code[n - 3]) && opt_is_int(out->code[n - 2]) &&
+        opt_fold_binary(op, VM_CODE_SIMM(out->code[n - 3]), VM_CODE_SIMM(out->code[n - 2]), &result) &&
+        opt_fits_imm24(result)) {
+        opt_replace(out, 3, VM_CODE(OP_PUSH_INT, result), -1);
+        return 1;
+    }
+
+    if (opt_tail(out, 2) && opt_is_int(out->code[n - 2]) &&
+        opt_fold_unary(op, VM_CODE_SIMM(out->code[n - 2]), &result) && opt_fits_imm24(result)) {
+        opt_replace(out, 2, VM_CODE(OP_PUSH_INT, result), -1);
+        return 1;
+    }
+
+    /* ---------- Constant conditions ---------- */
+
+    if ((op == OP_JUMP_IF_FALSE || op == OP_JUMP_IF_TRUE) && opt_tail(out, 2)) {
+        VMCode cond = out->code[n - 2];
+        int known = 1, truthy = 0;
+        if (opt_is_int(cond)) {
+            truthy = VM_CODE_SIMM(cond) != 0;
+        } else if (VM_CODE_OP(cond) == OP_PUSH_NULL) {
+            truthy = 0;
+        } else {
+            known = 0;
+        }
+        if (known) {
+            if (truthy == (op == OP_JUMP_IF_TRUE)) {
+                opt_replace(out, 2, VM_CODE(OP_JUMP, 0), out->target[n - 1]);
+                return 1;
+            }
+            return opt_drop(out, 2) ? 2 : 1;
+        }
+    }
+
+    if (level < VM_OPT_FUSE) return 0;
+
+    /* ---------- Superinstructions ---------- */
+
+    if (op == OP_ADD && opt_tail(out, 2) && opt_is_int(out->code[n - 2])) {
+        opt_replace(out, 2, VM_CODE(OP_PUSH_INT_ADD, VM_CODE_SIMM(out->code[n - 2])), -1);
+        return 1;
+    }
+
+    if (op == OP_STORE_LOCAL && opt_tail(out, 3) && VM_CODE_OP(out->code[n - 2]) == OP_PUSH_INT_ADD) {
+        int slot = VM_CODE_IMM(last);
+        long delta = VM_CODE_SIMM(out->code[n - 2]);
+        VMCode load = out->code[n - 3];
+        if (slot < VM_IMM8_LIMIT && delta >= VM_IMM16_MIN && delta <= VM_IMM16_MAX) {
+            if (VM_CODE_OP(load) == OP_LOAD_LOCAL && VM_CODE_IMM(load) == slot) {
+                opt_replace(out, 3, VM_CODE_PAIR(OP_INC_LOCAL, slot, delta), -1);
+                return 1;
+            }
+            /* LOAD_LOCAL a; LOAD_LOCAL n was fused before the add arrived */
+            if (VM_CODE_OP(load) == OP_LOAD_LOCAL_LOAD_LOCAL && VM_CODE_HI(load) == slot) {
+                out->code[n - 3] = VM_CODE(OP_LOAD_LOCAL, VM_CODE_LO(load));
+                out->code[n - 2] = VM_CODE_PAIR(OP_INC_LOCAL, slot, delta);
+                out->count = n - 1;
+                return 1;
+            }
+        }
+    }
+
+    if (op == OP_LOAD_LOCAL && opt_tail(out, 2) && VM_CODE_OP(out->code[n - 2]) == OP_LOAD_LOCAL &&
+        VM_CODE_IMM(out->code[n - 2]) < VM_IMM8_LIMIT && VM_CODE_IMM(last) < VM_SITE_LIMIT) {
+        opt_replace(out, 2, VM_CODE_PAIR(OP_LOAD_LOCAL_LOAD_LOCAL,
+                                         VM_CODE_IMM(out->code[n - 2]), VM_CODE_IMM(last)), -1);
+        return 1;
+    }
+
+    if (op == OP_JUMP_IF_FALSE && opt_tail(out, 2) && opt_is_comparison(VM_CODE_OP(out->code[n - 2])) &&
+        out->target[n - 1] < VM_SITE_LIMIT) {
+        /* The target is re-encoded after remapping; new indices only shrink */
+        int cmp = VM_CODE_OP(out->code[n - 2]) - OP_EQ;
+        opt_replace(out, 2, VM_CODE_PAIR(OP_CMP_JUMP_IF_FALSE, cmp, 0), out->target[n - 1]);
+        return 1;
+    }
+
+    if (op == OP_RETURN && opt_tail(out, 2)) {
+        VMCode load = out->code[n - 2];
+        if (VM_CODE_OP(load) == OP_LOAD_LOCAL) {
+            opt_replace(out, 2, VM_CODE(OP_RETURN_LOCAL, VM_CODE_IMM(load)), -1);
+            return 1;
+        }
+        if (VM_CODE_OP(load) == OP_LOAD_LOCAL_LOAD_LOCAL) {
+            out->code[n - 2] = VM_CODE(OP_LOAD_LOCAL, VM_CODE_LO(load));
+            out->code[n - 1] = VM_CODE(OP_RETURN_LOCAL, VM_CODE_HI(load));
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Follow chains of unconditional jumps */
+static int opt_thread_target(const VMCode *code, int count, int target) {
+    for (int hops = 0; hops < VM_OPT_MAX_THREAD; hops++) {
+        if (target < 0 || target >= count || VM_CODE_OP(code[target]) != OP_JUMP) break;
+        int next = VM_CODE_IMM(code[target]);
+        if (next == target) break;
+        target = next;
+    }
+    return target;
+}
+
+/* One streaming pass over @function; returns the new instruction count or
+ * -1 if out of memory */
+static int opt_pass(VMFunction *function, int level) {
+    int count = function->instruction_count;
+    VMCode *code = function->code;
+
+    OptBuffer out;
+    out.code = (VMCode *)malloc(sizeof(VMCode) * (count + 1));
+    out.target = (int *)malloc(sizeof(int) * (count + 1));
+    out.line = (int *)malloc(sizeof(int) * (count + 1));
+    out.label = (char *)calloc(count + 1, 1);
+    out.count = 0;
+    int *new_index = (int *)malloc(sizeof(int) * (count + 1));
+    char *is_target = (char *)calloc(count + 1, 1);
+
+    if (!out.code || !out.target || !out.line || !out.label || !new_index || !is_target) {
+        free(out.code);
+        free(out.target);
+        free(out.line);
+        free(out.label);
+        free(new_index);
+        free(is_target);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int target = vm_code_branch_target(code[i]);
+        if (target >= 0 && target <= count) is_target[target] = 1;
+    }
+
+    int dead = 0;
+    int pending_label = 0;
+    for (int i = 0; i < count; i++) {
+        new_index[i] = out.count;
+        if (dead && !is_target[i]) continue;
+        dead = 0;
+
+        VMCode word = code[i];
+        int target = vm_code_branch_target(word);
+        if (target >= 0) {
+            target = opt_thread_target(code, count, target);
+            if (target == i + 1 && VM_CODE_OP(word) == OP_JUMP) {
+                pending_label |= is_target[i];
+                continue;
+            }
+        }
+
+        int at = out.count++;
+        out.code[at] = word;
+        out.target[at] = target;
+        out.line[at] = function->line_map && i < function->line_map_count ? function->line_map[i] : -1;
+        out.label[at] = is_target[i] || pending_label;
+        pending_label = 0;
+
+        if (level >= VM_OPT_PEEPHOLE) {
+            int changed;
+            while ((changed = opt_rewrite_tail(&out, level)) != 0) {
+                if (changed == 2) pending_label = 1;
+            }
+        }
+        dead = out.count > 0 && opt_ends_block(out.code[out.count - 1]);
+    }
+    new_index[count] = out.count;
+
+    /* Branch targets to output numbering */
+    for (int i = 0; i < out.count; i++) {
+        if (out.target[i] >= 0) {
+            int target = out.target[i] <= count ? new_index[out.target[i]] : out.count;
+            vm_code_retarget(&out.code[i], target);
+        }
+    }
+
+    memcpy(function->code, out.code, sizeof(VMCode) * out.count);
+    function->instruction_count = out.count;
+    if (function->line_map) {
+        memcpy(function->line_map, out.line, sizeof(int) * out.count);
+        function->line_map_count = out.count;
+    }
+
+    free(out.code);
+    free(out.target);
+    free(out.line);
+    free(out.label);
+    free(new_index);
+    free(is_target);
+    return out.count;
+}
+
+int vm_optimize_function(VMFunction *function, int level) {
+    if (!function || level <= VM_OPT_NONE || function->instruction_count == 0) return 0;
+
+    /* The line map is rewritten in place, so it must cover every instruction */
+    if (function->line_map && function->line_map_count < function->instruction_count) {
+        free(function->line_map);
+        function->line_map = NULL;
+        function->line_map_count = 0;
+    }
+
+    int original = function->instruction_count;
+    for (int pass = 0; pass < VM_OPT_MAX_PASSES; pass++) {
+        int before = function->instruction_count;
+        if (opt_pass(function, level) < 0 || function->instruction_count == before) break;
+    }
+
+    /* Keep the sentinel slot valid for code built with vm_function_emit() */
+    function->code[function->instruction_count] = VM_CODE(OP_RETURN, 0);
+    return original - function->instruction_count;
+}
@@ -6,6 +6,7 @@
  * Key features:
  *   - HTTP upgrade handshake with SHA-1 key validation
  *   - Frame encoding/decoding with masking support
+ *   - Incremental parser that unmasks and reassembles in place
  *   - Text, binary, ping/pong, and close frames
  *   - ANSI color code conversion for web clients
  */
@@ -234,6 +235,88 @@ static void str_trim(char *str) {
     }
 }
 
+/*
+ * Check one permessage-deflate offer (RFC 7692 section 7.1) and, if it
+ * can be honoured, note what it asked of the server. Offers with unknown
+ * or repeated parameters are declined. Returns 0 if accepted.
+ */
+static int parse_deflate_offer(char *offer, WSHandshake *result) {
+    char *save;
+    char *param = strtok_r(offer, ";", &save);
+    if (!param) return -1;
+    str_trim(param);
+    if (strcasecmp(param, "permessage-deflate") != 0) return -1;
+    
+    int no_context_takeover = 0, window_bits = 0;
+    int client_no_context_takeover = 0, client_window_bits = 0;
+    while ((param = strtok_r(NULL, ";", &save)) != NULL) {
+        char *value = strchr(param, '=');
+        if (value) {
+            *value++ = '\0';
+            str_trim(value);
+            size_t value_len = strlen(value);
+            if (value_len >= 2 && value[0] == '"' && value[value_len - 1] == '"') {
+                value[value_len - 1] = '\0';
+                value++;
+            }
+        }
+        str_trim(param);
+        
+        if (strcasecmp(param, "server_no_context_takeover") == 0) {
+            if (value || no_context_takeover) return -1;
+            no_context_takeover = 1;
+        } else if (strcasecmp(param, "server_max_window_bits") == 0) {
+            /* zlib cannot deflate with a 256-byte window, so 8 is declined */
+            if (!value || window_bits) return -1;
+            char *end;
+            long bits = strtol(value, &end, 10);
+            if (*end || bits < 9 || bits > 15) return -1;
+            window_bits = (int)bits;
+        } else if (strcasecmp(param, "client_no_context_takeover") == 0) {
+            /* Only a hint: the inflater copes either way */
+            if (value || client_no_context_takeover) return -1;
+            client_no_context_takeover = 1;
+        } else if (strcasecmp(param, "client_max_window_bits") == 0) {
+            /* Not echoed, so the client keeps its full window */
+            if (client_window_bits) return -1;
+            client_window_bits = 1;
+            if (value) {
+                char *end;
+                long bits = strtol(value, &end, 10);
+                if (*end || bits < 8 || bits > 15) return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+    
+    result->deflate_no_context_takeover = no_context_takeover;
+    result->deflate_window_bits = window_bits ? window_bits : 15;
+    return 0;
+}
+
+/*
+ * Accept the first permessage-deflate offer that can be honoured
+ */
+static void negotiate_deflate(const char *extensions, WSHandshake *result) {
+    char offer[256];
+    const char *p = extensions;
+    
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        if (len < sizeof(offer)) {
+            memcpy(offer, p, len);
+            offer[len] = '\0';
+            if (parse_deflate_offer(offer, result) == 0) {
+                result->deflate = 1;
+                return;
+            }
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+}
+
 /*
  * Check if data looks like WebSocket upgrade request
  */
@@ -279,6 +362,13 @@ int ws_handle_handshake(const char *request, size_t request_len, WSHandshake *re
         free(protocol);
     }
     
+    /* Optional compression */
+    char *extensions = find_header_value(request, "Sec-WebSocket-Extensions");
+    if (extensions) {
+        negotiate_deflate(extensions, result);
+        free(extensions);
+    }
+    
     /* Calculate accept key: SHA1(key + GUID) -> Base64 */
     size_t concat_len = strlen(key) + strlen(WS_GUID);
     char *concat = malloc(concat_len + 1);
@@ -300,6 +390,16 @@ int ws_handle_handshake(const char *request, size_t request_len, WSHandshake *re
     }
     
     /* Build HTTP response */
+    char extension[128] = "";
+    if (result->deflate) {
+        char window[40] = "";
+        if (result->deflate_window_bits < 15) {
+            snprintf(window, sizeof(window), "; server_max_window_bits=%d", result->deflate_window_bits);
+        }
+        snprintf(extension, sizeof(extension), "Sec-WebSocket-Extensions: permessage-deflate%s%s\r\n",
+                 result->deflate_no_context_takeover ? "; server_no_context_takeover" : "", window);
+    }
+    
     char response[1024];
     int len = snprintf(response, sizeof(response),
         "HTTP/1.1 101 Switching Protocols\r\n"
@@ -307,11 +407,13 @@ int ws_handle_handshake(const char *request, size_t request_len, WSHandshake *re
         "Connection: Upgrade\r\n"
         "Sec-WebSocket-Accept: %s\r\n"
         "%s%s%s"
+        "%s"
         "\r\n",
         accept_key,
         result->protocol[0] ? "Sec-WebSocket-Protocol: " : "",
         result->protocol[0] ? result->protocol : "",
-        result->protocol[0] ? "\r\n" : "");
+        result->protocol[0] ? "\r\n" : "",
+        extension);
     
     free(accept_key);
     
@@ -385,13 +487,10 @@ int ws_decode_frame(const uint8_t *data, size_t data_len, WSFrame *frame, size_t
         frame->payload = malloc(payload_len + 1);  /* +1 for null terminator */
         if (!frame->payload) return -1;
         
-        memcpy(frame->payload, data + pos, payload_len);
-        
-        /* Unmask if needed */
         if (frame->masked) {
-            for (uint64_t i = 0; i < payload_len; i++) {
-                frame->payload[i] ^= frame->mask_key[i % 4];
-            }
+            ws_unmask(frame->payload, data + pos, payload_len, frame->mask_key, 0);
+        } else {
+            memcpy(frame->payload, data + pos, payload_len);
         }
         
         frame->payload[payload_len] = '\0';  /* Null terminate for text frames */
@@ -402,43 +501,294 @@ int ws_decode_frame(const uint8_t *data, size_t data_len, WSFrame *frame, size_t
 }
 
 /*
- * Encode a WebSocket frame
+ * Unmask eight bytes at a time with the key repeated across a word,
+ * then the tail bytewise
  */
-uint8_t *ws_encode_frame(int opcode, const uint8_t *payload, size_t payload_len, size_t *output_len) {
-    if (!output_len) return NULL;
+void ws_unmask(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t key[4], size_t offset) {
+    uint8_t key_bytes[8];
+    for (int i = 0; i < 8; i++) {
+        key_bytes[i] = key[(offset + i) & 3];
+    }
+    uint64_t key_word;
+    memcpy(&key_word, key_bytes, sizeof(key_word));
+    
+    /* Each word is loaded before it is stored, and dst <= src, so
+     * unmasking down within one buffer never reads a byte it wrote */
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        word ^= key_word;
+        memcpy(dst + i, &word, sizeof(word));
+    }
+    for (; i < len; i++) {
+        dst[i] = src[i] ^ key_bytes[i & 7];
+    }
+}
+
+/* ========== Incremental Parser ========== */
+
+void ws_parser_init(WSParser *parser) {
+    if (!parser) return;
+    parser->start = 0;
+    parser->message_len = 0;
+    parser->pos = 0;
+    parser->end = 0;
+    parser->message_opcode = 0;
+    parser->message_compressed = 0;
+    parser->message_done = 0;
+    parser->deflate = 0;
+    parser->frame_open = 0;
+    parser->saved_valid = 0;
+    parser->close_code = 0;
+}
+
+/*
+ * Take back what the last call handed out: put back the byte its
+ * terminator replaced, and drop a finished message. An empty buffer
+ * starts over at the front, so the common case never moves a byte.
+ */
+static void ws_parser_release(WSParser *parser) {
+    if (parser->saved_valid) {
+        parser->buffer[parser->saved_at] = parser->saved;
+        parser->saved_valid = 0;
+    }
+    if (parser->message_done) {
+        parser->message_done = 0;
+        parser->message_opcode = 0;
+        parser->message_compressed = 0;
+        parser->message_len = 0;
+        parser->start = parser->pos;
+    }
+    if (parser->message_opcode == 0 && parser->pos == parser->end) {
+        parser->start = 0;
+        parser->pos = 0;
+        parser->end = 0;
+    }
+}
+
+static int ws_parser_fail(WSParser *parser, uint16_t code) {
+    parser->close_code = code;
+    return -1;
+}
+
+/* Terminate a slice where it lies and hand it out */
+static int ws_parser_hand_out(WSParser *parser, WSMessage *message, int opcode,
+                              uint8_t *data, size_t len) {
+    size_t at = (size_t)(data - parser->buffer) + len;
+    parser->saved_at = at;
+    parser->saved = parser->buffer[at];
+    parser->saved_valid = 1;
+    parser->buffer[at] = '\0';
+    
+    message->opcode = opcode;
+    message->data = data;
+    message->len = len;
+    message->compressed = opcode < WS_OPCODE_CLOSE && parser->message_compressed;
+    return 0;
+}
+
+/*
+ * Parse the frame header at pos and check it against the message in
+ * progress. Returns 0 once parsed, 1 if incomplete, -1 on error.
+ */
+static int ws_parser_header(WSParser *parser) {
+    const uint8_t *p = parser->buffer + parser->pos;
+    size_t avail = parser->end - parser->pos;
+    if (avail < 2) return 1;
     
-    /* Calculate header size */
-    size_t header_size = 2;
-    if (payload_len >= 126 && payload_len <= 65535) {
-        header_size += 2;
-    } else if (payload_len > 65535) {
-        header_size += 8;
+    int fin = (p[0] & 0x80) != 0;
+    int opcode = p[0] & 0x0F;
+    int masked = (p[1] & 0x80) != 0;
+    uint64_t payload_len = p[1] & 0x7F;
+    size_t header_len = 2;
+    
+    if (payload_len == 126) {
+        header_len = 4;
+        if (avail < header_len) return 1;
+        payload_len = ((uint64_t)p[2] << 8) | p[3];
+    } else if (payload_len == 127) {
+        header_len = 10;
+        if (avail < header_len) return 1;
+        payload_len = 0;
+        for (int i = 0; i < 8; i++) {
+            payload_len = (payload_len << 8) | p[2 + i];
+        }
+    }
+    if (masked) header_len += 4;
+    if (avail < header_len) return 1;
+    
+    /* RSV2 and RSV3 are never used; RSV1 marks a compressed message, and
+     * only on its first frame, once permessage-deflate is negotiated */
+    int compressed = (p[0] & 0x40) != 0;
+    if (p[0] & 0x30) return ws_parser_fail(parser, WS_CLOSE_PROTOCOL_ERROR);
+    if (compressed && (!parser->deflate ||
+                       (opcode != WS_OPCODE_TEXT && opcode != WS_OPCODE_BINARY))) {
+        return ws_parser_fail(parser, WS_CLOSE_PROTOCOL_ERROR);
     }
     
-    /* Server-to-client frames are not masked */
-    *output_len = header_size + payload_len;
+    switch (opcode) {
+        case WS_OPCODE_CLOSE:
+        case WS_OPCODE_PING:
+        case WS_OPCODE_PONG:
+            if (!fin || payload_len > WS_MAX_CONTROL_SIZE) {
+                return ws_parser_fail(parser, WS_CLOSE_PROTOCOL_ERROR);
+            }
+            break;
+        case WS_OPCODE_CONTINUATION:
+            if (parser->message_opcode == 0) return ws_parser_fail(parser, WS_CLOSE_PROTOCOL_ERROR);
+            break;
+        case WS_OPCODE_TEXT:
+        case WS_OPCODE_BINARY:
+            if (parser->message_opcode != 0) return ws_parser_fail(parser, WS_CLOSE_PROTOCOL_ERROR);
+            break;
+        default:
+            return ws_parser_fail(parser, WS_CLOSE_PROTOCOL_ERROR);
+    }
+    if (opcode < WS_OPCODE_CLOSE && payload_len > WS_MAX_MESSAGE_SIZE - parser->message_len) {
+        return ws_parser_fail(parser, WS_CLOSE_TOO_LARGE);
+    }
     
-    uint8_t *frame = malloc(*output_len);
-    if (!frame) return NULL;
+    /* An unmasked frame gets a zero key, which leaves the payload as it is */
+    if (masked) {
+        memcpy(parser->mask_key, p + header_len - 4, 4);
+    } else {
+        memset(parser->mask_key, 0, 4);
+    }
+    parser->pos += header_len;
+    parser->frame_open = 1;
+    parser->frame_opcode = opcode;
+    parser->frame_fin = fin;
+    parser->frame_remaining = payload_len;
+    parser->mask_offset = 0;
+    if (opcode == WS_OPCODE_TEXT || opcode == WS_OPCODE_BINARY) {
+        parser->message_opcode = opcode;
+        parser->message_compressed = compressed;
+    }
+    return 0;
+}
+
+uint8_t *ws_parser_space(WSParser *parser, size_t *avail) {
+    if (!parser || !avail) return NULL;
+    ws_parser_release(parser);
+    
+    /* Close the gaps left by parsed headers and consumed frames: the
+     * message so far moves to the front, unparsed bytes right after it */
+    size_t raw = parser->end - parser->pos;
+    if (WS_PARSER_BUFFER_SIZE - parser->end < WS_PARSER_MIN_READ &&
+        parser->message_len + raw < parser->end) {
+        memmove(parser->buffer, parser->buffer + parser->start, parser->message_len);
+        memmove(parser->buffer + parser->message_len, parser->buffer + parser->pos, raw);
+        parser->start = 0;
+        parser->pos = parser->message_len;
+        parser->end = parser->pos + raw;
+    }
     
+    *avail = WS_PARSER_BUFFER_SIZE - parser->end;
+    return *avail > 0 ? parser->buffer + parser->end : NULL;
+}
+
+void ws_parser_commit(WSParser *parser, size_t len) {
+    if (!parser) return;
+    size_t avail = WS_PARSER_BUFFER_SIZE - parser->end;
+    parser->end += len < avail ? len : avail;
+}
+
+uint8_t *ws_parser_pending(WSParser *parser, size_t *len) {
+    if (!parser || !len) return NULL;
+    ws_parser_release(parser);
+    parser->buffer[parser->end] = '\0';
+    *len = parser->end - parser->pos;
+    return parser->buffer + parser->pos;
+}
+
+void ws_parser_skip(WSParser *parser, size_t len) {
+    if (!parser) return;
+    size_t avail = parser->end - parser->pos;
+    parser->pos += len < avail ? len : avail;
+    if (parser->message_opcode == 0) parser->start = parser->pos;
+    ws_parser_release(parser);
+}
+
+int ws_parser_next(WSParser *parser, WSMessage *message) {
+    if (!parser || !message) return -1;
+    if (parser->close_code) return -1;
+    ws_parser_release(parser);
+    
+    for (;;) {
+        if (!parser->frame_open) {
+            int result = ws_parser_header(parser);
+            if (result != 0) return result;
+        }
+        
+        /* Control frames are short, so wait for all of one and unmask it where it is */
+        if (parser->frame_opcode >= WS_OPCODE_CLOSE) {
+            if (parser->end - parser->pos < parser->frame_remaining) return 1;
+            size_t len = (size_t)parser->frame_remaining;
+            uint8_t *data = parser->buffer + parser->pos;
+            ws_unmask(data, data, len, parser->mask_key, 0);
+            parser->pos += len;
+            parser->frame_open = 0;
+            if (parser->message_opcode == 0) parser->start = parser->pos;
+            return ws_parser_hand_out(parser, message, parser->frame_opcode, data, len);
+        }
+        
+        /* Data: unmask what has arrived down onto the end of the message */
+        size_t len = parser->end - parser->pos;
+        if (len > parser->frame_remaining) len = (size_t)parser->frame_remaining;
+        ws_unmask(parser->buffer + parser->start + parser->message_len,
+                  parser->buffer + parser->pos, len, parser->mask_key, parser->mask_offset);
+        parser->mask_offset = (parser->mask_offset + len) & 3;
+        parser->message_len += len;
+        parser->pos += len;
+        parser->frame_remaining -= len;
+        if (parser->frame_remaining > 0) return 1;
+        
+        parser->frame_open = 0;
+        if (parser->frame_fin) {
+            parser->message_done = 1;
+            return ws_parser_hand_out(parser, message, parser->message_opcode,
+                                      parser->buffer + parser->start, parser->message_len);
+        }
+    }
+}
+
+/*
+ * Encode a WebSocket frame
+ */
+size_t ws_frame_header(uint8_t *out, int opcode, int compressed, size_t payload_len) {
     size_t pos = 0;
     
-    /* Byte 0: FIN (1) + RSV (000) + Opcode */
-    frame[pos++] = 0x80 | (opcode & 0x0F);
+    /* Byte 0: FIN (1) + RSV1 (compressed) + RSV2/3 (00) + Opcode */
+    out[pos++] = 0x80 | (compressed ? 0x40 : 0) | (opcode & 0x0F);
     
     /* Byte 1+: Payload length (no mask from server) */
     if (payload_len < 126) {
-        frame[pos++] = (uint8_t)payload_len;
+        out[pos++] = (uint8_t)payload_len;
     } else if (payload_len <= 65535) {
-        frame[pos++] = 126;
-        frame[pos++] = (uint8_t)(payload_len >> 8);
-        frame[pos++] = (uint8_t)(payload_len & 0xFF);
+        out[pos++] = 126;
+        out[pos++] = (uint8_t)(payload_len >> 8);
+        out[pos++] = (uint8_t)(payload_len & 0xFF);
     } else {
-        frame[pos++] = 127;
+        out[pos++] = 127;
         for (int i = 7; i >= 0; i--) {
-            frame[pos++] = (uint8_t)(payload_len >> (i * 8));
+            out[pos++] = (uint8_t)((uint64_t)payload_len >> (i * 8));
         }
     }
+    return pos;
+}
+
+uint8_t *ws_encode_frame(int opcode, const uint8_t *payload, size_t payload_len, size_t *output_len) {
+    if (!output_len) return NULL;
+    
+    /* Server-to-client frames are not masked */
+    uint8_t header[WS_MAX_HEADER_SIZE];
+    size_t pos = ws_frame_header(header, opcode, 0, payload_len);
+    *output_len = pos + payload_len;
+    
+    uint8_t *frame = malloc(*output_len);
+    if (!frame) return NULL;
+    memcpy(frame, header, pos);
     
     /* Payload */
     if (payload && payload_len > 0) {
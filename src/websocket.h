@@ -7,11 +7,12 @@
  *   - Text and binary frame encoding/decoding
  *   - Ping/pong heartbeat
  *   - Connection close handling
+ *   - permessage-deflate negotiation (RFC 7692; see compress.h)
  * 
  * Usage:
  *   1. Detect HTTP upgrade request in raw socket data
  *   2. Call ws_handle_handshake() to complete upgrade
- *   3. Use ws_decode_frame() for incoming data
+ *   3. Use a WSParser (or ws_decode_frame()) for incoming data
  *   4. Use ws_encode_frame() for outgoing data
  */
 
@@ -39,6 +40,12 @@
 /* Maximum frame/message sizes */
 #define WS_MAX_FRAME_SIZE       65536
 #define WS_MAX_HEADER_SIZE      14
+#define WS_MAX_MESSAGE_SIZE     WS_MAX_FRAME_SIZE
+#define WS_MAX_CONTROL_SIZE     125
+
+/* Parser buffer: a whole message plus the raw bytes of the frame after it */
+#define WS_PARSER_BUFFER_SIZE   (WS_MAX_MESSAGE_SIZE + 4096)
+#define WS_PARSER_MIN_READ      2048    /* Free tail space below which the buffer is compacted */
 
 /* WebSocket connection states */
 typedef enum {
@@ -58,6 +65,51 @@ typedef struct {
     uint8_t *payload;       /* Payload data (allocated) */
 } WSFrame;
 
+/*
+ * Incremental frame parser
+ *
+ * Bytes are received straight into the parser's buffer (ws_parser_space()
+ * and ws_parser_commit()) and parsed where they land. Payloads are
+ * unmasked in place as they arrive; the fragments of a message are
+ * unmasked down onto the end of the previous one, so a whole message
+ * ends up contiguous without being copied anywhere else. A read cursor
+ * moves over consumed bytes, and the buffer is only compacted when its
+ * tail runs short, or reset once everything in it is consumed.
+ */
+typedef struct {
+    uint8_t buffer[WS_PARSER_BUFFER_SIZE + 1];  /* +1 so a slice can always be terminated */
+    size_t start;           /* First live byte: the message being assembled */
+    size_t message_len;     /* Unmasked bytes of that message, at start */
+    size_t pos;             /* Next raw byte to parse */
+    size_t end;             /* One past the last byte received */
+
+    int message_opcode;     /* TEXT or BINARY being assembled, 0 if none */
+    int message_compressed; /* Its first frame had RSV1 set */
+    int message_done;       /* Message handed out; consumed by the next call */
+    int deflate;            /* permessage-deflate negotiated: RSV1 is allowed */
+
+    int frame_open;         /* Header parsed, payload still arriving */
+    int frame_opcode;
+    int frame_fin;
+    uint64_t frame_remaining;
+    uint8_t mask_key[4];
+    size_t mask_offset;     /* Payload bytes unmasked so far, mod 4 */
+
+    size_t saved_at;        /* Byte overwritten by a slice's terminator */
+    uint8_t saved;
+    int saved_valid;
+
+    uint16_t close_code;    /* Why parsing failed, for the close frame */
+} WSParser;
+
+/* A message or control frame, borrowed from the parser */
+typedef struct {
+    int opcode;             /* TEXT, BINARY, CLOSE, PING or PONG */
+    uint8_t *data;          /* Unmasked payload, NUL-terminated, in the parser's buffer */
+    size_t len;
+    int compressed;         /* permessage-deflate payload, still to be inflated */
+} WSMessage;
+
 /* WebSocket handshake result */
 typedef struct {
     int success;            /* 1 = handshake successful */
@@ -65,6 +117,9 @@ typedef struct {
     size_t response_len;    /* Response length */
     char client_key[64];    /* Client's Sec-WebSocket-Key */
     char protocol[64];      /* Requested sub-protocol (if any) */
+    int deflate;            /* permessage-deflate accepted */
+    int deflate_no_context_takeover;    /* Client asked for server_no_context_takeover */
+    int deflate_window_bits;            /* server_max_window_bits, 15 if not asked for */
 } WSHandshake;
 
 /*
@@ -103,6 +158,59 @@ int ws_handle_handshake(const char *request, size_t request_len, WSHandshake *re
  */
 int ws_decode_frame(const uint8_t *data, size_t data_len, WSFrame *frame, size_t *consumed);
 
+/*
+ * Reset a parser to expect a new frame on an empty buffer.
+ * A zero-filled parser is already reset.
+ */
+void ws_parser_init(WSParser *parser);
+
+/*
+ * Free space to receive into, compacting the buffer first when its tail
+ * is short.
+ *
+ * Parameters:
+ *   parser - Parser
+ *   avail  - Output: bytes that may be written at the returned pointer
+ *
+ * Returns: Where to write, or NULL if the buffer is full
+ */
+uint8_t *ws_parser_space(WSParser *parser, size_t *avail);
+
+/*
+ * Account for len bytes written at ws_parser_space().
+ */
+void ws_parser_commit(WSParser *parser, size_t len);
+
+/*
+ * Bytes received but not yet parsed, NUL-terminated (e.g. an HTTP
+ * upgrade request before the connection is open).
+ */
+uint8_t *ws_parser_pending(WSParser *parser, size_t *len);
+
+/*
+ * Drop len bytes from the front of the pending bytes.
+ */
+void ws_parser_skip(WSParser *parser, size_t len);
+
+/*
+ * Parse up to the next complete message or control frame.
+ * message->data points into the parser's buffer and stays valid, and may
+ * be written to, until the parser is next called.
+ *
+ * Returns:
+ *   0  - message holds a message or control frame
+ *   1  - Need more data
+ *   -1 - Protocol error; parser->close_code says which
+ */
+int ws_parser_next(WSParser *parser, WSMessage *message);
+
+/*
+ * XOR len bytes of src with the mask key, starting offset bytes into the
+ * key, and store them at dst. dst may be src, or below it in the same
+ * buffer.
+ */
+void ws_unmask(uint8_t *dst, const uint8_t *src, size_t len, const uint8_t key[4], size_t offset);
+
 /*
  * Encode data into a WebSocket frame.
  * Caller must free the returned buffer.
@@ -117,6 +225,20 @@ int ws_decode_frame(const uint8_t *data, size_t data_len, WSFrame *frame, size_t
  */
 uint8_t *ws_encode_frame(int opcode, const uint8_t *payload, size_t payload_len, size_t *output_len);
 
+/*
+ * Write a server frame header (FIN set, unmasked) for a payload of
+ * payload_len bytes.
+ *
+ * Parameters:
+ *   out         - At least WS_MAX_HEADER_SIZE bytes
+ *   opcode      - Frame opcode
+ *   compressed  - Set RSV1: the payload is permessage-deflate compressed
+ *   payload_len - Length of the payload that follows
+ *
+ * Returns: Header length
+ */
+size_t ws_frame_header(uint8_t *out, int opcode, int compressed, size_t payload_len);
+
 /*
  * Convenience function to encode a text message.
  */
@@ -0,0 +1,172 @@
+/*
+ * bench_boot.c - Mudlib Load Benchmark
+ *
+ * Loads every .lpc file under the mudlib into a fresh VM three times:
+ * without the program cache, with an empty cache (every file compiled
+ * and its image written), and with the warm cache (every file read from
+ * its image). The difference between the first and last pass is what
+ * the cache saves on a boot.
+ *
+ * Then the whole mudlib is preloaded with the cache off on 1, 2, 4, ...
+ * worker threads, up to at least the number of online CPUs, timing the
+ * parallel compile and the serial load separately.
+ *
+ * Usage: build/bench_boot [mudlib dir]   (default ./lib)
+ */
+
+#define _XOPEN_SOURCE 500
+#include "vm.h"
+#include "object_program.h"
+#include "program_cache.h"
+#include "preload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ftw.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BENCH_MAX_FILES 4096
+
+static char *files[BENCH_MAX_FILES];
+static int file_count = 0;
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int collect(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    size_t len = strlen(path);
+    if (type == FTW_F && len > 4 && strcmp(path + len - 4, ".lpc") == 0 &&
+        file_count < BENCH_MAX_FILES) {
+        files[file_count] = (char *)malloc(len + 1);
+        strcpy(files[file_count++], path);
+    }
+    return 0;
+}
+
+/* The compiler and loader's chatter goes to /dev/null while timing */
+static int saved_out = -1, saved_err = -1;
+
+static void silence(void) {
+    fflush(stdout);
+    fflush(stderr);
+    saved_out = dup(STDOUT_FILENO);
+    saved_err = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+}
+
+static void unsilence(void) {
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(saved_out);
+    close(saved_err);
+}
+
+/* Load every file into a new VM */
+static double load_all(int *loaded) {
+    silence();
+    VirtualMachine *vm = vm_init();
+    *loaded = 0;
+    double start = now_seconds();
+    for (int i = 0; i < file_count; i++) {
+        if (obj_program_load(vm, files[i], files[i])) (*loaded)++;
+    }
+    double elapsed = now_seconds() - start;
+    vm_free(vm);
+    unsilence();
+    return elapsed;
+}
+
+/* Preload the whole mudlib on the given number of workers */
+static int preload_all(const char *mudlib, int threads, PreloadList *out) {
+    silence();
+    VirtualMachine *vm = vm_init();
+    preload_list_init(out, mudlib);
+    preload_list_add(out, "/");
+    preload_compile(out, threads);
+    int loaded = preload_link(vm, out);
+    vm_free(vm);
+    unsilence();
+    return loaded;
+}
+
+/* ========== Benchmark ========== */
+
+int main(int argc, char **argv) {
+    const char *mudlib = argc > 1 ? argv[1] : "lib";
+    if (nftw(mudlib, collect, 16, FTW_PHYS) != 0 || file_count == 0) {
+        fprintf(stderr, "bench_boot: no .lpc files under %s\n", mudlib);
+        return 1;
+    }
+
+    char cache[64];
+    snprintf(cache, sizeof(cache), "/tmp/amlp_bench_cache_%d", (int)getpid());
+
+    int loaded_plain, loaded_cold, loaded_warm;
+    program_cache_set_dir(NULL);
+    double t_plain = load_all(&loaded_plain);
+
+    program_cache_set_dir(cache);
+    program_cache_reset_stats();
+    double t_cold = load_all(&loaded_cold);
+    ProgramCacheStats cold = *program_cache_stats();
+
+    program_cache_reset_stats();
+    double t_warm = load_all(&loaded_warm);
+    ProgramCacheStats warm = *program_cache_stats();
+
+    printf("\n========================================\n");
+    printf("Loading %d files from %s\n", file_count, mudlib);
+    printf("========================================\n");
+    printf("  %-14s  %8s  %10s  %10s\n", "pass", "loaded", "ms", "us/file");
+    printf("  %-14s  %8d  %10.1f  %10.1f\n", "no cache", loaded_plain, t_plain * 1e3, t_plain * 1e6 / file_count);
+    printf("  %-14s  %8d  %10.1f  %10.1f\n", "cold cache", loaded_cold, t_cold * 1e3, t_cold * 1e6 / file_count);
+    printf("  %-14s  %8d  %10.1f  %10.1f\n", "warm cache", loaded_warm, t_warm * 1e3, t_warm * 1e6 / file_count);
+    printf("  cold: %lu compiled, %lu images written\n", cold.misses, cold.stores);
+    printf("  warm: %lu from images, %lu compiled (files with errors are never cached)\n",
+           warm.hits, warm.misses);
+    printf("  speedup: %.1fx\n\n", t_plain / t_warm);
+
+    char cmd[96];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", cache);
+    if (system(cmd) != 0) fprintf(stderr, "bench_boot: could not remove %s\n", cache);
+    program_cache_set_dir(NULL);
+
+    int cpus = preload_default_threads();
+    int max_threads = cpus > 4 ? cpus : 4;
+    double t_serial = 0;
+    int loaded_preload = -1;
+    printf("  preload, no cache (%d CPUs online)\n", cpus);
+    printf("  %-14s  %8s  %10s  %10s  %8s\n", "threads", "loaded", "compile ms", "load ms", "scaling");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        PreloadList list;
+        int loaded = preload_all(mudlib, threads, &list);
+        if (threads == 1) t_serial = list.compile_seconds;
+        if (loaded_preload < 0) loaded_preload = loaded;
+        if (loaded != loaded_preload) loaded_preload = -2;
+        printf("  %-14d  %8d  %10.1f  %10.1f  %7.2fx\n", threads, loaded,
+               list.compile_seconds * 1e3, list.link_seconds * 1e3,
+               t_serial / list.compile_seconds);
+        preload_list_free(&list);
+    }
+    printf("\n");
+    for (int i = 0; i < file_count; i++) free(files[i]);
+
+    int failures = loaded_warm != loaded_plain || loaded_cold != loaded_plain ||
+                   loaded_preload != loaded_plain;
+    if (failures) fprintf(stderr, "bench_boot: passes loaded different file counts\n");
+    return failures ? 1 : 0;
+}
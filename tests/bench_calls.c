@@ -0,0 +1,153 @@
+/*
+ * bench_calls.c - OP_CALL Dispatch Microbenchmark
+ *
+ * Measures calls/second for a tight loop that calls one user function
+ * and one efun, while the VM function table grows from a handful of
+ * entries to several thousand. With call sites linked at load time the
+ * rate should stay flat as the table grows.
+ *
+ * Usage: build/bench_calls [iterations]
+ */
+
+#include "vm.h"
+#include "efun.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_ITERATIONS 200000
+
+static const int table_sizes[] = { 1, 10, 100, 1000, 5000 };
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void emit(VMFunction *func, OpCode opcode, long operand) {
+    if (opcode == OP_PUSH_INT) {
+        vm_function_emit_int(func, operand);
+    } else {
+        vm_function_emit(func, opcode, operand);
+    }
+}
+
+static void emit_call(VMFunction *func, const char *name, int arg_count) {
+    vm_function_emit_call(func, name, arg_count, -1);
+}
+
+static void emit_jump(VMFunction *func, OpCode opcode, int address) {
+    vm_function_emit(func, opcode, address);
+}
+
+/**
+ * Build: for (i = 0; i < iterations; i++) callee(i);
+ * Local 0 is the loop counter.
+ */
+static VMFunction *make_loop(const char *name, const char *callee, long iterations) {
+    VMFunction *func = vm_function_create(name, 0, 1);
+
+    emit(func, OP_PUSH_INT, 0);                 /* 0 */
+    emit(func, OP_STORE_LOCAL, 0);              /* 1 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 2: loop head */
+    emit(func, OP_PUSH_INT, iterations);        /* 3 */
+    emit(func, OP_LT, 0);                       /* 4 */
+    emit_jump(func, OP_JUMP_IF_FALSE, 14);      /* 5 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 6 */
+    emit_call(func, callee, 1);                 /* 7 */
+    emit(func, OP_POP, 0);                      /* 8 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 9 */
+    emit(func, OP_PUSH_INT, 1);                 /* 10 */
+    emit(func, OP_ADD, 0);                      /* 11 */
+    emit(func, OP_STORE_LOCAL, 0);              /* 12 */
+    emit_jump(func, OP_JUMP, 2);                /* 13 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 14: exit */
+    emit(func, OP_RETURN, 0);                   /* 15 */
+
+    return func;
+}
+
+/* ========== Benchmark ========== */
+
+typedef struct {
+    int function_count;
+    double user_rate;
+    double efun_rate;
+    int ok;
+} BenchResult;
+
+static double run_loop(VirtualMachine *vm, int func_idx, long iterations, int *ok) {
+    double start = now_seconds();
+    int status = vm_call_function(vm, func_idx, 0);
+    double elapsed = now_seconds() - start;
+
+    VMValue result = vm_pop_value(vm);
+    *ok = (status == 0 && result.type == VALUE_INT && result.data.int_value == iterations);
+    return elapsed > 0 ? (double)iterations / elapsed : 0.0;
+}
+
+static void bench_table_size(int filler_count, long iterations, BenchResult *out) {
+    memset(out, 0, sizeof(*out));
+    VirtualMachine *vm = vm_init();
+    if (!vm) return;
+
+    /* Filler functions ahead of the callee make any name scan pay for them */
+    for (int i = 0; i < filler_count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "filler_%d", i);
+        VMFunction *filler = vm_function_create(name, 0, 0);
+        emit(filler, OP_PUSH_NULL, 0);
+        emit(filler, OP_RETURN, 0);
+        vm_add_function(vm, filler);
+    }
+
+    VMFunction *callee = vm_function_create("bench_identity", 1, 0);
+    emit(callee, OP_LOAD_LOCAL, 0);
+    emit(callee, OP_RETURN, 0);
+    vm_add_function(vm, callee);
+
+    int user_loop = vm_add_function(vm, make_loop("bench_user_loop", "bench_identity", iterations));
+    int efun_loop = vm_add_function(vm, make_loop("bench_efun_loop", "abs", iterations));
+
+    int unresolved = vm_link_calls(vm, 0, vm->function_count);
+
+    int user_ok = 0, efun_ok = 0;
+    out->function_count = vm->function_count;
+    out->user_rate = run_loop(vm, user_loop, iterations, &user_ok);
+    out->efun_rate = run_loop(vm, efun_loop, iterations, &efun_ok);
+    out->ok = (unresolved == 0 && user_ok && efun_ok);
+
+    vm_free(vm);
+}
+
+int main(int argc, char **argv) {
+    long iterations = BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1) {
+        iterations = atol(argv[1]);
+        if (iterations <= 0) iterations = BENCH_DEFAULT_ITERATIONS;
+    }
+
+    size_t n = sizeof(table_sizes) / sizeof(table_sizes[0]);
+    BenchResult results[sizeof(table_sizes) / sizeof(table_sizes[0])];
+    for (size_t i = 0; i < n; i++) {
+        bench_table_size(table_sizes[i], iterations, &results[i]);
+    }
+
+    int failures = 0;
+    printf("\n========================================\n");
+    printf("OP_CALL dispatch (%ld iterations per loop)\n", iterations);
+    printf("========================================\n");
+    printf("  %9s  %16s  %16s\n", "functions", "user calls/sec", "efun calls/sec");
+    for (size_t i = 0; i < n; i++) {
+        printf("  %9d  %16.0f  %16.0f%s\n", results[i].function_count,
+               results[i].user_rate, results[i].efun_rate, results[i].ok ? "" : "  (FAILED)");
+        if (!results[i].ok) failures++;
+    }
+    printf("\n");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * bench_clone.c - Array and Mapping Copy Microbenchmark
+ *
+ * Times array_clone(), array_slice() and mapping_clone() on containers
+ * of strings, with and without a write to the copy afterwards. For
+ * reference, the same copies are made element by element, which is what
+ * clone and slice used to do.
+ *
+ * Usage: build/bench_clone [copies]
+ */
+
+#include "array.h"
+#include "mapping.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_COPIES 20000
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static array_t *make_array(size_t n) {
+    array_t *arr = array_new(NULL, n);
+    char buf[32];
+    for (size_t i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "item_%zu", i);
+        array_push(arr, vm_value_create_string(buf));
+    }
+    return arr;
+}
+
+static mapping_t *make_mapping(size_t n) {
+    mapping_t *map = mapping_new(NULL, 16);
+    char buf[32];
+    for (size_t i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "key_%zu", i);
+        mapping_set(map, buf, vm_value_create_string(buf));
+    }
+    return map;
+}
+
+/* The copies clone and slice made before they shared storage */
+static array_t *eager_slice(array_t *arr, size_t start, size_t length) {
+    array_t *copy = array_new(NULL, length);
+    for (size_t i = 0; i < length; i++) {
+        array_push(copy, vm_value_clone(array_get(arr, start + i)));
+    }
+    return copy;
+}
+
+static mapping_t *eager_mapping(mapping_t *map) {
+    mapping_t *copy = mapping_new(NULL, map->bucket_count);
+    size_t cursor = 0;
+    mapping_entry_t *entry;
+    while ((entry = mapping_next(map, &cursor)) != NULL) {
+        mapping_store(copy, entry->key, vm_value_clone(entry->value));
+    }
+    return copy;
+}
+
+static void print_row(const char *label, size_t n, double seconds, int copies) {
+    printf("  %-26s %6zu %10.1f ns\n", label, n, seconds * 1e9 / copies);
+}
+
+/* ========== Main ========== */
+
+int main(int argc, char **argv) {
+    int copies = argc > 1 ? atoi(argv[1]) : BENCH_COPIES;
+    if (copies < 1) copies = 1;
+    static const size_t sizes[] = {16, 1000};
+
+    printf("Copy benchmark (%d copies, time per copy)\n", copies);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        array_t *arr = make_array(n);
+        mapping_t *map = make_mapping(n);
+
+        double start = now_seconds();
+        for (int i = 0; i < copies; i++) array_free(eager_slice(arr, 0, n));
+        print_row("array copy (before)", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) array_free(array_clone(arr, NULL));
+        print_row("array_clone", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) {
+            array_t *copy = array_clone(arr, NULL);
+            array_set(copy, 0, vm_value_create_int(i));
+            array_free(copy);
+        }
+        print_row("array_clone + write", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) array_free(eager_slice(arr, n / 4, n / 2));
+        print_row("slice copy (before)", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) array_free(array_slice(arr, n / 4, n / 2));
+        print_row("array_slice", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) mapping_free(eager_mapping(map));
+        print_row("mapping copy (before)", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) mapping_free(mapping_clone(map, NULL));
+        print_row("mapping_clone", n, now_seconds() - start, copies);
+
+        start = now_seconds();
+        for (int i = 0; i < copies; i++) {
+            mapping_t *copy = mapping_clone(map, NULL);
+            mapping_set(copy, "key_0", vm_value_create_int(i));
+            mapping_free(copy);
+        }
+        print_row("mapping_clone + write", n, now_seconds() - start, copies);
+
+        array_free(arr);
+        mapping_free(map);
+    }
+    return 0;
+}
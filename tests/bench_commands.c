@@ -0,0 +1,188 @@
+/*
+ * bench_commands.c - Command Routing Microbenchmark
+ *
+ * Replays a recorded mix of player commands through the verb lookup
+ * execute_command() does, against the command table filled the way the
+ * driver fills it (its builtins and aliases plus the command daemon's
+ * verbs), and against a copy of the comparison chain it replaced, which
+ * tried each builtin with strcmp() in source order. Both include
+ * lowercasing and splitting off the arguments.
+ *
+ * Usage: build/bench_commands [replays]
+ */
+
+#include "command_table.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_REPLAYS 20000
+
+static volatile long sink;
+
+/* ========== Recorded Mix ==========
+ * Commands from a play session: movement and looking around dominate,
+ * then chat, inventory handling and combat, a few wizard commands, and
+ * some typos. */
+
+static const char *recorded[] = {
+    "look", "n", "n", "look", "say hello everyone", "e", "get sword", "i",
+    "wield sword", "l", "s", "w", "examine statue", "exits", "n", "attack goblin",
+    "strike goblin", "dodge", "strike goblin", "get coins", "inventory", "score",
+    "tell Zed meet me at the plaza", "chat anyone selling armour?", "e", "e",
+    "look", "give coins to merchant", "wear armour", "eq", "stats", "d", "look",
+    "cast fireball at rat", "ppe", "meditate", "skills", "u", "who", "n",
+    "shout help!", "flee", "s", "look", "drop dagger", "powers", "use mind block",
+    "isp", "emote grins", "whisper Zed the door is open", "lok", "w", "w", "l",
+    "help", "save", "ls /domains", "cd /domains/start", "cat room.lpc", "pwd",
+    "goto 2", "look", "inv", "exa statue", "unequip dagger", "worn", "take torch",
+    "spells", "n", "e", "s", "w", "quit",
+};
+
+#define RECORDED_COUNT (sizeof(recorded) / sizeof(recorded[0]))
+
+/* ========== Previous Implementation ========== */
+
+/* Each word the chain compared against, in order; unknown words reach the end */
+static const char *chain_words[] = {
+    "ls", "dir", "cd", "pwd", "cat", "more",
+    "north", "n", "south", "s", "east", "e", "west", "w", "up", "u", "down", "d",
+    "quit", "logout", "save", "help", "look", "l", "stats", "score", "skills",
+    "attack", "strike", "shoot", "dodge", "flee", "inventory", "i",
+    "equip", "eq", "wield", "wear", "unequip", "uneq", "remove",
+    "worn", "equipment", "eq", "get", "take", "drop", "use", "powers", "abilities",
+    "isp", "inner_strength", "cast", "spells", "grimoire", "ppe", "ppp", "meditate",
+    "say", "emote", "tell", "chat", "whisper", "shout", "exits", "examine", "exam",
+    "give", "who", "stats",
+    "north", "south", "east", "west", "up", "down", "n", "s", "e", "w", "u", "d",
+    "promote", "users", "sched", "goto", "clone", "shutdown",
+};
+
+#define CHAIN_COUNT (sizeof(chain_words) / sizeof(chain_words[0]))
+
+static int chain_dispatch(const char *verb) {
+    for (size_t i = 0; i < CHAIN_COUNT; i++) {
+        if (strcmp(verb, chain_words[i]) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/* ========== Table Setup ========== */
+
+static VMValue bench_handler(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb; (void)args;
+    return vm_value_create_null();
+}
+
+/* The driver's builtins: verb, aliases, flags */
+static const struct {
+    const char *verb;
+    const char *aliases;
+    int flags;
+} builtins[] = {
+    {"ls", "dir", COMMAND_EARLY}, {"cd", NULL, COMMAND_EARLY}, {"pwd", NULL, COMMAND_EARLY},
+    {"cat", "more", COMMAND_EARLY}, {"north", "n", 0}, {"south", "s", 0}, {"east", "e", 0},
+    {"west", "w", 0}, {"up", "u", 0}, {"down", "d", 0}, {"quit", "logout", 0}, {"save", NULL, 0},
+    {"help", NULL, 0}, {"look", "l", 0}, {"stats", "score", 0}, {"skills", NULL, COMMAND_ABBREV},
+    {"attack", NULL, 0}, {"strike", NULL, 0}, {"shoot", NULL, 0}, {"dodge", NULL, 0},
+    {"flee", NULL, 0}, {"inventory", "i", COMMAND_ABBREV}, {"equip", "eq wield wear", 0},
+    {"unequip", "uneq remove", 0}, {"worn", "equipment", 0}, {"get", "take", 0},
+    {"drop", NULL, 0}, {"use", NULL, 0}, {"powers", "abilities", COMMAND_ABBREV},
+    {"isp", "inner_strength", 0}, {"cast", NULL, 0}, {"spells", "grimoire", COMMAND_ABBREV},
+    {"ppe", "ppp", 0}, {"meditate", NULL, COMMAND_ABBREV}, {"say", NULL, 0}, {"emote", NULL, 0},
+    {"tell", NULL, 0}, {"chat", NULL, 0}, {"whisper", NULL, 0}, {"shout", NULL, 0},
+    {"exits", NULL, 0}, {"examine", "exam", COMMAND_ABBREV}, {"give", NULL, 0}, {"who", NULL, 0},
+    {"promote", NULL, 0}, {"users", NULL, 0}, {"sched", NULL, 0}, {"shutdown", NULL, 0},
+    {"goto", NULL, 0}, {"clone", NULL, 0},
+};
+
+/* Verbs the command daemon registers beyond the builtins */
+static const char *daemon_verbs[] = {
+    "'", ":", "put", "unwield", "repair", "languages", "surname", "introduce", "greet",
+    "remember", "position", "test", "demote", "wiztool", "wiz", "stat", "testskill",
+    "eval", "ed", "load", "update", "destruct",
+};
+
+static void fill_table(CommandTable *table) {
+    command_table_init(table);
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        command_table_add_builtin(table, builtins[i].verb, bench_handler, 0, builtins[i].flags);
+        command_table_add_path(table, builtins[i].verb, "/cmds/bench");
+        if (!builtins[i].aliases) continue;
+        char aliases[64];
+        snprintf(aliases, sizeof(aliases), "%s", builtins[i].aliases);
+        char *save = NULL;
+        for (char *a = strtok_r(aliases, " ", &save); a; a = strtok_r(NULL, " ", &save)) {
+            command_table_add_alias(table, a, builtins[i].verb);
+        }
+    }
+    for (size_t i = 0; i < sizeof(daemon_verbs) / sizeof(daemon_verbs[0]); i++) {
+        command_table_add_path(table, daemon_verbs[i], "/cmds/bench");
+    }
+}
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* What execute_command() does before routing: lowercase, split off the arguments */
+static const char *parse_verb(const char *command, char *buf, size_t size) {
+    size_t i = 0;
+    for (; command[i] && command[i] != ' ' && i + 1 < size; i++) {
+        buf[i] = (char)tolower((unsigned char)command[i]);
+    }
+    buf[i] = '\0';
+    return buf;
+}
+
+/* ========== Main ========== */
+
+int main(int argc, char **argv) {
+    int replays = argc > 1 ? atoi(argv[1]) : BENCH_REPLAYS;
+    if (replays < 1) replays = 1;
+    double commands = (double)replays * RECORDED_COUNT;
+    char verb[COMMAND_VERB_MAX];
+
+    CommandTable table;
+    fill_table(&table);
+
+    int chain_hits = 0, table_hits = 0;
+    for (size_t i = 0; i < RECORDED_COUNT; i++) {
+        chain_hits += chain_dispatch(parse_verb(recorded[i], verb, sizeof(verb))) >= 0;
+        table_hits += command_table_builtin(command_table_match(&table, verb)) != NULL;
+    }
+
+    double start = now_seconds();
+    for (int r = 0; r < replays; r++) {
+        for (size_t i = 0; i < RECORDED_COUNT; i++) {
+            sink += chain_dispatch(parse_verb(recorded[i], verb, sizeof(verb)));
+        }
+    }
+    double chain_ns = (now_seconds() - start) * 1e9 / commands;
+
+    start = now_seconds();
+    for (int r = 0; r < replays; r++) {
+        for (size_t i = 0; i < RECORDED_COUNT; i++) {
+            const CommandEntry *entry = command_table_match(&table, parse_verb(recorded[i], verb,
+                                                                               sizeof(verb)));
+            sink += entry != NULL;
+        }
+    }
+    double table_ns = (now_seconds() - start) * 1e9 / commands;
+
+    printf("Command routing benchmark (%zu recorded commands x %d replays, ns per command)\n",
+           RECORDED_COUNT, replays);
+    printf("  %-16s %8s %10s\n", "router", "builtin", "ns");
+    printf("  %-16s %4d/%-3zu %10.1f\n", "strcmp chain", chain_hits, RECORDED_COUNT, chain_ns);
+    printf("  %-16s %4d/%-3zu %10.1f\n", "command table", table_hits, RECORDED_COUNT, table_ns);
+    printf("  (%zu verbs and aliases in the table)\n", table.count);
+
+    command_table_free(&table);
+    return 0;
+}
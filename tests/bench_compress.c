@@ -0,0 +1,143 @@
+/*
+ * bench_compress.c - Output Compression Microbenchmark
+ *
+ * Sends the same stream of game output (room descriptions, combat
+ * rounds, chat and prompts, with ANSI colour and changing numbers)
+ * through each output path a connection can have: raw telnet, MCCP2 and
+ * permessage-deflate with and without context takeover. Reports the
+ * bytes that reach the wire per 100 bytes of output and the cost of
+ * compressing them, for the shipped window and a few smaller ones.
+ *
+ * Usage: build/bench_compress [megabytes]
+ */
+
+#include "compress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MEGABYTES 16
+#define BENCH_PASS_BYTES 4096   /* Output staged between flushes, as in one busy pass */
+
+static uint32_t rng_state = 12345;
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return rng_state >> 8;
+}
+
+/* Output messages of the kind a player receives, one per entry */
+static char **make_messages(size_t total, int *count) {
+    static const char *rooms[] = {
+        "\033[1;36mThe Town Square\033[0m\r\n  Cobbled streets meet here beneath an old clock tower.\r\n"
+        "Merchants hawk their wares from brightly painted stalls.\r\n\033[32m  Obvious exits: north, south, east, west\033[0m\r\n",
+        "\033[1;36mA Narrow Alley\033[0m\r\n  Refuse is piled against the damp brick walls, and the\r\n"
+        "smell of the tannery drifts in from the east.\r\n\033[32m  Obvious exits: west, east\033[0m\r\n",
+        "\033[1;36mThe Rusty Tankard\033[0m\r\n  A low-beamed taproom, warm from the hearth. A bard\r\n"
+        "tunes a lute in the corner.\r\n\033[32m  Obvious exits: south, up\033[0m\r\n",
+    };
+    static const char *mobs[] = { "a giant rat", "the town guard", "a mangy wolf", "Zed the rogue" };
+    static const char *verbs[] = { "slash", "hit", "bite", "pierce", "crush" };
+    static const char *names[] = { "Aria", "Bront", "Cael", "Dunmore", "Esk" };
+
+    int capacity = 1024;
+    char **messages = malloc((size_t)capacity * sizeof(char *));
+    size_t len = 0;
+    *count = 0;
+    while (len < total) {
+        char text[1024];
+        int kind = (int)(rng() % 10);
+        if (kind == 0) {
+            snprintf(text, sizeof(text), "%s%s is here.\r\n", rooms[rng() % 3], mobs[rng() % 4]);
+        } else if (kind < 6) {
+            snprintf(text, sizeof(text), "\033[31mYou %s %s for %u damage.\033[0m\r\n"
+                     "%s %ss you for %u damage.\r\n",
+                     verbs[rng() % 5], mobs[rng() % 4], rng() % 40 + 1,
+                     mobs[rng() % 4], verbs[rng() % 5], rng() % 30 + 1);
+        } else if (kind < 8) {
+            snprintf(text, sizeof(text), "\033[33m[chat] %s: anyone selling %s armour near the %s?\033[0m\r\n",
+                     names[rng() % 5], rng() % 2 ? "leather" : "chain", rng() % 2 ? "plaza" : "docks");
+        } else {
+            snprintf(text, sizeof(text), "HP: %u/120  SDC: %u/60  PPE: %u/45 > ",
+                     rng() % 120, rng() % 60, rng() % 45);
+        }
+        if (*count == capacity) {
+            capacity *= 2;
+            messages = realloc(messages, (size_t)capacity * sizeof(char *));
+        }
+        messages[(*count)++] = strdup(text);
+        len += strlen(text);
+    }
+    return messages;
+}
+
+/* ========== Main ========== */
+
+int main(int argc, char **argv) {
+    int megabytes = argc > 1 ? atoi(argv[1]) : BENCH_MEGABYTES;
+    if (megabytes < 1) megabytes = 1;
+    int count;
+    char **messages = make_messages((size_t)megabytes << 20, &count);
+    size_t total = 0;
+    for (int i = 0; i < count; i++) total += strlen(messages[i]);
+
+    printf("Output compression benchmark (%d MB of game output, %d messages, flushed every %d bytes)\n",
+           megabytes, count, BENCH_PASS_BYTES);
+    printf("  %-28s %12s %10s %10s\n", "path", "wire/100 B", "ns/KB", "MB/s");
+
+    static const struct { const char *name; CompressMode mode; int bits; int no_takeover; } paths[] = {
+        { "MCCP2, 8 KB window", COMPRESS_MCCP2, 13, 0 },
+        { "MCCP2, 2 KB window", COMPRESS_MCCP2, 11, 0 },
+        { "MCCP2, 512 B window", COMPRESS_MCCP2, 9, 0 },
+        { "deflate, 8 KB window", COMPRESS_WS_DEFLATE, 13, 0 },
+        { "deflate, no takeover", COMPRESS_WS_DEFLATE, 13, 1 },
+    };
+    printf("  %-28s %12.1f %10s %10s\n", "raw", 100.0, "-", "-");
+
+    OutputQueue queue;
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++) {
+        output_queue_init(&queue, 0);
+        Compressor *comp = compressor_new(paths[p].mode, paths[p].bits, paths[p].no_takeover, 0);
+        if (!comp) {
+            printf("bench_compress: compressor_new failed\n");
+            return 1;
+        }
+        size_t wire = 0;
+        size_t staged = 0;
+        double start = now_seconds();
+        for (int i = 0; i < count; i++) {
+            size_t len = strlen(messages[i]);
+            compressor_stage(comp, messages[i], len);
+            staged += len;
+            if (staged >= BENCH_PASS_BYTES || i == count - 1) {
+                /* Stands in for the flush at the end of a pass */
+                if (compressor_run(comp, &queue, 0) != 0) {
+                    printf("bench_compress: compressor_run failed\n");
+                    return 1;
+                }
+                wire += output_queue_pending(&queue);
+                output_queue_free(&queue);
+                output_queue_init(&queue, 0);
+                staged = 0;
+            }
+        }
+        double elapsed = now_seconds() - start;
+        printf("  %-28s %12.1f %10.0f %10.0f\n", paths[p].name, 100.0 * (double)wire / (double)total,
+               elapsed * 1e9 / ((double)total / 1024), (double)total / (1 << 20) / elapsed);
+        compressor_free(comp);
+        output_queue_free(&queue);
+    }
+
+    for (int i = 0; i < count; i++) free(messages[i]);
+    free(messages);
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * bench_dispatch.c - Interpreter Dispatch Microbenchmark
+ *
+ * Reports instructions/second for three kernels written directly in
+ * bytecode: recursive fib (call heavy), a counting loop (arithmetic and
+ * branches on locals) and string building through efuns (allocation
+ * heavy). Instruction counts are derived from the bytecode shapes below,
+ * so the production loop runs without any counters. Each kernel runs once
+ * as written and once after vm_optimize_function(); the optimized rate is
+ * reported against the unoptimized instruction count so the two columns
+ * compare the same amount of source-level work.
+ *
+ * Usage: build/bench_dispatch [scale]
+ */
+
+#include "vm.h"
+#include "efun.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FIB_N          25
+#define BENCH_LOOP_COUNT     2000000
+#define BENCH_STRING_COUNT   200000
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void emit(VMFunction *func, OpCode opcode, long operand) {
+    if (opcode == OP_PUSH_INT) {
+        vm_function_emit_int(func, operand);
+    } else {
+        vm_function_emit(func, opcode, operand);
+    }
+}
+
+static void emit_string(VMFunction *func, const char *value) {
+    vm_function_emit_constant(func, OP_PUSH_STRING, vm_value_create_string(value));
+}
+
+static void emit_call(VMFunction *func, const char *name, int arg_count) {
+    vm_function_emit_call(func, name, arg_count, -1);
+}
+
+static void emit_jump(VMFunction *func, OpCode opcode, int address) {
+    vm_function_emit(func, opcode, address);
+}
+
+/* ========== Kernels ========== */
+
+/**
+ * fib(n): if (n < 2) return n; return fib(n - 1) + fib(n - 2);
+ * A leaf runs 6 instructions, an inner call 14.
+ */
+static VMFunction *make_fib(const char *name) {
+    VMFunction *func = vm_function_create(name, 1, 0);
+    emit(func, OP_LOAD_LOCAL, 0);               /* 0 */
+    emit(func, OP_PUSH_INT, 2);                 /* 1 */
+    emit(func, OP_LT, 0);                       /* 2 */
+    emit_jump(func, OP_JUMP_IF_FALSE, 6);       /* 3 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 4 */
+    emit(func, OP_RETURN, 0);                   /* 5 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 6 */
+    emit(func, OP_PUSH_INT, 1);                 /* 7 */
+    emit(func, OP_SUB, 0);                      /* 8 */
+    emit_call(func, name, 1);                   /* 9 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 10 */
+    emit(func, OP_PUSH_INT, 2);                 /* 11 */
+    emit(func, OP_SUB, 0);                      /* 12 */
+    emit_call(func, name, 1);                   /* 13 */
+    emit(func, OP_ADD, 0);                      /* 14 */
+    emit(func, OP_RETURN, 0);                   /* 15 */
+    return func;
+}
+
+static long fib_value(int n) {
+    return n < 2 ? n : fib_value(n - 1) + fib_value(n - 2);
+}
+
+static double fib_instructions(int n) {
+    return n < 2 ? 6.0 : 14.0 + fib_instructions(n - 1) + fib_instructions(n - 2);
+}
+
+/**
+ * loop(): for (i = 0, sum = 0; i < count; i++) sum += i; return sum;
+ * 13 instructions per iteration plus 10 for setup and exit.
+ */
+static VMFunction *make_loop(const char *name, long count) {
+    VMFunction *func = vm_function_create(name, 0, 2);
+    emit(func, OP_PUSH_INT, 0);                 /* 0 */
+    emit(func, OP_STORE_LOCAL, 0);              /* 1: i */
+    emit(func, OP_PUSH_INT, 0);                 /* 2 */
+    emit(func, OP_STORE_LOCAL, 1);              /* 3: sum */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 4: loop head */
+    emit(func, OP_PUSH_INT, count);             /* 5 */
+    emit(func, OP_LT, 0);                       /* 6 */
+    emit_jump(func, OP_JUMP_IF_FALSE, 17);      /* 7 */
+    emit(func, OP_LOAD_LOCAL, 1);               /* 8 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 9 */
+    emit(func, OP_ADD, 0);                      /* 10 */
+    emit(func, OP_STORE_LOCAL, 1);              /* 11 */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 12 */
+    emit(func, OP_PUSH_INT, 1);                 /* 13 */
+    emit(func, OP_ADD, 0);                      /* 14 */
+    emit(func, OP_STORE_LOCAL, 0);              /* 15 */
+    emit_jump(func, OP_JUMP, 4);                /* 16 */
+    emit(func, OP_LOAD_LOCAL, 1);               /* 17: exit */
+    emit(func, OP_RETURN, 0);                   /* 18 */
+    return func;
+}
+
+/**
+ * strings(): for (i = 0; i < count; i++) s = upper_case(trim("  hello world  "));
+ *            return s;
+ * 13 instructions per iteration plus 8 for setup and exit.
+ */
+static VMFunction *make_strings(const char *name, long count) {
+    VMFunction *func = vm_function_create(name, 0, 2);
+    emit(func, OP_PUSH_INT, 0);                 /* 0 */
+    emit(func, OP_STORE_LOCAL, 0);              /* 1: i */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 2: loop head */
+    emit(func, OP_PUSH_INT, count);             /* 3 */
+    emit(func, OP_LT, 0);                       /* 4 */
+    emit_jump(func, OP_JUMP_IF_FALSE, 15);      /* 5 */
+    emit_string(func, "  hello world  ");       /* 6 */
+    emit_call(func, "trim", 1);                 /* 7 */
+    emit_call(func, "upper_case", 1);           /* 8 */
+    emit(func, OP_STORE_LOCAL, 1);              /* 9: s */
+    emit(func, OP_LOAD_LOCAL, 0);               /* 10 */
+    emit(func, OP_PUSH_INT, 1);                 /* 11 */
+    emit(func, OP_ADD, 0);                      /* 12 */
+    emit(func, OP_STORE_LOCAL, 0);              /* 13 */
+    emit_jump(func, OP_JUMP, 2);                /* 14 */
+    emit(func, OP_LOAD_LOCAL, 1);               /* 15: exit */
+    emit(func, OP_RETURN, 0);                   /* 16 */
+    return func;
+}
+
+/* ========== Benchmark ========== */
+
+#define BENCH_KERNELS 3
+
+typedef struct {
+    const char *name;
+    double instructions;
+    double seconds[2];
+    int ok;
+} BenchResult;
+
+static VMValue run_kernel(VirtualMachine *vm, int func_idx, int arg_count, double *seconds, int *status) {
+    double start = now_seconds();
+    *status = vm_call_function(vm, func_idx, arg_count);
+    *seconds = now_seconds() - start;
+    return *status == 0 ? vm_pop_value(vm) : vm_value_create_null();
+}
+
+static int add_kernel(VirtualMachine *vm, VMFunction *func, int level) {
+    vm_optimize_function(func, level);
+    return vm_add_function(vm, func);
+}
+
+/**
+ * Run the three kernels built at one optimization level. pass selects the
+ * seconds slot; ok is cleared on any wrong result.
+ */
+static int run_pass(VirtualMachine *vm, BenchResult *results, int pass, int level,
+                    int fib_n, long loop_count, long string_count) {
+    static const char *names[2][BENCH_KERNELS] = {
+        { "fib", "loop", "strings" },
+        { "fib_opt", "loop_opt", "strings_opt" }
+    };
+    int first = vm->function_count;
+    int fib_idx = add_kernel(vm, make_fib(names[pass][0]), level);
+    int loop_idx = add_kernel(vm, make_loop(names[pass][1], loop_count), level);
+    int strings_idx = add_kernel(vm, make_strings(names[pass][2], string_count), level);
+    int unresolved = vm_link_calls(vm, first, vm->function_count - first);
+    int status;
+    VMValue value;
+
+    vm_push_value(vm, vm_value_create_int(fib_n));
+    value = run_kernel(vm, fib_idx, 1, &results[0].seconds[pass], &status);
+    if (!(status == 0 && value.type == VALUE_INT && value.data.int_value == fib_value(fib_n))) {
+        results[0].ok = 0;
+    }
+
+    value = run_kernel(vm, loop_idx, 0, &results[1].seconds[pass], &status);
+    if (!(status == 0 && value.type == VALUE_INT &&
+          value.data.int_value == loop_count * (loop_count - 1) / 2)) {
+        results[1].ok = 0;
+    }
+
+    value = run_kernel(vm, strings_idx, 0, &results[2].seconds[pass], &status);
+    if (!(status == 0 && value.type == VALUE_STRING &&
+          strcmp(value.data.string_value, "HELLO WORLD") == 0)) {
+        results[2].ok = 0;
+    }
+    vm_value_release(&value);
+    return unresolved;
+}
+
+int main(int argc, char **argv) {
+    long scale = 1;
+    if (argc > 1) {
+        scale = atol(argv[1]);
+        if (scale <= 0) scale = 1;
+    }
+
+    int fib_n = BENCH_FIB_N;
+    long loop_count = BENCH_LOOP_COUNT * scale;
+    long string_count = BENCH_STRING_COUNT * scale;
+
+    VirtualMachine *vm = vm_init();
+    if (!vm) return 1;
+
+    BenchResult results[BENCH_KERNELS] = {
+        { "fib", fib_instructions(fib_n), { 0, 0 }, 1 },
+        { "loop", 13.0 * loop_count + 10.0, { 0, 0 }, 1 },
+        { "strings", 13.0 * string_count + 8.0, { 0, 0 }, 1 }
+    };
+
+    int failures = run_pass(vm, results, 0, VM_OPT_NONE, fib_n, loop_count, string_count) != 0;
+    failures += run_pass(vm, results, 1, VM_OPT_DEFAULT, fib_n, loop_count, string_count) != 0;
+
+    printf("\n========================================\n");
+    printf("Bytecode dispatch (scale %ld)\n", scale);
+    printf("========================================\n");
+    printf("  %-8s  %14s  %16s  %16s  %7s\n", "kernel", "instructions",
+           "instructions/sec", "optimized", "speedup");
+    for (int i = 0; i < BENCH_KERNELS; i++) {
+        double base = results[i].seconds[0] > 0 ? results[i].instructions / results[i].seconds[0] : 0.0;
+        double opt = results[i].seconds[1] > 0 ? results[i].instructions / results[i].seconds[1] : 0.0;
+        printf("  %-8s  %14.0f  %16.0f  %16.0f  %6.2fx%s\n", results[i].name,
+               results[i].instructions, base, opt, base > 0 ? opt / base : 0.0,
+               results[i].ok ? "" : "  (FAILED)");
+        if (!results[i].ok) failures++;
+    }
+    printf("\n");
+
+    vm_free(vm);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * bench_log.c - Logging Microbenchmark
+ *
+ * Times the two costs logging adds to the game loop. A disabled debug
+ * message: the old macros called getenv("AMLP_DEBUG") for every one,
+ * the new ones test a cached level. An enabled message: the old macros
+ * wrote it with fprintf(), the new ones format it into the ring and
+ * leave the write to the background thread. stderr goes to a temporary
+ * file, as it does when the driver's output is redirected to a log;
+ * enabled messages are sent in bursts the size of the ring, as a busy
+ * pass of the game loop would send them.
+ *
+ * Usage: build/bench_log [messages]
+ */
+
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_MESSAGES 1000000
+
+static volatile long sink;
+
+/* The previous DEBUG_LOG_VM, for comparison */
+#define OLD_DEBUG_LOG_VM(fmt, ...) \
+    do { \
+        if (getenv("AMLP_DEBUG") != NULL) { \
+            fprintf(stderr, "[VM] " fmt "\n", ##__VA_ARGS__); \
+        } \
+    } while(0)
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Give the writer time to empty the ring between bursts */
+static void settle(void) {
+    struct timespec pause = { 0, 5000000L };
+    nanosleep(&pause, NULL);
+}
+
+/* ========== Main ========== */
+
+int main(int argc, char **argv) {
+    int messages = argc > 1 ? atoi(argv[1]) : BENCH_MESSAGES;
+    if (messages < LOG_RING_SLOTS) messages = LOG_RING_SLOTS;
+    int bursts = messages / LOG_RING_SLOTS;
+    double sent = (double)bursts * LOG_RING_SLOTS;
+
+    FILE *log_file = tmpfile();
+    if (!log_file || dup2(fileno(log_file), STDERR_FILENO) < 0) {
+        printf("bench_log: cannot create a log file\n");
+        return 1;
+    }
+    unsetenv("AMLP_DEBUG");
+    log_init();
+    log_set_level(LOG_VM, LOG_LEVEL_INFO);
+
+    /* Disabled messages */
+    double start = now_seconds();
+    for (int i = 0; i < messages; i++) {
+        OLD_DEBUG_LOG_VM("pc=%d op=%d", i, i & 0xff);
+        sink += i;
+    }
+    double old_off_ns = (now_seconds() - start) * 1e9 / messages;
+
+    start = now_seconds();
+    for (int i = 0; i < messages; i++) {
+        LOG_AT(LOG_VM, LOG_LEVEL_DEBUG, "[VM]", "pc=%d op=%d", i, i & 0xff);
+        sink += i;
+    }
+    double new_off_ns = (now_seconds() - start) * 1e9 / messages;
+
+    /* Enabled messages, written directly */
+    double direct = 0;
+    for (int b = 0; b < bursts; b++) {
+        start = now_seconds();
+        for (int i = 0; i < LOG_RING_SLOTS; i++) {
+            fprintf(stderr, "[Server] Telnet connection fd %d from %s (%d online)\n",
+                    i, "127.0.0.1", b);
+        }
+        direct += now_seconds() - start;
+    }
+    double fprintf_ns = direct * 1e9 / sent;
+
+    /* Enabled messages, queued for the writer */
+    log_start_writer();
+    double queued = 0;
+    for (int b = 0; b < bursts; b++) {
+        start = now_seconds();
+        for (int i = 0; i < LOG_RING_SLOTS; i++) {
+            LOG_AT(LOG_SERVER, LOG_LEVEL_INFO, "[Server]", "Telnet connection fd %d from %s (%d online)",
+                   i, "127.0.0.1", b);
+        }
+        queued += now_seconds() - start;
+        settle();
+    }
+    log_shutdown();
+    double ring_ns = queued * 1e9 / sent;
+
+    printf("Logging benchmark (%d messages, ns per message)\n", messages);
+    printf("  %-28s %10s\n", "message", "ns");
+    printf("  %-28s %10.1f\n", "disabled, getenv()", old_off_ns);
+    printf("  %-28s %10.1f\n", "disabled, cached level", new_off_ns);
+    printf("  %-28s %10.1f\n", "enabled, fprintf()", fprintf_ns);
+    printf("  %-28s %10.1f\n", "enabled, ring", ring_ns);
+    printf("  (%lu dropped with the ring full)\n", log_dropped());
+    fclose(log_file);
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * bench_mapping.c - Mapping Microbenchmark
+ *
+ * Times insert, hit lookup, miss lookup, iteration and delete on
+ * mappings of several sizes. For reference, the same string-key work is
+ * repeated on a copy of the previous implementation: a chained hash
+ * table with a fixed bucket count, one malloc per entry, and iteration
+ * in bucket order; it is skipped at the largest size, where each of its
+ * operations walks a chain of thousands of entries. Int keys, which that
+ * table could not store, are timed on the current one only.
+ *
+ * Usage: build/bench_mapping [scale]   (default 1; multiplies the rounds)
+ */
+
+#include "mapping.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_KEYS  100000
+#define BENCH_WORK      2000000     /* Operations per measurement */
+
+static char *keys[BENCH_MAX_KEYS];
+static char *misses[BENCH_MAX_KEYS];
+static volatile long sink;
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void make_keys(void) {
+    char buf[32];
+    for (int i = 0; i < BENCH_MAX_KEYS; i++) {
+        snprintf(buf, sizeof(buf), "key_%d", i);
+        keys[i] = vm_string_intern(buf);
+        snprintf(buf, sizeof(buf), "absent_%d", i);
+        misses[i] = strdup(buf);
+    }
+}
+
+/* ========== Previous Implementation ========== */
+
+#define OLD_BUCKETS 16
+
+typedef struct old_entry_t {
+    char *key;
+    unsigned int hash;
+    VMValue value;
+    struct old_entry_t *next;
+} old_entry_t;
+
+typedef struct {
+    old_entry_t *buckets[OLD_BUCKETS];
+    size_t size;
+} old_mapping_t;
+
+static old_entry_t **old_find(old_mapping_t *map, const char *key, unsigned int hash, int interned) {
+    old_entry_t **cursor = &map->buckets[hash % OLD_BUCKETS];
+    while (*cursor) {
+        old_entry_t *entry = *cursor;
+        if (entry->key == key ||
+            (!interned && entry->hash == hash && strcmp(entry->key, key) == 0)) {
+            break;
+        }
+        cursor = &entry->next;
+    }
+    return cursor;
+}
+
+/* Like the old mapping_set(), interns key and keeps the reference */
+static void old_set(old_mapping_t *map, const char *str, VMValue value) {
+    char *key = vm_string_intern(str);
+    unsigned int hash = vm_string_hash(key);
+    old_entry_t **link = old_find(map, key, hash, 1);
+    if (*link) {
+        vm_string_release(key);
+        (*link)->value = value;
+        return;
+    }
+    old_entry_t *entry = (old_entry_t *)malloc(sizeof(old_entry_t));
+    entry->key = key;
+    entry->hash = hash;
+    entry->value = value;
+    entry->next = NULL;
+    *link = entry;
+    map->size++;
+}
+
+static VMValue old_get(old_mapping_t *map, const char *key) {
+    old_entry_t *entry = *old_find(map, key, vm_hash_cstring(key), 0);
+    return entry ? entry->value : vm_value_create_null();
+}
+
+static void old_delete(old_mapping_t *map, const char *key) {
+    old_entry_t **link = old_find(map, key, vm_hash_cstring(key), 0);
+    if (!*link) return;
+    old_entry_t *entry = *link;
+    *link = entry->next;
+    vm_string_release(entry->key);
+    free(entry);
+    map->size--;
+}
+
+static long old_sum(old_mapping_t *map) {
+    long sum = 0;
+    for (int i = 0; i < OLD_BUCKETS; i++) {
+        for (old_entry_t *e = map->buckets[i]; e; e = e->next) sum += e->value.data.int_value;
+    }
+    return sum;
+}
+
+/* ========== Timing ========== */
+
+typedef struct {
+    double insert, hit, miss, iterate, remove;  /* ns per operation */
+} Timings;
+
+static int rounds_for(int n, int scale) {
+    int rounds = BENCH_WORK / n;
+    if (rounds < 1) rounds = 1;
+    if (rounds > 20000) rounds = 20000;
+    return rounds * scale;
+}
+
+static Timings time_old(int n, int scale) {
+    Timings t;
+    memset(&t, 0, sizeof(t));
+    int rounds = rounds_for(n, scale);
+    /* Operations on the old table are O(n); one round is plenty */
+    if (n >= 10000) rounds = scale;
+    double ops = (double)rounds * n;
+
+    for (int r = 0; r < rounds; r++) {
+        old_mapping_t map;
+        memset(&map, 0, sizeof(map));
+
+        double start = now_seconds();
+        for (int i = 0; i < n; i++) old_set(&map, keys[i], vm_value_create_int(i));
+        t.insert += now_seconds() - start;
+
+        start = now_seconds();
+        for (int i = 0; i < n; i++) sink += old_get(&map, keys[i]).data.int_value;
+        t.hit += now_seconds() - start;
+
+        start = now_seconds();
+        for (int i = 0; i < n; i++) sink += old_get(&map, misses[i]).type;
+        t.miss += now_seconds() - start;
+
+        start = now_seconds();
+        sink += old_sum(&map);
+        t.iterate += now_seconds() - start;
+
+        start = now_seconds();
+        for (int i = 0; i < n; i++) old_delete(&map, keys[i]);
+        t.remove += now_seconds() - start;
+    }
+    t.insert *= 1e9 / ops; t.hit *= 1e9 / ops; t.miss *= 1e9 / ops;
+    t.iterate *= 1e9 / ops; t.remove *= 1e9 / ops;
+    return t;
+}
+
+static Timings time_new(int n, int scale, int int_keys) {
+    Timings t;
+    memset(&t, 0, sizeof(t));
+    int rounds = rounds_for(n, scale);
+    double ops = (double)rounds * n;
+
+    for (int r = 0; r < rounds; r++) {
+        mapping_t *map = mapping_new(NULL, 16);
+
+        double start = now_seconds();
+        if (int_keys) {
+            for (int i = 0; i < n; i++) mapping_store(map, vm_value_create_int(i), vm_value_create_int(i));
+        } else {
+            for (int i = 0; i < n; i++) mapping_set(map, keys[i], vm_value_create_int(i));
+        }
+        t.insert += now_seconds() - start;
+
+        start = now_seconds();
+        if (int_keys) {
+            for (int i = 0; i < n; i++) sink += mapping_lookup(map, vm_value_create_int(i)).data.int_value;
+        } else {
+            for (int i = 0; i < n; i++) sink += mapping_get(map, keys[i]).data.int_value;
+        }
+        t.hit += now_seconds() - start;
+
+        start = now_seconds();
+        if (int_keys) {
+            for (int i = 0; i < n; i++) sink += mapping_lookup(map, vm_value_create_int(-1 - i)).type;
+        } else {
+            for (int i = 0; i < n; i++) sink += mapping_get(map, misses[i]).type;
+        }
+        t.miss += now_seconds() - start;
+
+        start = now_seconds();
+        size_t cursor = 0;
+        mapping_entry_t *entry;
+        while ((entry = mapping_next(map, &cursor)) != NULL) {
+            sink += entry->value.data.int_value;
+        }
+        t.iterate += now_seconds() - start;
+
+        start = now_seconds();
+        if (int_keys) {
+            for (int i = 0; i < n; i++) mapping_remove(map, vm_value_create_int(i));
+        } else {
+            for (int i = 0; i < n; i++) mapping_delete(map, keys[i]);
+        }
+        t.remove += now_seconds() - start;
+
+        mapping_free(map);
+    }
+    t.insert *= 1e9 / ops; t.hit *= 1e9 / ops; t.miss *= 1e9 / ops;
+    t.iterate *= 1e9 / ops; t.remove *= 1e9 / ops;
+    return t;
+}
+
+static void print_row(const char *label, int n, Timings t) {
+    printf("  %-12s %7d %9.1f %9.1f %9.1f %9.2f %9.1f\n",
+           label, n, t.insert, t.hit, t.miss, t.iterate, t.remove);
+}
+
+/* ========== Main ========== */
+
+int main(int argc, char **argv) {
+    int scale = argc > 1 ? atoi(argv[1]) : 1;
+    if (scale < 1) scale = 1;
+    static const int sizes[] = {16, 1000, 10000, 100000};
+
+    make_keys();
+
+    printf("Mapping benchmark (ns per operation)\n");
+    printf("  %-12s %7s %9s %9s %9s %9s %9s\n",
+           "table", "keys", "insert", "hit", "miss", "iterate", "delete");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        /* Past 10k keys the chained table takes minutes */
+        if (n <= 10000) print_row("chained", n, time_old(n, scale));
+        print_row("robin hood", n, time_new(n, scale, 0));
+        print_row("  int keys", n, time_new(n, scale, 1));
+    }
+
+    for (int i = 0; i < BENCH_MAX_KEYS; i++) {
+        vm_string_release(keys[i]);
+        free(misses[i]);
+    }
+    return 0;
+}
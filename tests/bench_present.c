@@ -0,0 +1,141 @@
+/*
+ * bench_present.c - Containment Lookup Microbenchmark
+ *
+ * Loads BENCH_CLONES clones spread over BENCH_ROOMS rooms, then times
+ * present() and all_inventory() against one room. Both walk only that
+ * room's inventory. For reference, the same lookup is repeated as a
+ * scan over every object in the object manager, which is how these
+ * efuns used to find a container's contents.
+ *
+ * Usage: build/bench_present [lookups]
+ */
+
+#include "vm.h"
+#include "efun.h"
+#include "object.h"
+#include "array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CLONES   100000
+#define BENCH_ROOMS    1000
+#define BENCH_LOOKUPS  100000
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static VMValue object_value(obj_t *obj) {
+    VMValue v;
+    v.type = VALUE_OBJECT;
+    v.data.object_value = obj;
+    return v;
+}
+
+/* The old present(): every registered object, filtered by environment */
+static obj_t *scan_present(ObjManager *mgr, const char *id, obj_t *where) {
+    for (int i = 0; i < mgr->object_count; i++) {
+        obj_t *o = mgr->objects[i];
+        if (!o || o->environment != where) continue;
+        VMValue pid = obj_get_prop(o, "id");
+        if (pid.type == VALUE_STRING && strcmp(pid.data.string_value, id) == 0) return o;
+    }
+    return NULL;
+}
+
+/* ========== Benchmark ========== */
+
+int main(int argc, char **argv) {
+    long lookups = BENCH_LOOKUPS;
+    if (argc > 1) {
+        lookups = atol(argv[1]);
+        if (lookups <= 0) lookups = BENCH_LOOKUPS;
+    }
+
+    VirtualMachine *vm = vm_init();
+    ObjManager *mgr = efun_object_manager();
+    if (!vm || !mgr) return 1;
+
+    obj_t *rooms[BENCH_ROOMS];
+    for (int i = 0; i < BENCH_ROOMS; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "/bench/room_%d", i);
+        rooms[i] = obj_new(name);
+        obj_manager_register(mgr, rooms[i]);
+    }
+
+    /* The sword is moved in first, so it ends up last in its room, and
+     * registered last, so the world scan has to visit every object */
+    obj_t *coin = obj_new("/bench/coin");
+    obj_t *sword = obj_new("/bench/sword");
+    obj_set_prop(coin, "id", vm_value_create_string("coin"));
+    obj_set_prop(sword, "id", vm_value_create_string("sword"));
+    obj_manager_register(mgr, coin);
+    obj_t *room = rooms[BENCH_ROOMS / 2];
+    obj_move(sword, room);
+
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_CLONES; i++) {
+        obj_t *clone = obj_clone(coin);
+        obj_manager_register(mgr, clone);
+        obj_move(clone, rooms[i % BENCH_ROOMS]);
+    }
+    double t_load = now_seconds() - start;
+    obj_manager_register(mgr, sword);
+
+    VMValue args[2] = { vm_value_create_string("sword"), object_value(room) };
+    int failures = 0;
+
+    start = now_seconds();
+    for (long i = 0; i < lookups; i++) {
+        VMValue found = efun_present(vm, args, 2);
+        if (found.type != VALUE_OBJECT || found.data.object_value != sword) failures++;
+    }
+    double t_present = now_seconds() - start;
+
+    start = now_seconds();
+    for (long i = 0; i < lookups; i++) {
+        VMValue inv = efun_all_inventory(vm, &args[1], 1);
+        if (inv.type != VALUE_ARRAY || inv.data.array_value->length != (size_t)room->inventory_count) {
+            failures++;
+        }
+        array_free(inv.data.array_value);
+    }
+    double t_inventory = now_seconds() - start;
+
+    /* The scan is thousands of times slower; a few hundred calls are enough */
+    long scans = lookups < 200 ? lookups : 200;
+    start = now_seconds();
+    for (long i = 0; i < scans; i++) {
+        if (scan_present(mgr, "sword", room) != sword) failures++;
+    }
+    double t_scan = now_seconds() - start;
+
+    printf("\n========================================\n");
+    printf("present() with %d clones in %d rooms (%d per room)\n",
+           BENCH_CLONES, BENCH_ROOMS, room->inventory_count);
+    printf("========================================\n");
+    printf("  load + move_object: %.1f ns/clone\n", t_load * 1e9 / BENCH_CLONES);
+    printf("  %-16s  %10s  %12s\n", "lookup", "calls", "ns/call");
+    printf("  %-16s  %10ld  %12.1f\n", "present()", lookups, t_present * 1e9 / lookups);
+    printf("  %-16s  %10ld  %12.1f\n", "all_inventory()", lookups, t_inventory * 1e9 / lookups);
+    printf("  %-16s  %10ld  %12.1f\n", "world scan", scans, t_scan * 1e9 / scans);
+    printf("  speedup: %.0fx\n\n", (t_scan / scans) / (t_present / lookups));
+
+    /* Objects are freed directly; unregistering them one by one is quadratic */
+    vm_value_release(&args[0]);
+    for (int i = mgr->object_count - 1; i >= 0; i--) {
+        obj_free(mgr->objects[i]);
+    }
+    mgr->object_count = 0;
+    vm_free(vm);
+
+    if (failures) fprintf(stderr, "bench_present: %d wrong results\n", failures);
+    return failures ? 1 : 0;
+}
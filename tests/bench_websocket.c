@@ -0,0 +1,224 @@
+/*
+ * bench_websocket.c - WebSocket Frame Parsing Microbenchmark
+ *
+ * Feeds the same stream of masked client frames, in 4 KB reads, through
+ * a copy of the receive path handle_websocket_data() used to have and
+ * through the incremental parser. The old path appended each read to the
+ * session buffer, decoded a frame into a malloc()ed copy unmasked a byte
+ * at a time, copied a text payload once more into a line buffer, and
+ * shifted the rest of the buffer down. The parser is received into
+ * directly, unmasks in place and hands the payload out where it lies.
+ * Two streams: short commands, as players type them, and 16 KB messages.
+ *
+ * Usage: build/bench_websocket [megabytes]
+ */
+
+#include "websocket.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MEGABYTES 64
+#define BENCH_READ_SIZE 4096
+#define OLD_BUFFER_SIZE 65536
+#define OLD_INPUT_SIZE 2048
+
+static volatile long sink;
+
+/* ========== Helpers ========== */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static size_t put_frame(uint8_t *out, const uint8_t *payload, size_t len, const uint8_t key[4]) {
+    size_t pos = 0;
+    out[pos++] = 0x80 | WS_OPCODE_TEXT;
+    if (len < 126) {
+        out[pos++] = 0x80 | (uint8_t)len;
+    } else {
+        out[pos++] = 0x80 | 126;
+        out[pos++] = (uint8_t)(len >> 8);
+        out[pos++] = (uint8_t)len;
+    }
+    memcpy(out + pos, key, 4);
+    pos += 4;
+    for (size_t i = 0; i < len; i++) out[pos + i] = payload[i] ^ key[i % 4];
+    return pos + len;
+}
+
+/* A stream of text frames of about size bytes each */
+static uint8_t *make_stream(size_t total, size_t size, size_t *len, int *frames) {
+    static const char *commands[] = {
+        "look", "n", "say hello everyone", "get sword", "tell Zed meet me at the plaza",
+        "cast fireball at rat", "i", "chat anyone selling armour?",
+    };
+    uint8_t *stream = malloc(total + 70000);
+    uint8_t *payload = malloc(size + 64);
+    uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+    *len = 0;
+    *frames = 0;
+    while (*len < total) {
+        const char *text = commands[*frames % 8];
+        size_t n = strlen(text);
+        if (size > n) {
+            n = size;
+            for (size_t i = 0; i < n; i++) payload[i] = (uint8_t)('a' + i % 26);
+        } else {
+            memcpy(payload, text, n);
+        }
+        key[0] = (uint8_t)*frames;
+        *len += put_frame(stream + *len, payload, n, key);
+        (*frames)++;
+    }
+    free(payload);
+    return stream;
+}
+
+/* ========== Old Receive Path ========== */
+
+/* The previous ws_decode_frame(), for comparison */
+static int old_decode_frame(const uint8_t *data, size_t data_len, WSFrame *frame, size_t *consumed) {
+    if (data_len < 2) return 1;
+    memset(frame, 0, sizeof(WSFrame));
+    size_t pos = 0;
+    frame->fin = (data[pos] & 0x80) != 0;
+    frame->opcode = data[pos] & 0x0F;
+    pos++;
+    frame->masked = (data[pos] & 0x80) != 0;
+    uint64_t payload_len = data[pos] & 0x7F;
+    pos++;
+    if (payload_len == 126) {
+        if (data_len < pos + 2) return 1;
+        payload_len = ((uint64_t)data[pos] << 8) | data[pos + 1];
+        pos += 2;
+    } else if (payload_len == 127) {
+        if (data_len < pos + 8) return 1;
+        payload_len = 0;
+        for (int i = 0; i < 8; i++) payload_len = (payload_len << 8) | data[pos + i];
+        pos += 8;
+    }
+    frame->payload_len = payload_len;
+    if (payload_len > WS_MAX_FRAME_SIZE) return -1;
+    if (frame->masked) {
+        if (data_len < pos + 4) return 1;
+        memcpy(frame->mask_key, data + pos, 4);
+        pos += 4;
+    }
+    if (data_len < pos + payload_len) return 1;
+    if (payload_len > 0) {
+        frame->payload = malloc(payload_len + 1);
+        if (!frame->payload) return -1;
+        memcpy(frame->payload, data + pos, payload_len);
+        if (frame->masked) {
+            for (uint64_t i = 0; i < payload_len; i++) frame->payload[i] ^= frame->mask_key[i % 4];
+        }
+        frame->payload[payload_len] = '\0';
+    }
+    *consumed = pos + payload_len;
+    return 0;
+}
+
+static int run_old(const uint8_t *stream, size_t len) {
+    static uint8_t buffer[OLD_BUFFER_SIZE];
+    size_t buffer_len = 0;
+    int messages = 0;
+
+    for (size_t fed = 0; fed < len; fed += BENCH_READ_SIZE) {
+        size_t n = len - fed < BENCH_READ_SIZE ? len - fed : BENCH_READ_SIZE;
+        memcpy(buffer + buffer_len, stream + fed, n);
+        buffer_len += n;
+
+        while (buffer_len > 0) {
+            WSFrame frame;
+            size_t consumed;
+            if (old_decode_frame(buffer, buffer_len, &frame, &consumed) != 0) break;
+            if (frame.payload) {
+                char input[OLD_INPUT_SIZE];
+                size_t copy_len = frame.payload_len < sizeof(input) - 2 ? frame.payload_len : sizeof(input) - 2;
+                memcpy(input, frame.payload, copy_len);
+                input[copy_len] = '\n';
+                input[copy_len + 1] = '\0';
+                sink += input[0];
+            }
+            free(frame.payload);
+            messages++;
+            memmove(buffer, buffer + consumed, buffer_len - consumed);
+            buffer_len -= consumed;
+        }
+    }
+    return messages;
+}
+
+/* ========== Parser ========== */
+
+static int run_parser(WSParser *parser, const uint8_t *stream, size_t len) {
+    int messages = 0;
+    ws_parser_init(parser);
+
+    for (size_t fed = 0; fed < len; ) {
+        size_t avail;
+        uint8_t *space = ws_parser_space(parser, &avail);
+        size_t n = len - fed < BENCH_READ_SIZE ? len - fed : BENCH_READ_SIZE;
+        if (!space) return -1;
+        if (n > avail) n = avail;
+        memcpy(space, stream + fed, n);     /* Stands in for recv() */
+        ws_parser_commit(parser, n);
+        fed += n;
+
+        WSMessage message;
+        while (ws_parser_next(parser, &message) == 0) {
+            sink += message.data[0];
+            messages++;
+        }
+    }
+    return messages;
+}
+
+/* ========== Main ========== */
+
+int main(int argc, char **argv) {
+    int megabytes = argc > 1 ? atoi(argv[1]) : BENCH_MEGABYTES;
+    if (megabytes < 1) megabytes = 1;
+    size_t total = (size_t)megabytes << 20;
+    WSParser *parser = malloc(sizeof(WSParser));
+
+    printf("WebSocket receive benchmark (%d MB of masked text frames in %d-byte reads)\n",
+           megabytes, BENCH_READ_SIZE);
+    printf("  %-16s %-16s %10s %10s\n", "stream", "path", "MB/s", "ns/msg");
+
+    static const struct { const char *name; size_t size; } streams[] = {
+        { "commands", 0 },
+        { "16 KB messages", 16384 },
+    };
+    for (int s = 0; s < 2; s++) {
+        size_t len;
+        int frames;
+        uint8_t *stream = make_stream(total, streams[s].size, &len, &frames);
+
+        double start = now_seconds();
+        int old_messages = run_old(stream, len);
+        double old_time = now_seconds() - start;
+
+        start = now_seconds();
+        int new_messages = run_parser(parser, stream, len);
+        double new_time = now_seconds() - start;
+
+        if (old_messages != frames || new_messages != frames) {
+            printf("bench_websocket: %d frames, old path saw %d, parser %d\n",
+                   frames, old_messages, new_messages);
+            return 1;
+        }
+        double mb = (double)len / (1 << 20);
+        printf("  %-16s %-16s %10.0f %10.1f\n", streams[s].name, "copy and shift",
+               mb / old_time, old_time * 1e9 / frames);
+        printf("  %-16s %-16s %10.0f %10.1f\n", streams[s].name, "parser",
+               mb / new_time, new_time * 1e9 / frames);
+        free(stream);
+    }
+    free(parser);
+    return 0;
+}
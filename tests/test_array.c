@@ -370,6 +370,193 @@ void test_array_clone_independence(void) {
     gc_free(gc);
 }
 
+/* ========== TESTS: Copy-on-Write ========== */
+
+void test_array_clone_shares_storage(void) {
+    test_setup("Clone shares storage until written");
+    
+    GC *gc = gc_init();
+    array_t *arr = array_new(gc, 4);
+    array_push(arr, vm_value_create_string("sword"));
+    array_push(arr, vm_value_create_int(2));
+    
+    array_t *clone = array_clone(arr, gc);
+    test_assert(clone->elements == arr->elements, "Clone should read the original's elements");
+    test_assert(arr->shared && arr->shared->refs == 2, "Storage should have two users");
+    
+    array_push(clone, vm_value_create_int(3));
+    test_assert(clone->elements != arr->elements && array_length(clone) == 3,
+                "A write should give the clone its own elements");
+    test_assert(array_length(arr) == 2 && strcmp(array_get(arr, 0).data.string_value, "sword") == 0,
+                "The original should be unchanged");
+    test_assert(strcmp(array_get(clone, 0).data.string_value, "sword") == 0,
+                "The clone should keep the shared string");
+    
+    VMValue *before = arr->elements;
+    array_set(arr, 1, vm_value_create_int(20));
+    test_assert(arr->elements == before && arr->shared == NULL,
+                "The last user should write in place");
+    
+    array_free(clone);
+    array_free(arr);
+    gc_free(gc);
+}
+
+void test_array_clone_nested_is_deep(void) {
+    test_setup("Clone of nested arrays is still deep");
+    
+    GC *gc = gc_init();
+    array_t *inner = array_new(gc, 2);
+    array_push(inner, vm_value_create_int(1));
+    array_t *outer = array_new(gc, 2);
+    VMValue v;
+    v.type = VALUE_ARRAY;
+    v.data.array_value = inner;
+    array_push(outer, v);
+    
+    array_t *clone = array_clone(outer, gc);
+    array_t *inner_copy = array_get(clone, 0).data.array_value;
+    test_assert(clone->elements != outer->elements && inner_copy != inner,
+                "Nested arrays should be copied up front");
+    
+    array_set(inner, 0, vm_value_create_int(99));
+    test_assert(array_get(inner_copy, 0).data.int_value == 1,
+                "Writing the original's nested array should not show in the clone");
+    
+    array_free(clone);
+    array_free(outer);
+    gc_free(gc);
+}
+
+void test_array_slice_view(void) {
+    test_setup("Slices are views until written");
+    
+    GC *gc = gc_init();
+    array_t *arr = array_new(gc, 8);
+    for (int i = 0; i < 6; i++) {
+        array_push(arr, vm_value_create_int(i * 10));
+    }
+    
+    array_t *slice = array_slice(arr, 2, 3);
+    test_assert(slice && array_length(slice) == 3 && slice->elements == arr->elements + 2,
+                "A slice should point into its source");
+    test_assert(array_get(slice, 0).data.int_value == 20 && array_get(slice, 2).data.int_value == 40,
+                "A slice should see its range");
+    test_assert(array_slice(arr, 4, 3) == NULL, "A range past the end should fail");
+    
+    array_set(arr, 2, vm_value_create_int(-1));
+    test_assert(array_get(slice, 0).data.int_value == 20, "Writing the source should not change the slice");
+    test_assert(array_get(arr, 2).data.int_value == -1, "The source should see its own write");
+    
+    array_t *empty = array_slice(slice, 3, 0);
+    test_assert(empty && array_length(empty) == 0, "An empty slice at the end should be allowed");
+    
+    array_free(arr);
+    array_push(slice, vm_value_create_int(50));
+    test_assert(array_length(slice) == 4 && array_get(slice, 3).data.int_value == 50 &&
+                array_get(slice, 1).data.int_value == 30,
+                "A slice should outlive its source and grow on its own");
+    
+    array_free(empty);
+    array_free(slice);
+    gc_free(gc);
+}
+
+void test_array_slice_nested(void) {
+    test_setup("Slices of nested arrays are copies");
+    
+    GC *gc = gc_init();
+    array_t *outer = array_new(gc, 4);
+    for (int i = 0; i < 3; i++) {
+        array_t *inner = array_new(gc, 2);
+        array_push(inner, vm_value_create_int(i));
+        VMValue v;
+        v.type = VALUE_ARRAY;
+        v.data.array_value = inner;
+        array_push(outer, v);
+    }
+    
+    array_t *slice = array_slice(outer, 1, 2);
+    test_assert(slice && array_length(slice) == 2 && slice->elements != outer->elements + 1,
+                "A nested slice should not point into its source");
+    
+    array_t *inner_copy = array_get(slice, 0).data.array_value;
+    array_set(inner_copy, 0, vm_value_create_int(99));
+    array_set(slice, 1, vm_value_create_int(-1));
+    array_delete(slice, 0);
+    
+    array_t *inner = array_get(outer, 1).data.array_value;
+    test_assert(array_length(outer) == 3 && array_get(outer, 2).type == VALUE_ARRAY,
+                "Writing the slice should not change the source");
+    test_assert(inner != inner_copy && array_get(inner, 0).data.int_value == 1,
+                "The source's nested arrays should be intact");
+    
+    array_free(slice);
+    array_free(outer);
+    gc_free(gc);
+}
+
+void test_array_slice_strings(void) {
+    test_setup("Slices keep string references balanced");
+    
+    array_t *arr = array_new(NULL, 4);
+    array_push(arr, vm_value_create_string("north"));
+    array_push(arr, vm_value_create_string("south"));
+    array_push(arr, vm_value_create_string("east"));
+    
+    array_t *slice = array_slice(arr, 1, 1);
+    array_t *clone = array_clone(slice, NULL);
+    array_free(arr);
+    
+    /* Only the slice still needs "south"; its write takes it over */
+    array_push(slice, vm_value_create_string("west"));
+    test_assert(strcmp(array_get(slice, 0).data.string_value, "south") == 0 &&
+                strcmp(array_get(clone, 0).data.string_value, "south") == 0,
+                "Both views should still read their strings");
+    
+    array_free(clone);
+    array_free(slice);
+}
+
+void test_array_slice_gc(void) {
+    test_setup("A slice keeps its shared storage alive through a collection");
+    
+    VirtualMachine *vm = vm_init();
+    array_t *arr = array_new(vm->gc, 4);
+    array_push(arr, vm_value_create_int(1));
+    array_push(arr, vm_value_create_string("sword"));
+    
+    array_t *slice = array_slice(arr, 1, 1);
+    vm->global_variables[0].type = VALUE_ARRAY;
+    vm->global_variables[0].data.array_value = slice;
+    
+    /* Nested source: the slice holds copies the collector must trace */
+    array_t *nested = array_new(vm->gc, 4);
+    array_t *inner = array_new(vm->gc, 1);
+    VMValue v;
+    v.type = VALUE_ARRAY;
+    v.data.array_value = inner;
+    array_push(nested, vm_value_create_int(1));
+    array_push(nested, v);
+    
+    array_t *nested_slice = array_slice(nested, 1, 1);
+    vm->global_variables[1].type = VALUE_ARRAY;
+    vm->global_variables[1].data.array_value = nested_slice;
+    vm->global_count = 2;
+    gc_collect_full(vm->gc);
+    
+    test_assert(!gc_is_tracked(vm->gc, arr) && !gc_is_tracked(vm->gc, nested),
+                "The unreachable sources should be collected");
+    test_assert(slice->shared && gc_is_tracked(vm->gc, slice->shared->values) &&
+                strcmp(array_get(slice, 0).data.string_value, "sword") == 0,
+                "The storage a flat slice shares should survive");
+    array_t *inner_copy = array_get(nested_slice, 0).data.array_value;
+    test_assert(!gc_is_tracked(vm->gc, inner) && gc_is_tracked(vm->gc, inner_copy),
+                "The nested array the slice sees should survive");
+    
+    vm_free(vm);
+}
+
 /* ========== TESTS: Edge Cases ========== */
 
 void test_array_mixed_types(void) {
@@ -503,6 +690,14 @@ int main(void) {
     test_array_clone_empty();
     test_array_clone_independence();
     
+    /* Copy-on-Write Tests */
+    test_array_clone_shares_storage();
+    test_array_clone_nested_is_deep();
+    test_array_slice_view();
+    test_array_slice_nested();
+    test_array_slice_strings();
+    test_array_slice_gc();
+    
     /* Edge Cases */
     test_array_mixed_types();
     test_array_length();
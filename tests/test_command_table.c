@@ -0,0 +1,382 @@
+/**
+ * test_command_table.c - Command Table Test Suite
+ *
+ * Tests for verb, alias and prefix lookup, removal and growth of the
+ * table, command object paths, and actions added from LPC with
+ * add_action().
+ */
+
+#include "command_table.h"
+#include "array.h"
+#include "compiler.h"
+#include "object_program.h"
+#include "object.h"
+#include "efun.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static VMValue handler_a(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb; (void)args;
+    return vm_value_create_int(1);
+}
+
+static VMValue handler_b(PlayerSession *session, const char *verb, const char *args) {
+    (void)session; (void)verb; (void)args;
+    return vm_value_create_int(2);
+}
+
+static const char *verb_of(CommandTable *table, const char *word) {
+    const CommandEntry *entry = command_table_match(table, word);
+    return entry ? entry->verb : "(none)";
+}
+
+/* record(arg): the lever's pull action was run with arg */
+static int pulls = 0;
+static char last_arg[64];
+
+static VMValue efun_record(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    if (arg_count == 1 && args[0].type == VALUE_STRING) {
+        pulls++;
+        snprintf(last_arg, sizeof(last_arg), "%s", args[0].data.string_value);
+    }
+    return vm_value_create_int(0);
+}
+
+static const char *lever_src =
+    "void create() { add_action(\"do_pull\", \"pull\"); add_action(\"do_push\", \"push\", 1); }\n"
+    "int do_pull(string arg) { record(arg); return 1; }\n"
+    "int do_push(string arg) { return 0; }\n";
+
+/* An instance of a program compiled from src, created; it holds the
+ * program's only reference */
+static obj_t *new_instance_of(VirtualMachine *vm, const char *src, const char *path) {
+    Program *prog = compiler_compile_string(src, path);
+    if (!prog) return NULL;
+    ObjProgram *program = obj_program_from(vm, path, prog);
+    program_free(prog);
+    if (!program) return NULL;
+
+    obj_t *obj = obj_new(path);
+    if (obj && obj_program_attach(obj, program) != 0) {
+        obj_free(obj);
+        obj = NULL;
+    }
+    obj_program_release(program);
+
+    if (obj) obj_call_method(vm, obj, "create", NULL, 0);
+    return obj;
+}
+
+/* ========== Tests ========== */
+
+void test_verbs_and_aliases(void) {
+    test_setup("Aliases share their verb's builtin");
+
+    CommandTable table;
+    test_assert(command_table_init(&table) == 0, "Table should initialise");
+
+    command_table_add_builtin(&table, "look", handler_a, 0, 0);
+    command_table_add_alias(&table, "l", "look");
+    command_table_add_builtin(&table, "equip", handler_b, 0, 0);
+    command_table_add_alias(&table, "eq", "equip");
+    command_table_add_alias(&table, "wield", "eq");
+
+    const CommandEntry *look = command_table_find(&table, "look");
+    test_assert(look && look->handler == handler_a, "look should have its builtin");
+    test_assert(command_table_builtin(command_table_find(&table, "l")) == look,
+                "l should run look's builtin");
+    test_assert(command_table_builtin(command_table_find(&table, "wield")) ==
+                command_table_find(&table, "equip"),
+                "An alias of an alias should run the verb's builtin");
+    test_assert(command_table_find(&table, "lo") == NULL, "find() should not match prefixes");
+    test_assert(command_table_add_alias(&table, "look", "equip") != 0,
+                "A verb should not be turned into an alias");
+    test_assert(command_table_add_alias(&table, "x", "nothing") != 0,
+                "An alias for an unknown verb should be refused");
+
+    command_table_add_path(&table, "l", "/cmds/look");
+    test_assert(look->path == NULL, "A path for an alias should stay with the alias");
+
+    test_assert(command_table_remove(&table, "l") == 0 && command_table_find(&table, "look") == look,
+                "Removing an alias should keep its verb");
+    test_assert(command_table_remove(&table, "equip") == 0 &&
+                command_table_find(&table, "eq") == NULL &&
+                command_table_find(&table, "wield") == NULL,
+                "Removing a verb should remove its aliases");
+    test_assert(table.count == 1, "Only look should be left");
+
+    command_table_free(&table);
+}
+
+void test_prefixes(void) {
+    test_setup("Unique prefixes select COMMAND_ABBREV verbs");
+
+    CommandTable table;
+    command_table_init(&table);
+    command_table_add_builtin(&table, "inventory", handler_a, 0, COMMAND_ABBREV);
+    command_table_add_builtin(&table, "inspect", handler_a, 0, COMMAND_ABBREV);
+    command_table_add_builtin(&table, "skills", handler_a, 0, COMMAND_ABBREV);
+    command_table_add_builtin(&table, "shout", handler_a, 0, 0);
+    command_table_add_builtin(&table, "i", handler_b, 0, 0);
+
+    test_assert(strcmp(verb_of(&table, "inv"), "inventory") == 0, "inv should be inventory");
+    test_assert(strcmp(verb_of(&table, "ins"), "inspect") == 0, "ins should be inspect");
+    test_assert(strcmp(verb_of(&table, "in"), "(none)") == 0, "in should be ambiguous");
+    test_assert(strcmp(verb_of(&table, "i"), "i") == 0, "An exact verb should beat prefixes");
+    test_assert(strcmp(verb_of(&table, "sk"), "skills") == 0, "sk should be skills");
+    test_assert(strcmp(verb_of(&table, "sho"), "(none)") == 0,
+                "Verbs without COMMAND_ABBREV should need the whole word");
+    test_assert(strcmp(verb_of(&table, "inventoryx"), "(none)") == 0,
+                "Longer words should not match");
+
+    command_table_remove(&table, "inspect");
+    test_assert(strcmp(verb_of(&table, "in"), "inventory") == 0,
+                "Removing a verb should refresh the prefix index");
+
+    command_table_free(&table);
+}
+
+void test_growth_and_removal(void) {
+    test_setup("The table grows and survives heavy removal");
+
+    CommandTable table;
+    command_table_init(&table);
+    char verb[32];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(verb, sizeof(verb), "verb%d", i);
+        command_table_add_builtin(&table, verb, handler_a, 0, 0);
+    }
+    test_assert(table.count == 2000 && table.slot_count >= 4000, "2000 verbs at half load or less");
+
+    for (int i = 0; i < 2000; i += 2) {
+        snprintf(verb, sizeof(verb), "verb%d", i);
+        command_table_remove(&table, verb);
+    }
+    int found = 0, gone = 0;
+    for (int i = 0; i < 2000; i++) {
+        snprintf(verb, sizeof(verb), "verb%d", i);
+        if (command_table_find(&table, verb)) found += (i % 2);
+        else gone += !(i % 2);
+    }
+    test_assert(found == 1000 && gone == 1000 && table.count == 1000,
+                "Every odd verb should remain findable after removing the even ones");
+
+    command_table_free(&table);
+}
+
+void test_paths(void) {
+    test_setup("Command object paths come and go with their words");
+
+    CommandTable table;
+    command_table_init(&table);
+    command_table_add_builtin(&table, "who", handler_a, 0, 0);
+    command_table_add_path(&table, "who", "/cmds/who");
+    command_table_add_path(&table, "score", "/cmds/score");
+    command_table_add_path(&table, "score", "/cmds/player/score");
+
+    const CommandEntry *score = command_table_find(&table, "score");
+    test_assert(score && strcmp(score->path, "/cmds/player/score") == 0,
+                "A second path should replace the first");
+    test_assert(command_table_remove_path(&table, "score") == 0 &&
+                command_table_find(&table, "score") == NULL,
+                "A verb with only a path should go with it");
+    test_assert(command_table_remove_path(&table, "who") == 0 &&
+                command_table_find(&table, "who") != NULL,
+                "A verb with a builtin should stay");
+    test_assert(command_table_remove_path(&table, "who") != 0,
+                "Removing a missing path should fail");
+
+    command_table_add_builtin(&table, "stats", handler_a, 0, 0);
+    command_table_add_alias(&table, "score", "stats");
+    command_table_add_path(&table, "score", "/cmds/score");
+    command_table_remove(&table, "stats");
+    score = command_table_find(&table, "score");
+    test_assert(score && score->path && command_table_builtin(score) == NULL,
+                "An alias with a path should outlive its verb");
+
+    command_table_free(&table);
+}
+
+void test_actions(void) {
+    test_setup("Actions are per owner and dropped with their owner");
+
+    CommandTable table;
+    command_table_init(&table);
+    obj_t *a = obj_new("/test/a");
+    obj_t *b = obj_new("/test/b");
+
+    command_table_add_action(&table, "pull", a, "do_pull", 0);
+    command_table_add_action(&table, "pull", a, "other_pull", 0);
+    command_table_add_action(&table, "pull", b, "do_pull", 0);
+    command_table_add_action(&table, "yank", a, "do_yank", COMMAND_ABBREV);
+
+    const CommandEntry *pull = command_table_find(&table, "pull");
+    int n = 0;
+    for (const CommandAction *act = pull ? pull->actions : NULL; act; act = act->next) n++;
+    test_assert(n == 2 && a->action_count == 2 && b->action_count == 1,
+                "Adding the same verb again should replace the owner's action");
+    test_assert(strcmp(verb_of(&table, "ya"), "yank") == 0, "Actions can take prefixes");
+
+    command_table_forget_object(&table, a);
+    test_assert(a->action_count == 0 && command_table_find(&table, "yank") == NULL,
+                "A verb with only the owner's actions should go");
+    pull = command_table_find(&table, "pull");
+    test_assert(pull && pull->actions && pull->actions->owner == b && !pull->actions->next,
+                "Other owners' actions should stay");
+
+    command_table_forget_object(&table, b);
+    test_assert(table.count == 0, "The table should be empty");
+
+    /* An alias given an abbreviable action keeps its place in the prefix index */
+    command_table_add_builtin(&table, "inventory", handler_a, 0, 0);
+    command_table_add_alias(&table, "invent", "inventory");
+    command_table_add_action(&table, "invent", a, "do_invent", COMMAND_ABBREV);
+    test_assert(strcmp(verb_of(&table, "inve"), "invent") == 0, "The alias's action should take prefixes");
+    command_table_forget_object(&table, a);
+    command_table_remove(&table, "inventory");
+    test_assert(command_table_find(&table, "invent") == NULL &&
+                strcmp(verb_of(&table, "inve"), "(none)") == 0,
+                "Removing the verb should drop the alias from the prefix index");
+
+    command_table_free(&table);
+    obj_free(a);
+    obj_free(b);
+}
+
+void test_add_action_efun(void) {
+    test_setup("add_action() from LPC handles commands in reach");
+
+    VirtualMachine *vm = vm_init();
+    efun_register(vm->efun_registry, "record", efun_record, 1, 1, "void record(string)");
+    CommandTable *table = command_table_global();
+
+    obj_t *room = obj_new("/test/room");
+    obj_t *player = obj_new("/test/player");
+    obj_t *elsewhere = obj_new("/test/elsewhere");
+    obj_t *lever = new_instance_of(vm, lever_src, "/test/lever");
+    test_assert(lever != NULL, "Lever should load");
+    if (!lever) {
+        vm_free(vm);
+        return;
+    }
+    obj_move(player, room);
+    obj_move(lever, room);
+
+    const CommandEntry *pull = command_table_match(table, "pull");
+    test_assert(pull && pull->actions && pull->actions->owner == lever,
+                "create() should have added the action");
+    test_assert(command_table_run_actions(table, vm, pull, player, "hard") == 1 &&
+                pulls == 1 && strcmp(last_arg, "hard") == 0,
+                "The lever's action should run with the arguments");
+
+    const CommandEntry *push = command_table_match(table, "pu");
+    test_assert(push && strcmp(push->verb, "push") == 0,
+                "add_action() with flag 1 should allow prefixes");
+    test_assert(push && command_table_run_actions(table, vm, push, player, "") == 0,
+                "An action returning 0 should leave the command unhandled");
+
+    obj_move(player, elsewhere);
+    test_assert(command_table_run_actions(table, vm, pull, player, "") == 0 && pulls == 1,
+                "Actions out of reach should not run");
+    obj_move(lever, player);
+    test_assert(command_table_run_actions(table, vm, pull, player, "") == 1 && pulls == 2,
+                "Actions of carried objects should run");
+
+    command_table_set_verb(table, "pull");
+    VMValue verb = efun_query_verb(vm, NULL, 0);
+    test_assert(verb.type == VALUE_STRING && strcmp(verb.data.string_value, "pull") == 0,
+                "query_verb() should report the verb");
+    vm_value_release(&verb);
+
+    obj_free(lever);
+    test_assert(command_table_find(table, "pull") == NULL && command_table_find(table, "push") == NULL,
+                "Freeing the owner should drop its verbs");
+
+    obj_free(player);
+    obj_free(room);
+    obj_free(elsewhere);
+    vm_free(vm);
+}
+
+void test_verb_efuns(void) {
+    test_setup("register_verb() and friends manage command paths");
+
+    VirtualMachine *vm = vm_init();
+    VMValue args[2];
+    args[0] = vm_value_create_string("Score");
+    args[1] = vm_value_create_string("/cmds/score");
+
+    VMValue ok = efun_register_verb(vm, args, 2);
+    test_assert(ok.type == VALUE_INT && ok.data.int_value == 1, "register_verb() should succeed");
+
+    VMValue path = efun_query_verb_path(vm, args, 1);
+    test_assert(path.type == VALUE_STRING && strcmp(path.data.string_value, "/cmds/score") == 0,
+                "query_verb_path() should find the lowercased verb");
+    vm_value_release(&path);
+
+    VMValue verbs = efun_query_verbs(vm, NULL, 0);
+    test_assert(verbs.type == VALUE_ARRAY && array_length(verbs.data.array_value) == 1,
+                "query_verbs() should list the verb");
+    vm_value_release(&verbs);
+
+    ok = efun_unregister_verb(vm, args, 1);
+    path = efun_query_verb_path(vm, args, 1);
+    test_assert(ok.data.int_value == 1 && path.type == VALUE_INT,
+                "unregister_verb() should remove it");
+
+    vm_value_release(&args[0]);
+    vm_value_release(&args[1]);
+    vm_free(vm);
+}
+
+int main(void) {
+    printf("========================================\n");
+    printf("Command Table Test Suite\n");
+    printf("========================================\n");
+
+    test_verbs_and_aliases();
+    test_prefixes();
+    test_growth_and_removal();
+    test_paths();
+    test_actions();
+    test_add_action_efun();
+    test_verb_efuns();
+
+    command_table_free(command_table_global());
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
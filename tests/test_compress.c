@@ -0,0 +1,485 @@
+/**
+ * test_compress.c - Output Compression Test Suite
+ *
+ * Tests for the MCCP2 stream and permessage-deflate messages (decoded
+ * with plain zlib, as a client would), compression budgets and staging
+ * limits, inflating client messages, telnet command filtering, extension
+ * negotiation in the WebSocket handshake and RSV1 in the frame parser.
+ */
+
+#include "compress.h"
+#include "telnet.h"
+#include "websocket.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OUT_SIZE (1 << 20)
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static const char *room_text =
+    "The Town Square\r\n"
+    "  Cobbled streets meet here beneath an old clock tower. Merchants hawk\r\n"
+    "their wares from brightly painted stalls, and a fountain splashes idly.\r\n"
+    "  Obvious exits: north, south, east, west\r\n"
+    "A town guard stands here, watching the crowd.\r\n";
+
+static uint8_t out[OUT_SIZE];
+static uint8_t plain[OUT_SIZE];
+
+/* Take everything queued, as the socket would */
+static size_t drain(OutputQueue *queue, uint8_t *dest) {
+    size_t len = 0;
+    for (size_t i = 0; i < queue->count; i++) {
+        OutputSegment *seg = &queue->segments[(queue->head + i) & (queue->capacity - 1)];
+        memcpy(dest + len, seg->block->data + seg->offset, seg->length);
+        len += seg->length;
+    }
+    size_t limit = queue->limit;
+    output_queue_free(queue);
+    output_queue_init(queue, limit);
+    return len;
+}
+
+/* A server frame: header fields and where the payload starts */
+typedef struct {
+    int rsv1;
+    int opcode;
+    const uint8_t *payload;
+    size_t len;
+} Frame;
+
+static size_t read_frame(const uint8_t *data, Frame *frame) {
+    size_t pos = 2;
+    frame->rsv1 = (data[0] & 0x40) != 0;
+    frame->opcode = data[0] & 0x0F;
+    frame->len = data[1] & 0x7F;
+    if (frame->len == 126) {
+        frame->len = ((size_t)data[2] << 8) | data[3];
+        pos = 4;
+    } else if (frame->len == 127) {
+        frame->len = 0;
+        for (int i = 0; i < 8; i++) frame->len = (frame->len << 8) | data[2 + i];
+        pos = 10;
+    }
+    frame->payload = data + pos;
+    return pos + frame->len;
+}
+
+/* Inflate as a client does, sync-flush tail restored; returns the length */
+static long client_inflate(z_stream *zs, const uint8_t *data, size_t len, uint8_t *dest, size_t size,
+                           int add_tail) {
+    static const uint8_t tail[4] = { 0x00, 0x00, 0xff, 0xff };
+    zs->next_out = dest;
+    zs->avail_out = (uInt)size;
+    zs->next_in = (Bytef *)data;
+    zs->avail_in = (uInt)len;
+    int rc = inflate(zs, Z_SYNC_FLUSH);
+    if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) return -1;
+    if (add_tail) {
+        zs->next_in = (Bytef *)tail;
+        zs->avail_in = sizeof(tail);
+        rc = inflate(zs, Z_SYNC_FLUSH);
+        if (rc != Z_OK && rc != Z_BUF_ERROR) return -1;
+    }
+    return (long)(size - zs->avail_out);
+}
+
+static void stage_string(Compressor *comp, const char *text) {
+    compressor_stage(comp, text, strlen(text));
+}
+
+/* ========== Tests ========== */
+
+void test_mccp2_stream(void) {
+    test_setup("MCCP2 output is one zlib stream");
+    OutputQueue queue;
+    output_queue_init(&queue, OUT_SIZE);
+    Compressor *comp = compressor_new(COMPRESS_MCCP2, 15, 0, 0);
+    test_assert(comp != NULL, "The compressor should start");
+
+    size_t expected_len = 0;
+    for (int i = 0; i < 20; i++) {
+        stage_string(comp, room_text);
+        memcpy(plain + expected_len, room_text, strlen(room_text));
+        expected_len += strlen(room_text);
+    }
+    test_assert(compressor_staged(comp) == expected_len, "Everything should be staged");
+    test_assert(compressor_run(comp, &queue, 0) == 0, "A run without a budget should take it all");
+    size_t len = drain(&queue, out);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    inflateInit(&zs);
+    static uint8_t inflated[OUT_SIZE];
+    long inflated_len = client_inflate(&zs, out, len, inflated, sizeof(inflated), 0);
+    test_assert(inflated_len == (long)expected_len && memcmp(inflated, plain, expected_len) == 0,
+                "The flushed stream should inflate to what was staged");
+    test_assert(len * 10 < expected_len, "Repeated room text should compress more than tenfold");
+
+    stage_string(comp, "Goodbye.\r\n");
+    test_assert(compressor_finish(comp, &queue) == 0, "The stream should finish");
+    len = drain(&queue, out);
+    zs.next_in = out;
+    zs.avail_in = (uInt)len;
+    zs.next_out = inflated;
+    zs.avail_out = sizeof(inflated);
+    test_assert(inflate(&zs, Z_SYNC_FLUSH) == Z_STREAM_END &&
+                sizeof(inflated) - zs.avail_out == 10 && memcmp(inflated, "Goodbye.\r\n", 10) == 0,
+                "Finishing should deliver the rest and end the stream");
+    inflateEnd(&zs);
+    compressor_free(comp);
+    output_queue_free(&queue);
+}
+
+void test_ws_context_takeover(void) {
+    test_setup("permessage-deflate messages share a window");
+    OutputQueue queue;
+    output_queue_init(&queue, OUT_SIZE);
+    Compressor *comp = compressor_new(COMPRESS_WS_DEFLATE, 15, 0, 0);
+    for (int i = 0; i < 3; i++) stage_string(comp, room_text);
+    compressor_run(comp, &queue, 0);
+    size_t len = drain(&queue, out);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    inflateInit2(&zs, -15);
+    size_t pos = 0;
+    int frames = 0, intact = 1, rsv1 = 1;
+    size_t sizes[3] = { 0, 0, 0 };
+    while (pos < len && frames < 3) {
+        Frame frame;
+        pos += read_frame(out + pos, &frame);
+        rsv1 &= frame.rsv1 && frame.opcode == WS_OPCODE_TEXT;
+        long n = client_inflate(&zs, frame.payload, frame.len, plain, sizeof(plain), 1);
+        intact &= n == (long)strlen(room_text) && memcmp(plain, room_text, (size_t)n) == 0;
+        sizes[frames++] = frame.len;
+    }
+    test_assert(frames == 3 && pos == len, "Each staged message should be one frame");
+    test_assert(rsv1, "Compressed frames should be text frames with RSV1 set");
+    test_assert(intact, "Each frame should inflate to its message");
+    test_assert(sizes[1] * 4 < sizes[0], "A repeated message should cost a fraction of the first");
+    inflateEnd(&zs);
+    compressor_free(comp);
+    output_queue_free(&queue);
+}
+
+void test_ws_no_context_takeover(void) {
+    test_setup("server_no_context_takeover messages stand alone");
+    OutputQueue queue;
+    output_queue_init(&queue, OUT_SIZE);
+    Compressor *comp = compressor_new(COMPRESS_WS_DEFLATE, 10, 1, 0);
+    for (int i = 0; i < 3; i++) stage_string(comp, room_text);
+    compressor_run(comp, &queue, 0);
+    size_t len = drain(&queue, out);
+
+    size_t pos = 0;
+    int frames = 0, intact = 1;
+    while (pos < len) {
+        Frame frame;
+        pos += read_frame(out + pos, &frame);
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        inflateInit2(&zs, -10);
+        long n = client_inflate(&zs, frame.payload, frame.len, plain, sizeof(plain), 1);
+        intact &= frame.rsv1 && n == (long)strlen(room_text) && memcmp(plain, room_text, (size_t)n) == 0;
+        inflateEnd(&zs);
+        frames++;
+    }
+    test_assert(frames == 3 && intact, "Every frame should inflate with a fresh 1 KB window");
+    compressor_free(comp);
+    output_queue_free(&queue);
+}
+
+void test_short_messages(void) {
+    test_setup("Short WebSocket messages are sent uncompressed");
+    OutputQueue queue;
+    output_queue_init(&queue, OUT_SIZE);
+    Compressor *comp = compressor_new(COMPRESS_WS_DEFLATE, 15, 0, 0);
+    stage_string(comp, "> ");
+    compressor_run(comp, &queue, 0);
+    size_t len = drain(&queue, out);
+    Frame frame;
+    test_assert(read_frame(out, &frame) == len && !frame.rsv1 && frame.opcode == WS_OPCODE_TEXT &&
+                frame.len == 2 && memcmp(frame.payload, "> ", 2) == 0,
+                "A prompt should go out as a plain text frame");
+    test_assert(compressor_stage(comp, "", 0) == 0 && compressor_staged(comp) == 0,
+                "An empty message should stage nothing");
+    compressor_free(comp);
+    output_queue_free(&queue);
+}
+
+void test_budget(void) {
+    test_setup("A run stops at its budget and leaves the rest staged");
+    OutputQueue queue;
+    output_queue_init(&queue, OUT_SIZE);
+    char message[1000];
+    memset(message, 'm', sizeof(message));
+
+    Compressor *comp = compressor_new(COMPRESS_WS_DEFLATE, 15, 0, 0);
+    for (int i = 0; i < 10; i++) compressor_stage(comp, message, sizeof(message));
+    test_assert(compressor_run(comp, &queue, 2500) == 1, "Output should be left over");
+    size_t len = drain(&queue, out);
+    int frames = 0;
+    for (size_t pos = 0; pos < len; frames++) {
+        Frame frame;
+        pos += read_frame(out + pos, &frame);
+    }
+    test_assert(frames == 3, "Messages are whole, so the budget should be overrun by one");
+    test_assert(compressor_run(comp, &queue, 0) == 0 && compressor_staged(comp) == 0,
+                "A later run should take the rest");
+    compressor_free(comp);
+
+    comp = compressor_new(COMPRESS_MCCP2, 15, 0, 0);
+    for (int i = 0; i < 10; i++) compressor_stage(comp, message, sizeof(message));
+    test_assert(compressor_run(comp, &queue, 4000) == 1 && compressor_staged(comp) == 6000 &&
+                comp->bytes_in == 4000, "An MCCP2 run should take exactly its budget");
+    compressor_free(comp);
+    output_queue_free(&queue);
+}
+
+void test_stage_limit(void) {
+    test_setup("Staging past the limit is refused");
+    Compressor *comp = compressor_new(COMPRESS_MCCP2, 15, 0, 100);
+    char data[80];
+    memset(data, 'x', sizeof(data));
+    test_assert(compressor_stage(comp, data, 80) == 0, "Output within the limit should be staged");
+    test_assert(compressor_stage(comp, data, 30) == -1 && compressor_staged(comp) == 80,
+                "Output past the limit should be refused and nothing kept");
+    compressor_free(comp);
+
+    OutputQueue queue;
+    output_queue_init(&queue, 16);
+    comp = compressor_new(COMPRESS_WS_DEFLATE, 15, 0, 0);
+    stage_string(comp, room_text);
+    test_assert(compressor_run(comp, &queue, 0) == -1, "A full queue should fail the run");
+    compressor_free(comp);
+    output_queue_free(&queue);
+}
+
+void test_decompressor(void) {
+    test_setup("Client messages are inflated with context takeover");
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    Decompressor *decomp = decompressor_new(1024);
+
+    int intact = 1;
+    const char *commands[] = { "say hello everyone", "say hello everyone", "look" };
+    for (int i = 0; i < 3; i++) {
+        zs.next_in = (Bytef *)commands[i];
+        zs.avail_in = (uInt)strlen(commands[i]);
+        zs.next_out = out;
+        zs.avail_out = sizeof(out);
+        deflate(&zs, Z_SYNC_FLUSH);
+        size_t len = sizeof(out) - zs.avail_out - 4;
+        long n = decompressor_message(decomp, out, len);
+        intact &= n == (long)strlen(commands[i]) && strcmp((char *)decomp->out, commands[i]) == 0;
+    }
+    test_assert(intact, "Each message should inflate, NUL-terminated");
+
+    memset(plain, 'z', 2000);
+    zs.next_in = plain;
+    zs.avail_in = 2000;
+    zs.next_out = out;
+    zs.avail_out = sizeof(out);
+    deflate(&zs, Z_SYNC_FLUSH);
+    test_assert(decompressor_message(decomp, out, sizeof(out) - zs.avail_out - 4) == -1,
+                "A message inflating past the limit should be refused");
+    deflateEnd(&zs);
+    decompressor_free(decomp);
+
+    decomp = decompressor_new(1024);
+    static const uint8_t garbage[] = { 0xff, 0xff, 0xff, 0xff, 0x12 };
+    test_assert(decompressor_message(decomp, garbage, sizeof(garbage)) == -1,
+                "Corrupt data should be refused");
+    decompressor_free(decomp);
+}
+
+static int option_verb, option_code, option_calls;
+
+static void record_option(void *ctx, int verb, int option) {
+    (void)ctx;
+    option_verb = verb;
+    option_code = option;
+    option_calls++;
+}
+
+void test_telnet_filter(void) {
+    test_setup("Telnet commands are stripped, even split across reads");
+    TelnetState state;
+    telnet_init(&state);
+    char data[64];
+
+    memcpy(data, "lo\xff\xfd\x56ok\n", 8);
+    size_t len = telnet_filter(&state, data, 8, record_option, NULL);
+    test_assert(len == 5 && memcmp(data, "look\n", 5) == 0, "IAC DO 86 should be removed");
+    test_assert(option_calls == 1 && option_verb == TELNET_DO && option_code == TELOPT_COMPRESS2,
+                "The negotiation should be reported");
+
+    memcpy(data, "a\xff", 2);
+    len = telnet_filter(&state, data, 2, record_option, NULL);
+    memcpy(data + len, "\xfe", 1);
+    len += telnet_filter(&state, data + len, 1, record_option, NULL);
+    memcpy(data + len, "\x56z", 2);
+    len += telnet_filter(&state, data + len, 2, record_option, NULL);
+    test_assert(len == 2 && memcmp(data, "az", 2) == 0 && option_calls == 2 && option_verb == TELNET_DONT,
+                "A command split three ways should still be recognised");
+
+    memcpy(data, "x\xff\xffy\xff\xfa\x18\x01\xff\xff\xff\xf0z\xff\xf1!", 16);
+    len = telnet_filter(&state, data, 16, record_option, NULL);
+    test_assert(len == 5 && memcmp(data, "x\xffyz!", 5) == 0 && option_calls == 2,
+                "IAC IAC should be kept once; subnegotiations and NOP dropped");
+}
+
+static const char *upgrade_request =
+    "GET /mud HTTP/1.1\r\n"
+    "Host: localhost:3001\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n";
+
+static int handshake_with(const char *extensions, WSHandshake *handshake) {
+    char request[1024];
+    snprintf(request, sizeof(request), "%s%s%s%s\r\n", upgrade_request,
+             extensions ? "Sec-WebSocket-Extensions: " : "", extensions ? extensions : "",
+             extensions ? "\r\n" : "");
+    return ws_handle_handshake(request, strlen(request), handshake);
+}
+
+void test_negotiation(void) {
+    test_setup("permessage-deflate is negotiated in the handshake");
+    WSHandshake handshake;
+
+    test_assert(handshake_with(NULL, &handshake) == 0 && !handshake.deflate &&
+                strstr(handshake.response, "Extensions") == NULL,
+                "Without an offer nothing should be negotiated");
+    ws_handshake_free(&handshake);
+
+    test_assert(handshake_with("permessage-deflate; client_max_window_bits", &handshake) == 0 &&
+                handshake.deflate && !handshake.deflate_no_context_takeover &&
+                handshake.deflate_window_bits == 15 &&
+                strstr(handshake.response, "Sec-WebSocket-Extensions: permessage-deflate\r\n") != NULL,
+                "A browser's usual offer should be accepted as it is");
+    ws_handshake_free(&handshake);
+
+    test_assert(handshake_with("permessage-deflate; server_max_window_bits=\"10\"; server_no_context_takeover",
+                               &handshake) == 0 &&
+                handshake.deflate && handshake.deflate_no_context_takeover &&
+                handshake.deflate_window_bits == 10 &&
+                strstr(handshake.response, "permessage-deflate; server_no_context_takeover; "
+                                           "server_max_window_bits=10\r\n") != NULL,
+                "Server parameters should be honoured and echoed");
+    ws_handshake_free(&handshake);
+
+    test_assert(handshake_with("x-webkit-deflate-frame, permessage-deflate; server_max_window_bits=8, "
+                               "permessage-deflate; client_no_context_takeover", &handshake) == 0 &&
+                handshake.deflate && handshake.deflate_window_bits == 15,
+                "Offers that cannot be honoured should be passed over for the next");
+    ws_handshake_free(&handshake);
+
+    test_assert(handshake_with("permessage-deflate; mystery=1, permessage-deflate; "
+                               "server_no_context_takeover; server_no_context_takeover", &handshake) == 0 &&
+                !handshake.deflate && strstr(handshake.response, "Extensions") == NULL,
+                "Unknown or repeated parameters should be declined");
+    ws_handshake_free(&handshake);
+}
+
+static int parse_rsv1(int deflate, const uint8_t *stream, size_t len, WSMessage *message, uint16_t *code) {
+    static WSParser parser;
+    ws_parser_init(&parser);
+    parser.deflate = deflate;
+    size_t avail;
+    uint8_t *space = ws_parser_space(&parser, &avail);
+    memcpy(space, stream, len);
+    ws_parser_commit(&parser, len);
+    int result = ws_parser_next(&parser, message);
+    *code = parser.close_code;
+    return result;
+}
+
+void test_parser_rsv1(void) {
+    test_setup("RSV1 marks compressed messages once negotiated");
+    WSMessage message;
+    uint16_t code;
+
+    static const uint8_t compressed[] = { 0xc1, 0x03, 'a', 'b', 'c' };
+    test_assert(parse_rsv1(1, compressed, sizeof(compressed), &message, &code) == 0 &&
+                message.compressed && message.len == 3,
+                "RSV1 on a text frame should mark the message compressed");
+    test_assert(parse_rsv1(0, compressed, sizeof(compressed), &message, &code) == -1 &&
+                code == WS_CLOSE_PROTOCOL_ERROR, "RSV1 without negotiation should be refused");
+
+    static const uint8_t plain_frame[] = { 0x81, 0x02, 'h', 'i' };
+    test_assert(parse_rsv1(1, plain_frame, sizeof(plain_frame), &message, &code) == 0 && !message.compressed,
+                "A frame without RSV1 should stay uncompressed");
+
+    static const uint8_t fragments[] = { 0x41, 0x01, 'a', 0x80, 0x01, 'b' };
+    test_assert(parse_rsv1(1, fragments, sizeof(fragments), &message, &code) == 0 &&
+                message.compressed && message.len == 2,
+                "RSV1 on the first fragment should cover the whole message");
+
+    static const uint8_t bad_continuation[] = { 0x01, 0x01, 'a', 0xc0, 0x01, 'b' };
+    test_assert(parse_rsv1(1, bad_continuation, sizeof(bad_continuation), &message, &code) == -1 &&
+                code == WS_CLOSE_PROTOCOL_ERROR, "RSV1 on a continuation should be refused");
+
+    static const uint8_t bad_ping[] = { 0xc9, 0x00 };
+    test_assert(parse_rsv1(1, bad_ping, sizeof(bad_ping), &message, &code) == -1 &&
+                code == WS_CLOSE_PROTOCOL_ERROR, "RSV1 on a control frame should be refused");
+
+    static const uint8_t rsv2[] = { 0xa1, 0x01, 'a' };
+    test_assert(parse_rsv1(1, rsv2, sizeof(rsv2), &message, &code) == -1,
+                "RSV2 should still be refused");
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("Output Compression Test Suite\n");
+    printf("========================================\n");
+
+    test_mccp2_stream();
+    test_ws_context_takeover();
+    test_ws_no_context_takeover();
+    test_short_messages();
+    test_budget();
+    test_stage_limit();
+    test_decompressor();
+    test_telnet_filter();
+    test_negotiation();
+    test_parser_rsv1();
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
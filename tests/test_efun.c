@@ -637,6 +637,50 @@ void test_efun_file_dir_ops(void) {
 
 /* ========== Main Test Runner ========== */
 
+void test_efun_present_inventory(void) {
+    test_setup("present(), all_inventory() and environment() use the containment tree");
+    
+    VirtualMachine *vm = vm_init();
+    obj_t *room = obj_new("/test/room");
+    obj_t *other = obj_new("/test/other_room");
+    obj_t *sword = obj_new("/test/sword");
+    obj_t *torch = obj_new("/test/torch");
+    obj_set_prop(sword, "id", vm_value_create_string("sword"));
+    
+    VMValue args[2];
+    args[0].type = VALUE_OBJECT;
+    args[1].type = VALUE_OBJECT;
+    args[0].data.object_value = sword;
+    args[1].data.object_value = room;
+    efun_move_object(vm, args, 2);
+    args[0].data.object_value = torch;
+    efun_move_object(vm, args, 2);
+    
+    VMValue inv = efun_all_inventory(vm, &args[1], 1);
+    test_assert(inv.type == VALUE_ARRAY && inv.data.array_value->length == 2 &&
+                inv.data.array_value->elements[0].data.object_value == torch,
+                "all_inventory() should list the room's contents");
+    
+    VMValue id = vm_value_create_string("sword");
+    VMValue present_args[2] = { id, args[1] };
+    VMValue found = efun_present(vm, present_args, 2);
+    test_assert(found.type == VALUE_OBJECT && found.data.object_value == sword, "present() should match by id");
+    
+    present_args[1].data.object_value = other;
+    found = efun_present(vm, present_args, 2);
+    test_assert(found.type == VALUE_NULL, "present() should not look outside the container");
+    
+    VMValue env = efun_environment(vm, args, 1);
+    test_assert(env.type == VALUE_OBJECT && env.data.object_value == room, "environment() should return the room");
+    
+    vm_value_release(&id);
+    obj_free(sword);
+    obj_free(torch);
+    obj_free(other);
+    obj_free(room);
+    vm_free(vm);
+}
+
 int main(void) {
     printf("\n========================================\n");
     printf("AMLP Efun System - Test Suite\n");
@@ -684,6 +728,9 @@ int main(void) {
     test_efun_call_invalid();
     test_efun_call_wrong_args();
     
+    /* Containment Tests */
+    test_efun_present_inventory();
+    
     /* Summary */
     printf("\n========================================\n");
     printf("Test Results: %d/%d passed", test_passed, test_count);
@@ -7,10 +7,17 @@
  */
 
 #include "gc.h"
+#include "vm.h"
+#include "array.h"
+#include "mapping.h"
+#include "object.h"
+#include "efun.h"
+#include "slab.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 /* ========== Test Framework ========== */
 
@@ -418,6 +425,299 @@ void test_gc_find_nonexistent(void) {
     gc_free(gc);
 }
 
+/* ========== TESTS: Pointer Index ========== */
+
+void test_gc_index_remove_middle(void) {
+    test_setup("Release objects out of order keeps the index consistent");
+    
+    GC *gc = gc_init();
+    gc_set_auto_collect(gc, 0);
+    
+    enum { COUNT = 2000 };
+    void **ptrs = (void **)malloc(sizeof(void *) * COUNT);
+    for (int i = 0; i < COUNT; i++) {
+        ptrs[i] = gc_alloc(gc, 16, GC_TYPE_GENERIC);
+    }
+    
+    /* Release every third object, starting in the middle of the array */
+    for (int i = 1; i < COUNT; i += 3) {
+        gc_release(gc, ptrs[i]);
+    }
+    
+    int consistent = 1;
+    for (int i = 0; i < COUNT; i++) {
+        int expected = (i % 3) != 1;
+        if (gc_is_tracked(gc, ptrs[i]) != expected) consistent = 0;
+    }
+    for (int i = 0; i < gc->object_count; i++) {
+        if (gc->objects[i]->index != i) consistent = 0;
+    }
+    
+    test_assert(gc->object_count == COUNT - (COUNT + 1) / 3, "Should track the unreleased objects");
+    test_assert(consistent, "Lookups and array indices should match after removal");
+    test_assert(gc_get_ref_count(gc, ptrs[COUNT - 2]) == 1, "Surviving objects should keep their ref count");
+    
+    free(ptrs);
+    gc_free(gc);
+}
+
+void test_gc_bench_alloc_release(void) {
+    test_setup("Benchmark: allocate and release 1M objects");
+    
+    GC *gc = gc_init();
+    gc_set_auto_collect(gc, 0);
+    
+    enum { TOTAL = 1000000, LIVE = 50000 };
+    void **ptrs = (void **)malloc(sizeof(void *) * LIVE);
+    int failures = 0;
+    
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    /* Keep LIVE objects tracked so every lookup runs against a full registry */
+    for (int done = 0; done < TOTAL; done += LIVE) {
+        for (int i = 0; i < LIVE; i++) {
+            ptrs[i] = gc_alloc(gc, 32, GC_TYPE_GENERIC);
+            if (!ptrs[i]) failures++;
+        }
+        for (int i = 0; i < LIVE; i++) {
+            if (gc_retain(gc, ptrs[i]) != 2) failures++;
+        }
+        for (int i = LIVE - 1; i >= 0; i--) {
+            gc_release(gc, ptrs[i]);
+            if (gc_release(gc, ptrs[i]) != -1) failures++;
+        }
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) +
+                     (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("  %d objects (%d live) in %.3f s, %.0f ns per object\n",
+           TOTAL, LIVE, seconds, seconds * 1e9 / TOTAL);
+    
+    test_assert(failures == 0, "Every alloc, retain and release should succeed");
+    test_assert(gc->object_count == 0, "All objects should be released");
+    test_assert(gc_get_allocated_bytes(gc) == 0, "All bytes should be freed");
+    
+    free(ptrs);
+    gc_free(gc);
+}
+
+/* ========== TESTS: Tracing Collection ========== */
+
+static VMValue array_value(array_t *arr) {
+    VMValue v;
+    v.type = VALUE_ARRAY;
+    v.data.array_value = arr;
+    return v;
+}
+
+static VMValue mapping_value(mapping_t *map) {
+    VMValue v;
+    v.type = VALUE_MAPPING;
+    v.data.mapping_value = map;
+    return v;
+}
+
+void test_gc_trace_cycles(void) {
+    test_setup("Tracing collection frees unreachable cycles and keeps rooted data");
+    
+    VirtualMachine *vm = vm_init();
+    GC *gc = vm->gc;
+    
+    /* Rooted: global 0 -> array -> mapping -> string */
+    array_t *kept = array_new(gc, 2);
+    mapping_t *inner = mapping_new(gc, 4);
+    mapping_set(inner, "name", vm_value_create_string("kept"));
+    array_push(kept, mapping_value(inner));
+    vm->global_variables[0] = array_value(kept);
+    vm->global_count = 1;
+    
+    /* Unreachable: room <-> inventory cycle */
+    mapping_t *room = mapping_new(gc, 4);
+    array_t *inventory = array_new(gc, 2);
+    mapping_set(room, "inventory", array_value(inventory));
+    array_push(inventory, mapping_value(room));
+    array_push(inventory, vm_value_create_string("sword"));
+    
+    int freed = gc_collect_full(gc);
+    
+    test_assert(freed == 2, "Both halves of the cycle should be freed");
+    test_assert(!gc_is_tracked(gc, room) && !gc_is_tracked(gc, inventory),
+                "Cycle members should no longer be tracked");
+    test_assert(gc_is_tracked(gc, kept) && gc_is_tracked(gc, inner),
+                "Data reachable from a global should survive");
+    VMValue name = mapping_get(inner, "name");
+    test_assert(name.type == VALUE_STRING && strcmp(name.data.string_value, "kept") == 0,
+                "Surviving mapping should keep its contents");
+    
+    vm_free(vm);
+}
+
+void test_gc_trace_object_roots(void) {
+    test_setup("Object properties are collector roots");
+    
+    VirtualMachine *vm = vm_init();
+    GC *gc = vm->gc;
+    ObjManager *mgr = efun_object_manager();
+    
+    obj_t *player = obj_new("/test/gc_player");
+    obj_manager_register(mgr, player);
+    
+    array_t *inventory = array_new(gc, 2);
+    obj_set_prop(player, "inventory", array_value(inventory));
+    array_t *garbage = array_new(gc, 2);
+    
+    gc_collect_full(gc);
+    
+    test_assert(gc_is_tracked(gc, inventory), "Array held by an object property should survive");
+    test_assert(!gc_is_tracked(gc, garbage), "Unreferenced array should be freed");
+    
+    obj_manager_unregister(mgr, player);
+    obj_free(player);
+    vm_free(vm);
+}
+
+void test_gc_overwrite_shared_container(void) {
+    test_setup("Overwriting a shared container leaves it to the collector");
+    
+    VirtualMachine *vm = vm_init();
+    GC *gc = vm->gc;
+    
+    /* One mapping reachable from an array and from another mapping */
+    array_t *list = array_new(gc, 2);
+    mapping_t *index = mapping_new(gc, 4);
+    mapping_t *shared = mapping_new(gc, 4);
+    mapping_set(shared, "name", vm_value_create_string("shared"));
+    array_push(list, mapping_value(shared));
+    mapping_set(index, "first", mapping_value(shared));
+    vm->global_variables[0] = array_value(list);
+    vm->global_variables[1] = mapping_value(index);
+    vm->global_count = 2;
+    
+    array_set(list, 0, vm_value_create_int(0));
+    VMValue name = mapping_get(shared, "name");
+    test_assert(gc_is_tracked(gc, shared) && name.type == VALUE_STRING &&
+                strcmp(name.data.string_value, "shared") == 0,
+                "Overwritten element should stay intact while a mapping holds it");
+    
+    gc_collect_full(gc);
+    test_assert(gc_is_tracked(gc, shared), "Container still in the mapping should survive collection");
+    
+    mapping_set(index, "first", vm_value_create_int(0));
+    gc_collect_full(gc);
+    test_assert(!gc_is_tracked(gc, shared), "Container no value reaches should be collected");
+    
+    vm_free(vm);
+}
+
+void test_gc_incremental_barrier(void) {
+    test_setup("Incremental marking keeps values moved into traced containers");
+    
+    enum { CHAIN = 4000 };
+    VirtualMachine *vm = vm_init();
+    GC *gc = vm->gc;
+    gc_set_slice_budget(gc, 1);
+    
+    /* global 1 is traced first and ends up black; global 0 is a long chain */
+    array_t *black = array_new(gc, 2);
+    array_t *head = array_new(gc, 1);
+    array_t *tail = head;
+    for (int i = 0; i < CHAIN; i++) {
+        array_t *next = array_new(gc, 1);
+        array_push(tail, array_value(next));
+        tail = next;
+    }
+    array_t *moved = array_new(gc, 1);
+    array_push(tail, array_value(moved));
+    vm->global_variables[0] = array_value(head);
+    vm->global_variables[1] = array_value(black);
+    vm->global_count = 2;
+    
+    /* Unreachable garbage so the sweep has work */
+    for (int i = 0; i < 100; i++) {
+        array_new(gc, 1);
+    }
+    
+    gc->allocation_count = gc->collect_threshold;
+    int busy = gc_step(gc);
+    int was_marking = busy && gc->phase == GC_PHASE_MARK;
+    
+    /* Mutator between slices: move the chain's last link into the black array */
+    VMValue link;
+    array_pop(tail, &link);
+    array_push(black, link);
+    
+    int slices = 1;
+    while (gc_step(gc)) {
+        slices++;
+    }
+    
+    unsigned long histogram_total = 0;
+    for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+        histogram_total += gc->pause_histogram[i];
+    }
+    printf("  %d slices, max pause %ld us\n", slices, gc->pause_max_usec);
+    
+    test_assert(was_marking, "First slice should stop inside the mark phase");
+    test_assert(slices > 1, "Cycle should span several slices");
+    test_assert(gc_is_tracked(gc, moved), "Value stored during marking should survive");
+    test_assert(gc->last_cycle_freed == 100, "Only the garbage arrays should be freed");
+    test_assert(histogram_total == gc->slice_count && gc->slice_count >= (unsigned long)slices,
+                "Every slice should be recorded in the pause histogram");
+    
+    VMValue stats = efun_debug_mem_stats(vm, NULL, 0);
+    test_assert(stats.type == VALUE_STRING && strstr(stats.data.string_value, "gc_pause_histogram") != NULL,
+                "debug_mem_stats should report collector pauses");
+    vm_value_release(&stats);
+    
+    vm_free(vm);
+}
+
+void test_gc_slab_reuse(void) {
+    test_setup("Slab blocks are reused after free");
+    
+    SlabStats before, after;
+    slab_get_stats(&before);
+    
+    void *a = slab_alloc(40);
+    void *b = slab_alloc(48);
+    test_assert(a != NULL && b != NULL && a != b, "Same-class blocks should be distinct");
+    test_assert(((size_t)a % 16) == 0 && ((size_t)b % 16) == 0, "Blocks should be 16-byte aligned");
+    
+    slab_free(a, 40);
+    void *c = slab_alloc(33);
+    
+    void *big = slab_alloc(SLAB_MAX_SIZE + 1);
+    slab_free(big, SLAB_MAX_SIZE + 1);
+    slab_get_stats(&after);
+    
+#ifndef AMLP_NO_SLAB
+    test_assert(c == a, "Freed block should be handed out again");
+    test_assert(after.classes[2].size == 48 &&
+                after.classes[2].allocs - before.classes[2].allocs == 3 &&
+                after.classes[2].frees - before.classes[2].frees == 1,
+                "Per-class counters should track the 48-byte class");
+#endif
+    test_assert(after.large_allocs - before.large_allocs >= 1 &&
+                after.large_frees - before.large_frees >= 1,
+                "Oversized requests should go to malloc");
+    
+    slab_free(b, 48);
+    slab_free(c, 33);
+    
+    /* GC header and payload share one block, and strings come from the slab */
+    GC *gc = gc_init();
+    void *payload = gc_alloc(gc, 24, GC_TYPE_ARRAY);
+    GCObject *obj = gc_find_object(gc, payload);
+    test_assert(obj != NULL && obj->inline_payload &&
+                (size_t)((char *)payload - (char *)obj) < sizeof(GCObject) + 16,
+                "gc_alloc payload should follow its header");
+    gc_release(gc, payload);
+    test_assert(gc_get_object_count(gc) == 0, "Released slab object should be untracked");
+    gc_free(gc);
+}
+
 /* ========== Main Test Runner ========== */
 
 int main(void) {
@@ -462,6 +762,19 @@ int main(void) {
     test_gc_null_pointer();
     test_gc_find_nonexistent();
     
+    /* Pointer Index Tests */
+    test_gc_index_remove_middle();
+    test_gc_bench_alloc_release();
+    
+    /* Tracing Collection Tests */
+    test_gc_trace_cycles();
+    test_gc_trace_object_roots();
+    test_gc_overwrite_shared_container();
+    test_gc_incremental_barrier();
+    
+    /* Slab Allocator Tests */
+    test_gc_slab_reuse();
+    
     /* Summary */
     printf("\n========================================\n");
     printf("Test Results: %d/%d passed", test_passed, test_count);
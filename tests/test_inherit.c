@@ -0,0 +1,327 @@
+/**
+ * test_inherit.c - Inheritance Linking Test Suite
+ *
+ * Tests for programs linked to the programs they inherit: inherited
+ * variables and functions, overriding through the flattened table,
+ * ::name() calls, multiple inheritance, inherit path spellings, cycles,
+ * and relinking when a parent is recompiled. Sources are written to a
+ * scratch mudlib directory named by AMLP_MUDLIB.
+ */
+
+#include "object_program.h"
+#include "compiler.h"
+#include "object.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static char mudlib[64];
+
+static const char *base_src =
+    "int hp;\n"
+    "string title;\n"
+    "void set_hp(int n) { hp = n; }\n"
+    "int query_hp() { return hp; }\n"
+    "string kind() { return \"base\"; }\n"
+    "string describe() { return kind(); }\n";
+
+static const char *npc_src =
+    "inherit \"/std/base\";\n"
+    "int armor;\n"
+    "string kind() { return \"npc\"; }\n"
+    "string base_kind() { return ::kind(); }\n"
+    "void heal() { hp = 100; }\n"
+    "void set_armor(int a) { armor = a; }\n"
+    "int query_armor() { return armor; }\n";
+
+static const char *guard_src =
+    "inherit \"std/npc.c\";\n"
+    "string kind() { return \"guard\"; }\n"
+    "string npc_kind() { return ::kind(); }\n";
+
+static const char *named_src =
+    "string name;\n"
+    "void set_name(string s) { name = s; }\n"
+    "string query_name() { return name; }\n"
+    "string kind() { return \"named\"; }\n"
+    "string label() { return kind(); }\n";
+
+static const char *hero_src =
+    "inherit \"/std/npc\";\n"
+    "inherit \"/lib/std/named\";\n"
+    "int level;\n"
+    "void set_level(int n) { level = n; }\n"
+    "int query_level() { return level; }\n";
+
+static void write_file(const char *name, const char *src, time_t mtime) {
+    char fs_path[128];
+    snprintf(fs_path, sizeof(fs_path), "%s/std/%s.lpc", mudlib, name);
+    FILE *f = fopen(fs_path, "w");
+    fputs(src, f);
+    fclose(f);
+    if (mtime) {
+        struct utimbuf times = { mtime, mtime };
+        utime(fs_path, &times);
+    }
+}
+
+static ObjProgram *load(VirtualMachine *vm, const char *name) {
+    char path[64];
+    char fs_path[128];
+    snprintf(path, sizeof(path), "/std/%s", name);
+    snprintf(fs_path, sizeof(fs_path), "%s/std/%s.lpc", mudlib, name);
+    return obj_program_load(vm, path, fs_path);
+}
+
+static obj_t *new_instance(ObjProgram *program) {
+    obj_t *obj = obj_new(program->path);
+    if (obj && obj_program_attach(obj, program) != 0) {
+        obj_free(obj);
+        return NULL;
+    }
+    return obj;
+}
+
+static long call_int(VirtualMachine *vm, obj_t *obj, const char *method) {
+    VMValue result = obj_call_method(vm, obj, method, NULL, 0);
+    return result.type == VALUE_INT ? result.data.int_value : -999;
+}
+
+/* Result of a string method, or "" */
+static const char *call_str(VirtualMachine *vm, obj_t *obj, const char *method) {
+    static char buf[64];
+    VMValue result = obj_call_method(vm, obj, method, NULL, 0);
+    snprintf(buf, sizeof(buf), "%s",
+             result.type == VALUE_STRING && result.data.string_value ? result.data.string_value : "");
+    vm_value_release(&result);
+    return buf;
+}
+
+static void call_with(VirtualMachine *vm, obj_t *obj, const char *method, VMValue arg) {
+    VMValue result = obj_call_method(vm, obj, method, &arg, 1);
+    vm_value_release(&result);
+    vm_value_release(&arg);
+}
+
+/* The call site in a program's function, or NULL */
+static VMCallSite *find_site(ObjProgram *program, const char *function, const char *callee) {
+    for (int i = 0; i < program->function_count; i++) {
+        VMFunction *func = program->functions[i];
+        if (strcmp(func->name, function) != 0) continue;
+        for (int s = 0; s < func->call_site_count; s++) {
+            if (func->call_sites[s].name && strcmp(func->call_sites[s].name, callee) == 0) {
+                return &func->call_sites[s];
+            }
+        }
+    }
+    return NULL;
+}
+
+/* ========== Tests ========== */
+
+void test_inherited_members(void) {
+    test_setup("A program gets its parent's variables and functions");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *base = load(vm, "base");
+    ObjProgram *npc = load(vm, "npc");
+    test_assert(base && npc, "Both programs should load");
+    test_assert(npc && npc->inherit_count == 1 && npc->inherits[0] == base,
+                "npc should hold the cached base program");
+    test_assert(npc && npc->variable_count == 3 && obj_program_find_variable(npc, "armor") == 2,
+                "Inherited variables should come first");
+    test_assert(npc && npc->function_count == base->function_count + 5 &&
+                npc->functions[0] == base->functions[0],
+                "The first inherit's functions should be shared, not copied");
+
+    obj_t *obj = new_instance(npc);
+    call_with(vm, obj, "set_hp", vm_value_create_int(7));
+    call_with(vm, obj, "set_armor", vm_value_create_int(3));
+    test_assert(call_int(vm, obj, "query_hp") == 7 && call_int(vm, obj, "query_armor") == 3,
+                "Inherited and own functions should use separate slots");
+    call_int(vm, obj, "heal");
+    test_assert(call_int(vm, obj, "query_hp") == 100, "Own code should store to an inherited variable");
+
+    obj_free(obj);
+    vm_free(vm);
+}
+
+void test_overrides(void) {
+    test_setup("Calls dispatch through the table to the most derived definition");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *base = load(vm, "base");
+    ObjProgram *npc = load(vm, "npc");
+    ObjProgram *guard = load(vm, "guard");
+    test_assert(guard != NULL, "guard should load through a relative .c inherit");
+
+    VMCallSite *site = base ? find_site(base, "describe", "kind") : NULL;
+    test_assert(site && site->link == VM_CALL_VIRTUAL, "A call to a program function should be virtual");
+    site = npc ? find_site(npc, "base_kind", "::kind") : NULL;
+    test_assert(site && site->link == VM_CALL_LOCAL && site->target == base->functions[site->slot]->index,
+                "::kind() should be linked straight to the inherited function");
+
+    obj_t *b = new_instance(base);
+    obj_t *n = new_instance(npc);
+    obj_t *g = guard ? new_instance(guard) : NULL;
+    test_assert(strcmp(call_str(vm, b, "describe"), "base") == 0, "base should describe itself");
+    test_assert(strcmp(call_str(vm, n, "describe"), "npc") == 0,
+                "Inherited code should call the override");
+    test_assert(g && strcmp(call_str(vm, g, "describe"), "guard") == 0,
+                "Two levels down the override should still win");
+    test_assert(strcmp(call_str(vm, n, "base_kind"), "base") == 0, "::kind() should run the parent's");
+    test_assert(g && strcmp(call_str(vm, g, "npc_kind"), "npc") == 0 &&
+                strcmp(call_str(vm, g, "base_kind"), "base") == 0,
+                "Each ::kind() should run the definition its own program inherits");
+
+    obj_free(b);
+    obj_free(n);
+    obj_free(g);
+    vm_free(vm);
+}
+
+void test_multiple_inherits(void) {
+    test_setup("A second inherit is copied to its place in the table");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *npc = load(vm, "npc");
+    ObjProgram *named = load(vm, "named");
+    ObjProgram *hero = load(vm, "hero");
+    test_assert(hero && hero->inherit_count == 2 && hero->inherits[1] == named,
+                "/lib/std/named should name the same program as /std/named");
+    test_assert(hero && hero->variable_count == 5 && obj_program_find_variable(hero, "name") == 3 &&
+                obj_program_find_variable(hero, "level") == 4,
+                "Variables should be laid out in inherit order, then our own");
+    test_assert(hero && hero->functions[npc->function_count] != named->functions[0],
+                "The second block should run copies");
+
+    obj_t *obj = hero ? new_instance(hero) : NULL;
+    call_with(vm, obj, "set_hp", vm_value_create_int(5));
+    call_with(vm, obj, "set_name", vm_value_create_string("Tala"));
+    call_with(vm, obj, "set_level", vm_value_create_int(3));
+    test_assert(call_int(vm, obj, "query_hp") == 5 && strcmp(call_str(vm, obj, "query_name"), "Tala") == 0 &&
+                call_int(vm, obj, "query_level") == 3,
+                "Each block should address its own variables");
+    test_assert(strcmp(call_str(vm, obj, "kind"), "npc") == 0 && strcmp(call_str(vm, obj, "label"), "npc") == 0,
+                "The first inherit defining a name should win, for the second's code too");
+
+    obj_t *plain = new_instance(named);
+    call_with(vm, plain, "set_name", vm_value_create_string("Kell"));
+    test_assert(strcmp(call_str(vm, plain, "label"), "named") == 0 &&
+                strcmp(call_str(vm, plain, "query_name"), "Kell") == 0,
+                "The original program should be untouched by the copy");
+
+    obj_free(obj);
+    obj_free(plain);
+    vm_free(vm);
+}
+
+void test_bad_inherits(void) {
+    test_setup("Missing and circular inherits are linked without");
+    VirtualMachine *vm = vm_init();
+    write_file("loop_a", "inherit \"/std/loop_b\";\nint a() { return 1; }\n", 0);
+    write_file("loop_b", "inherit \"/std/loop_a\";\nint b() { return 2; }\n", 0);
+    write_file("orphan", "inherit \"/std/nowhere\";\nint c() { return 3; }\n", 0);
+
+    ObjProgram *loop_a = load(vm, "loop_a");
+    ObjProgram *loop_b = obj_program_find(vm, "/std/loop_b");
+    test_assert(loop_a && loop_a->inherit_count == 1 && loop_a->inherits[0] == loop_b,
+                "The outer file of a cycle should keep its inherit");
+    test_assert(loop_b && loop_b->inherit_count == 0, "The inherit closing the cycle should be dropped");
+
+    ObjProgram *orphan = load(vm, "orphan");
+    obj_t *obj = orphan ? new_instance(orphan) : NULL;
+    test_assert(orphan && orphan->inherit_count == 0, "A missing parent should be left out");
+    test_assert(obj && call_int(vm, obj, "c") == 3, "The child should still run its own code");
+    test_assert(vm->program_cache->linking_depth == 0, "Loading should unwind the inherit stack");
+    obj_free(obj);
+    vm_free(vm);
+}
+
+void test_parent_recompiled(void) {
+    test_setup("A child is relinked once its parent is recompiled");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *npc = load(vm, "npc");
+    obj_t *old = new_instance(npc);
+    test_assert(load(vm, "npc") == npc, "An unchanged chain should hit the cache");
+
+    write_file("base", "int hp;\nstring title;\nstring kind() { return \"changed\"; }\n"
+                       "string describe() { return kind(); }\n", npc->inherits[0]->mtime + 10);
+    load(vm, "base");
+    ObjProgram *relinked = load(vm, "npc");
+    obj_t *fresh = relinked ? new_instance(relinked) : NULL;
+    test_assert(relinked && relinked != npc, "A stale parent should relink the child");
+    test_assert(fresh && strcmp(call_str(vm, fresh, "base_kind"), "changed") == 0,
+                "New objects should run the new parent");
+    test_assert(strcmp(call_str(vm, old, "base_kind"), "base") == 0, "Old objects should keep the old one");
+
+    obj_free(old);
+    obj_free(fresh);
+    write_file("base", base_src, 0);
+    vm_free(vm);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("Inheritance Linking Test Suite\n");
+    printf("========================================\n");
+
+    snprintf(mudlib, sizeof(mudlib), "/tmp/amlp_inherit_test_%d", (int)getpid());
+    char std_dir[96];
+    snprintf(std_dir, sizeof(std_dir), "%s/std", mudlib);
+    mkdir(mudlib, 0755);
+    mkdir(std_dir, 0755);
+    setenv("AMLP_MUDLIB", mudlib, 1);
+
+    write_file("base", base_src, 0);
+    write_file("npc", npc_src, 0);
+    write_file("guard", guard_src, 0);
+    write_file("named", named_src, 0);
+    write_file("hero", hero_src, 0);
+
+    test_inherited_members();
+    test_overrides();
+    test_multiple_inherits();
+    test_bad_inherits();
+    test_parent_recompiled();
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", mudlib);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", mudlib);
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
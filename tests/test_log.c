@@ -0,0 +1,239 @@
+/**
+ * test_log.c - Logging Test Suite
+ *
+ * Tests for category and level names, per-category levels, the macros'
+ * level check, and the ring-buffer writer with one and several
+ * producing threads. Output is captured by pointing stderr at a file.
+ */
+
+#include "log.h"
+#include "efun.h"
+#include "vm.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PRODUCERS 4
+#define PRODUCER_MESSAGES 200
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static int saved_stderr = -1;
+static FILE *capture_file = NULL;
+
+/* Send stderr to a temporary file until capture_end() */
+static void capture_begin(void) {
+    fflush(stderr);
+    capture_file = tmpfile();
+    saved_stderr = dup(STDERR_FILENO);
+    dup2(fileno(capture_file), STDERR_FILENO);
+}
+
+/* Restore stderr and return what was written, or NULL; caller frees */
+static char *capture_end(void) {
+    fflush(stderr);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stderr);
+
+    long size = ftell(capture_file);
+    if (size < 0) size = 0;
+    char *text = malloc((size_t)size + 1);
+    if (text) {
+        rewind(capture_file);
+        size_t n = fread(text, 1, (size_t)size, capture_file);
+        text[n] = '\0';
+    }
+    fclose(capture_file);
+    return text;
+}
+
+static int count_lines(const char *text) {
+    int lines = 0;
+    for (const char *p = text; *p; p++) lines += *p == '\n';
+    return lines;
+}
+
+static int evaluated = 0;
+
+static int side_effect(void) {
+    return ++evaluated;
+}
+
+static void *produce(void *arg) {
+    int id = (int)(long)arg;
+    for (int i = 0; i < PRODUCER_MESSAGES; i++) {
+        LOG_AT(LOG_VM, LOG_LEVEL_INFO, "[Test]", "producer %d message %d", id, i);
+    }
+    return NULL;
+}
+
+/* ========== Tests ========== */
+
+void test_names(void) {
+    test_setup("Category and level names");
+
+    test_assert(log_category_by_name("vm") == LOG_VM, "vm should name LOG_VM");
+    test_assert(log_category_by_name("SERVER") == LOG_SERVER, "names should ignore case");
+    test_assert(log_category_by_name("nonsense") == -1, "unknown category should be -1");
+    test_assert(strcmp(log_category_name(LOG_EFUN), "efun") == 0, "LOG_EFUN should be named efun");
+    test_assert(log_level_by_name("debug") == LOG_LEVEL_DEBUG, "debug should name LOG_LEVEL_DEBUG");
+    test_assert(log_level_by_name("off") == LOG_LEVEL_OFF, "off should name LOG_LEVEL_OFF");
+    test_assert(log_level_by_name("loud") == -1, "unknown level should be -1");
+}
+
+void test_levels(void) {
+    test_setup("Setting levels");
+
+    log_set_level(LOG_CATEGORY_COUNT, LOG_LEVEL_INFO);
+    test_assert(log_set_level(LOG_VM, LOG_LEVEL_DEBUG) == LOG_LEVEL_INFO,
+                "set_level should return the previous level");
+    test_assert(LOG_ENABLED(LOG_VM, LOG_LEVEL_DEBUG), "vm debug should be enabled");
+    test_assert(!LOG_ENABLED(LOG_EFUN, LOG_LEVEL_DEBUG), "efun debug should stay disabled");
+    test_assert(log_set_level(LOG_VM, LOG_LEVEL_DEBUG + 1) == -1, "out-of-range level should be refused");
+    test_assert(log_set_level(-1, LOG_LEVEL_INFO) == -1, "bad category should be refused");
+
+    log_set_level(LOG_CATEGORY_COUNT, LOG_LEVEL_ERROR);
+    int all_error = 1;
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++) all_error &= log_levels[i] == LOG_LEVEL_ERROR;
+    test_assert(all_error, "LOG_CATEGORY_COUNT should set every category");
+    log_set_level(LOG_CATEGORY_COUNT, LOG_LEVEL_INFO);
+}
+
+void test_disabled_messages(void) {
+    test_setup("Disabled messages are not formatted");
+
+    evaluated = 0;
+    log_set_level(LOG_PARAM, LOG_LEVEL_WARN);
+    capture_begin();
+    LOG_AT(LOG_PARAM, LOG_LEVEL_DEBUG, "[Test]", "hidden %d", side_effect());
+    LOG_AT(LOG_PARAM, LOG_LEVEL_WARN, "[Test]", "shown %d", side_effect());
+    char *out = capture_end();
+
+    test_assert(evaluated == 1, "arguments of a disabled message should not be evaluated");
+    test_assert(out && strcmp(out, "[Test] shown 1\n") == 0, "enabled message should be written with its tag");
+    free(out);
+    log_set_level(LOG_PARAM, LOG_LEVEL_INFO);
+}
+
+void test_writer(void) {
+    test_setup("Background writer keeps order");
+
+    capture_begin();
+    test_assert(log_start_writer() == 0, "writer should start");
+    for (int i = 0; i < 300; i++) {
+        LOG_AT(LOG_GENERAL, LOG_LEVEL_INFO, "[Test]", "line %d", i);
+    }
+    log_shutdown();
+    char *out = capture_end();
+
+    int lines = out ? count_lines(out) : 0;
+    test_assert(lines + (int)log_dropped() == 300, "every message should be written or counted as dropped");
+    test_assert(out && strncmp(out, "[Test] line 0\n", 14) == 0, "first message should come first");
+
+    int ordered = 1, last = -1;
+    for (char *p = out; p && (p = strstr(p, "line ")); p += 5) {
+        int n = atoi(p + 5);
+        if (n <= last) ordered = 0;
+        last = n;
+    }
+    test_assert(ordered, "messages should be written in order");
+    free(out);
+}
+
+void test_concurrent_producers(void) {
+    test_setup("Several producing threads");
+
+    unsigned long dropped_before = log_dropped();
+    capture_begin();
+    log_start_writer();
+    pthread_t threads[PRODUCERS];
+    for (long i = 0; i < PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, produce, (void *)i);
+    }
+    for (int i = 0; i < PRODUCERS; i++) pthread_join(threads[i], NULL);
+    log_shutdown();
+    char *out = capture_end();
+
+    int lines = 0;
+    for (char *p = out; p && (p = strstr(p, "[Test] producer ")); p++) lines++;
+    unsigned long dropped = log_dropped() - dropped_before;
+    test_assert(lines + (int)dropped == PRODUCERS * PRODUCER_MESSAGES,
+                "each message should be written once or counted as dropped");
+    test_assert(dropped > 0 || (out && strstr(out, "[Test] producer 3 message 199") != NULL),
+                "last message of a producer should arrive");
+    free(out);
+}
+
+void test_efuns(void) {
+    test_setup("set_log_level() and query_log_level() efuns");
+
+    VMValue args[2];
+    args[0] = vm_value_create_string("compiler");
+    args[1] = vm_value_create_int(LOG_LEVEL_DEBUG);
+
+    VMValue previous = efun_set_log_level(NULL, args, 2);
+    VMValue now = efun_query_log_level(NULL, args, 1);
+    test_assert(previous.data.int_value == LOG_LEVEL_INFO && now.data.int_value == LOG_LEVEL_DEBUG,
+                "set_log_level() should change the category outside a player command");
+
+    vm_value_release(&args[0]);
+    args[0] = vm_value_create_string("bogus");
+    previous = efun_set_log_level(NULL, args, 2);
+    test_assert(previous.data.int_value == -1, "unknown category should be refused");
+
+    vm_value_release(&args[0]);
+    args[0] = vm_value_create_string("all");
+    efun_set_log_level(NULL, args, 2);
+    now = efun_query_log_level(NULL, args, 1);
+    test_assert(log_levels[LOG_SERVER] == LOG_LEVEL_DEBUG && now.data.int_value == -1,
+                "all should set every category but has no single level");
+
+    vm_value_release(&args[0]);
+    log_set_level(LOG_CATEGORY_COUNT, LOG_LEVEL_INFO);
+}
+
+int main(void) {
+    printf("========================================\n");
+    printf("Logging Test Suite\n");
+    printf("========================================\n");
+
+    test_names();
+    test_levels();
+    test_disabled_messages();
+    test_writer();
+    test_concurrent_producers();
+    test_efuns();
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
@@ -516,6 +516,263 @@ void test_mapping_multiple_gc_mappings(void) {
     gc_free(gc);
 }
 
+void test_mapping_interned_keys(void) {
+    test_setup("Mapping keys are interned and shared");
+    
+    GC *gc = gc_init();
+    mapping_t *map = mapping_new(gc, 8);
+    int interned_before = vm_string_intern_count();
+    
+    mapping_set(map, "short", vm_value_create_int(1));
+    VMValue literal = vm_value_create_interned("short");
+    VMValue computed = vm_value_create_string("short");
+    
+    test_assert(mapping_lookup(map, literal).data.int_value == 1, "Interned key should match by pointer");
+    test_assert(mapping_lookup(map, computed).data.int_value == 1, "Uninterned key should match by contents");
+    
+    mapping_store(map, computed, vm_value_create_int(2));
+    test_assert(mapping_size(map) == 1 && mapping_get(map, "short").data.int_value == 2,
+                "Storing an equal key should update the entry");
+    
+    array_t *keys = mapping_keys(map);
+    test_assert(keys && keys->elements[0].data.string_value == literal.data.string_value,
+                "keys() should share the interned key");
+    array_free(keys);
+    
+    vm_value_release(&literal);
+    vm_value_release(&computed);
+    mapping_free(map);
+    test_assert(vm_string_intern_count() == interned_before,
+                "Releasing the last reference should drop the key from the intern table");
+    gc_free(gc);
+}
+
+/* ========== TESTS: Typed Keys ========== */
+
+static VMValue object_key(void *ptr) {
+    VMValue v;
+    v.type = VALUE_OBJECT;
+    v.data.object_value = ptr;
+    return v;
+}
+
+void test_mapping_typed_keys(void) {
+    test_setup("Int, float, object and string keys are distinct");
+    
+    GC *gc = gc_init();
+    mapping_t *map = mapping_new(gc, 8);
+    int token_a = 0, token_b = 0;
+    VMValue one_str = vm_value_create_string("1");
+    
+    mapping_store(map, vm_value_create_int(1), vm_value_create_int(10));
+    mapping_store(map, vm_value_create_float(1.0), vm_value_create_int(20));
+    mapping_store(map, one_str, vm_value_create_int(30));
+    mapping_store(map, object_key(&token_a), vm_value_create_int(40));
+    mapping_store(map, vm_value_create_int(-7), vm_value_create_int(50));
+    
+    test_assert(mapping_size(map) == 5, "Each key type should get its own entry");
+    test_assert(mapping_lookup(map, vm_value_create_int(1)).data.int_value == 10, "Int key should match");
+    test_assert(mapping_lookup(map, vm_value_create_float(1.0)).data.int_value == 20, "Float key should match");
+    test_assert(mapping_get(map, "1").data.int_value == 30, "String key should match");
+    test_assert(mapping_lookup(map, object_key(&token_a)).data.int_value == 40,
+                "Object key should match by identity");
+    test_assert(mapping_lookup(map, object_key(&token_b)).type == VALUE_NULL,
+                "Another object should not match");
+    test_assert(mapping_lookup(map, vm_value_create_int(2)).type == VALUE_NULL, "Absent int should miss");
+    
+    mapping_store(map, vm_value_create_float(-0.0), vm_value_create_int(60));
+    test_assert(mapping_lookup(map, vm_value_create_float(0.0)).data.int_value == 60,
+                "-0.0 and 0.0 should be the same key");
+    
+    test_assert(mapping_remove(map, vm_value_create_int(1)) == 0 &&
+                mapping_lookup(map, vm_value_create_int(1)).type == VALUE_NULL &&
+                mapping_lookup(map, vm_value_create_float(1.0)).data.int_value == 20,
+                "Removing the int key should leave the float key");
+    
+    array_t *keys = mapping_keys(map);
+    int saw_object = 0;
+    for (size_t i = 0; keys && i < keys->length; i++) {
+        if (keys->elements[i].type == VALUE_OBJECT && keys->elements[i].data.object_value == &token_a) {
+            saw_object = 1;
+        }
+    }
+    test_assert(saw_object, "keys() should return non-string keys as they are");
+    array_free(keys);
+    
+    vm_value_release(&one_str);
+    mapping_free(map);
+    gc_free(gc);
+}
+
+/* ========== TESTS: Growth and Order ========== */
+
+void test_mapping_growth(void) {
+    test_setup("The index grows and every key stays reachable");
+    
+    mapping_t *map = mapping_new(NULL, 16);
+    const int count = 20000;
+    for (int i = 0; i < count; i++) {
+        mapping_store(map, vm_value_create_int(i * 7919), vm_value_create_int(i));
+    }
+    test_assert(mapping_size(map) == (size_t)count, "Size should count every key");
+    test_assert(map->bucket_count >= (size_t)count * MAPPING_MAX_LOAD_DEN / MAPPING_MAX_LOAD_NUM,
+                "The index should stay below its load limit");
+    test_assert((map->bucket_count & (map->bucket_count - 1)) == 0, "The index should be a power of two");
+    
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        VMValue v = mapping_lookup(map, vm_value_create_int(i * 7919));
+        if (v.type == VALUE_INT && v.data.int_value == i) found++;
+    }
+    test_assert(found == count, "Every key should be found after growing");
+    
+    mapping_free(map);
+}
+
+void test_mapping_insertion_order(void) {
+    test_setup("Iteration follows insertion order through deletes");
+    
+    mapping_t *map = mapping_new(NULL, 8);
+    char key[16];
+    for (int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mapping_set(map, key, vm_value_create_int(i));
+    }
+    /* Delete the even keys, then re-add k0 and update k1 */
+    for (int i = 0; i < 100; i += 2) {
+        snprintf(key, sizeof(key), "k%d", i);
+        mapping_delete(map, key);
+    }
+    mapping_set(map, "k0", vm_value_create_int(1000));
+    mapping_set(map, "k1", vm_value_create_int(1001));
+    
+    array_t *keys = mapping_keys(map);
+    array_t *values = mapping_values(map);
+    int ordered = keys && keys->length == 51;
+    for (int i = 0; ordered && i < 50; i++) {
+        snprintf(key, sizeof(key), "k%d", 2 * i + 1);
+        ordered = strcmp(keys->elements[i].data.string_value, key) == 0;
+    }
+    test_assert(ordered, "Surviving keys should keep their order; an update should not move a key");
+    test_assert(ordered && strcmp(keys->elements[50].data.string_value, "k0") == 0 &&
+                values->elements[50].data.int_value == 1000,
+                "A re-added key should go last");
+    
+    mapping_t *copy = mapping_clone(map, NULL);
+    array_t *copy_keys = mapping_keys(copy);
+    int same = copy_keys && copy_keys->length == keys->length;
+    for (size_t i = 0; same && i < keys->length; i++) {
+        same = copy_keys->elements[i].data.string_value == keys->elements[i].data.string_value;
+    }
+    test_assert(same, "A clone should iterate in the same order");
+    
+    array_free(keys);
+    array_free(values);
+    array_free(copy_keys);
+    mapping_free(copy);
+    mapping_free(map);
+}
+
+void test_mapping_churn(void) {
+    test_setup("Deleted entries are reclaimed under insert/delete churn");
+    
+    mapping_t *map = mapping_new(NULL, 16);
+    for (int round = 0; round < 10000; round++) {
+        mapping_store(map, vm_value_create_int(round), vm_value_create_int(round));
+        if (round >= 8) mapping_remove(map, vm_value_create_int(round - 8));
+    }
+    test_assert(mapping_size(map) == 8, "Eight keys should be live");
+    test_assert(map->bucket_count == 16 && map->entry_capacity <= 12,
+                "A steady size should not grow the table");
+    test_assert(mapping_lookup(map, vm_value_create_int(9999)).data.int_value == 9999 &&
+                mapping_lookup(map, vm_value_create_int(9991)).type == VALUE_NULL,
+                "Only the last eight keys should remain");
+    
+    mapping_free(map);
+}
+
+void test_mapping_gc_traces_keys(void) {
+    test_setup("The collector keeps array keys alive");
+    
+    VirtualMachine *vm = vm_init();
+    mapping_t *map = mapping_new(vm->gc, 8);
+    array_t *key_arr = array_new(vm->gc, 2);
+    VMValue key;
+    key.type = VALUE_ARRAY;
+    key.data.array_value = key_arr;
+    mapping_store(map, key, vm_value_create_int(1));
+    
+    vm->global_variables[0].type = VALUE_MAPPING;
+    vm->global_variables[0].data.mapping_value = map;
+    vm->global_count = 1;
+    gc_collect_full(vm->gc);
+    
+    test_assert(gc_is_tracked(vm->gc, key_arr), "An array used only as a key should survive");
+    test_assert(mapping_lookup(map, key).data.int_value == 1, "It should still find its value");
+    
+    vm_free(vm);
+}
+
+/* ========== TESTS: Copy-on-Write ========== */
+
+void test_mapping_clone_shares_entries(void) {
+    test_setup("Clone shares entries until written");
+    
+    GC *gc = gc_init();
+    mapping_t *map = mapping_new(gc, 8);
+    mapping_set(map, "name", vm_value_create_string("Bob"));
+    mapping_set(map, "level", vm_value_create_int(3));
+    
+    mapping_t *clone = mapping_clone(map, gc);
+    test_assert(clone->entries == map->entries && clone->index == map->index,
+                "Clone should read the original's entries");
+    
+    mapping_delete(clone, "level");
+    mapping_set(clone, "title", vm_value_create_string("the Brave"));
+    test_assert(clone->entries != map->entries, "A write should give the clone its own entries");
+    test_assert(mapping_size(map) == 2 && mapping_get(map, "level").data.int_value == 3 &&
+                mapping_get(map, "title").type == VALUE_NULL,
+                "The original should be unchanged");
+    test_assert(mapping_size(clone) == 2 && mapping_get(clone, "level").type == VALUE_NULL &&
+                strcmp(mapping_get(clone, "name").data.string_value, "Bob") == 0,
+                "The clone should see its own writes and the shared string");
+    
+    mapping_t *second = mapping_clone(map, gc);
+    mapping_free(map);
+    test_assert(strcmp(mapping_get(second, "name").data.string_value, "Bob") == 0,
+                "A clone should outlive its source");
+    mapping_entry_t *before = second->entries;
+    mapping_set(second, "level", vm_value_create_int(4));
+    test_assert(second->entries == before && second->shares == NULL,
+                "The last user should write in place");
+    
+    mapping_free(second);
+    mapping_free(clone);
+    gc_free(gc);
+}
+
+void test_mapping_clone_nested_is_deep(void) {
+    test_setup("Clone of a mapping holding arrays is still deep");
+    
+    mapping_t *map = mapping_new(NULL, 8);
+    array_t *arr = array_new(NULL, 2);
+    array_push(arr, vm_value_create_int(1));
+    VMValue v;
+    v.type = VALUE_ARRAY;
+    v.data.array_value = arr;
+    mapping_set(map, "list", v);
+    
+    mapping_t *clone = mapping_clone(map, NULL);
+    array_t *copy = mapping_get(clone, "list").data.array_value;
+    test_assert(clone->entries != map->entries && copy != arr,
+                "Nested arrays should be copied up front");
+    array_push(arr, vm_value_create_int(2));
+    test_assert(array_length(copy) == 1, "Writing the original's array should not show in the clone");
+    
+    mapping_free(clone);
+    mapping_free(map);
+}
+
 /* ========== Main Test Runner ========== */
 
 int main(void) {
@@ -564,6 +821,20 @@ int main(void) {
     test_mapping_gc_allocation();
     test_mapping_multiple_gc_mappings();
     
+    /* Interning Tests */
+    test_mapping_interned_keys();
+    
+    /* Typed Keys, Growth and Order */
+    test_mapping_typed_keys();
+    test_mapping_growth();
+    test_mapping_insertion_order();
+    test_mapping_churn();
+    test_mapping_gc_traces_keys();
+    
+    /* Copy-on-Write */
+    test_mapping_clone_shares_entries();
+    test_mapping_clone_nested_is_deep();
+    
     /* Summary */
     printf("\n========================================\n");
     printf("Test Results: %d/%d passed", test_passed, test_count);
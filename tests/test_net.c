@@ -0,0 +1,364 @@
+/**
+ * test_net.c - Event Loop Test Suite
+ *
+ * Tests for the timing wheel behind the driver's idle timeouts, the
+ * epoll reactor behind its main loop and the per-connection output queue.
+ */
+
+#include "net.h"
+#include "timer_wheel.h"
+#include "output_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+typedef struct {
+    TimerEntry timer;
+    int fired;
+    unsigned long fired_at;
+    TimerWheel *wheel;
+    TimerEntry *victim;         /* Removed by the callback, if set */
+    unsigned long rearm;        /* Re-added this many ticks later, if set */
+} CountingTimer;
+
+static void counting_expired(TimerEntry *timer, void *ctx) {
+    CountingTimer *ct = (CountingTimer *)ctx;
+    (void)timer;
+
+    ct->fired++;
+    ct->fired_at = ct->wheel->now;
+    if (ct->victim) timer_wheel_remove(ct->wheel, ct->victim);
+    if (ct->rearm) {
+        timer_wheel_add(ct->wheel, &ct->timer, ct->wheel->now + ct->rearm, counting_expired, ct);
+        ct->rearm = 0;
+    }
+}
+
+/* ========== TESTS: Timer Wheel ========== */
+
+void test_timer_wheel_fires_on_time(void) {
+    test_setup("Timers fire on their tick, not before");
+
+    static TimerWheel wheel;
+    timer_wheel_init(&wheel, 1000);
+
+    CountingTimer a = { .wheel = &wheel };
+    CountingTimer b = { .wheel = &wheel };
+    timer_wheel_add(&wheel, &a.timer, 1005, counting_expired, &a);
+    timer_wheel_add(&wheel, &b.timer, 1010, counting_expired, &b);
+
+    test_assert(wheel.count == 2 && timer_wheel_pending(&a.timer), "Both timers should be pending");
+    test_assert(timer_wheel_advance(&wheel, 1004) == 0 && a.fired == 0, "Nothing is due at 1004");
+    test_assert(timer_wheel_advance(&wheel, 1005) == 1 && a.fired == 1, "First timer fires at 1005");
+    test_assert(!timer_wheel_pending(&a.timer), "A fired timer is no longer pending");
+    test_assert(timer_wheel_advance(&wheel, 1020) == 1 && b.fired_at == 1010,
+                "Second timer fires on its own tick during a multi-tick advance");
+    test_assert(wheel.count == 0, "Wheel should be empty");
+    test_assert(timer_wheel_advance(&wheel, 1010) == 0, "Going backwards is a no-op");
+}
+
+void test_timer_wheel_beyond_one_lap(void) {
+    test_setup("Deadlines past the wheel span wait for their lap");
+
+    static TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+
+    CountingTimer far = { .wheel = &wheel };
+    unsigned long expires = TIMER_WHEEL_SLOTS * 2 + 7;
+    timer_wheel_add(&wheel, &far.timer, expires, counting_expired, &far);
+
+    timer_wheel_advance(&wheel, TIMER_WHEEL_SLOTS + 7);
+    test_assert(far.fired == 0, "Timer should survive the first pass over its slot");
+    timer_wheel_advance(&wheel, expires);
+    test_assert(far.fired == 1 && far.fired_at == expires, "Timer should fire on the second lap");
+
+    /* A gap of many laps still fires everything exactly once */
+    CountingTimer late = { .wheel = &wheel };
+    timer_wheel_add(&wheel, &late.timer, expires + 3, counting_expired, &late);
+    timer_wheel_advance(&wheel, expires + TIMER_WHEEL_SLOTS * 10);
+    test_assert(late.fired == 1, "Timer should fire once after a long stall");
+}
+
+void test_timer_wheel_remove_and_rearm(void) {
+    test_setup("Callbacks can remove and re-add timers");
+
+    static TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+
+    CountingTimer killer = { .wheel = &wheel };
+    CountingTimer victim = { .wheel = &wheel };
+    CountingTimer repeat = { .wheel = &wheel, .rearm = 3 };
+
+    /* Same slot: the killer is linked after the victim, so it runs first */
+    timer_wheel_add(&wheel, &victim.timer, 10, counting_expired, &victim);
+    timer_wheel_add(&wheel, &killer.timer, 10, counting_expired, &killer);
+    killer.victim = &victim.timer;
+    timer_wheel_add(&wheel, &repeat.timer, 10, counting_expired, &repeat);
+
+    timer_wheel_advance(&wheel, 10);
+    test_assert(killer.fired == 1 && victim.fired == 0, "Timer removed by a callback should not fire");
+    test_assert(repeat.fired == 1 && timer_wheel_pending(&repeat.timer), "Re-armed timer should be pending");
+
+    timer_wheel_advance(&wheel, 13);
+    test_assert(repeat.fired == 2 && repeat.fired_at == 13, "Re-armed timer should fire again");
+
+    /* Moving a pending timer does not duplicate it */
+    CountingTimer moved = { .wheel = &wheel };
+    timer_wheel_add(&wheel, &moved.timer, 20, counting_expired, &moved);
+    timer_wheel_add(&wheel, &moved.timer, 30, counting_expired, &moved);
+    test_assert(wheel.count == 1, "Moving a timer should not add a second entry");
+    timer_wheel_advance(&wheel, 25);
+    test_assert(moved.fired == 0, "Moved timer should not fire at its old tick");
+    timer_wheel_remove(&wheel, &moved.timer);
+    timer_wheel_remove(&wheel, &moved.timer);
+    test_assert(wheel.count == 0 && timer_wheel_advance(&wheel, 40) == 0,
+                "Removed timer should never fire");
+}
+
+/* ========== TESTS: Reactor ========== */
+
+void test_reactor_edge_triggered(void) {
+    test_setup("Edge-triggered read, write and hangup events");
+
+    NetReactor *reactor = malloc(sizeof(NetReactor));
+    int fds[2];
+    test_assert(reactor && net_reactor_init(reactor) == 0, "Reactor should initialize");
+    test_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "socketpair should succeed");
+    test_assert(net_set_nonblocking(fds[0]) == 0, "Socket should become nonblocking");
+
+    int tag = 42;
+    net_reactor_add(reactor, fds[0], NET_EVENT_READ | NET_EVENT_WRITE | NET_EVENT_EDGE, &tag);
+    test_assert(reactor->watched == 1, "One descriptor should be watched");
+
+    int n = net_reactor_wait(reactor, 0);
+    test_assert(n == 1 && reactor->events[0].data == &tag &&
+                (reactor->events[0].events & NET_EVENT_WRITE), "Fresh socket reports writable");
+    test_assert(net_reactor_wait(reactor, 0) == 0, "No new edge, no new event");
+
+    write(fds[1], "hello", 5);
+    n = net_reactor_wait(reactor, 100);
+    test_assert(n == 1 && (reactor->events[0].events & NET_EVENT_READ), "Incoming data reports readable");
+
+    /* Unread data does not repeat the event until the socket is re-armed */
+    test_assert(net_reactor_wait(reactor, 0) == 0, "Edge is reported once");
+    net_reactor_modify(reactor, fds[0], NET_EVENT_READ | NET_EVENT_WRITE | NET_EVENT_EDGE, &tag);
+    test_assert(net_reactor_wait(reactor, 0) == 1, "Re-arming reports the pending data again");
+
+    char buf[16];
+    test_assert(read(fds[0], buf, sizeof(buf)) == 5, "Data should be readable");
+    test_assert(read(fds[0], buf, sizeof(buf)) < 0 && errno == EAGAIN, "Drained socket should not block");
+
+    close(fds[1]);
+    n = net_reactor_wait(reactor, 100);
+    test_assert(n == 1 && (reactor->events[0].events & NET_EVENT_HANGUP), "Peer close reports hangup");
+
+    test_assert(net_reactor_remove(reactor, fds[0]) == 0 && reactor->watched == 0,
+                "Descriptor should be unregistered");
+    close(fds[0]);
+    net_reactor_close(reactor);
+    free(reactor);
+}
+
+void test_reactor_listen_accept(void) {
+    test_setup("Nonblocking listener and accept");
+
+    int listen_fd = net_listen(0);
+    test_assert(listen_fd >= 0, "Listener should bind an ephemeral port");
+    if (listen_fd < 0) return;
+
+    char ip[64] = "unset";
+    errno = 0;
+    test_assert(net_accept(listen_fd, ip, sizeof(ip)) < 0 && errno == EAGAIN,
+                "Empty backlog should return EAGAIN instead of blocking");
+    close(listen_fd);
+}
+
+/* ========== TESTS: Output Queue ========== */
+
+void test_output_queue_coalesce(void) {
+    test_setup("Small writes share blocks and leave in one flush");
+
+    OutputQueue q;
+    output_queue_init(&q, 0);
+    test_assert(q.limit == OUTPUT_QUEUE_LIMIT, "Default limit should apply");
+
+    for (int i = 0; i < 100; i++) {
+        output_queue_write(&q, "You hear a distant rumble.\r\n", 28);
+    }
+    test_assert(q.count == 1 && output_queue_pending(&q) == 2800, "100 short lines should fit one block");
+
+    /* Output longer than a block gets a block of its own */
+    char big[OUTPUT_BLOCK_SIZE * 3];
+    memset(big, 'x', sizeof(big));
+    output_queue_write(&q, big, sizeof(big));
+    test_assert(output_queue_pending(&q) == 2800 + sizeof(big), "Large output should be queued whole");
+
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    net_set_nonblocking(fds[0]);
+    test_assert(output_queue_flush(&q, fds[0]) == 0, "Flush should drain the queue");
+    test_assert(q.count == 0 && q.bytes_flushed == q.bytes_queued, "Counters should balance");
+
+    char *got = malloc(sizeof(big) + 2800);
+    size_t total = 0;
+    ssize_t n;
+    while (total < sizeof(big) + 2800 && (n = read(fds[1], got + total, sizeof(big) + 2800 - total)) > 0) {
+        total += (size_t)n;
+    }
+    test_assert(total == sizeof(big) + 2800 && memcmp(got, "You hear", 8) == 0 &&
+                got[total - 1] == 'x', "Peer should receive the bytes in order");
+
+    free(got);
+    close(fds[0]);
+    close(fds[1]);
+    output_queue_free(&q);
+}
+
+void test_output_queue_backpressure(void) {
+    test_setup("Slow reader: partial flush, limit and drop counters");
+
+    OutputQueue q;
+    output_queue_init(&q, 64000);
+
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    net_set_nonblocking(fds[0]);
+    int small = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+
+    char chunk[1000];
+    memset(chunk, 'a', sizeof(chunk));
+    int refused = 0;
+    for (int i = 0; i < 70; i++) {
+        if (output_queue_write(&q, chunk, sizeof(chunk)) != 0) refused++;
+    }
+    test_assert(refused == 6 && q.bytes_dropped == 6000, "Writes past the limit should be refused and counted");
+    test_assert(output_queue_pending(&q) == 64000, "Queued bytes stay within the limit");
+
+    test_assert(output_queue_flush(&q, fds[0]) == 1, "Full socket should leave output queued");
+    test_assert(q.bytes_flushed > 0 && output_queue_pending(&q) == 64000 - q.bytes_flushed,
+                "Partial flush should advance the queue");
+
+    /* Drain the peer, then the rest goes out */
+    char sink[8192];
+    int rounds = 0;
+    while (output_queue_flush(&q, fds[0]) == 1 && rounds++ < 1000) {
+        while (read(fds[1], sink, sizeof(sink)) == (ssize_t)sizeof(sink)) { }
+    }
+    test_assert(output_queue_pending(&q) == 0 && q.bytes_flushed == 64000, "Queue should drain once the peer reads");
+
+    /* A dead peer drops what is left */
+    output_queue_write(&q, chunk, sizeof(chunk));
+    close(fds[1]);
+    signal(SIGPIPE, SIG_IGN);
+    test_assert(output_queue_flush(&q, fds[0]) == -1, "Flush to a closed peer should fail");
+    test_assert(q.bytes_dropped == 7000 && output_queue_pending(&q) == 0, "Lost output should count as dropped");
+
+    close(fds[0]);
+    output_queue_free(&q);
+}
+
+void test_output_queue_shared_block(void) {
+    test_setup("Shared blocks are queued by reference");
+
+    OutputQueue a, b;
+    output_queue_init(&a, 0);
+    output_queue_init(&b, 0);
+
+    const char *text = "Grimnar shouts: Over here!\r\n";
+    size_t len = strlen(text);
+    OutputBlock *shared = output_block_new(len);
+    memcpy(shared->data, text, len);
+    shared->used = len;
+
+    output_queue_write(&a, "> ", 2);
+    output_queue_append(&a, shared, 0, len);
+    output_queue_append(&b, shared, 0, len);
+    test_assert(shared->refcount == 3, "Each queue should hold its own reference");
+
+    /* Later output must not be copied into the shared block */
+    output_queue_write(&a, "> ", 2);
+    test_assert(shared->used == len && a.count == 3, "Write after a shared segment starts a new block");
+
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    net_set_nonblocking(fds[0]);
+    output_queue_flush(&a, fds[0]);
+    char got[128] = { 0 };
+    ssize_t n = read(fds[1], got, sizeof(got) - 1);
+    test_assert(n == (ssize_t)len + 4 && strncmp(got + 2, text, len) == 0 &&
+                strcmp(got + 2 + len, "> ") == 0, "Segments should go out in order");
+    test_assert(shared->refcount == 2, "Flushing should drop the queue's reference");
+
+    output_queue_free(&a);
+    output_queue_init(&a, 8);
+    test_assert(output_queue_append(&a, shared, 0, len) == -1 && shared->refcount == 2 &&
+                a.bytes_dropped == len, "Append over the limit is refused without a reference");
+
+    output_queue_free(&b);
+    test_assert(shared->refcount == 1, "Freeing a queue should drop its references");
+    output_block_release(shared);
+
+    close(fds[0]);
+    close(fds[1]);
+    output_queue_free(&a);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("\n========================================\n");
+    printf("AMLP Event Loop - Test Suite\n");
+    printf("========================================\n");
+
+    /* Timer Wheel Tests */
+    test_timer_wheel_fires_on_time();
+    test_timer_wheel_beyond_one_lap();
+    test_timer_wheel_remove_and_rearm();
+
+    /* Reactor Tests */
+    test_reactor_edge_triggered();
+    test_reactor_listen_accept();
+
+    /* Output Queue Tests */
+    test_output_queue_coalesce();
+    test_output_queue_backpressure();
+    test_output_queue_shared_block();
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
@@ -338,6 +338,113 @@ void test_inherit_method(void) {
     vm_function_free(parent_method);
 }
 
+void test_intern_name(void) {
+    test_setup("Interned method names share one pointer");
+    
+    char buf[16];
+    strcpy(buf, "look_at");
+    const char *a = obj_intern_name("look_at");
+    const char *b = obj_intern_name(buf);
+    
+    test_assert(a != NULL && a == b, "Equal names should intern to the same pointer");
+    test_assert(a != buf, "Interned name should be an independent copy");
+}
+
+void test_clone_shares_method_table(void) {
+    test_setup("Clones share their prototype's method table");
+    
+    obj_t *master = obj_new("room");
+    VMFunction *init = vm_function_create("init", 0, 0);
+    obj_add_method(master, init);
+    
+    obj_t *c1 = obj_clone(master);
+    obj_t *c2 = obj_clone(master);
+    
+    ObjMethodTable *t1 = obj_method_table(c1);
+    ObjMethodTable *t2 = obj_method_table(c2);
+    test_assert(t1 != NULL && t1 == t2 && t1 == obj_method_table(master),
+                "Clones should reuse the master's table");
+    test_assert(obj_get_method(c1, "init") == init, "Clone should find inherited method");
+    
+    /* Adding a method afterwards must be visible through the shared table */
+    VMFunction *reset = vm_function_create("reset", 0, 0);
+    obj_add_method(master, reset);
+    test_assert(obj_get_method(c2, "reset") == reset,
+                "Table should be rebuilt after a method is added");
+    test_assert(obj_method_table(c2)->id != t1->id,
+                "Rebuilt table should have a new identity");
+    
+    obj_free(c1);
+    obj_free(c2);
+    obj_free(master);
+    vm_function_free(init);
+    vm_function_free(reset);
+}
+
+void test_method_override_order(void) {
+    test_setup("Own methods shadow inherited ones in the table");
+    
+    obj_t *parent = obj_new("parent");
+    VMFunction *base = vm_function_create("describe", 0, 0);
+    obj_add_method(parent, base);
+    
+    obj_t *child = obj_new("child");
+    obj_set_proto(child, parent);
+    VMFunction *own = vm_function_create("describe", 0, 0);
+    obj_add_method(child, own);
+    
+    test_assert(obj_get_method(child, "describe") == own, "Child's own method should win");
+    test_assert(obj_get_method(parent, "describe") == base, "Parent keeps its method");
+    test_assert(obj_get_method(child, "missing") == NULL, "Unknown method should not be found");
+    
+    obj_free(child);
+    obj_free(parent);
+    vm_function_free(base);
+    vm_function_free(own);
+}
+
+void test_method_table_invalidation(void) {
+    test_setup("Changing one object rebuilds only the tables built over it");
+    
+    obj_t *parent = obj_new("parent");
+    VMFunction *look = vm_function_create("look", 0, 0);
+    obj_add_method(parent, look);
+    obj_t *child = obj_new("child");
+    obj_set_proto(child, parent);
+    VMFunction *wield = vm_function_create("wield", 0, 0);
+    obj_add_method(child, wield);
+    obj_t *other = obj_new("other");
+    VMFunction *open = vm_function_create("open", 0, 0);
+    obj_add_method(other, open);
+    
+    unsigned int child_id = obj_method_table(child)->id;
+    unsigned int other_id = obj_method_table(other)->id;
+    
+    VMFunction *close = vm_function_create("close", 0, 0);
+    obj_add_method(other, close);
+    test_assert(obj_method_table(child)->id == child_id, "An unrelated object's change should keep the table");
+    test_assert(obj_method_table(other)->id != other_id && obj_get_method(other, "close") == close,
+                "The changed object's table should be rebuilt");
+    
+    VMFunction *smell = vm_function_create("smell", 0, 0);
+    obj_add_method(parent, smell);
+    test_assert(obj_method_table(child)->id != child_id && obj_get_method(child, "smell") == smell,
+                "A prototype's new method should reach the child");
+    
+    obj_set_proto(child, NULL);
+    test_assert(obj_get_method(child, "look") == NULL && obj_get_method(child, "wield") == wield,
+                "Dropping the prototype should drop its methods");
+    
+    obj_free(child);
+    obj_free(parent);
+    obj_free(other);
+    vm_function_free(look);
+    vm_function_free(wield);
+    vm_function_free(open);
+    vm_function_free(close);
+    vm_function_free(smell);
+}
+
 /* ========== TESTS: Object Manager ========== */
 
 void test_manager_init(void) {
@@ -446,6 +553,42 @@ void test_method_count(void) {
     vm_function_free(m3);
 }
 
+void test_move_inventory(void) {
+    test_setup("Move objects between containers");
+    
+    obj_t *room = obj_new("room");
+    obj_t *bag = obj_new("bag");
+    obj_t *coin = obj_new("coin");
+    obj_t *gem = obj_new("gem");
+    
+    obj_move(bag, room);
+    obj_move(coin, bag);
+    obj_move(gem, bag);
+    
+    test_assert(coin->environment == bag && bag->environment == room, "Environments should be set");
+    test_assert(bag->first_inventory == gem && gem->next_inventory == coin && !coin->next_inventory,
+                "Inventory should list the newest arrival first");
+    test_assert(bag->inventory_count == 2, "Bag should hold 2 objects");
+    
+    obj_move(gem, room);
+    test_assert(bag->first_inventory == coin && !coin->prev_inventory && bag->inventory_count == 1,
+                "Moving out should unlink from the old container");
+    test_assert(room->first_inventory == gem && gem->next_inventory == bag, "Gem should be first in room");
+    
+    test_assert(obj_move(room, coin) == -1 && room->environment == NULL,
+                "Moving a container into its own contents should fail");
+    test_assert(obj_move(bag, bag) == -1, "Moving an object into itself should fail");
+    
+    obj_free(bag);
+    test_assert(coin->environment == NULL, "Contents of a freed object should have no environment");
+    test_assert(room->first_inventory == gem && !gem->next_inventory && room->inventory_count == 1,
+                "Freed object should leave its environment");
+    
+    obj_free(coin);
+    obj_free(gem);
+    obj_free(room);
+}
+
 /* ========== Main Test Runner ========== */
 
 int main(void) {
@@ -478,6 +621,10 @@ int main(void) {
     test_add_method();
     test_get_method();
     test_inherit_method();
+    test_intern_name();
+    test_clone_shares_method_table();
+    test_method_override_order();
+    test_method_table_invalidation();
     
     /* Object Manager Tests */
     test_manager_init();
@@ -485,6 +632,9 @@ int main(void) {
     test_manager_find();
     test_manager_unregister();
     
+    /* Containment Tests */
+    test_move_inventory();
+    
     /* Utility Tests */
     test_property_count();
     test_method_count();
@@ -0,0 +1,256 @@
+/**
+ * test_object_program.c - Shared Program Test Suite
+ *
+ * Tests for programs shared between the objects compiled from one file:
+ * per-object global variables, per-program method lookup, the path
+ * cache and the cost of a clone.
+ */
+
+#include "object_program.h"
+#include "compiler.h"
+#include "object.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static const char *npc_src =
+    "int hp;\n"
+    "string name;\n"
+    "void set_hp(int n) { hp = n; }\n"
+    "int query_hp() { return hp; }\n"
+    "void set_name(string s) { name = s; }\n"
+    "string query_name() { return name; }\n";
+
+static ObjProgram *program_from_string(VirtualMachine *vm, const char *src, const char *path) {
+    Program *prog = compiler_compile_string(src, path);
+    if (!prog) return NULL;
+    ObjProgram *program = obj_program_from(vm, path, prog);
+    program_free(prog);
+    return program;
+}
+
+static obj_t *new_instance(ObjProgram *program) {
+    obj_t *obj = obj_new(program->path);
+    if (obj && obj_program_attach(obj, program) != 0) {
+        obj_free(obj);
+        return NULL;
+    }
+    return obj;
+}
+
+static long call_int(VirtualMachine *vm, obj_t *obj, const char *method, VMValue *args, int argc) {
+    VMValue result = obj_call_method(vm, obj, method, args, argc);
+    return result.type == VALUE_INT ? result.data.int_value : -999;
+}
+
+/* peek(o): return o->query_hp(), built by hand since the compiler has no -> */
+static VMFunction *make_peek_function(void) {
+    VMFunction *func = vm_function_create("peek", 1, 0);
+    VMInstruction ins1 = { .opcode = OP_LOAD_LOCAL, .operand.int_operand = 0 };
+    VMInstruction ins2 = { .opcode = OP_PUSH_STRING, .operand.string_operand = "query_hp" };
+    VMInstruction ins3 = { .opcode = OP_CALL_METHOD, .operand.int_operand = 0 };
+    VMInstruction ins4 = { .opcode = OP_RETURN, .operand.int_operand = 0 };
+    vm_function_add_instruction(func, ins1);
+    vm_function_add_instruction(func, ins2);
+    vm_function_add_instruction(func, ins3);
+    vm_function_add_instruction(func, ins4);
+    return func;
+}
+
+static void set_hp(VirtualMachine *vm, obj_t *obj, long hp) {
+    VMValue arg = vm_value_create_int(hp);
+    obj_call_method(vm, obj, "set_hp", &arg, 1);
+}
+
+/* ========== Tests ========== */
+
+void test_instance_variables(void) {
+    test_setup("Objects of one program keep their own globals");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *program = program_from_string(vm, npc_src, "/test/npc");
+    test_assert(program != NULL, "Program should load");
+    test_assert(program->variable_count == 2, "Program should lay out two variables");
+    test_assert(obj_program_find_variable(program, "name") == 1, "name should be slot 1");
+
+    obj_t *a = new_instance(program);
+    obj_t *b = new_instance(program);
+    set_hp(vm, a, 5);
+    set_hp(vm, b, 7);
+    test_assert(call_int(vm, a, "query_hp", NULL, 0) == 5, "a should keep its own hp");
+    test_assert(call_int(vm, b, "query_hp", NULL, 0) == 7, "b should keep its own hp");
+
+    VMValue name = vm_value_create_string("orc");
+    obj_call_method(vm, a, "set_name", &name, 1);
+    vm_value_release(&name);
+    VMValue got = obj_call_method(vm, a, "query_name", NULL, 0);
+    test_assert(got.type == VALUE_STRING && strcmp(got.data.string_value, "orc") == 0,
+                "A string variable should round-trip");
+    vm_value_release(&got);
+
+    /* A method call runs the callee with the callee's variables */
+    int peek = vm_add_function(vm, make_peek_function());
+    VMValue other;
+    other.type = VALUE_OBJECT;
+    other.data.object_value = b;
+    vm->current_object = a;
+    vm_push_value(vm, other);
+    vm_call_function(vm, peek, 1);
+    VMValue peeked = vm_pop_value(vm);
+    test_assert(peeked.type == VALUE_INT && peeked.data.int_value == 7,
+                "b->query_hp() called from a should read b's hp");
+    test_assert(vm->current_object == a, "The caller should be current again afterwards");
+    vm->current_object = NULL;
+
+    obj_free(a);
+    obj_free(b);
+    obj_program_release(program);
+    vm_free(vm);
+}
+
+void test_per_program_methods(void) {
+    test_setup("Same-named functions resolve within their own program");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *sword = program_from_string(vm, "int value() { return 10; }\n", "/test/sword");
+    ObjProgram *shield = program_from_string(vm, "int value() { return 25; }\n", "/test/shield");
+
+    obj_t *s1 = new_instance(sword);
+    obj_t *s2 = new_instance(shield);
+    test_assert(call_int(vm, s1, "value", NULL, 0) == 10, "sword should run its own value()");
+    test_assert(call_int(vm, s2, "value", NULL, 0) == 25, "shield should run its own value()");
+    test_assert(obj_method_table(s1) == sword->method_table,
+                "An instance should use its program's table");
+
+    obj_free(s1);
+    obj_free(s2);
+    obj_program_release(sword);
+    obj_program_release(shield);
+    vm_free(vm);
+}
+
+void test_cache(void) {
+    test_setup("Programs are cached by path and recompiled when the file changes");
+    VirtualMachine *vm = vm_init();
+
+    char fs_path[64];
+    snprintf(fs_path, sizeof(fs_path), "/tmp/amlp_test_program_%d.lpc", (int)getpid());
+    FILE *f = fopen(fs_path, "w");
+    fputs("int version() { return 1; }\n", f);
+    fclose(f);
+
+    ObjProgram *first = obj_program_load(vm, "/test/cached", fs_path);
+    ObjProgram *again = obj_program_load(vm, "/test/cached", fs_path);
+    test_assert(first != NULL && first == again, "A second load should hit the cache");
+    test_assert(obj_program_find(vm, "/test/cached") == first, "find should return the entry");
+    test_assert(vm->program_cache->compiles == 1 && vm->program_cache->hits == 1,
+                "The cache should count one compile and one hit");
+
+    obj_t *old = new_instance(first);
+
+    f = fopen(fs_path, "w");
+    fputs("int version() { return 2; }\n", f);
+    fclose(f);
+    struct utimbuf times = { first->mtime + 10, first->mtime + 10 };
+    utime(fs_path, &times);
+
+    ObjProgram *updated = obj_program_load(vm, "/test/cached", fs_path);
+    obj_t *fresh = new_instance(updated);
+    test_assert(updated != NULL && updated != first, "A changed file should be recompiled");
+    test_assert(call_int(vm, fresh, "version", NULL, 0) == 2, "New objects should run the new code");
+    test_assert(call_int(vm, old, "version", NULL, 0) == 1, "Old objects should keep the old code");
+
+    obj_free(old);
+    obj_free(fresh);
+    unlink(fs_path);
+    vm_free(vm);
+}
+
+void test_clone_cost(void) {
+    test_setup("10k clones share the program and allocate only their variables");
+    VirtualMachine *vm = vm_init();
+    ObjProgram *program = program_from_string(vm, npc_src, "/test/npc");
+
+    enum { CLONES = 10000 };
+    obj_t **clones = (obj_t **)malloc(sizeof(obj_t *) * CLONES);
+    int shared = 1;
+    for (int i = 0; i < CLONES; i++) {
+        clones[i] = new_instance(program);
+        if (!clones[i] || clones[i]->methods || clones[i]->properties ||
+            obj_method_table(clones[i]) != program->method_table) {
+            shared = 0;
+        }
+    }
+    test_assert(shared, "Clones should carry no method list or property table of their own");
+    test_assert(program->ref_count == CLONES + 1, "Every clone should hold the program");
+
+    size_t per_clone = sizeof(obj_t) + sizeof(VMValue) * program->variable_count +
+                       strlen(program->path) + 1;
+    printf("  %zu bytes per clone\n", per_clone);
+    test_assert(per_clone < 512, "A clone should cost a few hundred bytes");
+
+    set_hp(vm, clones[CLONES - 1], 42);
+    test_assert(call_int(vm, clones[CLONES - 1], "query_hp", NULL, 0) == 42 &&
+                call_int(vm, clones[0], "query_hp", NULL, 0) == 0,
+                "The last clone's variables should be its own");
+
+    /* obj_clone() of an instance gets the same program and fresh variables */
+    obj_t *copy = obj_clone(clones[CLONES - 1]);
+    test_assert(copy && copy->program == program &&
+                call_int(vm, copy, "query_hp", NULL, 0) == 0,
+                "obj_clone() should start from the program's initial values");
+    obj_free(copy);
+
+    for (int i = 0; i < CLONES; i++) obj_free(clones[i]);
+    free(clones);
+    test_assert(program->ref_count == 1, "Freeing the clones should drop their references");
+    obj_program_release(program);
+    vm_free(vm);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("Shared Program Test Suite\n");
+    printf("========================================\n");
+
+    test_instance_variables();
+    test_per_program_methods();
+    test_cache();
+    test_clone_cost();
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+/**
+ * test_preload.c - Parallel Preload Test Suite
+ *
+ * Tests for the preload list, compiling on worker threads and loading
+ * the results into a VM, and for the per-parser error state that makes
+ * concurrent compiles possible.
+ */
+
+#include "preload.h"
+#include "program_cache.h"
+#include "object_program.h"
+#include "compiler.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+#define MANY_FILES 48
+
+static char mudlib[64];
+
+static void write_file(const char *rel, const char *src) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", mudlib, rel);
+    FILE *f = fopen(path, "w");
+    fputs(src, f);
+    fclose(f);
+}
+
+static void make_mudlib(void) {
+    char path[256];
+    snprintf(mudlib, sizeof(mudlib), "/tmp/amlp_preload_test_%d", (int)getpid());
+    mkdir(mudlib, 0755);
+    snprintf(path, sizeof(path), "%s/std", mudlib);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/many", mudlib);
+    mkdir(path, 0755);
+
+    write_file("std/sword.lpc", "int damage;\nint query_damage() { return 7; }\n");
+    write_file("std/shield.lpc", "int query_armour() { return 3; }\n");
+    write_file("std/notes.txt", "not LPC\n");
+    write_file("broken.lpc", "int x;\n\nint broken( { return\n");
+
+    for (int i = 0; i < MANY_FILES; i++) {
+        char rel[64], src[256];
+        snprintf(rel, sizeof(rel), "many/obj_%02d.lpc", i);
+        snprintf(src, sizeof(src),
+                 "int level;\n"
+                 "int query_id() { return %d; }\n"
+                 "int scale(int n) { if (n > %d) { return n * 2; } return n + %d; }\n",
+                 i, i, i);
+        write_file(rel, src);
+    }
+
+    char list[256];
+    snprintf(list, sizeof(list), "%s/preload.txt", mudlib);
+    FILE *f = fopen(list, "w");
+    fputs("# boot objects\n"
+          "\n"
+          "/std/\n"
+          "  /std/sword  \n"
+          "/broken\n"
+          "/missing\n", f);
+    fclose(f);
+}
+
+static int find_entry(PreloadList *list, const char *path) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->entries[i].path, path) == 0) return i;
+    }
+    return -1;
+}
+
+/* ========== Tests ========== */
+
+void test_list(void) {
+    test_setup("Preload lists name files and directories");
+    PreloadList list;
+    test_assert(preload_list_init(&list, mudlib) == 0, "List should initialise");
+
+    char file[256];
+    snprintf(file, sizeof(file), "%s/preload.txt", mudlib);
+    int added = preload_list_read(&list, file);
+    test_assert(added == 3 && list.count == 3, "Directory, file and broken file should add three entries");
+    test_assert(find_entry(&list, "/std/shield") == 0 && find_entry(&list, "/std/sword") == 1,
+                "A directory should add its .lpc files in name order");
+    test_assert(find_entry(&list, "/broken") == 2, "A single path should be added once");
+
+    snprintf(file, sizeof(file), "%s/std/shield.lpc", mudlib);
+    test_assert(strcmp(list.entries[0].fs_path, file) == 0, "Entries should map to the mudlib file");
+    test_assert(preload_list_add(&list, "/std/sword.lpc") == 0, "A duplicate should not be added");
+    test_assert(preload_list_add(&list, "/nowhere") == -1, "A missing path should be an error");
+    preload_list_free(&list);
+}
+
+void test_parser_errors(void) {
+    test_setup("Syntax errors are reported from the parser that saw them");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/broken.lpc", mudlib);
+    Program *broken = compiler_compile_file(path);
+    Program *clean = compiler_compile_string("int ok() { return 1; }\n", "/ok");
+    test_assert(broken && broken->error_info.message && broken->error_info.line == 3,
+                "The first error should carry its own line");
+    test_assert(clean && clean->error_info.message == NULL,
+                "A later clean compile should carry no error");
+    program_free(broken);
+    program_free(clean);
+}
+
+void test_parallel_matches_serial(void) {
+    test_setup("Compiling on workers gives the same programs as compiling serially");
+    PreloadList list;
+    preload_list_init(&list, mudlib);
+    preload_list_add(&list, "/many");
+    test_assert(list.count == MANY_FILES, "The directory should add every file");
+
+    int compiled = preload_compile(&list, 8);
+    test_assert(compiled == MANY_FILES && list.failed == 0 && list.threads == 8,
+                "Eight workers should compile every file");
+
+    int same = 1;
+    for (int i = 0; i < list.count; i++) {
+        Program *serial = compiler_compile_file(list.entries[i].fs_path);
+        Program *parallel = list.entries[i].program;
+        if (!serial || !parallel || serial->bytecode_len != parallel->bytecode_len ||
+            memcmp(serial->bytecode, parallel->bytecode, serial->bytecode_len) != 0 ||
+            serial->function_count != parallel->function_count) {
+            same = 0;
+        }
+        program_free(serial);
+    }
+    test_assert(same, "Every program should match its serial compile");
+    preload_list_free(&list);
+}
+
+void test_link(void) {
+    test_setup("Linking loads programs into the VM's cache");
+    VirtualMachine *vm = vm_init();
+    PreloadList list;
+    preload_list_init(&list, mudlib);
+    preload_list_add(&list, "/std");
+    preload_list_add(&list, "/broken");
+    preload_list_add(&list, "/many");
+
+    preload_compile(&list, 4);
+    test_assert(list.compiled == MANY_FILES + 2 && list.failed == 1,
+                "The broken file should be the only failure");
+    int loaded = preload_link(vm, &list);
+    test_assert(loaded == MANY_FILES + 2, "Every clean program should be loaded");
+    test_assert(obj_program_find(vm, "/broken") == NULL, "The broken file should not be cached");
+
+    ObjProgram *sword = obj_program_find(vm, "/std/sword");
+    char fs_path[256];
+    snprintf(fs_path, sizeof(fs_path), "%s/std/sword.lpc", mudlib);
+    unsigned long compiles = vm->program_cache->compiles;
+    test_assert(sword && obj_program_load(vm, "/std/sword", fs_path) == sword &&
+                vm->program_cache->compiles == compiles,
+                "A later load should hit the preloaded program");
+
+    obj_t *obj = obj_new("/std/sword");
+    obj_program_attach(obj, sword);
+    VMValue result = obj_call_method(vm, obj, "query_damage", NULL, 0);
+    test_assert(result.type == VALUE_INT && result.data.int_value == 7, "Preloaded code should run");
+
+    obj_t *many = obj_new("/many/obj_30");
+    obj_program_attach(many, obj_program_find(vm, "/many/obj_30"));
+    VMValue arg = vm_value_create_int(40);
+    result = obj_call_method(vm, many, "scale", &arg, 1);
+    test_assert(result.type == VALUE_INT && result.data.int_value == 80,
+                "Each program should keep its own functions");
+
+    obj_free(obj);
+    obj_free(many);
+    preload_list_free(&list);
+    vm_free(vm);
+}
+
+void test_with_program_cache(void) {
+    test_setup("Workers share the on-disk program cache");
+    char dir[128];
+    snprintf(dir, sizeof(dir), "%s/images", mudlib);
+    program_cache_set_dir(dir);
+    program_cache_reset_stats();
+
+    PreloadList list;
+    preload_list_init(&list, mudlib);
+    preload_list_add(&list, "/many");
+    preload_compile(&list, 6);
+    const ProgramCacheStats *stats = program_cache_stats();
+    test_assert(stats->misses == MANY_FILES && stats->stores == MANY_FILES,
+                "A cold preload should compile and store every file");
+    preload_list_free(&list);
+
+    program_cache_reset_stats();
+    preload_list_init(&list, mudlib);
+    preload_list_add(&list, "/many");
+    int compiled = preload_compile(&list, 6);
+    test_assert(stats->hits == MANY_FILES && compiled == MANY_FILES,
+                "A warm preload should read every image");
+    preload_list_free(&list);
+    program_cache_set_dir(NULL);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("Parallel Preload Test Suite\n");
+    printf("========================================\n");
+
+    make_mudlib();
+
+    test_list();
+    test_parser_errors();
+    test_parallel_matches_serial();
+    test_link();
+    test_with_program_cache();
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", mudlib);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", mudlib);
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+/**
+ * test_program_cache.c - Program Cache Test Suite
+ *
+ * Tests for compiled program images: round trips, the mtime and
+ * content-hash checks, rejection of damaged images and the cache being
+ * off by default.
+ */
+
+#include "program_cache.h"
+#include "object_program.h"
+#include "compiler.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static char cache_root[64];
+static char source_path[96];
+
+static const char *weapon_src =
+    "int damage;\n"
+    "string name;\n"
+    "void set_damage(int d) { damage = d; }\n"
+    "int query_damage() { return damage; }\n"
+    "int hit(int roll) {\n"
+    "    if (roll > 10) { return 2 * roll; }\n"
+    "    return roll;\n"
+    "}\n";
+
+static void write_source(const char *src, time_t mtime) {
+    FILE *f = fopen(source_path, "w");
+    fputs(src, f);
+    fclose(f);
+    struct utimbuf times = { mtime, mtime };
+    utime(source_path, &times);
+}
+
+static int programs_equal(Program *a, Program *b) {
+    if (a->bytecode_len != b->bytecode_len || memcmp(a->bytecode, b->bytecode, a->bytecode_len) != 0) return 0;
+    if (a->function_count != b->function_count || a->global_count != b->global_count) return 0;
+    if (a->line_map_count != b->line_map_count) return 0;
+    for (size_t i = 0; i < a->function_count; i++) {
+        if (strcmp(a->functions[i].name, b->functions[i].name) != 0 ||
+            a->functions[i].offset != b->functions[i].offset ||
+            a->functions[i].arg_count != b->functions[i].arg_count) return 0;
+    }
+    for (size_t i = 0; i < a->global_count; i++) {
+        if (strcmp(a->globals[i].name, b->globals[i].name) != 0) return 0;
+    }
+    for (size_t i = 0; i < a->line_map_count; i++) {
+        if (a->line_map[i].bytecode_offset != b->line_map[i].bytecode_offset ||
+            a->line_map[i].source_line != b->line_map[i].source_line) return 0;
+    }
+    if (a->inherit_count != b->inherit_count || a->extern_count != b->extern_count) return 0;
+    for (size_t i = 0; i < a->inherit_count; i++) {
+        if (strcmp(a->inherits[i], b->inherits[i]) != 0) return 0;
+    }
+    for (size_t i = 0; i < a->extern_count; i++) {
+        if (strcmp(a->externs[i], b->externs[i]) != 0) return 0;
+    }
+    return 1;
+}
+
+static long call_int(VirtualMachine *vm, obj_t *obj, const char *method, long arg) {
+    VMValue v = vm_value_create_int(arg);
+    VMValue result = obj_call_method(vm, obj, method, &v, 1);
+    return result.type == VALUE_INT ? result.data.int_value : -999;
+}
+
+/* ========== Tests ========== */
+
+void test_round_trip(void) {
+    test_setup("A cached image decodes to the program the compiler produced");
+    program_cache_reset_stats();
+    write_source(weapon_src, 1000000);
+
+    Program *compiled = compiler_compile_file(source_path);
+    Program *first = program_cache_compile_file(source_path);
+    Program *second = program_cache_compile_file(source_path);
+    const ProgramCacheStats *stats = program_cache_stats();
+    test_assert(stats->misses == 1 && stats->stores == 1, "The first load should compile and store");
+    test_assert(stats->hits == 1, "The second load should come from the image");
+    test_assert(second && second->source == NULL, "An image carries no source text");
+    test_assert(compiled && second && programs_equal(compiled, second),
+                "The image should match the compiled program");
+
+    /* And it runs */
+    VirtualMachine *vm = vm_init();
+    ObjProgram *program = obj_program_from(vm, "/test/weapon", second);
+    obj_t *obj = obj_new("/test/weapon");
+    obj_program_attach(obj, program);
+    test_assert(call_int(vm, obj, "hit", 12) == 24 && call_int(vm, obj, "hit", 3) == 3,
+                "Code loaded from an image should run");
+
+    obj_free(obj);
+    obj_program_release(program);
+    vm_free(vm);
+    program_free(compiled);
+    program_free(first);
+    program_free(second);
+}
+
+void test_invalidation(void) {
+    test_setup("Images follow the source's mtime and contents");
+    program_cache_reset_stats();
+    const ProgramCacheStats *stats = program_cache_stats();
+
+    /* Touched but unchanged: hashed once, then a plain hit again */
+    write_source(weapon_src, 2000000);
+    program_free(program_cache_compile_file(source_path));
+    test_assert(stats->rehashed == 1 && stats->misses == 0, "A touched file should be rehashed, not compiled");
+    program_free(program_cache_compile_file(source_path));
+    test_assert(stats->hits == 1, "The refreshed image should then hit");
+
+    /* Changed: compiled again */
+    write_source("int hit(int roll) { return roll + 1; }\n", 3000000);
+    Program *prog = program_cache_compile_file(source_path);
+    test_assert(stats->misses == 1 && prog && prog->function_count == 1,
+                "A changed file should be compiled again");
+    program_free(prog);
+
+    /* Same size and a new mtime: the content hash catches the edit */
+    write_source("int hit(int roll) { return roll + 2; }\n", 4000000);
+    prog = program_cache_compile_file(source_path);
+    test_assert(stats->misses == 2, "Equal size but new contents should recompile");
+    program_free(prog);
+}
+
+void test_inherits(void) {
+    test_setup("Inherits and inherited variable names survive the image");
+    program_cache_reset_stats();
+    const ProgramCacheStats *stats = program_cache_stats();
+    write_source("inherit \"/std/weapon\";\nint bonus;\n"
+                 "int total() { return damage + bonus; }\n", 4500000);
+
+    Program *compiled = compiler_compile_file(source_path);
+    program_free(program_cache_compile_file(source_path));
+    Program *cached = program_cache_compile_file(source_path);
+    test_assert(stats->hits == 1 && cached && cached->inherit_count == 1 && cached->extern_count == 1 &&
+                strcmp(cached->externs[0], "damage") == 0,
+                "The image should list the inherit and the inherited variable used");
+    test_assert(compiled && cached && programs_equal(compiled, cached),
+                "The image should match the compiled program");
+    program_free(compiled);
+    program_free(cached);
+}
+
+void test_damaged_image(void) {
+    test_setup("Damaged or truncated images are rejected and rewritten");
+    program_cache_reset_stats();
+    const ProgramCacheStats *stats = program_cache_stats();
+    write_source(weapon_src, 5000000);
+    program_free(program_cache_compile_file(source_path));
+    program_cache_reset_stats();
+
+    char image[256];
+    test_assert(program_cache_image_path(source_path, image, sizeof(image)) == 0, "Image path should resolve");
+    struct stat st;
+    stat(image, &st);
+
+    /* Flip a byte in the payload */
+    FILE *f = fopen(image, "r+b");
+    fseek(f, (long)sizeof(ProgramImageHeader) + 4, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, (long)sizeof(ProgramImageHeader) + 4, SEEK_SET);
+    fputc(c ^ 0xFF, f);
+    fclose(f);
+
+    Program *prog = program_cache_compile_file(source_path);
+    test_assert(prog && stats->rejected == 1 && stats->misses == 1,
+                "A corrupt image should be rejected and the file compiled");
+    program_free(prog);
+
+    /* Cut it short */
+    truncate(image, (off_t)(st.st_size / 2));
+    prog = program_cache_compile_file(source_path);
+    test_assert(prog && stats->rejected == 2 && stats->misses == 2,
+                "A truncated image should be rejected and the file compiled");
+    program_free(prog);
+
+    program_free(program_cache_compile_file(source_path));
+    test_assert(stats->hits == 1, "The rewritten image should hit");
+}
+
+void test_errors_and_off(void) {
+    test_setup("Failed compiles are not cached, and the cache can be off");
+    program_cache_reset_stats();
+    const ProgramCacheStats *stats = program_cache_stats();
+
+    write_source("int broken( { return\n", 6000000);
+    Program *prog = program_cache_compile_file(source_path);
+    test_assert(prog && prog->error_info.message && stats->stores == 0,
+                "A program with errors should not be stored");
+    program_free(prog);
+
+    program_cache_set_dir(NULL);
+    test_assert(program_cache_dir() == NULL, "Cache should report off");
+    write_source(weapon_src, 7000000);
+    prog = program_cache_compile_file(source_path);
+    test_assert(prog && prog->source != NULL && stats->misses == 1,
+                "With the cache off, files are compiled directly");
+    program_free(prog);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("Program Cache Test Suite\n");
+    printf("========================================\n");
+
+    snprintf(cache_root, sizeof(cache_root), "/tmp/amlp_cache_test_%d", (int)getpid());
+    snprintf(source_path, sizeof(source_path), "%s/weapon.lpc", cache_root);
+    mkdir(cache_root, 0755);
+
+    char image_dir[96];
+    snprintf(image_dir, sizeof(image_dir), "%s/images", cache_root);
+    test_assert(program_cache_dir() == NULL, "The cache should be off until configured");
+    program_cache_set_dir(image_dir);
+
+    test_round_trip();
+    test_invalidation();
+    test_inherits();
+    test_damaged_image();
+    test_errors_and_off();
+
+    char cmd[160];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", cache_root);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", cache_root);
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+/**
+ * test_scheduler.c - Scheduler Test Suite
+ *
+ * Tests for heart_beat, call_out and reset scheduling through the efuns
+ * LPC code uses, the per-pass budget and the statistics it keeps.
+ */
+
+#include "scheduler.h"
+#include "compiler.h"
+#include "program_loader.h"
+#include "object.h"
+#include "efun.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+/* What the test objects report through the record() efun */
+static int beats = 0;
+static int calls = 0;
+static long last_arg = 0;
+
+/* record(0) counts a heartbeat; record(n) counts a call_out given n */
+static VMValue efun_record(VirtualMachine *vm, VMValue *args, int arg_count) {
+    (void)vm;
+    if (arg_count == 1 && args[0].type == VALUE_INT) {
+        if (args[0].data.int_value == 0) {
+            beats++;
+        } else {
+            calls++;
+            last_arg = args[0].data.int_value;
+        }
+    }
+    return vm_value_create_int(0);
+}
+
+static VirtualMachine *new_vm(void) {
+    VirtualMachine *vm = vm_init();
+    if (vm) efun_register(vm->efun_registry, "record", efun_record, 1, 1, "void record(int)");
+    beats = calls = 0;
+    last_arg = 0;
+    return vm;
+}
+
+static const char *ticker_src =
+    "void create() { set_heart_beat(1); }\n"
+    "void heart_beat() { record(0); }\n"
+    "void stop() { set_heart_beat(0); }\n"
+    "void ping(int n) { record(n); }\n"
+    "int schedule(int delay, int n) { return call_out(\"ping\", delay, n); }\n"
+    "int find(int handle) { return find_call_out(handle); }\n"
+    "int cancel(int handle) { return remove_call_out(handle); }\n"
+    "int cancel_named() { return remove_call_out(\"ping\"); }\n";
+
+/* Load src into vm as a fresh object and run its create() */
+static obj_t *load_object_from(VirtualMachine *vm, const char *src, const char *name) {
+    Program *prog = compiler_compile_string(src, name);
+    if (!prog) return NULL;
+
+    int first_function = vm->function_count;
+    if (program_loader_load(vm, prog) != 0) {
+        program_free(prog);
+        return NULL;
+    }
+
+    obj_t *obj = obj_new(name);
+    for (size_t i = 0; obj && i < prog->function_count; i++) {
+        VMFunction *fn = vm->functions[first_function + (int)i];
+        if (fn) obj_add_method(obj, fn);
+    }
+    program_free(prog);
+
+    if (obj) obj_call_method(vm, obj, "create", NULL, 0);
+    return obj;
+}
+
+static long call_int(VirtualMachine *vm, obj_t *obj, const char *method, VMValue *args, int argc) {
+    VMValue result = obj_call_method(vm, obj, method, args, argc);
+    return result.type == VALUE_INT ? result.data.int_value : -999;
+}
+
+/* Run the scheduler at ms after its origin */
+static int run_at(Scheduler *sched, VirtualMachine *vm, unsigned long long ms) {
+    return scheduler_run(sched, vm, sched->origin_ms + ms);
+}
+
+static int task_runs = 0;
+
+static void counting_task(void *ctx) {
+    (void)ctx;
+    task_runs++;
+}
+
+/* ========== Tests ========== */
+
+void test_heart_beat(void) {
+    test_setup("set_heart_beat() calls heart_beat() once per heartbeat");
+
+    VirtualMachine *vm = new_vm();
+    Scheduler *sched = scheduler_global();
+    obj_t *obj = load_object_from(vm, ticker_src, "/test/ticker");
+    test_assert(obj != NULL, "Ticker should load");
+    if (!obj) {
+        vm_free(vm);
+        return;
+    }
+
+    test_assert(sched->pending[SCHED_HEART_BEAT] == 1 && scheduler_query_heart_beat(obj) == 1,
+                "create() should have started a heartbeat");
+
+    unsigned long long ms = 0;
+    for (int i = 0; i < 100; i++) {
+        ms += SCHEDULER_TICK_MS;
+        run_at(sched, vm, ms);
+    }
+    test_assert(beats == 5, "Ten seconds should hold exactly five heartbeats");
+
+    /* A long stall runs the missed heartbeat once, not once per missed beat */
+    ms += 10 * SCHEDULER_HEART_BEAT_MS;
+    run_at(sched, vm, ms);
+    test_assert(beats == 6, "A stalled heartbeat should run once and skip ahead");
+
+    call_int(vm, obj, "stop", NULL, 0);
+    test_assert(sched->pending[SCHED_HEART_BEAT] == 0 && scheduler_query_heart_beat(obj) == 0,
+                "set_heart_beat(0) should stop the heartbeat");
+
+    obj_free(obj);
+    vm_free(vm);
+}
+
+void test_call_out(void) {
+    test_setup("call_out() runs once with its arguments; find and remove see it");
+
+    VirtualMachine *vm = new_vm();
+    Scheduler *sched = scheduler_global();
+    obj_t *obj = load_object_from(vm, ticker_src, "/test/caller");
+    if (!obj) {
+        test_assert(0, "Caller should load");
+        vm_free(vm);
+        return;
+    }
+    call_int(vm, obj, "stop", NULL, 0);
+
+    unsigned long long ms = (unsigned long long)sched->wheel.now * SCHEDULER_TICK_MS;
+    VMValue args[2] = { vm_value_create_int(3), vm_value_create_int(42) };
+    long handle = call_int(vm, obj, "schedule", args, 2);
+    test_assert(handle > 0, "call_out() should return a handle");
+
+    VMValue h = vm_value_create_int(handle);
+    test_assert(call_int(vm, obj, "find", &h, 1) == 3, "find_call_out() should report 3 seconds left");
+
+    run_at(sched, vm, ms + 2900);
+    test_assert(calls == 0, "Nothing should run before 3 seconds");
+    run_at(sched, vm, ms + 3000);
+    test_assert(calls == 1 && last_arg == 42, "The call_out should run once with its argument");
+    test_assert(call_int(vm, obj, "find", &h, 1) == -1, "A finished call_out should be gone");
+
+    /* Removed by handle and by name */
+    ms += 3000;
+    args[0] = vm_value_create_int(5);
+    h = vm_value_create_int(call_int(vm, obj, "schedule", args, 2));
+    call_int(vm, obj, "schedule", args, 2);
+    test_assert(call_int(vm, obj, "cancel", &h, 1) == 5, "remove_call_out() should return the time left");
+    test_assert(call_int(vm, obj, "cancel_named", NULL, 0) == 5, "remove_call_out(name) should find the other");
+    test_assert(call_int(vm, obj, "cancel_named", NULL, 0) == -1, "Nothing should be left to remove");
+    run_at(sched, vm, ms + 10000);
+    test_assert(calls == 1, "Removed call_outs should not run");
+
+    /* Destroying the object cancels what it scheduled */
+    call_int(vm, obj, "schedule", args, 2);
+    test_assert(sched->pending[SCHED_CALL_OUT] == 1, "One call_out should be pending");
+    obj_free(obj);
+    test_assert(sched->pending[SCHED_CALL_OUT] == 0, "obj_free() should cancel the call_out");
+
+    vm_free(vm);
+}
+
+void test_budget_and_stats(void) {
+    test_setup("A pass over budget defers the rest to later passes");
+
+    VirtualMachine *vm = new_vm();
+    Scheduler *sched = scheduler_global();
+    enum { TICKERS = 40 };
+    obj_t *tickers[TICKERS];
+    int loaded = 0;
+    for (int i = 0; i < TICKERS; i++) {
+        tickers[i] = load_object_from(vm, ticker_src, "/test/npc");
+        if (tickers[i]) loaded++;
+    }
+    test_assert(loaded == TICKERS, "Every ticker should load");
+    if (loaded != TICKERS) {
+        vm_free(vm);
+        return;
+    }
+
+    /* Stall past one heartbeat so every ticker is due in the same pass */
+    unsigned long long ms = (unsigned long long)sched->wheel.now * SCHEDULER_TICK_MS;
+    scheduler_set_budget(sched, 10, 1000000);
+    unsigned long long overruns = sched->stats.overruns;
+    unsigned long long runs = sched->stats.runs[SCHED_HEART_BEAT];
+
+    ms += SCHEDULER_HEART_BEAT_MS;
+    int wait = run_at(sched, vm, ms);
+    test_assert(wait == 0 && sched->ready_count == TICKERS - 10,
+                "Only the budget should run, and the caller should be told to come back");
+    test_assert(sched->stats.overruns > overruns, "The pass should count as an overrun");
+
+    for (int pass = 0; pass < 3; pass++) run_at(sched, vm, ms);
+    test_assert(sched->stats.runs[SCHED_HEART_BEAT] - runs == TICKERS && sched->ready_count == 0,
+                "Later passes should finish the deferred heartbeats");
+    test_assert(run_at(sched, vm, ms) > 0, "With the queue drained it should wait for the next tick");
+
+    char stats[2048];
+    scheduler_format_stats(sched, stats, sizeof(stats));
+    test_assert(strstr(stats, "overruns") != NULL && strstr(stats, "heart_beat") != NULL,
+                "Stats should report overruns and heartbeat runs");
+
+    scheduler_set_budget(sched, SCHEDULER_MAX_CALLBACKS, SCHEDULER_BUDGET_USEC);
+    for (int i = 0; i < TICKERS; i++) obj_free(tickers[i]);
+    test_assert(sched->pending[SCHED_HEART_BEAT] == 0, "Freed tickers should leave no heartbeats");
+
+    vm_free(vm);
+}
+
+void test_tasks_and_reset(void) {
+    test_setup("Native tasks repeat; reset() is scheduled only where defined");
+
+    VirtualMachine *vm = new_vm();
+    Scheduler *sched = scheduler_global();
+    unsigned long long ms = (unsigned long long)sched->wheel.now * SCHEDULER_TICK_MS;
+
+    task_runs = 0;
+    SchedEntry *task = scheduler_every(sched, 1000, counting_task, NULL);
+    for (int i = 1; i <= 50; i++) run_at(sched, vm, ms + (unsigned long long)i * SCHEDULER_TICK_MS);
+    test_assert(task_runs == 5, "A one-second task should run five times in five seconds");
+    scheduler_cancel(task);
+    test_assert(sched->pending[SCHED_TASK] == 0, "A cancelled task should be gone");
+
+    obj_t *plain = load_object_from(vm, "void create() { }\n", "/test/plain");
+    obj_t *resets = load_object_from(vm, "void reset() { record(0); }\n", "/test/resets");
+    test_assert(plain && resets, "Both objects should load");
+    if (plain && resets) {
+        test_assert(scheduler_arm_reset(sched, plain) == 0, "No reset() means no reset timer");
+        test_assert(scheduler_arm_reset(sched, resets) == 1 && sched->pending[SCHED_RESET] == 1,
+                    "An object with reset() should get a reset timer");
+    }
+    obj_free(plain);
+    obj_free(resets);
+    test_assert(sched->pending[SCHED_RESET] == 0, "Freeing the object should cancel its reset");
+
+    vm_free(vm);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("Scheduler Test Suite\n");
+    printf("========================================\n");
+
+    test_heart_beat();
+    test_call_out();
+    test_budget_and_stats();
+    test_tasks_and_reset();
+
+    scheduler_free(scheduler_global());
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
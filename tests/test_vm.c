@@ -938,6 +938,43 @@ void test_array_index(void) {
     vm_free(vm);
 }
 
+void test_array_slice(void) {
+    test_setup("Array slice: [10, 20, 30, 40][1..2] = [20, 30]");
+    VirtualMachine *vm = vm_init();
+    
+    /* Preload stack: the array */
+    array_t *arr = array_new(vm->gc, 4);
+    for (int i = 1; i <= 4; i++) {
+        array_push(arr, vm_value_create_int(i * 10));
+    }
+    VMValue arr_val;
+    arr_val.type = VALUE_ARRAY;
+    arr_val.data.array_value = arr;
+    vm_push_value(vm, arr_val);
+    
+    OpCode opcodes[] = {
+        OP_PUSH_INT,           // Start 1
+        OP_PUSH_INT,           // End 2
+        OP_SLICE_RANGE,        // Slice [1..2]
+        OP_HALT
+    };
+    long int_args[] = {1, 2, 0, 0};
+    double float_args[] = {0, 0, 0, 0};
+    char *string_args[] = {NULL, NULL, NULL, NULL};
+    
+    load_bytecode(vm, opcodes, int_args, float_args, string_args, 4);
+    vm_execute(vm);
+    
+    VMValue result = vm->stack->values[0];
+    array_t *slice = result.type == VALUE_ARRAY ? result.data.array_value : NULL;
+    test_assert(slice && array_length(slice) == 2 &&
+                array_get(slice, 0).data.int_value == 20 &&
+                array_get(slice, 1).data.int_value == 30,
+                "Expected slice [20, 30]");
+    
+    vm_free(vm);
+}
+
 /* ========== TESTS: Mapping Operations ========== */
 
 void test_make_mapping(void) {
@@ -1107,6 +1144,470 @@ void test_call_method_missing(void) {
     vm_free(vm);
 }
 
+/* send(o): return o->get_value() */
+static VMFunction* make_send_function(void) {
+    VMFunction *func = vm_function_create("send", 1, 0);
+    VMInstruction ins1 = { .opcode = OP_LOAD_LOCAL, .operand.int_operand = 0 };
+    VMInstruction ins2 = { .opcode = OP_PUSH_STRING, .operand.string_operand = "get_value" };
+    VMInstruction ins3 = { .opcode = OP_CALL_METHOD, .operand.int_operand = 0 };
+    VMInstruction ins4 = { .opcode = OP_RETURN, .operand.int_operand = 0 };
+    vm_function_add_instruction(func, ins1);
+    vm_function_add_instruction(func, ins2);
+    vm_function_add_instruction(func, ins3);
+    vm_function_add_instruction(func, ins4);
+    return func;
+}
+
+static long send_to(VirtualMachine *vm, int send_idx, obj_t *obj) {
+    vm_push_value(vm, make_object(obj));
+    vm_call_function(vm, send_idx, 1);
+    VMValue result = vm_pop_value(vm);
+    return result.type == VALUE_INT ? result.data.int_value : -1;
+}
+
+void test_call_method_inline_cache(void) {
+    test_setup("OP_CALL_METHOD site caches per method table");
+    VirtualMachine *vm = vm_init();
+
+    VMFunction *sword_value = make_const_method("get_value", 10);
+    VMFunction *shield_value = make_const_method("get_value", 20);
+    vm_add_function(vm, sword_value);
+    vm_add_function(vm, shield_value);
+    int send_idx = vm_add_function(vm, make_send_function());
+
+    obj_t *sword = obj_new("sword");
+    obj_add_method(sword, sword_value);
+    obj_t *shield = obj_new("shield");
+    obj_add_method(shield, shield_value);
+    obj_t *sword_a = obj_clone(sword);
+    obj_t *sword_b = obj_clone(sword);
+
+    long first = send_to(vm, send_idx, sword_a);
+    unsigned long misses = vm->profile.method_cache_misses;
+    long second = send_to(vm, send_idx, sword_b);
+    test_assert(first == 10 && second == 10, "Expected both clones to answer 10");
+    test_assert(misses == 1 && vm->profile.method_cache_hits == 1,
+                "Expected the second clone to hit the monomorphic cache");
+
+    /* A second program at the same site makes it polymorphic */
+    long third = send_to(vm, send_idx, shield);
+    long fourth = send_to(vm, send_idx, sword_a);
+    test_assert(third == 20 && fourth == 10, "Expected each receiver's own method");
+    test_assert(vm->profile.method_cache_misses == 2 && vm->profile.method_cache_hits == 2,
+                "Expected both receivers to stay cached");
+    test_assert(vm->stack->top == 0, "Expected a balanced stack after method calls");
+
+    obj_free(sword_a);
+    obj_free(sword_b);
+    obj_free(shield);
+    obj_free(sword);
+    vm_free(vm);
+}
+
+/* ========== TESTS: Call Linking ========== */
+
+static VMInstruction make_call(const char *name, int arg_count) {
+    VMInstruction ins;
+    memset(&ins, 0, sizeof(ins));
+    ins.opcode = OP_CALL;
+    ins.operand.call_operand.arg_count = arg_count;
+    ins.operand.call_operand.name = (char *)name;
+    return ins;
+}
+
+void test_link_calls(void) {
+    test_setup("Link OP_CALL sites to functions and efuns");
+    VirtualMachine *vm = vm_init();
+
+    int sum_idx = vm_add_function(vm, make_sum_method("sum"));
+
+    /* caller(): return sum(3, 4) + strlen("abc") */
+    VMFunction *caller = vm_function_create("caller", 0, 0);
+    VMInstruction ins = { .opcode = OP_PUSH_INT, .operand.int_operand = 3 };
+    vm_function_add_instruction(caller, ins);
+    ins.operand.int_operand = 4;
+    vm_function_add_instruction(caller, ins);
+    vm_function_add_instruction(caller, make_call("sum", 2));
+    VMInstruction str = { .opcode = OP_PUSH_STRING, .operand.string_operand = "abc" };
+    vm_function_add_instruction(caller, str);
+    vm_function_add_instruction(caller, make_call("strlen", 1));
+    VMInstruction add = { .opcode = OP_ADD, .operand.int_operand = 0 };
+    vm_function_add_instruction(caller, add);
+    VMInstruction ret = { .opcode = OP_RETURN, .operand.int_operand = 0 };
+    vm_function_add_instruction(caller, ret);
+    int caller_idx = vm_add_function(vm, caller);
+
+    int unresolved = vm_link_calls(vm, 0, vm->function_count);
+    test_assert(unresolved == 0, "Expected every call site to link");
+    VMInstruction site;
+    vm_function_decode(caller, 2, &site);
+    test_assert(site.operand.call_operand.link == VM_CALL_LOCAL &&
+                site.operand.call_operand.target == sum_idx,
+                "Expected sum() bound to its function index");
+    vm_function_decode(caller, 4, &site);
+    test_assert(site.operand.call_operand.link == VM_CALL_EFUN,
+                "Expected strlen() bound to the efun table");
+
+    int status = vm_call_function(vm, caller_idx, 0);
+    test_assert(status == 0 && vm->stack->top == 1, "Expected call to leave only its result");
+    VMValue result = vm_pop_value(vm);
+    test_assert(result.type == VALUE_INT && result.data.int_value == 10,
+                "Expected sum(3, 4) + strlen(\"abc\") = 10");
+
+    vm_free(vm);
+}
+
+void test_call_cache_invalidation(void) {
+    test_setup("Cross-program call cache follows a reloaded function");
+    VirtualMachine *vm = vm_init();
+
+    /* "Program" A: value() returns 1 */
+    vm_add_function(vm, make_const_method("value", 1));
+    vm_link_calls(vm, 0, 1);
+
+    /* "Program" B: caller() returns value(), linked against A */
+    VMFunction *caller = vm_function_create("caller", 0, 0);
+    vm_function_add_instruction(caller, make_call("value", 0));
+    VMInstruction ret = { .opcode = OP_RETURN, .operand.int_operand = 0 };
+    vm_function_add_instruction(caller, ret);
+    int caller_idx = vm_add_function(vm, caller);
+    vm_link_calls(vm, caller_idx, 1);
+
+    VMInstruction site;
+    vm_function_decode(caller, 0, &site);
+    test_assert(site.operand.call_operand.link == VM_CALL_CACHED,
+                "Expected cross-program call to be cached");
+
+    vm_call_function(vm, caller_idx, 0);
+    VMValue first = vm_pop_value(vm);
+
+    /* Reload A: value() now returns 2 */
+    int reloaded = vm_add_function(vm, make_const_method("value", 2));
+    vm_link_calls(vm, reloaded, 1);
+
+    vm_call_function(vm, caller_idx, 0);
+    VMValue second = vm_pop_value(vm);
+
+    test_assert(first.type == VALUE_INT && first.data.int_value == 1 &&
+                second.type == VALUE_INT && second.data.int_value == 2,
+                "Expected the cached call to pick up the reloaded definition");
+
+    vm_free(vm);
+}
+
+/* ========== TESTS: Frame Stack ========== */
+
+void test_locals_alias_arguments(void) {
+    test_setup("Locals live in place over the argument slots");
+    VirtualMachine *vm = vm_init();
+
+    /* swap_sub(a, b): tmp = a; a = b; b = tmp; return a - b; */
+    VMFunction *func = vm_function_create("swap_sub", 2, 1);
+    VMInstruction load = { .opcode = OP_LOAD_LOCAL };
+    VMInstruction store = { .opcode = OP_STORE_LOCAL };
+    load.operand.int_operand = 0;  vm_function_add_instruction(func, load);
+    store.operand.int_operand = 2; vm_function_add_instruction(func, store);
+    load.operand.int_operand = 1;  vm_function_add_instruction(func, load);
+    store.operand.int_operand = 0; vm_function_add_instruction(func, store);
+    load.operand.int_operand = 2;  vm_function_add_instruction(func, load);
+    store.operand.int_operand = 1; vm_function_add_instruction(func, store);
+    load.operand.int_operand = 0;  vm_function_add_instruction(func, load);
+    load.operand.int_operand = 1;  vm_function_add_instruction(func, load);
+    VMInstruction sub = { .opcode = OP_SUB, .operand.int_operand = 0 };
+    vm_function_add_instruction(func, sub);
+    VMInstruction ret = { .opcode = OP_RETURN, .operand.int_operand = 0 };
+    vm_function_add_instruction(func, ret);
+    int idx = vm_add_function(vm, func);
+
+    vm_push_value(vm, make_int(99));   /* caller's own value below the args */
+    vm_push_value(vm, make_int(3));
+    vm_push_value(vm, make_int(10));
+    int status = vm_call_function(vm, idx, 2);
+
+    test_assert(status == 0 && vm->stack->top == 2, "Expected args and locals replaced by one result");
+    VMValue result = vm_pop_value(vm);
+    test_assert(result.type == VALUE_INT && result.data.int_value == 7, "Expected swap_sub(3, 10) = 7");
+    test_assert(vm->stack->values[0].data.int_value == 99, "Expected caller's value untouched");
+    test_assert(vm->frame_count == 0 && vm->current_frame == NULL, "Expected the frame stack empty");
+
+    vm_free(vm);
+}
+
+void test_call_depth_limit(void) {
+    test_setup("Runaway recursion stops at the call depth limit");
+    VirtualMachine *vm = vm_init();
+
+    /* recurse(n): return recurse(n + 1); */
+    VMFunction *func = vm_function_create("recurse", 1, 0);
+    VMInstruction load = { .opcode = OP_LOAD_LOCAL, .operand.int_operand = 0 };
+    VMInstruction one = { .opcode = OP_PUSH_INT, .operand.int_operand = 1 };
+    VMInstruction add = { .opcode = OP_ADD, .operand.int_operand = 0 };
+    VMInstruction ret = { .opcode = OP_RETURN, .operand.int_operand = 0 };
+    vm_function_add_instruction(func, load);
+    vm_function_add_instruction(func, one);
+    vm_function_add_instruction(func, add);
+    vm_function_add_instruction(func, make_call("recurse", 1));
+    vm_function_add_instruction(func, ret);
+    int idx = vm_add_function(vm, func);
+    vm_link_calls(vm, idx, 1);
+
+    vm_push_value(vm, make_int(0));
+    int status = vm_call_function(vm, idx, 1);
+
+    test_assert(status == -1, "Expected the call to fail");
+    test_assert(strstr(vm->last_error, "Too deep recursion") != NULL,
+                "Expected a recursion error message");
+    test_assert(vm->stack->top == 0, "Expected every frame's values released");
+    test_assert(vm->frame_count == 0 && vm->current_frame == NULL, "Expected the frame stack unwound");
+
+    /* The VM stays usable afterwards */
+    int sum_idx = vm_add_function(vm, make_sum_method("sum"));
+    vm_push_value(vm, make_int(2));
+    vm_push_value(vm, make_int(5));
+    status = vm_call_function(vm, sum_idx, 2);
+    VMValue result = vm_pop_value(vm);
+    test_assert(status == 0 && result.type == VALUE_INT && result.data.int_value == 7,
+                "Expected a normal call to work after the error");
+
+    vm_free(vm);
+}
+
+void test_traced_dispatch(void) {
+    test_setup("Traced dispatch loop runs the same code");
+    VirtualMachine *vm = vm_init();
+    int sum_idx = vm_add_function(vm, make_sum_method("sum"));
+
+    FILE *trace = tmpfile();
+    vm->trace_output = trace;
+    vm_debug_enable(vm, VM_DEBUG_TRACE);
+
+    vm_push_value(vm, make_int(20));
+    vm_push_value(vm, make_int(22));
+    int status = vm_call_function(vm, sum_idx, 2);
+    VMValue result = vm_pop_value(vm);
+    test_assert(status == 0 && result.type == VALUE_INT && result.data.int_value == 42,
+                "Expected sum(20, 22) = 42 under tracing");
+    test_assert(trace && ftell(trace) > 0, "Expected the trace loop to log instructions");
+
+    vm_free(vm);
+}
+
+void test_packed_code(void) {
+    test_setup("Instructions pack into one word with operands in side tables");
+    VirtualMachine *vm = vm_init();
+
+    /* wide(): strlen("abc"); 2.5; return -5 + 10000000000; */
+    VMFunction *func = vm_function_create("wide", 0, 0);
+    VMInstruction wide = { .opcode = OP_PUSH_INT, .operand.int_operand = 10000000000L };
+    VMInstruction small = { .opcode = OP_PUSH_INT, .operand.int_operand = -5 };
+    VMInstruction flt = { .opcode = OP_PUSH_FLOAT, .operand.float_operand = 2.5 };
+    VMInstruction str = { .opcode = OP_PUSH_STRING, .operand.string_operand = "abc" };
+    VMInstruction pop = { .opcode = OP_POP };
+    VMInstruction add = { .opcode = OP_ADD };
+    VMInstruction ret = { .opcode = OP_RETURN };
+    vm_function_add_instruction(func, str);
+    vm_function_add_instruction(func, make_call("strlen", 1));
+    vm_function_add_instruction(func, pop);
+    vm_function_add_instruction(func, flt);
+    vm_function_add_instruction(func, pop);
+    vm_function_add_instruction(func, small);
+    vm_function_add_instruction(func, wide);
+    vm_function_add_instruction(func, add);
+    vm_function_add_instruction(func, ret);
+
+    test_assert(sizeof(VMCode) == 4, "Expected 4-byte instructions");
+    test_assert(func->instruction_count == 9, "Expected one word per instruction");
+    test_assert(VM_CODE_OP(func->code[6]) == OP_PUSH_CONST, "Expected a wide int in the constant table");
+    test_assert(VM_CODE_OP(func->code[5]) == OP_PUSH_INT && VM_CODE_SIMM(func->code[5]) == -5,
+                "Expected a small int as a signed immediate");
+
+    VMInstruction decoded;
+    vm_function_decode(func, 0, &decoded);
+    test_assert(decoded.opcode == OP_PUSH_STRING && strcmp(decoded.operand.string_operand, "abc") == 0,
+                "Expected the string to decode from the constant table");
+    vm_function_decode(func, 1, &decoded);
+    test_assert(decoded.opcode == OP_CALL && decoded.operand.call_operand.arg_count == 1 &&
+                strcmp(decoded.operand.call_operand.name, "strlen") == 0,
+                "Expected the call to decode from its call site");
+    vm_function_decode(func, 3, &decoded);
+    test_assert(decoded.opcode == OP_PUSH_FLOAT && decoded.operand.float_operand == 2.5,
+                "Expected the float to decode from the constant table");
+    vm_function_decode(func, 6, &decoded);
+    test_assert(decoded.opcode == OP_PUSH_INT && decoded.operand.int_operand == 10000000000L,
+                "Expected the wide int to decode as PUSH_INT");
+
+    int idx = vm_add_function(vm, func);
+    vm_link_calls(vm, idx, 1);
+    int status = vm_call_function(vm, idx, 0);
+    VMValue result = vm_pop_value(vm);
+    test_assert(status == 0 && result.type == VALUE_INT && result.data.int_value == 9999999995L,
+                "Expected wide() = 9999999995");
+
+    vm_free(vm);
+}
+
+/* ========== TESTS: Optimizer ========== */
+
+/* sum_below(n): for (i = 0, sum = 0; i < n; i = i + 1) sum = sum + i; return sum; */
+static VMFunction *make_sum_below(const char *name) {
+    VMFunction *func = vm_function_create(name, 1, 2);
+    vm_function_emit(func, OP_PUSH_INT, 0);         /* 0 */
+    vm_function_emit(func, OP_STORE_LOCAL, 1);      /* 1: i */
+    vm_function_emit(func, OP_PUSH_INT, 0);         /* 2 */
+    vm_function_emit(func, OP_STORE_LOCAL, 2);      /* 3: sum */
+    vm_function_emit(func, OP_LOAD_LOCAL, 1);       /* 4: loop head */
+    vm_function_emit(func, OP_LOAD_LOCAL, 0);       /* 5 */
+    vm_function_emit(func, OP_LT, 0);               /* 6 */
+    vm_function_emit(func, OP_JUMP_IF_FALSE, 17);   /* 7 */
+    vm_function_emit(func, OP_LOAD_LOCAL, 2);       /* 8 */
+    vm_function_emit(func, OP_LOAD_LOCAL, 1);       /* 9 */
+    vm_function_emit(func, OP_ADD, 0);              /* 10 */
+    vm_function_emit(func, OP_STORE_LOCAL, 2);      /* 11 */
+    vm_function_emit(func, OP_LOAD_LOCAL, 1);       /* 12 */
+    vm_function_emit(func, OP_PUSH_INT, 1);         /* 13 */
+    vm_function_emit(func, OP_ADD, 0);              /* 14 */
+    vm_function_emit(func, OP_STORE_LOCAL, 1);      /* 15 */
+    vm_function_emit(func, OP_JUMP, 4);             /* 16 */
+    vm_function_emit(func, OP_LOAD_LOCAL, 2);       /* 17: exit */
+    vm_function_emit(func, OP_RETURN, 0);           /* 18 */
+    return func;
+}
+
+static int count_opcode(VMFunction *func, OpCode opcode) {
+    int n = 0;
+    for (int i = 0; i < func->instruction_count; i++) {
+        if (VM_CODE_OP(func->code[i]) == opcode) n++;
+    }
+    return n;
+}
+
+void test_optimize_superinstructions(void) {
+    test_setup("Optimizer fuses loop code into superinstructions");
+    VirtualMachine *vm = vm_init();
+
+    VMFunction *plain = make_sum_below("plain");
+    VMFunction *fused = make_sum_below("fused");
+    int removed = vm_optimize_function(fused, VM_OPT_FUSE);
+
+    test_assert(removed > 0 && fused->instruction_count == plain->instruction_count - removed,
+                "Expected the optimized loop to be shorter");
+    test_assert(count_opcode(fused, OP_INC_LOCAL) == 1, "Expected i = i + 1 as INC_LOCAL");
+    test_assert(count_opcode(fused, OP_CMP_JUMP_IF_FALSE) == 1, "Expected LT; JUMP_IF_FALSE fused");
+    test_assert(count_opcode(fused, OP_LOAD_LOCAL_LOAD_LOCAL) == 2, "Expected paired local loads");
+    test_assert(count_opcode(fused, OP_RETURN_LOCAL) == 1, "Expected LOAD_LOCAL; RETURN fused");
+
+    int plain_idx = vm_add_function(vm, plain);
+    int fused_idx = vm_add_function(vm, fused);
+    vm_push_value(vm, make_int(100));
+    vm_call_function(vm, plain_idx, 1);
+    VMValue expected = vm_pop_value(vm);
+    vm_push_value(vm, make_int(100));
+    int status = vm_call_function(vm, fused_idx, 1);
+    VMValue actual = vm_pop_value(vm);
+    test_assert(status == 0 && expected.type == VALUE_INT && actual.type == VALUE_INT &&
+                actual.data.int_value == expected.data.int_value && actual.data.int_value == 4950,
+                "Expected both versions to return 4950");
+
+    /* Non-int operands take the generic path */
+    vm_push_value(vm, vm_value_create_float(2.5));
+    status = vm_call_function(vm, fused_idx, 1);
+    actual = vm_pop_value(vm);
+    test_assert(status == 0 && actual.type == VALUE_INT && actual.data.int_value == 3,
+                "Expected sum_below(2.5) = 0 + 1 + 2");
+
+    vm_free(vm);
+}
+
+void test_optimize_folding(void) {
+    test_setup("Optimizer folds constants and removes dead jumps");
+    VirtualMachine *vm = vm_init();
+
+    /* folded(): if (2 * 3 > 5) return 10 - 4; return 99; */
+    VMFunction *func = vm_function_create("folded", 0, 0);
+    vm_function_emit(func, OP_PUSH_INT, 2);         /* 0 */
+    vm_function_emit(func, OP_PUSH_INT, 3);         /* 1 */
+    vm_function_emit(func, OP_MUL, 0);              /* 2 */
+    vm_function_emit(func, OP_PUSH_INT, 5);         /* 3 */
+    vm_function_emit(func, OP_GT, 0);               /* 4 */
+    vm_function_emit(func, OP_JUMP_IF_FALSE, 10);   /* 5 */
+    vm_function_emit(func, OP_PUSH_INT, 10);        /* 6 */
+    vm_function_emit(func, OP_PUSH_INT, 4);         /* 7 */
+    vm_function_emit(func, OP_SUB, 0);              /* 8 */
+    vm_function_emit(func, OP_RETURN, 0);           /* 9 */
+    vm_function_emit(func, OP_PUSH_INT, 99);        /* 10 */
+    vm_function_emit(func, OP_RETURN, 0);           /* 11 */
+    vm_optimize_function(func, VM_OPT_PEEPHOLE);
+
+    test_assert(func->instruction_count == 2, "Expected only PUSH_INT 6; RETURN to remain");
+    test_assert(VM_CODE_OP(func->code[0]) == OP_PUSH_INT && VM_CODE_SIMM(func->code[0]) == 6,
+                "Expected 10 - 4 folded to 6");
+
+    /* A jump target is never folded into the instruction before it */
+    VMFunction *guarded = vm_function_create("guarded", 1, 0);
+    vm_function_emit(guarded, OP_LOAD_LOCAL, 0);     /* 0 */
+    vm_function_emit(guarded, OP_JUMP_IF_FALSE, 4);  /* 1 */
+    vm_function_emit(guarded, OP_PUSH_INT, 1);       /* 2 */
+    vm_function_emit(guarded, OP_JUMP, 5);           /* 3 */
+    vm_function_emit(guarded, OP_PUSH_INT, 2);       /* 4 */
+    vm_function_emit(guarded, OP_PUSH_INT, 40);      /* 5: join */
+    vm_function_emit(guarded, OP_ADD, 0);            /* 6 */
+    vm_function_emit(guarded, OP_RETURN, 0);         /* 7 */
+    vm_optimize_function(guarded, VM_OPT_FUSE);
+
+    int idx = vm_add_function(vm, func);
+    int guarded_idx = vm_add_function(vm, guarded);
+    int status = vm_call_function(vm, idx, 0);
+    VMValue result = vm_pop_value(vm);
+    test_assert(status == 0 && result.type == VALUE_INT && result.data.int_value == 6,
+                "Expected folded() = 6");
+    vm_push_value(vm, make_int(1));
+    vm_call_function(vm, guarded_idx, 1);
+    result = vm_pop_value(vm);
+    test_assert(result.type == VALUE_INT && result.data.int_value == 41, "Expected guarded(1) = 41");
+    vm_push_value(vm, make_int(0));
+    vm_call_function(vm, guarded_idx, 1);
+    result = vm_pop_value(vm);
+    test_assert(result.type == VALUE_INT && result.data.int_value == 42, "Expected guarded(0) = 42");
+
+    vm_free(vm);
+}
+
+void test_string_interning(void) {
+    test_setup("Equal string constants share one interned copy");
+    VirtualMachine *vm = vm_init();
+
+    char *a = vm_string_intern("lantern");
+    char *b = vm_string_intern("lantern");
+    test_assert(a && a == b && vm_string_is_interned(a), "Expected one copy per contents");
+    test_assert(vm_string_hash(a) == vm_hash_cstring("lantern"), "Expected the cached hash to match");
+
+    VMValue copy = vm_value_create_string("lantern");
+    test_assert(copy.data.string_value != a && vm_string_equal(copy.data.string_value, a),
+                "Expected an uninterned copy to compare equal by contents");
+    vm_value_intern(&copy);
+    test_assert(copy.data.string_value == a, "Expected interning a copy to yield the shared string");
+
+    /* Two functions pushing the same literal share the constant */
+    VMInstruction str = { .opcode = OP_PUSH_STRING, .operand.string_operand = "lantern" };
+    VMFunction *f1 = vm_function_create("f1", 0, 0);
+    VMFunction *f2 = vm_function_create("f2", 0, 0);
+    vm_function_add_instruction(f1, str);
+    vm_function_add_instruction(f2, str);
+    test_assert(f1->constants[0].data.string_value == a && f2->constants[0].data.string_value == a,
+                "Expected PUSH_STRING constants to be interned at load");
+
+    int interned = vm_string_intern_count();
+    vm_function_free(f1);
+    vm_function_free(f2);
+    vm_value_release(&copy);
+    vm_string_release(a);
+    test_assert(vm_string_intern_count() == interned, "Expected the string to stay while referenced");
+    vm_string_release(b);
+    test_assert(vm_string_intern_count() == interned - 1, "Expected the last release to unintern");
+
+    vm_free(vm);
+}
+
 /* ========== Main Test Runner ========== */
 
 int main(void) {
@@ -1169,6 +1670,7 @@ int main(void) {
     /* Arrays and mappings */
     test_make_array();
     test_array_index();
+    test_array_slice();
     test_make_mapping();
 
     /* Object method calls */
@@ -1176,6 +1678,21 @@ int main(void) {
     test_call_method_inherited();
     test_call_method_with_args();
     test_call_method_missing();
+
+    test_call_method_inline_cache();
+
+    /* Call linking */
+    test_link_calls();
+    test_call_cache_invalidation();
+
+    /* Frame stack */
+    test_locals_alias_arguments();
+    test_call_depth_limit();
+    test_traced_dispatch();
+    test_packed_code();
+    test_optimize_superinstructions();
+    test_optimize_folding();
+    test_string_interning();
     
     print_summary();
     return tests_failed == 0 ? 0 : 1;
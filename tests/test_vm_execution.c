@@ -251,13 +251,16 @@ void test_bytecode_decoder() {
         OP_HALT
     };
     
-    VMInstruction instr;
-    int bytes_read = program_loader_decode_instruction(bytecode, 0, &instr);
+    VMFunction *func = vm_function_create("decode", 0, 0);
+    int bytes_read = program_loader_decode_instruction(bytecode, 0, func);
     
-    if (bytes_read < 0) {
+    VMInstruction instr;
+    if (bytes_read != 9 || vm_function_decode(func, 0, &instr) != 0) {
+        vm_function_free(func);
         TEST_FAIL("Failed to decode instruction");
         return;
     }
+    vm_function_free(func);
     
     if (instr.opcode != OP_PUSH_INT) {
         TEST_FAIL("Wrong opcode decoded");
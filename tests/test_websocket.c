@@ -0,0 +1,436 @@
+/**
+ * test_websocket.c - WebSocket Frame Parser Test Suite
+ *
+ * Tests for word-at-a-time unmasking, the incremental parser on whole,
+ * split and fragmented messages with control frames in between, its
+ * protocol checks, and a fuzz pass: random message streams fed in random
+ * read sizes must come out exactly as sent, and random bytes must never
+ * make the parser step outside its buffer (run under ASan to check).
+ */
+
+#include "websocket.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_STREAMS 200
+#define FUZZ_GARBAGE 2000
+
+/* ========== Test Framework ========== */
+
+static int test_count = 0;
+static int test_passed = 0;
+static int test_failed = 0;
+
+void test_setup(const char *test_name) {
+    test_count++;
+    printf("\n[TEST %d] %s\n", test_count, test_name);
+}
+
+void test_assert(int condition, const char *message) {
+    if (condition) {
+        printf("  ✓ PASS\n");
+        test_passed++;
+    } else {
+        printf("  ✗ FAIL: %s\n", message);
+        test_failed++;
+    }
+}
+
+/* ========== Helpers ========== */
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+/* Write a client frame (masked when key is given); returns its length */
+static size_t put_frame(uint8_t *out, int fin, int opcode, const uint8_t *payload, size_t len,
+                        const uint8_t *key) {
+    size_t pos = 0;
+    out[pos++] = (uint8_t)((fin ? 0x80 : 0) | opcode);
+    uint8_t mask_bit = key ? 0x80 : 0;
+    if (len < 126) {
+        out[pos++] = mask_bit | (uint8_t)len;
+    } else if (len <= 65535) {
+        out[pos++] = mask_bit | 126;
+        out[pos++] = (uint8_t)(len >> 8);
+        out[pos++] = (uint8_t)len;
+    } else {
+        out[pos++] = mask_bit | 127;
+        for (int i = 7; i >= 0; i--) out[pos++] = (uint8_t)((uint64_t)len >> (i * 8));
+    }
+    if (key) {
+        memcpy(out + pos, key, 4);
+        pos += 4;
+    }
+    for (size_t i = 0; i < len; i++) {
+        out[pos + i] = key ? payload[i] ^ key[i % 4] : payload[i];
+    }
+    return pos + len;
+}
+
+/* Receive bytes the way the driver does; returns how many fit */
+static size_t feed(WSParser *parser, const uint8_t *data, size_t len) {
+    size_t avail;
+    uint8_t *space = ws_parser_space(parser, &avail);
+    if (!space) return 0;
+    if (len > avail) len = avail;
+    memcpy(space, data, len);
+    ws_parser_commit(parser, len);
+    return len;
+}
+
+static int message_is(const WSMessage *message, int opcode, const char *text) {
+    size_t len = strlen(text);
+    return message->opcode == opcode && message->len == len &&
+           memcmp(message->data, text, len) == 0 && message->data[len] == '\0';
+}
+
+static const uint8_t key_a[4] = { 0x37, 0xfa, 0x21, 0x3d };
+static const uint8_t key_b[4] = { 0x01, 0x80, 0xff, 0x5a };
+
+/* ========== Tests ========== */
+
+void test_unmask(void) {
+    test_setup("Word-at-a-time unmasking matches the bytewise definition");
+    uint8_t src[64], expected[64], out[64], buffer[80];
+    for (int i = 0; i < 64; i++) src[i] = (uint8_t)(i * 7 + 3);
+
+    int same = 1, in_place = 1, shifted = 1;
+    for (size_t len = 0; len <= 40; len++) {
+        for (size_t offset = 0; offset < 4; offset++) {
+            for (size_t i = 0; i < len; i++) expected[i] = src[i] ^ key_a[(offset + i) % 4];
+
+            ws_unmask(out, src, len, key_a, offset);
+            if (memcmp(out, expected, len) != 0) same = 0;
+
+            memcpy(out, src, len);
+            ws_unmask(out, out, len, key_a, offset);
+            if (memcmp(out, expected, len) != 0) in_place = 0;
+
+            memcpy(buffer + 13, src, len);
+            ws_unmask(buffer + 2, buffer + 13, len, key_a, offset);
+            if (memcmp(buffer + 2, expected, len) != 0) shifted = 0;
+        }
+    }
+    test_assert(same, "Unmasking into another buffer should match");
+    test_assert(in_place, "Unmasking in place should match");
+    test_assert(shifted, "Unmasking down within a buffer should match");
+}
+
+void test_whole_frames(void) {
+    test_setup("Whole frames come out in place and NUL-terminated");
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    uint8_t stream[256];
+    size_t len = put_frame(stream, 1, WS_OPCODE_TEXT, (const uint8_t *)"look", 4, key_a);
+    len += put_frame(stream + len, 1, WS_OPCODE_TEXT, (const uint8_t *)"north", 5, key_b);
+    len += put_frame(stream + len, 1, WS_OPCODE_BINARY, (const uint8_t *)"", 0, key_a);
+    feed(parser, stream, len);
+
+    WSMessage message;
+    test_assert(ws_parser_next(parser, &message) == 0 && message_is(&message, WS_OPCODE_TEXT, "look"),
+                "The first frame should be \"look\"");
+    test_assert(message.data >= parser->buffer && message.data < parser->buffer + WS_PARSER_BUFFER_SIZE,
+                "The payload should be borrowed from the parser's buffer");
+    test_assert(ws_parser_next(parser, &message) == 0 && message_is(&message, WS_OPCODE_TEXT, "north"),
+                "The terminator should not have damaged the next frame");
+    test_assert(ws_parser_next(parser, &message) == 0 && message.opcode == WS_OPCODE_BINARY &&
+                message.len == 0, "An empty frame should come out empty");
+    test_assert(ws_parser_next(parser, &message) == 1, "Nothing more should be there");
+    test_assert(parser->end == 0 && parser->pos == 0, "A drained buffer should start over at the front");
+    free(parser);
+}
+
+void test_split_reads(void) {
+    test_setup("A frame arriving a byte at a time is parsed once whole");
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    const char *text = "say a fairly long line, longer than one machine word or two";
+    uint8_t stream[256];
+    size_t len = put_frame(stream, 1, WS_OPCODE_TEXT, (const uint8_t *)text, strlen(text), key_b);
+
+    WSMessage message;
+    int early = 0;
+    for (size_t i = 0; i + 1 < len; i++) {
+        feed(parser, stream + i, 1);
+        if (ws_parser_next(parser, &message) != 1) early = 1;
+    }
+    feed(parser, stream + len - 1, 1);
+    test_assert(!early, "Nothing should come out before the last byte");
+    test_assert(ws_parser_next(parser, &message) == 0 && message_is(&message, WS_OPCODE_TEXT, text),
+                "The message should come out whole");
+    free(parser);
+}
+
+void test_fragments(void) {
+    test_setup("Fragments are joined around control frames");
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    uint8_t stream[256];
+    size_t len = put_frame(stream, 0, WS_OPCODE_TEXT, (const uint8_t *)"hel", 3, key_a);
+    len += put_frame(stream + len, 1, WS_OPCODE_PING, (const uint8_t *)"beat", 4, key_b);
+    len += put_frame(stream + len, 0, WS_OPCODE_CONTINUATION, (const uint8_t *)"lo ", 3, key_b);
+    len += put_frame(stream + len, 1, WS_OPCODE_CONTINUATION, (const uint8_t *)"world", 5, NULL);
+    len += put_frame(stream + len, 1, WS_OPCODE_CLOSE, (const uint8_t *)"\x03\xe8", 2, key_a);
+    feed(parser, stream, len);
+
+    WSMessage message;
+    test_assert(ws_parser_next(parser, &message) == 0 && message_is(&message, WS_OPCODE_PING, "beat"),
+                "The ping should come out first");
+    test_assert(ws_parser_next(parser, &message) == 0 &&
+                message_is(&message, WS_OPCODE_TEXT, "hello world"),
+                "The fragments should come out as one message");
+    test_assert(message.data == parser->buffer, "The message should be joined where it started");
+    test_assert(ws_parser_next(parser, &message) == 0 && message.opcode == WS_OPCODE_CLOSE &&
+                message.len == 2 && message.data[0] == 0x03 && message.data[1] == 0xe8,
+                "The close frame should follow");
+    free(parser);
+}
+
+static int fails_with(const uint8_t *stream, size_t len, uint16_t code) {
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    WSMessage message;
+    feed(parser, stream, len);
+    int result;
+    while ((result = ws_parser_next(parser, &message)) == 0) {
+    }
+    int ok = result == -1 && parser->close_code == code && ws_parser_next(parser, &message) == -1;
+    free(parser);
+    return ok;
+}
+
+void test_protocol_errors(void) {
+    test_setup("Protocol errors are reported with a close code");
+    uint8_t stream[256];
+    uint8_t big[126];
+    memset(big, 'x', sizeof(big));
+
+    size_t len = put_frame(stream, 1, WS_OPCODE_TEXT, (const uint8_t *)"a", 1, key_a);
+    stream[0] |= 0x40;
+    test_assert(fails_with(stream, len, WS_CLOSE_PROTOCOL_ERROR), "An RSV bit should be refused");
+
+    len = put_frame(stream, 1, WS_OPCODE_CONTINUATION, (const uint8_t *)"a", 1, key_a);
+    test_assert(fails_with(stream, len, WS_CLOSE_PROTOCOL_ERROR), "A stray continuation should be refused");
+
+    len = put_frame(stream, 0, WS_OPCODE_TEXT, (const uint8_t *)"a", 1, key_a);
+    len += put_frame(stream + len, 1, WS_OPCODE_TEXT, (const uint8_t *)"b", 1, key_a);
+    test_assert(fails_with(stream, len, WS_CLOSE_PROTOCOL_ERROR),
+                "A new message inside a fragmented one should be refused");
+
+    len = put_frame(stream, 1, WS_OPCODE_PING, big, sizeof(big), key_a);
+    test_assert(fails_with(stream, len, WS_CLOSE_PROTOCOL_ERROR), "A long control frame should be refused");
+
+    len = put_frame(stream, 0, WS_OPCODE_PING, (const uint8_t *)"a", 1, key_a);
+    test_assert(fails_with(stream, len, WS_CLOSE_PROTOCOL_ERROR), "A fragmented control frame should be refused");
+
+    len = put_frame(stream, 1, 0x3, (const uint8_t *)"a", 1, key_a);
+    test_assert(fails_with(stream, len, WS_CLOSE_PROTOCOL_ERROR), "A reserved opcode should be refused");
+
+    static const uint8_t huge[] = { 0x81, 0xff, 0, 0, 0, 1, 0, 0, 0, 0, 1, 2, 3, 4 };
+    test_assert(fails_with(huge, sizeof(huge), WS_CLOSE_TOO_LARGE), "A huge frame should be too large");
+
+    uint8_t *half = malloc(WS_MAX_MESSAGE_SIZE);
+    memset(half, 'y', WS_MAX_MESSAGE_SIZE);
+    uint8_t *pair = malloc(2 * (WS_MAX_MESSAGE_SIZE / 2 + 1) + 32);
+    len = put_frame(pair, 0, WS_OPCODE_TEXT, half, WS_MAX_MESSAGE_SIZE / 2 + 1, key_a);
+    len += put_frame(pair + len, 1, WS_OPCODE_CONTINUATION, half, WS_MAX_MESSAGE_SIZE / 2, key_a);
+    test_assert(fails_with(pair, len, WS_CLOSE_TOO_LARGE), "Fragments adding up to too much should be refused");
+    free(pair);
+    free(half);
+}
+
+void test_handshake_bytes(void) {
+    test_setup("Bytes before the upgrade can be read and skipped");
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    uint8_t stream[256];
+    const char *request = "GET / HTTP/1.1\r\n\r\n";
+    size_t request_len = strlen(request);
+    memcpy(stream, request, request_len);
+    size_t len = request_len + put_frame(stream + request_len, 1, WS_OPCODE_TEXT,
+                                         (const uint8_t *)"who", 3, key_b);
+    feed(parser, stream, len);
+
+    size_t pending_len;
+    uint8_t *pending = ws_parser_pending(parser, &pending_len);
+    test_assert(pending_len == len && memcmp(pending, request, request_len) == 0 && pending[len] == '\0',
+                "The request should be pending and terminated");
+    ws_parser_skip(parser, request_len);
+    WSMessage message;
+    test_assert(ws_parser_next(parser, &message) == 0 && message_is(&message, WS_OPCODE_TEXT, "who"),
+                "A frame sent right behind the request should be kept");
+    free(parser);
+}
+
+void test_decode_frame(void) {
+    test_setup("ws_decode_frame() still decodes one frame into a copy");
+    uint8_t stream[64];
+    size_t len = put_frame(stream, 1, WS_OPCODE_TEXT, (const uint8_t *)"score", 5, key_a);
+    WSFrame frame;
+    size_t consumed;
+    test_assert(ws_decode_frame(stream, len - 1, &frame, &consumed) == 1, "A short frame should need more");
+    test_assert(ws_decode_frame(stream, len, &frame, &consumed) == 0 && consumed == len &&
+                frame.payload_len == 5 && strcmp((char *)frame.payload, "score") == 0,
+                "A whole frame should decode");
+    ws_frame_free(&frame);
+}
+
+/* Random messages, fragments, control frames and read sizes */
+static int fuzz_stream(uint8_t *stream, size_t capacity, uint8_t *payload) {
+    enum { MAX_EXPECTED = 64 };
+    struct { int opcode; size_t offset; size_t len; } expected[MAX_EXPECTED];
+    uint8_t *plain = malloc(capacity);
+    size_t plain_len = 0;
+    size_t len = 0;
+    int count = 0;
+
+    while (count < MAX_EXPECTED - 8 && len + 2 * WS_MAX_MESSAGE_SIZE < capacity) {
+        int kind = rng() % 8;
+        size_t size = kind == 0 ? rng() % WS_MAX_MESSAGE_SIZE : kind < 3 ? rng() % 2000 : rng() % 40;
+        for (size_t i = 0; i < size; i++) payload[i] = (uint8_t)rng();
+        int opcode = rng() % 4 == 0 ? WS_OPCODE_BINARY : WS_OPCODE_TEXT;
+        int fragments = 1 + (int)(rng() % 4);
+
+        size_t sent = 0;
+        for (int f = 0; f < fragments; f++) {
+            size_t part = f == fragments - 1 ? size - sent : (size - sent) * (rng() % 100) / 100;
+            uint8_t key[4] = { (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng() };
+            len += put_frame(stream + len, f == fragments - 1, f == 0 ? opcode : WS_OPCODE_CONTINUATION,
+                             payload + sent, part, key);
+            sent += part;
+
+            /* A ping between fragments comes out before the message */
+            if (f < fragments - 1 && rng() % 3 == 0) {
+                size_t ping = rng() % (WS_MAX_CONTROL_SIZE + 1);
+                memcpy(plain + plain_len, payload, ping);
+                expected[count].opcode = WS_OPCODE_PING;
+                expected[count].offset = plain_len;
+                expected[count++].len = ping;
+                plain_len += ping;
+                len += put_frame(stream + len, 1, WS_OPCODE_PING, payload, ping, key);
+            }
+        }
+        memcpy(plain + plain_len, payload, size);
+        expected[count].opcode = opcode;
+        expected[count].offset = plain_len;
+        expected[count++].len = size;
+        plain_len += size;
+
+        if (rng() % 4 == 0) {
+            size_t pong = rng() % (WS_MAX_CONTROL_SIZE + 1);
+            memcpy(plain + plain_len, payload, pong);
+            expected[count].opcode = WS_OPCODE_PONG;
+            expected[count].offset = plain_len;
+            expected[count++].len = pong;
+            plain_len += pong;
+            len += put_frame(stream + len, 1, WS_OPCODE_PONG, payload, pong, key_b);
+        }
+    }
+
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    size_t fed = 0;
+    int seen = 0, ok = 1;
+    while (ok && (fed < len || seen < count)) {
+        size_t chunk = rng() % 3 == 0 ? rng() % 16 : rng() % 9000;
+        if (chunk > len - fed) chunk = len - fed;
+        size_t took = feed(parser, stream + fed, chunk);
+        if (took < chunk && took == 0) ok = 0;
+        fed += took;
+
+        WSMessage message;
+        int result;
+        while ((result = ws_parser_next(parser, &message)) == 0) {
+            if (seen >= count || message.opcode != expected[seen].opcode ||
+                message.len != expected[seen].len ||
+                memcmp(message.data, plain + expected[seen].offset, message.len) != 0 ||
+                message.data[message.len] != '\0') {
+                ok = 0;
+                break;
+            }
+            seen++;
+        }
+        if (result < 0 || (fed == len && result == 1 && seen < count)) ok = 0;
+    }
+    free(parser);
+    free(plain);
+    return ok && seen == count;
+}
+
+void test_fuzz(void) {
+    test_setup("Fuzzed streams and garbage");
+    size_t capacity = 16 * WS_MAX_MESSAGE_SIZE;
+    uint8_t *stream = malloc(capacity);
+    uint8_t *payload = malloc(WS_MAX_MESSAGE_SIZE);
+
+    int streams_ok = 1;
+    for (int i = 0; i < FUZZ_STREAMS && streams_ok; i++) {
+        streams_ok = fuzz_stream(stream, capacity, payload);
+    }
+    test_assert(streams_ok, "Random streams should come out exactly as sent");
+
+    /* Garbage: valid-looking headers over random bytes, fed in random reads */
+    int garbage_ok = 1;
+    WSParser *parser = calloc(1, sizeof(WSParser));
+    for (int i = 0; i < FUZZ_GARBAGE && garbage_ok; i++) {
+        ws_parser_init(parser);
+        size_t len = 1 + rng() % 4096;
+        for (size_t j = 0; j < len; j++) stream[j] = (uint8_t)rng();
+        for (size_t j = 0; j < len; j += 1 + rng() % 64) {
+            if (rng() % 2) stream[j] &= 0x8f;
+        }
+
+        size_t fed = 0;
+        int result = 0;
+        while (fed < len && result >= 0) {
+            size_t chunk = 1 + rng() % 512;
+            if (chunk > len - fed) chunk = len - fed;
+            size_t took = feed(parser, stream + fed, chunk);
+            if (took == 0) break;
+            fed += took;
+
+            WSMessage message;
+            while ((result = ws_parser_next(parser, &message)) == 0) {
+                if (message.data < parser->buffer ||
+                    message.data + message.len > parser->buffer + WS_PARSER_BUFFER_SIZE ||
+                    message.data[message.len] != '\0') {
+                    garbage_ok = 0;
+                }
+            }
+            if (result < 0 && parser->close_code == 0) garbage_ok = 0;
+        }
+    }
+    free(parser);
+    test_assert(garbage_ok, "Garbage should only yield in-bounds messages or a close code");
+
+    free(payload);
+    free(stream);
+}
+
+/* ========== Main ========== */
+
+int main(void) {
+    printf("========================================\n");
+    printf("WebSocket Frame Parser Test Suite\n");
+    printf("========================================\n");
+
+    test_unmask();
+    test_whole_frames();
+    test_split_reads();
+    test_fragments();
+    test_protocol_errors();
+    test_handshake_bytes();
+    test_decode_frame();
+    test_fuzz();
+
+    /* Summary */
+    printf("\n========================================\n");
+    printf("Test Results: %d/%d passed", test_passed, test_count);
+    if (test_failed > 0) {
+        printf(" (%d failed)", test_failed);
+    }
+    printf("\n========================================\n\n");
+
+    return (test_failed == 0) ? 0 : 1;
+}
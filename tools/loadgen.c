@@ -0,0 +1,289 @@
+/*
+ * loadgen.c - Connection Load Generator
+ *
+ * Opens a swarm of telnet or WebSocket bots against a running driver,
+ * holds them open, and optionally has each bot send a line every few
+ * seconds. Reports how many connections the driver accepted, how many
+ * bytes flowed, and the delay between a bot sending a line and the
+ * first byte of the reply.
+ *
+ * Usage: build/loadgen [options]
+ *   -h host      Driver address (default 127.0.0.1)
+ *   -p port      Port (default 3000, or 3001 with -w)
+ *   -c clients   Bots to connect (default 1000)
+ *   -d seconds   How long to hold the swarm (default 30)
+ *   -i seconds   Interval between lines per bot, 0 to stay idle (default 0)
+ *   -l line      Line the bots send (default "look")
+ *   -w           Speak WebSocket instead of telnet
+ *
+ * Raise the descriptor limit first (ulimit -n) for large swarms; the
+ * driver needs the same.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define LOADGEN_EVENTS 512
+#define LOADGEN_READ_SIZE 16384
+
+typedef struct {
+    int fd;
+    int connected;              /* connect() finished */
+    int ws_open;                /* WebSocket handshake answered */
+    double next_send;           /* When the bot sends its next line */
+    double sent_at;             /* Awaiting a reply since; 0 if not */
+} Bot;
+
+typedef struct {
+    long connected;
+    long failed;
+    long closed;                /* Dropped by the driver */
+    long lines_sent;
+    long replies;
+    unsigned long long bytes_in;
+    unsigned long long bytes_out;
+    double latency_sum;
+    double latency_max;
+} LoadStats;
+
+static const char *ws_request =
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n\r\n";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void send_bytes(Bot *bot, LoadStats *stats, const void *data, size_t len) {
+    ssize_t sent = send(bot->fd, data, len, MSG_NOSIGNAL);
+    if (sent > 0) stats->bytes_out += (unsigned long long)sent;
+}
+
+/* Client frames must be masked (RFC 6455 5.3) */
+static void send_line(Bot *bot, LoadStats *stats, const char *line, int websocket) {
+    size_t len = strlen(line);
+
+    if (!websocket) {
+        char buf[512];
+        int n = snprintf(buf, sizeof(buf), "%s\r\n", line);
+        send_bytes(bot, stats, buf, (size_t)n);
+        return;
+    }
+
+    unsigned char frame[512];
+    unsigned char mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    if (len > 125) len = 125;
+    frame[0] = 0x81;
+    frame[1] = 0x80 | (unsigned char)len;
+    memcpy(frame + 2, mask, 4);
+    for (size_t i = 0; i < len; i++) {
+        frame[6 + i] = (unsigned char)line[i] ^ mask[i & 3];
+    }
+    send_bytes(bot, stats, frame, len + 6);
+}
+
+static int start_connect(Bot *bot, int epfd, const struct sockaddr_in *addr) {
+    bot->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (bot->fd < 0) return -1;
+
+    if (connect(bot->fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0 && errno != EINPROGRESS) {
+        close(bot->fd);
+        bot->fd = -1;
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = bot;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, bot->fd, &ev) < 0) {
+        close(bot->fd);
+        bot->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void drop_bot(Bot *bot, int epfd) {
+    if (bot->fd < 0) return;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, bot->fd, NULL);
+    close(bot->fd);
+    bot->fd = -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-h host] [-p port] [-c clients] [-d seconds] "
+                    "[-i interval] [-l line] [-w]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1";
+    const char *line = "look";
+    int port = 0;
+    int clients = 1000;
+    int websocket = 0;
+    double duration = 30.0;
+    double interval = 0.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:c:d:i:l:w")) != -1) {
+        switch (opt) {
+            case 'h': host = optarg; break;
+            case 'p': port = atoi(optarg); break;
+            case 'c': clients = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'i': interval = atof(optarg); break;
+            case 'l': line = optarg; break;
+            case 'w': websocket = 1; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (port <= 0) port = websocket ? 3001 : 3000;
+    if (clients <= 0) clients = 1;
+
+    /* Ask for enough descriptors; the hard limit may still say no */
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < (rlim_t)clients + 16) {
+        rl.rlim_cur = rl.rlim_max < (rlim_t)clients + 16 ? rl.rlim_max : (rlim_t)clients + 16;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "loadgen: bad address %s\n", host);
+        return 1;
+    }
+
+    int epfd = epoll_create1(0);
+    Bot *bots = calloc((size_t)clients, sizeof(Bot));
+    if (epfd < 0 || !bots) {
+        fprintf(stderr, "loadgen: setup failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    LoadStats stats;
+    memset(&stats, 0, sizeof(stats));
+    double start = now_seconds();
+
+    for (int i = 0; i < clients; i++) {
+        bots[i].fd = -1;
+        if (start_connect(&bots[i], epfd, &addr) != 0) stats.failed++;
+        /* Spread the first lines over one interval */
+        bots[i].next_send = start + 1.0 + (interval > 0 ? interval * i / clients : 0);
+    }
+
+    struct epoll_event events[LOADGEN_EVENTS];
+    char buffer[LOADGEN_READ_SIZE];
+    double deadline = start + duration;
+    double last_report = start;
+
+    while (now_seconds() < deadline) {
+        int n = epoll_wait(epfd, events, LOADGEN_EVENTS, 100);
+        double now = now_seconds();
+
+        for (int i = 0; i < n; i++) {
+            Bot *bot = (Bot *)events[i].data.ptr;
+            if (bot->fd < 0) continue;
+
+            if (!bot->connected && (events[i].events & (EPOLLOUT | EPOLLERR))) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(bot->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    stats.failed++;
+                    drop_bot(bot, epfd);
+                    continue;
+                }
+                bot->connected = 1;
+                stats.connected++;
+                if (websocket) send_bytes(bot, &stats, ws_request, strlen(ws_request));
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                for (;;) {
+                    ssize_t got = recv(bot->fd, buffer, sizeof(buffer), 0);
+                    if (got > 0) {
+                        stats.bytes_in += (unsigned long long)got;
+                        if (websocket && !bot->ws_open) bot->ws_open = 1;
+                        if (bot->sent_at > 0) {
+                            double latency = now - bot->sent_at;
+                            stats.latency_sum += latency;
+                            if (latency > stats.latency_max) stats.latency_max = latency;
+                            stats.replies++;
+                            bot->sent_at = 0;
+                        }
+                        continue;
+                    }
+                    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    if (got < 0 && errno == EINTR) continue;
+                    stats.closed++;
+                    drop_bot(bot, epfd);
+                    break;
+                }
+            }
+        }
+
+        if (interval > 0) {
+            for (int i = 0; i < clients; i++) {
+                Bot *bot = &bots[i];
+                if (bot->fd < 0 || !bot->connected || now < bot->next_send) continue;
+                if (websocket && !bot->ws_open) continue;
+                send_line(bot, &stats, line, websocket);
+                stats.lines_sent++;
+                if (bot->sent_at == 0) bot->sent_at = now;
+                bot->next_send = now + interval;
+            }
+        }
+
+        if (now - last_report >= 5.0) {
+            fprintf(stderr, "[loadgen] %.0fs: %ld connected, %ld failed, %ld closed\n",
+                    now - start, stats.connected, stats.failed, stats.closed);
+            last_report = now;
+        }
+    }
+
+    long open = 0;
+    for (int i = 0; i < clients; i++) {
+        if (bots[i].fd >= 0 && bots[i].connected) open++;
+        drop_bot(&bots[i], epfd);
+    }
+    close(epfd);
+    free(bots);
+
+    printf("\n========================================\n");
+    printf("Load generator: %d %s bots for %.0fs\n", clients, websocket ? "WebSocket" : "telnet", duration);
+    printf("========================================\n");
+    printf("  connected:   %ld (failed %ld, dropped by driver %ld)\n",
+           stats.connected, stats.failed, stats.closed);
+    printf("  still open:  %ld\n", open);
+    printf("  lines sent:  %ld\n", stats.lines_sent);
+    printf("  bytes:       %llu in, %llu out\n", stats.bytes_in, stats.bytes_out);
+    if (stats.replies > 0) {
+        printf("  reply delay: %.2f ms avg, %.2f ms max (%ld replies)\n",
+               stats.latency_sum * 1000.0 / stats.replies, stats.latency_max * 1000.0, stats.replies);
+    }
+    printf("\n");
+
+    return open == clients ? 0 : 1;
+}
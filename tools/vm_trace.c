@@ -58,6 +58,12 @@ static const char *vm_debug_opcode_name(OpCode opcode) {
         case OP_CALL_METHOD: return "CALL_METHOD";
         case OP_HALT: return "HALT";
         case OP_PRINT: return "PRINT";
+        case OP_PUSH_CONST: return "PUSH_CONST";
+        case OP_PUSH_INT_ADD: return "PUSH_INT_ADD";
+        case OP_INC_LOCAL: return "INC_LOCAL";
+        case OP_LOAD_LOCAL_LOAD_LOCAL: return "LOAD_LOCAL_LOAD_LOCAL";
+        case OP_CMP_JUMP_IF_FALSE: return "CMP_JUMP_IF_FALSE";
+        case OP_RETURN_LOCAL: return "RETURN_LOCAL";
         default: return "UNKNOWN";
     }
 }
@@ -145,6 +151,13 @@ void vm_debug_init(VirtualMachine *vm) {
     }
 }
 
+/* Stop profiling into a VM that is being freed */
+void vm_debug_shutdown(VirtualMachine *vm) {
+    if (vm_profile_owner == vm) {
+        vm_profile_owner = NULL;
+    }
+}
+
 void vm_debug_set_flags(VirtualMachine *vm, unsigned int flags) {
     if (!vm) return;
     vm->debug_flags = flags;
@@ -166,8 +179,8 @@ void vm_debug_disable(VirtualMachine *vm, unsigned int flags) {
 }
 
 void vm_trace_instruction(VirtualMachine *vm, CallFrame *frame,
-                          VMInstruction *instr, int instruction_index) {
-    if (!vm || !instr) return;
+                          VMCode word, int instruction_index) {
+    if (!vm) return;
 
     FILE *out = vm_trace_output(vm);
     const char *func_name = frame && frame->function ? frame->function->name : "<toplevel>";
@@ -177,7 +190,7 @@ void vm_trace_instruction(VirtualMachine *vm, CallFrame *frame,
     int line = vm_trace_line_for_frame(frame, instruction_index);
 
     fprintf(out, "[VM TRACE] %s ip=%d op=%s", func_name, instruction_index,
-            vm_debug_opcode_name(instr->opcode));
+            vm_debug_opcode_name(VM_CODE_OP(word)));
     if (line >= 0) {
         fprintf(out, " line=%d file=%s", line, source_file);
     }
@@ -247,7 +260,8 @@ void vm_trace_dump_function(VirtualMachine *vm, VMFunction *function, FILE *out)
 
     fprintf(out, "[BYTECODE] Instructions:\n");
     for (int i = 0; i < function->instruction_count; i++) {
-        VMInstruction instr = function->instructions[i];
+        VMInstruction instr;
+        if (vm_function_decode(function, i, &instr) != 0) break;
         int line = (function->line_map && i < function->line_map_count)
             ? function->line_map[i]
             : -1;
@@ -284,8 +298,24 @@ void vm_trace_dump_function(VirtualMachine *vm, VMFunction *function, FILE *out)
             case OP_MAKE_ARRAY:
             case OP_MAKE_MAPPING:
             case OP_CALL_METHOD:
+            case OP_PUSH_INT_ADD:
+            case OP_RETURN_LOCAL:
                 fprintf(out, " %ld", instr.operand.int_operand);
                 break;
+            case OP_INC_LOCAL:
+            case OP_LOAD_LOCAL_LOAD_LOCAL:
+            case OP_CMP_JUMP_IF_FALSE: {
+                VMCode word = VM_CODE(instr.opcode, instr.operand.int_operand);
+                if (instr.opcode == OP_INC_LOCAL) {
+                    fprintf(out, " %d += %d", VM_CODE_LO(word), VM_CODE_SHI(word));
+                } else if (instr.opcode == OP_LOAD_LOCAL_LOAD_LOCAL) {
+                    fprintf(out, " %d, %d", VM_CODE_LO(word), VM_CODE_HI(word));
+                } else {
+                    fprintf(out, " %s -> %d",
+                            vm_debug_opcode_name((OpCode)(OP_EQ + VM_CODE_LO(word))), VM_CODE_HI(word));
+                }
+                break;
+            }
             default:
                 break;
         }
@@ -343,4 +373,9 @@ void vm_profile_report(FILE *out) {
             vm_profile_owner->profile.string_bytes_alloc,
             vm_profile_owner->profile.string_bytes_free,
             (long)(vm_profile_owner->profile.string_bytes_alloc - vm_profile_owner->profile.string_bytes_free));
+
+    fprintf(out, "[VM PROFILE] Method call caches\n");
+    fprintf(out, "  hits=%lu misses=%lu\n",
+            vm_profile_owner->profile.method_cache_hits,
+            vm_profile_owner->profile.method_cache_misses);
 }